@@ -22,6 +22,7 @@ import android.view.MenuItem;
 import android.view.View;
 
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.LinkedHashSet;
 import java.util.List;
 import java.util.Set;
@@ -47,6 +48,7 @@ public class GameChooser extends ActivityWithLoadButton implements SharedPrefere
 	private SharedPreferences _prefs;
     private boolean _useGrid;
 	private ListItemBinding[] _itemBindings;
+	private boolean[] _iconLoaded;
 	private Menu _menu;
 	private int _scrollToOnNextLayout = -1;
 	private long _resumeTime = 0;
@@ -77,6 +79,7 @@ public class GameChooser extends ActivityWithLoadButton implements SharedPrefere
 
 		_useGrid = _prefs.getString(PrefsConstants.CHOOSER_STYLE_KEY, "list").equals("grid");
 		_itemBindings = new ListItemBinding[BackendName.values().length];
+		_iconLoaded = new boolean[BackendName.values().length];
 		_binding = ChooserBinding.inflate(getLayoutInflater());
 		setContentView(_binding.getRoot());
 		buildViews();
@@ -94,7 +97,9 @@ public class GameChooser extends ActivityWithLoadButton implements SharedPrefere
 				_binding.scrollView.requestChildRectangleOnScreen(v, new Rect(0, 0, v.getWidth(), v.getHeight()), true);
 				_scrollToOnNextLayout = -1;
 			}
+			loadVisibleIcons();
 		});
+		_binding.scrollView.getViewTreeObserver().addOnScrollChangedListener(this::loadVisibleIcons);
 
 		enableTableAnimations();
 	}
@@ -131,7 +136,6 @@ public class GameChooser extends ActivityWithLoadButton implements SharedPrefere
 			final BackendName backend = BackendName.values()[i];
 			final ListItemBinding itemBinding = ListItemBinding.inflate(getLayoutInflater());
 			_itemBindings[i] = itemBinding;
-			itemBinding.icon.setImageDrawable(backend.getIcon(this));
 			SpannableStringBuilder desc = new SpannableStringBuilder(backend.getDisplayName());
 			desc.setSpan(new TextAppearanceSpan(this, R.style.ChooserItemName),
 					0, desc.length(), Spannable.SPAN_EXCLUSIVE_EXCLUSIVE);
@@ -156,6 +160,23 @@ public class GameChooser extends ActivityWithLoadButton implements SharedPrefere
 		rethinkColumns(true);
 	}
 
+	/** Icons are decoded only once their item is within a screen's height of being visible:
+	 *  decoding every icon up front was the bulk of the chooser's cold-start time. */
+	private void loadVisibleIcons() {
+		final int viewportHeight = _binding.scrollView.getHeight();
+		if (viewportHeight == 0) return;  // not laid out yet
+		final int top = _binding.scrollView.getScrollY() - viewportHeight;
+		final int bottom = _binding.scrollView.getScrollY() + 2 * viewportHeight;
+		final int tableTop = _binding.table.getTop();
+		for (int i = 0; i < BackendName.values().length; i++) {
+			if (_iconLoaded[i]) continue;
+			final View v = _itemBindings[i].getRoot();
+			if (v.getHeight() == 0 || tableTop + v.getBottom() < top || tableTop + v.getTop() > bottom) continue;
+			_itemBindings[i].icon.setImageDrawable(BackendName.values()[i].getIcon(this));
+			_iconLoaded[i] = true;
+		}
+	}
+
 	@SuppressLint("ClickableViewAccessibility")  // Does not define a new click mechanism
 	private void ignoreTouchAfterResume(View view) {
 		view.setOnTouchListener((v, event) -> {
@@ -178,8 +199,10 @@ public class GameChooser extends ActivityWithLoadButton implements SharedPrefere
 		final boolean isNight = NightModeHelper.isNight(getResources().getConfiguration());
 		if (_wasNight != isNight) {
 			for (int i = 0; i < BackendName.values().length; i++) {
-				_itemBindings[i].icon.setImageDrawable(BackendName.values()[i].getIcon(this));
+				_itemBindings[i].icon.setImageDrawable(null);
 			}
+			Arrays.fill(_iconLoaded, false);
+			loadVisibleIcons();
 		}
 		rethinkColumns(_wasNight != isNight);
 		if (_menu != null) {
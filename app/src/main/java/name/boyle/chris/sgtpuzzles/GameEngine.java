@@ -9,6 +9,7 @@ import androidx.annotation.Nullable;
 import androidx.annotation.VisibleForTesting;
 
 import java.io.ByteArrayOutputStream;
+import java.nio.ByteBuffer;
 
 public interface GameEngine {
     @UsedByJNI
@@ -28,14 +29,12 @@ public interface GameEngine {
         void blitterFree(int i);
         void blitterLoad(int i, int x, int y);
         void blitterSave(int i, int x, int y);
-        void clipRect(int x, int y, int w, int h);
-        void drawCircle(float thickness, float x, float y, float r, int lineColour, int fillColour);
-        void drawLine(float thickness, float x1, float y1, float x2, float y2, int colour);
-        void drawPoly(float thickness, int[] points, int ox, int oy, int line, int fill);
-        void drawText(int x, int y, int flags, int size, int colour, String text);
-        void fillRect(final int x, final int y, final int w, final int h, final int colour);
+        void drawCommands(ByteBuffer commands, int length);
         int getDefaultBackgroundColour();
+        void frameStats(String json);
+        void invalidateGameRect(int x, int y, int w, int h);
         void postInvalidateOnAnimation();
+        void registerDrawString(int id, String text);
         void unClip(int marginX, int marginY);
     }
 
@@ -61,11 +60,14 @@ public interface GameEngine {
 
     @Nullable KeysResult requestKeys(@NonNull BackendName backend, @Nullable String params);
 
-    void timerTick();
+    int timerTick();
     String htmlHelpTopic();
     void keyEvent(int x, int y, int k);
     void restartEvent();
-    void solveEvent();
+    /** Snapshot the position for {@link GameEngineImpl#runSolve(long)}, returning 0 if there's no game. */
+    long startSolve();
+    /** Enter a finished solve's result, unless the position has changed since it started. */
+    void finishSolve(long job);
     void resizeEvent(int x, int y);
     void serialise(ByteArrayOutputStream baos);
     String getCurrentParams();
@@ -74,6 +76,9 @@ public interface GameEngine {
     int getUIVisibility();
     void resetTimerBaseline();
     void purgeStates();
+    void setJournal(@Nullable String path);
+    boolean flushJournal();
+    void setFrameStats(boolean enabled);
     boolean isCompletedNow();
     float[] getColours();
     float suggestDensity(int x, int y);
@@ -85,11 +90,12 @@ public interface GameEngine {
         @Override public void onDestroy() {}
         @Override public void configEvent(CustomDialogBuilder.ActivityCallbacks activityCallbacks, int whichEvent, Context context, BackendName backendName) {}
         @Nullable @Override public KeysResult requestKeys(@NonNull BackendName backend, @Nullable String params) { return null; }
-        @Override public void timerTick() {}
+        @Override public int timerTick() { return 0; }
         @Override public String htmlHelpTopic() { return null; }
         @Override public void keyEvent(int x, int y, int k) {}
         @Override public void restartEvent() {}
-        @Override public void solveEvent() {}
+        @Override public long startSolve() { return 0; }
+        @Override public void finishSolve(long job) {}
         @Override public void resizeEvent(int x, int y) {}
         @Override public void serialise(ByteArrayOutputStream baos) {}
         @Override public String getCurrentParams() { return null; }
@@ -98,6 +104,9 @@ public interface GameEngine {
         @Override public int getUIVisibility() { return 0; }
         @Override public void resetTimerBaseline() {}
         @Override public void purgeStates() {}
+        @Override public void setJournal(@Nullable String path) {}
+        @Override public boolean flushJournal() { return false; }
+        @Override public void setFrameStats(boolean enabled) {}
         @Override public boolean isCompletedNow() { return false; }
         @Override public float[] getColours() { return new float[0]; }
         @Override public float suggestDensity(int x, int y) { return 1.f; }
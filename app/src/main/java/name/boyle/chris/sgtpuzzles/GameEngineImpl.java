@@ -9,6 +9,10 @@ import androidx.annotation.Nullable;
 import androidx.annotation.VisibleForTesting;
 
 import java.io.ByteArrayOutputStream;
+import java.util.ArrayList;
+import java.util.EnumMap;
+import java.util.List;
+import java.util.Map;
 
 public class GameEngineImpl implements CustomDialogBuilder.EngineCallbacks, GameEngine {
 
@@ -18,6 +22,9 @@ public class GameEngineImpl implements CustomDialogBuilder.EngineCallbacks, Game
     @NonNull
     private final BackendName _backend;
 
+    /** A backend's presets never change, but each game has its own midend, so remember them here. */
+    private static final Map<BackendName, MenuEntry[]> presetsCache = new EnumMap<>(BackendName.class);
+
     @UsedByJNI
     private GameEngineImpl(final long nativeFrontend, @NonNull final BackendName backend) {
         _nativeFrontend = nativeFrontend;
@@ -43,7 +50,12 @@ public class GameEngineImpl implements CustomDialogBuilder.EngineCallbacks, Game
 
     private static native GameEngine fromSavedGame(final String savedGame, final ActivityCallbacks activityCallbacks, final ViewCallbacks viewCallbacks);
     private static native GameEngine fromGameID(final String gameID, final BackendName backendName, final ActivityCallbacks activityCallbacks, final ViewCallbacks viewCallbacks);
+    /** Start entry {@code index} of a puzzle pack file written by puzzles-bench --pack, without generating anything. */
+    static native GameEngine fromPack(final String packPath, final int index, final ActivityCallbacks activityCallbacks, final ViewCallbacks viewCallbacks);
+    static native int getPackSize(final String packPath);
     @NonNull static native BackendName identifyBackend(String savedGame);
+    /** Replays a journal (see midend_set_journal()) into baos as an ordinary save; false if it can't. */
+    static native boolean loadJournal(String path, ByteArrayOutputStream baos);
     @NonNull static native String getDefaultParams(final BackendName backend);
 
     public native void configEvent(CustomDialogBuilder.ActivityCallbacks activityCallbacks, int whichEvent, Context context, BackendName backendName);
@@ -56,19 +68,50 @@ public class GameEngineImpl implements CustomDialogBuilder.EngineCallbacks, Game
     public native void configSetChoice(String item_ptr, int selected);
 
     @Nullable public native GameEngine.KeysResult requestKeys(@NonNull BackendName backend, @Nullable String params);
-    public native void timerTick();
+    public native int timerTick();
     public native String htmlHelpTopic();
     public native void keyEvent(int x, int y, int k);
     public native void restartEvent();
-    public native void solveEvent();
+    public native long startSolve();
+    /** Do the work of a solve from {@link #startSolve()}, on any thread. */
+    static native void runSolve(long job);
+    public native void finishSolve(long job);
+    /** Free a solve job whose engine has been replaced, without finishing it. */
+    static native void discardSolve(long job);
     public native void resizeEvent(int x, int y);
     public native void serialise(ByteArrayOutputStream baos);
     public native String getCurrentParams();
     public native void setCursorVisibility(boolean visible);
-    public native MenuEntry[] getPresets();
+    private native String[] getPresetsFlat();
+
+    public MenuEntry[] getPresets() {
+        MenuEntry[] presets = presetsCache.get(_backend);
+        if (presets == null) {
+            presets = parsePresets(getPresetsFlat(), new int[]{0});
+            presetsCache.put(_backend, presets);
+        }
+        return presets;
+    }
+
+    /** Rebuilds the menu from getPresetsFlat's listing: id, title and params for each entry in
+     *  order, where a submenu has null params and is followed by its own entries and three nulls. */
+    private static MenuEntry[] parsePresets(final String[] flat, final int[] pos) {
+        final List<MenuEntry> entries = new ArrayList<>();
+        while (pos[0] < flat.length && flat[pos[0]] != null) {
+            final int id = Integer.parseInt(flat[pos[0]]);
+            final String title = flat[pos[0] + 1], params = flat[pos[0] + 2];
+            pos[0] += 3;
+            entries.add(params != null ? new MenuEntry(id, title, params) : new MenuEntry(id, title, parsePresets(flat, pos)));
+        }
+        pos[0] += 3;
+        return entries.toArray(new MenuEntry[0]);
+    }
     public native int getUIVisibility();
     public native void resetTimerBaseline();
     public native void purgeStates();
+    public native void setJournal(@Nullable String path);
+    public native boolean flushJournal();
+    public native void setFrameStats(boolean enabled);
     public native boolean isCompletedNow();
     public native float[] getColours();
     public native float suggestDensity(int x, int y);
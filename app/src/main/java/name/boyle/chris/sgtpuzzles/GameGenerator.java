@@ -3,29 +3,51 @@ package name.boyle.chris.sgtpuzzles;
 import android.content.ActivityNotFoundException;
 import android.content.Context;
 import android.content.Intent;
+import android.content.IntentFilter;
 import android.content.SharedPreferences;
 import android.content.pm.ApplicationInfo;
 import android.net.Uri;
+import android.os.BatteryManager;
 import android.os.Build;
+import android.os.PowerManager;
 import android.util.Log;
 import android.widget.Toast;
 
 import androidx.annotation.NonNull;
 
+import java.io.BufferedInputStream;
 import java.io.File;
 import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.util.ArrayDeque;
 import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collections;
+import java.util.Deque;
 import java.util.List;
 import java.util.Objects;
+import java.util.concurrent.CancellationException;
 import java.util.concurrent.ExecutorService;
 import java.util.concurrent.Executors;
 import java.util.concurrent.Future;
+import java.util.concurrent.FutureTask;
+import java.util.concurrent.atomic.AtomicInteger;
+
+import static java.nio.charset.StandardCharsets.UTF_8;
 
 public class GameGenerator {
 
     public interface Callback {
         void gameGeneratorSuccess(GameLaunch launch, String previousGame);
         void gameGeneratorFailure(Exception e, GameLaunch launch);
+        /** Called from a background thread, every so often, while a slow game generates. */
+        void gameGeneratorProgress(GameLaunch launch, long attempts);
+    }
+
+    /** Receives the generator's count of attempts so far at a new game. */
+    private interface ProgressListener {
+        void onProgress(long attempts);
     }
 
     private static final String TAG = "GameGenerator";
@@ -33,57 +55,289 @@ public class GameGenerator {
     private static final String PUZZLES_LIBRARY = "libpuzzles.so";
     private static final String[] OBSOLETE_EXECUTABLES_IN_DATA_DIR = {"puzzlesgen", "puzzlesgen-with-pie", "puzzlesgen-no-pie"};
 
+    private static final int MIN_BATTERY_PERCENT_TO_PREGENERATE = 30;
+
+    private final Context appContext;
     private final ExecutorService executor = Executors.newCachedThreadPool();
+    private final ExecutorService pregenExecutor = Executors.newSingleThreadExecutor(r -> {
+        final Thread t = new Thread(r, "pregenerate");
+        t.setPriority(Thread.MIN_PRIORITY);
+        return t;
+    });
+    private final AtomicInteger foregroundRequests = new AtomicInteger(0);
+    private final PregeneratedGames pregeneratedGames;
+    private final Deque<Worker> idleWorkers = new ArrayDeque<>();
+    private final int maxIdleWorkers = Math.max(1, Runtime.getRuntime().availableProcessors());
+
+    /** A long-lived libpuzzlesgen.so in --worker mode, which generates one game per request line
+     *  so that we don't pay for process startup and linking on each new game. */
+    private static class Worker {
+        private final Process process;
+        private final OutputStream toWorker;
+        private final InputStream fromWorker;
+        private volatile boolean destroyed = false;
+
+        Worker(final ApplicationInfo appInfo) throws IOException {
+            process = startGameGenProcess(appInfo, Collections.singletonList("--worker"));
+            toWorker = process.getOutputStream();
+            fromWorker = new BufferedInputStream(process.getInputStream());
+        }
+
+        /** @return the save file for the new game; throws IllegalArgumentException for bogus params,
+         *  or CancellationException if {@link #cancel()} stopped the generation */
+        String request(final List<String> args, final ProgressListener listener) throws IOException {
+            final StringBuilder line = new StringBuilder();
+            for (final String arg : args) {
+                if (line.length() > 0) line.append('\t');
+                line.append(arg);
+            }
+            line.append('\n');
+            send(line.toString());
+            String header;
+            while ((header = readHeader()).startsWith("PROGRESS ")) {
+                if (listener == null) continue;
+                try {
+                    listener.onProgress(Long.parseLong(header.substring("PROGRESS ".length())));
+                } catch (NumberFormatException e) {
+                    throw new IOException("Bad response from game generator: " + header);
+                }
+            }
+            final int space = header.indexOf(' ');
+            if (space < 0) throw new IOException("Bad response from game generator: " + header);
+            final int length;
+            try {
+                length = Integer.parseInt(header.substring(space + 1));
+            } catch (NumberFormatException e) {
+                throw new IOException("Bad response from game generator: " + header);
+            }
+            final byte[] body = new byte[length];
+            int got = 0;
+            while (got < length) {
+                final int n = fromWorker.read(body, got, length - got);
+                if (n < 0) throw new IOException("Game generator exited mid-response");
+                got += n;
+            }
+            final String result = new String(body, UTF_8);
+            if (header.startsWith("ERR ")) throw new IllegalArgumentException(result);
+            if (header.startsWith("CANCELLED ")) throw new CancellationException();
+            return result;
+        }
+
+        private synchronized void send(final String message) throws IOException {
+            toWorker.write(message.getBytes(UTF_8));
+            toWorker.flush();
+        }
+
+        /** Asks the worker to abandon the game it's generating, so that it can be reused; its
+         *  request then returns as usual or throws CancellationException. If it can't be asked,
+         *  it's destroyed instead. */
+        void cancel() {
+            try {
+                send("CANCEL\n");
+            } catch (IOException e) {
+                destroy();
+            }
+        }
+
+        private String readHeader() throws IOException {
+            final StringBuilder header = new StringBuilder();
+            int c;
+            while ((c = fromWorker.read()) != '\n') {
+                if (c < 0) {
+                    final String stderr = Utils.readAllOf(process.getErrorStream());
+                    final String exitError = "Game generator exited unexpectedly" + (stderr.isEmpty() ? "" : ": " + stderr);
+                    Log.e(TAG, exitError);
+                    throw new IOException(exitError);
+                }
+                header.append((char) c);
+            }
+            return header.toString();
+        }
+
+        void destroy() {
+            destroyed = true;
+            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.O) {
+                process.destroyForcibly();
+            } else {
+                process.destroy();
+            }
+        }
+    }
+
+    public GameGenerator(final Context context) {
+        appContext = context.getApplicationContext();
+        pregeneratedGames = new PregeneratedGames(new File(appContext.getCacheDir(), "pregenerated"));
+    }
 
     public void onDestroy() {
         executor.shutdownNow();
+        pregenExecutor.shutdownNow();
+        synchronized (idleWorkers) {
+            for (final Worker worker : idleWorkers) {
+                worker.destroy();
+            }
+            idleWorkers.clear();
+        }
+    }
+
+    @NonNull
+    private Worker borrowWorker(final ApplicationInfo appInfo) throws IOException {
+        synchronized (idleWorkers) {
+            final Worker idle = idleWorkers.pollFirst();
+            if (idle != null) return idle;
+        }
+        return new Worker(appInfo);
+    }
+
+    private void returnWorker(final Worker worker) {
+        synchronized (idleWorkers) {
+            if (!worker.destroyed && !executor.isShutdown() && idleWorkers.size() < maxIdleWorkers) {
+                idleWorkers.addFirst(worker);
+                return;
+            }
+        }
+        worker.destroy();
     }
 
     @NonNull
     public Future<?> generate(final ApplicationInfo appInfo, final GameLaunch input, final List<String> args, final String previousGame, final Callback callback) {
-        // CompletableFuture would be cleaner when we reach minSdkVersion 24
-        final Future<?>[] future = new Future[] {null};
-        future[0] = executor.submit(() -> {
-            final String generated;
+        // Cancelling a request asks the worker busy with it to give up, which the slower
+        // generators check for every so often; the worker then goes back to the pool.
+        final Worker[] busy = new Worker[] {null};
+        // Only plain (backend, params) requests can be served from, or refill, the pre-generated queue
+        final String backend = args.get(0);
+        final String pregenParams = (args.size() == 2 && !args.get(1).startsWith("--")) ? args.get(1) : null;
+        final FutureTask<Void> task = new FutureTask<Void>(() -> {
+            foregroundRequests.incrementAndGet();
             try {
-                final Process process = startGameGenProcess(appInfo, args);
-                process.getOutputStream().close();
-                final int exitStatus;
-                final String stderr;
-                try {
-                    exitStatus = process.waitFor();
-                    if (future[0] != null && future[0].isCancelled()) return;
-                    generated = Utils.readAllOf(process.getInputStream());
-                    stderr = Utils.readAllOf(process.getErrorStream());
-                } catch (InterruptedException e) {
-                    // cancelled
-                    return;
-                } finally {
-                    if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.O) {
-                        process.destroyForcibly();
-                    } else {
-                        process.destroy();
-                    }
+                final String pregenerated = (pregenParams == null) ? null : pregenerated(backend, pregenParams);
+                if (pregenerated != null) {
+                    callback.gameGeneratorSuccess(input.finishedGenerating(pregenerated), previousGame);
+                } else {
+                    generateNow(appInfo, input, args, previousGame, callback, busy);
                 }
-                if (exitStatus != 0) {
-                    if (!stderr.isEmpty()) {  // probably bogus params
-                        throw new IllegalArgumentException(stderr);
-                    } else {
-                        final String exitError = "Game generation exited with status " + exitStatus;
-                        Log.e(TAG, exitError);
-                        throw new IOException(exitError);
+            } finally {
+                foregroundRequests.decrementAndGet();
+            }
+            if (pregenParams != null && !Thread.currentThread().isInterrupted()) {
+                pregenExecutor.execute(() -> pregenerate(appInfo, backend, pregenParams));
+            }
+        }, null) {
+            @Override
+            public boolean cancel(boolean mayInterruptIfRunning) {
+                final boolean ret = super.cancel(mayInterruptIfRunning);
+                synchronized (busy) {
+                    if (busy[0] != null) {
+                        busy[0].cancel();
+                        busy[0] = null;
                     }
                 }
-                if (generated.isEmpty()) {
-                    throw new IOException("Internal error generating game: result is blank");
-                }
-            } catch (IOException | IllegalArgumentException e) {
-                callback.gameGeneratorFailure(e, input);
+                return ret;
+            }
+        };
+        executor.execute(task);
+        return task;
+    }
+
+    private void generateNow(final ApplicationInfo appInfo, final GameLaunch input, final List<String> args, final String previousGame, final Callback callback, final Worker[] busy) {
+        final String generated;
+        final Worker worker;
+        try {
+            worker = borrowWorker(appInfo);
+        } catch (IOException e) {
+            callback.gameGeneratorFailure(e, input);
+            return;
+        }
+        synchronized (busy) {
+            if (Thread.currentThread().isInterrupted()) {
+                returnWorker(worker);
                 return;
             }
-            callback.gameGeneratorSuccess(input.finishedGenerating(generated), previousGame);
-        });
-        return future[0];
+            busy[0] = worker;
+        }
+        try {
+            generated = worker.request(args, attempts -> {
+                if (!Thread.currentThread().isInterrupted()) callback.gameGeneratorProgress(input, attempts);
+            });
+            if (generated.isEmpty()) {
+                throw new IOException("Internal error generating game: result is blank");
+            }
+        } catch (CancellationException e) {
+            synchronized (busy) { busy[0] = null; }
+            returnWorker(worker);
+            return;
+        } catch (IOException e) {
+            worker.destroy();
+            if (Thread.currentThread().isInterrupted()) return;  // cancelled
+            callback.gameGeneratorFailure(e, input);
+            return;
+        } catch (IllegalArgumentException e) {  // probably bogus params
+            synchronized (busy) { busy[0] = null; }
+            returnWorker(worker);
+            if (Thread.currentThread().isInterrupted()) return;
+            callback.gameGeneratorFailure(e, input);
+            return;
+        }
+        synchronized (busy) {
+            busy[0] = null;
+        }
+        returnWorker(worker);
+        if (Thread.currentThread().isInterrupted()) return;
+        callback.gameGeneratorSuccess(input.finishedGenerating(generated), previousGame);
+    }
+
+    private String pregenerated(final String backend, final String params) {
+        final String saved = pregeneratedGames.pop(backend, params);
+        Log.d(TAG, "pre-generated " + backend + " " + params + ": " + (saved != null ? "hit" : "miss")
+                + ", hit rate " + pregeneratedGames.getHitRate());
+        return saved;
+    }
+
+    /** Tops up the queue of games for these params while the device is idle and not short of power. */
+    private void pregenerate(final ApplicationInfo appInfo, final String backend, final String params) {
+        while (pregeneratedGames.wanted(backend, params) > 0 && !executor.isShutdown()
+                && foregroundRequests.get() == 0 && canPregenerateNow()) {
+            final Worker worker;
+            try {
+                worker = borrowWorker(appInfo);
+            } catch (IOException e) {
+                return;
+            }
+            try {
+                final String generated = worker.request(Arrays.asList(backend, params), null);
+                returnWorker(worker);
+                if (generated.isEmpty()) return;
+                pregeneratedGames.push(backend, params, generated);
+            } catch (IOException e) {
+                worker.destroy();
+                Log.d(TAG, "pre-generation failed", e);
+                return;
+            } catch (IllegalArgumentException e) {
+                returnWorker(worker);
+                return;
+            }
+        }
+    }
+
+    private boolean canPregenerateNow() {
+        final PowerManager power = (PowerManager) appContext.getSystemService(Context.POWER_SERVICE);
+        if (power != null) {
+            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.LOLLIPOP && power.isPowerSaveMode()) return false;
+            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q
+                    && power.getCurrentThermalStatus() >= PowerManager.THERMAL_STATUS_MODERATE) return false;
+        }
+        final Intent battery = appContext.registerReceiver(null, new IntentFilter(Intent.ACTION_BATTERY_CHANGED));
+        if (battery == null) return true;
+        final int status = battery.getIntExtra(BatteryManager.EXTRA_STATUS, -1);
+        if (status == BatteryManager.BATTERY_STATUS_CHARGING || status == BatteryManager.BATTERY_STATUS_FULL) return true;
+        final int level = battery.getIntExtra(BatteryManager.EXTRA_LEVEL, -1);
+        final int scale = battery.getIntExtra(BatteryManager.EXTRA_SCALE, -1);
+        return level < 0 || scale <= 0 || level * 100 / scale >= MIN_BATTERY_PERCENT_TO_PREGENERATE;
+    }
+
+    /** @return proportion of new games that were served from the pre-generated queue */
+    public float getPregeneratedHitRate() {
+        return pregeneratedGames.getHitRate();
     }
 
     @NonNull
@@ -68,6 +68,8 @@ import java.util.LinkedHashMap;
 import java.util.List;
 import java.util.Map;
 import java.util.Objects;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
 import java.util.concurrent.Future;
 import java.util.regex.Matcher;
 import java.util.regex.Pattern;
@@ -97,6 +99,10 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 	private int currentType = 0;
 	private GameGenerator gameGenerator;
 	private Future<?> generationInProgress = null;
+	/** Solving can be slow, so it runs here rather than on the UI thread. */
+	private final ExecutorService solveExecutor = Executors.newSingleThreadExecutor();
+	/** Set while a solve is running, so Solve can't queue up another one behind it. */
+	private boolean solveInProgress = false;
 	private boolean solveEnabled = false, customVisible = false,
 			undoEnabled = false, redoEnabled = false,
 			undoIsLoadGame = false, redoIsLoadGame = false;
@@ -145,8 +151,10 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 	private void handleMessage(Message msg) {
 		switch( MsgType.values()[msg.what] ) {
 		case TIMER:
+			// Between animations, a timed game only needs waking when its clock changes
+			int delay = TIMER_INTERVAL;
 			if( progress == null ) {
-				gameEngine.timerTick();
+				delay = Math.max(delay, gameEngine.timerTick());
 				if (currentBackend == BackendName.INERTIA) {
 					gameView.ensureCursorVisible(gameEngine.getCursorLocation());
 				}
@@ -154,7 +162,7 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 			if( gameWantsTimer ) {
 				handler.sendMessageDelayed(
 						handler.obtainMessage(MsgType.TIMER.ordinal()),
-						TIMER_INTERVAL);
+						delay);
 			}
 			break;
 		case COMPLETED:
@@ -209,6 +217,26 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 		editor.remove(PrefsConstants.SAVED_COMPLETED_PREFIX + backend);
 		editor.remove(PrefsConstants.LAST_PARAMS_PREFIX + backend);
 		editor.apply();
+		//noinspection ResultOfMethodCallIgnored
+		journalFile(backend).delete();
+	}
+
+	/** Append-only journal of the game in progress; see midend_set_journal(). */
+	@NonNull
+	private File journalFile(@NonNull final BackendName backend) {
+		return new File(getFilesDir(), "journal-" + backend);
+	}
+
+	/** @return the journal if there is one, else the full save from the last pause, else null */
+	@Nullable
+	private String getSavedGame(@NonNull final BackendName backend) {
+		final File journal = journalFile(backend);
+		if (journal.exists()) {
+			final ByteArrayOutputStream baos = new ByteArrayOutputStream();
+			if (GameEngineImpl.loadJournal(journal.getPath(), baos) && baos.size() > 0) return baos.toString();
+			Log.e(TAG, "Can't read journal for " + backend);
+		}
+		return state.getString(PrefsConstants.SAVED_GAME_PREFIX + backend, null);
 	}
 
 	private void dismissProgress()
@@ -234,11 +262,15 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 	private void save()
 	{
 		if (currentBackend == null) return;
-		final String saved = saveToString();
 		final SharedPreferences.Editor ed = state.edit();
 		ed.remove("engineName");
 		ed.putString(PrefsConstants.SAVED_BACKEND, currentBackend.toString());
-		ed.putString(PrefsConstants.SAVED_GAME_PREFIX + currentBackend, saved);
+		if (gameEngine.flushJournal()) {
+			// The journal is already up to date, without re-serialising the whole undo chain
+			ed.remove(PrefsConstants.SAVED_GAME_PREFIX + currentBackend);
+		} else {
+			ed.putString(PrefsConstants.SAVED_GAME_PREFIX + currentBackend, saveToString());
+		}
 		ed.putBoolean(PrefsConstants.SAVED_COMPLETED_PREFIX + currentBackend, everCompleted);
 		ed.putString(PrefsConstants.LAST_PARAMS_PREFIX + currentBackend, gameEngine.getCurrentParams());
 		ed.apply();
@@ -262,7 +294,7 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 		state = getSharedPreferences(PrefsConstants.STATE_PREFS_NAME, MODE_PRIVATE);
 		gameTypesById = new LinkedHashMap<>();
 		gameTypesMenu = new MenuEntry[]{};
-		gameGenerator = new GameGenerator();
+		gameGenerator = new GameGenerator(this);
 
 		applyFullscreen(false);  // must precede super.onCreate and setContentView
 		cachedFullscreen = startedFullscreen = prefs.getBoolean(PrefsConstants.FULLSCREEN_KEY, false);
@@ -405,7 +437,7 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 		}
 
 		if (backendFromChooser != null) {
-			final String savedGame = state.getString(PrefsConstants.SAVED_GAME_PREFIX + backendFromChooser, null);
+			final String savedGame = getSavedGame(backendFromChooser);
 			// We have a saved game, and if it's completed the user probably wants a fresh one.
 			// Theoretically we could silently load it and ask midend_status() but remembering is
 			// still faster and some people play large games.
@@ -420,7 +452,7 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 		} else {
 			final BackendName savedBackend = BackendName.byLowerCase(state.getString(PrefsConstants.SAVED_BACKEND, null));
 			if (savedBackend != null) {
-				final String savedGame = state.getString(PrefsConstants.SAVED_GAME_PREFIX + savedBackend, null);
+				final String savedGame = getSavedGame(savedBackend);
 				if (savedGame == null) {
 					Log.e(TAG, "missing state for " + savedBackend);
 					startGame(GameLaunch.toGenerateFromChooser(savedBackend));
@@ -438,8 +470,9 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 	private void warnOfStateLoss(final BackendName backend, final Runnable continueLoading, final boolean returnToChooser) {
 		boolean careAboutOldGame = !state.getBoolean(PrefsConstants.SAVED_COMPLETED_PREFIX + backend, true);
 		if (careAboutOldGame) {
-			final String savedGame = state.getString(PrefsConstants.SAVED_GAME_PREFIX + backend, null);
-			if (savedGame == null || savedGame.contains("NSTATES :1:1")) {
+			final String savedGame = getSavedGame(backend);
+			if (savedGame == null || (savedGame.contains("NSTATES :1:1")
+					&& !savedGame.contains("\nMOVE    :") && !savedGame.contains("\nSOLVE   :"))) {
 				careAboutOldGame = false;
 			}
 		}
@@ -543,7 +576,7 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 		final PopupMenu gameMenu = popupMenuWithIcons();
 		gameMenu.getMenuInflater().inflate(R.menu.game_menu, gameMenu.getMenu());
 		final MenuItem solveItem = gameMenu.getMenu().findItem(R.id.solve);
-		solveItem.setEnabled(solveEnabled);
+		solveItem.setEnabled(solveEnabled && !solveInProgress);
 		solveItem.setVisible(solveEnabled);
 		gameMenu.setOnMenuItemClickListener(item -> {
 			int itemId = item.getItemId();
@@ -576,11 +609,35 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 	}
 
 	private void solveMenuItemClicked() {
+		// The backends' solvers have nowhere to check for cancellation, so a stale solve runs to
+		// the end; at least don't start another full solve behind it.
+		if (solveInProgress) return;
+		final GameEngine engine = gameEngine;
+		final long job;
 		try {
-			gameEngine.solveEvent();
+			job = engine.startSolve();
 		} catch (IllegalArgumentException e) {
 			messageBox(getString(R.string.Error), e.getMessage(), false);
+			return;
 		}
+		if (job == 0) return;
+		solveInProgress = true;
+		// If the user moves meanwhile, finishSolve drops the result
+		solveExecutor.execute(() -> {
+			GameEngineImpl.runSolve(job);
+			runOnUiThread(() -> {
+				solveInProgress = false;
+				if (engine != gameEngine) {
+					GameEngineImpl.discardSolve(job);
+					return;
+				}
+				try {
+					engine.finishSolve(job);
+				} catch (IllegalArgumentException e) {
+					messageBox(getString(R.string.Error), e.getMessage(), false);
+				}
+			});
+		});
 	}
 
 	private final MenuItem.OnMenuItemClickListener TYPE_CLICK_LISTENER = item -> {
@@ -646,7 +703,7 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 		helpMenu.setForceShowIcon(true);
 		helpMenu.getMenuInflater().inflate(R.menu.help_menu, helpMenu.getMenu());
 		final MenuItem solveItem = helpMenu.getMenu().findItem(R.id.solve);
-		solveItem.setEnabled(solveEnabled);
+		solveItem.setEnabled(solveEnabled && !solveInProgress);
 		solveItem.setVisible(solveEnabled);
 		helpMenu.getMenu().findItem(R.id.this_game).setTitle(MessageFormat.format(
 				getString(R.string.how_to_play_game), GamePlay.this.getTitle()));
@@ -834,8 +891,18 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 		});
 	}
 
+	@Override
+	public void gameGeneratorProgress(final GameLaunch launch, final long attempts) {
+		runOnUiThread(() -> {
+			if (progress != null && generationInProgress != null) {
+				progress.setMessage(getString(R.string.starting_attempts, attempts));
+			}
+		});
+	}
+
 	private boolean hasState(final BackendName backend) {
 		return state.contains(PrefsConstants.SAVED_GAME_PREFIX + backend)
+				|| journalFile(backend).exists()
 				|| state.contains(PrefsConstants.SAVED_COMPLETED_PREFIX + backend)
 				|| state.contains(PrefsConstants.LAST_PARAMS_PREFIX + backend);
 
@@ -900,6 +967,8 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 		dismissProgress();
 		gameView.rebuildBitmap();
 		if (menu != null) onPrepareOptionsMenu(menu);
+		gameEngine.setJournal(journalFile(currentBackend).getPath());
+		applyFrameStats();
 		save();
 	}
 
@@ -989,6 +1058,7 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 	{
 		stopGameGeneration();
 		gameGenerator.onDestroy();
+		solveExecutor.shutdown();
 		gameEngine.onDestroy();
 		super.onDestroy();
 	}
@@ -1308,7 +1378,12 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 	@UsedByJNI
 	public void requestTimer(boolean on)
 	{
-		if( gameWantsTimer && on ) return;
+		if( gameWantsTimer && on ) {
+			// Wake from a long wait for the clock, as an animation has started
+			handler.removeMessages(MsgType.TIMER.ordinal());
+			handler.sendMessageDelayed(handler.obtainMessage(MsgType.TIMER.ordinal()), TIMER_INTERVAL);
+			return;
+		}
 		gameWantsTimer = on;
 		if( on ) handler.sendMessageDelayed(handler.obtainMessage(MsgType.TIMER.ordinal()), TIMER_INTERVAL);
 		else handler.removeMessages(MsgType.TIMER.ordinal());
@@ -1347,6 +1422,8 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 			applyFullscreen(true);  // = already started
 		} else if (key.equals(PrefsConstants.STAY_AWAKE_KEY)) {
 			applyStayAwake();
+		} else if (key.equals(PrefsConstants.FRAME_STATS_KEY)) {
+			applyFrameStats();
 		} else if (key.equals(PrefsConstants.LIMIT_DPI_KEY)) {
 			applyLimitDPI(true);
 		} else if (key.equals(PrefsConstants.ORIENTATION_KEY)) {
@@ -1421,6 +1498,11 @@ public class GamePlay extends ActivityWithLoadButton implements OnSharedPreferen
 		}
 	}
 
+	private void applyFrameStats()
+	{
+		gameEngine.setFrameStats(prefs.getBoolean(PrefsConstants.FRAME_STATS_KEY, false));
+	}
+
 	@SuppressLint({"InlinedApi", "SourceLockedOrientationActivity"})  // This is only done at the user's explicit request
 	private void applyOrientation() {
 		final String orientationPref = prefs.getString(PrefsConstants.ORIENTATION_KEY, "unspecified");
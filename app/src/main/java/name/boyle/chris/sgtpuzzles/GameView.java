@@ -47,6 +47,10 @@ import static android.view.InputDevice.SOURCE_MOUSE;
 import static android.view.InputDevice.SOURCE_STYLUS;
 import static android.view.MotionEvent.TOOL_TYPE_STYLUS;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.IntBuffer;
+import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.Collections;
 import java.util.LinkedHashSet;
@@ -60,7 +64,24 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 	private int canvasRestoreJustAfterCreation;
 	private final Paint paint;
 	private final Paint checkerboardPaint = new Paint();
-	private final Bitmap[] blitters;
+	// Blitter ids index these arrays; freed ids are kept on a stack for reuse, and freed
+	// bitmaps in a small pool (see blitterAlloc), as games reallocate every blitter on resize.
+	private Bitmap[] blitters = new Bitmap[16];
+	private Canvas[] blitterCanvases = new Canvas[16];
+	private int[] freeBlitterIds = new int[16];
+	private int nFreeBlitterIds = 0, nBlitterIds = 0;
+	private final ArrayList<Bitmap> spareBlitters = new ArrayList<>();
+	private static final int MAX_SPARE_BLITTERS = 32;
+	private Canvas blitCanvas;  // on bitmap, untransformed, for blitterLoad
+	private final float[] blitterPoint = new float[2];
+	private String[] drawStrings = new String[64];
+	private ByteBuffer drawBuffer = null;
+	private IntBuffer drawInts = null;
+	private int[] polyPoints = new int[16];
+	// Scratch objects for drawCommands, so that replaying a frame allocates nothing.
+	private final Path polyPath = new Path();
+	private final RectF clipBounds = new RectF();
+	private final Paint.FontMetrics fontMetrics = new Paint.FontMetrics();
 	@ColorInt private int[] colours = new int[0];
 	private float density = 1.f;
 	enum LimitDPIMode { LIMIT_OFF, LIMIT_AUTO, LIMIT_ON }
@@ -96,6 +117,9 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 	private static final int ALIGN_H_CENTRE = 0x001;
 	private static final int ALIGN_H_RIGHT = 0x002;
 	private static final int TEXT_MONO = 0x10;
+	// opcodes in the command buffer from android.c, as defined in drawcmd.h
+	private static final int DRAW_OP_RECT = 1, DRAW_OP_LINE = 2, DRAW_OP_POLY = 3, DRAW_OP_CIRCLE = 4,
+			DRAW_OP_TEXT = 5, DRAW_OP_CLIP = 6, DRAW_OP_UNCLIP = 7;
 	private static final int DRAG = LEFT_DRAG - LEFT_BUTTON;  // not bit fields, but there's a pattern
 			private static final int RELEASE = LEFT_RELEASE - LEFT_BUTTON;
 	static final int CURSOR_UP = 0x209, CURSOR_DOWN = 0x20a,
@@ -112,12 +136,15 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 	private final Matrix zoomInProgressMatrix = new Matrix();
 	private final Matrix inverseZoomMatrix = new Matrix();
 	private final Matrix tempDrawMatrix = new Matrix();
+	private final Matrix invalidateMatrix = new Matrix();
+	private final RectF invalidateRect = new RectF();
 	private enum DragMode { UNMODIFIED, REVERT_OFF_SCREEN, REVERT_TO_START, PREVENT }
 	private DragMode dragMode = DragMode.UNMODIFIED;
 	private final OverScroller mScroller;
 	private final EdgeEffect[] edges = new EdgeEffect[4];
 	// ARGB_8888 is viewable in Android Studio debugger but very memory-hungry
 	private static final Bitmap.Config BITMAP_CONFIG = Bitmap.Config.RGB_565;
+	private static final int BITMAP_BYTES_PER_PIXEL = 2;
 
 	public GameView(Context context, AttributeSet attrs)
 	{
@@ -128,11 +155,11 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 		bitmap = Bitmap.createBitmap(100, 100, BITMAP_CONFIG);  // for safety
 		canvas = new Canvas(bitmap);
 		canvasRestoreJustAfterCreation = canvas.save();
+		blitCanvas = new Canvas(bitmap);
 		paint = new Paint();
 		paint.setAntiAlias(true);
 		paint.setStrokeCap(Paint.Cap.SQUARE);
 		paint.setStrokeWidth(1.f);  // will be scaled with everything else as long as it's non-zero
-		blitters = new Bitmap[512];
 		maxDistSq = Math.pow(ViewConfiguration.get(context).getScaledTouchSlop(), 2);
 		backgroundColour = getDefaultBackgroundColour();
 		mScroller = new OverScroller(context);
@@ -726,7 +753,6 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 		Log.d("GameView", "density: " + density);
 		wDip = Math.max(1, Math.round((float) w / density));
 		hDip = Math.max(1, Math.round((float) h / density));
-		if (bitmap != null) bitmap.recycle();
 		overdrawX = Math.round(Math.round(ZOOM_OVERDRAW_PROPORTION * wDip) * density);
 		overdrawY = Math.round(Math.round(ZOOM_OVERDRAW_PROPORTION * hDip) * density);
 		// texture size limit, see http://stackoverflow.com/a/7523221/6540
@@ -735,14 +761,30 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 		// https://github.com/chrisboyle/sgtpuzzles/issues/199
 		overdrawX = Math.min(overdrawX, (maxTextureSize.x - w) / 2);
 		overdrawY = Math.min(overdrawY, (maxTextureSize.y - h) / 2);
-		bitmap = Bitmap.createBitmap(Math.max(1, w + 2 * overdrawX), Math.max(1, h + 2 * overdrawY), BITMAP_CONFIG);
+		allocateBitmap(Math.max(1, w + 2 * overdrawX), Math.max(1, h + 2 * overdrawY));
 		clear();
 		canvas = new Canvas(bitmap);
 		canvasRestoreJustAfterCreation = canvas.save();
+		blitCanvas = new Canvas(bitmap);
 		resetZoomForClear();
 		redrawForInitOrZoomChange();
 	}
 
+	/** rebuildBitmap runs on every new game and settings change, usually at the same size, so
+	 *  reuse the existing allocation if it's big enough instead of allocating another few
+	 *  megabytes each time. */
+	private void allocateBitmap(final int bw, final int bh) {
+		if (bitmap != null && !bitmap.isRecycled() && bitmap.isMutable()
+				&& bitmap.getAllocationByteCount() >= bw * bh * BITMAP_BYTES_PER_PIXEL) {
+			if (bitmap.getWidth() != bw || bitmap.getHeight() != bh) {
+				bitmap.reconfigure(bw, bh, BITMAP_CONFIG);
+			}
+			return;
+		}
+		if (bitmap != null) bitmap.recycle();
+		bitmap = Bitmap.createBitmap(bw, bh, BITMAP_CONFIG);
+	}
+
 	private Point getMaxTextureSize() {
 		final int maxW = canvas.getMaximumBitmapWidth();
 		final int maxH = canvas.getMaximumBitmapHeight();
@@ -821,12 +863,94 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 		return ContextCompat.getColor(dayContext, R.color.game_background);
 	}
 
+	/** Invalidates just the part of the view showing this rectangle of the bitmap (in the
+	 *  coordinates of drawCommands), which android.c has collected from a frame's draw_update
+	 *  calls. Widened by a pixel each way for antialiasing. Only API 19 and 20 use the
+	 *  rectangle: from API 21 a hardware-accelerated view (which this always is; nothing
+	 *  here sets a software layer) ignores it and redraws what it works out for itself. */
+	@UsedByJNI
+	public void invalidateGameRect(int x, int y, int w, int h)
+	{
+		invalidateMatrix.set(zoomMatrix);
+		invalidateMatrix.postConcat(zoomInProgressMatrix);
+		invalidateMatrix.postTranslate(-overdrawX, -overdrawY);
+		invalidateRect.set(x - 1, y - 1, x + w + 1, y + h + 1);
+		invalidateMatrix.mapRect(invalidateRect);
+		postInvalidateOnAnimation((int) Math.floor(invalidateRect.left), (int) Math.floor(invalidateRect.top),
+				(int) Math.ceil(invalidateRect.right), (int) Math.ceil(invalidateRect.bottom));
+	}
+
+	/** One frame's drawing counts and timings from android.c, if enabled by the developer
+	 *  setting, for logcat. */
 	@UsedByJNI
-	public void clipRect(int x, int y, int w, int h) {
+	public void frameStats(String json)
+	{
+		Log.d("FrameStats", json);
+	}
+
+	@UsedByJNI
+	public void registerDrawString(int id, String text)
+	{
+		if (id >= drawStrings.length) {
+			drawStrings = Arrays.copyOf(drawStrings, Math.max(id + 1, drawStrings.length * 2));
+		}
+		drawStrings[id] = text;
+	}
+
+	/** Replays a frame's worth of primitives recorded by android.c: one JNI call instead of one
+	 *  per rectangle/line/polygon. */
+	@UsedByJNI
+	public void drawCommands(ByteBuffer commands, int length)
+	{
+		if (commands != drawBuffer) {
+			drawBuffer = commands;
+			drawInts = commands.order(ByteOrder.nativeOrder()).asIntBuffer();
+		}
+		final IntBuffer b = drawInts;
+		b.position(0);
+		while (b.position() < length) {
+			switch (b.get()) {
+				case DRAW_OP_RECT:
+					fillRect(b.get(), b.get(), b.get(), b.get(), b.get());
+					break;
+				case DRAW_OP_LINE:
+					drawLine(Float.intBitsToFloat(b.get()), Float.intBitsToFloat(b.get()), Float.intBitsToFloat(b.get()),
+							Float.intBitsToFloat(b.get()), Float.intBitsToFloat(b.get()), b.get());
+					break;
+				case DRAW_OP_POLY: {
+					final float thickness = Float.intBitsToFloat(b.get());
+					final int npoints = b.get();
+					final int ox = b.get(), oy = b.get(), line = b.get(), fill = b.get();
+					if (polyPoints.length < npoints * 2) polyPoints = new int[npoints * 2];
+					b.get(polyPoints, 0, npoints * 2);
+					drawPoly(thickness, polyPoints, npoints, ox, oy, line, fill);
+					break;
+				}
+				case DRAW_OP_CIRCLE:
+					drawCircle(Float.intBitsToFloat(b.get()), Float.intBitsToFloat(b.get()), Float.intBitsToFloat(b.get()),
+							Float.intBitsToFloat(b.get()), b.get(), b.get());
+					break;
+				case DRAW_OP_TEXT:
+					drawText(b.get(), b.get(), b.get(), b.get(), b.get(), drawStrings[b.get()]);
+					break;
+				case DRAW_OP_CLIP:
+					clipRect(b.get(), b.get(), b.get(), b.get());
+					break;
+				case DRAW_OP_UNCLIP:
+					unClip(b.get(), b.get());
+					break;
+				default:
+					throw new IllegalStateException("Bad draw command at " + (b.position() - 1));
+			}
+		}
+	}
+
+	private void clipRect(int x, int y, int w, int h) {
 		canvas.restoreToCount(canvasRestoreJustAfterCreation);
 		canvasRestoreJustAfterCreation = canvas.save();
 		canvas.setMatrix(zoomMatrix);
-		canvas.clipRect(new RectF(x - 0.5f, y - 0.5f, x + w - 0.5f, y + h - 0.5f));
+		clipBounds.set(x - 0.5f, y - 0.5f, x + w - 0.5f, y + h - 0.5f);
+		canvas.clipRect(clipBounds);
 	}
 
 	@UsedByJNI
@@ -838,8 +962,7 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 		canvas.clipRect(marginX - 0.5f, marginY - 0.5f, wDip - marginX - 1.5f, hDip - marginY - 1.5f);
 	}
 
-	@UsedByJNI
-	public void fillRect(final int x, final int y, final int w, final int h, final int colour)
+	private void fillRect(final int x, final int y, final int w, final int h, final int colour)
 	{
 		paint.setColor(colours[colour]);
 		paint.setStyle(Paint.Style.FILL);
@@ -854,8 +977,7 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 		paint.setAntiAlias(true);
 	}
 
-	@UsedByJNI
-	public void drawLine(float thickness, float x1, float y1, float x2, float y2, int colour)
+	private void drawLine(float thickness, float x1, float y1, float x2, float y2, int colour)
 	{
 		paint.setColor(colours[colour]);
 		paint.setStrokeWidth(Math.max(thickness, 1.f));
@@ -863,18 +985,18 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 		paint.setStrokeWidth(1.f);
 	}
 
-	@UsedByJNI
-	public void drawPoly(float thickness, int[] points, int ox, int oy, int line, int fill)
+	private void drawPoly(float thickness, int[] points, int npoints, int ox, int oy, int line, int fill)
 	{
-		Path path = new Path();
+		final Path path = polyPath;
+		path.rewind();
 		path.moveTo(points[0] + ox, points[1] + oy);
-		for(int i=1; i < points.length/2; i++) {
+		for(int i=1; i < npoints; i++) {
 			path.lineTo(points[2 * i] + ox, points[2 * i + 1] + oy);
 		}
 		path.close();
 		// cheat slightly: polygons up to square look prettier without (and adjacent squares want to
 		// look continuous in lightup)
-		boolean disableAntiAlias = points.length <= 8;  // 2 per point
+		boolean disableAntiAlias = npoints <= 4;
 		if (disableAntiAlias) paint.setAntiAlias(false);
 		drawPoly(thickness, path, line, fill);
 		paint.setAntiAlias(true);
@@ -894,8 +1016,7 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 		paint.setStrokeWidth(1.f);
 	}
 
-	@UsedByJNI
-	public void drawCircle(float thickness, float x, float y, float r, int lineColour, int fillColour)
+	private void drawCircle(float thickness, float x, float y, float r, int lineColour, int fillColour)
 	{
 		if (r <= 0.5f) fillColour = lineColour;
 		r = Math.max(r, 0.4f);
@@ -913,14 +1034,14 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 		paint.setStrokeWidth(1.f);
 	}
 
-	@UsedByJNI
-	public void drawText(int x, int y, int flags, int size, int colour, String text)
+	private void drawText(int x, int y, int flags, int size, int colour, String text)
 	{
 		paint.setColor(colours[colour]);
 		paint.setStyle(Paint.Style.FILL);
 		paint.setTypeface( (flags & TEXT_MONO) != 0 ? Typeface.MONOSPACE : Typeface.DEFAULT );
 		paint.setTextSize(size);
-		Paint.FontMetrics fm = paint.getFontMetrics();
+		final Paint.FontMetrics fm = fontMetrics;
+		paint.getFontMetrics(fm);
 		float asc = Math.abs(fm.ascent), desc = Math.abs(fm.descent);
 		if ((flags & ALIGN_V_CENTRE) != 0) y += asc - (asc+desc)/2;
 		if ((flags & ALIGN_H_CENTRE) != 0) paint.setTextAlign( Paint.Align.CENTER );
@@ -932,26 +1053,60 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 	@UsedByJNI
 	public int blitterAlloc(int w, int h)
 	{
-		for(int i=0; i<blitters.length; i++) {
-			if (blitters[i] == null) {
-				float zoom = getXScale(zoomMatrix);
-				blitters[i] = Bitmap.createBitmap(Math.round(zoom * w), Math.round(zoom * h), BITMAP_CONFIG);
-				return i;
+		final float zoom = getXScale(zoomMatrix);
+		final int bw = Math.max(1, Math.round(zoom * w)), bh = Math.max(1, Math.round(zoom * h));
+		final int i;
+		if (nFreeBlitterIds > 0) {
+			i = freeBlitterIds[--nFreeBlitterIds];
+		} else {
+			if (nBlitterIds == blitters.length) {
+				blitters = Arrays.copyOf(blitters, nBlitterIds * 2);
+				blitterCanvases = Arrays.copyOf(blitterCanvases, nBlitterIds * 2);
+				freeBlitterIds = Arrays.copyOf(freeBlitterIds, nBlitterIds * 2);
+			}
+			i = nBlitterIds++;
+		}
+		blitters[i] = spareBlitter(bw, bh);
+		blitterCanvases[i] = new Canvas(blitters[i]);
+		return i;
+	}
+
+	/** A bitmap of the given size, reconfigured from the pool if one there is big enough. */
+	private Bitmap spareBlitter(int bw, int bh)
+	{
+		for (int j = spareBlitters.size() - 1; j >= 0; j--) {
+			final Bitmap b = spareBlitters.get(j);
+			if (b.getAllocationByteCount() >= bw * bh * BITMAP_BYTES_PER_PIXEL) {
+				spareBlitters.remove(j);
+				if (b.getWidth() != bw || b.getHeight() != bh) {
+					b.reconfigure(bw, bh, BITMAP_CONFIG);
+				}
+				b.eraseColor(Color.BLACK);  // as new, in case a save overhangs the bitmap
+				return b;
 			}
 		}
-		throw new RuntimeException("No free blitter found!");
+		return Bitmap.createBitmap(bw, bh, BITMAP_CONFIG);
 	}
 
 	@UsedByJNI
 	public void blitterFree(int i)
 	{
 		if( blitters[i] == null ) return;
-		blitters[i].recycle();
+		if (spareBlitters.size() < MAX_SPARE_BLITTERS) {
+			spareBlitters.add(blitters[i]);
+		} else {
+			blitters[i].recycle();
+		}
 		blitters[i] = null;
+		blitterCanvases[i] = null;
+		freeBlitterIds[nFreeBlitterIds++] = i;
 	}
 
-	private PointF blitterPosition(int x, int y, boolean save) {
-		float[] f = { x, y };
+	/** Sets blitterPoint to where to draw the bitmap (or blitter, if save) on the other. */
+	private void blitterPosition(int x, int y, boolean save) {
+		final float[] f = blitterPoint;
+		f[0] = x;
+		f[1] = y;
 		zoomMatrix.mapPoints(f);
 		f[0] = (float) Math.floor(f[0]);
 		f[1] = (float) Math.floor(f[1]);
@@ -959,23 +1114,22 @@ public class GameView extends View implements GameEngine.ViewCallbacks
 			f[0] *= -1f;
 			f[1] *= -1f;
 		}
-		return new PointF(f[0], f[1]);
 	}
 
 	@UsedByJNI
 	public void blitterSave(int i, int x, int y)
 	{
 		if( blitters[i] == null ) return;
-		final PointF blitterPosition = blitterPosition(x, y, true);
-		new Canvas(blitters[i]).drawBitmap(bitmap, blitterPosition.x, blitterPosition.y, null);
+		blitterPosition(x, y, true);
+		blitterCanvases[i].drawBitmap(bitmap, blitterPoint[0], blitterPoint[1], null);
 	}
 
 	@UsedByJNI
 	public void blitterLoad(int i, int x, int y)
 	{
 		if( blitters[i] == null ) return;
-		final PointF blitterPosition = blitterPosition(x, y, false);
-		new Canvas(bitmap).drawBitmap(blitters[i], blitterPosition.x, blitterPosition.y, null);
+		blitterPosition(x, y, false);
+		blitCanvas.drawBitmap(blitters[i], blitterPoint[0], blitterPoint[1], null);
 	}
 
 	@VisibleForTesting
@@ -6,7 +6,6 @@ public class MenuEntry {
 	private final MenuEntry[] submenu;
 	private final String params;
 
-	@UsedByJNI
 	public MenuEntry(final int id, final String title, final MenuEntry[] submenu) {
 		this.id = id;
 		this.title = title;
@@ -14,7 +13,6 @@ public class MenuEntry {
 		this.submenu = submenu;
 	}
 
-	@UsedByJNI
 	public MenuEntry(final int id, final String title, final String params) {
 		this.id = id;
 		this.title = title;
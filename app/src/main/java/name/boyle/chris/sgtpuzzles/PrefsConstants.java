@@ -21,6 +21,7 @@ abstract class PrefsConstants {
     static final String LATIN_SHOW_M_KEY = "latinShowM";
     static final String FULLSCREEN_KEY = "fullscreen";
     static final String STAY_AWAKE_KEY = "stayAwake";
+    static final String FRAME_STATS_KEY = "frameStats";
     static final String UNDO_REDO_KBD_KEY = "undoRedoOnKeyboard";
     static final boolean UNDO_REDO_KBD_DEFAULT = true;
     static final String MOUSE_LONG_PRESS_KEY = "extMouseLongPress";
@@ -0,0 +1,149 @@
+package name.boyle.chris.sgtpuzzles;
+
+import androidx.annotation.NonNull;
+import androidx.annotation.Nullable;
+
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.util.Arrays;
+
+import static java.nio.charset.StandardCharsets.UTF_8;
+
+/**
+ * Bounded on-disk queue of games generated ahead of time, keyed by backend and encoded params,
+ * so that "New game" on a slow preset needn't wait for the generator.
+ */
+public class PregeneratedGames {
+
+    static final int DEPTH = 2;  // games kept per (backend, params)
+    static final int MAX_KEYS = 16;  // least recently used (backend, params) is evicted beyond this
+
+    private final File dir;
+    private int hits = 0, misses = 0;
+
+    public PregeneratedGames(@NonNull final File dir) {
+        this.dir = dir;
+    }
+
+    /** @return a generated save file for these params, removing it from the queue, or null */
+    @Nullable
+    public synchronized String pop(@NonNull final String backend, @NonNull final String params) {
+        final File[] files = sortedFiles(keyDir(backend, params));
+        for (final File file : files) {
+            try {
+                final String saved = readFile(file);
+                //noinspection ResultOfMethodCallIgnored
+                file.delete();
+                if (!saved.isEmpty()) {
+                    hits++;
+                    return saved;
+                }
+            } catch (IOException ignored) {
+                //noinspection ResultOfMethodCallIgnored
+                file.delete();
+            }
+        }
+        misses++;
+        return null;
+    }
+
+    /** @return how many more games should be generated to fill the queue for these params */
+    public synchronized int wanted(@NonNull final String backend, @NonNull final String params) {
+        return Math.max(0, DEPTH - sortedFiles(keyDir(backend, params)).length);
+    }
+
+    public synchronized void push(@NonNull final String backend, @NonNull final String params, @NonNull final String saved) throws IOException {
+        final File keyDir = keyDir(backend, params);
+        if (!keyDir.isDirectory() && !keyDir.mkdirs()) throw new IOException("Could not create " + keyDir);
+        final File[] existing = sortedFiles(keyDir);
+        if (existing.length >= DEPTH) return;
+        final File tmp = new File(keyDir, "tmp");
+        try (OutputStream out = new FileOutputStream(tmp)) {
+            out.write(saved.getBytes(UTF_8));
+        }
+        final long next = existing.length == 0 ? 0 : Long.parseLong(existing[existing.length - 1].getName()) + 1;
+        if (!tmp.renameTo(new File(keyDir, Long.toString(next)))) throw new IOException("Could not rename " + tmp);
+        //noinspection ResultOfMethodCallIgnored
+        keyDir.setLastModified(System.currentTimeMillis());
+        evictBeyond(MAX_KEYS);
+    }
+
+    public synchronized int getHits() {
+        return hits;
+    }
+
+    public synchronized int getMisses() {
+        return misses;
+    }
+
+    /** @return proportion of lookups that found a pre-generated game, or 0 if none yet */
+    public synchronized float getHitRate() {
+        final int total = hits + misses;
+        return total == 0 ? 0.f : (float) hits / total;
+    }
+
+    private void evictBeyond(final int maxKeys) {
+        final File[] keyDirs = dir.listFiles(File::isDirectory);
+        if (keyDirs == null || keyDirs.length <= maxKeys) return;
+        Arrays.sort(keyDirs, (a, b) -> Long.compare(a.lastModified(), b.lastModified()));
+        for (int i = 0; i < keyDirs.length - maxKeys; i++) {
+            final File[] files = keyDirs[i].listFiles();
+            if (files != null) {
+                for (final File file : files) {
+                    //noinspection ResultOfMethodCallIgnored
+                    file.delete();
+                }
+            }
+            //noinspection ResultOfMethodCallIgnored
+            keyDirs[i].delete();
+        }
+    }
+
+    @NonNull
+    private File keyDir(@NonNull final String backend, @NonNull final String params) {
+        return new File(dir, backend + "-" + sha1Hex(params));
+    }
+
+    /** Queued games in the order they were pushed (skipping any half-written file). */
+    @NonNull
+    private static File[] sortedFiles(@NonNull final File keyDir) {
+        final File[] files = keyDir.listFiles(f -> f.getName().matches("[0-9]+"));
+        if (files == null) return new File[0];
+        Arrays.sort(files, (a, b) -> Long.compare(Long.parseLong(a.getName()), Long.parseLong(b.getName())));
+        return files;
+    }
+
+    @NonNull
+    private static String readFile(@NonNull final File file) throws IOException {
+        try (InputStream in = new FileInputStream(file)) {
+            final byte[] bytes = new byte[(int) file.length()];
+            int got = 0;
+            while (got < bytes.length) {
+                final int n = in.read(bytes, got, bytes.length - got);
+                if (n < 0) break;
+                got += n;
+            }
+            return new String(bytes, 0, got, UTF_8);
+        }
+    }
+
+    @NonNull
+    private static String sha1Hex(@NonNull final String s) {
+        try {
+            final byte[] digest = MessageDigest.getInstance("SHA-1").digest(s.getBytes(UTF_8));
+            final StringBuilder hex = new StringBuilder();
+            for (final byte b : digest) {
+                hex.append(String.format("%02x", b & 0xff));
+            }
+            return hex.toString();
+        } catch (NoSuchAlgorithmException e) {
+            throw new RuntimeException(e);
+        }
+    }
+}
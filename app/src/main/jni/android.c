@@ -14,11 +14,19 @@
 #include <ctype.h>
 #include <signal.h>
 #include <math.h>
+#include <dlfcn.h>
+#include <pthread.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
 #include "puzzles.h"
 #include "android.h"
+#include "drawcmd.h"
+#include "pack.h"
 
 // Touches/key-presses have a call chain like Java->here->midend->game->drawing->Java, in which we
 // could cause a Java exception. We must then avoid calling Java more, because this will obscure
@@ -55,6 +63,42 @@ void fatal(const char *fmt, ...)
 	exit(1);
 }
 
+// Trace sections go to ATrace, which only exists from API 23, so look it up at runtime.
+static void (*atrace_begin)(const char *name);
+static void (*atrace_end)(void);
+static bool (*atrace_is_enabled)(void);
+static pthread_once_t atrace_once = PTHREAD_ONCE_INIT;
+
+static void atrace_init(void)
+{
+	void *lib = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+	if (!lib) return;
+	atrace_begin = (void (*)(const char *))dlsym(lib, "ATrace_beginSection");
+	atrace_end = (void (*)(void))dlsym(lib, "ATrace_endSection");
+	atrace_is_enabled = (bool (*)(void))dlsym(lib, "ATrace_isEnabled");
+	if (!atrace_begin || !atrace_end || !atrace_is_enabled) {
+		atrace_begin = NULL;
+		atrace_end = NULL;
+		atrace_is_enabled = NULL;
+	}
+}
+
+bool trace_enabled(void)
+{
+	pthread_once(&atrace_once, atrace_init);
+	return atrace_is_enabled && atrace_is_enabled();
+}
+
+void trace_begin(const char *name)
+{
+	atrace_begin(name);
+}
+
+void trace_end(void)
+{
+	atrace_end();
+}
+
 #if 0
 // TODO Better translation mechanism or give up on it.
 /* This is so that the numerous callers of _() don't have to free strings.
@@ -72,7 +116,7 @@ static jobject ARROW_MODE_NONE = NULL,
 	ARROW_MODE_ARROWS_LEFT_RIGHT_CLICK = NULL,
 	ARROW_MODE_DIAGONALS = NULL;
 
-static jclass GameEngineImpl = NULL, BackendName = NULL, MenuEntry = NULL, IllegalArgumentException = NULL, IllegalStateException = NULL, RectF = NULL, Point = NULL, CustomDialogBuilder = NULL, KeysResult = NULL;
+static jclass GameEngineImpl = NULL, BackendName = NULL, String = NULL, IllegalArgumentException = NULL, IllegalStateException = NULL, RectF = NULL, Point = NULL, CustomDialogBuilder = NULL, KeysResult = NULL;
 static jfieldID frontendField;
 static jmethodID
 	newGameEngineImpl,
@@ -85,19 +129,17 @@ static jmethodID
 	changedState,
 	purgingStates,
 	allowFlash,
-	clipRect,
 	dialogAddString,
 	dialogAddBoolean,
 	dialogAddChoices,
 	dialogShow,
-	drawCircle,
-	drawLine,
-	drawPoly,
-	drawText,
-	fillRect,
+	drawCommands,
+	frameStats,
 	getBackgroundColour,
+	invalidateGameRect,
 	getText,
 	postInvalidate,
+	registerDrawString,
 	requestTimer,
 	baosWrite,
 	setStatus,
@@ -106,6 +148,7 @@ static jmethodID
 	inertiaFollow,
 	byDisplayName,
 	backendToString,
+	backendOrdinal,
 	newRectFWithLTRB,
 	newPoint;
 
@@ -146,44 +189,209 @@ void android_status_bar(void *handle, const char *text)
 	(*fe->env)->DeleteLocalRef(fe->env, js);
 }
 
-void android_start_draw(__attribute__((unused)) void *handle)
+// Drawing primitives are not passed to Java one at a time: each is appended to a
+// buffer in the format of drawcmd.h, which GameView.drawCommands() replays in one pass.
+// The buffer is flushed at end_draw, when it fills, and before anything (such as a
+// blitter save) that needs the canvas to be up to date. Text is sent as an id for
+// a string that was registered with Java the first time it was drawn.
+#define DRAWBUF_INTS 16384
+#define DRAWSTRINGS_MAX 4096
+
+struct drawstring {
+	char *text;
+	int id;
+};
+
+static int drawstring_cmp(void *av, void *bv)
+{
+	const struct drawstring *a = (const struct drawstring *)av;
+	const struct drawstring *b = (const struct drawstring *)bv;
+	return strcmp(a->text, b->text);
+}
+
+static void free_drawstrings(frontend *fe)
+{
+	struct drawstring *ds;
+	if (!fe->drawstrings) return;
+	while ((ds = delpos234(fe->drawstrings, 0)) != NULL) {
+		sfree(ds->text);
+		sfree(ds);
+	}
+	freetree234(fe->drawstrings);
+	fe->drawstrings = NULL;
+	fe->ndrawstrings = 0;
+}
+
+static long long now_ns(void)
 {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void android_flush_draw(frontend *fe)
+{
+	if (fe->drawbuf_len == 0) return;
+	if (!fe->env || (*fe->env)->ExceptionCheck(fe->env)) {
+		fe->drawbuf_len = 0;
+		return;
+	}
+	long long start = fe->frame_stats ? now_ns() : 0;
+	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, drawCommands, fe->drawBuffer, fe->drawbuf_len);
+	if (fe->frame_stats) fe->stats.replay_ns += now_ns() - start;
+	fe->stats.jni_calls++;
+	fe->drawbuf_len = 0;
+}
+
+// Returns space for n more ints in the draw buffer, or NULL if it couldn't be set up.
+// The buffer starts at DRAWBUF_INTS and grows for any single primitive (such as a
+// polygon with thousands of points) that wouldn't fit.
+static jint *drawbuf_reserve(frontend *fe, int n)
+{
+	if (n > fe->drawbuf_size) {
+		int size = max(n, DRAWBUF_INTS);
+		jint *buf = snewn(size, jint);
+		jobject buffer = (*fe->env)->NewDirectByteBuffer(fe->env, buf, size * sizeof(jint));
+		if (!buffer) {
+			sfree(buf);
+			return NULL;
+		}
+		android_flush_draw(fe);
+		if (fe->drawBuffer) (*fe->env)->DeleteGlobalRef(fe->env, fe->drawBuffer);
+		sfree(fe->drawbuf);
+		fe->drawbuf = buf;
+		fe->drawbuf_size = size;
+		fe->drawBuffer = (*fe->env)->NewGlobalRef(fe->env, buffer);
+		(*fe->env)->DeleteLocalRef(fe->env, buffer);
+	}
+	if (fe->drawbuf_len + n > fe->drawbuf_size) android_flush_draw(fe);
+	jint *ret = fe->drawbuf + fe->drawbuf_len;
+	fe->drawbuf_len += n;
+	return ret;
+}
+
+// Returns the id under which Java knows this string, registering it if it's new.
+static int drawstring_id(frontend *fe, const char *text)
+{
+	struct drawstring key, *ds;
+	if (!fe->drawstrings) fe->drawstrings = newtree234(drawstring_cmp);
+	key.text = (char *)text;
+	ds = find234(fe->drawstrings, &key, NULL);
+	if (ds) return ds->id;
+	if (fe->ndrawstrings >= DRAWSTRINGS_MAX) {
+		// Start again from id 0; anything queued must be drawn before its ids are reused.
+		android_flush_draw(fe);
+		free_drawstrings(fe);
+		fe->drawstrings = newtree234(drawstring_cmp);
+	}
+	jstring js = (*fe->env)->NewStringUTF(fe->env, text);
+	if (js == NULL) return -1;
+	ds = snew(struct drawstring);
+	ds->text = dupstr(text);
+	ds->id = fe->ndrawstrings++;
+	add234(fe->drawstrings, ds);
+	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, registerDrawString, ds->id, js);
+	fe->stats.jni_calls++;
+	(*fe->env)->DeleteLocalRef(fe->env, js);
+	return ds->id;
+}
+
+void android_start_draw(void *handle)
+{
+	HANDLE_TO_FE_OR_RETURN
+	memset(&fe->stats, 0, sizeof(fe->stats));
+	if (fe->frame_stats) fe->stats.start_ns = now_ns();
+}
+
+// Logs this frame's stats (via Java, to logcat) as one line of JSON. Time spent
+// replaying in Java includes the JNI call to get there; native time is the rest
+// of the frame, mostly the backend's redraw.
+static void android_frame_stats_log(frontend *fe)
+{
+	char buf[512];
+	if (!fe->stats.start_ns) return;  // only just enabled, mid-frame
+	long long total_ns = now_ns() - fe->stats.start_ns;
+	sprintf(buf, "{\"total_us\":%lld,\"native_us\":%lld,\"replay_us\":%lld,\"jni_calls\":%d,"
+			"\"rects\":%d,\"lines\":%d,\"polys\":%d,\"circles\":%d,\"texts\":%d,\"clips\":%d,"
+			"\"blitter_saves\":%d,\"blitter_loads\":%d}",
+			total_ns / 1000, (total_ns - fe->stats.replay_ns) / 1000, fe->stats.replay_ns / 1000,
+			fe->stats.jni_calls, fe->stats.rects, fe->stats.lines, fe->stats.polys,
+			fe->stats.circles, fe->stats.texts, fe->stats.clips,
+			fe->stats.blitter_saves, fe->stats.blitter_loads);
+	jstring js = (*fe->env)->NewStringUTF(fe->env, buf);
+	if (js == NULL) return;
+	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, frameStats, js);
+	(*fe->env)->DeleteLocalRef(fe->env, js);
 }
 
 void android_clip(void *handle, int x, int y, int w, int h)
 {
 	HANDLE_TO_FE_OR_RETURN
-	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, clipRect, x + fe->ox, y + fe->oy, w, h);
+	jint *cmd = drawbuf_reserve(fe, 5);
+	if (!cmd) return;
+	cmd[0] = DRAW_OP_CLIP;
+	fe->stats.clips++;
+	cmd[1] = x + fe->ox;
+	cmd[2] = y + fe->oy;
+	cmd[3] = w;
+	cmd[4] = h;
 }
 
 void android_unclip(void *handle)
 {
 	HANDLE_TO_FE_OR_RETURN
-	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, unClip, fe->ox, fe->oy);
+	jint *cmd = drawbuf_reserve(fe, 3);
+	if (!cmd) return;
+	cmd[0] = DRAW_OP_UNCLIP;
+	cmd[1] = fe->ox;
+	cmd[2] = fe->oy;
 }
 
 void android_draw_text(void *handle, int x, int y, int fonttype, int fontsize,
 		int align, int colour, const char *text)
 {
 	HANDLE_TO_FE_OR_RETURN
-	jstring js = (*fe->env)->NewStringUTF(fe->env, text);
-	if( js == NULL ) return;
-	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, drawText, x + fe->ox, y + fe->oy,
-			(fonttype == FONT_FIXED ? 0x10 : 0x0) | align,
-			fontsize, colour, js);
-	(*fe->env)->DeleteLocalRef(fe->env, js);
+	int id = drawstring_id(fe, text);
+	if (id < 0) return;
+	jint *cmd = drawbuf_reserve(fe, 7);
+	if (!cmd) return;
+	cmd[0] = DRAW_OP_TEXT;
+	fe->stats.texts++;
+	cmd[1] = x + fe->ox;
+	cmd[2] = y + fe->oy;
+	cmd[3] = (fonttype == FONT_FIXED ? DRAW_TEXT_FIXED : 0x0) | align;
+	cmd[4] = fontsize;
+	cmd[5] = colour;
+	cmd[6] = id;
 }
 
 void android_draw_rect(void *handle, int x, int y, int w, int h, int colour)
 {
 	HANDLE_TO_FE_OR_RETURN
-	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, fillRect, x + fe->ox, y + fe->oy, w, h, colour);
+	jint *cmd = drawbuf_reserve(fe, 6);
+	if (!cmd) return;
+	cmd[0] = DRAW_OP_RECT;
+	fe->stats.rects++;
+	cmd[1] = x + fe->ox;
+	cmd[2] = y + fe->oy;
+	cmd[3] = w;
+	cmd[4] = h;
+	cmd[5] = colour;
 }
 
 void android_draw_thick_line(void *handle, float thickness, float x1, float y1, float x2, float y2, int colour)
 {
 	HANDLE_TO_FE_OR_RETURN
-	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, drawLine, thickness, x1 + (float)fe->ox, y1 + (float)fe->oy, x2 + (float)fe->ox, y2 + (float)fe->oy, colour);
+	jint *cmd = drawbuf_reserve(fe, 7);
+	if (!cmd) return;
+	cmd[0] = DRAW_OP_LINE;
+	fe->stats.lines++;
+	cmd[1] = drawcmd_float(thickness);
+	cmd[2] = drawcmd_float(x1 + (float)fe->ox);
+	cmd[3] = drawcmd_float(y1 + (float)fe->oy);
+	cmd[4] = drawcmd_float(x2 + (float)fe->ox);
+	cmd[5] = drawcmd_float(y2 + (float)fe->oy);
+	cmd[6] = colour;
 }
 
 void android_draw_line(void *handle, int x1, int y1, int x2, int y2, int colour)
@@ -195,11 +403,17 @@ void android_draw_thick_poly(void *handle, float thickness, const int *coords, i
 		int fillColour, int outlineColour)
 {
 	HANDLE_TO_FE_OR_RETURN
-	jintArray coordsJava = (*fe->env)->NewIntArray(fe->env, npoints*2);
-	if (coordsJava == NULL) return;
-	(*fe->env)->SetIntArrayRegion(fe->env, coordsJava, 0, npoints*2, coords);
-	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, drawPoly, thickness, coordsJava, fe->ox, fe->oy, outlineColour, fillColour);
-	(*fe->env)->DeleteLocalRef(fe->env, coordsJava);  // prevent ref table exhaustion on e.g. large Mines grids...
+	jint *cmd = drawbuf_reserve(fe, 7 + npoints*2);
+	if (!cmd) return;
+	cmd[0] = DRAW_OP_POLY;
+	fe->stats.polys++;
+	cmd[1] = drawcmd_float(thickness);
+	cmd[2] = npoints;
+	cmd[3] = fe->ox;
+	cmd[4] = fe->oy;
+	cmd[5] = outlineColour;
+	cmd[6] = fillColour;
+	memcpy(cmd + 7, coords, npoints * 2 * sizeof(jint));
 }
 
 void android_draw_poly(void *handle, const int *coords, int npoints,
@@ -211,7 +425,16 @@ void android_draw_poly(void *handle, const int *coords, int npoints,
 void android_draw_thick_circle(void *handle, float thickness, float cx, float cy, float radius, int fillColour, int outlineColour)
 {
 	HANDLE_TO_FE_OR_RETURN
-	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, drawCircle, thickness, cx + (float)fe->ox, cy + (float)fe->oy, radius, outlineColour, fillColour);
+	jint *cmd = drawbuf_reserve(fe, 7);
+	if (!cmd) return;
+	cmd[0] = DRAW_OP_CIRCLE;
+	fe->stats.circles++;
+	cmd[1] = drawcmd_float(thickness);
+	cmd[2] = drawcmd_float(cx + (float)fe->ox);
+	cmd[3] = drawcmd_float(cy + (float)fe->oy);
+	cmd[4] = drawcmd_float(radius);
+	cmd[5] = outlineColour;
+	cmd[6] = fillColour;
 }
 
 void android_draw_circle(void *handle, int cx, int cy, int radius, int fillColour, int outlineColour)
@@ -238,6 +461,7 @@ void android_blitter_free(void *handle, blitter *bl)
 		frontend *fe = (frontend *)handle;
 		if (!(*fe->env)->ExceptionCheck(fe->env)) {
 			(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, blitterFree, bl->handle);
+			fe->stats.jni_calls++;
 		}
 	}
 	sfree(bl);
@@ -246,12 +470,17 @@ void android_blitter_free(void *handle, blitter *bl)
 void android_blitter_save(void *handle, blitter *bl, int x, int y)
 {
 	HANDLE_TO_FE_OR_RETURN
-	if (bl->handle == -1)
+	if (bl->handle == -1) {
 		bl->handle = (*fe->env)->CallIntMethod(fe->env, fe->viewCallbacks, blitterAlloc, bl->w, bl->h);
+		fe->stats.jni_calls++;
+	}
 	bl->x = x;
 	bl->y = y;
+	android_flush_draw(fe);
 	if ((*fe->env)->ExceptionCheck(fe->env)) return;
 	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, blitterSave, bl->handle, x + fe->ox, y + fe->oy);
+	fe->stats.blitter_saves++;
+	fe->stats.jni_calls++;
 }
 
 void android_blitter_load(void *handle, blitter *bl, int x, int y)
@@ -262,13 +491,56 @@ void android_blitter_load(void *handle, blitter *bl, int x, int y)
 		x = bl->x;
 		y = bl->y;
 	}
+	android_flush_draw(fe);
+	if ((*fe->env)->ExceptionCheck(fe->env)) return;
 	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, blitterLoad, bl->handle, x + fe->ox, y + fe->oy);
+	fe->stats.blitter_loads++;
+	fe->stats.jni_calls++;
+}
+
+void android_draw_update(void *handle, int x, int y, int w, int h)
+{
+	HANDLE_TO_FE_OR_RETURN
+	int x1 = x + fe->ox, y1 = y + fe->oy, x2 = x1 + w, y2 = y1 + h;
+	if (w <= 0 || h <= 0) return;
+	if (!fe->dirty) {
+		fe->dirty = true;
+		fe->dirty_x1 = x1; fe->dirty_y1 = y1;
+		fe->dirty_x2 = x2; fe->dirty_y2 = y2;
+		return;
+	}
+	if (x1 < fe->dirty_x1) fe->dirty_x1 = x1;
+	if (y1 < fe->dirty_y1) fe->dirty_y1 = y1;
+	if (x2 > fe->dirty_x2) fe->dirty_x2 = x2;
+	if (y2 > fe->dirty_y2) fe->dirty_y2 = y2;
 }
 
+// Invalidates only what the frame's draw_update calls covered (which only saves anything
+// before API 21; see GameView.invalidateGameRect). A frame that reported none (which a
+// backend drawing correctly shouldn't do) invalidates the whole view.
 void android_end_draw(void *handle)
 {
 	HANDLE_TO_FE_OR_RETURN
-	(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, postInvalidate);
+	bool dirty = fe->dirty;
+	fe->dirty = false;
+	android_flush_draw(fe);
+	if ((*fe->env)->ExceptionCheck(fe->env)) return;
+	if (dirty) {
+		(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, invalidateGameRect,
+				fe->dirty_x1, fe->dirty_y1, fe->dirty_x2 - fe->dirty_x1, fe->dirty_y2 - fe->dirty_y1);
+	} else {
+		(*fe->env)->CallVoidMethod(fe->env, fe->viewCallbacks, postInvalidate);
+	}
+	fe->stats.jni_calls++;
+	if (fe->frame_stats) android_frame_stats_log(fe);
+}
+
+// Nothing was drawn, so there's nothing to invalidate. Any clip commands stay
+// queued and are replayed ahead of the next frame's drawing.
+void android_end_draw_unchanged(void *handle)
+{
+	HANDLE_TO_FE_OR_RETURN
+	fe->dirty = false;
 }
 
 void android_changed_state(void *handle, int can_undo, int can_redo)
@@ -313,7 +585,7 @@ const struct drawing_api android_drawing = {
 	android_draw_thick_poly,
 	android_draw_circle,
 	android_draw_thick_circle,
-	NULL, // draw_update,
+	android_draw_update,
 	android_clip,
 	android_unclip,
 	android_start_draw,
@@ -330,6 +602,7 @@ const struct drawing_api android_drawing = {
 	android_purging_states,
 	android_draw_thick_line,
         android_inertia_follow,
+	android_end_draw_unchanged,
 };
 
 JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_keyEvent(JNIEnv *env, jobject gameEngine, jint x, jint y, jint keyVal)
@@ -357,14 +630,16 @@ JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_resizeEve
 	fe->winheight = h;
 	fe->ox = (viewWidth - w) / 2;
 	fe->oy = (viewHeight - h) / 2;
+	android_flush_draw(fe);
 	if (fe->viewCallbacks) (*env)->CallVoidMethod(env, fe->viewCallbacks, unClip, fe->ox, fe->oy);
 	midend_force_redraw(fe->me);
 }
 
-JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_timerTick(JNIEnv *env, jobject gameEngine)
+// Returns how many ms Java may wait before the next tick, or 0 for as soon as it likes.
+JNIEXPORT jint JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_timerTick(JNIEnv *env, jobject gameEngine)
 {
-	ENV_TO_FE_OR_RETURN()
-	if (! fe->timer_active) return;
+	ENV_TO_FE_OR_RETURN(0)
+	if (! fe->timer_active) return 0;
 	struct timeval now;
 	float elapsed;
 	gettimeofday(&now, NULL);
@@ -372,6 +647,10 @@ JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_timerTick
 			(now.tv_sec - fe->last_time.tv_sec));
 		midend_timer(fe->me, elapsed);  // may clear timer_active
 	fe->last_time = now;
+	float deadline = fe->timer_active ? midend_timer_deadline(fe->me) : 0.f;
+	fe->timer_sleeping = deadline > 0;
+	// Aim slightly late, so that the clock has ticked over when we wake
+	return fe->timer_sleeping ? (jint)(deadline * 1000) + 10 : 0;
 }
 
 void deactivate_timer(frontend *fe)
@@ -385,10 +664,18 @@ void deactivate_timer(frontend *fe)
 void activate_timer(frontend *fe)
 {
 	CHECK_FE_OR_RETURN()
-	if (fe->timer_active) return;
+	if (fe->timer_active) {
+		// Asleep until the clock's next second, but an animation or flash has started
+		if (fe->timer_sleeping && fe->me && midend_timer_deadline(fe->me) == 0) {
+			fe->timer_sleeping = false;
+			(*fe->env)->CallVoidMethod(fe->env, fe->activityCallbacks, requestTimer, true);
+		}
+		return;
+	}
 	(*fe->env)->CallVoidMethod(fe->env, fe->activityCallbacks, requestTimer, true);
 	gettimeofday(&fe->last_time, NULL);
 	fe->timer_active = true;
+	fe->timer_sleeping = false;
 }
 
 JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_resetTimerBaseline(JNIEnv *env, jobject gameEngine)
@@ -436,14 +723,38 @@ JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_configSet
 	i->u.choices.selected = selected;
 }
 
-JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_solveEvent(JNIEnv *env, jobject gameEngine)
+// Solving can take seconds, so Java runs it on a worker thread in three steps: startSolve
+// snapshots the position on the UI thread, runSolve does the work, and finishSolve (back on the
+// UI thread) enters the solution unless the user has moved on. The job is passed around as a long.
+JNIEXPORT jlong JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_startSolve(JNIEnv *env, jobject gameEngine)
 {
-	ENV_TO_FE_OR_RETURN()
-	const char *msg = midend_solve(fe->me);
-	if (! msg) return;
-	jstring js = (*env)->NewStringUTF(env, msg);
-	if( js == NULL ) return;
-	throwIllegalArgumentException(env, msg);
+	ENV_TO_FE_OR_RETURN(0)
+	const char *msg;
+	midend_solve_job *job = midend_solve_start(fe->me, &msg);
+	if (!job) throwIllegalArgumentException(env, msg);
+	return (jlong) job;
+}
+
+JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_runSolve(__attribute__((unused)) JNIEnv *env, __attribute__((unused)) jclass clazz, jlong job)
+{
+	midend_solve_run((midend_solve_job *)job);
+}
+
+JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_finishSolve(JNIEnv *env, jobject gameEngine, jlong job)
+{
+	frontend *fe = (*env)->ExceptionCheck(env) ? NULL : (frontend *)(*env)->GetLongField(env, gameEngine, frontendField);
+	if (!fe || !fe->me) {
+		midend_solve_discard((midend_solve_job *)job);  // this game has gone
+		return;
+	}
+	fe->env = env;
+	const char *msg = midend_solve_finish(fe->me, (midend_solve_job *)job);
+	if (msg) throwIllegalArgumentException(env, msg);
+}
+
+JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_discardSolve(__attribute__((unused)) JNIEnv *env, __attribute__((unused)) jclass clazz, jlong job)
+{
+	midend_solve_discard((midend_solve_job *)job);
 }
 
 JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_restartEvent(JNIEnv *env, jobject gameEngine)
@@ -594,30 +905,182 @@ JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_serialise
 	midend_serialise(fe->me, android_serialise_write, &sctx);
 }
 
+static void android_journal_close(frontend *fe, bool discard)
+{
+	if (fe->journal) fclose(fe->journal);
+	fe->journal = NULL;
+	if (discard && fe->journal_path) remove(fe->journal_path);
+}
+
+// Base records replace the journal atomically via a temporary file; appended records go through
+// stdio's buffer and reach the file when Java calls flushJournal(), typically on pause. Any
+// failure deletes the journal so that the full save Java falls back to is the one loaded.
+static void android_journal_write(void *ctx, const void *buf, int len, bool rewrite)
+{
+	frontend *fe = (frontend *)ctx;
+	if (rewrite) {
+		char *tmp = snewn(strlen(fe->journal_path) + 5, char);
+		sprintf(tmp, "%s.tmp", fe->journal_path);
+		android_journal_close(fe, false);
+		FILE *f = fopen(tmp, "wb");
+		bool ok = f && fwrite(buf, 1, (size_t) len, f) == (size_t) len;
+		if (f && fclose(f)) ok = false;
+		if (ok && !rename(tmp, fe->journal_path)) {
+			fe->journal = fopen(fe->journal_path, "ab");
+		} else {
+			remove(tmp);
+		}
+		if (!fe->journal) android_journal_close(fe, true);
+		sfree(tmp);
+	} else if (fe->journal && fwrite(buf, 1, (size_t) len, fe->journal) != (size_t) len) {
+		android_journal_close(fe, true);
+	}
+}
+
+JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_setJournal(JNIEnv *env, jobject gameEngine, jstring path)
+{
+	ENV_TO_FE_OR_RETURN()
+	midend_set_journal(fe->me, NULL, NULL);
+	android_journal_close(fe, false);
+	sfree(fe->journal_path);
+	fe->journal_path = NULL;
+	if (!path) return;
+	const char *c = (*env)->GetStringUTFChars(env, path, NULL);
+	fe->journal_path = dupstr(c);
+	(*env)->ReleaseStringUTFChars(env, path, c);
+	midend_set_journal(fe->me, android_journal_write, fe);
+}
+
+JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_setFrameStats(JNIEnv *env, jobject gameEngine, jboolean enabled)
+{
+	ENV_TO_FE_OR_RETURN()
+	fe->frame_stats = enabled;
+}
+
+JNIEXPORT jboolean JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_flushJournal(JNIEnv *env, jobject gameEngine)
+{
+	ENV_TO_FE_OR_RETURN(false)
+	midend_journal_flush(fe->me);  // time and UI-only changes since the last move
+	if (fe->journal && fflush(fe->journal)) android_journal_close(fe, true);
+	return fe->journal != NULL;
+}
+
+static bool android_journal_read(void *ctx, void *buf, int len)
+{
+	return len >= 0 && fread(buf, 1, (size_t) len, (FILE *)ctx) == (size_t) len;
+}
+
+// The journal is in the midend's compact binary form, which can't go through a Java string, so
+// this replays it in a headless midend and hands Java back the same game as an ordinary save.
+JNIEXPORT jboolean JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_loadJournal(JNIEnv *env, __attribute__((unused)) jclass clazz, jstring path, jobject baos)
+{
+	const char *c = (*env)->GetStringUTFChars(env, path, NULL);
+	FILE *f = fopen(c, "rb");
+	(*env)->ReleaseStringUTFChars(env, path, c);
+	if (!f) return false;
+	char *name;
+	const game *g = NULL;
+	const char *error = identify_game(&name, android_journal_read, f);
+	if (!error) {
+		for (int i = 0; i < gamecount; i++) {
+			if (!strcmp(gamelist[i]->name, name)) g = gamelist[i];
+		}
+		sfree(name);
+	}
+	bool ok = false;
+	if (g) {
+		midend *me = midend_new(NULL, g, NULL, NULL);
+		rewind(f);
+		if (!midend_deserialise_journal(me, android_journal_read, f)) {
+			struct serialise_ctx sctx;
+			sctx.env = env;
+			sctx.baos = baos;
+			midend_serialise(me, android_serialise_write, &sctx);
+			ok = !(*env)->ExceptionCheck(env);
+		}
+		midend_free(me);
+	}
+	fclose(f);
+	return ok;
+}
+
+#define DESERIALISE_CHUNK 1024
+
+/* Reads a save straight out of the Java string a chunk at a time, rather than
+ * converting the whole thing up front: identify_game() stops at the GAME line,
+ * and a long save is never held in memory as UTF-16 and UTF-8 at once. */
 struct deserialise_ctx {
-    const char* deserialise_read_ptr;
-    size_t deserialise_read_len;
+	JNIEnv *env;
+	jstring s;
+	jsize pos, len;  // in UTF-16 code units
+	char utf8[DESERIALISE_CHUNK * 3];
+	size_t utf8_pos, utf8_len;
 };
 
+static void deserialise_start(struct deserialise_ctx *dctx, JNIEnv *env, jstring s)
+{
+	dctx->env = env;
+	dctx->s = s;
+	dctx->pos = 0;
+	dctx->len = (*env)->GetStringLength(env, s);
+	dctx->utf8_pos = dctx->utf8_len = 0;
+}
+
+static bool deserialise_refill(struct deserialise_ctx *dctx)
+{
+	jchar units[DESERIALISE_CHUNK];
+	jsize n = min(DESERIALISE_CHUNK, dctx->len - dctx->pos);
+	if (n <= 0) return false;
+	(*dctx->env)->GetStringRegion(dctx->env, dctx->s, dctx->pos, n, units);
+	// don't split a surrogate pair across chunks
+	if (n > 1 && dctx->pos + n < dctx->len && units[n-1] >= 0xD800 && units[n-1] < 0xDC00) n--;
+	dctx->pos += n;
+	char *out = dctx->utf8;
+	for (jsize i = 0; i < n; i++) {
+		unsigned long c = units[i];
+		if (c >= 0xD800 && c < 0xDC00 && i + 1 < n && units[i+1] >= 0xDC00 && units[i+1] < 0xE000) {
+			c = 0x10000 + ((c - 0xD800) << 10) + (units[++i] - 0xDC00);
+			*out++ = (char)(0xF0 | (c >> 18));
+			*out++ = (char)(0x80 | ((c >> 12) & 0x3F));
+			*out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+			*out++ = (char)(0x80 | (c & 0x3F));
+		} else if (c < 0x80) {
+			*out++ = (char)c;
+		} else if (c < 0x800) {
+			*out++ = (char)(0xC0 | (c >> 6));
+			*out++ = (char)(0x80 | (c & 0x3F));
+		} else {
+			*out++ = (char)(0xE0 | (c >> 12));
+			*out++ = (char)(0x80 | ((c >> 6) & 0x3F));
+			*out++ = (char)(0x80 | (c & 0x3F));
+		}
+	}
+	dctx->utf8_pos = 0;
+	dctx->utf8_len = out - dctx->utf8;
+	return true;
+}
+
 bool android_deserialise_read(void *ctx, void *buf, int len)
 {
 	struct deserialise_ctx *dctx = (struct deserialise_ctx *)ctx;
 	if (len < 0) return false;
-	size_t l = min((size_t)len, dctx->deserialise_read_len);
-	if (l == 0) return len == 0;
-	memcpy(buf, dctx->deserialise_read_ptr, l );
-	dctx->deserialise_read_ptr += l;
-	dctx->deserialise_read_len -= l;
-	return l == len;
+	char *out = buf;
+	while (len > 0) {
+		if (dctx->utf8_pos == dctx->utf8_len && !deserialise_refill(dctx)) return false;
+		size_t l = min((size_t)len, dctx->utf8_len - dctx->utf8_pos);
+		memcpy(out, dctx->utf8 + dctx->utf8_pos, l);
+		dctx->utf8_pos += l;
+		out += l;
+		len -= (int)l;
+	}
+	return true;
 }
 
 jobject deserialiseOrIdentify(JNIEnv *env, frontend *new_fe, jstring s, jboolean identifyOnly) {
-	const char * c = (*env)->GetStringUTFChars(env, s, NULL);
-	struct deserialise_ctx dctx;
-	dctx.deserialise_read_ptr = c;
-	dctx.deserialise_read_len = strlen(dctx.deserialise_read_ptr);
+	struct deserialise_ctx *dctx = snew(struct deserialise_ctx);
+	deserialise_start(dctx, env, s);
 	char *name;
-	const char *error = identify_game(&name, android_deserialise_read, &dctx);
+	const char *error = identify_game(&name, android_deserialise_read, dctx);
 	const struct game* whichBackend = NULL;
 	jobject backendEnum = NULL;
 	if (! error) {
@@ -625,19 +1088,22 @@ jobject deserialiseOrIdentify(JNIEnv *env, frontend *new_fe, jstring s, jboolean
 		for (i = 0; i < gamecount; i++) {
 			if (!strcmp(gamelist[i]->name, name)) {
 				whichBackend = gamelist[i];
-				backendEnum = (*env)->CallStaticObjectMethod(env, BackendName, byDisplayName, (*env)->NewStringUTF(env, name));
+				jstring jName = (*env)->NewStringUTF(env, name);
+				backendEnum = (*env)->CallStaticObjectMethod(env, BackendName, byDisplayName, jName);
+				(*env)->DeleteLocalRef(env, jName);
+				break;
 			}
 		}
 		if (whichBackend == NULL || backendEnum == NULL) error = "Internal error identifying game";
 	}
+	sfree(name);
 	if (! error && ! identifyOnly) {
 		new_fe->thegame = whichBackend;
 		new_fe->me = midend_new(new_fe, whichBackend, &android_drawing, new_fe);
-		dctx.deserialise_read_ptr = c;
-		dctx.deserialise_read_len = strlen(dctx.deserialise_read_ptr);
-		error = midend_deserialise(new_fe->me, android_deserialise_read, &dctx);
+		deserialise_start(dctx, env, s);
+		error = midend_deserialise_journal(new_fe->me, android_deserialise_read, dctx);
 	}
-	(*env)->ReleaseStringUTFChars(env, s, c);
+	sfree(dctx);
 	if (error) {
 		throwIllegalArgumentException(env, error);
 		if (!identifyOnly && new_fe->me) {
@@ -700,12 +1166,20 @@ game_params* params_from_str(const game* my_game, const char* params_str, const
 	return params;
 }
 
+// Filled in lazily by ordinal so that repeat lookups skip the string round trip.
+static const game *gameByOrdinal[64];
+
 const game* gameFromEnum(JNIEnv *env, jobject backendEnum)
 {
+    const jint ordinal = (*env)->CallIntMethod(env, backendEnum, backendOrdinal);
+    const bool cacheable = ordinal >= 0 && ordinal < (jint)lenof(gameByOrdinal);
+    if (cacheable && gameByOrdinal[ordinal]) return gameByOrdinal[ordinal];
     const jstring backendName = (jstring)(*env)->CallObjectMethod(env, backendEnum, backendToString);
     const char *backend = (*env)->GetStringUTFChars(env, backendName, NULL);
     const game *ret = game_by_name(backend);
     (*env)->ReleaseStringUTFChars(env, backendName, backend);
+    (*env)->DeleteLocalRef(env, backendName);
+    if (cacheable) gameByOrdinal[ordinal] = ret;
     return ret;
 }
 
@@ -807,35 +1281,51 @@ JNIEXPORT jfloatArray JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_ge
 	return jColours;
 }
 
-jobject getPresetInternal(JNIEnv *env, frontend *fe, struct preset_menu_entry entry);
-
-jobjectArray getPresetsInternal(JNIEnv *env, frontend *fe, struct preset_menu *menu) {
-    jobjectArray ret = (*env)->NewObjectArray(env, menu->n_entries, MenuEntry, NULL);
-    for (int i = 0; i < menu->n_entries; i++) {
-        jobject menuItem = getPresetInternal(env, fe, menu->entries[i]);
-        (*env)->SetObjectArrayElement(env, ret, i, menuItem);
-    }
-    return ret;
+static int count_preset_strings(const struct preset_menu *menu)
+{
+	int n = 0;
+	for (int i = 0; i < menu->n_entries; i++) {
+		n += 3;
+		if (menu->entries[i].submenu) n += count_preset_strings(menu->entries[i].submenu) + 3;
+	}
+	return n;
 }
 
-jobject getPresetInternal(JNIEnv *env, frontend *fe, const struct preset_menu_entry entry) {
-    jstring title = (*env)->NewStringUTF(env, entry.title);
-    if (entry.submenu) {
-        jobject submenu = getPresetsInternal(env, fe, entry.submenu);
-        jmethodID newEntryWithSubmenu = (*env)->GetMethodID(env, MenuEntry,  "<init>", "(ILjava/lang/String;[Lname/boyle/chris/sgtpuzzles/MenuEntry;)V");
-        return (*env)->NewObject(env, MenuEntry, newEntryWithSubmenu, entry.id, title, submenu);
-    } else {
-        jstring params = (*env)->NewStringUTF(env, midend_android_preset_menu_get_encoded_params(fe->me, entry.id));
-        jmethodID newEntryWithParams = (*env)->GetMethodID(env, MenuEntry,  "<init>", "(ILjava/lang/String;Ljava/lang/String;)V");
-        return (*env)->NewObject(env, MenuEntry, newEntryWithParams, entry.id, title, params);
-    }
+static void fill_preset_strings(JNIEnv *env, frontend *fe, jobjectArray ret, int *pos, const struct preset_menu *menu)
+{
+	char id[16];
+	for (int i = 0; i < menu->n_entries; i++) {
+		const struct preset_menu_entry *entry = &menu->entries[i];
+		sprintf(id, "%d", entry->id);
+		jstring js = (*env)->NewStringUTF(env, id);
+		(*env)->SetObjectArrayElement(env, ret, (*pos)++, js);
+		(*env)->DeleteLocalRef(env, js);
+		js = (*env)->NewStringUTF(env, entry->title);
+		(*env)->SetObjectArrayElement(env, ret, (*pos)++, js);
+		(*env)->DeleteLocalRef(env, js);
+		if (entry->submenu) {
+			(*pos)++;  // null params
+			fill_preset_strings(env, fe, ret, pos, entry->submenu);
+			*pos += 3;  // end marker
+		} else {
+			js = (*env)->NewStringUTF(env, midend_android_preset_menu_get_encoded_params(fe->me, entry->id));
+			(*env)->SetObjectArrayElement(env, ret, (*pos)++, js);
+			(*env)->DeleteLocalRef(env, js);
+		}
+	}
 }
 
-JNIEXPORT jobjectArray JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_getPresets(JNIEnv *env, jobject gameEngine)
+// The whole preset menu as one flat array of strings, so that Java can build it without
+// a JNI call per entry; see GameEngineImpl.parsePresets() for the layout.
+JNIEXPORT jobjectArray JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_getPresetsFlat(JNIEnv *env, jobject gameEngine)
 {
 	ENV_TO_FE_OR_THROW_ISE("Internal error in getPresets", NULL)
 	struct preset_menu* menu = midend_get_presets(fe->me, NULL);
-	return getPresetsInternal(env, fe, menu);
+	jobjectArray ret = (*env)->NewObjectArray(env, count_preset_strings(menu), String, NULL);
+	if (ret == NULL) return NULL;
+	int pos = 0;
+	fill_preset_strings(env, fe, ret, &pos, menu);
+	return ret;
 }
 
 JNIEXPORT jint JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_getUIVisibility(JNIEnv *env, jobject gameEngine) {
@@ -850,6 +1340,11 @@ JNIEXPORT jint JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_getUIVisi
 JNIEXPORT void JNICALL Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_onDestroy(JNIEnv *env, jobject gameEngine) {
 	ENV_TO_FE_OR_RETURN()
 	midend_free(fe->me);  // might use viewCallbacks (e.g. blitters)
+	android_journal_close(fe, false);
+	sfree(fe->journal_path);
+	free_drawstrings(fe);
+	if (fe->drawBuffer) (*env)->DeleteGlobalRef(env, fe->drawBuffer);
+	sfree(fe->drawbuf);
 	sfree(fe);
 	(*env)->SetLongField(env, gameEngine, frontendField, 0LL);
 }
@@ -887,6 +1382,83 @@ Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_fromGameID(JNIEnv *env, __attrib
 	return startPlayingInt(env, backend, activityCallbacks, viewCallbacks, gameID, true);
 }
 
+// Map a puzzle pack (see pack.h) read-only, so that only the pages holding the index and the
+// entry we want are ever read. On failure, throws and returns NULL; otherwise the caller must
+// munmap(ret, *len).
+static void *map_pack(JNIEnv *env, jstring jPath, pack *pk, size_t *len)
+{
+	const char *path = (*env)->GetStringUTFChars(env, jPath, NULL);
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	(*env)->ReleaseStringUTFChars(env, jPath, path);
+	if (fd < 0) {
+		throwIllegalArgumentException(env, strerror(errno));
+		return NULL;
+	}
+	struct stat st;
+	void *map = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		*len = (size_t)st.st_size;
+		map = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (map == MAP_FAILED) {
+		throwIllegalArgumentException(env, "Cannot map puzzle pack");
+		return NULL;
+	}
+	const char *error = pack_open(pk, map, *len);
+	if (error) {
+		munmap(map, *len);
+		throwIllegalArgumentException(env, error);
+		return NULL;
+	}
+	return map;
+}
+
+JNIEXPORT jint JNICALL
+Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_getPackSize(JNIEnv *env, __attribute__((unused)) jclass clazz, jstring path)
+{
+	pack pk;
+	size_t len;
+	void *map = map_pack(env, path, &pk, &len);
+	if (!map) return 0;
+	munmap(map, len);
+	return pk.count;
+}
+
+// Start entry i of a puzzle pack. The desc is already there, so midend_new_game does no generation.
+JNIEXPORT jobject JNICALL
+Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_fromPack(JNIEnv *env, __attribute__((unused)) jclass clazz, jstring path, jint index, jobject activityCallbacks, jobject viewCallbacks)
+{
+	pack pk;
+	size_t len;
+	void *map = map_pack(env, path, &pk, &len);
+	if (!map) return NULL;
+	if (index < 0 || index >= pk.count) {
+		munmap(map, len);
+		throwIllegalArgumentException(env, "No such puzzle in pack");
+		return NULL;
+	}
+	jstring jName = (*env)->NewStringUTF(env, pk.name);
+	jobject backendEnum = (*env)->CallStaticObjectMethod(env, BackendName, byDisplayName, jName);
+	(*env)->DeleteLocalRef(env, jName);
+	char *gameID = pack_game_id(&pk, index);
+	munmap(map, len);
+	if ((*env)->ExceptionCheck(env)) {
+		sfree(gameID);
+		return NULL;
+	}
+	if (!backendEnum) {
+		sfree(gameID);
+		throwIllegalArgumentException(env, "Puzzle pack is for an unknown game");
+		return NULL;
+	}
+	jstring jGameID = (*env)->NewStringUTF(env, gameID);
+	sfree(gameID);
+	jobject ret = startPlayingInt(env, backendEnum, activityCallbacks, viewCallbacks, jGameID, true);
+	(*env)->DeleteLocalRef(env, jGameID);
+	return ret;
+}
+
 JNIEXPORT jstring JNICALL
 Java_name_boyle_chris_sgtpuzzles_GameEngineImpl_getDefaultParams(JNIEnv *env,
                                                                  __attribute__((unused)) jclass clazz,
@@ -948,13 +1520,13 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *jvm, __attribute__((unused)) void *res
 	ViewCallbacks = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "name/boyle/chris/sgtpuzzles/GameEngine$ViewCallbacks"));
 	ArrowMode = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "name/boyle/chris/sgtpuzzles/SmallKeyboard$ArrowMode"));
 	BackendName = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "name/boyle/chris/sgtpuzzles/BackendName"));
-	MenuEntry = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "name/boyle/chris/sgtpuzzles/MenuEntry"));
 	CustomDialogBuilder = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "name/boyle/chris/sgtpuzzles/CustomDialogBuilder"));
 	KeysResult = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "name/boyle/chris/sgtpuzzles/GameEngine$KeysResult"));
 	IllegalArgumentException = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "java/lang/IllegalArgumentException"));
 	IllegalStateException = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "java/lang/IllegalStateException"));
 	RectF = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "android/graphics/RectF"));
 	Point = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "android/graphics/Point"));
+	String = (jclass)(*env)->NewGlobalRef(env, (*env)->FindClass(env, "java/lang/String"));
 
 	frontendField   = (*env)->GetFieldID(env, GameEngineImpl, "_nativeFrontend", "J");
 	ARROW_MODE_NONE = (*env)->NewGlobalRef(env, (*env)->GetStaticObjectField(env, ArrowMode,
@@ -971,6 +1543,7 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *jvm, __attribute__((unused)) void *res
 	newGameEngineImpl  = (*env)->GetMethodID(env, GameEngineImpl, "<init>", "(JLname/boyle/chris/sgtpuzzles/BackendName;)V");
 	byDisplayName  = (*env)->GetStaticMethodID(env, BackendName, "byDisplayName", "(Ljava/lang/String;)Lname/boyle/chris/sgtpuzzles/BackendName;");
 	backendToString = (*env)->GetMethodID(env, BackendName, "toString", "()Ljava/lang/String;");
+	backendOrdinal = (*env)->GetMethodID(env, BackendName, "ordinal", "()I");
 	newDialogBuilder = (*env)->GetMethodID(env, CustomDialogBuilder, "<init>",
 		"(Landroid/content/Context;Lname/boyle/chris/sgtpuzzles/CustomDialogBuilder$EngineCallbacks;Lname/boyle/chris/sgtpuzzles/CustomDialogBuilder$ActivityCallbacks;ILjava/lang/String;Lname/boyle/chris/sgtpuzzles/BackendName;)V");
 	newKeysResult  = (*env)->GetMethodID(env, KeysResult, "<init>",
@@ -987,14 +1560,12 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *jvm, __attribute__((unused)) void *res
 	blitterFree    = (*env)->GetMethodID(env, ViewCallbacks, "blitterFree", "(I)V");
 	blitterLoad    = (*env)->GetMethodID(env, ViewCallbacks, "blitterLoad", "(III)V");
 	blitterSave    = (*env)->GetMethodID(env, ViewCallbacks, "blitterSave", "(III)V");
-	clipRect       = (*env)->GetMethodID(env, ViewCallbacks, "clipRect", "(IIII)V");
-	drawCircle     = (*env)->GetMethodID(env, ViewCallbacks, "drawCircle", "(FFFFII)V");
-	drawLine       = (*env)->GetMethodID(env, ViewCallbacks, "drawLine", "(FFFFFI)V");
-	drawPoly       = (*env)->GetMethodID(env, ViewCallbacks, "drawPoly", "(F[IIIII)V");
-	drawText       = (*env)->GetMethodID(env, ViewCallbacks, "drawText", "(IIIIILjava/lang/String;)V");
-	fillRect       = (*env)->GetMethodID(env, ViewCallbacks, "fillRect", "(IIIII)V");
+	drawCommands   = (*env)->GetMethodID(env, ViewCallbacks, "drawCommands", "(Ljava/nio/ByteBuffer;I)V");
+	frameStats     = (*env)->GetMethodID(env, ViewCallbacks, "frameStats", "(Ljava/lang/String;)V");
 	getBackgroundColour = (*env)->GetMethodID(env, ViewCallbacks, "getDefaultBackgroundColour", "()I");
+	invalidateGameRect = (*env)->GetMethodID(env, ViewCallbacks, "invalidateGameRect", "(IIII)V");
 	postInvalidate = (*env)->GetMethodID(env, ViewCallbacks, "postInvalidateOnAnimation", "()V");
+	registerDrawString = (*env)->GetMethodID(env, ViewCallbacks, "registerDrawString", "(ILjava/lang/String;)V");
 	unClip         = (*env)->GetMethodID(env, ViewCallbacks, "unClip", "(II)V");
 	dialogAddString = (*env)->GetMethodID(env, CustomDialogBuilder, "dialogAddString", "(ILjava/lang/String;Ljava/lang/String;)V");
 	dialogAddBoolean = (*env)->GetMethodID(env, CustomDialogBuilder, "dialogAddBoolean", "(ILjava/lang/String;Z)V");
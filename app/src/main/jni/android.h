@@ -2,7 +2,9 @@
 #define PUZZLES_ANDROID_H
 
 #include <jni.h>
+#include <stdio.h>
 #include "puzzles.h"
+#include "tree234.h"
 
 struct frontend {
     midend *me;
@@ -11,11 +13,35 @@ struct frontend {
     jobject activityCallbacks;
     jobject viewCallbacks;
     int timer_active;
+    bool timer_sleeping;        /* until the clock's next second */
     struct timeval last_time;
     config_item *cfg;
     int cfg_which;
     int ox, oy;
     int winwidth, winheight;
+    /* Drawing primitives are recorded here and handed to Java in one
+     * call per frame; see android_flush_draw(). */
+    jint *drawbuf;
+    int drawbuf_len, drawbuf_size;
+    jobject drawBuffer;
+    tree234 *drawstrings;
+    int ndrawstrings;
+    /* Union of this frame's draw_update rectangles, in the same
+     * coordinates as the draw buffer, so only that much of the view
+     * need be invalidated; see android_end_draw(). */
+    bool dirty;
+    int dirty_x1, dirty_y1, dirty_x2, dirty_y2;
+    /* This frame's drawing counts and timings, logged at end_draw if
+     * frame_stats is set; see android_frame_stats_log(). */
+    bool frame_stats;
+    struct {
+        int rects, lines, polys, circles, texts, clips;
+        int blitter_saves, blitter_loads, jni_calls;
+        long long start_ns, replay_ns;
+    } stats;
+    /* Append-only save journal, if enabled; see android_journal_write(). */
+    char *journal_path;
+    FILE *journal;
 };
 
 #endif /* PUZZLES_ANDROID_H */
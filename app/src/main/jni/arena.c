@@ -0,0 +1,152 @@
+/*
+ * arena.c: a resettable bump allocator, for solver scratch space
+ * that is allocated in bulk and all thrown away together.
+ *
+ * Memory comes from a list of chunks obtained through smalloc. An
+ * allocation just advances a pointer within the current chunk;
+ * nothing is freed individually. Instead a caller can take a mark,
+ * and releasing back to it discards everything allocated since,
+ * which suits recursive solvers that allocate on the way down and
+ * discard on the way back up. Chunks are never returned to the heap
+ * until arena_free: they are kept and reused, and arena_reset merges
+ * them into one chunk big enough for everything the arena has
+ * needed so far, so once a generator's first attempt has sized the
+ * arena, later attempts make no calls to malloc at all.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "puzzles.h"
+
+#define ARENA_MIN_CHUNK 4096
+
+/* Every allocation is rounded up to a multiple of this, so that any
+ * pointer returned is as well aligned as one from malloc. */
+union arena_align {
+    long double ld;
+    void *p;
+    void (*fp)(void);
+    long l;
+};
+#define ARENA_ALIGN (sizeof(union arena_align))
+
+struct arena_chunk {
+    unsigned char *data;
+    size_t size;
+};
+
+struct arena {
+    struct arena_chunk *chunks;
+    int nchunks, chunksize;
+    int current;                       /* index of chunk in use */
+    size_t used;                       /* bytes used in chunks[current] */
+    size_t capacity;                   /* sum of all chunk sizes */
+};
+
+arena *arena_new(void)
+{
+    arena *a = snew(arena);
+    a->chunks = NULL;
+    a->nchunks = a->chunksize = 0;
+    a->current = 0;
+    a->used = 0;
+    a->capacity = 0;
+    return a;
+}
+
+static void arena_new_chunk(arena *a, int index, size_t size)
+{
+    if (index >= a->chunksize) {
+        a->chunksize = index + 8;
+        a->chunks = sresize(a->chunks, a->chunksize, struct arena_chunk);
+    }
+    a->chunks[index].data = snewn(size, unsigned char);
+    a->chunks[index].size = size;
+    a->capacity += size;
+    if (index >= a->nchunks)
+        a->nchunks = index + 1;
+}
+
+void *arena_alloc(arena *a, size_t size)
+{
+    void *ret;
+
+    size = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    if (size == 0)
+        size = ARENA_ALIGN;
+
+    while (a->current >= a->nchunks ||
+           a->chunks[a->current].size - a->used < size) {
+        int next = (a->nchunks == 0 ? 0 : a->current + 1);
+        size_t want = a->capacity > ARENA_MIN_CHUNK ?
+            a->capacity : ARENA_MIN_CHUNK;
+
+        if (want < size)
+            want = size;
+
+        if (next < a->nchunks && a->chunks[next].size < size) {
+            /*
+             * A chunk left over from a previous, larger use is too
+             * small for this request. Nothing live is in it, so
+             * replace it with one that will do.
+             */
+            a->capacity -= a->chunks[next].size;
+            sfree(a->chunks[next].data);
+            arena_new_chunk(a, next, want);
+        } else if (next >= a->nchunks) {
+            arena_new_chunk(a, next, want);
+        }
+        a->current = next;
+        a->used = 0;
+    }
+
+    ret = a->chunks[a->current].data + a->used;
+    a->used += size;
+    return ret;
+}
+
+arena_mark arena_get_mark(const arena *a)
+{
+    arena_mark m;
+    m.chunk = a->current;
+    m.used = a->used;
+    return m;
+}
+
+void arena_release(arena *a, arena_mark m)
+{
+    assert(m.chunk < a->current ||
+           (m.chunk == a->current && m.used <= a->used));
+    a->current = m.chunk;
+    a->used = m.used;
+}
+
+void arena_reset(arena *a)
+{
+    if (a->nchunks > 1) {
+        size_t capacity = a->capacity;
+        int i;
+
+        for (i = 0; i < a->nchunks; i++)
+            sfree(a->chunks[i].data);
+        a->nchunks = 0;
+        a->capacity = 0;
+        arena_new_chunk(a, 0, capacity);
+    }
+    a->current = 0;
+    a->used = 0;
+}
+
+void arena_free(arena *a)
+{
+    int i;
+
+    if (!a)
+        return;
+    for (i = 0; i < a->nchunks; i++)
+        sfree(a->chunks[i].data);
+    sfree(a->chunks);
+    sfree(a);
+}
@@ -0,0 +1,803 @@
+/*
+ * benchmark.c: measure game generation speed across the whole
+ * collection, as "puzzles-bench".
+ *
+ * For every game (or the ones named on the command line) and every
+ * preset it offers through fetch_preset, this runs N seeded calls to
+ * new_desc and reports the mean, median, 99th percentile and maximum
+ * time per call, plus the process's peak memory by the end of that
+ * preset. If the collection was built with MALLOC_STATS, it also
+ * reports the peak heap use during each preset's generations.
+ * Output is CSV by default, or JSON with --json, so that results
+ * from different releases can be compared mechanically.
+ *
+ *   puzzles-bench [-n N] [--seed PREFIX] [--json] [game[:params]...]
+ *
+ * Seed strings are PREFIX followed by the run number, so the same
+ * arguments always generate the same games. Games that only offer a
+ * preset_menu (Loopy) are benchmarked at their default parameters,
+ * since this tool doesn't link in the midend's menu code.
+ *
+ *   puzzles-bench --corpus [-n N] [--seed PREFIX] [game[:params]...]
+ *
+ * writes the games those arguments would generate to standard
+ * output instead of timing them, one "game:params:desc" per line,
+ * which is the format the solving benchmark reads:
+ *
+ *   puzzles-bench --solve [-n K] [--json] corpus-file...
+ *
+ * For each corpus line, this solves the puzzle once untimed as a
+ * warm-up and then K more times, and reports the mean time per solve
+ * for each run of consecutive lines with the same game and params.
+ * Solving goes through the game's solve function with no aux
+ * string, so it measures each backend's own solver. The corpora in
+ * benchmarks/ are checked in so that solver changes can be compared
+ * on the same puzzles from one build to the next.
+ *
+ *   puzzles-bench --check [--jobs N] < corpus
+ *
+ * validates game IDs in the same format read from standard input,
+ * spread over N threads: each is solved, and the solution checked to
+ * complete the puzzle. One line per ID is written in input order,
+ * the ID followed by a tab and "solved", "unsolved" (the solver gave
+ * up), "wrong" (its answer didn't complete the puzzle) or "invalid:"
+ * and the error; the exit status is nonzero unless all were solved.
+ * More than one job needs a build with PARALLEL_GENERATION, which is
+ * what makes the shared grid cache safe to use from several threads.
+ *
+ *   puzzles-bench --pack FILE [-n N] [--seed PREFIX] [--jobs N] game[:params]
+ *
+ * generates N games with the same seeds as --corpus, spread over the
+ * given number of threads, and writes them to FILE as a puzzle pack
+ * (see pack.h) for a front end to play without generating anything.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "puzzles.h"
+#include "pack.h"
+
+extern const game *gamelist[];
+extern const int gamecount;
+
+struct result {
+    const char *game;
+    char *preset, *params;
+    int runs;
+    double mean, p50, p99, max;        /* milliseconds */
+    long peak_kb;
+    long heap_peak_bytes;              /* -1 without MALLOC_STATS */
+};
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static long peak_kb(void)
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) < 0)
+        return -1;
+    return ru.ru_maxrss;
+}
+
+static int compare_doubles(const void *av, const void *bv)
+{
+    double a = *(const double *)av, b = *(const double *)bv;
+    return a < b ? -1 : a > b ? +1 : 0;
+}
+
+static const game *find_game(const char *name)
+{
+    int i;
+
+    for (i = 0; i < gamecount; i++)
+        if (!strcmp(gamelist[i]->name, name) ||
+            !strcmp(gamelist[i]->htmlhelp_topic, name))
+            return gamelist[i];
+    return NULL;
+}
+
+static void bench(const game *g, const game_params *params,
+                  const char *preset, int runs, const char *seedprefix,
+                  struct result *res)
+{
+    double *times = snewn(runs, double), total = 0;
+    char *seed = snewn(strlen(seedprefix) + 20, char);
+    int i;
+#ifdef MALLOC_STATS
+    struct malloc_stats ms;
+    malloc_stats_reset();
+#endif
+
+    for (i = 0; i < runs; i++) {
+        random_state *rs;
+        char *desc, *aux = NULL;
+        double t0;
+
+        sprintf(seed, "%s%d", seedprefix, i);
+        rs = random_new_seed_string(seed);
+        t0 = now_ms();
+        desc = g->new_desc(params, rs, &aux, false);
+        times[i] = now_ms() - t0;
+        total += times[i];
+        sfree(desc);
+        sfree(aux);
+        random_free(rs);
+    }
+
+    qsort(times, runs, sizeof(double), compare_doubles);
+    res->game = g->name;
+    res->preset = dupstr(preset);
+    res->params = g->encode_params(params, true);
+    res->runs = runs;
+    res->mean = total / runs;
+    res->p50 = times[runs / 2];
+    res->p99 = times[(runs * 99) / 100 < runs ? (runs * 99) / 100 : runs-1];
+    res->max = times[runs - 1];
+    res->peak_kb = peak_kb();
+#ifdef MALLOC_STATS
+    malloc_stats_snapshot(&ms, 1);
+    res->heap_peak_bytes = ms.peak_bytes;
+#else
+    res->heap_peak_bytes = -1;
+#endif
+
+    sfree(seed);
+    sfree(times);
+}
+
+static void print_string(const char *s, bool json)
+{
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"')
+            fputs(json ? "\\\"" : "\"\"", stdout);
+        else if (json && *s == '\\')
+            fputs("\\\\", stdout);
+        else
+            putchar(*s);
+    }
+    putchar('"');
+}
+
+static void print_result(const struct result *r, bool json, bool first)
+{
+    if (json) {
+        printf("%s\n  {\"game\": ", first ? "" : ",");
+        print_string(r->game, true);
+        printf(", \"preset\": ");
+        print_string(r->preset, true);
+        printf(", \"params\": ");
+        print_string(r->params, true);
+        printf(", \"runs\": %d, \"mean_ms\": %.3f, \"p50_ms\": %.3f, "
+               "\"p99_ms\": %.3f, \"max_ms\": %.3f, \"peak_kb\": %ld, "
+               "\"heap_peak_bytes\": %ld}",
+               r->runs, r->mean, r->p50, r->p99, r->max, r->peak_kb,
+               r->heap_peak_bytes);
+    } else {
+        print_string(r->game, false);
+        putchar(',');
+        print_string(r->preset, false);
+        putchar(',');
+        print_string(r->params, false);
+        printf(",%d,%.3f,%.3f,%.3f,%.3f,%ld,%ld\n",
+               r->runs, r->mean, r->p50, r->p99, r->max, r->peak_kb,
+               r->heap_peak_bytes);
+    }
+    fflush(stdout);
+}
+
+static void write_corpus(const game *g, const game_params *params,
+                         int runs, const char *seedprefix)
+{
+    char *seed = snewn(strlen(seedprefix) + 20, char);
+    char *paramstr = g->encode_params(params, true);
+    int i;
+
+    for (i = 0; i < runs; i++) {
+        random_state *rs;
+        char *desc, *aux = NULL;
+
+        sprintf(seed, "%s%d", seedprefix, i);
+        rs = random_new_seed_string(seed);
+        desc = g->new_desc(params, rs, &aux, false);
+        printf("%s:%s:%s\n", g->name, paramstr, desc);
+        sfree(desc);
+        sfree(aux);
+        random_free(rs);
+    }
+    fflush(stdout);
+
+    sfree(paramstr);
+    sfree(seed);
+}
+
+static void bench_preset(const game *g, const game_params *params,
+                         const char *preset, int runs,
+                         const char *seedprefix, bool corpus, bool json,
+                         bool *first)
+{
+    struct result res;
+
+    if (corpus) {
+        write_corpus(g, params, runs, seedprefix);
+        return;
+    }
+    bench(g, params, preset, runs, seedprefix, &res);
+    print_result(&res, json, *first);
+    *first = false;
+    sfree(res.preset);
+    sfree(res.params);
+}
+
+static bool bench_game(const game *g, const char *paramstr, int runs,
+                       const char *seedprefix, bool corpus, bool json,
+                       bool *first)
+{
+
+    if (paramstr) {
+        game_params *params = g->default_params();
+        const char *err;
+
+        g->decode_params(params, paramstr);
+        err = g->validate_params(params, true);
+        if (err) {
+            fprintf(stderr, "puzzles-bench: %s:%s: %s\n",
+                    g->name, paramstr, err);
+            g->free_params(params);
+            return false;
+        }
+        bench_preset(g, params, paramstr, runs, seedprefix, corpus, json,
+                     first);
+        g->free_params(params);
+    } else {
+        char *name;
+        game_params *params;
+        int i;
+
+        for (i = 0; g->fetch_preset && g->fetch_preset(i, &name, &params);
+             i++) {
+            bench_preset(g, params, name, runs, seedprefix, corpus, json,
+                         first);
+            sfree(name);
+            g->free_params(params);
+        }
+        if (i == 0) {
+            params = g->default_params();
+            bench_preset(g, params, "default", runs, seedprefix, corpus,
+                         json, first);
+            g->free_params(params);
+        }
+    }
+    return true;
+}
+
+/*
+ * Results of the solving benchmark, for one run of corpus lines with
+ * the same game and params.
+ */
+struct solve_result {
+    const game *g;
+    char *params;
+    int puzzles, unsolved, runs;
+    double total;                      /* milliseconds */
+};
+
+static void print_solve_result(const struct solve_result *r, bool json,
+                               bool first)
+{
+    double ns = r->puzzles ? r->total * 1e6 / r->puzzles / r->runs : 0;
+
+    if (json) {
+        printf("%s\n  {\"game\": ", first ? "" : ",");
+        print_string(r->g->name, true);
+        printf(", \"params\": ");
+        print_string(r->params, true);
+        printf(", \"puzzles\": %d, \"unsolved\": %d, \"runs\": %d, "
+               "\"ns_per_puzzle\": %.0f}",
+               r->puzzles, r->unsolved, r->runs, ns);
+    } else {
+        print_string(r->g->name, false);
+        putchar(',');
+        print_string(r->params, false);
+        printf(",%d,%d,%d,%.0f\n", r->puzzles, r->unsolved, r->runs, ns);
+    }
+    fflush(stdout);
+}
+
+/*
+ * Solve one corpus puzzle once untimed, then 'runs' times timed.
+ * Returns false if the game ID is bad; a puzzle the solver gives up
+ * on is counted in 'unsolved' rather than being an error.
+ */
+static bool solve_one(const game *g, const char *paramstr, const char *desc,
+                      int runs, struct solve_result *res)
+{
+    game_params *params = g->default_params();
+    game_state *state;
+    const char *err;
+    char *move;
+    double t0;
+    int i;
+
+    g->decode_params(params, paramstr);
+    err = g->validate_params(params, true);
+    if (!err)
+        err = g->validate_desc(params, desc);
+    if (err) {
+        fprintf(stderr, "puzzles-bench: %s:%s:%s: %s\n",
+                g->name, paramstr, desc, err);
+        g->free_params(params);
+        return false;
+    }
+    state = g->new_game(NULL, params, desc);
+
+    move = g->solve(state, state, NULL, &err);
+    if (!move)
+        res->unsolved++;
+    sfree(move);
+
+    t0 = now_ms();
+    for (i = 0; i < runs; i++)
+        sfree(g->solve(state, state, NULL, &err));
+    res->total += now_ms() - t0;
+    res->puzzles++;
+
+    g->free_game(state);
+    g->free_params(params);
+    return true;
+}
+
+static bool solve_corpus(const char *filename, int runs, bool json,
+                         bool *first)
+{
+    FILE *fp = fopen(filename, "r");
+    struct solve_result res;
+    char *line;
+    bool ok = true;
+
+    if (!fp) {
+        fprintf(stderr, "puzzles-bench: %s: cannot open\n", filename);
+        return false;
+    }
+
+    res.g = NULL;
+    res.params = NULL;
+    while ((line = fgetline(fp)) != NULL) {
+        char *paramstr, *desc;
+        const game *g;
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!*line || *line == '#') {
+            sfree(line);
+            continue;
+        }
+        paramstr = strchr(line, ':');
+        desc = paramstr ? strchr(paramstr + 1, ':') : NULL;
+        if (!desc) {
+            fprintf(stderr, "puzzles-bench: %s: bad line '%s'\n",
+                    filename, line);
+            ok = false;
+            sfree(line);
+            continue;
+        }
+        *paramstr++ = *desc++ = '\0';
+
+        g = find_game(line);
+        if (!g || !g->can_solve) {
+            fprintf(stderr, "puzzles-bench: %s: %s game '%s'\n", filename,
+                    g ? "unsolvable" : "unknown", line);
+            ok = false;
+            sfree(line);
+            continue;
+        }
+
+        if (g != res.g || strcmp(paramstr, res.params)) {
+            if (res.g && res.puzzles) {
+                print_solve_result(&res, json, *first);
+                *first = false;
+            }
+            sfree(res.params);
+            res.g = g;
+            res.params = dupstr(paramstr);
+            res.puzzles = res.unsolved = 0;
+            res.runs = runs;
+            res.total = 0;
+        }
+        if (!solve_one(g, paramstr, desc, runs, &res))
+            ok = false;
+        sfree(line);
+    }
+    if (res.g && res.puzzles) {
+        print_solve_result(&res, json, *first);
+        *first = false;
+    }
+    sfree(res.params);
+
+    fclose(fp);
+    return ok;
+}
+
+/*
+ * Shared state of a --check run. Worker threads take the next
+ * unclaimed line, and the main thread writes out each result as soon
+ * as all the ones before it are done.
+ */
+struct check_ctx {
+    char **lines;
+    char **results;                    /* NULL until done */
+    int nlines, next;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+};
+
+/* Check one corpus line, which this may modify. */
+static char *check_one(char *line)
+{
+    char *paramstr, *desc, *move;
+    const game *g;
+    game_params *params;
+    game_state *state, *solved;
+    const char *err = NULL, *result;
+
+    paramstr = strchr(line, ':');
+    desc = paramstr ? strchr(paramstr + 1, ':') : NULL;
+    if (!desc)
+        return dupstr("invalid: expected game:params:desc");
+    *paramstr++ = *desc++ = '\0';
+    g = find_game(line);
+    if (!g)
+        return dupstr("invalid: unknown game");
+    if (!g->can_solve)
+        return dupstr("invalid: game has no solver");
+
+    params = g->default_params();
+    g->decode_params(params, paramstr);
+    err = g->validate_params(params, true);
+    if (!err)
+        err = g->validate_desc(params, desc);
+    if (err) {
+        char *ret = snewn(strlen(err) + 10, char);
+        sprintf(ret, "invalid: %s", err);
+        g->free_params(params);
+        return ret;
+    }
+
+    state = g->new_game(NULL, params, desc);
+    move = g->solve(state, state, NULL, &err);
+    if (!move) {
+        result = "unsolved";
+    } else {
+        solved = g->execute_move(state, move);
+        result = solved && g->status(solved) > 0 ? "solved" : "wrong";
+        if (solved)
+            g->free_game(solved);
+        sfree(move);
+    }
+    g->free_game(state);
+    g->free_params(params);
+    return dupstr(result);
+}
+
+static void *check_thread(void *vctx)
+{
+    struct check_ctx *ctx = (struct check_ctx *)vctx;
+    char *line, *result;
+    int i;
+
+    while (1) {
+        pthread_mutex_lock(&ctx->lock);
+        i = ctx->next < ctx->nlines ? ctx->next++ : -1;
+        pthread_mutex_unlock(&ctx->lock);
+        if (i < 0)
+            return NULL;
+
+        line = dupstr(ctx->lines[i]);
+        result = check_one(line);
+        sfree(line);
+
+        pthread_mutex_lock(&ctx->lock);
+        ctx->results[i] = result;
+        pthread_cond_signal(&ctx->done);
+        pthread_mutex_unlock(&ctx->lock);
+    }
+}
+
+static bool check_corpus(FILE *fp, int jobs)
+{
+    struct check_ctx ctx;
+    pthread_t *threads;
+    char *line;
+    int size = 0, i, nthreads;
+    bool ok = true;
+
+    ctx.lines = NULL;
+    ctx.nlines = ctx.next = 0;
+    while ((line = fgetline(fp)) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!*line || *line == '#') {
+            sfree(line);
+            continue;
+        }
+        if (ctx.nlines == size) {
+            size = size * 3 / 2 + 64;
+            ctx.lines = sresize(ctx.lines, size, char *);
+        }
+        ctx.lines[ctx.nlines++] = line;
+    }
+    ctx.results = snewn(ctx.nlines + 1, char *);
+    for (i = 0; i < ctx.nlines; i++)
+        ctx.results[i] = NULL;
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.done, NULL);
+
+    threads = snewn(jobs, pthread_t);
+    for (nthreads = 0; nthreads < jobs; nthreads++)
+        if (pthread_create(&threads[nthreads], NULL, check_thread, &ctx))
+            break;
+    if (nthreads == 0)
+        check_thread(&ctx);            /* do it all ourselves */
+
+    for (i = 0; i < ctx.nlines; i++) {
+        pthread_mutex_lock(&ctx.lock);
+        while (!ctx.results[i])
+            pthread_cond_wait(&ctx.done, &ctx.lock);
+        pthread_mutex_unlock(&ctx.lock);
+
+        printf("%s\t%s\n", ctx.lines[i], ctx.results[i]);
+        fflush(stdout);
+        if (strcmp(ctx.results[i], "solved"))
+            ok = false;
+        sfree(ctx.results[i]);
+        sfree(ctx.lines[i]);
+    }
+
+    for (i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    sfree(threads);
+    pthread_cond_destroy(&ctx.done);
+    pthread_mutex_destroy(&ctx.lock);
+    sfree(ctx.results);
+    sfree(ctx.lines);
+    return ok;
+}
+
+/*
+ * Shared state of a --pack run. Worker threads take the next index
+ * still to be generated; the seeds don't depend on which thread
+ * generates what, so the pack is the same for any number of jobs.
+ */
+struct pack_ctx {
+    const game *g;
+    const game_params *params;
+    const char *seedprefix;
+    char **descs;
+    int n, next;
+    pthread_mutex_t lock;
+};
+
+static void *pack_thread(void *vctx)
+{
+    struct pack_ctx *ctx = (struct pack_ctx *)vctx;
+    char *seed = snewn(strlen(ctx->seedprefix) + 20, char);
+    random_state *rs;
+    char *aux;
+    int i;
+
+    while (1) {
+        pthread_mutex_lock(&ctx->lock);
+        i = ctx->next < ctx->n ? ctx->next++ : -1;
+        pthread_mutex_unlock(&ctx->lock);
+        if (i < 0)
+            break;
+
+        sprintf(seed, "%s%d", ctx->seedprefix, i);
+        rs = random_new_seed_string(seed);
+        aux = NULL;
+        ctx->descs[i] = ctx->g->new_desc(ctx->params, rs, &aux, false);
+        sfree(aux);
+        random_free(rs);
+    }
+    sfree(seed);
+    return NULL;
+}
+
+static bool write_pack(const char *filename, char *gamearg, int runs,
+                       const char *seedprefix, int jobs)
+{
+    struct pack_ctx ctx;
+    pthread_t *threads;
+    char *paramstr = strchr(gamearg, ':'), *encoded;
+    game_params *params;
+    const char *err;
+    FILE *fp;
+    int i, nthreads;
+    bool ok;
+
+    if (paramstr)
+        *paramstr++ = '\0';
+    ctx.g = find_game(gamearg);
+    if (!ctx.g) {
+        fprintf(stderr, "puzzles-bench: unknown game '%s'\n", gamearg);
+        return false;
+    }
+    params = ctx.g->default_params();
+    if (paramstr)
+        ctx.g->decode_params(params, paramstr);
+    err = ctx.g->validate_params(params, true);
+    if (err) {
+        fprintf(stderr, "puzzles-bench: %s:%s: %s\n", ctx.g->name,
+                paramstr ? paramstr : "", err);
+        ctx.g->free_params(params);
+        return false;
+    }
+
+    ctx.params = params;
+    ctx.seedprefix = seedprefix;
+    ctx.n = runs;
+    ctx.next = 0;
+    ctx.descs = snewn(runs, char *);
+    pthread_mutex_init(&ctx.lock, NULL);
+    threads = snewn(jobs, pthread_t);
+    for (nthreads = 0; nthreads < jobs; nthreads++)
+        if (pthread_create(&threads[nthreads], NULL, pack_thread, &ctx))
+            break;
+    if (nthreads == 0)
+        pack_thread(&ctx);
+    for (i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    sfree(threads);
+    pthread_mutex_destroy(&ctx.lock);
+
+    encoded = ctx.g->encode_params(params, true);
+    fp = fopen(filename, "wb");
+    ok = fp && pack_write(fp, ctx.g->name, encoded, ctx.descs, runs);
+    if (fp && fclose(fp))
+        ok = false;
+    if (!ok)
+        fprintf(stderr, "puzzles-bench: %s: write failed\n", filename);
+
+    for (i = 0; i < runs; i++)
+        sfree(ctx.descs[i]);
+    sfree(ctx.descs);
+    sfree(encoded);
+    ctx.g->free_params(params);
+    return ok;
+}
+
+static void usage(FILE *fp)
+{
+    fprintf(fp, "usage: puzzles-bench [-n N] [--seed PREFIX] [--json] "
+            "[game[:params]...]\n"
+            "       puzzles-bench --corpus [-n N] [--seed PREFIX] "
+            "[game[:params]...]\n"
+            "       puzzles-bench --solve [-n K] [--json] "
+            "corpus-file...\n"
+            "       puzzles-bench --check [--jobs N] < corpus\n"
+            "       puzzles-bench --pack FILE [-n N] [--seed PREFIX] "
+            "[--jobs N] game[:params]\n");
+}
+
+int main(int argc, char **argv)
+{
+    int runs = -1, i, j, ngames = 0;
+    const char *seedprefix = RANDOM_FAST_SEED_TAG "bench";
+    const char *packfile = NULL;
+    int jobs = 1;
+    bool json = false, corpus = false, solve = false, check = false;
+    bool first = true, ok = true;
+    char **games = snewn(argc, char *);
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i+1 < argc) {
+            runs = atoi(argv[++i]);
+            if (runs < 1) {
+                usage(stderr);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--seed") && i+1 < argc) {
+            seedprefix = argv[++i];
+        } else if (!strcmp(argv[i], "--json")) {
+            json = true;
+        } else if (!strcmp(argv[i], "--corpus")) {
+            corpus = true;
+        } else if (!strcmp(argv[i], "--solve")) {
+            solve = true;
+        } else if (!strcmp(argv[i], "--check")) {
+            check = true;
+        } else if (!strcmp(argv[i], "--pack") && i+1 < argc) {
+            packfile = argv[++i];
+        } else if ((!strcmp(argv[i], "--jobs") || !strcmp(argv[i], "-j")) &&
+                   i+1 < argc) {
+            jobs = atoi(argv[++i]);
+            if (jobs < 1) {
+                usage(stderr);
+                return 1;
+            }
+#ifndef PARALLEL_GENERATION
+            if (jobs > 1) {
+                fprintf(stderr, "puzzles-bench: --jobs needs a build "
+                        "with PARALLEL_GENERATION\n");
+                return 1;
+            }
+#endif
+        } else if (!strcmp(argv[i], "--help")) {
+            usage(stdout);
+            return 0;
+        } else if (argv[i][0] == '-') {
+            usage(stderr);
+            return 1;
+        } else {
+            games[ngames++] = argv[i];
+        }
+    }
+
+    if ((corpus && (solve || json)) || (solve && ngames == 0) ||
+        (check && (corpus || solve || json || ngames > 0)) ||
+        (packfile && (check || corpus || solve || json || ngames != 1))) {
+        usage(stderr);
+        return 1;
+    }
+    if (check) {
+        sfree(games);
+        return check_corpus(stdin, jobs) ? 0 : 1;
+    }
+    if (runs < 0)
+        runs = solve ? 10 : 20;
+    if (packfile) {
+        ok = write_pack(packfile, games[0], runs, seedprefix, jobs);
+        sfree(games);
+        return ok ? 0 : 1;
+    }
+
+    if (json)
+        printf("[");
+    else if (solve)
+        printf("game,params,puzzles,unsolved,runs,ns_per_puzzle\n");
+    else if (!corpus)
+        printf("game,preset,params,runs,mean_ms,p50_ms,p99_ms,max_ms,"
+               "peak_kb,heap_peak_bytes\n");
+
+    if (solve) {
+        for (i = 0; i < ngames; i++)
+            if (!solve_corpus(games[i], runs, json, &first))
+                ok = false;
+        ngames = 0;
+    } else if (ngames == 0) {
+        for (j = 0; j < gamecount; j++)
+            bench_game(gamelist[j], NULL, runs, seedprefix, corpus, json,
+                       &first);
+    }
+    for (i = 0; i < ngames; i++) {
+        char *paramstr = strchr(games[i], ':');
+        const game *g;
+
+        if (paramstr)
+            *paramstr++ = '\0';
+        g = find_game(games[i]);
+        if (!g) {
+            fprintf(stderr, "puzzles-bench: unknown game '%s'\n", games[i]);
+            ok = false;
+            continue;
+        }
+        if (!bench_game(g, paramstr, runs, seedprefix, corpus, json,
+                        &first))
+            ok = false;
+    }
+
+    if (json)
+        printf("\n]\n");
+    sfree(games);
+    return ok ? 0 : 1;
+}
+
+/* vim: set shiftwidth=4 tabstop=8: */
@@ -0,0 +1,172 @@
+/*
+ * bitgrid.c: a rectangle of bits, packed one per bit with each row
+ * starting on a word boundary so that whole-row operations can work
+ * a word at a time.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include "puzzles.h"
+
+typedef unsigned long bitword;
+#define WORD_BITS ((int)(sizeof(bitword) * CHAR_BIT))
+
+struct bitgrid {
+    int w, h;
+    int stride;                        /* words per row */
+    bitword *words;
+};
+
+static int popcount(bitword v)
+{
+#ifdef __GNUC__
+    return __builtin_popcountl(v);
+#else
+    int n = 0;
+    for (; v; v &= v - 1)
+        n++;
+    return n;
+#endif
+}
+
+static int lowest_bit(bitword v)
+{
+#ifdef __GNUC__
+    return __builtin_ctzl(v);
+#else
+    int n = 0;
+    for (; !(v & 1); v >>= 1)
+        n++;
+    return n;
+#endif
+}
+
+bitgrid *bitgrid_new(int w, int h)
+{
+    bitgrid *bg = snew(bitgrid);
+
+    assert(w > 0 && h > 0);
+    bg->w = w;
+    bg->h = h;
+    bg->stride = (w + WORD_BITS - 1) / WORD_BITS;
+    bg->words = snewn(bg->stride * h, bitword);
+    bitgrid_clear(bg);
+    return bg;
+}
+
+bitgrid *bitgrid_dup(const bitgrid *bg)
+{
+    bitgrid *ret = snew(bitgrid);
+
+    *ret = *bg;
+    ret->words = snewn(bg->stride * bg->h, bitword);
+    memcpy(ret->words, bg->words, bg->stride * bg->h * sizeof(bitword));
+    return ret;
+}
+
+void bitgrid_free(bitgrid *bg)
+{
+    if (!bg)
+        return;
+    sfree(bg->words);
+    sfree(bg);
+}
+
+void bitgrid_clear(bitgrid *bg)
+{
+    memset(bg->words, 0, bg->stride * bg->h * sizeof(bitword));
+}
+
+bool bitgrid_get(const bitgrid *bg, int x, int y)
+{
+    assert(x >= 0 && x < bg->w && y >= 0 && y < bg->h);
+    return (bg->words[y * bg->stride + x / WORD_BITS] >> (x % WORD_BITS)) & 1;
+}
+
+void bitgrid_set(bitgrid *bg, int x, int y, bool v)
+{
+    bitword *word, bit;
+
+    assert(x >= 0 && x < bg->w && y >= 0 && y < bg->h);
+    word = &bg->words[y * bg->stride + x / WORD_BITS];
+    bit = (bitword)1 << (x % WORD_BITS);
+    if (v)
+        *word |= bit;
+    else
+        *word &= ~bit;
+}
+
+void bitgrid_toggle(bitgrid *bg, int x, int y)
+{
+    assert(x >= 0 && x < bg->w && y >= 0 && y < bg->h);
+    bg->words[y * bg->stride + x / WORD_BITS] ^= (bitword)1 << (x % WORD_BITS);
+}
+
+void bitgrid_xor_row(bitgrid *dst, int dy, const bitgrid *src, int sy)
+{
+    bitword *d;
+    const bitword *s;
+    int i;
+
+    assert(dst->w == src->w);
+    assert(dy >= 0 && dy < dst->h && sy >= 0 && sy < src->h);
+    d = dst->words + dy * dst->stride;
+    s = src->words + sy * src->stride;
+    for (i = 0; i < dst->stride; i++)
+        d[i] ^= s[i];
+}
+
+bool bitgrid_rows_equal(const bitgrid *a, int ay, const bitgrid *b, int by)
+{
+    assert(a->w == b->w);
+    assert(ay >= 0 && ay < a->h && by >= 0 && by < b->h);
+    return !memcmp(a->words + ay * a->stride, b->words + by * b->stride,
+                   a->stride * sizeof(bitword));
+}
+
+bool bitgrid_row_empty(const bitgrid *bg, int y)
+{
+    const bitword *row;
+    int i;
+
+    assert(y >= 0 && y < bg->h);
+    row = bg->words + y * bg->stride;
+    for (i = 0; i < bg->stride; i++)
+        if (row[i])
+            return false;
+    return true;
+}
+
+int bitgrid_row_popcount(const bitgrid *bg, int y)
+{
+    const bitword *row;
+    int i, n = 0;
+
+    assert(y >= 0 && y < bg->h);
+    row = bg->words + y * bg->stride;
+    for (i = 0; i < bg->stride; i++)
+        n += popcount(row[i]);
+    return n;
+}
+
+int bitgrid_row_next(const bitgrid *bg, int y, int x)
+{
+    const bitword *row;
+    bitword v;
+    int i;
+
+    assert(y >= 0 && y < bg->h && x >= 0);
+    if (x >= bg->w)
+        return -1;
+    row = bg->words + y * bg->stride;
+    i = x / WORD_BITS;
+    v = row[i] & (~(bitword)0 << (x % WORD_BITS));
+    while (!v) {
+        if (++i == bg->stride)
+            return -1;
+        v = row[i];
+    }
+    return i * WORD_BITS + lowest_bit(v);
+}
@@ -136,6 +136,8 @@ typedef unsigned int grid_type; /* change me later if we invent > 16 bits of fla
 struct solver_state {
     int *dsf, *comptspaces;
     int *tmpdsf, *tmpcompspaces;
+    /* columns and rows whose possibles are out of date. */
+    bool *coldirty, *rowdirty;
     int refcount;
 };
 
@@ -921,104 +923,137 @@ static char *game_state_diff(const game_state *src, const game_state *dest)
 
 /* --- Game setup and solving utilities --- */
 
-/* This function is optimised; a Quantify showed that lots of grid-generation time
- * (>50%) was spent in here. Hence the IDX() stuff. */
+/* These functions are optimised; a Quantify showed that lots of
+ * grid-generation time (>50%) was spent in here. Hence the IDX() stuff.
+ * Each column's possv depends only on that column, and each row's possh
+ * only on that row, so the solver recalculates just the lines that
+ * solve_join has touched. */
 
-static void map_update_possibles(game_state *state)
+static void map_update_possv(game_state *state, int x)
 {
-    int x, y, s, e, i, np, maxb, w = state->w, idx;
+    int y, s, e, i, np, maxb, w = state->w, idx;
     bool bl;
     struct island *is_s = NULL, *is_f = NULL;
 
-    /* Run down vertical stripes [un]setting possv... */
-    for (x = 0; x < state->w; x++) {
-        idx = x;
-        s = e = -1;
-        bl = false;
-        maxb = state->params.maxb;     /* placate optimiser */
-        /* Unset possible flags until we find an island. */
-        for (y = 0; y < state->h; y++) {
-            is_s = IDX(state, gridi, idx);
-            if (is_s) {
-                maxb = is_s->count;
-                break;
-            }
-
-            IDX(state, possv, idx) = 0;
-            idx += w;
+    idx = x;
+    s = e = -1;
+    bl = false;
+    maxb = state->params.maxb;     /* placate optimiser */
+    /* Unset possible flags until we find an island. */
+    for (y = 0; y < state->h; y++) {
+        is_s = IDX(state, gridi, idx);
+        if (is_s) {
+            maxb = is_s->count;
+            break;
         }
-        for (; y < state->h; y++) {
-            maxb = min(maxb, IDX(state, maxv, idx));
-            is_f = IDX(state, gridi, idx);
-            if (is_f) {
-                assert(is_s);
-                np = min(maxb, is_f->count);
 
-                if (s != -1) {
-                    for (i = s; i <= e; i++) {
-                        INDEX(state, possv, x, i) = bl ? 0 : np;
-                    }
+        IDX(state, possv, idx) = 0;
+        idx += w;
+    }
+    for (; y < state->h; y++) {
+        maxb = min(maxb, IDX(state, maxv, idx));
+        is_f = IDX(state, gridi, idx);
+        if (is_f) {
+            assert(is_s);
+            np = min(maxb, is_f->count);
+
+            if (s != -1) {
+                for (i = s; i <= e; i++) {
+                    INDEX(state, possv, x, i) = bl ? 0 : np;
                 }
-                s = y+1;
-                bl = false;
-                is_s = is_f;
-                maxb = is_s->count;
-            } else {
-                e = y;
-                if (IDX(state,grid,idx) & (G_LINEH|G_NOLINEV)) bl = true;
             }
-            idx += w;
-        }
-        if (s != -1) {
-            for (i = s; i <= e; i++)
-                INDEX(state, possv, x, i) = 0;
+            s = y+1;
+            bl = false;
+            is_s = is_f;
+            maxb = is_s->count;
+        } else {
+            e = y;
+            if (IDX(state,grid,idx) & (G_LINEH|G_NOLINEV)) bl = true;
         }
+        idx += w;
+    }
+    if (s != -1) {
+        for (i = s; i <= e; i++)
+            INDEX(state, possv, x, i) = 0;
     }
+    state->solver->coldirty[x] = false;
+}
 
-    /* ...and now do horizontal stripes [un]setting possh. */
-    /* can we lose this clone'n'hack? */
-    for (y = 0; y < state->h; y++) {
-        idx = y*w;
-        s = e = -1;
-        bl = false;
-        maxb = state->params.maxb;     /* placate optimiser */
-        for (x = 0; x < state->w; x++) {
-            is_s = IDX(state, gridi, idx);
-            if (is_s) {
-                maxb = is_s->count;
-                break;
-            }
+/* can we lose this clone'n'hack? */
+static void map_update_possh(game_state *state, int y)
+{
+    int x, s, e, i, np, maxb, w = state->w, idx;
+    bool bl;
+    struct island *is_s = NULL, *is_f = NULL;
 
-            IDX(state, possh, idx) = 0;
-            idx += 1;
+    idx = y*w;
+    s = e = -1;
+    bl = false;
+    maxb = state->params.maxb;     /* placate optimiser */
+    for (x = 0; x < state->w; x++) {
+        is_s = IDX(state, gridi, idx);
+        if (is_s) {
+            maxb = is_s->count;
+            break;
         }
-        for (; x < state->w; x++) {
-            maxb = min(maxb, IDX(state, maxh, idx));
-            is_f = IDX(state, gridi, idx);
-            if (is_f) {
-                assert(is_s);
-                np = min(maxb, is_f->count);
 
-                if (s != -1) {
-                    for (i = s; i <= e; i++) {
-                        INDEX(state, possh, i, y) = bl ? 0 : np;
-                    }
+        IDX(state, possh, idx) = 0;
+        idx += 1;
+    }
+    for (; x < state->w; x++) {
+        maxb = min(maxb, IDX(state, maxh, idx));
+        is_f = IDX(state, gridi, idx);
+        if (is_f) {
+            assert(is_s);
+            np = min(maxb, is_f->count);
+
+            if (s != -1) {
+                for (i = s; i <= e; i++) {
+                    INDEX(state, possh, i, y) = bl ? 0 : np;
                 }
-                s = x+1;
-                bl = false;
-                is_s = is_f;
-                maxb = is_s->count;
-            } else {
-                e = x;
-                if (IDX(state,grid,idx) & (G_LINEV|G_NOLINEH)) bl = true;
             }
-            idx += 1;
-        }
-        if (s != -1) {
-            for (i = s; i <= e; i++)
-                INDEX(state, possh, i, y) = 0;
+            s = x+1;
+            bl = false;
+            is_s = is_f;
+            maxb = is_s->count;
+        } else {
+            e = x;
+            if (IDX(state,grid,idx) & (G_LINEV|G_NOLINEH)) bl = true;
         }
+        idx += 1;
+    }
+    if (s != -1) {
+        for (i = s; i <= e; i++)
+            INDEX(state, possh, i, y) = 0;
     }
+    state->solver->rowdirty[y] = false;
+}
+
+static void map_update_possibles(game_state *state)
+{
+    int x, y;
+
+    /* Run down vertical stripes [un]setting possv... */
+    for (x = 0; x < state->w; x++)
+        map_update_possv(state, x);
+
+    /* ...and now do horizontal stripes [un]setting possh. */
+    for (y = 0; y < state->h; y++)
+        map_update_possh(state, y);
+}
+
+/* Only valid when everything but solve_join has left the grid alone
+ * since the last map_update_possibles. */
+static void map_update_dirty_possibles(game_state *state)
+{
+    int x, y;
+
+    for (x = 0; x < state->w; x++)
+        if (state->solver->coldirty[x])
+            map_update_possv(state, x);
+    for (y = 0; y < state->h; y++)
+        if (state->solver->rowdirty[y])
+            map_update_possh(state, y);
 }
 
 static void map_count(game_state *state)
@@ -1267,7 +1302,7 @@ static void map_clear(game_state *state)
 static void solve_join(struct island *is, int direction, int n, bool is_max)
 {
     struct island *is_orth;
-    int d1, d2, *dsf = is->state->solver->dsf;
+    int d1, d2, i, *dsf = is->state->solver->dsf;
     game_state *state = is->state; /* for DINDEX */
 
     is_orth = INDEX(is->state, gridi,
@@ -1278,6 +1313,18 @@ static void solve_join(struct island *is, int direction, int n, bool is_max)
            is->x, is->y, is_orth->x, is_orth->y, n));*/
     island_join(is, is_orth, n, is_max);
 
+    /* The join's own line, and every line it crosses, need new
+     * possibles. */
+    if (is->x == is_orth->x) {
+        state->solver->coldirty[is->x] = true;
+        for (i = min(is->y, is_orth->y); i <= max(is->y, is_orth->y); i++)
+            state->solver->rowdirty[i] = true;
+    } else {
+        state->solver->rowdirty[is->y] = true;
+        for (i = min(is->x, is_orth->x); i <= max(is->x, is_orth->x); i++)
+            state->solver->coldirty[i] = true;
+    }
+
     if (n > 0 && !is_max) {
         d1 = DINDEX(is->x, is->y);
         d2 = DINDEX(is_orth->x, is_orth->y);
@@ -1372,7 +1419,7 @@ static bool solve_island_stage1(struct island *is, bool *didsth_r)
         }
     }
     if (didsth) {
-        map_update_possibles(is->state);
+        map_update_dirty_possibles(is->state);
         *didsth_r = true;
     }
     return true;
@@ -1418,7 +1465,7 @@ static bool solve_island_stage2(struct island *is, bool *didsth_r)
             debug(("removing possible loop at (%d,%d) direction %d.\n",
                    is->x, is->y, i));
             solve_join(is, i, -1, false);
-            map_update_possibles(is->state);
+            map_update_dirty_possibles(is->state);
             removed = true;
         } else {
             navail += island_isadj(is, i);
@@ -1449,7 +1496,7 @@ static bool solve_island_stage2(struct island *is, bool *didsth_r)
             }
         }
     }
-    if (added) map_update_possibles(is->state);
+    if (added) map_update_dirty_possibles(is->state);
     if (added || removed) *didsth_r = true;
     return true;
 }
@@ -1547,7 +1594,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
         memcpy(ss->tmpdsf, ss->dsf, wh*sizeof(int));
         for (n = curr+1; n <= curr+spc; n++) {
             solve_join(is, i, n, false);
-            map_update_possibles(is->state);
+            map_update_dirty_possibles(is->state);
 
             if (solve_island_subgroup(is, i) ||
                 solve_island_impossible(is->state)) {
@@ -1573,7 +1620,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
             }
             didsth = true;
         }
-        map_update_possibles(is->state);
+        map_update_dirty_possibles(is->state);
     }
 
     for (i = 0; i < is->adj.npoints; i++) {
@@ -1637,7 +1684,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
             if (j == i) continue;
             solve_join(is, j, before[j] + spc, false);
         }
-        map_update_possibles(is->state);
+        map_update_dirty_possibles(is->state);
 
         if (solve_island_subgroup(is, -1))
             got = true;
@@ -1654,7 +1701,7 @@ static bool solve_island_stage3(struct island *is, bool *didsth_r)
             didsth = true;
         }
 
-        map_update_possibles(is->state);
+        map_update_dirty_possibles(is->state);
     }
 
     if (didsth) *didsth_r = didsth;
@@ -1713,6 +1760,7 @@ static int solve_sub(game_state *state, int difficulty, int depth)
 static void solve_for_hint(game_state *state)
 {
     map_group(state);
+    map_update_possibles(state);
     solve_sub(state, 10, 0);
 }
 
@@ -1765,6 +1813,10 @@ static game_state *new_state(const game_params *params)
     ret->solver = snew(struct solver_state);
     ret->solver->dsf = snew_dsf(wh);
     ret->solver->tmpdsf = snewn(wh, int);
+    ret->solver->coldirty = snewn(ret->w, bool);
+    ret->solver->rowdirty = snewn(ret->h, bool);
+    memset(ret->solver->coldirty, 0, ret->w * sizeof(bool));
+    memset(ret->solver->rowdirty, 0, ret->h * sizeof(bool));
 
     ret->solver->refcount = 1;
 
@@ -1815,6 +1867,8 @@ static void free_game(game_state *state)
     if (--state->solver->refcount <= 0) {
         sfree(state->solver->dsf);
         sfree(state->solver->tmpdsf);
+        sfree(state->solver->coldirty);
+        sfree(state->solver->rowdirty);
         sfree(state->solver);
     }
 
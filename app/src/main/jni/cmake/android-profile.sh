@@ -0,0 +1,78 @@
+#!/bin/sh
+# Collect profile-guided optimisation data for one Android ABI, and
+# report what LTO+PGO does to libpuzzles.so's size and to generation
+# and solving speed.
+#
+#   cmake/android-profile.sh ABI [RUNS]
+#
+# Run from the jni directory, with ANDROID_NDK_HOME pointing at the
+# NDK and adb connected to a device or emulator that runs ABI. The
+# merged profile is written to profiles/ABI.profdata, which release
+# builds pick up when built with -PnativeLto.
+#
+# The profile covers generation (puzzles-bench over every preset) and
+# solving (puzzles-bench --solve over benchmarks/*.txt). Drawing code
+# only runs inside the app, so it is optimised without a profile.
+
+set -e
+
+abi=$1
+runs=${2:-5}
+if [ -z "$abi" ] || [ -z "$ANDROID_NDK_HOME" ]; then
+    echo "usage: ANDROID_NDK_HOME=... $0 ABI [RUNS]" >&2
+    exit 1
+fi
+
+bin=$(echo "$ANDROID_NDK_HOME"/toolchains/llvm/prebuilt/*/bin)
+remote=/data/local/tmp/puzzles-profile
+top=$(pwd)
+
+# Configure and build one flavour into build-profile/ABI-NAME.
+build() {
+    name=$1; shift
+    dir=build-profile/$abi-$name
+    cmake -S . -B "$dir" -DCMAKE_BUILD_TYPE=Release \
+        -DCMAKE_TOOLCHAIN_FILE="$ANDROID_NDK_HOME"/build/cmake/android.toolchain.cmake \
+        -DANDROID_ABI="$abi" -DANDROID_PLATFORM=android-19 "$@" >/dev/null
+    cmake --build "$dir" --target puzzles libpuzzlesbench.so >/dev/null
+}
+
+# Run puzzles-bench from one flavour on the device, with extra
+# environment settings given as arguments.
+run() {
+    name=$1; shift
+    adb push build-profile/$abi-$name/libpuzzlesbench.so $remote/bench >/dev/null
+    adb shell "cd $remote && $* ./bench -n $runs > gen-$name.csv &&
+               $* ./bench --solve -n $runs benchmarks/*.txt > solve-$name.csv"
+    adb pull $remote/gen-$name.csv $remote/solve-$name.csv \
+        build-profile/$abi-$name/ >/dev/null
+}
+
+adb shell "rm -rf $remote && mkdir -p $remote/benchmarks"
+adb push benchmarks/. $remote/benchmarks >/dev/null
+
+build instrumented -DPUZZLES_PROFILE=generate
+run instrumented LLVM_PROFILE_FILE=$remote/profraw/%p.profraw
+rm -rf build-profile/$abi-profraw
+adb pull $remote/profraw build-profile/$abi-profraw >/dev/null
+mkdir -p profiles
+"$bin"/llvm-profdata merge -o profiles/$abi.profdata \
+    build-profile/$abi-profraw/*.profraw
+
+build plain
+build optimised -DPUZZLES_LTO=ON -DPUZZLES_PROFILE="$top"/profiles
+run plain
+run optimised
+adb shell "rm -rf $remote"
+
+for name in plain optimised; do
+    dir=build-profile/$abi-$name
+    "$bin"/llvm-strip -o $dir/libpuzzles-stripped.so $dir/libpuzzles.so
+    # Total the mean_ms and ns_per_puzzle columns.
+    gen=$(awk -F, 'NR > 1 { t += $(NF-5) } END { printf "%.1f", t }' \
+          $dir/gen-$name.csv)
+    solve=$(awk -F, 'NR > 1 { t += $NF } END { printf "%.0f", t / 1e6 }' \
+            $dir/solve-$name.csv)
+    echo "$abi $name: $(wc -c < $dir/libpuzzles-stripped.so) bytes," \
+         "generation ${gen}ms, solving ${solve}ms (summed over presets)"
+done
@@ -3,10 +3,39 @@ set(build_individual_puzzles FALSE)
 set(build_cli_programs FALSE)
 set(build_gui_programs FALSE)
 
-add_compile_definitions(ANDROID COMBINED SMALL_SCREEN STYLUS_BASED NO_PRINTING VIVID_COLOURS)
+add_compile_definitions(ANDROID COMBINED SMALL_SCREEN STYLUS_BASED NO_PRINTING VIVID_COLOURS PARALLEL_GENERATION TRACE_SECTIONS)
 
 #set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -Wall -Wwrite-strings -std=c99 -pedantic -Werror")
 
+set(PUZZLES_LTO OFF
+  CACHE BOOL "Build with (thin) link-time optimisation")
+set(PUZZLES_PROFILE ""
+  CACHE STRING "Profile-guided optimisation: 'generate' to build \
+instrumented binaries, or a directory of <ABI>.profdata files to \
+optimise with")
+
+if(PUZZLES_LTO)
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -flto=thin")
+  set(CMAKE_SHARED_LINKER_FLAGS "${CMAKE_SHARED_LINKER_FLAGS} -flto=thin")
+  set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} -flto=thin")
+endif()
+
+# Profiles are collected by cmake/android-profile.sh, which runs
+# libpuzzlesbench.so (below) on a device of each ABI.
+if(PUZZLES_PROFILE STREQUAL "generate")
+  set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -fprofile-generate")
+  set(CMAKE_SHARED_LINKER_FLAGS "${CMAKE_SHARED_LINKER_FLAGS} -fprofile-generate")
+  set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} -fprofile-generate")
+elseif(PUZZLES_PROFILE)
+  set(profdata ${PUZZLES_PROFILE}/${ANDROID_ABI}.profdata)
+  if(EXISTS ${profdata})
+    set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -fprofile-use=${profdata} \
+-Wno-profile-instr-out-of-date -Wno-profile-instr-unprofiled")
+  else()
+    message(STATUS "No ${profdata}, building ${ANDROID_ABI} without PGO")
+  endif()
+endif()
+
 function(get_platform_puzzle_extra_source_files OUTVAR NAME)
   set(${OUTVAR} PARENT_SCOPE)
 endfunction()
@@ -22,8 +51,17 @@ function(build_platform_extras)
   add_library(puzzles SHARED list.c ${puzzle_sources})
   target_include_directories(puzzles PRIVATE ${generated_include_dir})
   target_link_libraries(puzzles common)
+  target_link_libraries(common dl)
 
   # Only executables with library-ish filenames are included in the APK and unpacked on devices
   add_executable(libpuzzlesgen.so "executable/android-gen.c")
   target_link_libraries(libpuzzlesgen.so puzzles)
+
+  # puzzles-bench, for collecting profiles and measuring the result
+  # on a device. Never built by default, so never packaged.
+  add_executable(libpuzzlesbench.so EXCLUDE_FROM_ALL benchmark.c
+    list.c ${puzzle_sources})
+  target_include_directories(libpuzzlesbench.so PRIVATE
+    ${generated_include_dir})
+  target_link_libraries(libpuzzlesbench.so common)
 endfunction()
@@ -1,7 +1,32 @@
 set(platform_common_sources emcc.c)
 set(platform_gui_libs)
 set(platform_libs)
-set(CMAKE_EXECUTABLE_SUFFIX ".js")
+# An opt-in flavour for browsers that can run it: WebAssembly SIMD lets
+# the compiler vectorise the bitset and solver loops, and threads let
+# generation race several seeds at once, as on Android. Threads need
+# SharedArrayBuffer, so the page must be served cross-origin isolated.
+# The flavour's files get their own suffix, so that both can be hosted
+# side by side and emccflavour.js can pick one.
+set(PUZZLES_WASM_SIMD OFF
+  CACHE BOOL "Build with WebAssembly SIMD (-msimd128)")
+set(PUZZLES_WASM_THREADS 0
+  CACHE STRING "Generate on up to this many WebAssembly threads \
+(0 for a single-threaded build)")
+
+set(emcc_flavour_flags)
+set(emcc_flavour)
+if(PUZZLES_WASM_SIMD)
+  set(emcc_flavour_flags "${emcc_flavour_flags} -msimd128")
+  set(emcc_flavour "${emcc_flavour}.simd")
+endif()
+if(PUZZLES_WASM_THREADS GREATER 0)
+  set(emcc_flavour_flags "${emcc_flavour_flags} -pthread")
+  add_compile_definitions(PARALLEL_GENERATION
+    WASM_GENERATION_THREADS=${PUZZLES_WASM_THREADS})
+  set(emcc_flavour "${emcc_flavour}.mt")
+endif()
+set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS}${emcc_flavour_flags}")
+set(CMAKE_EXECUTABLE_SUFFIX "${emcc_flavour}.js")
 
 set(emcc_export_list
   # Event handlers for mouse and keyboard input
@@ -32,7 +57,16 @@ string(JOIN "," emcc_export_string ${emcc_export_list})
 set(CMAKE_C_LINK_FLAGS "\
 -s ALLOW_MEMORY_GROWTH=1 \
 -s EXPORTED_FUNCTIONS='[${emcc_export_string}]' \
--s EXTRA_EXPORTED_RUNTIME_METHODS='[cwrap,callMain]'")
+-s EXTRA_EXPORTED_RUNTIME_METHODS='[cwrap,callMain]'${emcc_flavour_flags}")
+if(PUZZLES_WASM_THREADS GREATER 0)
+  # Losing generators are left to notice they've been cancelled, so
+  # keep enough workers spare that the next game's threads needn't
+  # wait for them: the main thread can't start a new worker while it
+  # is blocked waiting for a winner.
+  math(EXPR emcc_pool_size "${PUZZLES_WASM_THREADS} * 2")
+  set(CMAKE_C_LINK_FLAGS "${CMAKE_C_LINK_FLAGS} \
+-s PTHREAD_POOL_SIZE=${emcc_pool_size}")
+endif()
 
 set(build_cli_programs FALSE)
 set(build_gui_programs FALSE)
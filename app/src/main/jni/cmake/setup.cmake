@@ -40,6 +40,74 @@ if(NOT HAVE_STDINT_H)
   add_compile_definitions(NO_STDINT_H)
 endif()
 
+# Solo's Killer solver needs, for each cage size from 2 to 4 and each
+# clue, the list of ways to make that sum from distinct digits 1..9.
+# Work them out here and write them as constant arrays, so that no
+# process has to build them at startup. Each mask has bit N set if
+# digit N is in the sum, and lists come out in ascending order of
+# digits, which is the order the solver has always tried them in.
+function(write_solo_sums_header)
+  set(header ${CMAKE_BINARY_DIR}/include/solo-sums.h)
+  set(limit_2 18)
+  set(limit_3 25)
+  set(limit_4 31)
+  set(max_2 5)
+  set(max_3 8)
+  set(max_4 12)
+
+  foreach(a RANGE 1 9)
+    foreach(b RANGE 1 9)
+      if(b GREATER a)
+        math(EXPR sum "${a} + ${b}")
+        math(EXPR mask "(1 << ${a}) | (1 << ${b})")
+        list(APPEND sums_2_${sum} ${mask})
+        foreach(c RANGE 1 9)
+          if(c GREATER b)
+            math(EXPR sum "${a} + ${b} + ${c}")
+            math(EXPR mask "(1 << ${a}) | (1 << ${b}) | (1 << ${c})")
+            list(APPEND sums_3_${sum} ${mask})
+            foreach(d RANGE 1 9)
+              if(d GREATER c)
+                math(EXPR sum "${a} + ${b} + ${c} + ${d}")
+                math(EXPR mask
+                  "(1 << ${a}) | (1 << ${b}) | (1 << ${c}) | (1 << ${d})")
+                list(APPEND sums_4_${sum} ${mask})
+              endif()
+            endforeach()
+          endif()
+        endforeach()
+      endif()
+    endforeach()
+  endforeach()
+
+  set(text "/* Generated by write_solo_sums_header() in cmake/setup.cmake. */\n")
+  foreach(n 2 3 4)
+    math(EXPR last "${limit_${n}} - 1")
+    string(APPEND text "\nstatic const unsigned long "
+      "sum_bits${n}[${limit_${n}}][MAX_${n}SUMS] = {\n")
+    foreach(sum RANGE 0 ${last})
+      list(LENGTH sums_${n}_${sum} count)
+      if(count GREATER ${max_${n}})
+        message(FATAL_ERROR "${count} ways to make ${sum} from ${n} \
+digits, but MAX_${n}SUMS is ${max_${n}}")
+      endif()
+      if(count EQUAL 0)
+        string(APPEND text "    /* ${sum} */ {0},\n")
+      else()
+        string(REPLACE ";" ", " masks "${sums_${n}_${sum}}")
+        string(APPEND text "    /* ${sum} */ {${masks}},\n")
+      endif()
+    endforeach()
+    string(APPEND text "};\n")
+  endforeach()
+
+  file(MAKE_DIRECTORY ${CMAKE_BINARY_DIR}/include)
+  file(WRITE ${header} "${text}")
+endfunction()
+
+write_solo_sums_header()
+include_directories(${CMAKE_BINARY_DIR}/include)
+
 include(icons/icons.cmake)
 
 # The main function called from the top-level CMakeLists.txt to define
@@ -177,6 +245,18 @@ macro(build_extras)
     file(APPEND ${CMAKE_BINARY_DIR}/gamelist.txt "${name}\n")
   endforeach()
 
+  # Generation benchmark over the whole collection, which needs every
+  # puzzle linked into one binary.
+  if(build_cli_programs)
+    write_generated_games_header()
+    add_executable(puzzles-bench ${CMAKE_SOURCE_DIR}/benchmark.c
+      ${CMAKE_SOURCE_DIR}/list.c ${CMAKE_SOURCE_DIR}/nullfe.c
+      ${puzzle_sources})
+    target_compile_definitions(puzzles-bench PRIVATE COMBINED)
+    target_include_directories(puzzles-bench PRIVATE ${generated_include_dir})
+    target_link_libraries(puzzles-bench common ${platform_libs})
+  endif()
+
   # Further extra stuff specific to particular platforms.
   build_platform_extras()
 endmacro()
@@ -249,6 +249,96 @@ static bool addremcommon(int w, int h, int x, int y, int *own, int val)
     return (count == 2);
 }
 
+/*
+ * Work out which ominoes square yx could safely be added to, and
+ * whether it can safely be removed from its own omino. We don't
+ * take account of other ominoes in this process, so we will often
+ * end up knowing that a square can be poached from one omino by
+ * another.
+ *
+ * For each square, there may be up to four ominoes to which it can
+ * be added (those to which it is 4-adjacent).
+ *
+ * Everything computed here depends only on the ownership of the
+ * 3x3 block of squares centred on yx (and, for a singleton, on the
+ * size of its omino, which only changes when a square next to it
+ * joins it). So after changing the owner of a square, only its
+ * 3x3 neighbourhood needs recomputing.
+ */
+static void divvy_square(int w, int h, int yx, int *own, const int *sizes,
+                         bool *removable, int *addable)
+{
+    int x = yx % w, y = yx / w;
+    int curr = own[yx];
+    int dir;
+
+    if (curr < 0) {
+	removable[yx] = false;	       /* can't remove if not owned! */
+    } else if (sizes[curr] == 1) {
+	removable[yx] = true;	       /* can always remove a singleton */
+    } else {
+	/*
+	 * See if this square can be removed from its omino without
+	 * disconnecting it.
+	 */
+	removable[yx] = addremcommon(w, h, x, y, own, curr);
+    }
+
+    for (dir = 0; dir < 4; dir++) {
+	int dx = (dir == 0 ? -1 : dir == 1 ? +1 : 0);
+	int dy = (dir == 2 ? -1 : dir == 3 ? +1 : 0);
+	int sx = x + dx, sy = y + dy;
+	int syx = sy*w+sx;
+
+	addable[yx*4+dir] = -1;
+
+	if (sx < 0 || sx >= w || sy < 0 || sy >= h)
+	    continue;		       /* no omino here! */
+	if (own[syx] < 0)
+	    continue;		       /* also no omino here */
+	if (own[syx] == own[yx])
+	    continue;		       /* we already got one */
+	if (!addremcommon(w, h, x, y, own, own[syx]))
+	    continue;		       /* would non-simply connect the omino */
+
+	addable[yx*4+dir] = own[syx];
+    }
+}
+
+/*
+ * Recompute divvy_square for every square within one step
+ * (including diagonally) of any of the given squares.
+ */
+static void divvy_update(int w, int h, const int *changed, int nchanged,
+                         int *own, const int *sizes,
+                         bool *removable, int *addable)
+{
+    int i, dx, dy;
+
+    for (i = 0; i < nchanged; i++) {
+	int cx = changed[i] % w, cy = changed[i] / w;
+	for (dy = -1; dy <= +1; dy++)
+	    for (dx = -1; dx <= +1; dx++)
+		if (cx+dx >= 0 && cx+dx < w && cy+dy >= 0 && cy+dy < h)
+		    divvy_square(w, h, (cy+dy)*w+(cx+dx), own, sizes,
+				 removable, addable);
+    }
+}
+
+#ifdef TESTMODE
+static int fail_counter = 0, repair_counter = 0;
+#endif
+
+/*
+ * If extending an omino fails, we don't throw away the whole layout
+ * at once. Instead we shrink every omino the failed search reached
+ * back to a single square, which frees up space in the neighbourhood
+ * where things got stuck while leaving the rest of the grid alone,
+ * and carry on. Only after this many repairs do we give up and start
+ * again from scratch.
+ */
+#define MAX_REPAIRS 8
+
 /*
  * w and h are the dimensions of the rectangle.
  * 
@@ -262,10 +352,10 @@ static bool addremcommon(int w, int h, int x, int y, int *own, int val)
  */
 static int *divvy_internal(int w, int h, int k, random_state *rs)
 {
-    int *order, *queue, *tmp, *own, *sizes, *addable, *retdsf;
+    int *order, *queue, *tmp, *own, *sizes, *addable, *changed, *retdsf;
     bool *removable;
     int wh = w*h;
-    int i, j, n, x, y, qhead, qtail;
+    int i, j, n, x, y, qhead, qtail, nchanged, repairs = 0;
 
     n = wh / k;
     assert(wh == k*n);
@@ -277,6 +367,7 @@ static int *divvy_internal(int w, int h, int k, random_state *rs)
     queue = snewn(n, int);
     addable = snewn(wh*4, int);
     removable = snewn(wh, bool);
+    changed = snewn(n, int);
 
     /*
      * Permute the grid squares into a random order, which will be
@@ -299,6 +390,8 @@ static int *divvy_internal(int w, int h, int k, random_state *rs)
 	own[order[i]] = i;
 	sizes[i] = 1;
     }
+    for (i = 0; i < wh; i++)
+	divvy_square(w, h, i, own, sizes, removable, addable);
 
     /*
      * Now repeatedly pick a random omino which isn't already at
@@ -308,7 +401,8 @@ static int *divvy_internal(int w, int h, int k, random_state *rs)
      * square-stealing which terminates in an as yet unclaimed
      * square. Hence every successful iteration around this loop
      * causes the number of unclaimed squares to drop by one, and
-     * so the process is bounded in duration.
+     * so (with at most MAX_REPAIRS repairs undoing some of that)
+     * the process is bounded in duration.
      */
     while (1) {
 
@@ -324,57 +418,6 @@ static int *divvy_internal(int w, int h, int k, random_state *rs)
 	}
 #endif
 
-	/*
-	 * Go over the grid and figure out which squares can
-	 * safely be added to, or removed from, each omino. We
-	 * don't take account of other ominoes in this process, so
-	 * we will often end up knowing that a square can be
-	 * poached from one omino by another.
-	 * 
-	 * For each square, there may be up to four ominoes to
-	 * which it can be added (those to which it is
-	 * 4-adjacent).
-	 */
-	for (y = 0; y < h; y++) {
-	    for (x = 0; x < w; x++) {
-		int yx = y*w+x;
-		int curr = own[yx];
-		int dir;
-
-		if (curr < 0) {
-		    removable[yx] = false; /* can't remove if not owned! */
-		} else if (sizes[curr] == 1) {
-		    removable[yx] = true; /* can always remove a singleton */
-		} else {
-		    /*
-		     * See if this square can be removed from its
-		     * omino without disconnecting it.
-		     */
-		    removable[yx] = addremcommon(w, h, x, y, own, curr);
-		}
-
-		for (dir = 0; dir < 4; dir++) {
-		    int dx = (dir == 0 ? -1 : dir == 1 ? +1 : 0);
-		    int dy = (dir == 2 ? -1 : dir == 3 ? +1 : 0);
-		    int sx = x + dx, sy = y + dy;
-		    int syx = sy*w+sx;
-
-		    addable[yx*4+dir] = -1;
-
-		    if (sx < 0 || sx >= w || sy < 0 || sy >= h)
-			continue;      /* no omino here! */
-		    if (own[syx] < 0)
-			continue;      /* also no omino here */
-		    if (own[syx] == own[yx])
-			continue;      /* we already got one */
-		    if (!addremcommon(w, h, x, y, own, own[syx]))
-			continue;      /* would non-simply connect the omino */
-		    
-		    addable[yx*4+dir] = own[syx];
-		}
-	    }
-	}
-
 	for (i = j = 0; i < n; i++)
 	    if (sizes[i] < k)
 		tmp[j++] = i;
@@ -490,8 +533,11 @@ static int *divvy_internal(int w, int h, int k, random_state *rs)
 #ifdef DIVVY_DIAGNOSTICS
 		printf("(%d,%d)", i%w, i/w);
 #endif
+		nchanged = 0;
 		while (1) {
 		    own[i] = j;
+		    assert(nchanged < n);
+		    changed[nchanged++] = i;
 #ifdef DIVVY_DIAGNOSTICS
 		    printf(" -> %d", j);
 #endif
@@ -512,6 +558,9 @@ static int *divvy_internal(int w, int h, int k, random_state *rs)
 		 */
 		sizes[j]++;
 
+		divvy_update(w, h, changed, nchanged, own, sizes,
+			     removable, addable);
+
 		/*
 		 * Terminate the bfs loop.
 		 */
@@ -577,10 +626,36 @@ static int *divvy_internal(int w, int h, int k, random_state *rs)
 	if (qhead == qtail) {
 	    /*
 	     * We have finished the bfs and not found any way to
-	     * expand omino j. Panic, and return failure.
-	     * 
-	     * FIXME: or should we loop over all ominoes before we
-	     * give up?
+	     * expand omino j. Unless we've already tried repairing
+	     * too often, shrink every omino the bfs visited back to
+	     * the first of its squares in our random order, and
+	     * carry on from there.
+	     */
+	    if (repairs++ < MAX_REPAIRS) {
+#ifdef DIVVY_DIAGNOSTICS
+		printf("Repairing\n");
+#endif
+#ifdef TESTMODE
+		repair_counter++;
+#endif
+		for (i = 0; i < qtail; i++)
+		    sizes[queue[i]] = 0;
+		for (i = 0; i < wh; i++) {
+		    int o = own[order[i]];
+		    if (o < 0 || tmp[2*o] == -1)
+			continue;      /* not an omino we're shrinking */
+		    if (sizes[o] == 0)
+			sizes[o] = 1;
+		    else
+			own[order[i]] = -1;
+		}
+		for (i = 0; i < wh; i++)
+		    divvy_square(w, h, i, own, sizes, removable, addable);
+		continue;
+	    }
+
+	    /*
+	     * Panic, and return failure.
 	     */
 #ifdef DIVVY_DIAGNOSTICS
 	    printf("FAIL!\n");
@@ -645,6 +720,7 @@ static int *divvy_internal(int w, int h, int k, random_state *rs)
     sfree(queue);
     sfree(addable);
     sfree(removable);
+    sfree(changed);
 
     /*
      * And we're done.
@@ -652,10 +728,6 @@ static int *divvy_internal(int w, int h, int k, random_state *rs)
     return retdsf;
 }
 
-#ifdef TESTMODE
-static int fail_counter = 0;
-#endif
-
 int *divvy_rectangle(int w, int h, int k, random_state *rs)
 {
     int *ret;
@@ -681,6 +753,9 @@ int *divvy_rectangle(int w, int h, int k, random_state *rs)
  * or to debug
  * 
  * gcc -g -O0 -DDIVVY_DIAGNOSTICS -DTESTMODE -I.. -o divvy divvy.c ../random.c ../malloc.c ../dsf.c ../misc.c ../nullfe.c
+ *
+ * Usage: divvy [w [h [k [tries [quiet]]]]]. A nonzero `quiet' skips
+ * printing the layouts, leaving just the retry and repair counts.
  */
 
 int main(int argc, char **argv)
@@ -688,6 +763,7 @@ int main(int argc, char **argv)
     int *dsf;
     int i;
     int w = 9, h = 4, k = 6, tries = 100;
+    bool quiet = false;
     random_state *rs;
 
     rs = random_new("123456", 6);
@@ -700,12 +776,18 @@ int main(int argc, char **argv)
 	k = atoi(argv[3]);
     if (argc > 4)
 	tries = atoi(argv[4]);
+    if (argc > 5)
+	quiet = atoi(argv[5]);	       /* just report the counts, to benchmark */
 
     for (i = 0; i < tries; i++) {
 	int x, y;
 
 	dsf = divvy_rectangle(w, h, k, rs);
 	assert(dsf);
+	if (quiet) {
+	    sfree(dsf);
+	    continue;
+	}
 
 	for (y = 0; y <= 2*h; y++) {
 	    for (x = 0; x <= 2*w; x++) {
@@ -774,7 +856,8 @@ int main(int argc, char **argv)
 	sfree(dsf);
     }
 
-    printf("%d retries needed for %d successes\n", fail_counter, tries);
+    printf("%d retries and %d repairs needed for %d successes\n",
+	   fail_counter, repair_counter, tries);
 
     return 0;
 }
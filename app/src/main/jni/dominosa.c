@@ -261,6 +261,35 @@ bool solver_diagnostics = false;
 const bool solver_diagnostics = true;
 #endif
 
+#ifdef SOLVER_DIAGNOSTICS
+/*
+ * The deduction rules run_solver tries, in the order it tries them,
+ * with the difficulty level each one belongs to. Only used to keep
+ * count of how often each rule makes progress.
+ */
+#define RULELIST(X)                                                \
+    X(DOMINO_SINGLE_PLACEMENT, "domino_single_placement", TRIVIAL) \
+    X(SQUARE_SINGLE_PLACEMENT, "square_single_placement", TRIVIAL) \
+    X(SQUARE_SINGLE_DOMINO, "square_single_domino", BASIC)         \
+    X(DOMINO_MUST_OVERLAP, "domino_must_overlap", BASIC)           \
+    X(LOCAL_DUPLICATE, "local_duplicate", BASIC)                   \
+    X(LOCAL_DUPLICATE_2, "local_duplicate_2", BASIC)               \
+    X(PARITY, "parity", BASIC)                                     \
+    X(SET, "set", HARD)                                            \
+    X(SET_DOUBLES, "set_doubles", EXTREME)                         \
+    X(FORCING_CHAIN, "forcing_chain", EXTREME)                     \
+    /* end of list */
+#define RULE_ENUM(upper,name,diff) RULE_ ## upper,
+#define RULE_NAME(upper,name,diff) name,
+#define RULE_DIFF(upper,name,diff) DIFF_ ## diff,
+enum { RULELIST(RULE_ENUM) NRULES };
+static const char *const rule_names[] = { RULELIST(RULE_NAME) };
+static const int rule_diffs[] = { RULELIST(RULE_DIFF) };
+#define COUNT_RULE(sc, rule) ((sc)->rule_count[RULE_ ## rule]++)
+#else
+#define COUNT_RULE(sc, rule) ((void)0)
+#endif
+
 struct solver_domino;
 struct solver_placement;
 
@@ -344,6 +373,23 @@ struct solver_scratch {
     struct findloopstate *fls;
     bool squares_by_number_initialised;
     int *wh_scratch, *pc_scratch, *pc_scratch2, *dc_scratch;
+
+    /*
+     * Once deduce_forcing_chain has been used, pc_scratch holds the
+     * forcing chain id of every placement, and chain_todo lists the
+     * placements whose chain may have changed since. A chain only
+     * changes when one of its squares drops to two placements or
+     * fewer, so rule_out_placement adds the remaining placements of
+     * such a square. chain_stamp and chain_round mark the placements
+     * already recomputed in the current update.
+     */
+    tdq *chain_todo;
+    int *chain_stamp, chain_round;
+
+#ifdef SOLVER_DIAGNOSTICS
+    /* Number of times each deduction rule has made progress. */
+    int rule_count[NRULES];
+#endif
 };
 
 static struct solver_scratch *solver_make_scratch(int n)
@@ -475,6 +521,16 @@ static struct solver_scratch *solver_make_scratch(int n)
     sc->wh_scratch = NULL;
     sc->pc_scratch = sc->pc_scratch2 = NULL;
     sc->dc_scratch = NULL;
+    sc->chain_todo = NULL;
+    sc->chain_stamp = NULL;
+
+#ifdef SOLVER_DIAGNOSTICS
+    {
+        int i;
+        for (i = 0; i < NRULES; i++)
+            sc->rule_count[i] = 0;
+    }
+#endif
 
     return sc;
 }
@@ -502,6 +558,9 @@ static void solver_free_scratch(struct solver_scratch *sc)
     sfree(sc->pc_scratch);
     sfree(sc->pc_scratch2);
     sfree(sc->dc_scratch);
+    if (sc->chain_todo)
+        tdq_free(sc->chain_todo);
+    sfree(sc->chain_stamp);
     sfree(sc);
 }
 
@@ -549,6 +608,8 @@ static void solver_setup_grid(struct solver_scratch *sc, const int *numbers)
 
     sc->max_diff_used = DIFF_TRIVIAL;
     sc->squares_by_number_initialised = false;
+    if (sc->chain_todo)
+        tdq_fill(sc->chain_todo);
 }
 
 /* Given two placements p,q that overlap, returns si such that
@@ -581,6 +642,8 @@ static void rule_out_placement(
 #endif
 
     p->active = false;
+    if (sc->chain_todo)
+        tdq_add(sc->chain_todo, p->index);
 
     i = p->dpi;
     assert(d->placements[i] == p);
@@ -598,6 +661,9 @@ static void rule_out_placement(
             j = (sq->placements[i]->squares[0] == sq ? 0 : 1);
             sq->placements[i]->spi[j] = i;
         }
+        if (sc->chain_todo && sq->nplacements <= 2)
+            for (i = 0; i < sq->nplacements; i++)
+                tdq_add(sc->chain_todo, sq->placements[i]->index);
     }
 }
 
@@ -1405,90 +1471,131 @@ static int forcing_chain_sq_cmp(const void *av, const void *bv, void *ctx)
     return 0;
 }
 
-static bool deduce_forcing_chain(struct solver_scratch *sc)
+/*
+ * Bring the forcing chains in pc_scratch up to date, by recomputing
+ * the chain containing every placement on the chain_todo list. The
+ * result is the same as computing every chain from scratch would
+ * give: a chain's id is twice the lowest placement index in its
+ * connected set of placements, plus 1 for the half that doesn't
+ * contain that placement, which is exactly what the edsf this used
+ * to be built from would have said.
+ *
+ * Only a recomputed chain can have come to contain a duplicated
+ * domino, so this is also where such chains are found and ruled
+ * out. If that happens, return true, and the next call will pick up
+ * the chains the rule-outs have changed.
+ */
+static bool update_forcing_chains(struct solver_scratch *sc)
 {
-    int si, pi, di, j, k, m;
+    int pi, j, k, n, ndup = 0;
     bool done_something = false;
 
-    if (!sc->wh_scratch)
-        sc->wh_scratch = snewn(sc->wh, int);
-    if (!sc->pc_scratch)
-        sc->pc_scratch = snewn(sc->pc, int);
-    if (!sc->pc_scratch2)
-        sc->pc_scratch2 = snewn(sc->pc, int);
-    if (!sc->dc_scratch)
-        sc->dc_scratch = snewn(sc->dc, int);
-
-    /*
-     * Start by identifying chains of placements which must all occur
-     * together if any of them occurs. We do this by making
-     * pc_scratch2 an edsf binding the placements into an equivalence
-     * class for each entire forcing chain, with the two possible sets
-     * of dominoes for the chain listed as inverses.
-     */
-    dsf_init(sc->pc_scratch2, sc->pc);
-    for (si = 0; si < sc->wh; si++) {
-        struct solver_square *sq = &sc->squares[si];
-        if (sq->nplacements == 2)
-            edsf_merge(sc->pc_scratch2,
-                       sq->placements[0]->index,
-                       sq->placements[1]->index, true);
-    }
-    /*
-     * Now read out the whole dsf into pc_scratch, flattening its
-     * structured data into a simple integer id per chain of dominoes
-     * that must occur together.
-     *
-     * The integer ids have the property that any two that differ only
-     * in the lowest bit (i.e. of the form {2n,2n+1}) represent
-     * complementary chains, each of which rules out the other.
-     */
-    for (pi = 0; pi < sc->pc; pi++) {
-        bool inv;
-        int c = edsf_canonify(sc->pc_scratch2, pi, &inv);
-        sc->pc_scratch[pi] = c * 2 + (inv ? 1 : 0);
-    }
+    sc->chain_round++;
 
-    /*
-     * Identify chains that contain a duplicate domino, and rule them
-     * out. We do this by making a list of the placement indices in
-     * pc_scratch2, sorted by (chain id, domino id), so that dupes
-     * become adjacent.
-     */
-    for (pi = 0; pi < sc->pc; pi++)
-        sc->pc_scratch2[pi] = pi;
-    arraysort(sc->pc_scratch2, sc->pc, forcing_chain_dup_cmp, sc);
+    while ((pi = tdq_remove(sc->chain_todo)) >= 0) {
+        int root, rootpar;
 
-    for (j = 0; j < sc->pc ;) {
-        struct solver_domino *duplicated_domino = NULL;
+        if (sc->chain_stamp[pi] == sc->chain_round)
+            continue;                  /* already redone this time */
 
         /*
-         * This loop iterates once per contiguous segment of the same
-         * value in pc_scratch2, i.e. once per chain.
+         * Find every placement connected to this one by a square
+         * with only two placements left, listing them in pc_scratch2
+         * and temporarily using pc_scratch for each one's parity
+         * relative to the first.
          */
-        int ci = sc->pc_scratch[sc->pc_scratch2[j]];
-        int climit, cstart = j;
-        while (j < sc->pc && sc->pc_scratch[sc->pc_scratch2[j]] == ci)
-            j++;
-        climit = j;
+        sc->pc_scratch2[0] = pi;
+        sc->pc_scratch[pi] = 0;
+        sc->chain_stamp[pi] = sc->chain_round;
+        root = pi;
+        for (n = 1, j = 0; j < n; j++) {
+            struct solver_placement *p = &sc->placements[sc->pc_scratch2[j]];
+            int si;
+
+            if (p->index < root)
+                root = p->index;
+            if (!p->active)
+                continue;      /* would be a singleton chain anyway */
+
+            for (si = 0; si < 2; si++) {
+                struct solver_square *sq = p->squares[si];
+                struct solver_placement *q;
+
+                if (sq->nplacements != 2)
+                    continue;
+                q = sq->placements[sq->placements[0] == p ? 1 : 0];
+                if (sc->chain_stamp[q->index] != sc->chain_round) {
+                    sc->chain_stamp[q->index] = sc->chain_round;
+                    sc->pc_scratch[q->index] = sc->pc_scratch[p->index] ^ 1;
+                    sc->pc_scratch2[n++] = q->index;
+                } else {
+                    assert(sc->pc_scratch[q->index] ==
+                           (sc->pc_scratch[p->index] ^ 1));
+                }
+            }
+        }
+
+        rootpar = sc->pc_scratch[root];
+        for (j = 0; j < n; j++) {
+            int qi = sc->pc_scratch2[j];
+            sc->pc_scratch[qi] = root * 2 + (sc->pc_scratch[qi] ^ rootpar);
+        }
 
         /*
-         * Now look for a duplicate domino within that chain.
+         * Look for a duplicate domino in either half of the chain,
+         * by sorting the placements by (chain id, domino id) so that
+         * dupes become adjacent. Note each half we find one in.
          */
-        for (k = cstart; k + 1 < climit; k++) {
-            struct solver_placement *p = &sc->placements[sc->pc_scratch2[k]];
-            struct solver_placement *q = &sc->placements[sc->pc_scratch2[k+1]];
-            if (p->domino == q->domino) {
-                duplicated_domino = p->domino;
-                break;
+        if (n < 3)
+            continue;
+        arraysort(sc->pc_scratch2, n, forcing_chain_dup_cmp, sc);
+        for (j = 0; j + 1 < n; j++) {
+            struct solver_placement *p = &sc->placements[sc->pc_scratch2[j]];
+            struct solver_placement *q = &sc->placements[sc->pc_scratch2[j+1]];
+            int ci = sc->pc_scratch[p->index];
+            if (p->domino == q->domino && ci == sc->pc_scratch[q->index] &&
+                (ndup == 0 || sc->wh_scratch[ndup-1] != ci)) {
+                assert(ndup < sc->wh);
+                sc->wh_scratch[ndup++] = ci;
             }
         }
+    }
 
-        if (!duplicated_domino)
-            continue;
+    if (ndup == 0)
+        return false;
+
+    /*
+     * Rule out the chains containing a duplicate, in order of chain
+     * id and then domino id.
+     */
+    for (pi = n = 0; pi < sc->pc; pi++)
+        for (k = 0; k < ndup; k++)
+            if (sc->pc_scratch[pi] == sc->wh_scratch[k]) {
+                sc->pc_scratch2[n++] = pi;
+                break;
+            }
+    arraysort(sc->pc_scratch2, n, forcing_chain_dup_cmp, sc);
+
+    for (j = 0; j < n ;) {
+        int ci = sc->pc_scratch[sc->pc_scratch2[j]];
+        int climit, cstart = j;
+        while (j < n && sc->pc_scratch[sc->pc_scratch2[j]] == ci)
+            j++;
+        climit = j;
 
 #ifdef SOLVER_DIAGNOSTICS
         if (solver_diagnostics) {
+            struct solver_domino *duplicated_domino = NULL;
+            for (k = cstart; k + 1 < climit; k++) {
+                struct solver_placement *p =
+                    &sc->placements[sc->pc_scratch2[k]];
+                struct solver_placement *q =
+                    &sc->placements[sc->pc_scratch2[k+1]];
+                if (p->domino == q->domino) {
+                    duplicated_domino = p->domino;
+                    break;
+                }
+            }
             printf("domino %s occurs more than once in forced chain:",
                    duplicated_domino->name);
             for (k = cstart; k < climit; k++)
@@ -1503,7 +1610,42 @@ static bool deduce_forcing_chain(struct solver_scratch *sc)
         done_something = true;
     }
 
-    if (done_something)
+    return done_something;
+}
+
+static bool deduce_forcing_chain(struct solver_scratch *sc)
+{
+    int si, pi, di, j, k, m;
+    bool done_something = false;
+
+    if (!sc->wh_scratch)
+        sc->wh_scratch = snewn(sc->wh, int);
+    if (!sc->pc_scratch)
+        sc->pc_scratch = snewn(sc->pc, int);
+    if (!sc->pc_scratch2)
+        sc->pc_scratch2 = snewn(sc->pc, int);
+    if (!sc->dc_scratch)
+        sc->dc_scratch = snewn(sc->dc + 1, int);
+    if (!sc->chain_todo) {
+        sc->chain_todo = tdq_new(sc->pc);
+        tdq_fill(sc->chain_todo);
+        sc->chain_stamp = snewn(sc->pc, int);
+        for (pi = 0; pi < sc->pc; pi++)
+            sc->chain_stamp[pi] = 0;
+        sc->chain_round = 0;
+    }
+
+    /*
+     * Chains of placements must all occur together if any of them
+     * occurs, because each consecutive pair shares a square with no
+     * other placement left. Each chain comes with a complementary
+     * chain that has to occur if it doesn't: they have ids of the
+     * form {2n,2n+1}, and each rules out the other.
+     *
+     * One way to rule out a whole chain is if it contains the same
+     * domino twice, which update_forcing_chains checks for as it goes.
+     */
+    if (update_forcing_chains(sc))
         return true;
 
     /*
@@ -1512,25 +1654,21 @@ static bool deduce_forcing_chain(struct solver_scratch *sc)
      * square, so that if the domnioes in the chain were all laid, the
      * other square would be left without any choices.
      *
-     * To detect this, we sort the placements again, this time by
-     * (domino index, chain index), so that we can easily find a
-     * sorted list of chains per domino. That allows us to iterate
-     * over the squares and check for a chain id common to all the
-     * placements of that square.
+     * To detect this, we list each domino's placements sorted by
+     * chain index in pc_scratch2, with dc_scratch pointing at the
+     * start of each domino's list. That allows us to iterate over the
+     * squares and check for a chain id common to all the placements
+     * of that square.
      */
-    for (pi = 0; pi < sc->pc; pi++)
-        sc->pc_scratch2[pi] = pi;
-    arraysort(sc->pc_scratch2, sc->pc, forcing_chain_sq_cmp, sc);
-
-    /* Store a lookup table of the first entry in pc_scratch2
-     * corresponding to each domino. */
-    for (di = j = 0; j < sc->pc; j++) {
-        while (di <= sc->placements[sc->pc_scratch2[j]].domino->index) {
-            assert(di < sc->dc);
-            sc->dc_scratch[di++] = j;
-        }
+    for (di = j = 0; di < sc->dc; di++) {
+        struct solver_domino *d = &sc->dominoes[di];
+        sc->dc_scratch[di] = j;
+        for (k = 0; k < d->nplacements; k++)
+            sc->pc_scratch2[j++] = d->placements[k]->index;
+        arraysort(sc->pc_scratch2 + sc->dc_scratch[di], d->nplacements,
+                  forcing_chain_sq_cmp, sc);
     }
-    assert(di == sc->dc);
+    sc->dc_scratch[di] = j;
 
     for (si = 0; si < sc->wh; si++) {
         struct solver_square *sq = &sc->squares[si];
@@ -1557,8 +1695,7 @@ static bool deduce_forcing_chain(struct solver_scratch *sc)
             listout = listpos = 0;
 
             for (k = sc->dc_scratch[d->index];
-                 k < sc->pc && sc->placements[sc->pc_scratch2[k]].domino == d;
-                 k++) {
+                 k < sc->dc_scratch[d->index + 1]; k++) {
                 int chain = sc->pc_scratch[sc->pc_scratch2[k]];
                 bool keep;
 
@@ -1706,16 +1843,20 @@ static int run_solver(struct solver_scratch *sc, int max_diff_allowed)
         done_something = false;
 
         for (di = 0; di < sc->dc; di++)
-            if (deduce_domino_single_placement(sc, di))
+            if (deduce_domino_single_placement(sc, di)) {
+                COUNT_RULE(sc, DOMINO_SINGLE_PLACEMENT);
                 done_something = true;
+            }
         if (done_something) {
             sc->max_diff_used = max(sc->max_diff_used, DIFF_TRIVIAL);
             continue;
         }
 
         for (si = 0; si < sc->wh; si++)
-            if (deduce_square_single_placement(sc, si))
+            if (deduce_square_single_placement(sc, si)) {
+                COUNT_RULE(sc, SQUARE_SINGLE_PLACEMENT);
                 done_something = true;
+            }
         if (done_something) {
             sc->max_diff_used = max(sc->max_diff_used, DIFF_TRIVIAL);
             continue;
@@ -1725,39 +1866,49 @@ static int run_solver(struct solver_scratch *sc, int max_diff_allowed)
             continue;
 
         for (si = 0; si < sc->wh; si++)
-            if (deduce_square_single_domino(sc, si))
+            if (deduce_square_single_domino(sc, si)) {
+                COUNT_RULE(sc, SQUARE_SINGLE_DOMINO);
                 done_something = true;
+            }
         if (done_something) {
             sc->max_diff_used = max(sc->max_diff_used, DIFF_BASIC);
             continue;
         }
 
         for (di = 0; di < sc->dc; di++)
-            if (deduce_domino_must_overlap(sc, di))
+            if (deduce_domino_must_overlap(sc, di)) {
+                COUNT_RULE(sc, DOMINO_MUST_OVERLAP);
                 done_something = true;
+            }
         if (done_something) {
             sc->max_diff_used = max(sc->max_diff_used, DIFF_BASIC);
             continue;
         }
 
         for (pi = 0; pi < sc->pc; pi++)
-            if (deduce_local_duplicate(sc, pi))
+            if (deduce_local_duplicate(sc, pi)) {
+                COUNT_RULE(sc, LOCAL_DUPLICATE);
                 done_something = true;
+            }
         if (done_something) {
             sc->max_diff_used = max(sc->max_diff_used, DIFF_BASIC);
             continue;
         }
 
         for (pi = 0; pi < sc->pc; pi++)
-            if (deduce_local_duplicate_2(sc, pi))
+            if (deduce_local_duplicate_2(sc, pi)) {
+                COUNT_RULE(sc, LOCAL_DUPLICATE_2);
                 done_something = true;
+            }
         if (done_something) {
             sc->max_diff_used = max(sc->max_diff_used, DIFF_BASIC);
             continue;
         }
 
-        if (deduce_parity(sc))
+        if (deduce_parity(sc)) {
+            COUNT_RULE(sc, PARITY);
             done_something = true;
+        }
         if (done_something) {
             sc->max_diff_used = max(sc->max_diff_used, DIFF_BASIC);
             continue;
@@ -1766,8 +1917,10 @@ static int run_solver(struct solver_scratch *sc, int max_diff_allowed)
         if (max_diff_allowed <= DIFF_BASIC)
             continue;
 
-        if (deduce_set(sc, false))
+        if (deduce_set(sc, false)) {
+            COUNT_RULE(sc, SET);
             done_something = true;
+        }
         if (done_something) {
             sc->max_diff_used = max(sc->max_diff_used, DIFF_HARD);
             continue;
@@ -1776,15 +1929,19 @@ static int run_solver(struct solver_scratch *sc, int max_diff_allowed)
         if (max_diff_allowed <= DIFF_HARD)
             continue;
 
-        if (deduce_set(sc, true))
+        if (deduce_set(sc, true)) {
+            COUNT_RULE(sc, SET_DOUBLES);
             done_something = true;
+        }
         if (done_something) {
             sc->max_diff_used = max(sc->max_diff_used, DIFF_EXTREME);
             continue;
         }
 
-        if (deduce_forcing_chain(sc))
+        if (deduce_forcing_chain(sc)) {
+            COUNT_RULE(sc, FORCING_CHAIN);
             done_something = true;
+        }
         if (done_something) {
             sc->max_diff_used = max(sc->max_diff_used, DIFF_EXTREME);
             continue;
@@ -2272,6 +2429,12 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      */
 
     while (1) {
+        if (random_cancelled(rs)) {
+            solver_free_scratch(sc);
+            alloc_free_scratch(as);
+            return NULL;
+        }
+
         alloc_make_layout(as, rs);
 
         if (diff == DIFF_AMBIGUOUS) {
@@ -3551,7 +3714,7 @@ const struct game thegame = {
 #endif
     false,			       /* wants_statusbar */
     false, game_timing_state,
-    0,				       /* flags */
+    PARALLEL_NEW_DESC,		       /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -3563,7 +3726,7 @@ int main(int argc, char **argv)
     char *id = NULL, *desc;
     int maxdiff = DIFFCOUNT;
     const char *err;
-    bool grade = false, diagnostics = false;
+    bool grade = false, diagnostics = false, stats = false;
     struct solver_scratch *sc;
     int retd;
 
@@ -3573,6 +3736,8 @@ int main(int argc, char **argv)
             diagnostics = true;
         } else if (!strcmp(p, "-g")) {
             grade = true;
+        } else if (!strcmp(p, "-s")) {
+            stats = true;
         } else if (!strncmp(p, "-d", 2) && p[2] && !p[3]) {
             int i;
             bool bad = true;
@@ -3597,7 +3762,7 @@ int main(int argc, char **argv)
     }
 
     if (!id) {
-        fprintf(stderr, "usage: %s [-v | -g] <game_id>\n", argv[0]);
+        fprintf(stderr, "usage: %s [-v | -g] [-s] <game_id>\n", argv[0]);
         return 1;
     }
 
@@ -3638,6 +3803,13 @@ int main(int argc, char **argv)
         if (retd > 1)
             printf("Could not deduce a unique solution\n");
     }
+    if (stats) {
+        int i;
+        printf("Deductions made by each rule:\n");
+        for (i = 0; i < NRULES; i++)
+            printf("  %-24s %-8s %d\n", rule_names[i],
+                   dominosa_diffnames[rule_diffs[i]], sc->rule_count[i]);
+    }
     solver_free_scratch(sc);
     free_game(s);
     free_params(p);
@@ -0,0 +1,47 @@
+/*
+ * drawcmd.h: the draw-command buffer format shared by the front ends
+ * whose drawing happens on the other side of a language boundary
+ * (Java for Android, Javascript for the web).
+ *
+ * Rather than crossing the boundary once per primitive, these front
+ * ends append each one to a buffer of native-order 32-bit ints, which
+ * the other side replays in a single call. Each command is an op
+ * followed by the fields listed against it. Floats are stored as their
+ * bit patterns, and colours as indices into the puzzle's colour list,
+ * with -1 meaning no fill. How a TEXT command refers to its string is
+ * up to the front end.
+ */
+
+#ifndef DRAWCMD_H
+#define DRAWCMD_H
+
+#include <stdint.h>
+#include <string.h>
+
+enum {
+    DRAW_OP_RECT = 1,   /* x, y, w, h, colour */
+    DRAW_OP_LINE,       /* thickness, x1, y1, x2, y2 (floats), colour */
+    DRAW_OP_POLY,       /* thickness (float), npoints, ox, oy, outline,
+                         * fill, coords... */
+    DRAW_OP_CIRCLE,     /* thickness, cx, cy, radius (floats), outline,
+                         * fill */
+    DRAW_OP_TEXT,       /* x, y, flags, size, colour, string */
+    DRAW_OP_CLIP,       /* x, y, w, h */
+    DRAW_OP_UNCLIP,     /* marginX, marginY */
+    /* The web front end also batches these, which Android does not. */
+    DRAW_OP_UPDATE,     /* x, y, w, h */
+    DRAW_OP_BLITTER_SAVE, /* id, x, y, w, h */
+    DRAW_OP_BLITTER_LOAD, /* id, x, y, w, h */
+};
+
+/* TEXT flags: the ALIGN_* bits, plus this for FONT_FIXED. */
+#define DRAW_TEXT_FIXED 0x10
+
+static inline int32_t drawcmd_float(float f)
+{
+    int32_t ret;
+    memcpy(&ret, &f, sizeof(ret));
+    return ret;
+}
+
+#endif /* DRAWCMD_H */
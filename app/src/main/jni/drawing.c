@@ -5,7 +5,9 @@
  * 
  * Mostly just looks up calls in a vtable and passes them through
  * unchanged. However, on the printing side it tracks print colours
- * so the front end API doesn't have to.
+ * so the front end API doesn't have to, and it holds back each
+ * draw_rect briefly so that runs of rectangles can be coalesced
+ * (see draw_rect).
  * 
  * FIXME:
  * 
@@ -48,8 +50,27 @@ struct drawing {
      * this may set it to NULL. */
     midend *me;
     char *laststatus;
+    /* Whether anything has been drawn since start_draw. */
+    bool drawn;
+    /* A draw_rect not yet passed on, if rect_pending. */
+    bool coalesce, rect_pending;
+    int rx, ry, rw, rh, rcolour;
 };
 
+/*
+ * Pass on any held-back rectangle. Everything that draws, reads the
+ * drawing or changes how later drawing behaves does this first, so
+ * the front end sees primitives in their original order.
+ */
+static void flush_rect(drawing *dr)
+{
+    if (dr->rect_pending) {
+        dr->rect_pending = false;
+        dr->api->draw_rect(dr->handle, dr->rx, dr->ry, dr->rw, dr->rh,
+                           dr->rcolour);
+    }
+}
+
 drawing *drawing_new(const drawing_api *api, midend *me, void *handle)
 {
     drawing *dr = snew(drawing);
@@ -60,9 +81,18 @@ drawing *drawing_new(const drawing_api *api, midend *me, void *handle)
     dr->scale = 1.0F;
     dr->me = me;
     dr->laststatus = NULL;
+    dr->drawn = false;
+    dr->coalesce = true;
+    dr->rect_pending = false;
     return dr;
 }
 
+void drawing_set_coalescing(drawing *dr, bool coalesce)
+{
+    flush_rect(dr);
+    dr->coalesce = coalesce;
+}
+
 void drawing_free(drawing *dr)
 {
     sfree(dr->laststatus);
@@ -73,23 +103,74 @@ void drawing_free(drawing *dr)
 void draw_text(drawing *dr, int x, int y, int fonttype, int fontsize,
                int align, int colour, const char *text)
 {
+    flush_rect(dr);
+    dr->drawn = true;
     dr->api->draw_text(dr->handle, x, y, fonttype, fontsize, align,
 		       colour, text);
 }
 
+/*
+ * Rectangles are axis-aligned and unantialiased in every front end,
+ * so a few rewrites leave the pixels exactly as they were: a
+ * rectangle covered by the next one can be dropped, whatever its
+ * colour; one of the same colour inside the last can be dropped;
+ * and same-coloured neighbours sharing a whole edge become one
+ * rectangle. Backends emit runs like this when filling grids cell
+ * by cell. Only one rectangle is held back, so this costs nothing
+ * when there's nothing to merge.
+ */
 void draw_rect(drawing *dr, int x, int y, int w, int h, int colour)
 {
-    dr->api->draw_rect(dr->handle, x, y, w, h, colour);
+    dr->drawn = true;
+    if (!dr->coalesce || w <= 0 || h <= 0) {
+        flush_rect(dr);
+        dr->api->draw_rect(dr->handle, x, y, w, h, colour);
+        return;
+    }
+
+    if (dr->rect_pending) {
+        int rx = dr->rx, ry = dr->ry, rw = dr->rw, rh = dr->rh;
+
+        if (x <= rx && y <= ry && x + w >= rx + rw && y + h >= ry + rh) {
+            /* The new rectangle hides the held one; replace it. */
+        } else if (colour != dr->rcolour) {
+            flush_rect(dr);
+        } else if (rx <= x && ry <= y &&
+                   rx + rw >= x + w && ry + rh >= y + h) {
+            return;                    /* nothing new to draw */
+        } else if (y == ry && h == rh && x <= rx + rw && rx <= x + w) {
+            dr->rw = max(rx + rw, x + w) - min(rx, x);
+            dr->rx = min(rx, x);
+            return;
+        } else if (x == rx && w == rw && y <= ry + rh && ry <= y + h) {
+            dr->rh = max(ry + rh, y + h) - min(ry, y);
+            dr->ry = min(ry, y);
+            return;
+        } else {
+            flush_rect(dr);
+        }
+    }
+
+    dr->rect_pending = true;
+    dr->rx = x;
+    dr->ry = y;
+    dr->rw = w;
+    dr->rh = h;
+    dr->rcolour = colour;
 }
 
 void draw_line(drawing *dr, int x1, int y1, int x2, int y2, int colour)
 {
+    flush_rect(dr);
+    dr->drawn = true;
     dr->api->draw_line(dr->handle, x1, y1, x2, y2, colour);
 }
 
 void draw_thick_line(drawing *dr, float thickness,
 		     float x1, float y1, float x2, float y2, int colour)
 {
+    flush_rect(dr);
+    dr->drawn = true;
     if (thickness < 1.0)
         thickness = 1.0;
     if (dr->api->draw_thick_line) {
@@ -120,6 +201,8 @@ void draw_thick_line(drawing *dr, float thickness,
 void draw_polygon(drawing *dr, const int *coords, int npoints,
                   int fillcolour, int outlinecolour)
 {
+    flush_rect(dr);
+    dr->drawn = true;
     dr->api->draw_polygon(dr->handle, coords, npoints, fillcolour,
 			  outlinecolour);
 }
@@ -127,6 +210,8 @@ void draw_polygon(drawing *dr, const int *coords, int npoints,
 void draw_thick_polygon(drawing *dr, float thickness, int *coords, int npoints,
                   int fillcolour, int outlinecolour)
 {
+    flush_rect(dr);
+    dr->drawn = true;
     dr->api->draw_thick_polygon(dr->handle, thickness, coords, npoints, fillcolour,
 			  outlinecolour);
 }
@@ -134,6 +219,8 @@ void draw_thick_polygon(drawing *dr, float thickness, int *coords, int npoints,
 void draw_circle(drawing *dr, int cx, int cy, int radius,
                  int fillcolour, int outlinecolour)
 {
+    flush_rect(dr);
+    dr->drawn = true;
     dr->api->draw_circle(dr->handle, cx, cy, radius, fillcolour,
 			 outlinecolour);
 }
@@ -141,34 +228,50 @@ void draw_circle(drawing *dr, int cx, int cy, int radius,
 void draw_thick_circle(drawing *dr, float thickness, float cx, float cy, float radius,
                  int fillcolour, int outlinecolour)
 {
+    flush_rect(dr);
+    dr->drawn = true;
     dr->api->draw_thick_circle(dr->handle, thickness, cx, cy, radius, fillcolour,
 			 outlinecolour);
 }
 
 void draw_update(drawing *dr, int x, int y, int w, int h)
 {
+    flush_rect(dr);
+    dr->drawn = true;
     if (dr->api->draw_update)
 	dr->api->draw_update(dr->handle, x, y, w, h);
 }
 
 void clip(drawing *dr, int x, int y, int w, int h)
 {
+    flush_rect(dr);
     dr->api->clip(dr->handle, x, y, w, h);
 }
 
 void unclip(drawing *dr)
 {
+    flush_rect(dr);
     dr->api->unclip(dr->handle);
 }
 
 void start_draw(drawing *dr)
 {
+    dr->drawn = false;
     dr->api->start_draw(dr->handle);
 }
 
 void end_draw(drawing *dr)
 {
-    dr->api->end_draw(dr->handle);
+    flush_rect(dr);
+    /*
+     * Backends with a drawstate often redraw nothing at all, e.g. on
+     * a timer tick with a static board. Front ends that repaint at
+     * end_draw can skip that if they provide end_draw_unchanged.
+     */
+    if (!dr->drawn && dr->api->end_draw_unchanged)
+        dr->api->end_draw_unchanged(dr->handle);
+    else
+        dr->api->end_draw(dr->handle);
 }
 
 char *text_fallback(drawing *dr, const char *const *strings, int nstrings)
@@ -235,21 +338,26 @@ void blitter_free(drawing *dr, blitter *bl)
 
 void blitter_save(drawing *dr, blitter *bl, int x, int y)
 {
+    flush_rect(dr);
     dr->api->blitter_save(dr->handle, bl, x, y);
 }
 
 void blitter_load(drawing *dr, blitter *bl, int x, int y)
 {
+    flush_rect(dr);
+    dr->drawn = true;
     dr->api->blitter_load(dr->handle, bl, x, y);
 }
 
 void print_begin_doc(drawing *dr, int pages)
 {
+    flush_rect(dr);
     dr->api->begin_doc(dr->handle, pages);
 }
 
 void print_begin_page(drawing *dr, int number)
 {
+    flush_rect(dr);
     dr->api->begin_page(dr->handle, number);
 }
 
@@ -257,6 +365,7 @@ void print_begin_puzzle(drawing *dr, float xm, float xc,
 			float ym, float yc, int pw, int ph, float wmm,
 			float scale)
 {
+    flush_rect(dr);
     dr->scale = scale;
     dr->ncolours = 0;
     dr->api->begin_puzzle(dr->handle, xm, xc, ym, yc, pw, ph, wmm);
@@ -264,17 +373,20 @@ void print_begin_puzzle(drawing *dr, float xm, float xc,
 
 void print_end_puzzle(drawing *dr)
 {
+    flush_rect(dr);
     dr->api->end_puzzle(dr->handle);
     dr->scale = 1.0F;
 }
 
 void print_end_page(drawing *dr, int number)
 {
+    flush_rect(dr);
     dr->api->end_page(dr->handle, number);
 }
 
 void print_end_doc(drawing *dr)
 {
+    flush_rect(dr);
     dr->api->end_doc(dr->handle);
 }
 
@@ -346,6 +458,7 @@ int print_rgb_hatched_colour(drawing *dr, float r, float g, float b, int hatch)
 
 void print_line_width(drawing *dr, int width)
 {
+    flush_rect(dr);
     /*
      * I don't think it's entirely sensible to have line widths be
      * entirely relative to the puzzle size; there is a point
@@ -363,23 +476,24 @@ void print_line_width(drawing *dr, int width)
 
 void print_line_dotted(drawing *dr, bool dotted)
 {
+    flush_rect(dr);
     dr->api->line_dotted(dr->handle, dotted);
 }
 
 void changed_state(drawing *dr, int can_undo, int can_redo)
 {
-    if (! dr->api->changed_state) return;
+    if (!dr || !dr->api->changed_state) return;
     dr->api->changed_state(dr->handle, can_undo, can_redo);
 }
 
 void purging_states(drawing *dr)
 {
-    if (! dr->api->purging_states) return;
+    if (!dr || !dr->api->purging_states) return;
     dr->api->purging_states(dr->handle);
 }
 
 void inertia_follow(drawing *dr, bool is_solved)
 {
-    if (! dr->api->inertia_follow) return;
+    if (!dr || !dr->api->inertia_follow) return;
     dr->api->inertia_follow(dr->handle, is_solved);
 }
@@ -190,3 +190,119 @@ void edsf_merge(int *dsf, int v1, int v2, bool inverse)
 
 /*    fprintf(stderr, "dsf[%2d] = %2d\n", v2, dsf[v2]); */
 }
+
+/* ----------------------------------------------------------------------
+ * The typed variant. parent[i] == i marks a root, at which csize and
+ * cmin hold the class size and smallest element.
+ */
+
+struct DSF {
+    int size;
+    int *parent, *csize, *cmin;
+};
+
+DSF *dsf_new(int size)
+{
+    DSF *dsf = snew(DSF);
+
+    dsf->size = size;
+    dsf->parent = snewn(size, int);
+    dsf->csize = snewn(size, int);
+    dsf->cmin = snewn(size, int);
+    dsf_reinit(dsf);
+    return dsf;
+}
+
+void dsf_free(DSF *dsf)
+{
+    if (dsf) {
+        sfree(dsf->parent);
+        sfree(dsf->csize);
+        sfree(dsf->cmin);
+        sfree(dsf);
+    }
+}
+
+void dsf_reinit(DSF *dsf)
+{
+    int i;
+
+    for (i = 0; i < dsf->size; i++) {
+        dsf->parent[i] = dsf->cmin[i] = i;
+        dsf->csize[i] = 1;
+    }
+}
+
+void dsf_copy(DSF *to, const DSF *from)
+{
+    assert(to->size == from->size);
+    memcpy(to->parent, from->parent, from->size * sizeof(int));
+    memcpy(to->csize, from->csize, from->size * sizeof(int));
+    memcpy(to->cmin, from->cmin, from->size * sizeof(int));
+}
+
+int dsf_find(DSF *dsf, int val)
+{
+    int *parent = dsf->parent;
+    int root = val, next;
+
+    assert(val >= 0 && val < dsf->size);
+    while (parent[root] != root)
+        root = parent[root];
+    while (parent[val] != root) {
+        next = parent[val];
+        parent[val] = root;
+        val = next;
+    }
+    return root;
+}
+
+int dsf_union(DSF *dsf, int v1, int v2)
+{
+    v1 = dsf_find(dsf, v1);
+    v2 = dsf_find(dsf, v2);
+    if (v1 == v2)
+        return v1;
+    if (dsf->csize[v1] < dsf->csize[v2]) {
+        int v3 = v1;
+        v1 = v2;
+        v2 = v3;
+    }
+    dsf->parent[v2] = v1;
+    dsf->csize[v1] += dsf->csize[v2];
+    if (dsf->cmin[v2] < dsf->cmin[v1])
+        dsf->cmin[v1] = dsf->cmin[v2];
+    return v1;
+}
+
+bool dsf_equivalent(DSF *dsf, int v1, int v2)
+{
+    return dsf_find(dsf, v1) == dsf_find(dsf, v2);
+}
+
+int dsf_class_size(DSF *dsf, int val)
+{
+    return dsf->csize[dsf_find(dsf, val)];
+}
+
+int dsf_minimal(DSF *dsf, int val)
+{
+    return dsf->cmin[dsf_find(dsf, val)];
+}
+
+const int *dsf_flatten(DSF *dsf)
+{
+    int *parent = dsf->parent;
+    int i;
+
+    /*
+     * Walking in index order, a non-root whose parent has already
+     * been visited finds that parent pointing straight at its root,
+     * so most elements resolve in one step; the rest compress their
+     * paths as they go, so the pass is linear in practice.
+     */
+    for (i = 0; i < dsf->size; i++)
+        if (parent[parent[i]] != parent[i])
+            parent[i] = dsf_find(dsf, parent[i]);
+    return parent;
+}
@@ -52,7 +52,12 @@
 #include <string.h>
 #include <stdarg.h>
 
+#ifdef PARALLEL_GENERATION
+#include <emscripten/threading.h>
+#endif
+
 #include "puzzles.h"
+#include "drawcmd.h"
 
 /*
  * Extern references to Javascript functions provided in emcclib.js.
@@ -71,28 +76,13 @@ extern void js_enable_undo_redo(bool undo, bool redo);
 extern void js_activate_timer();
 extern void js_deactivate_timer();
 extern void js_canvas_start_draw(void);
-extern void js_canvas_draw_update(int x, int y, int w, int h);
 extern void js_canvas_end_draw(void);
-extern void js_canvas_draw_rect(int x, int y, int w, int h,
-                                const char *colour);
-extern void js_canvas_clip_rect(int x, int y, int w, int h);
-extern void js_canvas_unclip(void);
-extern void js_canvas_draw_line(float x1, float y1, float x2, float y2,
-                                int width, const char *colour);
-extern void js_canvas_draw_poly(int *points, int npoints,
-                                const char *fillcolour,
-                                const char *outlinecolour);
-extern void js_canvas_draw_circle(int x, int y, int r,
-                                  const char *fillcolour,
-                                  const char *outlinecolour);
+extern void js_canvas_set_colours(char **colours, int ncolours);
+extern void js_canvas_draw_commands(const int32_t *cmds, int len,
+                                    const char *text);
 extern int js_canvas_find_font_midpoint(int height, const char *fontptr);
-extern void js_canvas_draw_text(int x, int y, int halign,
-                                const char *colptr, const char *fontptr,
-                                const char *text);
 extern int js_canvas_new_blitter(int w, int h);
 extern void js_canvas_free_blitter(int id);
-extern void js_canvas_copy_to_blitter(int id, int x, int y, int w, int h);
-extern void js_canvas_copy_from_blitter(int id, int x, int y, int w, int h);
 extern void js_canvas_make_statusbar(void);
 extern void js_canvas_set_statusbar(const char *text);
 extern void js_canvas_set_size(int w, int h);
@@ -367,7 +357,55 @@ static void ids_changed(void *ignored)
  * Implementation of the drawing API by calling Javascript canvas
  * drawing functions. (Well, half of it; the other half is on the JS
  * side.)
+ *
+ * Rather than calling into Javascript once per primitive, we append
+ * each one to a command buffer in the format of drawcmd.h, which
+ * js_canvas_draw_commands replays in a single call. The strings of
+ * TEXT commands are copied into a separate buffer, and referred to
+ * by their offset in it. Both buffers are emptied at the end of each
+ * redraw, and whenever the command buffer fills up.
  */
+#define DRAWBUF_INTS 16384
+
+static int32_t drawbuf[DRAWBUF_INTS];
+static int drawbuf_len;
+static char *drawtext;
+static int drawtext_len, drawtext_size;
+
+static void js_flush_draw(void)
+{
+    if (drawbuf_len == 0)
+        return;
+    js_canvas_draw_commands(drawbuf, drawbuf_len, drawtext);
+    drawbuf_len = 0;
+    drawtext_len = 0;
+}
+
+static int32_t *drawbuf_reserve(int n)
+{
+    int32_t *ret;
+
+    assert(n <= DRAWBUF_INTS);
+    if (drawbuf_len + n > DRAWBUF_INTS)
+        js_flush_draw();
+    ret = drawbuf + drawbuf_len;
+    drawbuf_len += n;
+    return ret;
+}
+
+static int drawtext_add(const char *text)
+{
+    int len = strlen(text) + 1, ret = drawtext_len;
+
+    if (drawtext_len + len > drawtext_size) {
+        drawtext_size = (drawtext_len + len) * 3 / 2 + 256;
+        drawtext = sresize(drawtext, drawtext_size, char);
+    }
+    memcpy(drawtext + drawtext_len, text, len);
+    drawtext_len += len;
+    return ret;
+}
+
 static void js_start_draw(void *handle)
 {
     js_canvas_start_draw();
@@ -375,69 +413,101 @@ static void js_start_draw(void *handle)
 
 static void js_clip(void *handle, int x, int y, int w, int h)
 {
-    js_canvas_clip_rect(x, y, w, h);
+    int32_t *cmd = drawbuf_reserve(5);
+    cmd[0] = DRAW_OP_CLIP;
+    cmd[1] = x;
+    cmd[2] = y;
+    cmd[3] = w;
+    cmd[4] = h;
 }
 
 static void js_unclip(void *handle)
 {
-    js_canvas_unclip();
+    int32_t *cmd = drawbuf_reserve(3);
+    cmd[0] = DRAW_OP_UNCLIP;
+    cmd[1] = cmd[2] = 0;
 }
 
 static void js_draw_text(void *handle, int x, int y, int fonttype,
                          int fontsize, int align, int colour,
                          const char *text)
 {
-    char fontstyle[80];
-    int halign;
+    int32_t *cmd;
 
-    sprintf(fontstyle, "%dpx %s", fontsize,
-            fonttype == FONT_FIXED ? "monospace" : "sans-serif");
+    if (align & ALIGN_VCENTRE) {
+        char fontstyle[80];
 
-    if (align & ALIGN_VCENTRE)
+        sprintf(fontstyle, "%dpx %s", fontsize,
+                fonttype == FONT_FIXED ? "monospace" : "sans-serif");
 	y += js_canvas_find_font_midpoint(fontsize, fontstyle);
+    }
 
-    if (align & ALIGN_HCENTRE)
-	halign = 1;
-    else if (align & ALIGN_HRIGHT)
-        halign = 2;
-    else
-        halign = 0;
-
-    js_canvas_draw_text(x, y, halign, colour_strings[colour], fontstyle, text);
+    cmd = drawbuf_reserve(7);
+    cmd[0] = DRAW_OP_TEXT;
+    cmd[1] = x;
+    cmd[2] = y;
+    cmd[3] = (fonttype == FONT_FIXED ? DRAW_TEXT_FIXED : 0) |
+        (align & ~ALIGN_VCENTRE);
+    cmd[4] = fontsize;
+    cmd[5] = colour;
+    cmd[6] = drawtext_add(text);
 }
 
 static void js_draw_rect(void *handle, int x, int y, int w, int h, int colour)
 {
-    js_canvas_draw_rect(x, y, w, h, colour_strings[colour]);
-}
-
-static void js_draw_line(void *handle, int x1, int y1, int x2, int y2,
-                         int colour)
-{
-    js_canvas_draw_line(x1, y1, x2, y2, 1, colour_strings[colour]);
+    int32_t *cmd = drawbuf_reserve(6);
+    cmd[0] = DRAW_OP_RECT;
+    cmd[1] = x;
+    cmd[2] = y;
+    cmd[3] = w;
+    cmd[4] = h;
+    cmd[5] = colour;
 }
 
 static void js_draw_thick_line(void *handle, float thickness,
                                float x1, float y1, float x2, float y2,
                                int colour)
 {
-    js_canvas_draw_line(x1, y1, x2, y2, thickness, colour_strings[colour]);
+    int32_t *cmd = drawbuf_reserve(7);
+    cmd[0] = DRAW_OP_LINE;
+    cmd[1] = drawcmd_float(thickness);
+    cmd[2] = drawcmd_float(x1);
+    cmd[3] = drawcmd_float(y1);
+    cmd[4] = drawcmd_float(x2);
+    cmd[5] = drawcmd_float(y2);
+    cmd[6] = colour;
+}
+
+static void js_draw_line(void *handle, int x1, int y1, int x2, int y2,
+                         int colour)
+{
+    js_draw_thick_line(handle, 1, x1, y1, x2, y2, colour);
 }
 
 static void js_draw_poly(void *handle, int *coords, int npoints,
                          int fillcolour, int outlinecolour)
 {
-    js_canvas_draw_poly(coords, npoints,
-                        fillcolour >= 0 ? colour_strings[fillcolour] : NULL,
-                        colour_strings[outlinecolour]);
+    int32_t *cmd = drawbuf_reserve(7 + npoints * 2);
+    cmd[0] = DRAW_OP_POLY;
+    cmd[1] = drawcmd_float(1);
+    cmd[2] = npoints;
+    cmd[3] = cmd[4] = 0;
+    cmd[5] = outlinecolour;
+    cmd[6] = fillcolour;
+    memcpy(cmd + 7, coords, npoints * 2 * sizeof(int32_t));
 }
 
 static void js_draw_circle(void *handle, int cx, int cy, int radius,
                            int fillcolour, int outlinecolour)
 {
-    js_canvas_draw_circle(cx, cy, radius,
-                          fillcolour >= 0 ? colour_strings[fillcolour] : NULL,
-                          colour_strings[outlinecolour]);
+    int32_t *cmd = drawbuf_reserve(7);
+    cmd[0] = DRAW_OP_CIRCLE;
+    cmd[1] = drawcmd_float(1);
+    cmd[2] = drawcmd_float(cx);
+    cmd[3] = drawcmd_float(cy);
+    cmd[4] = drawcmd_float(radius);
+    cmd[5] = outlinecolour;
+    cmd[6] = fillcolour;
 }
 
 struct blitter {
@@ -456,6 +526,8 @@ static blitter *js_blitter_new(void *handle, int w, int h)
 
 static void js_blitter_free(void *handle, blitter *bl)
 {
+    /* commands already buffered may still refer to it */
+    js_flush_draw();
     js_canvas_free_blitter(bl->id);
     sfree(bl);
 }
@@ -488,31 +560,51 @@ static void trim_rect(int *x, int *y, int *w, int *h)
     *h = y1 - y0;
 }
 
-static void js_blitter_save(void *handle, blitter *bl, int x, int y)
+static void js_blitter_copy(int op, blitter *bl, int x, int y)
 {
     int w = bl->w, h = bl->h;
+    int32_t *cmd;
+
     trim_rect(&x, &y, &w, &h);
-    if (w > 0 && h > 0)
-        js_canvas_copy_to_blitter(bl->id, x, y, w, h);
+    if (w > 0 && h > 0) {
+        cmd = drawbuf_reserve(6);
+        cmd[0] = op;
+        cmd[1] = bl->id;
+        cmd[2] = x;
+        cmd[3] = y;
+        cmd[4] = w;
+        cmd[5] = h;
+    }
+}
+
+static void js_blitter_save(void *handle, blitter *bl, int x, int y)
+{
+    js_blitter_copy(DRAW_OP_BLITTER_SAVE, bl, x, y);
 }
 
 static void js_blitter_load(void *handle, blitter *bl, int x, int y)
 {
-    int w = bl->w, h = bl->h;
-    trim_rect(&x, &y, &w, &h);
-    if (w > 0 && h > 0)
-        js_canvas_copy_from_blitter(bl->id, x, y, w, h);
+    js_blitter_copy(DRAW_OP_BLITTER_LOAD, bl, x, y);
 }
 
 static void js_draw_update(void *handle, int x, int y, int w, int h)
 {
+    int32_t *cmd;
+
     trim_rect(&x, &y, &w, &h);
-    if (w > 0 && h > 0)
-        js_canvas_draw_update(x, y, w, h);
+    if (w > 0 && h > 0) {
+        cmd = drawbuf_reserve(5);
+        cmd[0] = DRAW_OP_UPDATE;
+        cmd[1] = x;
+        cmd[2] = y;
+        cmd[3] = w;
+        cmd[4] = h;
+    }
 }
 
 static void js_end_draw(void *handle)
 {
+    js_flush_draw();
     js_canvas_end_draw();
 }
 
@@ -917,6 +1009,18 @@ int main(int argc, char **argv)
      * Instantiate a midend.
      */
     me = midend_new(NULL, &thegame, &js_drawing, NULL);
+#ifdef PARALLEL_GENERATION
+    /*
+     * In the threaded flavour, race generators on as many workers as
+     * the build reserved, or as the browser has cores if that's fewer.
+     */
+    {
+        int cores = emscripten_num_logical_cores();
+        midend_set_generation_threads(
+            me, cores < WASM_GENERATION_THREADS ? cores :
+            WASM_GENERATION_THREADS);
+    }
+#endif
 
     /*
      * Chuck in the HTML fragment ID if we have one (trimming the
@@ -987,6 +1091,7 @@ int main(int argc, char **argv)
                 (unsigned)(0.5 + 255 * colours[i*3+2]));
         colour_strings[i] = dupstr(col);
     }
+    js_canvas_set_colours(colour_strings, ncolours);
 
     /*
      * Request notification when the game ids change (e.g. if the user
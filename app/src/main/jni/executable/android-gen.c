@@ -1,13 +1,46 @@
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "../puzzles.h"
 #include "../android.h"
 
-#define USAGE "Usage: puzzles-gen gamename [params | --seed seed | --desc desc]\n"
+#define USAGE "Usage: puzzles-gen gamename [params | --seed seed | --desc desc]\n" \
+	"       puzzles-gen --worker\n"
 
-void serialise_write(__attribute__((unused)) void *ctx, const void *buf, int len) {
-	write(1, buf, (size_t) len);
+/*
+ * In --worker mode we stay alive and read one request per line from stdin:
+ * the same arguments as the one-shot mode, separated by tabs. For each we
+ * write a header line "OK <length>" or "ERR <length>" followed by exactly
+ * that many bytes of save file or error message. EOF on stdin ends it.
+ *
+ * While a game is generating we may also write "PROGRESS <attempts>" lines,
+ * with no body. A "CANCEL" line sent meanwhile stops the generation (in
+ * games whose generators check for it) and gets the reply "CANCELLED 0"; a
+ * CANCEL that arrives after the reply has gone is ignored.
+ */
+
+// How often, at most, generation stops to check for CANCEL and report progress
+#define CHECK_INTERVAL_MS 100
+
+struct gen_output {
+	char *buf;
+	int len, size;
+};
+
+void serialise_write(void *ctx, const void *buf, int len) {
+	if (!ctx) {
+		write(1, buf, (size_t) len);
+		return;
+	}
+	struct gen_output *out = (struct gen_output *)ctx;
+	if (out->len + len > out->size) {
+		out->size = (out->len + len) * 5 / 4 + 1024;
+		out->buf = sresize(out->buf, out->size, char);
+	}
+	memcpy(out->buf + out->len, buf, (size_t) len);
+	out->len += len;
 }
 
 
@@ -17,51 +50,204 @@ const struct drawing_api null_drawing = {
 	NULL, NULL, NULL, NULL, NULL, NULL,
 };
 
-int main(int argc, const char *argv[]) {
-	if (argc < 2 || argc > 4) {
-		fprintf(stderr, USAGE);
-		exit(1);
+// One generation stream per core, up to a point: beyond that the streams mostly compete for memory bandwidth
+#define MAX_GENERATION_THREADS 8
+
+// stdin for the worker, read by hand so that we can see what's waiting without blocking
+static struct {
+	char *buf;
+	int len, size;
+} input;
+
+static long now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/* Reads whatever is available, waiting for it only if wait is set. Returns false at EOF. */
+static bool input_fill(bool wait) {
+	if (!wait) {
+		struct pollfd pfd = { 0, POLLIN, 0 };
+		if (poll(&pfd, 1, 0) <= 0) return true;
 	}
+	if (input.len + 4096 > input.size) {
+		input.size = input.len + 4096;
+		input.buf = sresize(input.buf, input.size, char);
+	}
+	ssize_t n = read(0, input.buf + input.len, (size_t) (input.size - input.len));
+	if (n <= 0) return false;
+	input.len += (int) n;
+	return true;
+}
+
+/* Returns the next complete line (without its newline) if one is buffered, else NULL. */
+static char *input_line(bool peek) {
+	char *nl = input.len ? memchr(input.buf, '\n', (size_t) input.len) : NULL;
+	if (!nl) return NULL;
+	int n = (int) (nl - input.buf);
+	char *line = snewn(n + 1, char);
+	memcpy(line, input.buf, (size_t) n);
+	line[n] = '\0';
+	line[strcspn(line, "\r")] = '\0';
+	if (!peek) {
+		memmove(input.buf, nl + 1, (size_t) (input.len - n - 1));
+		input.len -= n + 1;
+	}
+	return line;
+}
+
+struct gen_progress {
+	long next_check;
+	bool cancelled;
+};
+
+static const char cancelled_error[] = "Cancelled";
+
+// The midend's generation progress hook in worker mode; calls to it are serialised
+static bool gen_progress(void *ctx, unsigned long attempts) {
+	struct gen_progress *prog = (struct gen_progress *)ctx;
+	const long now = now_ms();
+	if (now < prog->next_check) return false;
+	prog->next_check = now + CHECK_INTERVAL_MS;
+	if (!input_fill(false)) {
+		prog->cancelled = true;  // nobody left to send the game to
+		return true;
+	}
+	char *line = input_line(true);
+	if (line && !strcmp(line, "CANCEL")) {
+		sfree(input_line(false));
+		prog->cancelled = true;
+	}
+	sfree(line);
+	if (!prog->cancelled) {
+		printf("PROGRESS %lu\n", attempts);
+		fflush(stdout);
+	}
+	return prog->cancelled;
+}
+
+static int generation_threads(void) {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 1) return 1;
+	return n > MAX_GENERATION_THREADS ? MAX_GENERATION_THREADS : (int) n;
+}
+
+/* Returns an error message, or NULL having serialised the new game to out (stdout if NULL). */
+static const char *generate(int argc, const char *argv[], struct gen_output *out) {
 	int defmode = DEF_PARAMS;
-	if (argc >= 4) {
-		if (!strcmp(argv[2], "--seed")) {
+	if (argc < 1 || argc > 3) return "Wrong number of arguments";
+	if (argc >= 3) {
+		if (!strcmp(argv[1], "--seed")) {
 			defmode = DEF_SEED;
-		} else if (!strcmp(argv[2], "--desc")) {
+		} else if (!strcmp(argv[1], "--desc")) {
 			defmode = DEF_DESC;
 		} else {
-			fprintf(stderr, USAGE);
-			exit(1);
+			return "Unrecognised option";
 		}
 	}
 
-	const game *thegame = game_by_name(argv[1]);
+	const game *thegame = game_by_name(argv[0]);
 
 	if (!thegame) {
-		fprintf(stderr, "Game name not recognised\n");
-		exit(1);
+		return "Game name not recognised";
 	}
 
 	frontend *fe = snew(frontend);
 	memset(fe, 0, sizeof(frontend));
 	fe->me = midend_new(fe, thegame, &null_drawing, fe);
+	midend_set_generation_threads(fe->me, generation_threads());
+	struct gen_progress prog;
+	prog.next_check = now_ms() + CHECK_INTERVAL_MS;
+	prog.cancelled = false;
+	if (out) midend_set_generation_progress(fe->me, gen_progress, &prog);
 
 	const char* error = NULL;
 	game_params *params = NULL;
 	if (defmode == DEF_PARAMS) {
-		params = params_from_str(thegame, (argc >= 3 && strlen(argv[2]) > 0) ? argv[2] : NULL, &error);
+		params = params_from_str(thegame, (argc >= 2 && strlen(argv[1]) > 0) ? argv[1] : NULL, &error);
 	} else {
-		char *tmp = dupstr(argv[3]);
+		char *tmp = dupstr(argv[2]);
 		error = midend_game_id_int(fe->me, tmp, defmode, false);
 		sfree(tmp);
 	}
+	if (!error) {
+		if (defmode == DEF_PARAMS) {
+			midend_set_params(fe->me, params);
+			thegame->free_params(params);
+		}
+		midend_new_game(fe->me);
+
+		if (prog.cancelled) {
+			error = cancelled_error;
+		} else {
+			// We need a save not just a desc: aux info contains solution
+			midend_serialise(fe->me, serialise_write, out);
+		}
+	}
+	midend_free(fe->me);
+	sfree(fe);
+	return error;
+}
+
+static void write_frame(const char *status, const char *buf, int len) {
+	printf("%s %d\n", status, len);
+	fwrite(buf, 1, (size_t) len, stdout);
+	fflush(stdout);
+}
+
+static int worker(void) {
+	char *line;
+	struct gen_output out;
+	out.buf = NULL;
+	out.len = out.size = 0;
+	for (;;) {
+		while ((line = input_line(false)) == NULL) {
+			if (!input_fill(true)) break;
+		}
+		if (!line) break;
+		if (!strcmp(line, "CANCEL")) {
+			// too late: we'd already replied
+			sfree(line);
+			continue;
+		}
+		const char *args[3];
+		int nargs = 0;
+		char *p = line;
+		while (nargs < 3) {
+			args[nargs++] = p;
+			p = strchr(p, '\t');
+			if (!p) break;
+			*p++ = '\0';
+		}
+		out.len = 0;
+		const char *error = p ? "Too many arguments" : generate(nargs, args, &out);
+		if (error == cancelled_error) {
+			write_frame("CANCELLED", "", 0);
+		} else if (error) {
+			write_frame("ERR", error, (int) strlen(error));
+		} else {
+			write_frame("OK", out.buf, out.len);
+		}
+		sfree(line);
+	}
+	sfree(out.buf);
+	sfree(input.buf);
+	return 0;
+}
+
+int main(int argc, const char *argv[]) {
+	if (argc == 2 && !strcmp(argv[1], "--worker")) {
+		exit(worker());
+	}
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, USAGE);
+		exit(1);
+	}
+	const char *error = generate(argc - 1, argv + 1, NULL);
 	if (error) {
 		fprintf(stderr, "%s\n", error);
 		exit(1);
 	}
-	if (defmode == DEF_PARAMS) midend_set_params(fe->me, params);
-	midend_new_game(fe->me);
-
-	// We need a save not just a desc: aux info contains solution
-	midend_serialise(fe->me, serialise_write, NULL);
 	exit(0);
 }
@@ -641,6 +641,197 @@ static void next_move(int nx, int ny, int ox, int oy, int gx, int gy,
         *dx = to_tile_x;
 }
 
+/*
+ * Once the unsolved part of the board is down to a small rectangle,
+ * finish it off with a shortest solution found by iterative deepening
+ * A*, using Manhattan distance plus linear conflicts as the heuristic.
+ * Any such rectangle holds exactly its own tiles and the gap, so it
+ * be solved in isolation without disturbing the rows and columns
+ * compute_hint has already finished. The area limit keeps the search
+ * to a few tens of thousands of nodes at worst; there is deliberately
+ * no node budget, since falling back to the greedy walk halfway along
+ * an optimal path could make successive hints go round in circles.
+ */
+#define IDA_MAX_AREA 9
+
+struct ida {
+    int w, h;                          /* of the region */
+    int tiles[IDA_MAX_AREA];           /* region-local tile numbers */
+    int gap;
+    int path[64];                      /* moves found, as gap positions */
+};
+
+/* Twice the number of tiles that must leave a line to get past one
+ * another, for the line of 'len' squares starting at 'start'. */
+static int ida_line_conflict(const struct ida *ida, int start, int step,
+                             int len, bool row)
+{
+    int goals[IDA_MAX_AREA], lis[IDA_MAX_AREA], n = 0, i, j, ret = 0;
+    int line = row ? start / ida->w : start % ida->w;
+
+    for (i = 0; i < len; i++) {
+        int t = ida->tiles[start + i*step];
+        if (t < 0)
+            continue;
+        if ((row ? t / ida->w : t % ida->w) == line) {
+            goals[n] = row ? t % ida->w : t / ida->w;
+            lis[n++] = 1;
+        }
+    }
+
+    /*
+     * The minimum number of tiles to remove so that the rest are in
+     * order is n minus the longest increasing subsequence.
+     */
+    for (i = 0; i < n; i++)
+        for (j = 0; j < i; j++)
+            if (goals[j] < goals[i] && lis[j] + 1 > lis[i])
+                lis[i] = lis[j] + 1;
+    for (i = 0; i < n; i++)
+        if (lis[i] > ret)
+            ret = lis[i];
+    return 2 * (n - ret);
+}
+
+static int ida_row_conflict(const struct ida *ida, int y)
+{
+    return ida_line_conflict(ida, y * ida->w, 1, ida->w, true);
+}
+
+static int ida_col_conflict(const struct ida *ida, int x)
+{
+    return ida_line_conflict(ida, x, ida->w, ida->h, false);
+}
+
+static int ida_heuristic(const struct ida *ida)
+{
+    int i, ret = 0;
+
+    for (i = 0; i < ida->w * ida->h; i++) {
+        int t = ida->tiles[i];
+        if (t >= 0)
+            ret += abs(t % ida->w - i % ida->w) + abs(t / ida->w - i / ida->w);
+    }
+    for (i = 0; i < ida->h; i++)
+        ret += ida_row_conflict(ida, i);
+    for (i = 0; i < ida->w; i++)
+        ret += ida_col_conflict(ida, i);
+    return ret;
+}
+
+/*
+ * Move the tile at 'from' into the gap, and return the change in the
+ * heuristic. Only the tile's own distance and the conflicts on the
+ * lines it leaves, enters or moves along can change.
+ */
+static int ida_slide(struct ida *ida, int from)
+{
+    int w = ida->w, to = ida->gap, t = ida->tiles[from], delta;
+    int fx = from % w, fy = from / w, tx = to % w, ty = to / w;
+    bool vertical = (fx == tx);
+
+    delta = abs(t % w - tx) + abs(t / w - ty)
+        - abs(t % w - fx) - abs(t / w - fy);
+    if (vertical)
+        delta -= ida_row_conflict(ida, fy) + ida_row_conflict(ida, ty)
+            + ida_col_conflict(ida, fx);
+    else
+        delta -= ida_col_conflict(ida, fx) + ida_col_conflict(ida, tx)
+            + ida_row_conflict(ida, fy);
+
+    ida->tiles[to] = t;
+    ida->tiles[from] = -1;
+    ida->gap = from;
+
+    if (vertical)
+        delta += ida_row_conflict(ida, fy) + ida_row_conflict(ida, ty)
+            + ida_col_conflict(ida, fx);
+    else
+        delta += ida_col_conflict(ida, fx) + ida_col_conflict(ida, tx)
+            + ida_row_conflict(ida, fy);
+    return delta;
+}
+
+/*
+ * Returns -1 when a solution within 'bound' moves has been recorded in
+ * path[], and otherwise the smallest f value that exceeded the bound.
+ */
+static int ida_search(struct ida *ida, int g, int hval, int bound, int prev)
+{
+    static const int dx[4] = {+1, -1, 0, 0}, dy[4] = {0, 0, +1, -1};
+    int w = ida->w, h = ida->h, gx = ida->gap % w, gy = ida->gap / w;
+    int i, min = INT_MAX;
+
+    if (g + hval > bound)
+        return g + hval;
+    if (hval == 0)
+        return -1;
+    assert(g < lenof(ida->path));
+
+    for (i = 0; i < 4; i++) {
+        int x = gx + dx[i], y = gy + dy[i], pos = y * w + x, old = ida->gap;
+        int ret, delta;
+
+        if (x < 0 || x >= w || y < 0 || y >= h || pos == prev)
+            continue;
+        delta = ida_slide(ida, pos);
+        ida->path[g] = pos;
+        ret = ida_search(ida, g + 1, hval + delta, bound, old);
+        ida_slide(ida, old);
+        if (ret == -1)
+            return ret;
+        if (ret < min)
+            min = ret;
+    }
+    return min;
+}
+
+/*
+ * Find the first move of a shortest solution of the w x h region at
+ * (x0,y0), which must hold exactly its own tiles and the gap.
+ */
+static bool ida_solve_region(const game_state *state, int x0, int y0,
+                             int w, int h, int *out_x, int *out_y)
+{
+    struct ida *ida;
+    int x, y, bound, hval;
+    bool ret = false;
+
+    if (w * h > IDA_MAX_AREA || w < 2 || h < 2)
+        return false;
+    /* a hand-typed game ID can be unsolvable, and then we'd never stop */
+    if (PARITY_S(state) != perm_parity(state->tiles, state->n))
+        return false;
+
+    ida = snew(struct ida);
+    ida->w = w;
+    ida->h = h;
+    for (y = 0; y < h; y++)
+        for (x = 0; x < w; x++) {
+            int t = state->tiles[C(state, x0 + x, y0 + y)];
+            if (t == 0) {
+                ida->tiles[y * w + x] = -1;
+                ida->gap = y * w + x;
+            } else {
+                int tx = X(state, t - 1) - x0, ty = Y(state, t - 1) - y0;
+                assert(tx >= 0 && tx < w && ty >= 0 && ty < h);
+                ida->tiles[y * w + x] = ty * w + tx;
+            }
+        }
+
+    hval = ida_heuristic(ida);
+    if (hval > 0) {
+        for (bound = hval; bound != -1;)
+            bound = ida_search(ida, 0, hval, bound, -1);
+        *out_x = x0 + ida->path[0] % w;
+        *out_y = y0 + ida->path[0] / w;
+        ret = true;
+    }
+
+    sfree(ida);
+    return ret;
+}
+
 static bool compute_hint(const game_state *state, int *out_x, int *out_y)
 {
     /* The overall solving process is this:
@@ -692,6 +883,10 @@ static bool compute_hint(const game_state *state, int *out_x, int *out_y)
     if (next_piece == n)
         return false;
 
+    if (ida_solve_region(state, solc, solr, unsolved_cols, unsolved_rows,
+                         out_x, out_y))
+        return true;
+
     /* 2, 3. Move the next piece towards its place */
 
     /* gx, gy already set */
@@ -289,21 +289,24 @@ static const int dy[4] = {0, 0, -1, 1};
 
 struct solver_state
 {
-    int *dsf;
+    DSF *dsf;
     int *board;
     int *connected;
     int nempty;
 
     /* Used internally by learn_bitmap_deductions; kept here to avoid
      * mallocing/freeing them every time that function is called. */
-    int *bm, *bmdsf, *bmminsize;
+    int *bm, *bmdsf, *bmminsize, *bmreach;
+
+    /* Used by check_capacity, to undo its flood fill. */
+    int *flooded;
 };
 
 static void print_board(int *board, int w, int h) {
     if (verbose) {
 	char *repr = board_to_string(board, w, h);
 	printv("%s\n", repr);
-	free(repr);
+	sfree(repr);
     }
 }
 
@@ -461,14 +464,14 @@ retry:
     sfree(dsf);
 }
 
-static void merge(int *dsf, int *connected, int a, int b) {
+static void merge(DSF *dsf, int *connected, int a, int b) {
     int c;
     assert(dsf);
     assert(connected);
-    a = dsf_canonify(dsf, a);
-    b = dsf_canonify(dsf, b);
+    a = dsf_find(dsf, a);
+    b = dsf_find(dsf, b);
     if (a == b) return;
-    dsf_merge(dsf, a, b);
+    dsf_union(dsf, a, b);
     c = connected[a];
     connected[a] = connected[b];
     connected[b] = c;
@@ -501,16 +504,19 @@ static void expand(struct solver_state *s, int w, int h, int t, int f) {
     --s->nempty;
 }
 
-static void clear_count(int *board, int sz) {
+/* Undo the marks left by flood_count on the nflooded squares it
+ * recorded in flooded[]. */
+static void clear_count(int *board, int sz, const int *flooded, int nflooded) {
     int i;
-    for (i = 0; i < sz; ++i) {
-        if (board[i] >= 0) continue;
-        else if (board[i] == -SENTINEL) board[i] = EMPTY;
-        else board[i] = -board[i];
+    for (i = 0; i < nflooded; ++i) {
+	const int j = flooded[i];
+        if (board[j] == -SENTINEL) board[j] = EMPTY;
+        else board[j] = -board[j];
     }
 }
 
-static void flood_count(int *board, int w, int h, int i, int n, int *c) {
+static void flood_count(int *board, int w, int h, int i, int n, int *c,
+			int *flooded, int *nflooded) {
     const int sz = w * h;
     int k;
 
@@ -518,6 +524,7 @@ static void flood_count(int *board, int w, int h, int i, int n, int *c) {
     else if (board[i] == n) board[i] = -board[i];
     else return;
 
+    flooded[(*nflooded)++] = i;
     if (--*c == 0) return;
 
     for (k = 0; k < 4; ++k) {
@@ -525,19 +532,26 @@ static void flood_count(int *board, int w, int h, int i, int n, int *c) {
         const int y = (i / w) + dy[k];
         const int idx = w*y + x;
         if (x < 0 || x >= w || y < 0 || y >= h) continue;
-        flood_count(board, w, h, idx, n, c);
+        flood_count(board, w, h, idx, n, c, flooded, nflooded);
 	if (*c == 0) return;
     }
 }
 
-static bool check_capacity(int *board, int w, int h, int i) {
-    int n = board[i];
-    flood_count(board, w, h, i, board[i], &n);
-    clear_count(board, w * h);
+/* Can the CC containing i still reach its full size without using
+ * the empty square `blocked'? */
+static bool check_capacity(struct solver_state *s, int w, int h, int i,
+			   int blocked) {
+    const int sz = w * h;
+    int n = s->board[i], nflooded = 0;
+    assert(s->board[blocked] == EMPTY);
+    s->board[blocked] = -SENTINEL;
+    flood_count(s->board, w, h, i, s->board[i], &n, s->flooded, &nflooded);
+    clear_count(s->board, sz, s->flooded, nflooded);
+    s->board[blocked] = EMPTY;
     return n == 0;
 }
 
-static int expandsize(const int *board, int *dsf, int w, int h, int i, int n) {
+static int expandsize(const int *board, DSF *dsf, int w, int h, int i, int n) {
     int j;
     int nhits = 0;
     int hits[4];
@@ -550,12 +564,13 @@ static int expandsize(const int *board, int *dsf, int w, int h, int i, int n) {
         int m;
         if (x < 0 || x >= w || y < 0 || y >= h) continue;
         if (board[idx] != n) continue;
-        root = dsf_canonify(dsf, idx);
+        root = dsf_find(dsf, idx);
         for (m = 0; m < nhits && root != hits[m]; ++m);
         if (m < nhits) continue;
-	printv("\t  (%d, %d) contrib %d to size\n", x, y, dsf[root] >> 2);
-        size += dsf_size(dsf, root);
-        assert(dsf_size(dsf, root) >= 1);
+	printv("\t  (%d, %d) contrib %d to size\n", x, y,
+	       dsf_class_size(dsf, root));
+        size += dsf_class_size(dsf, root);
+        assert(dsf_class_size(dsf, root) >= 1);
         hits[nhits++] = root;
     }
     return size;
@@ -662,11 +677,9 @@ static bool learn_expand_or_one(struct solver_state *s, int w, int h) {
 		 (s->board[idx] >= expandsize(s->board, s->dsf, w, h,
 					      i, s->board[idx]))))
 		one = false;
-	    if (dsf_size(s->dsf, idx) == s->board[idx]) continue;
-	    assert(s->board[i] == EMPTY);
-	    s->board[i] = -SENTINEL;
-	    if (check_capacity(s->board, w, h, idx)) continue;
+	    if (dsf_class_size(s->dsf, idx) == s->board[idx]) continue;
 	    assert(s->board[i] == EMPTY);
+	    if (check_capacity(s, w, h, idx, i)) continue;
 	    printv("learn: expanding in one\n");
 	    expand(s, w, h, i, idx);
 	    learn = true;
@@ -697,13 +710,13 @@ static bool learn_blocked_expansion(struct solver_state *s, int w, int h) {
         int j;
 
 	if (s->board[i] == EMPTY) continue;
-        j = dsf_canonify(s->dsf, i);
+        j = dsf_minimal(s->dsf, i);
 
         /* (but only for each connected component) */
         if (i != j) continue;
 
         /* (and not if it's already complete) */
-        if (dsf_size(s->dsf, j) == s->board[j]) continue;
+        if (dsf_class_size(s->dsf, j) == s->board[j]) continue;
 
         /* for each square j _in_ the connected component */
         do {
@@ -787,8 +800,8 @@ static bool learn_critical_square(struct solver_state *s, int w, int h) {
     for (i = 0; i < sz; ++i) {
 	int j, slack;
 	if (s->board[i] == EMPTY) continue;
-	if (i != dsf_canonify(s->dsf, i)) continue;
-	slack = s->board[i] - dsf_size(s->dsf, i);
+	if (i != dsf_minimal(s->dsf, i)) continue;
+	slack = s->board[i] - dsf_class_size(s->dsf, i);
 	if (slack == 0) continue;
 	assert(s->board[i] != 1);
 	/* for each empty square */
@@ -803,8 +816,7 @@ static bool learn_critical_square(struct solver_state *s, int w, int h) {
 		} while (i != k);
 		if (i == k) continue; /* not within range */
 	    } else continue;
-	    s->board[j] = -SENTINEL;
-	    if (check_capacity(s->board, w, h, i)) continue;
+	    if (check_capacity(s, w, h, i, j)) continue;
 	    /* if not expanding s->board[i] to s->board[j] implies
 	     * that s->board[i] can't reach its full size, ... */
 	    assert(s->nempty);
@@ -840,6 +852,7 @@ static bool learn_bitmap_deductions(struct solver_state *s, int w, int h)
     int *bm = s->bm;
     int *dsf = s->bmdsf;
     int *minsize = s->bmminsize;
+    int *reach = s->bmreach, *newreach = s->bmreach + sz, *tmp;
     int x, y, i, j, n;
     bool learn = false;
 
@@ -964,75 +977,51 @@ static bool learn_bitmap_deductions(struct solver_state *s, int w, int h)
      * Now our bitmap includes every square which could be part of a
      * completely new region, of any size. Extend it to include
      * squares which could be part of an existing region.
+     *
+     * For each n, we want the squares within distance n-s of some
+     * existing CC of n's of size s (the distance being measured
+     * straight across the grid, regardless of what's in the way),
+     * i.e. those that CC could be extended to include without
+     * becoming too big. Rather than doing a separate breadth-first
+     * search for every n, we do them all at once, one bit per n, as
+     * in bm itself: reach[i] has bit n set if some n-CC would have
+     * to have size at most j to be extended to include square i.
+     * Going from j-1 to j, that set grows by one step in every
+     * direction, plus any n-CCs which are of size j already; and
+     * once j reaches n, bit n is finished and can go into bm.
      */
-    for (n = 1; n <= 9; n++) {
-	/*
-	 * We're going to do a breadth-first search starting from
-	 * existing connected components with cell value n, to find
-	 * all cells they might possibly extend into.
-	 *
-	 * The quantity we compute, for each square, is 'minimum size
-	 * that any existing CC would have to have if extended to
-	 * include this square'. So squares already _in_ an existing
-	 * CC are initialised to the size of that CC; then we search
-	 * outwards using the rule that if a square's score is j, then
-	 * its neighbours can't score more than j+1.
-	 *
-	 * Scores are capped at n+1, because if a square scores more
-	 * than n then that's enough to know it can't possibly be
-	 * reached by extending an existing region - we don't need to
-	 * know exactly _how far_ out of reach it is.
-	 */
-	for (i = 0; i < sz; i++) {
-	    if (s->board[i] == n) {
-		/* Square is part of an existing CC. */
-		minsize[i] = dsf_size(s->dsf, i);
-	    } else {
-		/* Otherwise, initialise to the maximum score n+1;
-		 * we'll reduce this later if we find a neighbouring
-		 * square with a lower score. */
-		minsize[i] = n+1;
-	    }
-	}
+    for (i = 0; i < sz; i++) {
+	/* minsize[i] is the size of i's CC, or 0 if i is empty */
+	minsize[i] = s->board[i] == EMPTY ? 0 : dsf_class_size(s->dsf, i);
+	reach[i] = 0;
+    }
 
-	for (j = 1; j < n; j++) {
-	    /*
-	     * Find neighbours of cells scoring j, and set their score
-	     * to at most j+1.
-	     *
-	     * Doing the BFS this way means we need n passes over the
-	     * grid, which isn't entirely optimal but it seems to be
-	     * fast enough for the moment. This could probably be
-	     * improved by keeping a linked-list queue of cells in
-	     * some way, but I think you'd have to be a bit careful to
-	     * insert things into the right place in the queue; this
-	     * way is easier not to get wrong.
-	     */
-	    for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-		    i = y*w+x;
-		    if (minsize[i] == j) {
-			if (x > 0 && minsize[i-1] > j+1)
-			    minsize[i-1] = j+1;
-			if (x+1 < w && minsize[i+1] > j+1)
-			    minsize[i+1] = j+1;
-			if (y > 0 && minsize[i-w] > j+1)
-			    minsize[i-w] = j+1;
-			if (y+1 < h && minsize[i+w] > j+1)
-			    minsize[i+w] = j+1;
-		    }
-		}
+    for (j = 1; j <= 9; j++) {
+	for (y = 0; y < h; y++) {
+	    for (x = 0; x < w; x++) {
+		int r;
+
+		i = y*w+x;
+		r = reach[i];
+		if (minsize[i] && minsize[i] <= j)
+		    r |= 1 << s->board[i];
+		if (x > 0)
+		    r |= reach[i-1];
+		if (x+1 < w)
+		    r |= reach[i+1];
+		if (y > 0)
+		    r |= reach[i-w];
+		if (y+1 < h)
+		    r |= reach[i+w];
+		newreach[i] = r;
 	    }
 	}
+	tmp = reach;
+	reach = newreach;
+	newreach = tmp;
 
-	/*
-	 * Now, every cell scoring at most n should have its 1<<n bit
-	 * in the bitmap reinstated, because we've found that it's
-	 * potentially reachable by extending an existing CC.
-	 */
 	for (i = 0; i < sz; i++)
-	    if (minsize[i] <= n)
-		bm[i] |= 1<<n;
+	    bm[i] |= reach[i] & (1 << j);
     }
 #if 0
     printv("bitmap after bfs:\n");
@@ -1081,13 +1070,15 @@ static bool solver(const int *orig, int w, int h, char **solution) {
 
     struct solver_state ss;
     ss.board = memdup(orig, sz, sizeof (int));
-    ss.dsf = snew_dsf(sz); /* eqv classes: connected components */
+    ss.dsf = dsf_new(sz); /* eqv classes: connected components */
     ss.connected = snewn(sz, int); /* connected[n] := n.next; */
     /* cyclic disjoint singly linked lists, same partitioning as dsf.
      * The lists lets you iterate over a partition given any member */
     ss.bm = snewn(sz, int);
     ss.bmdsf = snew_dsf(sz);
     ss.bmminsize = snewn(sz, int);
+    ss.bmreach = snewn(2 * sz, int);
+    ss.flooded = snewn(sz, int);
 
     printv("trying to solve this:\n");
     print_board(ss.board, w, h);
@@ -1114,12 +1105,14 @@ static bool solver(const int *orig, int w, int h, char **solution) {
          * I'm just being printf-friendly in case I wanna print */
     }
 
-    sfree(ss.dsf);
+    dsf_free(ss.dsf);
     sfree(ss.board);
     sfree(ss.connected);
     sfree(ss.bm);
     sfree(ss.bmdsf);
     sfree(ss.bmminsize);
+    sfree(ss.bmreach);
+    sfree(ss.flooded);
 
     return !ss.nempty;
 }
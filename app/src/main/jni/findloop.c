@@ -19,6 +19,7 @@ struct findloopstate {
     int index, minindex, maxindex;
     int minreachable, maxreachable;
     int bridge;
+    int depth, size;                   /* kept up to date by add/remove */
 };
 
 struct findloopstate *findloop_new_state(int nvertices)
@@ -66,8 +67,8 @@ static bool findloop_is_bridge_oneway(
         return false;
 
     r = pv[u].component_root;
-    total = pv[r].maxindex - pv[r].minindex + 1;
-    below = pv[u].maxindex - pv[u].minindex + 1;
+    total = pv[r].size;
+    below = pv[u].size;
 
     if (u_vertices)
         *u_vertices = below;
@@ -122,6 +123,7 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
             pv[v].sibling = pv[root].child;
             pv[root].child = v;
             pv[v].component_root = v;
+            pv[v].depth = 0;
             debug(("%d is new child of root\n", v));
 
             u = v;
@@ -145,6 +147,7 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
                             pv[w].sibling = pv[u].child;
                             pv[w].parent = u;
                             pv[w].component_root = pv[u].component_root;
+                            pv[w].depth = pv[u].depth + 1;
                             pv[u].child = w;
                         }
 
@@ -234,6 +237,7 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
          * its maxindex field.
          */
         pv[u].maxindex = index-1;
+        pv[u].size = pv[u].maxindex - pv[u].minindex + 1;
         debug(("  vertex %d <- maxindex %d\n", u, pv[u].maxindex));
 
         if (pv[u].sibling >= 0) {
@@ -357,6 +361,166 @@ bool findloop_run(struct findloopstate *pv, int nvertices,
     return nbridges < nedges;
 }
 
+/*
+ * Incremental updates. These keep the spanning forest built by
+ * findloop_run, and the bridge flags on it, correct for the graph
+ * after a single edge change, without looking at the rest of the
+ * graph. The subtree index ranges are not maintained, so from here on
+ * only depth and size are trusted.
+ */
+
+static void findloop_unlink(struct findloopstate *pv, int c)
+{
+    int *p = &pv[pv[c].parent].child;
+
+    while (*p != c)
+        p = &pv[*p].sibling;
+    *p = pv[c].sibling;
+}
+
+static void findloop_link(struct findloopstate *pv, int p, int c)
+{
+    pv[c].parent = p;
+    pv[c].sibling = pv[p].child;
+    pv[p].child = c;
+}
+
+/*
+ * Walk the subtree under r in preorder, putting every vertex in the
+ * component rooted at 'croot', at depth 'depth' for r itself; sizes
+ * are recomputed on the way back up.
+ */
+static void findloop_reroot_subtree(struct findloopstate *pv, int r,
+                                    int croot, int depth)
+{
+    int u = r, v;
+
+    pv[r].depth = depth;
+    while (1) {
+        pv[u].component_root = croot;
+        if (pv[u].child >= 0) {
+            v = pv[u].child;
+            pv[v].depth = pv[u].depth + 1;
+            u = v;
+            continue;
+        }
+        while (1) {
+            pv[u].size = 1;
+            for (v = pv[u].child; v >= 0; v = pv[v].sibling)
+                pv[u].size += pv[v].size;
+            if (u == r)
+                return;
+            if (pv[u].sibling >= 0) {
+                v = pv[u].sibling;
+                pv[v].depth = pv[u].depth;
+                u = v;
+                break;
+            }
+            u = pv[u].parent;
+        }
+    }
+}
+
+bool findloop_add_edge(struct findloopstate *pv, int nvertices, int u, int v)
+{
+    int ru, rv, c, p, pp, a;
+    bool isbridge, pbridge;
+
+    /* A second copy of an existing edge: leave that to findloop_run. */
+    if (u == v || pv[u].parent == v || pv[v].parent == u)
+        return false;
+
+    ru = pv[u].component_root;
+    rv = pv[v].component_root;
+
+    if (ru == rv) {
+        /*
+         * The new edge closes a cycle through the tree path between
+         * u and v, so every edge on that path is now a loop edge.
+         */
+        while (pv[u].depth > pv[v].depth) {
+            pv[u].bridge = -1;
+            u = pv[u].parent;
+        }
+        while (pv[v].depth > pv[u].depth) {
+            pv[v].bridge = -1;
+            v = pv[v].parent;
+        }
+        while (u != v) {
+            pv[u].bridge = pv[v].bridge = -1;
+            u = pv[u].parent;
+            v = pv[v].parent;
+        }
+        return true;
+    }
+
+    /*
+     * The new edge joins two components, so it's a bridge and nothing
+     * else changes. Hang the smaller tree off the larger one, which
+     * means re-rooting it at its end of the new edge first.
+     */
+    if (pv[ru].size < pv[rv].size) {
+        int t = u; u = v; v = t;
+        t = ru; ru = rv; rv = t;
+    }
+    findloop_unlink(pv, rv);
+    c = v;
+    p = pv[v].parent;
+    isbridge = (pv[v].bridge == p);
+    if (v != rv)
+        findloop_unlink(pv, v);
+    while (c != rv) {
+        pp = pv[p].parent;
+        pbridge = (pv[p].bridge == pp);
+        if (p != rv)
+            findloop_unlink(pv, p);
+        findloop_link(pv, c, p);
+        pv[p].bridge = isbridge ? c : -1;
+        c = p;
+        p = pp;
+        isbridge = pbridge;
+    }
+    findloop_link(pv, u, v);
+    pv[v].bridge = u;
+    findloop_reroot_subtree(pv, v, ru, pv[u].depth + 1);
+
+    for (a = u;; a = pv[a].parent) {
+        pv[a].size += pv[v].size;
+        if (a == ru)
+            break;
+    }
+    return true;
+}
+
+bool findloop_remove_edge(struct findloopstate *pv, int nvertices,
+                          int u, int v)
+{
+    int c, p, a;
+
+    /*
+     * Removing a bridge splits its component in two and changes
+     * nothing else. Removing a loop edge can turn any of the edges in
+     * its loops into bridges, which needs the full treatment.
+     */
+    if (pv[u].bridge == v)
+        c = u, p = v;
+    else if (pv[v].bridge == u)
+        c = v, p = u;
+    else
+        return false;
+
+    for (a = p;; a = pv[a].parent) {
+        pv[a].size -= pv[c].size;
+        if (a == pv[a].component_root)
+            break;
+    }
+    findloop_unlink(pv, c);
+    findloop_link(pv, nvertices, c);
+    pv[c].bridge = -1;
+    findloop_reroot_subtree(pv, c, c, 0);
+    return true;
+}
+
 /*
  * Appendix: the long and painful history of loop detection in these puzzles
  * =========================================================================
@@ -53,14 +53,14 @@ struct game_params {
  */
 struct matrix {
     int refcount;
-    unsigned char *matrix;             /* array of (w*h) by (w*h) */
+    bitgrid *matrix;                   /* (w*h) by (w*h); row i is square i's effect */
 };
 
 struct game_state {
     int w, h;
     int moves;
     bool completed, cheated, hints_active;
-    unsigned char *grid;               /* array of w*h */
+    bitgrid *lights, *hints;           /* one row of w*h each */
     struct matrix *matrix;
 };
 
@@ -186,7 +186,7 @@ static const char *validate_params(const game_params *params, bool full)
     return NULL;
 }
 
-static char *encode_bitmap(unsigned char *bmp, int len)
+static char *encode_bitmap(const bitgrid *bmp, int bw, int len)
 {
     int slen = (len + 3) / 4;
     char *ret;
@@ -197,7 +197,7 @@ static char *encode_bitmap(unsigned char *bmp, int len)
         int j, v;
         v = 0;
         for (j = 0; j < 4; j++)
-            if (i*4+j < len && bmp[i*4+j])
+            if (i*4+j < len && bitgrid_get(bmp, (i*4+j) % bw, (i*4+j) / bw))
                 v |= 8 >> j;
         ret[i] = "0123456789abcdef"[v];
     }
@@ -205,7 +205,7 @@ static char *encode_bitmap(unsigned char *bmp, int len)
     return ret;
 }
 
-static void decode_bitmap(unsigned char *bmp, int len, const char *hex)
+static void decode_bitmap(bitgrid *bmp, int bw, int len, const char *hex)
 {
     int slen = (len + 3) / 4;
     int i;
@@ -221,12 +221,8 @@ static void decode_bitmap(unsigned char *bmp, int len, const char *hex)
         else
             v = 0;                     /* shouldn't happen */
         for (j = 0; j < 4; j++) {
-            if (i*4+j < len) {
-                if (v & (8 >> j))
-                    bmp[i*4+j] = 1;
-                else
-                    bmp[i*4+j] = 0;
-            }
+            if (i*4+j < len)
+                bitgrid_set(bmp, (i*4+j) % bw, (i*4+j) / bw, v & (8 >> j));
         }
     }
 }
@@ -306,17 +302,15 @@ static int sqcmp_osize(void *av, void *bv)
     return 0;
 }
 static void addsq(tree234 *t, int w, int h, int cx, int cy,
-                  int x, int y, unsigned char *matrix)
+                  int x, int y, const bitgrid *matrix, const int *colcount)
 {
-    int wh = w * h;
     struct sq *sq;
-    int i;
 
     if (x < 0 || x >= w || y < 0 || y >= h)
         return;
     if (abs(x-cx) > 1 || abs(y-cy) > 1)
         return;
-    if (matrix[(cy*w+cx) * wh + y*w+x])
+    if (bitgrid_get(matrix, y*w+x, cy*w+cx))
         return;
 
     sq = snew(struct sq);
@@ -324,24 +318,20 @@ static void addsq(tree234 *t, int w, int h, int cx, int cy,
     sq->cy = cy;
     sq->x = x;
     sq->y = y;
-    sq->coverage = sq->ominosize = 0;
-    for (i = 0; i < wh; i++) {
-        if (matrix[i * wh + y*w+x])
-            sq->coverage++;
-        if (matrix[(cy*w+cx) * wh + i])
-            sq->ominosize++;
-    }
+    sq->coverage = colcount[y*w+x];
+    sq->ominosize = bitgrid_row_popcount(matrix, cy*w+cx);
 
     if (add234(t, sq) != sq)
         sfree(sq);                     /* already there */
 }
 static void addneighbours(tree234 *t, int w, int h, int cx, int cy,
-                          int x, int y, unsigned char *matrix)
+                          int x, int y, const bitgrid *matrix,
+                          const int *colcount)
 {
-    addsq(t, w, h, cx, cy, x-1, y, matrix);
-    addsq(t, w, h, cx, cy, x+1, y, matrix);
-    addsq(t, w, h, cx, cy, x, y-1, matrix);
-    addsq(t, w, h, cx, cy, x, y+1, matrix);
+    addsq(t, w, h, cx, cy, x-1, y, matrix, colcount);
+    addsq(t, w, h, cx, cy, x+1, y, matrix, colcount);
+    addsq(t, w, h, cx, cy, x, y-1, matrix, colcount);
+    addsq(t, w, h, cx, cy, x, y+1, matrix, colcount);
 }
 
 static char *new_game_desc(const game_params *params, random_state *rs,
@@ -349,11 +339,13 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 {
     int w = params->w, h = params->h, wh = w * h;
     int i, j;
-    unsigned char *matrix, *grid;
+    bitgrid *matrix, *grid;
+    int *colcount;		       /* set bits in each matrix column */
     char *mbmp, *gbmp, *ret;
 
-    matrix = snewn(wh * wh, unsigned char);
-    grid = snewn(wh, unsigned char);
+    matrix = bitgrid_new(wh, wh);
+    grid = bitgrid_new(wh, 1);
+    colcount = snewn(wh, int);
 
     /*
      * First set up the matrix.
@@ -364,32 +356,35 @@ static char *new_game_desc(const game_params *params, random_state *rs,
             int ix = i % w, iy = i / w;
             for (j = 0; j < wh; j++) {
                 int jx = j % w, jy = j / w;
-                if (abs(jx - ix) + abs(jy - iy) <= 1)
-                    matrix[i*wh+j] = 1;
-                else
-                    matrix[i*wh+j] = 0;
+                bitgrid_set(matrix, j, i, abs(jx - ix) + abs(jy - iy) <= 1);
             }
         }
         break;
-      case RANDOM:
+      case RANDOM: {
+        tree234 *pick, *cov, *osize;
+
+        /*
+         * The trees are emptied rather than freed between
+         * attempts, so each retry reuses the previous one's nodes.
+         */
+        pick = newtree234(sqcmp_pick);
+        cov = newtree234(sqcmp_cov);
+        osize = newtree234(sqcmp_osize);
+
         while (1) {
-            tree234 *pick, *cov, *osize;
             int limit;
 
-            pick = newtree234(sqcmp_pick);
-            cov = newtree234(sqcmp_cov);
-            osize = newtree234(sqcmp_osize);
-
-            memset(matrix, 0, wh * wh);
+            bitgrid_clear(matrix);
             for (i = 0; i < wh; i++) {
-                matrix[i*wh+i] = 1;
+                bitgrid_set(matrix, i, i, true);
+                colcount[i] = 1;
             }
 
             for (i = 0; i < wh; i++) {
                 int ix = i % w, iy = i / w;
-                addneighbours(pick, w, h, ix, iy, ix, iy, matrix);
-                addneighbours(cov, w, h, ix, iy, ix, iy, matrix);
-                addneighbours(osize, w, h, ix, iy, ix, iy, matrix);
+                addneighbours(pick, w, h, ix, iy, ix, iy, matrix, colcount);
+                addneighbours(cov, w, h, ix, iy, ix, iy, matrix, colcount);
+                addneighbours(osize, w, h, ix, iy, ix, iy, matrix, colcount);
             }
 
             /*
@@ -431,7 +426,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
                 /*
                  * Add this square to the matrix.
                  */
-                matrix[(sq->cy * w + sq->cx) * wh + (sq->y * w + sq->x)] = 1;
+                bitgrid_set(matrix, sq->y * w + sq->x, sq->cy * w + sq->cx, true);
+                colcount[sq->y * w + sq->x]++;
 
                 /*
                  * Correct the matrix coverage field of any sq
@@ -476,9 +472,12 @@ static char *new_game_desc(const game_params *params, random_state *rs,
                  * finished with; but its neighbours now need to
                  * appear.
                  */
-                addneighbours(pick, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix);
-                addneighbours(cov, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix);
-                addneighbours(osize, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix);
+                addneighbours(pick, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix,
+                              colcount);
+                addneighbours(cov, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix,
+                              colcount);
+                addneighbours(osize, w,h, sq->cx,sq->cy, sq->x,sq->y, matrix,
+                              colcount);
                 sfree(sq);
             }
 
@@ -487,12 +486,12 @@ static char *new_game_desc(const game_params *params, random_state *rs,
              */
             {
                 struct sq *sq;
-                while ((sq = delpos234(pick, 0)) != NULL)
+                for (i = 0; (sq = index234(pick, i)) != NULL; i++)
                     sfree(sq);
             }
-            freetree234(pick);
-            freetree234(cov);
-            freetree234(osize);
+            cleartree234(pick);
+            cleartree234(cov);
+            cleartree234(osize);
 
             /*
              * Finally, check to see if any two matrix rows are
@@ -515,8 +514,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
              */
             for (i = 0; i < wh; i++) {
                 for (j = 0; j < wh; j++)
-                    if (i != j &&
-                        !memcmp(matrix + i * wh, matrix + j * wh, wh))
+                    if (i != j && bitgrid_rows_equal(matrix, i, matrix, j))
                         break;
                 if (j < wh)
                     break;
@@ -524,7 +522,12 @@ static char *new_game_desc(const game_params *params, random_state *rs,
             if (i == wh)
                 break;                 /* no matches found */
         }
+
+        freetree234(pick);
+        freetree234(cov);
+        freetree234(osize);
         break;
+      }
     }
 
     /*
@@ -559,21 +562,16 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      * all the output points. Phew!
      */
     while (1) {
-        memset(grid, 0, wh);
+        bitgrid_clear(grid);
         for (i = 0; i < wh; i++) {
             int v = random_upto(rs, 2);
-            if (v) {
-                for (j = 0; j < wh; j++)
-                    grid[j] ^= matrix[i*wh+j];
-            }
+            if (v)
+                bitgrid_xor_row(grid, 0, matrix, i);
         }
         /*
          * Ensure we don't have the starting state already!
          */
-        for (i = 0; i < wh; i++)
-            if (grid[i])
-                break;
-        if (i < wh)
+        if (!bitgrid_row_empty(grid, 0))
             break;
     }
 
@@ -582,14 +580,15 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      * description. We'll do this by concatenating two great big
      * hex bitmaps.
      */
-    mbmp = encode_bitmap(matrix, wh*wh);
-    gbmp = encode_bitmap(grid, wh);
+    mbmp = encode_bitmap(matrix, wh, wh*wh);
+    gbmp = encode_bitmap(grid, wh, wh);
     ret = snewn(strlen(mbmp) + strlen(gbmp) + 2, char);
     sprintf(ret, "%s,%s", mbmp, gbmp);
     sfree(mbmp);
     sfree(gbmp);
-    sfree(matrix);
-    sfree(grid);
+    bitgrid_free(matrix);
+    bitgrid_free(grid);
+    sfree(colcount);
     return ret;
 }
 
@@ -633,10 +632,11 @@ static game_state *new_game(midend *me, const game_params *params,
     state->moves = 0;
     state->matrix = snew(struct matrix);
     state->matrix->refcount = 1;
-    state->matrix->matrix = snewn(wh*wh, unsigned char);
-    decode_bitmap(state->matrix->matrix, wh*wh, desc);
-    state->grid = snewn(wh, unsigned char);
-    decode_bitmap(state->grid, wh, desc + mlen + 1);
+    state->matrix->matrix = bitgrid_new(wh, wh);
+    decode_bitmap(state->matrix->matrix, wh, wh*wh, desc);
+    state->lights = bitgrid_new(wh, 1);
+    decode_bitmap(state->lights, wh, wh, desc + mlen + 1);
+    state->hints = bitgrid_new(wh, 1);
 
     return state;
 }
@@ -653,56 +653,54 @@ static game_state *dup_game(const game_state *state)
     ret->moves = state->moves;
     ret->matrix = state->matrix;
     state->matrix->refcount++;
-    ret->grid = snewn(ret->w * ret->h, unsigned char);
-    memcpy(ret->grid, state->grid, ret->w * ret->h);
+    ret->lights = bitgrid_dup(state->lights);
+    ret->hints = bitgrid_dup(state->hints);
 
     return ret;
 }
 
 static void free_game(game_state *state)
 {
-    sfree(state->grid);
+    bitgrid_free(state->lights);
+    bitgrid_free(state->hints);
     if (--state->matrix->refcount <= 0) {
-        sfree(state->matrix->matrix);
+        bitgrid_free(state->matrix->matrix);
         sfree(state->matrix);
     }
     sfree(state);
 }
 
-static void rowxor(unsigned char *row1, unsigned char *row2, int len)
-{
-    int i;
-    for (i = 0; i < len; i++)
-	row1[i] ^= row2[i];
-}
-
 static char *solve_game(const game_state *state, const game_state *currstate,
                         const char *aux, const char **error)
 {
     int w = state->w, h = state->h, wh = w * h;
-    unsigned char *equations, *solution, *shortest;
-    int *und, nund;
+    bitgrid *equations, *solution, *shortest, *effects;
+    int *und, nund, *pivot;
+    unsigned long long step, code, bestcode;
     int rowsdone, colsdone;
-    int i, j, k, len, bestlen;
+    int i, j, len, bestlen;
     char *ret;
 
     /*
-     * Set up a list of simultaneous equations. Each one is of
-     * length (wh+1) and has wh coefficients followed by a value.
+     * Set up a list of simultaneous equations. Each one is a row
+     * of length (wh+1) and has wh coefficients followed by a value.
      */
-    equations = snewn((wh + 1) * wh, unsigned char);
+    equations = bitgrid_new(wh + 1, wh);
     for (i = 0; i < wh; i++) {
 	for (j = 0; j < wh; j++)
-	    equations[i * (wh+1) + j] = currstate->matrix->matrix[j*wh+i];
-	equations[i * (wh+1) + wh] = currstate->grid[i] & 1;
+	    if (bitgrid_get(currstate->matrix->matrix, i, j))
+		bitgrid_set(equations, j, i, true);
+	bitgrid_set(equations, wh, i, bitgrid_get(currstate->lights, i, 0));
     }
 
     /*
-     * Perform Gaussian elimination over GF(2).
+     * Perform Gauss-Jordan elimination over GF(2), recording the
+     * column in which each finished row has its leading 1.
      */
     rowsdone = colsdone = 0;
     nund = 0;
     und = snewn(wh, int);
+    pivot = snewn(wh, int);
     do {
 	/*
 	 * Find the leftmost column which has a 1 in it somewhere
@@ -711,7 +709,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	j = -1;
 	for (i = colsdone; i < wh; i++) {
 	    for (j = rowsdone; j < wh; j++)
-		if (equations[j * (wh+1) + i])
+		if (bitgrid_get(equations, i, j))
 		    break;
 	    if (j < wh)
 		break;		       /* found one */
@@ -731,10 +729,11 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 */
 	if (i == wh) {
 	    for (j = rowsdone; j < wh; j++)
-		if (equations[j * (wh+1) + wh]) {
+		if (bitgrid_get(equations, wh, j)) {
 		    *error = _("No solution exists for this position");
-		    sfree(equations);
+		    bitgrid_free(equations);
 		    sfree(und);
+		    sfree(pivot);
 		    return NULL;
 		}
 	    break;
@@ -747,20 +746,21 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	 */
 	assert(j != -1);
 	if (j > rowsdone)
-	    rowxor(equations + rowsdone*(wh+1), equations + j*(wh+1), wh+1);
+	    bitgrid_xor_row(equations, rowsdone, equations, j);
 
 	/*
-	 * Do row-XORs to eliminate that 1 from all rows below the
-	 * topmost row.
+	 * Do row-XORs to eliminate that 1 from all other rows, above
+	 * as well as below, so that each leading 1 is alone in its
+	 * column and only undetermined variables remain to its right.
 	 */
-	for (j = rowsdone + 1; j < wh; j++)
-	    if (equations[j*(wh+1) + i])
-		rowxor(equations + j*(wh+1),
-		       equations + rowsdone*(wh+1), wh+1);
+	for (j = 0; j < wh; j++)
+	    if (j != rowsdone && bitgrid_get(equations, i, j))
+		bitgrid_xor_row(equations, j, equations, rowsdone);
 
 	/*
 	 * Mark this row and column as done.
 	 */
+	pivot[rowsdone] = i;
 	rowsdone++;
 	colsdone = i+1;
 
@@ -776,68 +776,53 @@ static char *solve_game(const game_state *state, const game_state *currstate,
      * components not directly determined by an equation), and pick
      * one requiring the smallest number of flips.
      */
-    solution = snewn(wh, unsigned char);
-    shortest = snewn(wh, unsigned char);
-    memset(solution, 0, wh);
-    bestlen = wh + 1;
-    while (1) {
-	/*
-	 * Find a solution based on the current values of the
-	 * undetermined variables.
-	 */
-	for (j = rowsdone; j-- ;) {
-	    int v;
+    solution = bitgrid_new(wh, 1);
+    shortest = bitgrid_new(wh, 1);
+    effects = bitgrid_new(wh, max(nund, 1));
 
-	    /*
-	     * Find the leftmost set bit in this equation.
-	     */
-	    for (i = 0; i < wh; i++)
-		if (equations[j * (wh+1) + i])
-		    break;
-	    assert(i < wh);		       /* there must have been one! */
-
-	    /*
-	     * Compute this variable using the rest.
-	     */
-	    v = equations[j * (wh+1) + wh];
-	    for (k = i+1; k < wh; k++)
-		if (equations[j * (wh+1) + k])
-		    v ^= solution[k];
+    /*
+     * Start with every undetermined variable zero, in which case
+     * each leading variable is just its equation's value.
+     */
+    for (j = 0; j < rowsdone; j++)
+	if (bitgrid_get(equations, wh, j))
+	    bitgrid_set(solution, pivot[j], 0, true);
 
-	    solution[i] = v;
-	}
+    /*
+     * Row i of `effects' is the change to the solution caused by
+     * flipping undetermined variable und[i]: that variable itself,
+     * plus the leading variable of every equation it appears in.
+     */
+    for (i = 0; i < nund; i++) {
+	bitgrid_set(effects, und[i], i, true);
+	for (j = 0; j < rowsdone; j++)
+	    if (bitgrid_get(equations, und[i], j))
+		bitgrid_toggle(effects, pivot[j], i);
+    }
 
-	/*
-	 * Compare this solution to the current best one, and
-	 * replace the best one if this one is shorter.
-	 */
-	len = 0;
-	for (i = 0; i < wh; i++)
-	    if (solution[i])
-		len++;
-	if (len < bestlen) {
+    /*
+     * Step through all 2^nund settings of the undetermined
+     * variables in Gray code order, so that each step flips just
+     * one of them and costs one row XOR. `code' holds the setting
+     * as a binary number with und[0] least significant; on a tie
+     * we keep the lowest, which is the first one that counting up
+     * in binary would have reached. (With 64 or more there'd be no
+     * finishing anyway, so settle for the first solution.)
+     */
+    bestlen = bitgrid_row_popcount(solution, 0);
+    bestcode = code = 0;
+    bitgrid_xor_row(shortest, 0, solution, 0);
+    for (step = 1; nund < 64 && step < (1ULL << nund); step++) {
+	for (i = 0; !((step >> i) & 1); i++);
+	bitgrid_xor_row(solution, 0, effects, i);
+	code ^= 1ULL << i;
+	len = bitgrid_row_popcount(solution, 0);
+	if (len < bestlen || (len == bestlen && code < bestcode)) {
 	    bestlen = len;
-	    memcpy(shortest, solution, wh);
-	}
-
-	/*
-	 * Now increment the binary number given by the
-	 * undetermined variables: turn all 1s into 0s until we see
-	 * a 0, at which point we turn it into a 1.
-	 */
-	for (i = 0; i < nund; i++) {
-	    solution[und[i]] = !solution[und[i]];
-	    if (solution[und[i]])
-		break;
+	    bestcode = code;
+	    bitgrid_clear(shortest);
+	    bitgrid_xor_row(shortest, 0, solution, 0);
 	}
-
-	/*
-	 * If we didn't find a 0 at any point, we have wrapped
-	 * round and are back at the start, i.e. we have enumerated
-	 * all solutions.
-	 */
-	if (i == nund)
-	    break;
     }
 
     /*
@@ -847,13 +832,15 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     ret = snewn(wh + 2, char);
     ret[0] = 'S';
     for (i = 0; i < wh; i++)
-	ret[i+1] = shortest[i] ? '1' : '0';
+	ret[i+1] = bitgrid_get(shortest, i, 0) ? '1' : '0';
     ret[wh+1] = '\0';
 
-    sfree(shortest);
-    sfree(solution);
-    sfree(equations);
+    bitgrid_free(shortest);
+    bitgrid_free(solution);
+    bitgrid_free(effects);
+    bitgrid_free(equations);
     sfree(und);
+    sfree(pivot);
 
     return ret;
 }
@@ -868,7 +855,7 @@ static bool game_can_format_as_text_now(const game_params *params)
 
 static char *game_text_format(const game_state *state)
 {
-    int w = state->w, h = state->h, wh = w*h, r, c, dx, dy;
+    int w = state->w, h = state->h, r, c, dx, dy;
     int cw = 4, ch = 4, gw = w * cw + 2, gh = h * ch + 1, len = gw * gh;
     char *board = snewn(len + 1, char);
 
@@ -877,10 +864,10 @@ static char *game_text_format(const game_state *state)
     for (r = 0; r < h; ++r) {
 	for (c = 0; c < w; ++c) {
 	    int cell = r*ch*gw + c*cw, center = cell+(ch/2)*DOWN + cw/2*RIGHT;
-	    char flip = (state->grid[r*w + c] & 1) ? '#' : '.';
+	    char flip = bitgrid_get(state->lights, r*w + c, 0) ? '#' : '.';
 	    for (dy = -1 + (r == 0); dy <= 1 - (r == h - 1); ++dy)
 		for (dx = -1 + (c == 0); dx <= 1 - (c == w - 1); ++dx)
-		    if (state->matrix->matrix[(r*w+c)*wh + ((r+dy)*w + c+dx)])
+		    if (bitgrid_get(state->matrix->matrix, (r+dy)*w + c+dx, r*w+c))
 			board[center + dy*DOWN + dx*RIGHT] = flip;
 	    board[cell] = '+';
 	    for (dx = 1; dx < cw; ++dx) board[cell+dx*RIGHT] = '-';
@@ -952,7 +939,7 @@ static char *interpret_move(const game_state *state, game_ui *ui,
                             const game_drawstate *ds,
                             int x, int y, int button)
 {
-    int w = state->w, h = state->h, wh = w * h;
+    int w = state->w, h = state->h;
     char buf[80], *nullret = NULL;
 
     if (button == LEFT_BUTTON || IS_CURSOR_SELECT(button)) {
@@ -972,13 +959,7 @@ static char *interpret_move(const game_state *state, game_ui *ui,
              * will have at least one square do nothing whatsoever.
              * If so, we avoid encoding a move at all.
              */
-            int i = ty*w+tx, j;
-            bool makemove = false;
-            for (j = 0; j < wh; j++) {
-                if (state->matrix->matrix[i*wh+j])
-                    makemove = true;
-            }
-            if (makemove) {
+            if (!bitgrid_row_empty(state->matrix->matrix, ty*w+tx)) {
                 sprintf(buf, "M%d,%d", tx, ty);
                 return dupstr(buf);
             } else {
@@ -1017,17 +998,13 @@ static game_state *execute_move(const game_state *from, const char *move)
 	ret = dup_game(from);
 	ret->hints_active = true;
 	ret->cheated = true;
-	for (i = 0; i < wh; i++) {
-	    ret->grid[i] &= ~2;
-	    if (move[i+1] != '0')
-		ret->grid[i] |= 2;
-	}
+	for (i = 0; i < wh; i++)
+	    bitgrid_set(ret->hints, i, 0, move[i+1] != '0');
 	return ret;
     } else if (move[0] == 'M' &&
 	       sscanf(move+1, "%d,%d", &x, &y) == 2 &&
 	x >= 0 && x < w && y >= 0 && y < h) {
-	int i, j;
-        bool done;
+	int i;
 
 	ret = dup_game(from);
 
@@ -1036,14 +1013,9 @@ static game_state *execute_move(const game_state *from, const char *move)
 
 	i = y * w + x;
 
-	done = true;
-	for (j = 0; j < wh; j++) {
-	    ret->grid[j] ^= ret->matrix->matrix[i*wh+j];
-	    if (ret->grid[j] & 1)
-		done = false;
-	}
-	ret->grid[i] ^= 2;	       /* toggle hint */
-	if (done) {
+	bitgrid_xor_row(ret->lights, 0, ret->matrix->matrix, i);
+	bitgrid_toggle(ret->hints, i, 0);
+	if (bitgrid_row_empty(ret->lights, 0)) {
 	    ret->completed = true;
 	    ret->hints_active = false;
 	}
@@ -1133,7 +1105,7 @@ static void game_free_drawstate(drawing *dr, game_drawstate *ds)
 static void draw_tile(drawing *dr, game_drawstate *ds, const game_state *state,
                       int x, int y, int tile, bool anim, float animtime)
 {
-    int w = ds->w, h = ds->h, wh = w * h;
+    int w = ds->w, h = ds->h;
     int bx = x * TILE_SIZE + BORDER, by = y * TILE_SIZE + BORDER;
     int i, j, dcol = (tile & 4) ? COL_CURSOR : COL_DIAG;
 
@@ -1170,7 +1142,7 @@ static void draw_tile(drawing *dr, game_drawstate *ds, const game_state *state,
      */
     for (i = 0; i < h; i++)
 	for (j = 0; j < w; j++)
-	    if (state->matrix->matrix[(y*w+x)*wh + i*w+j]) {
+	    if (bitgrid_get(state->matrix->matrix, i*w+j, y*w+x)) {
 		int ox = j - x, oy = i - y;
 		int td = TILE_SIZE / 16;
 		int cx = (bx + TILE_SIZE/2) + (2 * ox - 1) * td;
@@ -1243,7 +1215,8 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
     for (i = 0; i < wh; i++) {
         int x = i % w, y = i / w;
 	int fx, fy, fd;
-	int v = state->grid[i];
+	int v = bitgrid_get(state->lights, i, 0) |
+	    (bitgrid_get(state->hints, i, 0) << 1);
 	int vv;
 
 	if (flashframe >= 0) {
@@ -1261,7 +1234,8 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
         if (ui->cdraw && ui->cx == x && ui->cy == y)
             v |= 4;
 
-	if (oldstate && ((state->grid[i] ^ oldstate->grid[i]) &~ 2))
+	if (oldstate && bitgrid_get(state->lights, i, 0) !=
+	    bitgrid_get(oldstate->lights, i, 0))
 	    vv = 255;		       /* means `animated' */
 	else
 	    vv = v;
@@ -246,16 +246,57 @@ void check_recursion_depth(void)
 #define check_recursion_depth() (void)0
 #endif
 
+/*
+ * Many of the positions at the bottom of choosemove's lookahead are
+ * reached more than once, by different move orders or from one actual
+ * move to the next, so remember search() results for recent ones.
+ * Positions are found by a Zobrist hash, kept up to date as fill()
+ * recolours squares, and confirmed by comparing the whole grid.
+ */
+#define LEAF_CACHE_SIZE 1024           /* must be a power of 2 */
+
+struct leaf {
+    unsigned long long hash;
+    bool used;
+    int dist, number, control;
+};
+
 struct solver_scratch {
     int *queue[2];
     int *dist;
     char *grid, *grid2;
     char *rgrids;
+    struct leaf *leaves;
+    char *leafgrids;                   /* LEAF_CACHE_SIZE grids of wh */
 };
 
+/*
+ * The Zobrist key for a square having a colour: fixed pseudo-random
+ * bits (a splitmix64 step), which must not come from the game's
+ * random_state since the solver's results can't depend on them.
+ */
+static unsigned long long zobrist(int pos, int colour)
+{
+    unsigned long long z = (unsigned long long)pos * 16 + colour + 1;
+    z *= 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static unsigned long long grid_hash(int wh, const char *grid)
+{
+    unsigned long long hash = 0;
+    int i;
+
+    for (i = 0; i < wh; i++)
+        hash ^= zobrist(i, grid[i]);
+    return hash;
+}
+
 static struct solver_scratch *new_scratch(int w, int h)
 {
-    int wh = w*h;
+    int wh = w*h, i;
     struct solver_scratch *scratch = snew(struct solver_scratch);
     check_recursion_depth();
     scratch->queue[0] = snewn(wh, int);
@@ -264,6 +305,10 @@ static struct solver_scratch *new_scratch(int w, int h)
     scratch->grid = snewn(wh, char);
     scratch->grid2 = snewn(wh, char);
     scratch->rgrids = snewn(wh * RECURSION_DEPTH, char);
+    scratch->leaves = snewn(LEAF_CACHE_SIZE, struct leaf);
+    scratch->leafgrids = snewn(wh * LEAF_CACHE_SIZE, char);
+    for (i = 0; i < LEAF_CACHE_SIZE; i++)
+        scratch->leaves[i].used = false;
     return scratch;
 }
 
@@ -275,6 +320,8 @@ static void free_scratch(struct solver_scratch *scratch)
     sfree(scratch->grid);
     sfree(scratch->grid2);
     sfree(scratch->rgrids);
+    sfree(scratch->leaves);
+    sfree(scratch->leafgrids);
     sfree(scratch);
 }
 
@@ -404,10 +451,11 @@ static void search(int w, int h, char *grid, int x0, int y0,
 }
 
 /*
- * Enact a flood-fill move on a grid.
+ * Enact a flood-fill move on a grid. Returns the number of squares
+ * recoloured, which are left in the first entries of queue.
  */
-static void fill(int w, int h, char *grid, int x0, int y0, char newcolour,
-                 int *queue)
+static int fill(int w, int h, char *grid, int x0, int y0, char newcolour,
+                int *queue)
 {
     char oldcolour;
     int qhead, qtail;
@@ -436,6 +484,37 @@ static void fill(int w, int h, char *grid, int x0, int y0, char newcolour,
             }
         }
     }
+
+    return qhead;
+}
+
+/*
+ * search(), but answered from the leaf cache if we've seen this grid.
+ */
+static void search_cached(int w, int h, char *grid, unsigned long long hash,
+                          int x0, int y0, struct solver_scratch *scratch,
+                          int *rdist, int *rnumber, int *rcontrol)
+{
+    int wh = w*h;
+    int i = (int)(hash & (LEAF_CACHE_SIZE - 1));
+    struct leaf *leaf = &scratch->leaves[i];
+    char *leafgrid = scratch->leafgrids + i*wh;
+
+    if (leaf->used && leaf->hash == hash &&
+        !memcmp(leafgrid, grid, wh * sizeof(*grid))) {
+        *rdist = leaf->dist;
+        *rnumber = leaf->number;
+        *rcontrol = leaf->control;
+        return;
+    }
+
+    search(w, h, grid, x0, y0, scratch, rdist, rnumber, rcontrol);
+    leaf->used = true;
+    leaf->hash = hash;
+    leaf->dist = *rdist;
+    leaf->number = *rnumber;
+    leaf->control = *rcontrol;
+    memcpy(leafgrid, grid, wh * sizeof(*grid));
 }
 
 /*
@@ -457,12 +536,15 @@ static bool completed(int w, int h, char *grid)
  * Try out every possible move on a grid, and choose whichever one
  * reduced the result of search() by the most.
  */
-static char choosemove_recurse(int w, int h, char *grid, int x0, int y0,
+static char choosemove_recurse(int w, int h, char *grid, unsigned long long hash,
+                               int x0, int y0,
                                int maxmove, struct solver_scratch *scratch,
                                int depth, int *rbestdist, int *rbestnumber, int *rbestcontrol)
 {
     int wh = w*h;
-    char move, bestmove;
+    int i, nfilled;
+    unsigned long long tmphash;
+    char move, bestmove, oldcolour = grid[y0*w+x0];
     int dist, number, control, bestdist, bestnumber, bestcontrol;
     char *tmpgrid;
 
@@ -481,7 +563,7 @@ static char choosemove_recurse(int w, int h, char *grid, int x0, int y0,
         if (grid[y0*w+x0] == move)
             continue;
         memcpy(tmpgrid, grid, wh * sizeof(*grid));
-        fill(w, h, tmpgrid, x0, y0, move, scratch->queue[0]);
+        nfilled = fill(w, h, tmpgrid, x0, y0, move, scratch->queue[0]);
         if (completed(w, h, tmpgrid)) {
             /*
              * A move that wins is immediately the best, so stop
@@ -494,15 +576,20 @@ static char choosemove_recurse(int w, int h, char *grid, int x0, int y0,
             *rbestcontrol = wh;
             return move;
         }
+        tmphash = hash;
+        for (i = 0; i < nfilled; i++)
+            tmphash ^= zobrist(scratch->queue[0][i], oldcolour) ^
+                zobrist(scratch->queue[0][i], move);
         if (depth < RECURSION_DEPTH-1) {
-            choosemove_recurse(w, h, tmpgrid, x0, y0, maxmove, scratch,
+            choosemove_recurse(w, h, tmpgrid, tmphash, x0, y0, maxmove, scratch,
                                depth+1, &dist, &number, &control);
         } else {
 #if 0
             dump_grid(w, h, tmpgrid, "after move %d at depth %d",
                       move, depth);
 #endif
-            search(w, h, tmpgrid, x0, y0, scratch, &dist, &number, &control);
+            search_cached(w, h, tmpgrid, tmphash, x0, y0, scratch,
+                          &dist, &number, &control);
 #if 0
             dump_dist(w, h, scratch->dist, "after move %d at depth %d",
                       move, depth);
@@ -535,8 +622,8 @@ static char choosemove(int w, int h, char *grid, int x0, int y0,
                        int maxmove, struct solver_scratch *scratch)
 {
     int tmp0, tmp1, tmp2;
-    return choosemove_recurse(w, h, grid, x0, y0, maxmove, scratch,
-                              0, &tmp0, &tmp1, &tmp2);
+    return choosemove_recurse(w, h, grid, grid_hash(w*h, grid), x0, y0,
+                              maxmove, scratch, 0, &tmp0, &tmp1, &tmp2);
 }
 
 static char *new_game_desc(const game_params *params, random_state *rs,
@@ -1354,6 +1354,11 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     for (i = 0; i < sz; i++) scratch[i] = i;
 
 generate:
+    if (random_cancelled(rs)) {
+        free_game(state);
+        sfree(scratch);
+        return NULL;
+    }
     clear_game(state, true);
     ntries++;
 
@@ -1670,30 +1675,85 @@ static game_state *new_game(midend *me, const game_params *params,
  * Solver and all its little wizards.
  */
 
-static int solver_recurse_depth;
+static THREAD_LOCAL int solver_recurse_depth;
+
+/*
+ * Each deduction pass need only revisit the spaces near something that
+ * has changed since it last looked at them: anything else would just
+ * repeat itself. So every change the solver makes goes through
+ * solver_changed, which marks what depends on the changed space:
+ *
+ *  - D_LINES on an edge, for solver_lines_opposite_cb, if the edge or
+ *    either tile beside it has changed;
+ *  - D_ONEPOSS on a tile, for solver_spaces_oneposs_cb, if the tile,
+ *    one of its edges or one of its neighbours has changed.
+ *
+ * Everything starts out marked, and each callback clears its mark
+ * before looking, so that anything it changes itself is looked at
+ * again next time round. (solver_expand_dots still starts from
+ * scratch each time: by the time it runs, changes are usually spread
+ * too widely over the grid for remembering its results to pay.)
+ */
+#define D_LINES         1
+#define D_ONEPOSS       2
 
 typedef struct solver_ctx {
     game_state *state;
     int sz;             /* state->sx * state->sy */
     space **scratch;    /* size sz */
+    space **marked;     /* size sz: tiles given F_MARK by
+                           solver_expand_fromdot, for it to clear */
 
+    unsigned char *dirty;       /* size sz: D_* flags */
 } solver_ctx;
 
 static solver_ctx *new_solver(game_state *state)
 {
     solver_ctx *sctx = snew(solver_ctx);
+
     sctx->state = state;
     sctx->sz = state->sx*state->sy;
     sctx->scratch = snewn(sctx->sz, space *);
+    sctx->marked = snewn(sctx->sz, space *);
+    sctx->dirty = snewn(sctx->sz, unsigned char);
+    memset(sctx->dirty, D_LINES | D_ONEPOSS, sctx->sz);
     return sctx;
 }
 
 static void free_solver(solver_ctx *sctx)
 {
     sfree(sctx->scratch);
+    sfree(sctx->marked);
+    sfree(sctx->dirty);
     sfree(sctx);
 }
 
+/* Note that sp has just gained an edge or an association. */
+static void solver_changed(solver_ctx *sctx, space *sp)
+{
+    game_state *state = sctx->state;
+    space *a1s[4], *a2s[4];
+    int i;
+
+    if (sp->type == s_edge) {
+        sctx->dirty[sp - state->grid] |= D_LINES;
+        tiles_from_edge(state, sp, a2s);
+        for (i = 0; i < 2; i++)
+            if (a2s[i])
+                sctx->dirty[a2s[i] - state->grid] |= D_ONEPOSS;
+    } else {
+        assert(sp->type == s_tile);
+        sctx->dirty[sp - state->grid] |= D_ONEPOSS;
+        adjacencies(state, sp, a1s, a2s);
+        for (i = 0; i < 4; i++) {
+            if (a1s[i])
+                sctx->dirty[a1s[i] - state->grid] |= D_LINES;
+            if (a2s[i])
+                sctx->dirty[a2s[i] - state->grid] |= D_ONEPOSS;
+        }
+    }
+}
+
     /* Solver ideas so far:
      *
      * For any empty space, work out how many dots it could associate
@@ -1716,8 +1776,9 @@ static void free_solver(solver_ctx *sctx)
    * one possible dot for a given tile based on line-of-sight
  */
 
-static int solver_add_assoc(game_state *state, space *tile, int dx, int dy,
-                            const char *why)
+/* sctx may be NULL if nothing needs telling about the change. */
+static int solver_add_assoc(game_state *state, solver_ctx *sctx,
+                            space *tile, int dx, int dy, const char *why)
 {
     space *dot, *tile_opp;
 
@@ -1753,6 +1814,10 @@ static int solver_add_assoc(game_state *state, space *tile, int dx, int dy,
 
     add_assoc(state, tile, dot);
     add_assoc(state, tile_opp, dot);
+    if (sctx) {
+        solver_changed(sctx, tile);
+        solver_changed(sctx, tile_opp);
+    }
     solvep(("%*sSetting %d,%d --> %d,%d (%s).\n",
             solver_recurse_depth*4, "",
             tile->x, tile->y,dx, dy, why));
@@ -1777,7 +1842,7 @@ static int solver_obvious_dot(game_state *state, space *dot)
 
             tile = &SPACE(state, dot->x+dx, dot->y+dy);
             if (tile->type == s_tile) {
-                ret = solver_add_assoc(state, tile, dot->x, dot->y,
+                ret = solver_add_assoc(state, NULL, tile, dot->x, dot->y,
                                        "next to dot");
                 if (ret < 0) return -1;
                 if (ret > 0) didsth = 1;
@@ -1803,10 +1868,13 @@ static int solver_obvious(game_state *state)
 
 static int solver_lines_opposite_cb(game_state *state, space *edge, void *ctx)
 {
+    solver_ctx *sctx = (solver_ctx *)ctx;
     int didsth = 0, n, dx, dy;
     space *tiles[2], *tile_opp, *edge_opp;
 
     assert(edge->type == s_edge);
+    if (!(sctx->dirty[edge - state->grid] & D_LINES)) return 0;
+    sctx->dirty[edge - state->grid] &= ~D_LINES;
 
     tiles_from_edge(state, edge, tiles);
 
@@ -1824,6 +1892,7 @@ static int solver_lines_opposite_cb(game_state *state, space *edge, void *ctx)
         solvep(("%*sSetting edge %d,%d - tiles different dots.\n",
                solver_recurse_depth*4, "", edge->x, edge->y));
         edge->flags |= F_EDGE_SET;
+        solver_changed(sctx, edge);
         didsth = 1;
     }
 
@@ -1853,6 +1922,7 @@ static int solver_lines_opposite_cb(game_state *state, space *edge, void *ctx)
                    solver_recurse_depth*4, "",
                    tile_opp->x-dx, tile_opp->y-dy, edge->x, edge->y));
             edge_opp->flags |= F_EDGE_SET;
+            solver_changed(sctx, edge_opp);
             didsth = 1;
         }
     }
@@ -1861,12 +1931,15 @@ static int solver_lines_opposite_cb(game_state *state, space *edge, void *ctx)
 
 static int solver_spaces_oneposs_cb(game_state *state, space *tile, void *ctx)
 {
+    solver_ctx *sctx = (solver_ctx *)ctx;
     int n, eset, ret;
     space *edgeadj[4], *tileadj[4];
     int dotx, doty;
 
     assert(tile->type == s_tile);
     if (tile->flags & F_TILE_ASSOC) return 0;
+    if (!(sctx->dirty[tile - state->grid] & D_ONEPOSS)) return 0;
+    sctx->dirty[tile - state->grid] &= ~D_ONEPOSS;
 
     adjacencies(state, tile, edgeadj, tileadj);
 
@@ -1905,7 +1978,7 @@ static int solver_spaces_oneposs_cb(game_state *state, space *tile, void *ctx)
     }
     assert(dotx != -1 && doty != -1);
 
-    ret = solver_add_assoc(state, tile, dotx, doty, "rest are edges");
+    ret = solver_add_assoc(state, sctx, tile, dotx, doty, "rest are edges");
     if (ret == -1) return -1;
     assert(ret != 0); /* really should have done something. */
 
@@ -1997,21 +2070,20 @@ static bool solver_expand_checkdot(space *tile, space *dot)
     return false;
 }
 
+/* Set F_MARK on a tile, remembering to clear it again afterwards. */
+#define EXPAND_MARK(sp) do {                            \
+    (sp)->flags |= F_MARK;                              \
+    sctx->marked[nmarked++] = (sp);                     \
+} while (0)
+
 static void solver_expand_fromdot(game_state *state, space *dot, solver_ctx *sctx)
 {
-    int i, j, x, y, start, end, next;
-    space *sp;
+    int i, j, start, end, next, nmarked = 0;
 
-    /* Clear the grid of the (space) flags we'll use. */
-
-    /* This is well optimised; analysis showed that:
-        for (i = 0; i < sctx->sz; i++) state->grid[i].flags &= ~F_MARK;
-       took up ~85% of the total function time! */
-    for (y = 1; y < state->sy; y += 2) {
-        sp = &SPACE(state, 1, y);
-        for (x = 1; x < state->sx; x += 2, sp += 2)
-            sp->flags &= ~F_MARK;
-    }
+    /* No tile has F_MARK on entry: solver_expand_dots clears them all
+     * before the first call, and each call clears the (usually far
+     * fewer) tiles it marked before returning. Clearing the whole
+     * grid for every dot used to dominate the solver's running time. */
 
     /* Seed the list of marked squares with two that must be associated
      * with our dot (possibly the same space) */
@@ -2027,8 +2099,8 @@ static void solver_expand_fromdot(game_state *state, space *dot, solver_ctx *sct
     assert(sctx->scratch[0]->flags & F_TILE_ASSOC);
     assert(sctx->scratch[1]->flags & F_TILE_ASSOC);
 
-    sctx->scratch[0]->flags |= F_MARK;
-    sctx->scratch[1]->flags |= F_MARK;
+    EXPAND_MARK(sctx->scratch[0]);
+    EXPAND_MARK(sctx->scratch[1]);
 
     debug(("%*sexpand from dot %d,%d seeded with %d,%d and %d,%d.\n",
            solver_recurse_depth*4, "", dot->x, dot->y,
@@ -2059,7 +2131,7 @@ expand:
                 debug(("%*sMarking %d,%d, no opposite.\n",
                        solver_recurse_depth*4, "",
                        tileadj[j]->x, tileadj[j]->y));
-                tileadj[j]->flags |= F_MARK;
+                EXPAND_MARK(tileadj[j]);
                 continue; /* no opposite, so mark for next time. */
             }
             /* If the tile had an opposite we should have either seen both of
@@ -2080,8 +2152,8 @@ expand:
             debug(("%*sMarking %d,%d and %d,%d.\n",
                    solver_recurse_depth*4, "",
                        tileadj[j]->x, tileadj[j]->y, tileadj2->x, tileadj2->y));
-            tileadj[j]->flags |= F_MARK;
-            tileadj2->flags |= F_MARK;
+            EXPAND_MARK(tileadj[j]);
+            EXPAND_MARK(tileadj2);
         }
     }
     if (next > end) {
@@ -2111,9 +2183,13 @@ expand:
             sctx->scratch[i]->doty = dot->y;
         }
     }
+    for (i = 0; i < nmarked; i++)
+        sctx->marked[i]->flags &= ~F_MARK;
     dbg_state(state);
 }
 
+#undef EXPAND_MARK
+
 static int solver_expand_postcb(game_state *state, space *tile, void *ctx)
 {
     assert(tile->type == s_tile);
@@ -2127,7 +2203,8 @@ static int solver_expand_postcb(game_state *state, space *tile, void *ctx)
     }
     if (tile->flags & F_MULTIPLE) return 0;
 
-    return solver_add_assoc(state, tile, tile->dotx, tile->doty,
+    return solver_add_assoc(state, (solver_ctx *)ctx,
+                            tile, tile->dotx, tile->doty,
                             "single possible dot after expansion");
 }
 
@@ -2136,7 +2213,7 @@ static int solver_expand_dots(game_state *state, solver_ctx *sctx)
     int i;
 
     for (i = 0; i < sctx->sz; i++)
-        state->grid[i].flags &= ~(F_REACHABLE|F_MULTIPLE);
+        state->grid[i].flags &= ~(F_REACHABLE|F_MULTIPLE|F_MARK);
 
     for (i = 0; i < state->ndots; i++)
         solver_expand_fromdot(state, state->dots[i], sctx);
@@ -2209,7 +2286,7 @@ static int solver_recurse(game_state *state, int maxdiff)
         if (!dotfortile(state, rctx.best, state->dots[n])) continue;
 
         /* set cell (temporarily) pointing to that dot. */
-        solver_add_assoc(state, rctx.best,
+        solver_add_assoc(state, NULL, rctx.best,
                          state->dots[n]->x, state->dots[n]->y,
                          "Attempting for recursion");
 
@@ -3854,7 +3931,7 @@ const struct game thegame = {
     false,			       /* wants_statusbar */
 #endif
     false, game_timing_state,
-    REQUIRE_RBUTTON,		       /* flags */
+    REQUIRE_RBUTTON | PARALLEL_NEW_DESC, /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -13,9 +13,13 @@
 #include <ctype.h>
 #include <math.h>
 #include <float.h>
+#ifdef PARALLEL_GENERATION
+#include <pthread.h>
+#endif
 
 #include "puzzles.h"
 #include "tree234.h"
+#include "hashset.h"
 #include "grid.h"
 #include "penrose.h"
 
@@ -25,15 +29,55 @@
 #define DEBUG_GRID
 */
 
+/*
+ * Grids are shared between game states, and through the cache at the
+ * bottom of this file between games, so with PARALLEL_GENERATION one
+ * may be referenced from several threads at once. This lock covers
+ * every grid's refcount and the cache itself.
+ */
+#ifdef PARALLEL_GENERATION
+static pthread_mutex_t grid_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_GRIDS() pthread_mutex_lock(&grid_lock)
+#define UNLOCK_GRIDS() pthread_mutex_unlock(&grid_lock)
+#else
+#define LOCK_GRIDS() ((void)0)
+#define UNLOCK_GRIDS() ((void)0)
+#endif
+
+/*
+ * The index used by grid_nearest_edge: the grid's area is divided
+ * into square cells, and each cell lists (in increasing order) every
+ * edge that a point in that cell could possibly be near enough to.
+ * The lists for all cells are packed together as in the grid's own
+ * flat incidence arrays.
+ */
+struct grid_edge_index {
+    int x0, y0, cellsize, w, h;
+    int *start, *edges;
+};
+
 /* ----------------------------------------------------------------------
- * Deallocate or dereference a grid
+ * Reference, deallocate or dereference a grid
  */
+grid *grid_ref(grid *g)
+{
+    LOCK_GRIDS();
+    assert(g->refcount);
+    g->refcount++;
+    UNLOCK_GRIDS();
+    return g;
+}
+
 void grid_free(grid *g)
 {
+    int refcount;
+
+    LOCK_GRIDS();
     assert(g->refcount);
+    refcount = --g->refcount;
+    UNLOCK_GRIDS();
 
-    g->refcount--;
-    if (g->refcount == 0) {
+    if (refcount == 0) {
         int i;
         for (i = 0; i < g->num_faces; i++) {
             sfree(g->faces[i].dots);
@@ -46,6 +90,17 @@ void grid_free(grid *g)
         sfree(g->faces);
         sfree(g->edges);
         sfree(g->dots);
+        sfree(g->face_edge_start);
+        sfree(g->face_edges);
+        sfree(g->dot_edge_start);
+        sfree(g->dot_edges);
+        sfree(g->edge_dots);
+        sfree(g->edge_faces);
+        if (g->edge_index) {
+            sfree(g->edge_index->start);
+            sfree(g->edge_index->edges);
+            sfree(g->edge_index);
+        }
         sfree(g);
     }
 }
@@ -58,6 +113,10 @@ static grid *grid_empty(void)
     g->faces = NULL;
     g->edges = NULL;
     g->dots = NULL;
+    g->face_edge_start = g->face_edges = NULL;
+    g->dot_edge_start = g->dot_edges = NULL;
+    g->edge_dots = g->edge_faces = NULL;
+    g->edge_index = NULL;
     g->num_faces = g->num_edges = g->num_dots = 0;
     g->refcount = 1;
     g->lowest_x = g->lowest_y = g->highest_x = g->highest_y = 0;
@@ -88,6 +147,81 @@ static double point_line_distance(long px, long py,
     return det / len;
 }
 
+/*
+ * The region in which grid_nearest_edge will accept an edge is a
+ * rectangle along the edge, reaching half the edge's length to either
+ * side of it. Find a box enclosing that, with a little to spare.
+ */
+static void edge_hit_box(const grid_edge *e, int *x0, int *y0,
+                         int *x1, int *y1)
+{
+    long dx = (long)e->dot1->x - (long)e->dot2->x;
+    long dy = (long)e->dot1->y - (long)e->dot2->y;
+    int margin = (int)ceil(sqrt((double)(SQ(dx) + SQ(dy))) / 2) + 1;
+
+    *x0 = min(e->dot1->x, e->dot2->x) - margin;
+    *y0 = min(e->dot1->y, e->dot2->y) - margin;
+    *x1 = max(e->dot1->x, e->dot2->x) + margin;
+    *y1 = max(e->dot1->y, e->dot2->y) + margin;
+}
+
+static grid_edge_index *grid_build_edge_index(const grid *g)
+{
+    grid_edge_index *idx = snew(grid_edge_index);
+    int i, pass, x0, y0, x1, y1, xmax = 0, ymax = 0, cx, cy;
+    int *fill = NULL;
+
+    idx->cellsize = max(g->tilesize, 1);
+    for (i = 0; i < g->num_edges; i++) {
+        edge_hit_box(&g->edges[i], &x0, &y0, &x1, &y1);
+        if (i == 0 || x0 < idx->x0) idx->x0 = x0;
+        if (i == 0 || y0 < idx->y0) idx->y0 = y0;
+        if (i == 0 || x1 > xmax) xmax = x1;
+        if (i == 0 || y1 > ymax) ymax = y1;
+    }
+    if (g->num_edges == 0)
+        idx->x0 = idx->y0 = xmax = ymax = 0;
+    idx->w = (xmax - idx->x0) / idx->cellsize + 1;
+    idx->h = (ymax - idx->y0) / idx->cellsize + 1;
+    idx->start = snewn(idx->w * idx->h + 1, int);
+    for (i = 0; i <= idx->w * idx->h; i++)
+        idx->start[i] = 0;
+    idx->edges = NULL;
+
+    /*
+     * First count the edges in each cell, then go round again putting
+     * them in. Edges are visited in order both times, so each cell's
+     * list comes out sorted.
+     */
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < g->num_edges; i++) {
+            edge_hit_box(&g->edges[i], &x0, &y0, &x1, &y1);
+            x0 = (x0 - idx->x0) / idx->cellsize;
+            y0 = (y0 - idx->y0) / idx->cellsize;
+            x1 = (x1 - idx->x0) / idx->cellsize;
+            y1 = (y1 - idx->y0) / idx->cellsize;
+            for (cy = y0; cy <= y1; cy++)
+                for (cx = x0; cx <= x1; cx++) {
+                    int c = cy * idx->w + cx;
+                    if (pass == 0)
+                        idx->start[c+1]++;
+                    else
+                        idx->edges[fill[c]++] = i;
+                }
+        }
+        if (pass == 0) {
+            for (i = 0; i < idx->w * idx->h; i++)
+                idx->start[i+1] += idx->start[i];
+            idx->edges = snewn(max(idx->start[idx->w * idx->h], 1), int);
+            fill = snewn(idx->w * idx->h, int);
+            memcpy(fill, idx->start, idx->w * idx->h * sizeof(int));
+        }
+    }
+    sfree(fill);
+
+    return idx;
+}
+
 /* Determine nearest edge to where the user clicked.
  * (x, y) is the clicked location, converted to grid coordinates.
  * Returns the nearest edge, or NULL if no edge is reasonably
@@ -110,13 +244,29 @@ static double point_line_distance(long px, long py,
 grid_edge *grid_nearest_edge(grid *g, int x, int y)
 {
     grid_edge *best_edge;
+    grid_edge_index *idx;
     double best_distance = 0;
-    int i;
+    int cx, cy, c, i;
+
+    /* The grid may be shared, so don't race to build its index. */
+    LOCK_GRIDS();
+    if (!g->edge_index)
+        g->edge_index = grid_build_edge_index(g);
+    idx = g->edge_index;
+    UNLOCK_GRIDS();
+
+    if (x < idx->x0 || y < idx->y0)
+        return NULL;
+    cx = (x - idx->x0) / idx->cellsize;
+    cy = (y - idx->y0) / idx->cellsize;
+    if (cx >= idx->w || cy >= idx->h)
+        return NULL;
+    c = cy * idx->w + cx;
 
     best_edge = NULL;
 
-    for (i = 0; i < g->num_edges; i++) {
-        grid_edge *e = &g->edges[i];
+    for (i = idx->start[c]; i < idx->start[c+1]; i++) {
+        grid_edge *e = &g->edges[idx->edges[i]];
         long e2; /* squared length of edge */
         long a2, b2; /* squared lengths of other sides */
         double dist;
@@ -786,22 +936,49 @@ static void grid_make_consistent(grid *g)
         }
     }
 
+    /* ====== Stage 5 ======
+     * Flatten the incidence lists into integer index arrays
+     */
+    g->face_edge_start = snewn(g->num_faces + 1, int);
+    /* Every edge borders at most two faces and has exactly two dots,
+     * which bounds the sizes of both lists. */
+    g->face_edges = snewn(2 * g->num_edges, int);
+    g->face_edge_start[0] = 0;
+    for (i = 0; i < g->num_faces; i++) {
+        grid_face *f = g->faces + i;
+        int j, start = g->face_edge_start[i];
+        for (j = 0; j < f->order; j++)
+            g->face_edges[start + j] = f->edges[j] - g->edges;
+        g->face_edge_start[i+1] = start + f->order;
+    }
+
+    g->dot_edge_start = snewn(g->num_dots + 1, int);
+    g->dot_edges = snewn(2 * g->num_edges, int);
+    g->dot_edge_start[0] = 0;
+    for (i = 0; i < g->num_dots; i++) {
+        grid_dot *d = g->dots + i;
+        int j, start = g->dot_edge_start[i];
+        for (j = 0; j < d->order; j++)
+            g->dot_edges[start + j] = d->edges[j] - g->edges;
+        g->dot_edge_start[i+1] = start + d->order;
+    }
+
+    g->edge_dots = snewn(2 * g->num_edges, int);
+    g->edge_faces = snewn(2 * g->num_edges, int);
+    for (i = 0; i < g->num_edges; i++) {
+        grid_edge *e = g->edges + i;
+        g->edge_dots[2*i] = e->dot1 - g->dots;
+        g->edge_dots[2*i+1] = e->dot2 - g->dots;
+        g->edge_faces[2*i] = e->face1 ? e->face1 - g->faces : -1;
+        g->edge_faces[2*i+1] = e->face2 ? e->face2 - g->faces : -1;
+    }
+
     grid_debug_derived(g);
 }
 
 /* Helpers for making grid-generation easier.  These functions are only
  * intended for use during grid generation. */
 
-/* Comparison function for the (tree234) sorted dot list */
-static int grid_point_cmp_fn(void *v1, void *v2)
-{
-    grid_dot *p1 = v1;
-    grid_dot *p2 = v2;
-    if (p1->y != p2->y)
-        return p2->y - p1->y;
-    else
-        return p2->x - p1->x;
-}
 /* Add a new face to the grid, with its dot list allocated.
  * Assumes there's enough space allocated for the new face in grid->faces */
 static void grid_face_add_new(grid *g, int face_size)
@@ -832,22 +1009,16 @@ static grid_dot *grid_dot_add_new(grid *g, int x, int y)
  * in the dot_list, or add a new dot to the grid (and the dot_list) and
  * return that.
  * Assumes g->dots has enough capacity allocated */
-static grid_dot *grid_get_dot(grid *g, tree234 *dot_list, int x, int y)
+static grid_dot *grid_get_dot(grid *g, intmap *dot_list, int x, int y)
 {
-    grid_dot test, *ret;
+    long long key = (long long)x * 0x100000000LL + (unsigned int)y;
+    int *index = intmap_find(dot_list, key);
 
-    test.order = 0;
-    test.edges = NULL;
-    test.faces = NULL;
-    test.x = x;
-    test.y = y;
-    ret = find234(dot_list, &test, NULL);
-    if (ret)
-        return ret;
+    if (index)
+        return g->dots + *index;
 
-    ret = grid_dot_add_new(g, x, y);
-    add234(dot_list, ret);
-    return ret;
+    intmap_set(dot_list, key, g->num_dots);
+    return grid_dot_add_new(g, x, y);
 }
 
 /* Sets the last face of the grid to include this dot, at this position
@@ -1225,22 +1396,96 @@ void grid_find_incentre(grid_face *f)
                 /*
                  * Now go through our candidate points and see if any
                  * of them are better than what we've got so far.
+                 *
+                 * Most candidates are nowhere near the incentre, and
+                 * a candidate can only win by beating bestdist, so we
+                 * measure its distance from the polygon boundary
+                 * first and stop as soon as that falls to bestdist or
+                 * below. Only the few survivors pay for the
+                 * inside-the-polygon test. Since a point must pass
+                 * both tests to be chosen, doing them in this order
+                 * picks exactly the point the full checks would.
                  */
                 for (m = 0; m < cn; m++) {
                     double x = cx[m], y = cy[m];
+#ifdef HUGE_VAL
+                    double mindist = HUGE_VAL;
+#else
+#ifdef DBL_MAX
+                    double mindist = DBL_MAX;
+#else
+#error No way to get maximum floating-point number.
+#endif
+#endif
+                    int e, d;
+                    bool in;
+
+                    /*
+                     * Check the candidate's minimum distance to every
+                     * corner ...
+                     */
+                    for (d = 0; d < f->order && mindist > bestdist; d++) {
+                        int xp = f->dots[d]->x;
+                        int yp = f->dots[d]->y;
+                        double dx = x - xp, dy = y - yp;
+                        double dist = dx*dx + dy*dy;
+                        if (mindist > dist)
+                            mindist = dist;
+                    }
+
+                    /*
+                     * ... and now also check the perpendicular distance
+                     * to every edge, if the perpendicular lies between
+                     * the edge's endpoints.
+                     */
+                    for (e = 0; e < f->order && mindist > bestdist; e++) {
+                        int xs = f->edges[e]->dot1->x;
+                        int xe = f->edges[e]->dot2->x;
+                        int ys = f->edges[e]->dot1->y;
+                        int ye = f->edges[e]->dot2->y;
+
+                        /*
+                         * If s and e are our endpoints, and p our
+                         * candidate circle centre, the foot of a
+                         * perpendicular from p to the line se lies
+                         * between s and e if and only if (p-s).(e-s) lies
+                         * strictly between 0 and (e-s).(e-s).
+                         */
+                        int edx = xe - xs, edy = ye - ys;
+                        double pdx = x - xs, pdy = y - ys;
+                        double pde = pdx * edx + pdy * edy;
+                        long ede = (long)edx * edx + (long)edy * edy;
+                        if (0 < pde && pde < ede) {
+                            /*
+                             * Yes, the nearest point on this edge is
+                             * closer than either endpoint, so we must
+                             * take it into account by measuring the
+                             * perpendicular distance to the edge and
+                             * checking its square against mindist.
+                             */
+
+                            double pdre = pdx * edy - pdy * edx;
+                            double sqlen = pdre * pdre / ede;
+
+                            if (mindist > sqlen)
+                                mindist = sqlen;
+                        }
+                    }
+
+                    if (!(bestdist < mindist))
+                        continue;
 
                     /*
-                     * First, disqualify the point if it's not inside
-                     * the polygon, which we work out by counting the
-                     * edges to the right of the point. (For
-                     * tiebreaking purposes when edges start or end on
-                     * our y-coordinate or go right through it, we
-                     * consider our point to be offset by a small
-                     * _positive_ epsilon in both the x- and
-                     * y-direction.)
+                     * This point would be the best so far, so now
+                     * disqualify it if it's not inside the polygon,
+                     * which we work out by counting the edges to the
+                     * right of the point. (For tiebreaking purposes
+                     * when edges start or end on our y-coordinate or
+                     * go right through it, we consider our point to
+                     * be offset by a small _positive_ epsilon in both
+                     * the x- and y-direction.)
                      */
-                    int e;
-                    bool in = false;
+                    in = false;
                     for (e = 0; e < f->order; e++) {
                         int xs = f->edges[e]->dot1->x;
                         int xe = f->edges[e]->dot2->x;
@@ -1270,80 +1515,15 @@ void grid_find_incentre(grid_face *f)
                         }
                     }
 
+                    /*
+                     * Right. Now we know the biggest circle around this
+                     * point, and that it's inside the polygon, so it's
+                     * our new best.
+                     */
                     if (in) {
-#ifdef HUGE_VAL
-                        double mindist = HUGE_VAL;
-#else
-#ifdef DBL_MAX
-                        double mindist = DBL_MAX;
-#else
-#error No way to get maximum floating-point number.
-#endif
-#endif
-                        int e, d;
-
-                        /*
-                         * This point is inside the polygon, so now we check
-                         * its minimum distance to every edge and corner.
-                         * First the corners ...
-                         */
-                        for (d = 0; d < f->order; d++) {
-                            int xp = f->dots[d]->x;
-                            int yp = f->dots[d]->y;
-                            double dx = x - xp, dy = y - yp;
-                            double dist = dx*dx + dy*dy;
-                            if (mindist > dist)
-                                mindist = dist;
-                        }
-
-                        /*
-                         * ... and now also check the perpendicular distance
-                         * to every edge, if the perpendicular lies between
-                         * the edge's endpoints.
-                         */
-                        for (e = 0; e < f->order; e++) {
-                            int xs = f->edges[e]->dot1->x;
-                            int xe = f->edges[e]->dot2->x;
-                            int ys = f->edges[e]->dot1->y;
-                            int ye = f->edges[e]->dot2->y;
-
-                            /*
-                             * If s and e are our endpoints, and p our
-                             * candidate circle centre, the foot of a
-                             * perpendicular from p to the line se lies
-                             * between s and e if and only if (p-s).(e-s) lies
-                             * strictly between 0 and (e-s).(e-s).
-                             */
-                            int edx = xe - xs, edy = ye - ys;
-                            double pdx = x - xs, pdy = y - ys;
-                            double pde = pdx * edx + pdy * edy;
-                            long ede = (long)edx * edx + (long)edy * edy;
-                            if (0 < pde && pde < ede) {
-                                /*
-                                 * Yes, the nearest point on this edge is
-                                 * closer than either endpoint, so we must
-                                 * take it into account by measuring the
-                                 * perpendicular distance to the edge and
-                                 * checking its square against mindist.
-                                 */
-
-                                double pdre = pdx * edy - pdy * edx;
-                                double sqlen = pdre * pdre / ede;
-
-                                if (mindist > sqlen)
-                                    mindist = sqlen;
-                            }
-                        }
-
-                        /*
-                         * Right. Now we know the biggest circle around this
-                         * point, so we can check it against bestdist.
-                         */
-                        if (bestdist < mindist) {
-                            bestdist = mindist;
-                            xbest = x;
-                            ybest = y;
-                        }
+                        bestdist = mindist;
+                        xbest = x;
+                        ybest = y;
                     }
                 }
 
@@ -1377,9 +1557,9 @@ void grid_find_incentre(grid_face *f)
  * a new face reuses an existing dot.  For example, two squares touching at an
  * edge would generate six unique dots: four dots from the first face, then
  * two additional dots for the second face, because we detect the other two
- * dots have already been taken up.  This list is stored in a tree234
- * called "points".  No extra memory-allocation needed here - we store the
- * actual grid_dot* pointers, which all point into the g->dots list.
+ * dots have already been taken up.  This list is stored in an intmap
+ * called "points", keyed on the dot coordinates, whose values are indices
+ * into the g->dots list.
  * For this reason, we have to calculate coordinates in such a way as to
  * eliminate any rounding errors, so we can detect when a dot on one
  * face precisely lands on a dot of a different face.  No floating-point
@@ -1408,14 +1588,14 @@ static grid *grid_new_square(int width, int height, const char *desc)
     int max_faces = width * height;
     int max_dots = (width + 1) * (height + 1);
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = a;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     /* generate square faces */
     for (y = 0; y < height; y++) {
@@ -1437,7 +1617,7 @@ static grid *grid_new_square(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -1471,14 +1651,14 @@ static grid *grid_new_honeycomb(int width, int height, const char *desc)
     int max_faces = width * height;
     int max_dots = 2 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = HONEY_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     /* generate hexagonal faces */
     for (y = 0; y < height; y++) {
@@ -1506,7 +1686,7 @@ static grid *grid_new_honeycomb(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -1649,7 +1829,7 @@ static grid *grid_new_triangular(int width, int height, const char *desc)
          *   5x5t1:0_21120b11a1a01a1a00c1a0b211021c1h1a2a1a0a
          *   5x6t1:0_a1212c22c2a02a2f22a0c12a110d0e1c0c0a101121a1
          */
-        tree234 *points = newtree234(grid_point_cmp_fn);
+        intmap *points = intmap_new();
         /* Upper bounds - don't have to be exact */
         int max_faces = height * (2*width+1);
         int max_dots = (height+1) * (width+1) * 4;
@@ -1702,7 +1882,7 @@ static grid *grid_new_triangular(int width, int height, const char *desc)
             }
         }
 
-        freetree234(points);
+        intmap_free(points);
         assert(g->num_faces <= max_faces);
         assert(g->num_dots <= max_dots);
     }
@@ -1737,14 +1917,14 @@ static grid *grid_new_snubsquare(int width, int height, const char *desc)
     int max_faces = 3 * width * height;
     int max_dots = 2 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = SNUBSQUARE_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -1817,7 +1997,7 @@ static grid *grid_new_snubsquare(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -1850,14 +2030,14 @@ static grid *grid_new_cairo(int width, int height, const char *desc)
     int max_faces = 2 * width * height;
     int max_dots = 3 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = CAIRO_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -1923,7 +2103,7 @@ static grid *grid_new_cairo(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -1957,14 +2137,14 @@ static grid *grid_new_greathexagonal(int width, int height, const char *desc)
     int max_faces = 6 * (width + 1) * (height + 1);
     int max_dots = 6 * width * height;
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = GREATHEX_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2053,7 +2233,7 @@ static grid *grid_new_greathexagonal(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2087,14 +2267,14 @@ static grid *grid_new_kagome(int width, int height, const char *desc)
     int max_faces = 6 * (width + 1) * (height + 1);
     int max_dots = 6 * width * height;
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = KAGOME_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2149,7 +2329,7 @@ static grid *grid_new_kagome(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2183,14 +2363,14 @@ static grid *grid_new_octagonal(int width, int height, const char *desc)
     int max_faces = 2 * width * height;
     int max_dots = 4 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = OCTAGONAL_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2232,7 +2412,7 @@ static grid *grid_new_octagonal(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2266,14 +2446,14 @@ static grid *grid_new_kites(int width, int height, const char *desc)
     int max_faces = 6 * width * height;
     int max_dots = 6 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = KITE_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2352,7 +2532,7 @@ static grid *grid_new_kites(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2397,14 +2577,14 @@ static grid *grid_new_floret(int width, int height, const char *desc)
     int max_faces = 6 * width * height;
     int max_dots = 9 * (width + 1) * (height + 1);
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = FLORET_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     /* generate pentagonal faces */
     for (y = 0; y < height; y++) {
@@ -2462,7 +2642,7 @@ static grid *grid_new_floret(int width, int height, const char *desc)
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2497,14 +2677,14 @@ static grid *grid_new_dodecagonal(int width, int height, const char *desc)
     int max_faces = 3 * width * height;
     int max_dots = 14 * width * height;
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2548,7 +2728,7 @@ static grid *grid_new_dodecagonal(int width, int height, const char *desc)
 	}
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2578,14 +2758,14 @@ static grid *grid_new_greatdodecagonal(int width, int height, const char *desc)
     int max_faces = 30 * width * height;
     int max_dots = 200 * width * height;
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2662,7 +2842,7 @@ static grid *grid_new_greatdodecagonal(int width, int height, const char *desc)
 	}
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2692,14 +2872,14 @@ static grid *grid_new_greatgreatdodecagonal(int width, int height, const char *d
     int max_faces = 50 * width * height;
     int max_dots = 300 * width * height;
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2831,7 +3011,7 @@ static grid *grid_new_greatgreatdodecagonal(int width, int height, const char *d
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2861,14 +3041,14 @@ static grid *grid_new_compassdodecagonal(int width, int height, const char *desc
     int max_faces = 6 * width * height;
     int max_dots = 18 * width * height;
 
-    tree234 *points;
+    intmap *points;
 
     grid *g = grid_empty();
     g->tilesize = DODEC_TILESIZE;
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     for (y = 0; y < height; y++) {
         for (x = 0; x < width; x++) {
@@ -2927,7 +3107,7 @@ static grid *grid_new_compassdodecagonal(int width, int height, const char *desc
         }
     }
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -2940,7 +3120,7 @@ typedef struct setface_ctx
     int xmin, xmax, ymin, ymax;
 
     grid *g;
-    tree234 *points;
+    intmap *points;
 } setface_ctx;
 
 static double round_int_nearest_away(double r)
@@ -3098,7 +3278,7 @@ static grid *grid_new_penrose(int width, int height, int which, const char *desc
     int xsz, ysz, xoff, yoff, aoff;
     double rradius;
 
-    tree234 *points;
+    intmap *points;
     grid *g;
 
     penrose_state ps;
@@ -3121,7 +3301,7 @@ static grid *grid_new_penrose(int width, int height, int which, const char *desc
     g->faces = snewn(max_faces, grid_face);
     g->dots = snewn(max_dots, grid_dot);
 
-    points = newtree234(grid_point_cmp_fn);
+    points = intmap_new();
 
     memset(&sf_ctx, 0, sizeof(sf_ctx));
     sf_ctx.g = g;
@@ -3142,6 +3322,13 @@ static grid *grid_new_penrose(int width, int height, int which, const char *desc
     sf_ctx.ymin = yoff - ysz/2;
     sf_ctx.ymax = yoff + ysz/2;
 
+    /* Don't bother subdividing anything set_faces would throw away. */
+    ps.clip = 1;
+    ps.xmin = sf_ctx.xmin;
+    ps.xmax = sf_ctx.xmax;
+    ps.ymin = sf_ctx.ymin;
+    ps.ymax = sf_ctx.ymax;
+
     debug(("penrose: centre (%f, %f) xsz %f ysz %f",
            0.0, 0.0, xsz, ysz));
     debug(("penrose: x range (%f --> %f), y range (%f --> %f)",
@@ -3149,7 +3336,7 @@ static grid *grid_new_penrose(int width, int height, int which, const char *desc
 
     penrose(&ps, which, aoff);
 
-    freetree234(points);
+    intmap_free(points);
     assert(g->num_faces <= max_faces);
     assert(g->num_dots <= max_dots);
 
@@ -3242,12 +3429,100 @@ const char *grid_validate_desc(grid_type type, int width, int height,
     }
 }
 
+/*
+ * A small cache of recently built grids, most recently used first,
+ * each holding a reference of its own. Building a big or aperiodic
+ * grid is a lot of work, and both starting a new game and generating
+ * one tend to ask for the same grid many times in a row.
+ */
+#define GRID_CACHE_SIZE 4
+
+struct grid_cache_entry {
+    grid_type type;
+    int width, height;
+    char *desc;                        /* NULL if the grid has none */
+    grid *g;
+};
+
+static struct grid_cache_entry grid_cache[GRID_CACHE_SIZE];
+static int grid_cache_len;
+
+static int grid_cache_find(grid_type type, int width, int height,
+                           const char *desc)
+{
+    int i;
+
+    for (i = 0; i < grid_cache_len; i++) {
+        struct grid_cache_entry *ent = &grid_cache[i];
+        if (ent->type == type && ent->width == width &&
+            ent->height == height &&
+            (ent->desc && desc ? !strcmp(ent->desc, desc) :
+             ent->desc == desc))
+            return i;
+    }
+    return -1;
+}
+
+/* Move entry i to the front of the cache. Called with the lock held. */
+static void grid_cache_promote(int i)
+{
+    struct grid_cache_entry ent = grid_cache[i];
+    memmove(grid_cache + 1, grid_cache, i * sizeof(*grid_cache));
+    grid_cache[0] = ent;
+}
+
 grid *grid_new(grid_type type, int width, int height, const char *desc)
 {
     const char *err = grid_validate_desc(type, width, height, desc);
+    struct grid_cache_entry evicted;
+    grid *g;
+    int i;
+
     if (err) assert(!"Invalid grid description.");
 
-    return grid_news[type](width, height, desc);
+    LOCK_GRIDS();
+    i = grid_cache_find(type, width, height, desc);
+    if (i >= 0) {
+        grid_cache_promote(i);
+        g = grid_cache[0].g;
+        g->refcount++;
+        UNLOCK_GRIDS();
+        return g;
+    }
+    UNLOCK_GRIDS();
+
+    /* Build the grid without holding the lock, since it can be slow. */
+    g = grid_news[type](width, height, desc);
+
+    LOCK_GRIDS();
+    i = grid_cache_find(type, width, height, desc);
+    if (i >= 0) {
+        /* Another thread got there first; use its copy instead. */
+        grid *ours = g;
+        grid_cache_promote(i);
+        g = grid_cache[0].g;
+        g->refcount++;
+        UNLOCK_GRIDS();
+        grid_free(ours);
+        return g;
+    }
+    evicted.g = NULL;
+    if (grid_cache_len == GRID_CACHE_SIZE)
+        evicted = grid_cache[--grid_cache_len];
+    grid_cache[grid_cache_len].type = type;
+    grid_cache[grid_cache_len].width = width;
+    grid_cache[grid_cache_len].height = height;
+    grid_cache[grid_cache_len].desc = desc ? dupstr(desc) : NULL;
+    grid_cache[grid_cache_len].g = g;
+    grid_cache_promote(grid_cache_len++);
+    g->refcount++;                     /* one for the cache, one for us */
+    UNLOCK_GRIDS();
+
+    if (evicted.g) {
+        sfree(evicted.desc);
+        grid_free(evicted.g);
+    }
+    return g;
 }
 
 void grid_compute_size(grid_type type, int width, int height,
@@ -31,6 +31,7 @@
 typedef struct grid_face grid_face;
 typedef struct grid_edge grid_edge;
 typedef struct grid_dot grid_dot;
+typedef struct grid_edge_index grid_edge_index;
 
 struct grid_face {
   int order; /* Number of edges, also the number of dots */
@@ -85,8 +86,31 @@ typedef struct grid {
    * of a square cell. */
   int tilesize;
 
+  /* The same incidence relationships again, as integer indices into
+   * the lists above, packed into a few contiguous arrays for code that
+   * walks the whole grid repeatedly (such as a solver) and would rather
+   * not chase pointers. These are filled in along with everything else
+   * when the grid is generated, in the same order as the pointer lists.
+   *
+   * The edges around face i are face_edges[face_edge_start[i]] up to
+   * (but not including) face_edges[face_edge_start[i+1]], and the
+   * edges around dot i are found from dot_edge_start and dot_edges in
+   * the same way. Edge i joins dots edge_dots[2*i] and edge_dots[2*i+1]
+   * (its dot1 and dot2), and separates faces edge_faces[2*i] and
+   * edge_faces[2*i+1] (its face1 and face2), using -1 for the infinite
+   * outside face. */
+  int *face_edge_start, *face_edges;
+  int *dot_edge_start, *dot_edges;
+  int *edge_dots, *edge_faces;
+
+  /* A spatial index for grid_nearest_edge, built the first time that
+   * is called on this grid. */
+  grid_edge_index *edge_index;
+
   /* We really don't want to copy this monstrosity!
-   * A grid is immutable once generated.
+   * A grid is immutable once generated. Take another reference with
+   * grid_ref and drop one with grid_free, rather than touching this
+   * directly, since grids can be shared between threads.
    */
   int refcount;
 } grid;
@@ -121,8 +145,12 @@ char *grid_new_desc(grid_type type, int width, int height, random_state *rs);
 const char *grid_validate_desc(grid_type type, int width, int height,
                                const char *desc);
 
+/* Grids recently returned by grid_new are cached, so asking for the
+ * same type, size and description again returns another reference to
+ * the same (immutable) grid. */
 grid *grid_new(grid_type type, int width, int height, const char *desc);
 
+grid *grid_ref(grid *g);
 void grid_free(grid *g);
 
 grid_edge *grid_nearest_edge(grid *g, int x, int y);
@@ -154,6 +154,15 @@ struct internal_drawing_api {
 #endif
 };
 
+/*
+ * A rectangle of the puzzle image changed by the current redraw,
+ * with exclusive right and bottom edges.
+ */
+#define MAX_DAMAGE 16
+struct damage {
+    int l, r, u, d;
+};
+
 /*
  * This structure holds all the data relevant to a single window.
  * In principle this would allow us to open multiple independent
@@ -191,7 +200,8 @@ struct frontend {
     int backgroundindex;	       /* which of colours[] is background */
 #endif
     int ncolours;
-    int bbox_l, bbox_r, bbox_u, bbox_d;
+    struct damage damage[MAX_DAMAGE];
+    int ndamage;
     bool timer_active;
     int timer_id;
     struct timeval last_time;
@@ -349,14 +359,14 @@ static void teardown_drawing(frontend *fe)
     fe->cr = NULL;
 
 #ifndef USE_CAIRO_WITHOUT_PIXMAP
-    if (!fe->headless) {
+    if (!fe->headless && fe->ndamage) {
         cairo_t *cr = gdk_cairo_create(fe->pixmap);
+        int i;
         cairo_set_source_surface(cr, fe->image, 0, 0);
-        cairo_rectangle(cr,
-                        fe->bbox_l - 1,
-                        fe->bbox_u - 1,
-                        fe->bbox_r - fe->bbox_l + 2,
-                        fe->bbox_d - fe->bbox_u + 2);
+        for (i = 0; i < fe->ndamage; i++)
+            cairo_rectangle(cr, fe->damage[i].l, fe->damage[i].u,
+                            fe->damage[i].r - fe->damage[i].l,
+                            fe->damage[i].d - fe->damage[i].u);
         cairo_fill(cr);
         cairo_destroy(cr);
     }
@@ -1132,10 +1142,7 @@ static void align_and_draw_text(int index, int align, int x, int y,
 void gtk_start_draw(void *handle)
 {
     frontend *fe = (frontend *)handle;
-    fe->bbox_l = fe->w;
-    fe->bbox_r = 0;
-    fe->bbox_u = fe->h;
-    fe->bbox_d = 0;
+    fe->ndamage = 0;
     setup_drawing(fe);
 }
 
@@ -1253,34 +1260,97 @@ void gtk_blitter_load(void *handle, blitter *bl, int x, int y)
     do_blitter_load(fe, bl, x, y);
 }
 
+static long damage_area(int l, int r, int u, int d)
+{
+    return (long)(r - l) * (d - u);
+}
+
 void gtk_draw_update(void *handle, int x, int y, int w, int h)
 {
     frontend *fe = (frontend *)handle;
-    if (fe->bbox_l > x  ) fe->bbox_l = x  ;
-    if (fe->bbox_r < x+w) fe->bbox_r = x+w;
-    if (fe->bbox_u > y  ) fe->bbox_u = y  ;
-    if (fe->bbox_d < y+h) fe->bbox_d = y+h;
+    struct damage *dm;
+    int l, r, u, d, i, best;
+    long cost, bestcost;
+
+    if (w <= 0 || h <= 0)
+        return;
+
+    /* Allow a pixel either side for antialiasing spilling over. */
+    l = x - 1;
+    r = x + w + 1;
+    u = y - 1;
+    d = y + h + 1;
+
+    /*
+     * Keep the damaged rectangles disjoint, so nothing is copied
+     * twice: absorb any existing one that the new one overlaps or
+     * touches. The union might now reach others, so start again
+     * after each merge. If that still leaves no room, merge with
+     * whichever rectangle makes the smallest union.
+     */
+    i = 0;
+    while (i < fe->ndamage || fe->ndamage == MAX_DAMAGE) {
+        if (i == fe->ndamage) {
+            best = 0;
+            bestcost = 0;
+            for (i = 0; i < fe->ndamage; i++) {
+                dm = &fe->damage[i];
+                cost = damage_area(min(l, dm->l), max(r, dm->r),
+                                   min(u, dm->u), max(d, dm->d)) -
+                    damage_area(dm->l, dm->r, dm->u, dm->d);
+                if (i == 0 || cost < bestcost) {
+                    best = i;
+                    bestcost = cost;
+                }
+            }
+            i = best;
+        } else {
+            dm = &fe->damage[i];
+            if (dm->l > r || l > dm->r || dm->u > d || u > dm->d) {
+                i++;
+                continue;
+            }
+        }
+        dm = &fe->damage[i];
+        l = min(l, dm->l);
+        r = max(r, dm->r);
+        u = min(u, dm->u);
+        d = max(d, dm->d);
+        *dm = fe->damage[--fe->ndamage];
+        i = 0;
+    }
+
+    dm = &fe->damage[fe->ndamage++];
+    dm->l = l;
+    dm->r = r;
+    dm->u = u;
+    dm->d = d;
 }
 
 void gtk_end_draw(void *handle)
 {
     frontend *fe = (frontend *)handle;
+    int i;
 
     teardown_drawing(fe);
 
-    if (fe->bbox_l < fe->bbox_r && fe->bbox_u < fe->bbox_d && !fe->headless) {
+    if (fe->headless)
+        return;
+
+    /*
+     * Only the damaged rectangles need to reach the screen. GTK
+     * collects queued areas into a region rather than a bounding
+     * box, so two far-apart changes don't repaint everything
+     * between them.
+     */
+    for (i = 0; i < fe->ndamage; i++) {
+        struct damage *dm = &fe->damage[i];
 #ifdef USE_CAIRO_WITHOUT_PIXMAP
-        gtk_widget_queue_draw_area(fe->area,
-                                   fe->bbox_l - 1 + fe->ox,
-                                   fe->bbox_u - 1 + fe->oy,
-                                   fe->bbox_r - fe->bbox_l + 2,
-                                   fe->bbox_d - fe->bbox_u + 2);
+        gtk_widget_queue_draw_area(fe->area, dm->l + fe->ox, dm->u + fe->oy,
+                                   dm->r - dm->l, dm->d - dm->u);
 #else
-	repaint_rectangle(fe, fe->area,
-			  fe->bbox_l - 1 + fe->ox,
-			  fe->bbox_u - 1 + fe->oy,
-			  fe->bbox_r - fe->bbox_l + 2,
-			  fe->bbox_d - fe->bbox_u + 2);
+	repaint_rectangle(fe, fe->area, dm->l + fe->ox, dm->u + fe->oy,
+			  dm->r - dm->l, dm->d - dm->u);
 #endif
     }
 }
@@ -1584,7 +1654,6 @@ static gint motion_event(GtkWidget *widget, GdkEventMotion *event,
 static gint draw_area(GtkWidget *widget, cairo_t *cr, gpointer data)
 {
     frontend *fe = (frontend *)data;
-    GdkRectangle dirtyrect;
 
     cairo_surface_t *target_surface = cairo_get_target(cr);
     cairo_matrix_t m;
@@ -1594,11 +1663,13 @@ static gint draw_area(GtkWidget *widget, cairo_t *cr, gpointer data)
     cairo_surface_set_device_scale(target_surface, 1.0, 1.0);
     cairo_translate(cr, m.x0 * (orig_sx - 1.0), m.y0 * (orig_sy - 1.0));
 
-    gdk_cairo_get_clip_rectangle(cr, &dirtyrect);
+    /*
+     * The clip is the exact region needing a repaint, which may be
+     * several separate rectangles; painting through it copies just
+     * those rather than their bounding box.
+     */
     cairo_set_source_surface(cr, fe->image, fe->ox, fe->oy);
-    cairo_rectangle(cr, dirtyrect.x, dirtyrect.y,
-                    dirtyrect.width, dirtyrect.height);
-    cairo_fill(cr);
+    cairo_paint(cr);
 
     cairo_surface_set_device_scale(target_surface, orig_sx, orig_sy);
 
@@ -1614,14 +1685,18 @@ static gint expose_area(GtkWidget *widget, GdkEventExpose *event,
 #ifdef USE_CAIRO_WITHOUT_PIXMAP
         cairo_t *cr = gdk_cairo_create(gtk_widget_get_window(widget));
         cairo_set_source_surface(cr, fe->image, fe->ox, fe->oy);
-        cairo_rectangle(cr, event->area.x, event->area.y,
-                        event->area.width, event->area.height);
+        gdk_cairo_region(cr, event->region);
         cairo_fill(cr);
         cairo_destroy(cr);
 #else
-	repaint_rectangle(fe, widget,
-			  event->area.x, event->area.y,
-			  event->area.width, event->area.height);
+        GdkRectangle *rects;
+        int i, nrects;
+
+        gdk_region_get_rectangles(event->region, &rects, &nrects);
+        for (i = 0; i < nrects; i++)
+            repaint_rectangle(fe, widget, rects[i].x, rects[i].y,
+                              rects[i].width, rects[i].height);
+        g_free(rects);
 #endif
     }
     return true;
@@ -3582,7 +3657,7 @@ int main(int argc, char **argv)
     int ngenerate = 0, px = 1, py = 1;
     bool print = false;
     bool time_generation = false, test_solve = false, list_presets = false;
-    bool soln = false, colour = false;
+    bool soln = false, colour = false, stream = false;
     float scale = 1.0F;
     float redo_proportion = 0.0F;
     const char *savefile = NULL, *savesuffix = NULL;
@@ -3741,6 +3816,8 @@ int main(int argc, char **argv)
 		return 1;
 	    }
 	    colour = true;
+	} else if (doing_opts && !strcmp(p, "--stream")) {
+	    stream = true;
 	} else if (doing_opts && !strcmp(p, "--load")) {
 	    argtype = ARG_SAVE;
 	} else if (doing_opts && !strcmp(p, "--game")) {
@@ -3787,6 +3864,7 @@ int main(int argc, char **argv)
 	midend *me;
 	char *id;
 	document *doc = NULL;
+	psdata *ps = NULL;
 
         /*
          * If we're in this branch, we should display any pending
@@ -3808,8 +3886,18 @@ int main(int argc, char **argv)
 	if (!savefile && savesuffix)
 	    savefile = "";
 
-	if (print)
+	if (print) {
 	    doc = document_new(px, py, scale);
+	    /*
+	     * If asked to, stream the document, so that each page is
+	     * written out and freed as soon as it fills, rather than
+	     * holding every puzzle in memory until the end.
+	     */
+	    if (stream) {
+		ps = ps_init(stdout, colour);
+		document_begin_stream(doc, ps_drawing_api(ps));
+	    }
+	}
 
 	/*
 	 * In this loop, we either generate a game ID or read one
@@ -3966,8 +4054,12 @@ int main(int argc, char **argv)
 	}
 
 	if (doc) {
-	    psdata *ps = ps_init(stdout, colour);
-	    document_print(doc, ps_drawing_api(ps));
+	    if (stream) {
+		document_end_stream(doc);
+	    } else {
+		ps = ps_init(stdout, colour);
+		document_print(doc, ps_drawing_api(ps));
+	    }
 	    document_free(doc);
 	    ps_free(ps);
 	}
@@ -0,0 +1,243 @@
+/*
+ * hashset.c: open-addressing hash tables with linear probing.
+ *
+ * Both tables keep their load factor at most one half, so probe
+ * sequences stay short, and delete by shifting later entries of the
+ * same probe run backwards rather than leaving tombstones.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "puzzles.h"
+#include "hashset.h"
+
+#define MINSIZE 16
+
+struct hashset {
+    int mask;                          /* table size - 1 */
+    int count;
+    void **elems;                      /* NULL in unused slots */
+    hashfn hash;
+    hasheqfn eq;
+};
+
+static int hashset_slot(hashset *h, const void *e)
+{
+    unsigned long long v = (unsigned long long)h->hash(e);
+    return (int)((v * 0x9E3779B97F4A7C15ULL) >> 32) & h->mask;
+}
+
+static void **hashset_alloc(int size)
+{
+    void **elems = snewn(size, void *);
+    int i;
+
+    for (i = 0; i < size; i++)
+        elems[i] = NULL;
+    return elems;
+}
+
+hashset *newhash(hashfn hash, hasheqfn eq)
+{
+    hashset *h = snew(hashset);
+
+    h->mask = MINSIZE - 1;
+    h->count = 0;
+    h->elems = hashset_alloc(MINSIZE);
+    h->hash = hash;
+    h->eq = eq;
+    return h;
+}
+
+void freehash(hashset *h)
+{
+    sfree(h->elems);
+    sfree(h);
+}
+
+static void hashset_grow(hashset *h)
+{
+    void **old = h->elems;
+    int oldsize = h->mask + 1, i, j;
+
+    h->mask = oldsize * 2 - 1;
+    h->elems = hashset_alloc(oldsize * 2);
+    for (i = 0; i < oldsize; i++) {
+        if (!old[i])
+            continue;
+        for (j = hashset_slot(h, old[i]); h->elems[j]; j = (j + 1) & h->mask);
+        h->elems[j] = old[i];
+    }
+    sfree(old);
+}
+
+void *addhash(hashset *h, void *e)
+{
+    int i;
+
+    assert(e);
+    if (2 * (h->count + 1) > h->mask + 1)
+        hashset_grow(h);
+    for (i = hashset_slot(h, e); h->elems[i]; i = (i + 1) & h->mask)
+        if (h->eq(h->elems[i], e))
+            return h->elems[i];
+    h->elems[i] = e;
+    h->count++;
+    return e;
+}
+
+void *findhash(hashset *h, const void *e)
+{
+    int i;
+
+    for (i = hashset_slot(h, e); h->elems[i]; i = (i + 1) & h->mask)
+        if (h->eq(h->elems[i], e))
+            return h->elems[i];
+    return NULL;
+}
+
+void *delhash(hashset *h, const void *e)
+{
+    void *ret;
+    int i, j, k;
+
+    for (i = hashset_slot(h, e); h->elems[i]; i = (i + 1) & h->mask)
+        if (h->eq(h->elems[i], e))
+            break;
+    if (!h->elems[i])
+        return NULL;
+    ret = h->elems[i];
+    h->count--;
+
+    /*
+     * Close the gap: any later element in the same run whose home
+     * slot is not cyclically within (i, j] could no longer be found
+     * past the hole, so move it into the hole and carry on from
+     * where it was.
+     */
+    for (j = (i + 1) & h->mask; h->elems[j]; j = (j + 1) & h->mask) {
+        k = hashset_slot(h, h->elems[j]);
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        h->elems[i] = h->elems[j];
+        i = j;
+    }
+    h->elems[i] = NULL;
+    return ret;
+}
+
+int counthash(hashset *h)
+{
+    return h->count;
+}
+
+void *nexthash(hashset *h, int *pos)
+{
+    while (*pos <= h->mask) {
+        void *e = h->elems[(*pos)++];
+        if (e)
+            return e;
+    }
+    return NULL;
+}
+
+static void intmap_alloc(intmap *m, int size)
+{
+    int i;
+
+    m->mask = size - 1;
+    m->keys = snewn(size, long long);
+    m->vals = snewn(size, int);
+    for (i = 0; i < size; i++)
+        m->keys[i] = INTMAP_EMPTY;
+}
+
+intmap *intmap_new(void)
+{
+    intmap *m = snew(intmap);
+
+    m->count = 0;
+    intmap_alloc(m, MINSIZE);
+    return m;
+}
+
+void intmap_free(intmap *m)
+{
+    sfree(m->keys);
+    sfree(m->vals);
+    sfree(m);
+}
+
+static void intmap_grow(intmap *m)
+{
+    long long *oldkeys = m->keys;
+    int *oldvals = m->vals;
+    int oldsize = m->mask + 1, i, j;
+
+    intmap_alloc(m, oldsize * 2);
+    for (i = 0; i < oldsize; i++) {
+        if (oldkeys[i] == INTMAP_EMPTY)
+            continue;
+        for (j = intmap_slot(m, oldkeys[i]); m->keys[j] != INTMAP_EMPTY;
+             j = (j + 1) & m->mask);
+        m->keys[j] = oldkeys[i];
+        m->vals[j] = oldvals[i];
+    }
+    sfree(oldkeys);
+    sfree(oldvals);
+}
+
+int *intmap_add(intmap *m, long long key, int val, bool *added)
+{
+    int i;
+
+    assert(key != INTMAP_EMPTY);
+    if (2 * (m->count + 1) > m->mask + 1)
+        intmap_grow(m);
+    for (i = intmap_slot(m, key); m->keys[i] != INTMAP_EMPTY;
+         i = (i + 1) & m->mask) {
+        if (m->keys[i] == key) {
+            if (added)
+                *added = false;
+            return &m->vals[i];
+        }
+    }
+    m->keys[i] = key;
+    m->vals[i] = val;
+    m->count++;
+    if (added)
+        *added = true;
+    return &m->vals[i];
+}
+
+int *intmap_set(intmap *m, long long key, int val)
+{
+    int *v = intmap_add(m, key, val, NULL);
+    *v = val;
+    return v;
+}
+
+bool intmap_remove(intmap *m, long long key)
+{
+    int i, j, k;
+
+    assert(key != INTMAP_EMPTY);
+    for (i = intmap_slot(m, key); m->keys[i] != key; i = (i + 1) & m->mask)
+        if (m->keys[i] == INTMAP_EMPTY)
+            return false;
+    m->count--;
+
+    /* Close the gap as in delhash. */
+    for (j = (i + 1) & m->mask; m->keys[j] != INTMAP_EMPTY;
+         j = (j + 1) & m->mask) {
+        k = intmap_slot(m, m->keys[j]);
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        m->keys[i] = m->keys[j];
+        m->vals[i] = m->vals[j];
+        i = j;
+    }
+    m->keys[i] = INTMAP_EMPTY;
+    return true;
+}
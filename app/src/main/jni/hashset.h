@@ -0,0 +1,129 @@
+/*
+ * hashset.h: header defining functions in hashset.c.
+ *
+ * Open-addressing hash tables, for the cases where a tree234 would
+ * only ever be used as a set or map and nothing needs its ordering.
+ * Lookups are O(1) and probe one contiguous array, at the cost of
+ * having no order at all: iteration visits elements in whatever
+ * order the table happens to hold them.
+ */
+
+#ifndef HASHSET_H
+#define HASHSET_H
+
+#include <stdbool.h>
+#include <limits.h>
+
+/*
+ * This typedef is opaque outside hashset.c itself.
+ */
+typedef struct hashset hashset;
+
+typedef unsigned long (*hashfn)(const void *elem);
+typedef bool (*hasheqfn)(const void *a, const void *b);
+
+/*
+ * Create a hash set of pointers. `hash' must return equal values
+ * for any two elements `eq' considers equal.
+ */
+hashset *newhash(hashfn hash, hasheqfn eq);
+
+/*
+ * Free a hash set (not including freeing the elements).
+ */
+void freehash(hashset *h);
+
+/*
+ * Add an element e to a hash set. Returns e on success, or if an
+ * existing element compares equal, returns that.
+ */
+void *addhash(hashset *h, void *e);
+
+/*
+ * Look up an element equal to e. Returns NULL if there is none.
+ */
+void *findhash(hashset *h, const void *e);
+
+/*
+ * Remove the element equal to e, if there is one, and return it.
+ * Does not free the element.
+ */
+void *delhash(hashset *h, const void *e);
+
+/*
+ * Count the elements in a hash set.
+ */
+int counthash(hashset *h);
+
+/*
+ * Iterate over a hash set in no particular order. Start with *pos
+ * set to zero; each call returns the next element, or NULL at the
+ * end. The set must not be modified during the iteration.
+ *
+ *   for (i = 0; (p = nexthash(h, &i)) != NULL; ) consume(p);
+ */
+void *nexthash(hashset *h, int *pos);
+
+/*
+ * A map from integer keys to int values, specialised so that the
+ * common case of looking up a key compiles to a few inline
+ * instructions. Any key except INTMAP_EMPTY may be used; callers
+ * wanting a set can simply ignore the values.
+ *
+ * The structure is visible only so that intmap_find can be inline;
+ * use the functions below rather than its fields.
+ */
+typedef struct intmap {
+    int mask;                          /* table size - 1 */
+    int count;
+    long long *keys;                   /* INTMAP_EMPTY in unused slots */
+    int *vals;
+} intmap;
+
+#define INTMAP_EMPTY LLONG_MIN
+
+intmap *intmap_new(void);
+void intmap_free(intmap *m);
+
+/*
+ * Set the value for a key, adding the key if it is not present.
+ * Returns a pointer to the stored value, valid until the next
+ * insertion or removal.
+ */
+int *intmap_set(intmap *m, long long key, int val);
+
+/*
+ * Add a key with the given value if it is not already present.
+ * Returns a pointer to the stored value, which is the existing one
+ * if the key was present; *added says which happened.
+ */
+int *intmap_add(intmap *m, long long key, int val, bool *added);
+
+/*
+ * Remove a key. Returns true if it was present.
+ */
+bool intmap_remove(intmap *m, long long key);
+
+static inline int intmap_slot(const intmap *m, long long key)
+{
+    unsigned long long h = (unsigned long long)key * 0x9E3779B97F4A7C15ULL;
+    return (int)(h >> 32) & m->mask;
+}
+
+/*
+ * Look up a key. Returns a pointer to its value, or NULL if it is
+ * not present.
+ */
+static inline int *intmap_find(const intmap *m, long long key)
+{
+    int i = intmap_slot(m, key);
+
+    while (m->keys[i] != INTMAP_EMPTY) {
+        if (m->keys[i] == key)
+            return &m->vals[i];
+        i = (i + 1) & m->mask;
+    }
+    return NULL;
+}
+
+#endif /* HASHSET_H */
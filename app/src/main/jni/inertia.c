@@ -71,6 +71,16 @@ typedef struct soln {
     unsigned char *list;
 } soln;
 
+/*
+ * Where the ball comes to rest after each possible move. Gems never
+ * stop the ball and mines never go away, so this depends only on the
+ * layout, and is built once and shared by all the states of a game.
+ */
+typedef struct slides {
+    int refcount;
+    int *dest;			       /* by (y*w+x)*DIRECTIONS+d; -1 = mine */
+} slides;
+
 struct game_state {
     game_params p;
     int px, py;
@@ -81,6 +91,7 @@ struct game_state {
     bool cheated;
     int solnpos;
     soln *soln;
+    slides *slides;
 };
 
 static game_params *default_params(void)
@@ -653,6 +664,7 @@ static game_state *new_game(midend *me, const game_params *params,
     state->cheated = false;
     state->solnpos = 0;
     state->soln = NULL;
+    state->slides = NULL;
 
     return state;
 }
@@ -675,6 +687,9 @@ static game_state *dup_game(const game_state *state)
     if (ret->soln)
 	ret->soln->refcount++;
     ret->solnpos = state->solnpos;
+    ret->slides = state->slides;
+    if (ret->slides)
+	ret->slides->refcount++;
 
     return ret;
 }
@@ -685,6 +700,10 @@ static void free_game(game_state *state)
 	sfree(state->soln->list);
 	sfree(state->soln);
     }
+    if (state->slides && --state->slides->refcount == 0) {
+	sfree(state->slides->dest);
+	sfree(state->slides);
+    }
     sfree(state->grid);
     sfree(state);
 }
@@ -759,6 +778,23 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 	return NULL;
     }
 
+    /*
+     * If we're already following a solution, the rest of it still
+     * collects every gem (execute_move makes sure of that), so hand
+     * it back rather than searching all over again.
+     */
+    if (currstate->soln) {
+	const struct soln *sol = currstate->soln;
+	assert(currstate->solnpos < sol->len);
+	soln = snewn(sol->len - currstate->solnpos + 2, char);
+	p = soln;
+	*p++ = 'S';
+	for (i = currstate->solnpos; i < sol->len; i++)
+	    *p++ = '0' + sol->list[i];
+	*p = '\0';
+	return soln;
+    }
+
     /*
      * Solving Inertia is a question of first building up the graph
      * of where you can get to from where, and secondly finding a
@@ -782,6 +818,10 @@ static char *solve_game(const game_state *state, const game_state *currstate,
      * I'm going to refer to a non-directional vertex as
      * (y*w+x)*DP1+DIRECTIONS, and a directional one as
      * (y*w+x)*DP1+d.
+     *
+     * (The slides table used by rejoin_solution() is no help here:
+     * it slides straight through gems, whereas this graph needs a
+     * vertex at each one still on the grid.)
      */
 
     /*
@@ -1683,6 +1723,119 @@ static void discard_solution(game_state *ret)
     ret->solnpos = 0;
 }
 
+static slides *new_slides(int w, int h, const char *grid)
+{
+    slides *sl = snew(slides);
+    int x, y, d, x2, y2;
+
+    sl->refcount = 1;
+    sl->dest = snewn(w*h*DIRECTIONS, int);
+    for (y = 0; y < h; y++)
+	for (x = 0; x < w; x++)
+	    for (d = 0; d < DIRECTIONS; d++) {
+		x2 = x;
+		y2 = y;
+		while (AT(w, h, grid, x2+DX(d), y2+DY(d)) != WALL) {
+		    x2 += DX(d);
+		    y2 += DY(d);
+		    if (AT(w, h, grid, x2, y2) == STOP ||
+			AT(w, h, grid, x2, y2) == MINE)
+			break;
+		}
+		sl->dest[(y*w+x)*DIRECTIONS+d] =
+		    (AT(w, h, grid, x2, y2) == MINE ? -1 : y2*w+x2);
+	    }
+
+    return sl;
+}
+
+/*
+ * The player has just strayed from the stored solution, from (ox,oy)
+ * to where ret now is. Rather than solving from scratch, look for the
+ * shortest way back onto the old path. Any later point on it will do
+ * provided the moves skipped over would not have collected a gem
+ * that is still on the grid, since the rest of the old path then
+ * collects everything left. Returns a solve move as from solve_game,
+ * or NULL if the old path can't be reached.
+ */
+static char *rejoin_solution(const game_state *ret, int ox, int oy)
+{
+    int w = ret->p.w, h = ret->p.h, wh = w*h;
+    const soln *sol = ret->soln;
+    const int *dest = ret->slides->dest;
+    int *dist, *from, *queue;
+    int head, tail, i, j, d, k, pos, best, bestk, bestlen;
+    char *move, *p;
+
+    /*
+     * Breadth-first search from the player's position to find the
+     * shortest route to everywhere.
+     */
+    dist = snewn(wh, int);
+    from = snewn(wh, int);
+    queue = snewn(wh, int);
+    for (i = 0; i < wh; i++)
+	dist[i] = -1;
+    pos = ret->py*w+ret->px;
+    dist[pos] = 0;
+    queue[0] = pos;
+    head = 0;
+    tail = 1;
+    while (head < tail) {
+	i = queue[head++];
+	for (d = 0; d < DIRECTIONS; d++) {
+	    j = dest[i*DIRECTIONS+d];
+	    if (j >= 0 && dist[j] < 0) {
+		dist[j] = dist[i] + 1;
+		from[j] = i*DIRECTIONS+d;
+		queue[tail++] = j;
+	    }
+	}
+    }
+
+    /*
+     * Walk along the old path and pick the point that makes the
+     * whole solution shortest.
+     */
+    best = bestk = bestlen = -1;
+    pos = oy*w+ox;
+    for (k = ret->solnpos; k < sol->len; k++) {
+	if (dist[pos] >= 0 &&
+	    (bestk < 0 || dist[pos] + sol->len - k < bestlen)) {
+	    best = pos;
+	    bestk = k;
+	    bestlen = dist[pos] + sol->len - k;
+	}
+	d = sol->list[k];
+	j = dest[pos*DIRECTIONS+d];
+	assert(j >= 0);		       /* the old path was safe */
+	for (i = pos; i != j && ret->grid[i + DY(d)*w + DX(d)] != GEM;
+	     i += DY(d)*w + DX(d));
+	if (i != j)
+	    break;		       /* can't skip this move */
+	pos = j;
+    }
+
+    move = NULL;
+    if (bestk >= 0) {
+	move = snewn(bestlen + 2, char);
+	move[0] = 'S';
+	p = move + 1 + dist[best];
+	for (i = best; dist[i] > 0; i = from[i] / DIRECTIONS)
+	    *--p = '0' + from[i] % DIRECTIONS;
+	assert(p == move + 1);
+	p = move + 1 + dist[best];
+	for (k = bestk; k < sol->len; k++)
+	    *p++ = '0' + sol->list[k];
+	*p = '\0';
+    }
+
+    sfree(queue);
+    sfree(from);
+    sfree(dist);
+    return move;
+}
+
 static game_state *execute_move(const game_state *state, const char *move)
 {
     int w = state->p.w, h = state->p.h /*, wh = w*h */;
@@ -1744,11 +1897,19 @@ static game_state *execute_move(const game_state *state, const char *move)
 	    assert(!ret->dead); /* or not a solution */
 	} else {
 	    const char *error = NULL;
-            char *soln = solve_game(NULL, ret, NULL, &error);
+            char *soln;
+	    if (!ret->slides)
+		ret->slides = new_slides(w, h, ret->grid);
+	    soln = rejoin_solution(ret, state->px, state->py);
+	    if (!soln) {
+		discard_solution(ret);
+		soln = solve_game(NULL, ret, NULL, &error);
+	    }
 	    if (!error) {
 		install_new_solution(ret, soln);
 		sfree(soln);
-	    } else discard_solution(ret);
+	    } else if (ret->soln)
+		discard_solution(ret);
 	}
     }
 
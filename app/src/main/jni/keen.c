@@ -234,6 +234,9 @@ struct solver_ctx {
     digit *soln;
     digit *dscratch;
     int *iscratch;
+    /* latin_solver stamp at which each box was last examined, for each
+     * of the difficulty levels solver_common runs at */
+    unsigned long *seen;
 };
 
 static void solver_clue_candidate(struct solver_ctx *ctx, int diff, int box)
@@ -336,6 +339,10 @@ static int solver_common(struct latin_solver *solver, void *vctx, int diff)
 	int n = ctx->boxes[box+1] - ctx->boxes[box];
 	long value = ctx->clues[box] & ~CMASK;
 	long op = ctx->clues[box] & CMASK;
+	unsigned long *seen = &ctx->seen[diff*ctx->nboxes+box];
+
+	if (!latin_solver_changed(solver, *seen, sq, n))
+	    continue;
 
         /*
          * Initialise ctx->iscratch for this clue box. At different
@@ -551,6 +558,8 @@ static int solver_common(struct latin_solver *solver, void *vctx, int diff)
 	    if (ret)
 		return ret;
 	}
+
+	*seen = solver->stamp;
     }
 
     return ret;
@@ -678,12 +687,25 @@ static bool keen_valid(struct latin_solver *solver, void *vctx)
     return true;
 }
 
-static int solver(int w, int *dsf, long *clues, digit *soln, int maxdiff)
+/*
+ * Solve into soln, taking all working memory from the arena 'ar' (and
+ * giving it back before returning), or from a private one if 'ar' is
+ * NULL.
+ */
+static int solver(int w, int *dsf, long *clues, digit *soln, int maxdiff,
+                  arena *ar)
 {
     int a = w*w;
     struct solver_ctx ctx;
+    struct latin_solver solver;
+    arena *own = NULL;
+    arena_mark mark;
     int ret;
     int i, j, n, m;
+
+    if (!ar)
+        ar = own = arena_new();
+    mark = arena_get_mark(ar);
     
     ctx.w = w;
     ctx.soln = soln;
@@ -700,10 +722,10 @@ static int solver(int w, int *dsf, long *clues, digit *soln, int maxdiff)
     for (ctx.nboxes = i = 0; i < a; i++)
 	if (dsf_canonify(dsf, i) == i)
 	    ctx.nboxes++;
-    ctx.boxlist = snewn(a, int);
-    ctx.boxes = snewn(ctx.nboxes+1, int);
-    ctx.clues = snewn(ctx.nboxes, long);
-    ctx.whichbox = snewn(a, int);
+    ctx.boxlist = anewn(ar, a, int);
+    ctx.boxes = anewn(ar, ctx.nboxes+1, int);
+    ctx.clues = anewn(ar, ctx.nboxes, long);
+    ctx.whichbox = anewn(ar, a, int);
     for (n = m = i = 0; i < a; i++)
 	if (dsf_canonify(dsf, i) == i) {
 	    ctx.clues[n] = clues[i];
@@ -719,20 +741,21 @@ static int solver(int w, int *dsf, long *clues, digit *soln, int maxdiff)
     assert(m == a);
     ctx.boxes[n] = m;
 
-    ctx.dscratch = snewn(a+1, digit);
-    ctx.iscratch = snewn(max(a+1, 4*w), int);
+    ctx.dscratch = anewn(ar, a+1, digit);
+    ctx.iscratch = anewn(ar, max(a+1, 4*w), int);
+    ctx.seen = anewn(ar, (DIFF_HARD+1)*ctx.nboxes, unsigned long);
+    for (i = 0; i < (DIFF_HARD+1)*ctx.nboxes; i++)
+        ctx.seen[i] = 0;
 
-    ret = latin_solver(soln, w, maxdiff,
-		       DIFF_EASY, DIFF_HARD, DIFF_EXTREME,
-		       DIFF_EXTREME, DIFF_UNREASONABLE,
-		       keen_solvers, keen_valid, &ctx, NULL, NULL);
+    latin_solver_alloc_arena(&solver, soln, w, ar);
+    ret = latin_solver_main(&solver, maxdiff,
+			    DIFF_EASY, DIFF_HARD, DIFF_EXTREME,
+			    DIFF_EXTREME, DIFF_UNREASONABLE,
+			    keen_solvers, keen_valid, &ctx, NULL, NULL);
+    latin_solver_free(&solver);
 
-    sfree(ctx.dscratch);
-    sfree(ctx.iscratch);
-    sfree(ctx.whichbox);
-    sfree(ctx.boxlist);
-    sfree(ctx.boxes);
-    sfree(ctx.clues);
+    arena_release(ar, mark);
+    arena_free(own);
 
     return ret;
 }
@@ -896,6 +919,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int i, j, k, n, x, y, ret;
     int diff = params->diff;
     char *desc, *p;
+    arena *ar;
 
     /*
      * Difficulty exceptions: 3x3 puzzles at difficulty Hard or
@@ -924,6 +948,7 @@ done
 	diff = DIFF_NORMAL;
 
     grid = NULL;
+    ar = arena_new();
 
     order = snewn(a, int);
     revorder = snewn(a, int);
@@ -934,6 +959,11 @@ done
     soln = snewn(a, digit);
 
     while (1) {
+	if (random_cancelled(rs)) {
+	    desc = NULL;
+	    goto cleanup;
+	}
+
 	/*
 	 * First construct a latin square to be the solution.
 	 */
@@ -1219,12 +1249,12 @@ done
 	 */
 	if (diff > 0) {
 	    memset(soln, 0, a);
-	    ret = solver(w, dsf, clues, soln, diff-1);
+	    ret = solver(w, dsf, clues, soln, diff-1, ar);
 	    if (ret <= diff-1)
 		continue;
 	}
 	memset(soln, 0, a);
-	ret = solver(w, dsf, clues, soln, diff);
+	ret = solver(w, dsf, clues, soln, diff, ar);
 	if (ret != diff)
 	    continue;		       /* go round again */
 
@@ -1277,6 +1307,7 @@ done
 	(*aux)[i+1] = '0' + soln[i];
     (*aux)[a+1] = '\0';
 
+  cleanup:
     sfree(grid);
     sfree(order);
     sfree(revorder);
@@ -1285,6 +1316,7 @@ done
     sfree(clues);
     sfree(cluevals);
     sfree(soln);
+    arena_free(ar);
 
     return desc;
 }
@@ -1477,7 +1509,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     memset(soln, 0, a);
 
     ret = solver(w, state->clues->dsf, state->clues->clues,
-		 soln, DIFFCOUNT-1);
+		 soln, DIFFCOUNT-1, NULL);
 
     if (ret == diff_impossible) {
 	*error = _("No solution exists for this puzzle");
@@ -2621,7 +2653,7 @@ int main(int argc, char **argv)
     for (diff = 0; diff < DIFFCOUNT; diff++) {
 	memset(s->grid, 0, p->w * p->w);
 	ret = solver(p->w, s->clues->dsf, s->clues->clues,
-		     s->grid, diff);
+		     s->grid, diff, NULL);
 	if (ret <= diff)
 	    break;
     }
@@ -2641,7 +2673,7 @@ int main(int argc, char **argv)
 	    solver_show_working = really_show_working ? 1 : 0;
 	    memset(s->grid, 0, p->w * p->w);
 	    ret = solver(p->w, s->clues->dsf, s->clues->clues,
-			 s->grid, diff);
+			 s->grid, diff, NULL);
 	    if (ret != diff)
 		printf("Puzzle is inconsistent\n");
 	    else {
@@ -138,12 +138,49 @@ int latin_solver_elim(struct latin_solver *solver, int start, int step
     return 0;
 }
 
+/*
+ * The set and forcing deductions work on candidate sets packed into a
+ * single word, so no latin square handed to the solver may be bigger
+ * than this.
+ */
+typedef uint64_t latin_bits;
+#define LATIN_BITS_MAX 64
+#define LATIN_BIT(i) ((latin_bits)1 << (i))
+
+static int latin_popcount(latin_bits x)
+{
+#ifdef __GNUC__
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Index of the lowest set bit of a non-zero word. */
+static int latin_lowbit(latin_bits x)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
+#else
+    int i = 0;
+    while (!(x & 1))
+        x >>= 1, i++;
+    return i;
+#endif
+}
+
 struct latin_solver_scratch {
-    unsigned char *grid, *rowidx, *colidx, *set;
+    unsigned char *grid, *rowidx, *colidx;
+    latin_bits *rows, *cells;
     int *neighbours, *bfsqueue;
 #ifdef STANDALONE_SOLVER
     int *bfsprev;
 #endif
+    arena *arena;
+    arena_mark mark;
 };
 
 int latin_solver_set(struct latin_solver *solver,
@@ -158,11 +195,11 @@ int latin_solver_set(struct latin_solver *solver,
 #ifdef STANDALONE_SOLVER
     char **names = solver->names;
 #endif
-    int i, j, n, count;
-    unsigned char *grid = scratch->grid;
+    int i, j, n;
+    latin_bits *rows = scratch->rows;
     unsigned char *rowidx = scratch->rowidx;
     unsigned char *colidx = scratch->colidx;
-    unsigned char *set = scratch->set;
+    latin_bits set, all;
 
     /*
      * We are passed a o-by-o matrix of booleans. Our first job
@@ -173,14 +210,14 @@ int latin_solver_set(struct latin_solver *solver,
     memset(rowidx, true, o);
     memset(colidx, true, o);
     for (i = 0; i < o; i++) {
-        int count = 0, first = -1;
+        latin_bits bits = 0;
         for (j = 0; j < o; j++)
             if (solver->cube[start+i*step1+j*step2])
-                first = j, count++;
+                bits |= LATIN_BIT(j);
 
-	if (count == 0) return -1;
-        if (count == 1)
-            rowidx[i] = colidx[first] = false;
+	if (!bits) return -1;
+        if (latin_popcount(bits) == 1)
+            rowidx[i] = colidx[latin_lowbit(bits)] = false;
     }
 
     /*
@@ -197,11 +234,16 @@ int latin_solver_set(struct latin_solver *solver,
     assert(n == j);
 
     /*
-     * And create the smaller matrix.
+     * And create the smaller matrix, as one word per row. Column j
+     * of it is bit n-1-j, for the benefit of the search below.
      */
-    for (i = 0; i < n; i++)
+    for (i = 0; i < n; i++) {
+        latin_bits bits = 0;
         for (j = 0; j < n; j++)
-            grid[i*o+j] = solver->cube[start+rowidx[i]*step1+colidx[j]*step2];
+            if (solver->cube[start+rowidx[i]*step1+colidx[j]*step2])
+                bits |= LATIN_BIT(n-1-j);
+        rows[i] = bits;
+    }
 
     /*
      * Having done that, we now have a matrix in which every row
@@ -209,11 +251,20 @@ int latin_solver_set(struct latin_solver *solver,
      * a rectangle of zeroes (in the set-theoretic sense of
      * `rectangle', i.e. a subset of rows crossed with a subset of
      * columns) whose width and height add up to n.
+     *
+     * The candidate sets of columns are the successive values of
+     * a binary counter, with column 0 as its top bit, so a row has
+     * a zero in every column of a set exactly when its word and
+     * the counter have no bits in common.
      */
+    all = (n == LATIN_BITS_MAX ? ~(latin_bits)0 : LATIN_BIT(n) - 1);
+    set = 0;
+    while (set != all) {
+        int count;
+
+        set++;
+        count = latin_popcount(set);
 
-    memset(set, 0, n);
-    count = 0;
-    while (1) {
         /*
          * We have a candidate set. If its size is <=1 or >=n-1
          * then we move on immediately.
@@ -224,17 +275,10 @@ int latin_solver_set(struct latin_solver *solver,
              * find that many rows which each have a zero in all
              * the positions listed in `set'.
              */
-            int rows = 0;
-            for (i = 0; i < n; i++) {
-                bool ok = true;
-                for (j = 0; j < n; j++)
-                    if (set[j] && grid[i*o+j]) {
-                        ok = false;
-                        break;
-                    }
-                if (ok)
-                    rows++;
-            }
+            int nrows = 0;
+            for (i = 0; i < n; i++)
+                if (!(rows[i] & set))
+                    nrows++;
 
             /*
              * We expect never to be able to get _more_ than
@@ -244,7 +288,7 @@ int latin_solver_set(struct latin_solver *solver,
              * indicates a faulty deduction before this point or
              * even a bogus clue.
              */
-            if (rows > n - count) {
+            if (nrows > n - count) {
 #ifdef STANDALONE_SOLVER
 		if (solver_show_working) {
 		    va_list ap;
@@ -260,7 +304,7 @@ int latin_solver_set(struct latin_solver *solver,
 		return -1;
 	    }
 
-            if (rows >= n - count) {
+            if (nrows >= n - count) {
                 bool progress = false;
 
                 /*
@@ -275,45 +319,42 @@ int latin_solver_set(struct latin_solver *solver,
                  * positions in the cube to meddle with.
                  */
                 for (i = 0; i < n; i++) {
-                    bool ok = true;
+                    latin_bits elim;
+
+                    if (!(rows[i] & set))
+                        continue;
+                    elim = rows[i] & ~set;
                     for (j = 0; j < n; j++)
-                        if (set[j] && grid[i*o+j]) {
-                            ok = false;
-                            break;
-                        }
-                    if (!ok) {
-                        for (j = 0; j < n; j++)
-                            if (!set[j] && grid[i*o+j]) {
-                                int fpos = (start+rowidx[i]*step1+
-                                            colidx[j]*step2);
+                        if (elim & LATIN_BIT(n-1-j)) {
+                            int fpos = (start+rowidx[i]*step1+
+                                        colidx[j]*step2);
 #ifdef STANDALONE_SOLVER
-                                if (solver_show_working) {
-                                    int px, py, pn;
-
-                                    if (!progress) {
-                                        va_list ap;
-					printf("%*s", solver_recurse_depth*4,
-					       "");
-                                        va_start(ap, fmt);
-                                        vprintf(fmt, ap);
-                                        va_end(ap);
-                                        printf(":\n");
-                                    }
+                            if (solver_show_working) {
+                                int px, py, pn;
+
+                                if (!progress) {
+                                    va_list ap;
+                                    printf("%*s", solver_recurse_depth*4,
+                                           "");
+                                    va_start(ap, fmt);
+                                    vprintf(fmt, ap);
+                                    va_end(ap);
+                                    printf(":\n");
+                                }
 
-                                    pn = 1 + fpos % o;
-                                    py = fpos / o;
-                                    px = py / o;
-                                    py %= o;
+                                pn = 1 + fpos % o;
+                                py = fpos / o;
+                                px = py / o;
+                                py %= o;
 
-                                    printf("%*s  ruling out %s at (%d,%d)\n",
-					   solver_recurse_depth*4, "",
-                                           names[pn-1], px+1, py+1);
-                                }
-#endif
-                                progress = true;
-                                solver->cube[fpos] = false;
+                                printf("%*s  ruling out %s at (%d,%d)\n",
+                                       solver_recurse_depth*4, "",
+                                       names[pn-1], px+1, py+1);
                             }
-                    }
+#endif
+                            progress = true;
+                            solver->cube[fpos] = false;
+                        }
                 }
 
                 if (progress) {
@@ -321,18 +362,6 @@ int latin_solver_set(struct latin_solver *solver,
                 }
             }
         }
-
-        /*
-         * Binary increment: change the rightmost 0 to a 1, and
-         * change all 1s to the right of it to 0s.
-         */
-        i = n;
-        while (i > 0 && set[i-1])
-            set[--i] = 0, count--;
-        if (i > 0)
-            set[--i] = 1, count++;
-        else
-            break;                     /* done */
     }
 
     return 0;
@@ -386,33 +415,40 @@ int latin_solver_forcing(struct latin_solver *solver,
     int *bfsprev = scratch->bfsprev;
 #endif
     unsigned char *number = scratch->grid;
+    latin_bits *cells = scratch->cells;
     int *neighbours = scratch->neighbours;
-    int x, y;
+    int x, y, n;
 
+    /*
+     * Take a copy of each square's candidates as a word, with bit
+     * n-1 standing for number n. Nothing below changes the cube
+     * until we return, so the copy stays accurate throughout.
+     */
     for (y = 0; y < o; y++)
         for (x = 0; x < o; x++) {
-            int count, t, n;
+            latin_bits bits = 0;
+            for (n = 1; n <= o; n++)
+                if (cube(x, y, n))
+                    bits |= LATIN_BIT(n-1);
+            cells[y*o+x] = bits;
+        }
+
+    for (y = 0; y < o; y++)
+        for (x = 0; x < o; x++) {
+            latin_bits here = cells[y*o+x];
 
             /*
              * If this square doesn't have exactly two candidate
              * numbers, don't try it.
-             *
-             * In this loop we also sum the candidate numbers,
-             * which is a nasty hack to allow us to quickly find
-             * `the other one' (since we will shortly know there
-             * are exactly two).
              */
-            for (count = t = 0, n = 1; n <= o; n++)
-                if (cube(x, y, n))
-                    count++, t += n;
-            if (count != 2)
+            if (latin_popcount(here) != 2)
                 continue;
 
             /*
              * Now attempt a bfs for each candidate.
              */
             for (n = 1; n <= o; n++)
-                if (cube(x, y, n)) {
+                if (here & LATIN_BIT(n-1)) {
                     int orign, currn, head, tail;
 
                     /*
@@ -426,7 +462,7 @@ int latin_solver_forcing(struct latin_solver *solver,
 #ifdef STANDALONE_SOLVER
                     bfsprev[y*o+x] = -1;
 #endif
-                    number[y*o+x] = t - n;
+                    number[y*o+x] = 1 + latin_lowbit(here & ~LATIN_BIT(n-1));
 
                     while (head < tail) {
                         int xx, yy, nneighbours, xt, yt, i;
@@ -450,7 +486,7 @@ int latin_solver_forcing(struct latin_solver *solver,
                          * Try visiting each of those neighbours.
                          */
                         for (i = 0; i < nneighbours; i++) {
-                            int cc, tt, nn;
+                            latin_bits there;
 
                             xt = neighbours[i] % o;
                             yt = neighbours[i] / o;
@@ -462,7 +498,8 @@ int latin_solver_forcing(struct latin_solver *solver,
                              */
                             if (number[yt*o+xt] <= o)
                                 continue;
-                            if (!cube(xt, yt, currn))
+                            there = cells[yt*o+xt];
+                            if (!(there & LATIN_BIT(currn-1)))
                                 continue;
 
                             /*
@@ -477,15 +514,13 @@ int latin_solver_forcing(struct latin_solver *solver,
                              * this square to have exactly two
                              * possible numbers.
                              */
-                            for (cc = tt = 0, nn = 1; nn <= o; nn++)
-                                if (cube(xt, yt, nn))
-                                    cc++, tt += nn;
-                            if (cc == 2) {
+                            if (latin_popcount(there) == 2) {
                                 bfsqueue[tail++] = yt*o+xt;
 #ifdef STANDALONE_SOLVER
                                 bfsprev[yt*o+xt] = yy*o+xx;
 #endif
-                                number[yt*o+xt] = tt - currn;
+                                number[yt*o+xt] = 1 + latin_lowbit(
+                                    there & ~LATIN_BIT(currn-1));
                             }
 
                             /*
@@ -535,45 +570,156 @@ int latin_solver_forcing(struct latin_solver *solver,
 
 struct latin_solver_scratch *latin_solver_new_scratch(struct latin_solver *solver)
 {
-    struct latin_solver_scratch *scratch = snew(struct latin_solver_scratch);
+    struct latin_solver_scratch *scratch;
+    arena *a = solver->arena;
     int o = solver->o;
-    scratch->grid = snewn(o*o, unsigned char);
-    scratch->rowidx = snewn(o, unsigned char);
-    scratch->colidx = snewn(o, unsigned char);
-    scratch->set = snewn(o, unsigned char);
-    scratch->neighbours = snewn(3*o, int);
-    scratch->bfsqueue = snewn(o*o, int);
+
+    if (a) {
+        arena_mark mark = arena_get_mark(a);
+        scratch = anew(a, struct latin_solver_scratch);
+        scratch->mark = mark;
+        scratch->grid = anewn(a, o*o, unsigned char);
+        scratch->rowidx = anewn(a, o, unsigned char);
+        scratch->colidx = anewn(a, o, unsigned char);
+        scratch->rows = anewn(a, o, latin_bits);
+        scratch->cells = anewn(a, o*o, latin_bits);
+        scratch->neighbours = anewn(a, 3*o, int);
+        scratch->bfsqueue = anewn(a, o*o, int);
 #ifdef STANDALONE_SOLVER
-    scratch->bfsprev = snewn(o*o, int);
+        scratch->bfsprev = anewn(a, o*o, int);
 #endif
+    } else {
+        scratch = snew(struct latin_solver_scratch);
+        scratch->grid = snewn(o*o, unsigned char);
+        scratch->rowidx = snewn(o, unsigned char);
+        scratch->colidx = snewn(o, unsigned char);
+        scratch->rows = snewn(o, latin_bits);
+        scratch->cells = snewn(o*o, latin_bits);
+        scratch->neighbours = snewn(3*o, int);
+        scratch->bfsqueue = snewn(o*o, int);
+#ifdef STANDALONE_SOLVER
+        scratch->bfsprev = snewn(o*o, int);
+#endif
+    }
+    scratch->arena = a;
     return scratch;
 }
 
 void latin_solver_free_scratch(struct latin_solver_scratch *scratch)
 {
+    if (scratch->arena) {
+        arena_release(scratch->arena, scratch->mark);
+        return;
+    }
 #ifdef STANDALONE_SOLVER
     sfree(scratch->bfsprev);
 #endif
     sfree(scratch->bfsqueue);
     sfree(scratch->neighbours);
-    sfree(scratch->set);
+    sfree(scratch->cells);
+    sfree(scratch->rows);
     sfree(scratch->colidx);
     sfree(scratch->rowidx);
     sfree(scratch->grid);
     sfree(scratch);
 }
 
-void latin_solver_alloc(struct latin_solver *solver, digit *grid, int o)
+/*
+ * Start change tracking afresh, counting every square as changed at
+ * 'stamp'. That must be later than any stamp a usersolver might
+ * already have recorded in its context, so that nothing is skipped
+ * on the strength of a different cube.
+ */
+static void latin_solver_track_from(struct latin_solver *solver,
+                                    unsigned long stamp)
+{
+    int i, o = solver->o;
+
+    solver->stamp = stamp;
+    for (i = 0; i < o*o; i++)
+        solver->changed[i] = stamp;
+    memcpy(solver->prevcube, solver->cube, o*o*o);
+    memcpy(solver->prevgrid, solver->grid, o*o);
+}
+
+/*
+ * Called after any deduction: advance the stamp, and record it against
+ * every square whose possibilities (or grid entry) differ from the
+ * copies taken last time.
+ */
+static void latin_solver_note_changes(struct latin_solver *solver)
+{
+    int i, x, y, o = solver->o;
+
+    solver->stamp++;
+    for (i = 0; i < o*o; i++) {
+        x = i / o;
+        y = i % o;
+        if (solver->grid[y*o+x] != solver->prevgrid[y*o+x] ||
+            memcmp(solver->cube + i*o, solver->prevcube + i*o, o)) {
+            solver->changed[i] = solver->stamp;
+            memcpy(solver->prevcube + i*o, solver->cube + i*o, o);
+            solver->prevgrid[y*o+x] = solver->grid[y*o+x];
+        }
+    }
+}
+
+bool latin_solver_changed(struct latin_solver *solver, unsigned long seen,
+                          const int *squares, int n)
+{
+    struct latin_solver_stats *st = &solver->stats[solver->level];
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (solver->changed[squares[i]] > seen) {
+            st->examined++;
+            return true;
+        }
+    st->skipped++;
+    return false;
+}
+
+bool latin_solver_line_changed(struct latin_solver *solver, unsigned long seen,
+                               int start, int step, int n)
+{
+    struct latin_solver_stats *st = &solver->stats[solver->level];
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (solver->changed[start + i*step] > seen) {
+            st->examined++;
+            return true;
+        }
+    st->skipped++;
+    return false;
+}
+
+void latin_solver_alloc_arena(struct latin_solver *solver, digit *grid, int o,
+                              arena *a)
 {
     int x, y;
 
+    assert(o <= LATIN_BITS_MAX);
     solver->o = o;
-    solver->cube = snewn(o*o*o, unsigned char);
+    solver->arena = a;
+    if (a) {
+        solver->mark = arena_get_mark(a);
+        solver->cube = anewn(a, o*o*o, unsigned char);
+        solver->row = anewn(a, o*o, unsigned char);
+        solver->col = anewn(a, o*o, unsigned char);
+        solver->changed = anewn(a, o*o, unsigned long);
+        solver->prevcube = anewn(a, o*o*o, unsigned char);
+        solver->prevgrid = anewn(a, o*o, digit);
+    } else {
+        solver->cube = snewn(o*o*o, unsigned char);
+        solver->row = snewn(o*o, unsigned char);
+        solver->col = snewn(o*o, unsigned char);
+        solver->changed = snewn(o*o, unsigned long);
+        solver->prevcube = snewn(o*o*o, unsigned char);
+        solver->prevgrid = snewn(o*o, digit);
+    }
     solver->grid = grid;		/* write straight back to the input */
     memset(solver->cube, 1, o*o*o);
-
-    solver->row = snewn(o*o, unsigned char);
-    solver->col = snewn(o*o, unsigned char);
     memset(solver->row, 0, o*o);
     memset(solver->col, 0, o*o);
 
@@ -582,16 +728,32 @@ void latin_solver_alloc(struct latin_solver *solver, digit *grid, int o)
 	    if (grid[y*o+x])
 		latin_solver_place(solver, x, y, grid[y*o+x]);
 
+    latin_solver_track_from(solver, 1);
+    solver->level = 0;
+    memset(solver->stats, 0, sizeof(solver->stats));
+
 #ifdef STANDALONE_SOLVER
     solver->names = NULL;
 #endif
 }
 
+void latin_solver_alloc(struct latin_solver *solver, digit *grid, int o)
+{
+    latin_solver_alloc_arena(solver, grid, o, NULL);
+}
+
 void latin_solver_free(struct latin_solver *solver)
 {
+    if (solver->arena) {
+        arena_release(solver->arena, solver->mark);
+        return;
+    }
     sfree(solver->cube);
     sfree(solver->row);
     sfree(solver->col);
+    sfree(solver->changed);
+    sfree(solver->prevcube);
+    sfree(solver->prevgrid);
 }
 
 int latin_solver_diff_simple(struct latin_solver *solver)
@@ -755,6 +917,7 @@ static int latin_solver_recurse
     else {
         int i, j;
         digit *list, *ingrid, *outgrid;
+        arena_mark mark;
         int diff = diff_impossible;    /* no solution found yet */
 
         /*
@@ -763,9 +926,16 @@ static int latin_solver_recurse
         y = best / o;
         x = best % o;
 
-        list = snewn(o, digit);
-        ingrid = snewn(o*o, digit);
-        outgrid = snewn(o*o, digit);
+        if (solver->arena) {
+            mark = arena_get_mark(solver->arena);
+            list = anewn(solver->arena, o, digit);
+            ingrid = anewn(solver->arena, o*o, digit);
+            outgrid = anewn(solver->arena, o*o, digit);
+        } else {
+            list = snewn(o, digit);
+            ingrid = snewn(o*o, digit);
+            outgrid = snewn(o*o, digit);
+        }
         memcpy(ingrid, solver->grid, o*o);
 
         /* Make a list of the possible digits. */
@@ -791,7 +961,7 @@ static int latin_solver_recurse
          * main solver at every stage.
          */
         for (i = 0; i < j; i++) {
-            int ret;
+            int ret, k;
 	    void *newctx;
 	    struct latin_solver subsolver;
 
@@ -810,7 +980,10 @@ static int latin_solver_recurse
 	    } else {
 		newctx = ctx;
 	    }
-	    latin_solver_alloc(&subsolver, outgrid, o);
+	    latin_solver_alloc_arena(&subsolver, outgrid, o, solver->arena);
+            /* Without a ctxnew, the subsolver shares our context, so its
+             * stamps must carry on from ours (and ours from its). */
+            latin_solver_track_from(&subsolver, solver->stamp + 1);
 #ifdef STANDALONE_SOLVER
 	    subsolver.names = solver->names;
 #endif
@@ -819,6 +992,13 @@ static int latin_solver_recurse
 				   diff_forcing, diff_recursive,
 				   usersolvers, valid, newctx,
                                    ctxnew, ctxfree);
+            solver->stamp = subsolver.stamp;
+            for (k = 0; k < diff_impossible; k++) {
+                solver->stats[k].calls += subsolver.stats[k].calls;
+                solver->stats[k].progress += subsolver.stats[k].progress;
+                solver->stats[k].examined += subsolver.stats[k].examined;
+                solver->stats[k].skipped += subsolver.stats[k].skipped;
+            }
 	    latin_solver_free(&subsolver);
 	    if (ctxnew)
 		ctxfree(newctx);
@@ -862,9 +1042,13 @@ static int latin_solver_recurse
                 break;
         }
 
-        sfree(outgrid);
-        sfree(ingrid);
-        sfree(list);
+        if (solver->arena) {
+            arena_release(solver->arena, mark);
+        } else {
+            sfree(outgrid);
+            sfree(ingrid);
+            sfree(list);
+        }
 
         if (diff == diff_impossible)
             return -1;
@@ -902,9 +1086,13 @@ static int latin_solver_top(struct latin_solver *solver, int maxdiff,
         latin_solver_debug(solver->cube, solver->o);
 
 	for (i = 0; i <= maxdiff; i++) {
-	    if (usersolvers[i])
+	    if (usersolvers[i]) {
+                solver->level = i;
 		ret = usersolvers[i](solver, ctx);
-	    else
+                solver->stats[i].calls++;
+                if (ret > 0)
+                    solver->stats[i].progress++;
+            } else
 		ret = 0;
 	    if (ret == 0 && i == diff_simple)
 		ret = latin_solver_diff_simple(solver);
@@ -920,6 +1108,7 @@ static int latin_solver_top(struct latin_solver *solver, int maxdiff,
 		goto got_result;
 	    } else if (ret > 0) {
 		diff = max(diff, i);
+                latin_solver_note_changes(solver);
 		goto cont;
 	    }
 	}
@@ -1043,6 +1232,17 @@ int latin_solver_main(struct latin_solver *solver, int maxdiff,
 			    usersolvers, valid, ctx, ctxnew, ctxfree);
 
 #ifdef STANDALONE_SOLVER
+    if (solver_show_working) {
+        int i;
+
+        for (i = 0; i < diff_impossible; i++)
+            if (solver->stats[i].calls)
+                printf("%*susersolver %d: %d calls (%d productive), "
+                       "%d clues examined, %d skipped as unchanged\n",
+                       solver_recurse_depth*4, "", i,
+                       solver->stats[i].calls, solver->stats[i].progress,
+                       solver->stats[i].examined, solver->stats[i].skipped);
+    }
     sfree(names);
     sfree(text);
 #endif
@@ -1126,8 +1326,9 @@ digit *latin_generate(int o, random_state *rs)
     digit *sq;
     int *adjdata, *adjsizes, *matching;
     int **adjlists;
+    latin_bits *used, all;
     void *scratch;
-    int i, j, k;
+    int i, j;
     digit *row;
 
     /*
@@ -1144,6 +1345,7 @@ digit *latin_generate(int o, random_state *rs)
      * support functions in matching.c.
      */
 
+    assert(o <= LATIN_BITS_MAX);
     sq = snewn(o*o, digit);
 
     /*
@@ -1158,13 +1360,19 @@ digit *latin_generate(int o, random_state *rs)
     shuffle(row, i, sizeof(*row), rs);
 
     /*
-     * Set up the infrastructure for the matching subroutine.
+     * Set up the infrastructure for the matching subroutine, once
+     * for all the rows. used[j] has a bit set for each number already
+     * placed in column j.
      */
     scratch = smalloc(matching_scratch_size(o, o));
     adjdata = snewn(o*o, int);
     adjlists = snewn(o, int *);
     adjsizes = snewn(o, int);
     matching = snewn(o, int);
+    used = snewn(o, latin_bits);
+    for (j = 0; j < o; j++)
+        used[j] = 0;
+    all = (o == LATIN_BITS_MAX ? ~(latin_bits)0 : LATIN_BIT(o) - 1);
 
     /*
      * Now generate each row of the latin square.
@@ -1172,18 +1380,16 @@ digit *latin_generate(int o, random_state *rs)
     for (i = 0; i < o; i++) {
         /*
          * Make adjacency lists for a bipartite graph joining each
-         * column to all the numbers not yet placed in that column.
+         * column to all the numbers not yet placed in that column,
+         * in increasing order.
          */
         for (j = 0; j < o; j++) {
-            int *p, *adj = adjdata + j*o;
-            for (k = 0; k < o; k++)
-                adj[k] = 1;
-            for (k = 0; k < i; k++)
-                adj[sq[row[k]*o + j] - 1] = 0;
-            adjlists[j] = p = adj;
-            for (k = 0; k < o; k++)
-                if (adj[k])
-                    *p++ = k;
+            int *p = adjdata + j*o;
+            latin_bits avail;
+
+            adjlists[j] = p;
+            for (avail = all & ~used[j]; avail; avail &= avail - 1)
+                *p++ = latin_lowbit(avail);
             adjsizes[j] = p - adjlists[j];
         }
 
@@ -1198,13 +1404,16 @@ digit *latin_generate(int o, random_state *rs)
 	 * And use the output to set up the new row of the latin
 	 * square.
 	 */
-	for (j = 0; j < o; j++)
+	for (j = 0; j < o; j++) {
 	    sq[row[i]*o + j] = matching[j] + 1;
+            used[j] |= LATIN_BIT(matching[j]);
+        }
     }
 
     /*
      * Done. Free our internal workspaces...
      */
+    sfree(used);
     sfree(matching);
     sfree(adjlists);
     sfree(adjsizes);
@@ -11,6 +11,18 @@ typedef unsigned char digit;
 extern int solver_show_working, solver_recurse_depth;
 #endif
 
+/* Individual puzzles should use their enumerations for their
+ * own difficulty levels, ensuring they don't clash with these. */
+enum { diff_impossible = 10, diff_ambiguous, diff_unfinished };
+
+/* Counters kept for each difficulty level's usersolver. */
+struct latin_solver_stats {
+  int calls;            /* times the usersolver was run */
+  int progress;         /* of which made some deduction */
+  int examined;         /* clues it examined (see latin_solver_changed) */
+  int skipped;          /* clues it skipped because nothing had changed */
+};
+
 struct latin_solver {
   int o;                /* order of latin square */
   unsigned char *cube;  /* o^3, indexed by x, y, and digit:
@@ -23,6 +35,20 @@ struct latin_solver {
 #ifdef STANDALONE_SOLVER
   char **names;         /* o: names[n-1] gives name of 'digit' n */
 #endif
+
+  /* Change tracking: see latin_solver_changed. */
+  unsigned long stamp;  /* advances whenever a deduction is made */
+  unsigned long *changed; /* o^2, indexed like cube/o: stamp at which
+                           that square last lost a possibility */
+  unsigned char *prevcube; /* o^3: copy of cube as of the last advance */
+  digit *prevgrid;      /* o^2: copy of grid likewise */
+
+  int level;            /* difficulty level of the usersolver running */
+  struct latin_solver_stats stats[diff_impossible];
+
+  arena *arena;         /* if not NULL, where the above and all scratch
+                           space come from */
+  arena_mark mark;      /* where to release the arena back to */
 };
 #define cubepos(x,y,n) (((x)*solver->o+(y))*solver->o+(n)-1)
 #define cube(x,y,n) (solver->cube[cubepos(x,y,n)])
@@ -58,13 +84,35 @@ int latin_solver_forcing(struct latin_solver *solver,
                          struct latin_solver_scratch *scratch);
 
 
+/* Change tracking. A usersolver working through a list of clues need
+ * not look again at a clue none of whose squares has lost a possibility
+ * (or been filled in) since it last analysed that clue in full: the same
+ * analysis of the same possibilities can only repeat itself, and anything
+ * it ruled out elsewhere is still ruled out. So it keeps an unsigned long
+ * per clue in its context, zero to begin with, skips the clue if
+ * latin_solver_changed returns false for it, and otherwise sets it to
+ * solver->stamp once the clue has been dealt with.
+ *
+ * Squares are given as indices into the cube divided by o, i.e. x*o+y:
+ * either as a list, or as n squares from start in steps of step. */
+bool latin_solver_changed(struct latin_solver *solver, unsigned long seen,
+                          const int *squares, int n);
+bool latin_solver_line_changed(struct latin_solver *solver, unsigned long seen,
+                               int start, int step, int n);
+
 /* --- Solver allocation --- */
 
 /* Fills in (and allocates members for) a latin_solver struct.
  * Will allocate members of snew, but not snew itself
  * (allowing 'struct latin_solver' to be the first element in a larger
- * struct, for example). */
+ * struct, for example). The order may be at most 64. */
 void latin_solver_alloc(struct latin_solver *solver, digit *grid, int o);
+/* The same, but taking every allocation the solver makes (including those
+ * of recursive sub-solvers) from an arena, so that a generator calling the
+ * solver repeatedly can reuse the same memory each time. latin_solver_free
+ * then returns it to the arena rather than the heap. */
+void latin_solver_alloc_arena(struct latin_solver *solver, digit *grid, int o,
+                              arena *a);
 void latin_solver_free(struct latin_solver *solver);
 
 /* Allocates scratch space (for _set and _forcing) */
@@ -89,10 +137,6 @@ typedef bool (*validator_t)(struct latin_solver *solver, void *ctx);
 typedef void *(*ctxnew_t)(void *ctx);
 typedef void (*ctxfree_t)(void *ctx);
 
-/* Individual puzzles should use their enumerations for their
- * own difficulty levels, ensuring they don't clash with these. */
-enum { diff_impossible = 10, diff_ambiguous, diff_unfinished };
-
 /* Externally callable function that allocates and frees a latin_solver */
 int latin_solver(digit *grid, int o, int maxdiff,
 		 int diff_simple, int diff_set_0, int diff_set_1,
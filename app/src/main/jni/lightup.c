@@ -112,12 +112,22 @@ struct game_params {
 
 #define F_MARK          32
 
+/* The extent of each square's lines of sight, i.e. of the horizontal
+ * and vertical runs of non-black squares through it. These depend only
+ * on the black squares, so they're computed once for each layout and
+ * shared between copies of a state. */
+struct light_runs {
+    int refcount;
+    int *minx, *maxx, *miny, *maxy;     /* size h*w */
+};
+
 struct game_state {
     int w, h, nlights;
     int *lights;        /* For black squares, (optionally) the number
                            of surrounding lights. For non-black squares,
                            the number of times it's lit. size h*w*/
     unsigned int *flags;        /* size h*w */
+    struct light_runs *runs;
     bool completed, used_solve;
 };
 
@@ -397,6 +407,7 @@ static game_state *new_state(const game_params *params)
     memset(ret->lights, 0, ret->w * ret->h * sizeof(int));
     ret->flags = snewn(ret->w * ret->h, unsigned int);
     memset(ret->flags, 0, ret->w * ret->h * sizeof(unsigned int));
+    ret->runs = NULL;
     ret->completed = false;
     ret->used_solve = false;
     return ret;
@@ -416,19 +427,72 @@ static game_state *dup_game(const game_state *state)
     ret->flags = snewn(ret->w * ret->h, unsigned int);
     memcpy(ret->flags, state->flags, ret->w * ret->h * sizeof(unsigned int));
 
+    ret->runs = state->runs;
+    if (ret->runs) ret->runs->refcount++;
+
     ret->completed = state->completed;
     ret->used_solve = state->used_solve;
 
     return ret;
 }
 
+static void free_runs(struct light_runs *runs)
+{
+    if (runs && --runs->refcount == 0) {
+        sfree(runs->minx);
+        sfree(runs->maxx);
+        sfree(runs->miny);
+        sfree(runs->maxy);
+        sfree(runs);
+    }
+}
+
 static void free_game(game_state *state)
 {
     sfree(state->lights);
     sfree(state->flags);
+    free_runs(state->runs);
     sfree(state);
 }
 
+/* Recomputes state->runs; must be called whenever black squares change. */
+static void find_runs(game_state *state)
+{
+    int w = state->w, h = state->h, x, y, i;
+    struct light_runs *runs = snew(struct light_runs);
+
+    runs->refcount = 1;
+    runs->minx = snewn(w * h, int);
+    runs->maxx = snewn(w * h, int);
+    runs->miny = snewn(w * h, int);
+    runs->maxy = snewn(w * h, int);
+
+    /* A square sees as far as its neighbour does in the same direction,
+     * unless that neighbour is black (or missing). This holds for black
+     * squares too, just as list_lights has always treated them. */
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < w; x++) {
+            i = y*w + x;
+            runs->minx[i] = (x == 0 || (state->flags[i-1] & F_BLACK)) ?
+                x : runs->minx[i-1];
+            runs->miny[i] = (y == 0 || (state->flags[i-w] & F_BLACK)) ?
+                y : runs->miny[i-w];
+        }
+    }
+    for (y = h-1; y >= 0; y--) {
+        for (x = w-1; x >= 0; x--) {
+            i = y*w + x;
+            runs->maxx[i] = (x == w-1 || (state->flags[i+1] & F_BLACK)) ?
+                x : runs->maxx[i+1];
+            runs->maxy[i] = (y == h-1 || (state->flags[i+w] & F_BLACK)) ?
+                y : runs->maxy[i+w];
+        }
+    }
+
+    free_runs(state->runs);
+    state->runs = runs;
+}
+
 static void debug_state(game_state *state)
 {
     int x, y;
@@ -684,31 +748,16 @@ static void set_blacks(game_state *state, const game_params *params,
 static void list_lights(game_state *state, int ox, int oy, bool origin,
                         ll_data *lld)
 {
-    int x,y;
+    int i = oy * state->w + ox;
 
-    lld->ox = lld->minx = lld->maxx = ox;
-    lld->oy = lld->miny = lld->maxy = oy;
+    assert(state->runs);
+    lld->ox = ox;
+    lld->oy = oy;
+    lld->minx = state->runs->minx[i];
+    lld->maxx = state->runs->maxx[i];
+    lld->miny = state->runs->miny[i];
+    lld->maxy = state->runs->maxy[i];
     lld->include_origin = origin;
-
-    y = oy;
-    for (x = ox-1; x >= 0; x--) {
-        if (GRID(state, flags, x, y) & F_BLACK) break;
-        if (x < lld->minx) lld->minx = x;
-    }
-    for (x = ox+1; x < state->w; x++) {
-        if (GRID(state, flags, x, y) & F_BLACK) break;
-        if (x > lld->maxx) lld->maxx = x;
-    }
-
-    x = ox;
-    for (y = oy-1; y >= 0; y--) {
-        if (GRID(state, flags, x, y) & F_BLACK) break;
-        if (y < lld->miny) lld->miny = y;
-    }
-    for (y = oy+1; y < state->h; y++) {
-        if (GRID(state, flags, x, y) & F_BLACK) break;
-        if (y > lld->maxy) lld->maxy = y;
-    }
 }
 
 /* Makes sure a light is the given state, editing the lights table to suit the
@@ -1572,6 +1621,7 @@ static char *new_game_desc(const game_params *params_in, random_state *rs,
     while (1) {
         for (i = 0; i < MAX_GRIDGEN_TRIES; i++) {
             set_blacks(news, params, rs); /* also cleans board. */
+            find_runs(news);
 
             /* set up lights and then the numbers, and remove the lights */
             place_lights(news, rs);
@@ -1730,6 +1780,7 @@ static game_state *new_game(midend *me, const game_params *params,
     }
     if (*desc) assert(!"Over-long desc.");
 
+    find_runs(ret);
     return ret;
 }
 
@@ -8,10 +8,10 @@
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <math.h>
 
 #include "puzzles.h"
-#include "tree234.h"
 #include "grid.h"
 #include "loopgen.h"
 
@@ -21,55 +21,158 @@
  * Each face gets a 'score', which tells us how adding that face right
  * now would affect the curliness of the solution loop.  We're trying to
  * maximise that quantity so will bias our random selection of faces to
- * colour those with high scores */
-struct face_score {
-    int white_score;
-    int black_score;
-    unsigned long random;
-    /* No need to store a grid_face* here.  The 'face_scores' array will
-     * be a list of 'face_score' objects, one for each face of the grid, so
-     * the position (index) within the 'face_scores' array will determine
-     * which face corresponds to a particular face_score.
-     * Having a single 'face_scores' array for all faces simplifies memory
-     * management, and probably improves performance, because we don't have to 
-     * malloc/free each individual face_score, and we don't have to maintain
-     * a mapping from grid_face* pointers to face_score* pointers.
-     */
+ * colour those with high scores.
+ *
+ * A score is minus the number of same-coloured neighbours, so it is a
+ * small integer no lower than minus the face's order.  That lets each
+ * list be a bucket queue: one bucket per score, and within a bucket a
+ * bitset indexed by the face's 'rank', its position in a fixed random
+ * ordering of the faces.  The best face is then the lowest set bit in
+ * the best nonempty bucket, and a summary bitset per bucket (one bit
+ * per nonzero word) keeps that search short on big grids. */
+typedef unsigned long queueword;
+#define QUEUE_WORD_BITS ((int)(sizeof(queueword) * CHAR_BIT))
+
+struct face_queue {
+    int nbuckets;                      /* bucket b holds faces of score -b */
+    int nwords, nsummary;              /* words per bucket, and per summary */
+    queueword *bits, *summary;
+    int *bucket_count;                 /* faces in each bucket */
+    int *bucket;                       /* bucket of each rank, or -1 */
+    int count;
 };
 
-static int generic_sort_cmpfn(void *v1, void *v2, size_t offset)
+static int queue_lowest_bit(queueword v)
 {
-    struct face_score *f1 = v1;
-    struct face_score *f2 = v2;
-    int r;
+#ifdef __GNUC__
+    return __builtin_ctzl(v);
+#else
+    int n = 0;
+    for (; !(v & 1); v >>= 1)
+        n++;
+    return n;
+#endif
+}
 
-    r = *(int *)((char *)f2 + offset) - *(int *)((char *)f1 + offset);
-    if (r) {
-        return r;
-    }
+static struct face_queue *queue_new(int nranks, int nbuckets)
+{
+    struct face_queue *q = snew(struct face_queue);
+    int i;
 
-    if (f1->random < f2->random)
-        return -1;
-    else if (f1->random > f2->random)
-        return 1;
+    q->nbuckets = nbuckets;
+    q->nwords = (nranks + QUEUE_WORD_BITS - 1) / QUEUE_WORD_BITS;
+    q->nsummary = (q->nwords + QUEUE_WORD_BITS - 1) / QUEUE_WORD_BITS;
+    q->bits = snewn(nbuckets * q->nwords, queueword);
+    q->summary = snewn(nbuckets * q->nsummary, queueword);
+    memset(q->bits, 0, nbuckets * q->nwords * sizeof(queueword));
+    memset(q->summary, 0, nbuckets * q->nsummary * sizeof(queueword));
+    q->bucket_count = snewn(nbuckets, int);
+    for (i = 0; i < nbuckets; i++)
+        q->bucket_count[i] = 0;
+    q->bucket = snewn(nranks, int);
+    for (i = 0; i < nranks; i++)
+        q->bucket[i] = -1;
+    q->count = 0;
+    return q;
+}
 
-    /*
-     * It's _just_ possible that two faces might have been given
-     * the same random value. In that situation, fall back to
-     * comparing based on the positions within the face_scores list.
-     * This introduces a tiny directional bias, but not a significant one.
-     */
-    return f1 - f2;
+static void queue_free(struct face_queue *q)
+{
+    sfree(q->bits);
+    sfree(q->summary);
+    sfree(q->bucket_count);
+    sfree(q->bucket);
+    sfree(q);
 }
 
-static int white_sort_cmpfn(void *v1, void *v2)
+static void queue_add(struct face_queue *q, int rank, int bucket)
 {
-    return generic_sort_cmpfn(v1, v2, offsetof(struct face_score,white_score));
+    int w = rank / QUEUE_WORD_BITS;
+
+    assert(q->bucket[rank] < 0);
+    assert(bucket >= 0 && bucket < q->nbuckets);
+    q->bits[bucket * q->nwords + w] |= (queueword)1 << (rank % QUEUE_WORD_BITS);
+    q->summary[bucket * q->nsummary + w / QUEUE_WORD_BITS] |=
+        (queueword)1 << (w % QUEUE_WORD_BITS);
+    q->bucket[rank] = bucket;
+    q->bucket_count[bucket]++;
+    q->count++;
 }
 
-static int black_sort_cmpfn(void *v1, void *v2)
+/* Remove a face from the queue, if it's in there. */
+static void queue_del(struct face_queue *q, int rank)
 {
-    return generic_sort_cmpfn(v1, v2, offsetof(struct face_score,black_score));
+    int bucket = q->bucket[rank], w = rank / QUEUE_WORD_BITS;
+    queueword *word;
+
+    if (bucket < 0)
+        return;
+    word = &q->bits[bucket * q->nwords + w];
+    *word &= ~((queueword)1 << (rank % QUEUE_WORD_BITS));
+    if (!*word)
+        q->summary[bucket * q->nsummary + w / QUEUE_WORD_BITS] &=
+            ~((queueword)1 << (w % QUEUE_WORD_BITS));
+    q->bucket[rank] = -1;
+    q->bucket_count[bucket]--;
+    q->count--;
+}
+
+/* Return the first rank in queue order at or after position 'rank' of
+ * bucket '*bucket', updating *bucket to the bucket it was found in; or
+ * -1 if there are none. Queue order is by bucket (best score first),
+ * then by rank. */
+static int queue_next(struct face_queue *q, int *bucket, int rank)
+{
+    int b, w, s;
+    queueword v;
+
+    for (b = *bucket; b < q->nbuckets; b++, rank = 0) {
+        const queueword *bits = q->bits + b * q->nwords;
+        const queueword *summary = q->summary + b * q->nsummary;
+
+        if (!q->bucket_count[b] || rank >= q->nwords * QUEUE_WORD_BITS)
+            continue;
+
+        /* Try the rest of the word containing 'rank' first ... */
+        w = rank / QUEUE_WORD_BITS;
+        v = bits[w] & (~(queueword)0 << (rank % QUEUE_WORD_BITS));
+        if (v) {
+            *bucket = b;
+            return w * QUEUE_WORD_BITS + queue_lowest_bit(v);
+        }
+
+        /* ... then use the summary to find the next nonzero word. */
+        w++;
+        s = w / QUEUE_WORD_BITS;
+        if (s >= q->nsummary)
+            continue;
+        v = summary[s] & (~(queueword)0 << (w % QUEUE_WORD_BITS));
+        while (!v && ++s < q->nsummary)
+            v = summary[s];
+        if (v) {
+            w = s * QUEUE_WORD_BITS + queue_lowest_bit(v);
+            *bucket = b;
+            return w * QUEUE_WORD_BITS + queue_lowest_bit(bits[w]);
+        }
+    }
+    return -1;
+}
+
+/* Sort face indices by the random numbers assigned to the faces.
+ * It's _just_ possible that two faces might have been given the same
+ * random value. In that situation, fall back to comparing the face
+ * indices. This introduces a tiny directional bias, but not a
+ * significant one. */
+static int face_random_cmp(const void *av, const void *bv, void *ctx)
+{
+    const unsigned long *random = (const unsigned long *)ctx;
+    int a = *(const int *)av, b = *(const int *)bv;
+
+    if (random[a] < random[b])
+        return -1;
+    else if (random[a] > random[b])
+        return 1;
+    return a < b ? -1 : a > b ? 1 : 0;
 }
 
 /* 'board' is an array of enum face_colour, indicating which faces are
@@ -226,19 +329,6 @@ static int face_num_neighbours(grid *g, char *board, grid_face *face,
     return colour_count;
 }
 
-/* The 'score' of a face reflects its current desirability for selection
- * as the next face to colour white or black.  We want to encourage moving
- * into grey areas and increasing loopiness, so we give scores according to
- * how many of the face's neighbours are currently coloured the same as the
- * proposed colour. */
-static int face_score(grid *g, char *board, grid_face *face,
-                      enum face_colour colour)
-{
-    /* Simple formula: score = 0 - num. same-coloured neighbours,
-     * so a higher score means fewer same-coloured neighbours. */
-    return -face_num_neighbours(g, board, face, colour);
-}
-
 /*
  * Generate a new complete random closed loop for the given grid.
  *
@@ -300,23 +390,25 @@ void generate_loop(grid *g, char *board, random_state *rs,
 {
     int i, j;
     int num_faces = g->num_faces;
-    struct face_score *face_scores; /* Array of face_score objects */
-    struct face_score *fs; /* Points somewhere in the above list */
+    unsigned long *face_random; /* Random tiebreak for each face */
+    int *rank_face, *face_rank; /* Faces sorted by face_random, and inverse */
+    int *nbr_start, *nbrs = NULL; /* Faces touching each face at a corner */
+    int *mark;
+    int *white_count, *black_count; /* Same-coloured edge neighbours */
+    int max_order;
     struct grid_face *cur_face;
-    tree234 *lightable_faces_sorted;
-    tree234 *darkable_faces_sorted;
+    struct face_queue *lightable_faces_sorted;
+    struct face_queue *darkable_faces_sorted;
     int *face_list;
     bool do_random_pass;
 
     /* Make a board */
     memset(board, FACE_GREY, num_faces);
     
-    /* Create and initialise the list of face_scores */
-    face_scores = snewn(num_faces, struct face_score);
-    for (i = 0; i < num_faces; i++) {
-        face_scores[i].random = random_bits(rs, 31);
-        face_scores[i].black_score = face_scores[i].white_score = 0;
-    }
+    /* Give each face its random tiebreak */
+    face_random = snewn(num_faces, unsigned long);
+    for (i = 0; i < num_faces; i++)
+        face_random[i] = random_bits(rs, 31);
     
     /* Colour a random, finite face white.  The infinite face is implicitly
      * coloured black.  Together, they will seed the random growth process
@@ -329,44 +421,99 @@ void generate_loop(grid *g, char *board, random_state *rs,
      * their score and choose randomly from that with appropriate skew.
      * In order to avoid consistently biasing towards particular faces, we
      * need the sort order _within_ each group of scores to be completely
-     * random.  But it would be abusing the hospitality of the tree234 data
-     * structure if our comparison function were nondeterministic :-).  So with
-     * each face we associate a random number that does not change during a
-     * particular run of the generator, and use that as a secondary sort key.
+     * random.  So with each face we associate a random number that does
+     * not change during a particular run of the generator, and use that
+     * as a secondary sort key, which the queues see as the face's rank.
      * Yes, this means we will be biased towards particular random faces in
      * any one run but that doesn't actually matter. */
+    rank_face = snewn(num_faces, int);
+    face_rank = snewn(num_faces, int);
+    for (i = 0; i < num_faces; i++)
+        rank_face[i] = i;
+    arraysort(rank_face, num_faces, face_random_cmp, face_random);
+    for (i = 0; i < num_faces; i++)
+        face_rank[rank_face[i]] = i;
+
+    /* Colouring a face can change the colourability of every face that
+     * touches it, even just at a corner, so list those once for each
+     * face rather than walking round its dots every time. */
+    nbr_start = snewn(num_faces + 1, int);
+    mark = snewn(num_faces, int);
+    for (i = 0; i < num_faces; i++)
+        mark[i] = -1;
+    for (j = 0; j < 2; j++) {
+        int n = 0;
+        for (i = 0; i < num_faces; i++) {
+            grid_face *f = g->faces + i;
+            int k, m;
+            if (j == 0)
+                nbr_start[i] = n;
+            mark[i] = i + j * num_faces;
+            for (k = 0; k < f->order; k++) {
+                grid_dot *d = f->dots[k];
+                for (m = 0; m < d->order; m++) {
+                    grid_face *f2 = d->faces[m];
+                    int fi;
+                    if (f2 == NULL)
+                        continue;
+                    fi = f2 - g->faces;
+                    if (mark[fi] == i + j * num_faces)
+                        continue;
+                    mark[fi] = i + j * num_faces;
+                    if (j == 1)
+                        nbrs[n] = fi;
+                    n++;
+                }
+            }
+        }
+        if (j == 0) {
+            nbr_start[num_faces] = n;
+            nbrs = snewn(n, int);
+        }
+    }
+    sfree(mark);
+
+    /* A face's score for a colour is minus the number of its edges
+     * shared with faces of that colour, so keep those counts up to
+     * date as faces are coloured rather than recounting them. */
+    white_count = snewn(num_faces, int);
+    black_count = snewn(num_faces, int);
+    max_order = 0;
+    for (i = 0; i < num_faces; i++) {
+        grid_face *f = g->faces + i;
+        white_count[i] = face_num_neighbours(g, board, f, FACE_WHITE);
+        black_count[i] = face_num_neighbours(g, board, f, FACE_BLACK);
+        if (max_order < f->order)
+            max_order = f->order;
+    }
 
-    lightable_faces_sorted = newtree234(white_sort_cmpfn);
-    darkable_faces_sorted = newtree234(black_sort_cmpfn);
+    lightable_faces_sorted = queue_new(num_faces, max_order + 1);
+    darkable_faces_sorted = queue_new(num_faces, max_order + 1);
 
     /* Initialise the lists of lightable and darkable faces.  This is
      * slightly different from the code inside the while-loop, because we need
      * to check every face of the board (the grid structure does not keep a
      * list of the infinite face's neighbours). */
     for (i = 0; i < num_faces; i++) {
-        grid_face *f = g->faces + i;
-        struct face_score *fs = face_scores + i;
         if (board[i] != FACE_GREY) continue;
         /* We need the full colourability check here, it's not enough simply
          * to check neighbourhood.  On some grids, a neighbour of the infinite
          * face is not necessarily darkable. */
-        if (can_colour_face(g, board, i, FACE_BLACK)) {
-            fs->black_score = face_score(g, board, f, FACE_BLACK);
-            add234(darkable_faces_sorted, fs);
-        }
-        if (can_colour_face(g, board, i, FACE_WHITE)) {
-            fs->white_score = face_score(g, board, f, FACE_WHITE);
-            add234(lightable_faces_sorted, fs);
-        }
+        if (can_colour_face(g, board, i, FACE_BLACK))
+            queue_add(darkable_faces_sorted, face_rank[i], black_count[i]);
+        if (can_colour_face(g, board, i, FACE_WHITE))
+            queue_add(lightable_faces_sorted, face_rank[i], white_count[i]);
     }
 
     /* Colour faces one at a time until no more faces are colourable. */
     while (true)
     {
         enum face_colour colour;
-        tree234 *faces_to_pick;
-        int c_lightable = count234(lightable_faces_sorted);
-        int c_darkable = count234(darkable_faces_sorted);
+        struct face_queue *faces_to_pick;
+        int *colour_count;
+        int c_lightable = lightable_faces_sorted->count;
+        int c_darkable = darkable_faces_sorted->count;
+        int bucket, rank;
         if (c_lightable == 0 && c_darkable == 0) {
             /* No more faces we can use at all. */
             break;
@@ -377,44 +524,43 @@ void generate_loop(grid *g, char *board, random_state *rs,
          * with that colour. */
         colour = random_upto(rs, 2) ? FACE_WHITE : FACE_BLACK;
 
-        if (colour == FACE_WHITE)
+        if (colour == FACE_WHITE) {
             faces_to_pick = lightable_faces_sorted;
-        else
+            colour_count = white_count;
+        } else {
             faces_to_pick = darkable_faces_sorted;
+            colour_count = black_count;
+        }
+        bucket = 0;
+        rank = queue_next(faces_to_pick, &bucket, 0);
         if (bias) {
             /*
              * Go through all the candidate faces and pick the one the
              * bias function likes best, breaking ties using the
-             * ordering in our tree234 (which is why we replace only
+             * ordering in our queue (which is why we replace only
              * if score > bestscore, not >=).
              */
-            int j, k;
-            struct face_score *best = NULL;
+            int k, best = -1;
             int score, bestscore = 0;
 
-            for (j = 0;
-                 (fs = (struct face_score *)index234(faces_to_pick, j))!=NULL;
-                 j++) {
-
-                assert(fs);
-                k = fs - face_scores;
+            for (; rank >= 0;
+                 rank = queue_next(faces_to_pick, &bucket, rank + 1)) {
+                k = rank_face[rank];
                 assert(board[k] == FACE_GREY);
                 board[k] = colour;
                 score = bias(biasctx, board, k);
                 board[k] = FACE_GREY;
                 bias(biasctx, board, k); /* let bias know we put it back */
 
-                if (!best || score > bestscore) {
+                if (best < 0 || score > bestscore) {
                     bestscore = score;
-                    best = fs;
+                    best = rank;
                 }
             }
-            fs = best;
-        } else {
-            fs = (struct face_score *)index234(faces_to_pick, 0);
+            rank = best;
         }
-        assert(fs);
-        i = fs - face_scores;
+        assert(rank >= 0);
+        i = rank_face[rank];
         assert(board[i] == FACE_GREY);
         board[i] = colour;
         if (bias)
@@ -422,62 +568,60 @@ void generate_loop(grid *g, char *board, random_state *rs,
 
         /* Remove this newly-coloured face from the lists.  These lists should
          * only contain grey faces. */
-        del234(lightable_faces_sorted, fs);
-        del234(darkable_faces_sorted, fs);
+        queue_del(lightable_faces_sorted, rank);
+        queue_del(darkable_faces_sorted, rank);
 
         /* Remember which face we've just coloured */
         cur_face = g->faces + i;
 
+        /* Each face sharing an edge with it now has one more neighbour
+         * of this colour. */
+        for (j = 0; j < cur_face->order; j++) {
+            grid_edge *e = cur_face->edges[j];
+            grid_face *f = (e->face1 == cur_face) ? e->face2 : e->face1;
+            if (f != NULL)
+                colour_count[f - g->faces]++;
+        }
+
         /* The face we've just coloured potentially affects the colourability
          * and the scores of any neighbouring faces (touching at a corner or
-         * edge).  So the search needs to be conducted around all faces
-         * touching the one we've just lit.  Iterate over its corners, then
-         * over each corner's faces.  For each such face, we remove it from
-         * the lists, recalculate any scores, then add it back to the lists
-         * (depending on whether it is lightable, darkable or both). */
-        for (i = 0; i < cur_face->order; i++) {
-            grid_dot *d = cur_face->dots[i];
-            for (j = 0; j < d->order; j++) {
-                grid_face *f = d->faces[j];
-                int fi; /* face index of f */
-
-                if (f == NULL)
-                    continue;
-                if (f == cur_face)
-                    continue;
-                
-                /* If the face is already coloured, it won't be on our
-                 * lightable/darkable lists anyway, so we can skip it without 
-                 * bothering with the removal step. */
-                if (FACE_COLOUR(f) != FACE_GREY) continue; 
-
-                /* Find the face index and face_score* corresponding to f */
-                fi = f - g->faces;                
-                fs = face_scores + fi;
-
-                /* Remove from lightable list if it's in there.  We do this,
-                 * even if it is still lightable, because the score might
-                 * be different, and we need to remove-then-add to maintain
-                 * correct sort order. */
-                del234(lightable_faces_sorted, fs);
-                if (can_colour_face(g, board, fi, FACE_WHITE)) {
-                    fs->white_score = face_score(g, board, f, FACE_WHITE);
-                    add234(lightable_faces_sorted, fs);
-                }
-                /* Do the same for darkable list. */
-                del234(darkable_faces_sorted, fs);
-                if (can_colour_face(g, board, fi, FACE_BLACK)) {
-                    fs->black_score = face_score(g, board, f, FACE_BLACK);
-                    add234(darkable_faces_sorted, fs);
-                }
-            }
+         * edge).  For each such face, we remove it from the lists, then add
+         * it back with its new score (depending on whether it is lightable,
+         * darkable or both). */
+        for (j = nbr_start[i]; j < nbr_start[i+1]; j++) {
+            int fi = nbrs[j]; /* face index of neighbour */
+
+            /* If the face is already coloured, it won't be on our
+             * lightable/darkable lists anyway, so we can skip it without 
+             * bothering with the removal step. */
+            if (board[fi] != FACE_GREY) continue; 
+
+            /* Remove from lightable list if it's in there.  We do this,
+             * even if it is still lightable, because the score might
+             * be different, and we need to remove-then-add to put it
+             * in the right bucket. */
+            queue_del(lightable_faces_sorted, face_rank[fi]);
+            if (can_colour_face(g, board, fi, FACE_WHITE))
+                queue_add(lightable_faces_sorted, face_rank[fi],
+                          white_count[fi]);
+            /* Do the same for darkable list. */
+            queue_del(darkable_faces_sorted, face_rank[fi]);
+            if (can_colour_face(g, board, fi, FACE_BLACK))
+                queue_add(darkable_faces_sorted, face_rank[fi],
+                          black_count[fi]);
         }
     }
 
     /* Clean up */
-    freetree234(lightable_faces_sorted);
-    freetree234(darkable_faces_sorted);
-    sfree(face_scores);
+    queue_free(lightable_faces_sorted);
+    queue_free(darkable_faces_sorted);
+    sfree(white_count);
+    sfree(black_count);
+    sfree(nbr_start);
+    sfree(nbrs);
+    sfree(rank_face);
+    sfree(face_rank);
+    sfree(face_random);
 
     /* The next step requires a shuffled list of all faces */
     face_list = snewn(num_faces, int);
@@ -164,6 +164,17 @@ typedef struct solver_state {
 
     /* Hard level information */
     int *linedsf;
+    /* Circular lists of the members of each linedsf class: linedsf_next[i]
+     * is the next line after i in the same class. */
+    int *linedsf_next;
+
+    /* To-do lists for the deduction functions. A face or dot is on one
+     * of these if something that function's deductions about it depend
+     * on has changed since it last looked there. The dline and linedsf
+     * lists are NULL when the difficulty doesn't use those functions. */
+    tdq *trivial_faces, *trivial_dots;
+    tdq *dline_faces, *dline_dots;
+    tdq *linedsf_faces, *linedsf_dots;
 } solver_state;
 
 /*
@@ -248,6 +259,7 @@ static const char *validate_desc(const game_params *params, const char *desc);
 static int dot_order(const game_state* state, int i, char line_type);
 static int face_order(const game_state* state, int i, char line_type);
 static solver_state *solve_game_rec(const solver_state *sstate);
+static void solve_in_place(solver_state *sstate);
 
 #ifdef DEBUG_CACHES
 static void check_caches(const solver_state* sstate);
@@ -350,8 +362,7 @@ static game_state *dup_game(const game_state *state)
 {
     game_state *ret = snew(game_state);
 
-    ret->game_grid = state->game_grid;
-    ret->game_grid->refcount++;
+    ret->game_grid = grid_ref(state->game_grid);
 
     ret->solved = state->solved;
     ret->cheated = state->cheated;
@@ -382,6 +393,48 @@ static void free_game(game_state *state)
     }
 }
 
+/* Give a solver state a full set of to-do lists, with everything on them. */
+static void new_solver_queues(solver_state *sstate)
+{
+    int num_dots = sstate->state->game_grid->num_dots;
+    int num_faces = sstate->state->game_grid->num_faces;
+
+    sstate->trivial_faces = tdq_new(num_faces);
+    sstate->trivial_dots = tdq_new(num_dots);
+    tdq_fill(sstate->trivial_faces);
+    tdq_fill(sstate->trivial_dots);
+
+    sstate->dline_faces = sstate->dline_dots = NULL;
+    if (sstate->dlines) {
+        sstate->dline_faces = tdq_new(num_faces);
+        sstate->dline_dots = tdq_new(num_dots);
+        tdq_fill(sstate->dline_faces);
+        tdq_fill(sstate->dline_dots);
+    }
+
+    sstate->linedsf_faces = sstate->linedsf_dots = NULL;
+    if (sstate->linedsf) {
+        sstate->linedsf_faces = tdq_new(num_faces);
+        sstate->linedsf_dots = tdq_new(num_dots);
+        tdq_fill(sstate->linedsf_faces);
+        tdq_fill(sstate->linedsf_dots);
+    }
+}
+
+static void free_solver_queues(solver_state *sstate)
+{
+    tdq_free(sstate->trivial_faces);
+    tdq_free(sstate->trivial_dots);
+    if (sstate->dline_faces) {
+        tdq_free(sstate->dline_faces);
+        tdq_free(sstate->dline_dots);
+    }
+    if (sstate->linedsf_faces) {
+        tdq_free(sstate->linedsf_faces);
+        tdq_free(sstate->linedsf_dots);
+    }
+}
+
 static solver_state *new_solver_state(const game_state *state, int diff) {
     int i;
     int num_dots = state->game_grid->num_dots;
@@ -424,10 +477,16 @@ static solver_state *new_solver_state(const game_state *state, int diff) {
 
     if (diff < DIFF_HARD) {
         ret->linedsf = NULL;
+        ret->linedsf_next = NULL;
     } else {
         ret->linedsf = snew_dsf(state->game_grid->num_edges);
+        ret->linedsf_next = snewn(num_edges, int);
+        for (i = 0; i < num_edges; i++)
+            ret->linedsf_next[i] = i;
     }
 
+    new_solver_queues(ret);
+
     return ret;
 }
 
@@ -446,6 +505,9 @@ static void free_solver_state(solver_state *sstate) {
         /* OK, because sfree(NULL) is a no-op */
         sfree(sstate->dlines);
         sfree(sstate->linedsf);
+        sfree(sstate->linedsf_next);
+
+        free_solver_queues(sstate);
 
         sfree(sstate);
     }
@@ -497,13 +559,87 @@ static solver_state *dup_solver_state(const solver_state *sstate) {
         ret->linedsf = snewn(num_edges, int);
         memcpy(ret->linedsf, sstate->linedsf,
                num_edges * sizeof(int));
+        ret->linedsf_next = snewn(num_edges, int);
+        memcpy(ret->linedsf_next, sstate->linedsf_next,
+               num_edges * sizeof(int));
     } else {
         ret->linedsf = NULL;
+        ret->linedsf_next = NULL;
     }
 
+    /* The copy starts by looking at everything again, which is always
+     * safe. */
+    new_solver_queues(ret);
+
     return ret;
 }
 
+/*
+ * Put an existing solver state back to how new_solver_state would have
+ * made it for the given game state, which must be on the same grid,
+ * without allocating anything. This lets the generator try removing
+ * each clue in turn with a single solver state.
+ */
+static void reset_solver_state(solver_state *sstate, const game_state *state)
+{
+    grid *g = state->game_grid;
+    int num_dots = g->num_dots;
+    int num_faces = g->num_faces;
+    int num_edges = g->num_edges;
+    int i;
+
+    assert(sstate->state->game_grid == g);
+
+    memcpy(sstate->state->clues, state->clues, num_faces);
+    memcpy(sstate->state->lines, state->lines, num_edges);
+    memcpy(sstate->state->line_errors, state->line_errors,
+           num_edges * sizeof(bool));
+    sstate->state->exactly_one_loop = state->exactly_one_loop;
+    sstate->state->solved = state->solved;
+    sstate->state->cheated = state->cheated;
+
+    sstate->solver_status = SOLVER_INCOMPLETE;
+
+    dsf_init(sstate->dotdsf, num_dots);
+    for (i = 0; i < num_dots; i++)
+        sstate->looplen[i] = 1;
+
+    memset(sstate->dot_solved, 0, num_dots * sizeof(bool));
+    memset(sstate->face_solved, 0, num_faces * sizeof(bool));
+    memset(sstate->dot_yes_count, 0, num_dots);
+    memset(sstate->dot_no_count, 0, num_dots);
+    memset(sstate->face_yes_count, 0, num_faces);
+    memset(sstate->face_no_count, 0, num_faces);
+
+    if (sstate->dlines)
+        memset(sstate->dlines, 0, 2*num_edges);
+
+    if (sstate->linedsf) {
+        dsf_init(sstate->linedsf, num_edges);
+        for (i = 0; i < num_edges; i++)
+            sstate->linedsf_next[i] = i;
+    }
+
+    /* Empty each to-do list and refill it, so that everything is on it
+     * in the same order as in a new one. */
+    while (tdq_remove(sstate->trivial_faces) >= 0);
+    while (tdq_remove(sstate->trivial_dots) >= 0);
+    tdq_fill(sstate->trivial_faces);
+    tdq_fill(sstate->trivial_dots);
+    if (sstate->dline_faces) {
+        while (tdq_remove(sstate->dline_faces) >= 0);
+        while (tdq_remove(sstate->dline_dots) >= 0);
+        tdq_fill(sstate->dline_faces);
+        tdq_fill(sstate->dline_dots);
+    }
+    if (sstate->linedsf_faces) {
+        while (tdq_remove(sstate->linedsf_faces) >= 0);
+        while (tdq_remove(sstate->linedsf_dots) >= 0);
+        tdq_fill(sstate->linedsf_faces);
+        tdq_fill(sstate->linedsf_dots);
+    }
+}
+
 static game_params *default_params(void)
 {
     game_params *ret = snew(game_params);
@@ -1172,6 +1308,37 @@ static void check_caches(const solver_state* sstate)
  * Solver utility functions
  */
 
+/* Put the faces and dots whose deductions depend on line i back on the
+ * to-do lists, because the line has just been set. */
+static void queue_line(solver_state *sstate, int i)
+{
+    grid *g = sstate->state->game_grid;
+    int j, k;
+
+    for (j = 0; j < 2; j++) {
+        int d = g->edge_dots[2*i+j];
+        int f = g->edge_faces[2*i+j];
+        grid_dot *dot = g->dots + d;
+
+        tdq_add(sstate->trivial_dots, d);
+        /* trivial_deductions looks at every line meeting each corner of
+         * a face, not just the lines around it. */
+        for (k = 0; k < dot->order; k++)
+            if (dot->faces[k])
+                tdq_add(sstate->trivial_faces, dot->faces[k] - g->faces);
+        if (sstate->dline_dots) {
+            tdq_add(sstate->dline_dots, d);
+            if (f >= 0)
+                tdq_add(sstate->dline_faces, f);
+        }
+        if (sstate->linedsf_dots) {
+            tdq_add(sstate->linedsf_dots, d);
+            if (f >= 0)
+                tdq_add(sstate->linedsf_faces, f);
+        }
+    }
+}
+
 /* Sets the line (with index i) to the new state 'line_new', and updates
  * the cached counts of any affected faces and dots.
  * Returns true if this actually changed the line's state. */
@@ -1183,8 +1350,7 @@ static bool solver_set_line(solver_state *sstate, int i,
                             )
 {
     game_state *state = sstate->state;
-    grid *g;
-    grid_edge *e;
+    const int *dots, *faces;
 
     assert(line_new != LINE_UNKNOWN);
 
@@ -1201,27 +1367,29 @@ static bool solver_set_line(solver_state *sstate, int i,
             reason);
 #endif
 
-    g = state->game_grid;
-    e = g->edges + i;
+    queue_line(sstate, i);
+
+    dots = state->game_grid->edge_dots + 2*i;
+    faces = state->game_grid->edge_faces + 2*i;
 
     /* Update the cache for both dots and both faces affected by this. */
     if (line_new == LINE_YES) {
-        sstate->dot_yes_count[e->dot1 - g->dots]++;
-        sstate->dot_yes_count[e->dot2 - g->dots]++;
-        if (e->face1) {
-            sstate->face_yes_count[e->face1 - g->faces]++;
+        sstate->dot_yes_count[dots[0]]++;
+        sstate->dot_yes_count[dots[1]]++;
+        if (faces[0] >= 0) {
+            sstate->face_yes_count[faces[0]]++;
         }
-        if (e->face2) {
-            sstate->face_yes_count[e->face2 - g->faces]++;
+        if (faces[1] >= 0) {
+            sstate->face_yes_count[faces[1]]++;
         }
     } else {
-        sstate->dot_no_count[e->dot1 - g->dots]++;
-        sstate->dot_no_count[e->dot2 - g->dots]++;
-        if (e->face1) {
-            sstate->face_no_count[e->face1 - g->faces]++;
+        sstate->dot_no_count[dots[0]]++;
+        sstate->dot_no_count[dots[1]]++;
+        if (faces[0] >= 0) {
+            sstate->face_no_count[faces[0]]++;
         }
-        if (e->face2) {
-            sstate->face_no_count[e->face2 - g->faces]++;
+        if (faces[1] >= 0) {
+            sstate->face_no_count[faces[1]]++;
         }
     }
 
@@ -1245,10 +1413,9 @@ static bool merge_dots(solver_state *sstate, int edge_index)
 {
     int i, j, len;
     grid *g = sstate->state->game_grid;
-    grid_edge *e = g->edges + edge_index;
 
-    i = e->dot1 - g->dots;
-    j = e->dot2 - g->dots;
+    i = g->edge_dots[2*edge_index];
+    j = g->edge_dots[2*edge_index+1];
 
     i = dsf_canonify(sstate->dotdsf, i);
     j = dsf_canonify(sstate->dotdsf, j);
@@ -1283,6 +1450,39 @@ static bool merge_lines(solver_state *sstate, int i, int j, bool inverse
     j = edsf_canonify(sstate->linedsf, j, &inv_tmp);
     inverse ^= inv_tmp;
 
+    if (i != j) {
+        grid *g = sstate->state->game_grid;
+        int *next = sstate->linedsf_next;
+        int a = next[i], b = next[j], start, k, t;
+
+        /*
+         * Any face or dot whose linedsf deductions this merge affects
+         * has a line in each class, so it's enough to requeue the
+         * faces and dots of every line in the smaller class. Walk both
+         * lists together to find out which one that is.
+         */
+        while (a != i && b != j) {
+            a = next[a];
+            b = next[b];
+        }
+        start = k = (a == i ? i : j);
+        do {
+            for (t = 0; t < 2; t++) {
+                int f = g->edge_faces[2*k+t];
+                tdq_add(sstate->linedsf_dots, g->edge_dots[2*k+t]);
+                if (f >= 0)
+                    tdq_add(sstate->linedsf_faces, f);
+            }
+            k = next[k];
+        } while (k != start);
+
+        /* Swapping a successor in each of two circular lists splices
+         * them together. */
+        t = next[i];
+        next[i] = next[j];
+        next[j] = t;
+    }
+
     edsf_merge(sstate->linedsf, i, j, inverse);
 
 #ifdef SHOW_WORKING
@@ -1306,14 +1506,11 @@ static int dot_order(const game_state* state, int dot, char line_type)
 {
     int n = 0;
     grid *g = state->game_grid;
-    grid_dot *d = g->dots + dot;
     int i;
 
-    for (i = 0; i < d->order; i++) {
-        grid_edge *e = d->edges[i];
-        if (state->lines[e - g->edges] == line_type)
+    for (i = g->dot_edge_start[dot]; i < g->dot_edge_start[dot+1]; i++)
+        if (state->lines[g->dot_edges[i]] == line_type)
             ++n;
-    }
     return n;
 }
 
@@ -1323,14 +1520,11 @@ static int face_order(const game_state* state, int face, char line_type)
 {
     int n = 0;
     grid *g = state->game_grid;
-    grid_face *f = g->faces + face;
     int i;
 
-    for (i = 0; i < f->order; i++) {
-        grid_edge *e = f->edges[i];
-        if (state->lines[e - g->edges] == line_type)
+    for (i = g->face_edge_start[face]; i < g->face_edge_start[face+1]; i++)
+        if (state->lines[g->face_edges[i]] == line_type)
             ++n;
-    }
     return n;
 }
 
@@ -1342,17 +1536,15 @@ static bool dot_setall(solver_state *sstate, int dot,
     bool retval = false, r;
     game_state *state = sstate->state;
     grid *g;
-    grid_dot *d;
     int i;
 
     if (old_type == new_type)
         return false;
 
     g = state->game_grid;
-    d = g->dots + dot;
 
-    for (i = 0; i < d->order; i++) {
-        int line_index = d->edges[i] - g->edges;
+    for (i = g->dot_edge_start[dot]; i < g->dot_edge_start[dot+1]; i++) {
+        int line_index = g->dot_edges[i];
         if (state->lines[line_index] == old_type) {
             r = solver_set_line(sstate, line_index, new_type);
             assert(r);
@@ -1369,17 +1561,15 @@ static bool face_setall(solver_state *sstate, int face,
     bool retval = false, r;
     game_state *state = sstate->state;
     grid *g;
-    grid_face *f;
     int i;
 
     if (old_type == new_type)
         return false;
 
     g = state->game_grid;
-    f = g->faces + face;
 
-    for (i = 0; i < f->order; i++) {
-        int line_index = f->edges[i] - g->edges;
+    for (i = g->face_edge_start[face]; i < g->face_edge_start[face+1]; i++) {
+        int line_index = g->face_edges[i];
         if (state->lines[line_index] == old_type) {
             r = solver_set_line(sstate, line_index, new_type);
             assert(r);
@@ -1427,15 +1617,13 @@ static void add_full_clues(game_state *state, random_state *rs)
 static bool game_has_unique_soln(const game_state *state, int diff)
 {
     bool ret;
-    solver_state *sstate_new;
     solver_state *sstate = new_solver_state((game_state *)state, diff);
 
-    sstate_new = solve_game_rec(sstate);
+    solve_in_place(sstate);
 
-    assert(sstate_new->solver_status != SOLVER_MISTAKE);
-    ret = (sstate_new->solver_status == SOLVER_SOLVED);
+    assert(sstate->solver_status != SOLVER_MISTAKE);
+    ret = (sstate->solver_status == SOLVER_SOLVED);
 
-    free_solver_state(sstate_new);
     free_solver_state(sstate);
 
     return ret;
@@ -1448,7 +1636,8 @@ static game_state *remove_clues(game_state *state, random_state *rs,
 {
     int *face_list;
     int num_faces = state->game_grid->num_faces;
-    game_state *ret = dup_game(state), *saved_ret;
+    game_state *ret = dup_game(state);
+    solver_state *sstate;
     int n;
 
     /* We need to remove some clues.  We'll do this by forming a list of all
@@ -1462,17 +1651,24 @@ static game_state *remove_clues(game_state *state, random_state *rs,
 
     shuffle(face_list, num_faces, sizeof(int), rs);
 
+    /*
+     * Removing a clue can undo any of the deductions the previous
+     * clue set allowed, so each trial has to solve from scratch; but
+     * they can all share one solver state, reset in place.
+     */
+    sstate = new_solver_state(ret, diff);
     for (n = 0; n < num_faces; ++n) {
-        saved_ret = dup_game(ret);
-        ret->clues[face_list[n]] = -1;
-
-        if (game_has_unique_soln(ret, diff)) {
-            free_game(saved_ret);
-        } else {
-            free_game(ret);
-            ret = saved_ret;
-        }
+        int face = face_list[n];
+        signed char clue = ret->clues[face];
+
+        ret->clues[face] = -1;
+        reset_solver_state(sstate, ret);
+        solve_in_place(sstate);
+        assert(sstate->solver_status != SOLVER_MISTAKE);
+        if (sstate->solver_status != SOLVER_SOLVED)
+            ret->clues[face] = clue;
     }
+    free_solver_state(sstate);
     sfree(face_list);
 
     return ret;
@@ -1924,17 +2120,39 @@ static bool is_atleastone(const char *dline_array, int index)
 {
     return BIT_SET(dline_array[index], 0);
 }
-static bool set_atleastone(char *dline_array, int index)
+/* A dline's flags have changed: requeue its dot, and the faces either
+ * side of its first edge, one of which is the face inside it. */
+static void queue_dline(solver_state *sstate, int index)
 {
-    return SET_BIT(dline_array[index], 0);
+    grid *g = sstate->state->game_grid;
+    int e = index / 2;
+    int d = g->edge_dots[2*e + ((index & 1) ? 0 : 1)];
+    int j;
+
+    tdq_add(sstate->dline_dots, d);
+    for (j = 0; j < 2; j++)
+        if (g->edge_faces[2*e+j] >= 0)
+            tdq_add(sstate->dline_faces, g->edge_faces[2*e+j]);
+    if (sstate->linedsf_dots)
+        tdq_add(sstate->linedsf_dots, d);
+}
+static bool set_atleastone(solver_state *sstate, int index)
+{
+    if (!SET_BIT(sstate->dlines[index], 0))
+        return false;
+    queue_dline(sstate, index);
+    return true;
 }
 static bool is_atmostone(const char *dline_array, int index)
 {
     return BIT_SET(dline_array[index], 1);
 }
-static bool set_atmostone(char *dline_array, int index)
+static bool set_atmostone(solver_state *sstate, int index)
 {
-    return SET_BIT(dline_array[index], 1);
+    if (!SET_BIT(sstate->dlines[index], 1))
+        return false;
+    queue_dline(sstate, index);
+    return true;
 }
 
 static void array_setall(char *array, char from, char to, int len)
@@ -1980,7 +2198,7 @@ static bool dline_set_opp_atleastone(solver_state *sstate,
             continue;
         /* Found opposite UNKNOWNS and they're next to each other */
         opp_dline_index = dline_index_from_dot(g, d, opp);
-        return set_atleastone(sstate->dlines, opp_dline_index);
+        return set_atleastone(sstate, opp_dline_index);
     }
     return false;
 }
@@ -2017,8 +2235,10 @@ static bool face_setall_identical(solver_state *sstate, int face_index,
             can1 = edsf_canonify(sstate->linedsf, line1_index, &inv1);
             can2 = edsf_canonify(sstate->linedsf, line2_index, &inv2);
             if (can1 == can2 && inv1 == inv2) {
-                solver_set_line(sstate, line1_index, line_new);
-                solver_set_line(sstate, line2_index, line_new);
+                if (solver_set_line(sstate, line1_index, line_new))
+                    retval = true;
+                if (solver_set_line(sstate, line2_index, line_new))
+                    retval = true;
             }
         }
     }
@@ -2135,24 +2355,15 @@ static int parity_deductions(solver_state *sstate,
  * solvers which progress more quickly.
  */
 
-/* PROPOSED NEW DESIGN:
- * We have a work queue consisting of 'events' notifying us that something has
- * happened that a particular solver mode might be interested in.  For example
- * the hard mode solver might do something that helps the normal mode solver at
- * dot [x,y] in which case it will enqueue an event recording this fact.  Then
- * we pull events off the work queue, and hand each in turn to the solver that
- * is interested in them.  If a solver reports that it failed we pass the same
- * event on to progressively more advanced solvers and the loop detector.  Once
- * we've exhausted an event, or it has helped us progress, we drop it and
- * continue to the next one.  The events are sorted first in order of solver
- * complexity (easy first) then order of insertion (oldest first).
- * Once we run out of events we loop over each permitted solver in turn
- * (easiest first) until either a deduction is made (and an event therefore
- * emerges) or no further deductions can be made (in which case we've failed).
- *
- * QUESTIONS:
- *    * How do we 'loop over' a solver when both dots and squares are concerned.
- *      Answer: first all squares then all dots.
+/* Work queues:
+ * Each of the face-and-dot solvers keeps a to-do list of faces and one of
+ * dots (see the solver_state), and only looks at the entries on it.
+ * solver_set_line, the dline setters and merge_lines put back every face
+ * and dot whose deductions could have been changed by what they did, so
+ * a solver that finds its lists empty knows it has nothing to add, and
+ * is cheap to call. The order the solvers are called in, and the
+ * difficulty thresholds in solve_game_rec, are unchanged; faces are
+ * still processed before dots.
  */
 
 static int trivial_deductions(solver_state *sstate)
@@ -2163,7 +2374,7 @@ static int trivial_deductions(solver_state *sstate)
     int diff = DIFF_MAX;
 
     /* Per-face deductions */
-    for (i = 0; i < g->num_faces; i++) {
+    while ((i = tdq_remove(sstate->trivial_faces)) >= 0) {
         grid_face *f = g->faces + i;
 
         if (sstate->face_solved[i])
@@ -2219,26 +2430,27 @@ static int trivial_deductions(solver_state *sstate)
              * _both_ be LINE_YES, and hence that pushes us one line
              * closer to being able to determine all the rest.
              */
+            const int *edges = g->face_edges + g->face_edge_start[i];
             int j, k, e1, e2, e, d;
 
             for (j = 0; j < f->order; j++) {
-                e1 = f->edges[j] - g->edges;
-                e2 = f->edges[j+1 < f->order ? j+1 : 0] - g->edges;
+                e1 = edges[j];
+                e2 = edges[j+1 < f->order ? j+1 : 0];
 
-                if (g->edges[e1].dot1 == g->edges[e2].dot1 ||
-                    g->edges[e1].dot1 == g->edges[e2].dot2) {
-                    d = g->edges[e1].dot1 - g->dots;
+                if (g->edge_dots[2*e1] == g->edge_dots[2*e2] ||
+                    g->edge_dots[2*e1] == g->edge_dots[2*e2+1]) {
+                    d = g->edge_dots[2*e1];
                 } else {
-                    assert(g->edges[e1].dot2 == g->edges[e2].dot1 ||
-                           g->edges[e1].dot2 == g->edges[e2].dot2);
-                    d = g->edges[e1].dot2 - g->dots;
+                    assert(g->edge_dots[2*e1+1] == g->edge_dots[2*e2] ||
+                           g->edge_dots[2*e1+1] == g->edge_dots[2*e2+1]);
+                    d = g->edge_dots[2*e1+1];
                 }
 
                 if (state->lines[e1] == LINE_UNKNOWN &&
                     state->lines[e2] == LINE_UNKNOWN) {
-                    for (k = 0; k < g->dots[d].order; k++) {
-                        int e = g->dots[d].edges[k] - g->edges;
-                        if (state->lines[e] == LINE_YES)
+                    for (k = g->dot_edge_start[d];
+                         k < g->dot_edge_start[d+1]; k++) {
+                        if (state->lines[g->dot_edges[k]] == LINE_YES)
                             goto found;    /* multi-level break */
                     }
                 }
@@ -2251,7 +2463,7 @@ static int trivial_deductions(solver_state *sstate)
              * they're e1 and e2.
              */
             for (j = 0; j < f->order; j++) {
-                e = f->edges[j] - g->edges;
+                e = edges[j];
                 if (state->lines[e] == LINE_UNKNOWN && e != e1 && e != e2) {
                     bool r = solver_set_line(sstate, e, LINE_YES);
                     assert(r);
@@ -2264,7 +2476,7 @@ static int trivial_deductions(solver_state *sstate)
     check_caches(sstate);
 
     /* Per-dot deductions */
-    for (i = 0; i < g->num_dots; i++) {
+    while ((i = tdq_remove(sstate->trivial_dots)) >= 0) {
         grid_dot *d = g->dots + i;
         int yes, no, unknown;
 
@@ -2359,7 +2571,7 @@ static int dline_deductions(solver_state *sstate)
      * could get quite expensive if there are many large faces. */
 #define MAX_FACE_SIZE 12
 
-    for (i = 0; i < g->num_faces; i++) {
+    while ((i = tdq_remove(sstate->dline_faces)) >= 0) {
         int maxs[MAX_FACE_SIZE][MAX_FACE_SIZE];
         int mins[MAX_FACE_SIZE][MAX_FACE_SIZE];
         grid_face *f = g->faces + i;
@@ -2477,13 +2689,13 @@ static int dline_deductions(solver_state *sstate)
                 /* minimum YESs in the complement of this dline */
                 if (mins[k][j] > clue - 2) {
                     /* Adding 2 YESs would break the clue */
-                    if (set_atmostone(dlines, dline_index))
+                    if (set_atmostone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
                 /* maximum YESs in the complement of this dline */
                 if (maxs[k][j] < clue) {
                     /* Adding 2 NOs would mean not enough YESs */
-                    if (set_atleastone(dlines, dline_index))
+                    if (set_atleastone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
             }
@@ -2495,7 +2707,7 @@ static int dline_deductions(solver_state *sstate)
 
     /* ------ Dot deductions ------ */
 
-    for (i = 0; i < g->num_dots; i++) {
+    while ((i = tdq_remove(sstate->dline_dots)) >= 0) {
         grid_dot *d = g->dots + i;
         int N = d->order;
         int yes, no, unknown;
@@ -2521,11 +2733,11 @@ static int dline_deductions(solver_state *sstate)
 
             /* Infer dline state from line state */
             if (line1 == LINE_NO || line2 == LINE_NO) {
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
             }
             if (line1 == LINE_YES || line2 == LINE_YES) {
-                if (set_atleastone(dlines, dline_index))
+                if (set_atleastone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
             }
             /* Infer line state from dline state */
@@ -2571,10 +2783,10 @@ static int dline_deductions(solver_state *sstate)
                 }
             }
             if (yes == 1) {
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
                 if (unknown == 2) {
-                    if (set_atleastone(dlines, dline_index))
+                    if (set_atleastone(sstate, dline_index))
                         diff = min(diff, DIFF_NORMAL);
                 }
             }
@@ -2600,7 +2812,7 @@ static int dline_deductions(solver_state *sstate)
                         if (j == N-1 && opp == 0)
                             continue;
                         opp_dline_index = dline_index_from_dot(g, d, opp);
-                        if (set_atmostone(dlines, opp_dline_index))
+                        if (set_atmostone(sstate, opp_dline_index))
                             diff = min(diff, DIFF_NORMAL);
                     }
                     if (yes == 0 && is_atmostone(dlines, dline_index)) {
@@ -2653,7 +2865,7 @@ static int linedsf_deductions(solver_state *sstate)
      * known to be identical.  If setting them both to YES (or NO) would break
      * the clue, set them to NO (or YES). */
 
-    for (i = 0; i < g->num_faces; i++) {
+    while ((i = tdq_remove(sstate->linedsf_faces)) >= 0) {
         int N, yes, no, unknown;
         int clue;
 
@@ -2687,7 +2899,7 @@ static int linedsf_deductions(solver_state *sstate)
     }
 
     /* ------ Dot deductions ------ */
-    for (i = 0; i < g->num_dots; i++) {
+    while ((i = tdq_remove(sstate->linedsf_dots)) >= 0) {
         grid_dot *d = g->dots + i;
         int N = d->order;
         int j;
@@ -2714,9 +2926,9 @@ static int linedsf_deductions(solver_state *sstate)
             can2 = edsf_canonify(sstate->linedsf, line2_index, &inv2);
             if (can1 == can2 && inv1 != inv2) {
                 /* These are opposites, so set dline atmostone/atleastone */
-                if (set_atmostone(dlines, dline_index))
+                if (set_atmostone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
-                if (set_atleastone(dlines, dline_index))
+                if (set_atleastone(sstate, dline_index))
                     diff = min(diff, DIFF_NORMAL);
                 continue;
             }
@@ -2829,9 +3041,8 @@ static int loop_deductions(solver_state *sstate)
      * loop it would create is a solution.
      */
     for (i = 0; i < g->num_edges; i++) {
-        grid_edge *e = g->edges + i;
-        int d1 = e->dot1 - g->dots;
-        int d2 = e->dot2 - g->dots;
+        int d1 = g->edge_dots[2*i];
+        int d2 = g->edge_dots[2*i+1];
         int eqclass, val;
         if (state->lines[i] != LINE_UNKNOWN)
             continue;
@@ -2850,7 +3061,7 @@ static int loop_deductions(solver_state *sstate)
          * it)?
          */
         if (sstate->looplen[eqclass] == edgecount + 1) {
-            int sm1_nearby;
+            int sm1_nearby, j;
 
             /*
              * This edge would form a loop which
@@ -2867,17 +3078,13 @@ static int loop_deductions(solver_state *sstate)
              * side of this edge.
              */
             sm1_nearby = 0;
-            if (e->face1) {
-                int f = e->face1 - g->faces;
-                int c = state->clues[f];
-                if (c >= 0 && sstate->face_yes_count[f] == c - 1)
-                    sm1_nearby++;
-            }
-            if (e->face2) {
-                int f = e->face2 - g->faces;
-                int c = state->clues[f];
-                if (c >= 0 && sstate->face_yes_count[f] == c - 1)
-                    sm1_nearby++;
+            for (j = 0; j < 2; j++) {
+                int f = g->edge_faces[2*i+j];
+                if (f >= 0) {
+                    int c = state->clues[f];
+                    if (c >= 0 && sstate->face_yes_count[f] == c - 1)
+                        sm1_nearby++;
+                }
             }
             if (sm1clues == sm1_nearby &&
 		sm1clues + satclues == clues) {
@@ -2917,12 +3124,29 @@ static int loop_deductions(solver_state *sstate)
     return progress ? DIFF_EASY : DIFF_MAX;
 }
 
-/* This will return a dynamically allocated solver_state containing the (more)
- * solved grid */
-static solver_state *solve_game_rec(const solver_state *sstate_start)
+/* Whether solver i has faces or dots waiting on its to-do lists. */
+static bool solver_has_work(const solver_state *sstate, int i)
 {
-    solver_state *sstate;
+    tdq *faces, *dots;
+
+    if (solver_fns[i] == trivial_deductions) {
+        faces = sstate->trivial_faces;
+        dots = sstate->trivial_dots;
+    } else if (solver_fns[i] == dline_deductions) {
+        faces = sstate->dline_faces;
+        dots = sstate->dline_dots;
+    } else if (solver_fns[i] == linedsf_deductions) {
+        faces = sstate->linedsf_faces;
+        dots = sstate->linedsf_dots;
+    } else {
+        return false;
+    }
+    return faces && (!tdq_empty(faces) || !tdq_empty(dots));
+}
 
+/* Run the solvers on sstate until they finish or get stuck. */
+static void solve_in_place(solver_state *sstate)
+{
     /* Index of the solver we should call next. */
     int i = 0;
     
@@ -2937,25 +3161,27 @@ static solver_state *solve_game_rec(const solver_state *sstate_start)
      *
      * Therefore: if a solver is earlier in the list than "threshold_index",
      * we don't bother running it if it's difficulty level is less than
-     * "threshold_diff".
+     * "threshold_diff" - unless something has been put on its to-do lists
+     * since it last ran, in which case we can't stop before it has
+     * looked at them either. That keeps the outcome independent of the
+     * order in which deductions happened to be found.
      */
     int threshold_diff = 0;
     int threshold_index = 0;
-    
-    sstate = dup_solver_state(sstate_start);
 
     check_caches(sstate);
 
     while (i < NUM_SOLVERS) {
         if (sstate->solver_status == SOLVER_MISTAKE)
-            return sstate;
+            return;
         if (sstate->solver_status == SOLVER_SOLVED ||
             sstate->solver_status == SOLVER_AMBIGUOUS) {
             /* solver finished */
             break;
         }
 
-        if ((solver_diffs[i] >= threshold_diff || i >= threshold_index)
+        if ((solver_diffs[i] >= threshold_diff || i >= threshold_index ||
+             solver_has_work(sstate, i))
             && solver_diffs[i] <= sstate->diff) {
             /* current_solver is eligible, so use it */
             int next_diff = solver_fns[i](sstate);
@@ -2971,6 +3197,15 @@ static solver_state *solve_game_rec(const solver_state *sstate_start)
         /* current_solver is ineligible, or failed to make progress, so
          * go to the next solver in the list */
         i++;
+
+        if (i == NUM_SOLVERS) {
+            /* Go back for any work queued by a solver that changed
+             * something without reporting progress. */
+            for (i = 0; i < NUM_SOLVERS; i++)
+                if (solver_diffs[i] <= sstate->diff &&
+                    solver_has_work(sstate, i))
+                    break;
+        }
     }
 
     if (sstate->solver_status == SOLVER_SOLVED ||
@@ -2978,9 +3213,15 @@ static solver_state *solve_game_rec(const solver_state *sstate_start)
         /* s/LINE_UNKNOWN/LINE_NO/g */
         array_setall(sstate->state->lines, LINE_UNKNOWN, LINE_NO,
                      sstate->state->game_grid->num_edges);
-        return sstate;
     }
+}
 
+/* This will return a dynamically allocated solver_state containing the (more)
+ * solved grid */
+static solver_state *solve_game_rec(const solver_state *sstate_start)
+{
+    solver_state *sstate = dup_solver_state(sstate_start);
+    solve_in_place(sstate);
     return sstate;
 }
 
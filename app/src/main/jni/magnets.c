@@ -280,6 +280,8 @@ struct game_state {
     bool *counts_done;
 
     struct game_common *common; /* domino layout never changes. */
+
+    struct solver_scratch *sc;  /* solver only: see solve_changed */
 };
 
 static void clear_state(game_state *ret)
@@ -351,9 +353,13 @@ static game_state *dup_game(const game_state *src)
     dest->flags = snewn(dest->wh, unsigned int);
     memcpy(dest->flags, src->flags, dest->wh*sizeof(unsigned int));
 
+    dest->sc = NULL;
+
     return dest;
 }
 
+static void free_scratch(struct solver_scratch *sc);
+
 static void free_game(game_state *state)
 {
     state->common->refcount--;
@@ -363,6 +369,7 @@ static void free_game(game_state *state)
         sfree(state->common->colcount);
         sfree(state->common);
     }
+    free_scratch(state->sc);
     sfree(state->counts_done);
     sfree(state->flags);
     sfree(state->grid);
@@ -801,6 +808,98 @@ static int check_completion(game_state *state)
 static const int dx[4] = {-1, 1, 0, 0};
 static const int dy[4] = {0, 0, -1, 1};
 
+/*
+ * Every deduction looks at one cell (and the other half of its
+ * domino), or at one row or column. Having looked somewhere and found
+ * nothing, it needn't look there again until a cell in it changes.
+ * So the solver keeps a bit per cell for each of the cell deductions,
+ * set when the cell or its domino changes and cleared when it is
+ * looked at; and for lines, a stamp of when each line last changed
+ * and when each line deduction last looked at it.
+ */
+enum { DIRTY_FORCE, DIRTY_NEITHER, NDIRTY };
+enum {
+    LINE_CHECKFULL, LINE_ODDLENGTH,
+    LINE_ADVANCEDFULL, LINE_NONNEUTRAL,
+    LINE_COUNTDOMINOES_NEUTRAL, LINE_COUNTDOMINOES_NONNEUTRAL,
+    NLINE
+};
+
+struct solver_scratch {
+    bitgrid *dirty;             /* w*h by NDIRTY */
+    unsigned long stamp;
+    unsigned long *changed;     /* size w+h: columns, then rows */
+    unsigned long *seen;        /* size NLINE*(w+h) */
+};
+
+/* Note that cell i has changed. */
+static void solve_changed(game_state *state, int i)
+{
+    struct solver_scratch *sc = state->sc;
+    int w = state->w;
+
+    if (!sc) return;
+
+    bitgrid_set(sc->dirty, i, DIRTY_FORCE, true);
+    bitgrid_set(sc->dirty, i, DIRTY_NEITHER, true);
+    bitgrid_set(sc->dirty, state->common->dominoes[i], DIRTY_NEITHER, true);
+    sc->changed[i%w] = sc->changed[w + i/w] = ++sc->stamp;
+}
+
+/* Note that anything might have changed. */
+static void solve_alldirty(game_state *state)
+{
+    struct solver_scratch *sc = state->sc;
+    int i, n = state->w + state->h;
+
+    if (!sc) {
+        sc = state->sc = snew(struct solver_scratch);
+        sc->dirty = bitgrid_new(state->wh, NDIRTY);
+        sc->changed = snewn(n, unsigned long);
+        sc->seen = snewn(NLINE * n, unsigned long);
+    }
+    sc->stamp = 1;
+    for (i = 0; i < n; i++)
+        sc->changed[i] = 1;
+    for (i = 0; i < NLINE * n; i++)
+        sc->seen[i] = 0;
+    for (i = 0; i < state->wh; i++) {
+        bitgrid_set(sc->dirty, i, DIRTY_FORCE, true);
+        bitgrid_set(sc->dirty, i, DIRTY_NEITHER, true);
+    }
+}
+
+static void free_scratch(struct solver_scratch *sc)
+{
+    if (!sc) return;
+    bitgrid_free(sc->dirty);
+    sfree(sc->changed);
+    sfree(sc->seen);
+    sfree(sc);
+}
+
+/* Returns the next cell at or after i that is dirty for a cell
+ * deduction, clearing its bit, or -1 if there are none. */
+static int solve_next_dirty(game_state *state, int which, int i)
+{
+    i = bitgrid_row_next(state->sc->dirty, which, i);
+    if (i >= 0)
+        bitgrid_set(state->sc->dirty, i, which, false);
+    return i;
+}
+
+/* Returns true if a line deduction has nothing new to look at in
+ * line n; otherwise notes that it's looking now. */
+static bool solve_line_seen(game_state *state, int which, int n)
+{
+    struct solver_scratch *sc = state->sc;
+    unsigned long *seen = &sc->seen[which * (state->w + state->h) + n];
+
+    if (*seen >= sc->changed[n]) return true;
+    *seen = sc->stamp;
+    return false;
+}
+
 static void solve_clearflags(game_state *state)
 {
     int i;
@@ -810,6 +909,7 @@ static void solve_clearflags(game_state *state)
         if (state->common->dominoes[i] != i)
             state->flags[i] &= ~GS_SET;
     }
+    solve_alldirty(state);
 }
 
 /* Knowing a given cell cannot be a certain colour also tells us
@@ -841,12 +941,14 @@ static int solve_unflag(game_state *state, int i, int which,
     }
     if (POSSIBLE(i, which)) {
         state->flags[i] |= NOTFLAG(which);
+        solve_changed(state, i);
         ret++;
         debug(("solve_unflag: (%d,%d) CANNOT be %s (%s)",
                i%w, i/w, NAME(which), why));
     }
     if (POSSIBLE(ii, OPPOSITE(which))) {
         state->flags[ii] |= NOTFLAG(OPPOSITE(which));
+        solve_changed(state, ii);
         ret++;
         debug(("solve_unflag: (%d,%d) CANNOT be %s (%s, other half)",
                ii%w, ii/w, NAME(OPPOSITE(which)), why));
@@ -941,6 +1043,9 @@ static int solve_set(game_state *state, int i, int which,
     state->flags[i] |= GS_SET;
     state->flags[ii] |= GS_SET;
 
+    solve_changed(state, i);
+    solve_changed(state, ii);
+
     debug(("solve_set: (%d,%d) set to %s (%s)", i%w, i/w, NAME(which), why));
 
     return 1;
@@ -1039,13 +1144,14 @@ static int solve_startflags(game_state *state)
 
 typedef int (*rowcolfn)(game_state *state, rowcol rc, int *counts);
 
-static int solve_rowcols(game_state *state, rowcolfn fn)
+static int solve_rowcols(game_state *state, rowcolfn fn, int which)
 {
     int x, y, didsth = 0, ret;
     rowcol rc;
     int counts[4];
 
     for (x = 0; x < state->w; x++) {
+        if (solve_line_seen(state, which, x)) continue;
         rc = mkrowcol(state, x, COLUMN);
         solve_counts(state, rc, counts, NULL);
 
@@ -1054,6 +1160,7 @@ static int solve_rowcols(game_state *state, rowcolfn fn)
         didsth += ret;
     }
     for (y = 0; y < state->h; y++) {
+        if (solve_line_seen(state, which, state->w + y)) continue;
         rc = mkrowcol(state, y, ROW);
         solve_counts(state, rc, counts, NULL);
 
@@ -1069,7 +1176,8 @@ static int solve_force(game_state *state)
     int i, which, didsth = 0;
     unsigned long f;
 
-    for (i = 0; i < state->wh; i++) {
+    for (i = solve_next_dirty(state, DIRTY_FORCE, 0); i >= 0;
+         i = solve_next_dirty(state, DIRTY_FORCE, i+1)) {
         if (state->flags[i] & GS_SET) continue;
         if (state->common->dominoes[i] == i) continue;
 
@@ -1094,7 +1202,8 @@ static int solve_neither(game_state *state)
 {
     int i, j, didsth = 0;
 
-    for (i = 0; i < state->wh; i++) {
+    for (i = solve_next_dirty(state, DIRTY_NEITHER, 0); i >= 0;
+         i = solve_next_dirty(state, DIRTY_NEITHER, i+1)) {
         if (state->flags[i] & GS_SET) continue;
         j = state->common->dominoes[i];
         if (i == j) continue;
@@ -1374,8 +1483,8 @@ static int solve_countdominoes_nonneutral(game_state *state, rowcol rc, int *cou
 
 /* danger, evil macro. can't use the do { ... } while(0) trick because
  * the continue breaks. */
-#define SOLVE_FOR_ROWCOLS(fn) \
-    ret = solve_rowcols(state, fn); \
+#define SOLVE_FOR_ROWCOLS(fn, which) \
+    ret = solve_rowcols(state, fn, which); \
     if (ret < 0) { debug(("%s said impossible, cannot solve", #fn)); return -1; } \
     if (ret > 0) continue
 
@@ -1397,15 +1506,17 @@ static int solve_state(game_state *state, int diff)
         if (ret > 0) continue;
         if (ret < 0) return -1;
 
-        SOLVE_FOR_ROWCOLS(solve_checkfull);
-        SOLVE_FOR_ROWCOLS(solve_oddlength);
+        SOLVE_FOR_ROWCOLS(solve_checkfull, LINE_CHECKFULL);
+        SOLVE_FOR_ROWCOLS(solve_oddlength, LINE_ODDLENGTH);
 
         if (diff < DIFF_TRICKY) break;
 
-        SOLVE_FOR_ROWCOLS(solve_advancedfull);
-        SOLVE_FOR_ROWCOLS(solve_nonneutral);
-        SOLVE_FOR_ROWCOLS(solve_countdominoes_neutral);
-        SOLVE_FOR_ROWCOLS(solve_countdominoes_nonneutral);
+        SOLVE_FOR_ROWCOLS(solve_advancedfull, LINE_ADVANCEDFULL);
+        SOLVE_FOR_ROWCOLS(solve_nonneutral, LINE_NONNEUTRAL);
+        SOLVE_FOR_ROWCOLS(solve_countdominoes_neutral,
+                          LINE_COUNTDOMINOES_NEUTRAL);
+        SOLVE_FOR_ROWCOLS(solve_countdominoes_nonneutral,
+                          LINE_COUNTDOMINOES_NONNEUTRAL);
 
         /* more ... */
 
@@ -1523,6 +1634,7 @@ static int lay_dominoes(game_state *state, random_state *rs, int *scratch)
         state->grid[i] = EMPTY;
         state->flags[i] = (state->common->dominoes[i] == i) ? GS_SET : 0;
     }
+    solve_alldirty(state);
     shuffle(scratch, state->wh, sizeof(int), rs);
 
     n_initial_neutral = (state->wh > 100) ? 5 : (state->wh / 10);
@@ -9,6 +9,123 @@
 #include <string.h>
 #include "puzzles.h"
 
+#ifdef MALLOC_STATS
+#undef smalloc
+#undef srealloc
+
+/*
+ * Each block is preceded by a header recording its size and which
+ * tag it's charged to, padded so the caller's pointer stays as well
+ * aligned as malloc's.
+ */
+#define MAX_MALLOC_TAGS 63
+union malloc_header {
+    struct {
+        size_t size;
+        int tag;
+    } h;
+    long double align1;
+    void *align2;
+};
+
+static struct malloc_stats malloc_tags[MAX_MALLOC_TAGS + 1];
+static int n_malloc_tags = 1;          /* [0] is the overall totals */
+
+static int malloc_tag_index(const char *tag)
+{
+    static int last = 1;
+    int i;
+
+    if (last < n_malloc_tags && malloc_tags[last].tag == tag)
+        return last;
+    for (i = 1; i < n_malloc_tags; i++)
+        if (malloc_tags[i].tag == tag || !strcmp(malloc_tags[i].tag, tag))
+            return last = i;
+    if (n_malloc_tags > MAX_MALLOC_TAGS)
+        return 0;                      /* charge the surplus to the total */
+    malloc_tags[n_malloc_tags].tag = tag;
+    return last = n_malloc_tags++;
+}
+
+static void malloc_stats_add(int tag, size_t size)
+{
+    struct malloc_stats *st[2];
+    int i;
+
+    st[0] = &malloc_tags[0];
+    st[1] = &malloc_tags[tag];
+    for (i = 0; i < (tag ? 2 : 1); i++) {
+        st[i]->total_bytes += size;
+        st[i]->live_bytes += size;
+        st[i]->count++;
+        if (st[i]->live_bytes > st[i]->peak_bytes)
+            st[i]->peak_bytes = st[i]->live_bytes;
+    }
+}
+
+static void malloc_stats_remove(int tag, size_t size)
+{
+    malloc_tags[0].live_bytes -= size;
+    if (tag)
+        malloc_tags[tag].live_bytes -= size;
+}
+
+int malloc_stats_snapshot(struct malloc_stats *out, int max)
+{
+    int i;
+
+    for (i = 0; i < n_malloc_tags && i < max; i++)
+        out[i] = malloc_tags[i];
+    return n_malloc_tags;
+}
+
+void malloc_stats_reset(void)
+{
+    int i;
+
+    for (i = 0; i < n_malloc_tags; i++) {
+        malloc_tags[i].total_bytes = 0;
+        malloc_tags[i].count = 0;
+        malloc_tags[i].peak_bytes = malloc_tags[i].live_bytes;
+    }
+}
+
+void *smalloc_tagged(size_t size, const char *tag)
+{
+    union malloc_header *hdr;
+
+    hdr = smalloc(sizeof(union malloc_header) + size);
+    hdr->h.size = size;
+    hdr->h.tag = malloc_tag_index(tag);
+    malloc_stats_add(hdr->h.tag, size);
+    return hdr + 1;
+}
+
+void *srealloc_tagged(void *p, size_t size, const char *tag)
+{
+    union malloc_header *hdr;
+
+    if (!p)
+        return smalloc_tagged(size, tag);
+    hdr = (union malloc_header *)p - 1;
+    malloc_stats_remove(hdr->h.tag, hdr->h.size);
+    hdr = srealloc(hdr, sizeof(union malloc_header) + size);
+    hdr->h.size = size;
+    malloc_stats_add(hdr->h.tag, size);
+    return hdr + 1;
+}
+
+/* Within this file, smalloc and srealloc are the untagged versions
+ * and sfree has to find the header smalloc_tagged added. */
+#define sfree_header(p) do { \
+    union malloc_header *hdr = (union malloc_header *)(p) - 1; \
+    malloc_stats_remove(hdr->h.tag, hdr->h.size); \
+    (p) = hdr; \
+} while (0)
+#else
+#define sfree_header(p) ((void)0)
+#endif
+
 /*
  * smalloc should guarantee to return a useful pointer - we
  * can do nothing except die when it's out of memory anyway.
@@ -30,6 +147,7 @@ void *smalloc(size_t size) {
  */
 void sfree(void *p) {
     if (p) {
+	sfree_header(p);
 	free(p);
     }
 }
@@ -58,7 +176,11 @@ void *srealloc(void *p, size_t size) {
  * of smalloc (and also reliably defined in all environments :-)
  */
 char *dupstr(const char *s) {
+#ifdef MALLOC_STATS
+    char *r = smalloc_tagged(1+strlen(s), "dupstr");
+#else
     char *r = smalloc(1+strlen(s));
+#endif
     strcpy(r,s);
     return r;
 }
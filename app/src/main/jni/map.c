@@ -659,21 +659,20 @@ static int graph_edge_index(int *graph, int n, int ngraph, int i, int j)
 #define graph_adjacent(graph, n, ngraph, i, j) \
     (graph_edge_index((graph), (n), (ngraph), (i), (j)) >= 0)
 
-static int graph_vertex_start(int *graph, int n, int ngraph, int i)
+/*
+ * Fill in starts[0..n] so that the edges out of vertex i are
+ * graph[starts[i]] up to graph[starts[i+1]-1], saving the solvers a
+ * binary search every time they want a vertex's neighbours.
+ */
+static void graph_vertex_starts(int *graph, int n, int ngraph, int *starts)
 {
-    int v = i*n;
-    int top, bot, mid;
+    int i, j;
 
-    bot = -1;
-    top = ngraph;
-    while (top - bot > 1) {
-	mid = (top + bot) / 2;
-	if (graph[mid] < v)
-	    bot = mid;
-	else
-	    top = mid;
+    for (i = j = 0; i <= n; i++) {
+        while (j < ngraph && graph[j] < i*n)
+            j++;
+        starts[i] = j;
     }
-    return top;
 }
 
 /* ----------------------------------------------------------------------
@@ -684,10 +683,10 @@ static int graph_vertex_start(int *graph, int n, int ngraph, int i)
  * the sake of the Palm port and its limited stack.
  */
 
-static bool fourcolour_recurse(int *graph, int n, int ngraph,
+static bool fourcolour_recurse(int *graph, int n, const int *starts,
                                int *colouring, int *scratch, random_state *rs)
 {
-    int nfree, nvert, start, i, j, k, c, ci;
+    int nfree, nvert, start, end, i, j, k, c, ci;
     int cs[FOUR];
 
     /*
@@ -721,7 +720,8 @@ static bool fourcolour_recurse(int *graph, int n, int ngraph,
 	    if (j-- == 0)
 		break;
     assert(i < n);
-    start = graph_vertex_start(graph, n, ngraph, i);
+    start = starts[i];
+    end = starts[i+1];
 
     /*
      * Loop over the possible colours for i, and recurse for each
@@ -745,7 +745,7 @@ static bool fourcolour_recurse(int *graph, int n, int ngraph,
 	 * Update the scratch space to reflect a new neighbour
 	 * of this colour for each neighbour of vertex i.
 	 */
-	for (j = start; j < ngraph && graph[j] < n*(i+1); j++) {
+	for (j = start; j < end; j++) {
 	    k = graph[j] - i*n;
 	    if (scratch[k*FIVE+c] == 0)
 		scratch[k*FIVE+FOUR]--;
@@ -755,14 +755,14 @@ static bool fourcolour_recurse(int *graph, int n, int ngraph,
 	/*
 	 * Recurse.
 	 */
-	if (fourcolour_recurse(graph, n, ngraph, colouring, scratch, rs))
+	if (fourcolour_recurse(graph, n, starts, colouring, scratch, rs))
 	    return true;	       /* got one! */
 
 	/*
 	 * If that didn't work, clean up and try again with a
 	 * different colour.
 	 */
-	for (j = start; j < ngraph && graph[j] < n*(i+1); j++) {
+	for (j = start; j < end; j++) {
 	    k = graph[j] - i*n;
 	    scratch[k*FIVE+c]--;
 	    if (scratch[k*FIVE+c] == 0)
@@ -785,7 +785,7 @@ static bool fourcolour_recurse(int *graph, int n, int ngraph,
 static void fourcolour(int *graph, int n, int ngraph, int *colouring,
 		       random_state *rs)
 {
-    int *scratch;
+    int *scratch, *starts;
     int i;
     bool retd;
 
@@ -804,9 +804,13 @@ static void fourcolour(int *graph, int n, int ngraph, int *colouring,
     for (i = 0; i < n; i++)
 	colouring[i] = -1;
 
-    retd = fourcolour_recurse(graph, n, ngraph, colouring, scratch, rs);
+    starts = snewn(n + 1, int);
+    graph_vertex_starts(graph, n, ngraph, starts);
+
+    retd = fourcolour_recurse(graph, n, starts, colouring, scratch, rs);
     assert(retd);                 /* by the Four Colour Theorem :-) */
 
+    sfree(starts);
     sfree(scratch);
 }
 
@@ -821,6 +825,17 @@ struct solver_scratch {
     int n;
     int ngraph;
 
+    /*
+     * Derived from the graph, and shared with the scratch spaces of
+     * recursive calls, which don't free them: starts is as filled in
+     * by graph_vertex_starts, and neighbour is all false between
+     * uses, which mark a vertex's neighbours in it to make adjacency
+     * tests against that vertex constant-time.
+     */
+    int *starts;
+    bool *neighbour;
+    bool shared;
+
     int *bfsqueue;
     int *bfscolour;
 #ifdef SOLVER_DIAGNOSTICS
@@ -838,6 +853,11 @@ static struct solver_scratch *new_scratch(int *graph, int n, int ngraph)
     sc->graph = graph;
     sc->n = n;
     sc->ngraph = ngraph;
+    sc->starts = snewn(n + 1, int);
+    graph_vertex_starts(graph, n, ngraph, sc->starts);
+    sc->neighbour = snewn(n, bool);
+    memset(sc->neighbour, 0, n * sizeof(bool));
+    sc->shared = false;
     sc->possible = snewn(n, unsigned char);
     sc->depth = 0;
     sc->bfsqueue = snewn(n, int);
@@ -849,8 +869,48 @@ static struct solver_scratch *new_scratch(int *graph, int n, int ngraph)
     return sc;
 }
 
+/*
+ * Scratch space for a recursive call, sharing the parts that only
+ * depend on the graph.
+ */
+static struct solver_scratch *new_sub_scratch(struct solver_scratch *parent)
+{
+    struct solver_scratch *sc;
+    int n = parent->n;
+
+    sc = snew(struct solver_scratch);
+    sc->graph = parent->graph;
+    sc->n = n;
+    sc->ngraph = parent->ngraph;
+    sc->starts = parent->starts;
+    sc->neighbour = parent->neighbour;
+    sc->shared = true;
+    sc->possible = snewn(n, unsigned char);
+    sc->depth = parent->depth + 1;
+    sc->bfsqueue = snewn(n, int);
+    sc->bfscolour = snewn(n, int);
+#ifdef SOLVER_DIAGNOSTICS
+    sc->bfsprev = snewn(n, int);
+#endif
+
+    return sc;
+}
+
+/* Mark or unmark the neighbours of vertex v in sc->neighbour. */
+static void mark_neighbours(struct solver_scratch *sc, int v, bool mark)
+{
+    int j;
+
+    for (j = sc->starts[v]; j < sc->starts[v+1]; j++)
+        sc->neighbour[sc->graph[j] - v*sc->n] = mark;
+}
+
 static void free_scratch(struct solver_scratch *sc)
 {
+    if (!sc->shared) {
+        sfree(sc->starts);
+        sfree(sc->neighbour);
+    }
     sfree(sc->possible);
     sfree(sc->bfsqueue);
     sfree(sc->bfscolour);
@@ -882,7 +942,7 @@ static bool place_colour(struct solver_scratch *sc,
 #endif
                          )
 {
-    int *graph = sc->graph, n = sc->n, ngraph = sc->ngraph;
+    int *graph = sc->graph, n = sc->n;
     int j, k;
 
     if (!(sc->possible[index] & (1 << colour))) {
@@ -906,8 +966,7 @@ static bool place_colour(struct solver_scratch *sc,
     /*
      * Rule out this colour from all the region's neighbours.
      */
-    for (j = graph_vertex_start(graph, n, ngraph, index);
-	 j < ngraph && graph[j] < n*(index+1); j++) {
+    for (j = sc->starts[index]; j < sc->starts[index+1]; j++) {
 	k = graph[j] - index*n;
 #ifdef SOLVER_DIAGNOSTICS
         if (verbose && (sc->possible[k] & (1 << colour)))
@@ -1078,11 +1137,10 @@ static int map_solver(struct solver_scratch *sc,
              * Go through the neighbours of j1 and see if any are
              * shared with j2.
              */
-            for (j = graph_vertex_start(graph, n, ngraph, j1);
-                 j < ngraph && graph[j] < n*(j1+1); j++) {
+            mark_neighbours(sc, j2, true);
+            for (j = sc->starts[j1]; j < sc->starts[j1+1]; j++) {
                 k = graph[j] - j1*n;
-                if (graph_adjacent(graph, n, ngraph, k, j2) &&
-                    (sc->possible[k] & v)) {
+                if (sc->neighbour[k] && (sc->possible[k] & v)) {
 #ifdef SOLVER_DIAGNOSTICS
                     if (verbose) {
                         char buf[80];
@@ -1099,6 +1157,7 @@ static int map_solver(struct solver_scratch *sc,
                     done_something = true;
                 }
             }
+            mark_neighbours(sc, j2, false);
         }
 
         if (done_something)
@@ -1151,6 +1210,7 @@ static int map_solver(struct solver_scratch *sc,
             if (colouring[i] >= 0 || bitcount(sc->possible[i]) != 2)
                 continue;
 
+            mark_neighbours(sc, i, true);
             for (c = 0; c < FOUR; c++)
                 if (sc->possible[i] & (1 << c)) {
                     int j, k, gi, origc, currc, head, tail;
@@ -1183,8 +1243,7 @@ static int map_solver(struct solver_scratch *sc,
                         /*
                          * Try neighbours of j.
                          */
-                        for (gi = graph_vertex_start(graph, n, ngraph, j);
-                             gi < ngraph && graph[gi] < n*(j+1); gi++) {
+                        for (gi = sc->starts[j]; gi < sc->starts[j+1]; gi++) {
                             k = graph[gi] - j*n;
 
                             /*
@@ -1215,8 +1274,7 @@ static int map_solver(struct solver_scratch *sc,
                              * possibility, and currc is equal to
                              * the original colour we ruled out.
                              */
-                            if (currc == origc &&
-                                graph_adjacent(graph, n, ngraph, k, i) &&
+                            if (currc == origc && sc->neighbour[k] &&
                                 (sc->possible[k] & currc)) {
 #ifdef SOLVER_DIAGNOSTICS
                                 if (verbose) {
@@ -1244,6 +1302,7 @@ static int map_solver(struct solver_scratch *sc,
 
                     assert(tail <= n);
                 }
+            mark_neighbours(sc, i, false);
         }
 
 	if (!done_something)
@@ -1316,8 +1375,7 @@ static int map_solver(struct solver_scratch *sc,
         /*
          * Now iterate over the possible colours for this region.
          */
-        rsc = new_scratch(graph, n, ngraph);
-        rsc->depth = sc->depth + 1;
+        rsc = new_sub_scratch(sc);
         origcolouring = snewn(n, int);
         memcpy(origcolouring, colouring, n * sizeof(int));
         subcolouring = snewn(n, int);
@@ -1435,6 +1493,10 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     tries = 50;
 
     while (1) {
+        if (random_cancelled(rs)) {
+            ret = NULL;
+            goto cleanup;
+        }
 
         /*
          * Create the map.
@@ -1702,7 +1764,9 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	assert(retlen < retsize);
     }
 
-    free_scratch(sc);
+  cleanup:
+    if (sc)
+        free_scratch(sc);
     sfree(regions);
     sfree(colouring2);
     sfree(colouring);
@@ -3370,7 +3434,7 @@ const struct game thegame = {
 #endif
     false,			       /* wants_statusbar */
     false, game_timing_state,
-    0,				       /* flags */
+    PARALLEL_NEW_DESC,		       /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -74,39 +74,38 @@ size_t matching_scratch_size(int nl, int nr)
     return n * sizeof(int);
 }
 
-int matching_with_scratch(void *scratchv,
-                          int nl, int nr, int **adjlists, int *adjsizes,
-                          random_state *rs, int *outl, int *outr)
+/*
+ * Set up the various array pointers in the scratch space.
+ */
+static struct scratch *setup_scratch(void *scratchv, int nl, int nr)
 {
     struct scratch *s = (struct scratch *)scratchv;
-    int L, R, i, j;
+    int *p = scratchv;
+    int nmin = (nl < nr ? nl : nr);
 
-    /*
-     * Set up the various array pointers in the scratch space.
-     */
-    {
-        int *p = scratchv;
-        int nmin = (nl < nr ? nl : nr);
-
-        p += (sizeof(struct scratch) + sizeof(int)-1)/sizeof(int);
-        s->LtoR = p; p += nl;
-        s->RtoL = p; p += nr;
-        s->Llayer = p; p += nl;
-        s->Rlayer = p; p += nr;
-        s->Lqueue = p; p += nl;
-        s->Rqueue = p; p += nr;
-        s->augpath = p; p += 2*nmin;
-        s->dfsstate = p; p += nmin;
-        s->Lorder = p; p += nl;
-    }
+    p += (sizeof(struct scratch) + sizeof(int)-1)/sizeof(int);
+    s->LtoR = p; p += nl;
+    s->RtoL = p; p += nr;
+    s->Llayer = p; p += nl;
+    s->Rlayer = p; p += nr;
+    s->Lqueue = p; p += nl;
+    s->Rqueue = p; p += nr;
+    s->augpath = p; p += 2*nmin;
+    s->dfsstate = p; p += nmin;
+    s->Lorder = p; p += nl;
+
+    return s;
+}
 
-    /*
-     * Set up the initial matching, which is empty.
-     */
-    for (L = 0; L < nl; L++)
-        s->LtoR[L] = -1;
-    for (R = 0; R < nr; R++)
-        s->RtoL[R] = -1;
+/*
+ * The main loop of the algorithm: augment whatever matching is in
+ * s->LtoR and s->RtoL until it's maximal.
+ */
+static int augment_matching(struct scratch *s,
+                            int nl, int nr, int **adjlists, int *adjsizes,
+                            random_state *rs, int *outl, int *outr)
+{
+    int L, R, i, j;
 
     while (1) {
         /*
@@ -299,6 +298,55 @@ int matching_with_scratch(void *scratchv,
     return j;
 }
 
+int matching_with_scratch(void *scratchv,
+                          int nl, int nr, int **adjlists, int *adjsizes,
+                          random_state *rs, int *outl, int *outr)
+{
+    struct scratch *s = setup_scratch(scratchv, nl, nr);
+    int L, R;
+
+    /*
+     * Set up the initial matching, which is empty.
+     */
+    for (L = 0; L < nl; L++)
+        s->LtoR[L] = -1;
+    for (R = 0; R < nr; R++)
+        s->RtoL[R] = -1;
+
+    return augment_matching(s, nl, nr, adjlists, adjsizes, rs, outl, outr);
+}
+
+int matching_update_with_scratch(void *scratchv, int nl, int nr,
+                                 int **adjlists, int *adjsizes,
+                                 random_state *rs, int *inoutl, int *outr)
+{
+    struct scratch *s = setup_scratch(scratchv, nl, nr);
+    int L, R, j;
+
+    for (R = 0; R < nr; R++)
+        s->RtoL[R] = -1;
+
+    /*
+     * Start from as much of the previous matching as is still made
+     * of edges of the graph.
+     */
+    for (L = 0; L < nl; L++) {
+        s->LtoR[L] = -1;
+        R = inoutl[L];
+        if (R < 0 || R >= nr || s->RtoL[R] != -1)
+            continue;
+        for (j = 0; j < adjsizes[L]; j++)
+            if (adjlists[L][j] == R)
+                break;
+        if (j < adjsizes[L]) {
+            s->LtoR[L] = R;
+            s->RtoL[R] = L;
+        }
+    }
+
+    return augment_matching(s, nl, nr, adjlists, adjsizes, rs, inoutl, outr);
+}
+
 int matching(int nl, int nr, int **adjlists, int *adjsizes,
              random_state *rs, int *outl, int *outr)
 {
@@ -398,12 +446,10 @@ void deallocate(void)
     sfree(scratch);
 }
 
-void find_and_check_matching(void)
+void check_matching(void)
 {
     int i, j, k;
 
-    count = matching_with_scratch(scratch, nl, nr, adjlists, adjsizes,
-                                  rs, outl, outr);
     matching_witness(scratch, nl, nr, witness);
 
     for (i = j = 0; i < nl; i++) {
@@ -449,6 +495,13 @@ void find_and_check_matching(void)
     }
 }
 
+void find_and_check_matching(void)
+{
+    count = matching_with_scratch(scratch, nl, nr, adjlists, adjsizes,
+                                  rs, outl, outr);
+    check_matching();
+}
+
 struct nodename {
     const char *name;
     int index;
@@ -681,6 +734,71 @@ void test_subsets(void)
     }
 }
 
+void test_updates(void)
+{
+    int n = 40, maxdeg = 6;
+    int i, j, k, L, R, nruns, full;
+    int *fullout;
+    static const char seed[] = "fixed random seed for repeatability";
+
+    /*
+     * Start from a random sparse graph, then repeatedly add or remove
+     * a random edge and update the previous matching to fit. Each
+     * result must be a valid maximum matching (checked by the
+     * witness) of the same size as one found from scratch.
+     */
+
+    if (!rs)
+        rs = random_new(seed, strlen(seed));
+
+    allocate(n, n, n*n);
+    fullout = snewn(n, int);
+    for (i = 0; i < n; i++) {
+        adjlists[i] = adjdata + i*n;
+        adjsizes[i] = 0;
+        for (j = random_upto(rs, maxdeg); j > 0; j--) {
+            R = random_upto(rs, n);
+            for (k = 0; k < adjsizes[i]; k++)
+                if (adjlists[i][k] == R)
+                    break;
+            if (k == adjsizes[i])
+                adjlists[i][adjsizes[i]++] = R;
+        }
+    }
+    find_and_check_matching();
+
+    for (nruns = 0; nruns < 100000; nruns++) {
+        L = random_upto(rs, n);
+        if (adjsizes[L] > 0 && random_upto(rs, 2)) {
+            /* Remove an edge, preferring one in the matching. */
+            for (k = 0; k < adjsizes[L]; k++)
+                if (adjlists[L][k] == outl[L])
+                    break;
+            if (k == adjsizes[L] || random_upto(rs, 4) == 0)
+                k = random_upto(rs, adjsizes[L]);
+            adjlists[L][k] = adjlists[L][--adjsizes[L]];
+        } else {
+            R = random_upto(rs, n);
+            for (k = 0; k < adjsizes[L]; k++)
+                if (adjlists[L][k] == R)
+                    break;
+            if (k == adjsizes[L])
+                adjlists[L][adjsizes[L]++] = R;
+        }
+
+        count = matching_update_with_scratch(scratch, nl, nr, adjlists,
+                                             adjsizes, rs, outl, outr);
+        check_matching();
+
+        full = matching(nl, nr, adjlists, adjsizes, NULL, fullout, NULL);
+        assert(count == full);
+    }
+
+    printf("%d updates checked\n", nruns);
+    sfree(fullout);
+    deallocate();
+}
+
 int main(int argc, char **argv)
 {
     static const char stdin_identifier[] = "<standard input>";
@@ -745,6 +863,7 @@ int main(int argc, char **argv)
         }
 
         test_subsets();
+        test_updates();
     }
 
     return 0;
@@ -55,7 +55,26 @@ int matching_with_scratch(void *scratch,
                           random_state *rs, int *outl, int *outr);
 
 /*
- * The above function expects its 'scratch' parameter to have already
+ * Incremental version of the above, for callers that find matchings
+ * of a series of graphs each differing from the last by a few edges.
+ *
+ * On entry, 'inoutl' must hold a matching from a previous call, in
+ * the same form as 'outl' above (so it may not be NULL). Pairs in it
+ * that are no longer edges of the graph are dropped, and the rest is
+ * used as the starting point instead of the empty matching, so the
+ * algorithm only has to find the augmenting paths the change has
+ * made available. After adding or removing a single edge that takes
+ * at most two passes over the graph, rather than O(sqrt(V)) of them.
+ *
+ * On exit 'inoutl' and 'outr' are as 'outl' and 'outr' above, and the
+ * return value is again the size of the (maximum) matching.
+ */
+int matching_update_with_scratch(void *scratch, int nl, int nr,
+                                 int **adjlists, int *adjsizes,
+                                 random_state *rs, int *inoutl, int *outr);
+
+/*
+ * The above functions expect their 'scratch' parameter to have already
  * been set up. This function tells you how much space is needed for a
  * given size of graph, so that you can allocate a single instance of
  * scratch space and run the algorithm multiple times without the
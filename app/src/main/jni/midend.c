@@ -13,6 +13,13 @@
 
 #include "puzzles.h"
 
+#ifdef PARALLEL_GENERATION
+#include <pthread.h>
+#endif
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
 enum { NEWGAME, MOVE, SOLVE, RESTART };/* for midend_state_entry.movetype */
 
 #define special(type) ( (type) != MOVE )
@@ -65,10 +72,36 @@ struct midend {
 
     int nstates, statesize, statepos;
     struct midend_state_entry *states;
+    /*
+     * If undo_stride > 1, only every undo_stride'th entry of states[]
+     * (plus the few around statepos that the midend looks at
+     * directly) keeps its game_state; the rest have state == NULL
+     * and are rebuilt on demand by replaying movestrs from the
+     * nearest earlier snapshot. See midend_thin_states().
+     */
+    int undo_stride;
+    bool states_thinned;
+
+    /*
+     * Optional append-only journal (see midend_set_journal()).
+     * journal_len counts bytes written since the last base record,
+     * of which the base record itself was journal_base_len, and
+     * journal_ui is the game_ui encoding the journal last recorded.
+     */
+    void (*journal_write)(void *ctx, const void *buf, int len,
+                          bool rewrite);
+    void *journal_ctx;
+    int journal_len, journal_base_len;
+    char *journal_ui;
 
     struct midend_serialise_buf newgame_undo, newgame_redo;
     bool newgame_can_store_undo;
 
+    int gen_threads;            /* see midend_set_generation_threads() */
+    midend_solve_job *solve_job;    /* latest midend_solve_start() job */
+    random_poll_fn gen_progress;
+    void *gen_progress_ctx;
+
     game_params *params, *curparams;
     game_drawstate *drawstate;
     bool first_draw;
@@ -118,12 +151,33 @@ struct deserialise_data {
 };
 
 /*
- * Forward reference.
+ * State for reading key/value pairs from a save file in either of its
+ * forms (see midend_read_pair()).
+ */
+struct pair_reader {
+    bool (*read)(void *ctx, void *buf, int len);
+    void *rctx;
+    int binary;                 /* -1 until the first pair shows which */
+    char *moves;                /* inflated MOVES pairs, read first */
+    int moves_len, moves_pos;
+};
+
+/*
+ * Forward references.
  */
 static const char *midend_deserialise_internal(
-    midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx,
+    midend *me, struct pair_reader *pr,
     const char *(*check)(void *ctx, midend *, const struct deserialise_data *),
     void *cctx);
+static void pair_reader_init(struct pair_reader *pr,
+                             bool (*read)(void *ctx, void *buf, int len),
+                             void *rctx);
+static void pair_reader_free(struct pair_reader *pr);
+static void serialise_binary_pair(struct midend_serialise_buf *ser,
+                                  const char *key, const char *val,
+                                  int len);
+static void midend_serialise_compact_buf(midend *me,
+                                         struct midend_serialise_buf *ser);
 
 void midend_reset_tilesize(midend *me)
 {
@@ -162,11 +216,21 @@ midend *midend_new(frontend *fe, const game *ourgame,
     me->random = random_new(randseed, randseedsize);
     me->nstates = me->statesize = me->statepos = 0;
     me->states = NULL;
+    me->undo_stride = ourgame->undo_snapshot_stride;
+    me->states_thinned = false;
+    me->journal_write = NULL;
+    me->journal_ctx = NULL;
+    me->journal_len = me->journal_base_len = 0;
+    me->journal_ui = NULL;
     me->newgame_undo.buf = NULL;
     me->newgame_undo.size = me->newgame_undo.len = 0;
     me->newgame_redo.buf = NULL;
     me->newgame_redo.size = me->newgame_redo.len = 0;
     me->newgame_can_store_undo = false;
+    me->gen_threads = 1;
+    me->solve_job = NULL;
+    me->gen_progress = NULL;
+    me->gen_progress_ctx = NULL;
     me->params = ourgame->default_params();
     me->game_id_change_notify_function = NULL;
     me->game_id_change_notify_ctx = NULL;
@@ -224,22 +288,46 @@ const game *midend_which_game(midend *me)
     return me->ourgame;
 }
 
-void midend_purge_states(midend *me)
+static void midend_journal_record(midend *me, const char *key,
+                                  const char *value);
+static void midend_journal_ui(midend *me);
+
+static void midend_discard_redo(midend *me)
 {
     while (me->nstates > me->statepos) {
-        me->ourgame->free_game(me->states[--me->nstates].state);
+        if (me->states[--me->nstates].state)
+            me->ourgame->free_game(me->states[me->nstates].state);
         if (me->states[me->nstates].movestr)
             sfree(me->states[me->nstates].movestr);
     }
+}
+
+void midend_purge_states(midend *me)
+{
+    if (me->nstates > me->statepos)
+        midend_journal_record(me, "PURGE", "");
+    midend_discard_redo(me);
     me->newgame_redo.len = 0;
     purging_states(me->drawing);
 }
 
+/*
+ * Called whenever the current position moves. An asynchronous solve
+ * started from the old position no longer applies, so forget it.
+ */
+static void midend_changed_state(midend *me)
+{
+    me->solve_job = NULL;
+    midend_journal_ui(me);
+    changed_state(me->drawing, me->statepos > 1, me->statepos < me->nstates);
+}
+
 static void midend_free_game(midend *me)
 {
     while (me->nstates > 0) {
         me->nstates--;
-	me->ourgame->free_game(me->states[me->nstates].state);
+        if (me->states[me->nstates].state)
+            me->ourgame->free_game(me->states[me->nstates].state);
 	sfree(me->states[me->nstates].movestr);
     }
 
@@ -249,6 +337,268 @@ static void midend_free_game(midend *me)
     }
 }
 
+/*
+ * Reconstruct states[i].state by replaying moves forward from the
+ * nearest earlier entry that still has its state. states[0] always
+ * does, so this can't fail for a move that succeeded the first time.
+ */
+static game_state *midend_rebuild_state(midend *me, int i)
+{
+    game_state *s = NULL;
+    int j, k;
+
+    for (j = i - 1; !me->states[j].state; j--)
+        assert(j > 0);
+    for (k = j + 1; k <= i; k++) {
+        const game_state *prev = s ? s : me->states[j].state;
+        game_state *next;
+
+        assert(me->states[k].movetype != NEWGAME);
+        if (me->states[k].movetype == RESTART)
+            next = me->ourgame->new_game(me, me->params,
+                                         me->states[k].movestr);
+        else
+            next = me->ourgame->execute_move(prev, me->states[k].movestr);
+        assert(next);
+        if (s)
+            me->ourgame->free_game(s);
+        s = next;
+    }
+    return s;
+}
+
+/*
+ * Maintain the invariant that states[0], every undo_stride'th entry,
+ * and states[statepos-2 .. statepos] (all the midend ever reads
+ * without going through here) have their game_state, and that no
+ * other entry does. Call after every change to statepos.
+ */
+static void midend_thin_states(midend *me)
+{
+    int i;
+    bool thinned = me->undo_stride > 1;
+
+    if (!thinned && !me->states_thinned)
+        return;
+
+    for (i = 1; i < me->nstates; i++) {
+        bool keep = !thinned || i % me->undo_stride == 0 ||
+            (i >= me->statepos - 2 && i <= me->statepos);
+        if (keep && !me->states[i].state) {
+            me->states[i].state = midend_rebuild_state(me, i);
+        } else if (!keep && me->states[i].state) {
+            me->ourgame->free_game(me->states[i].state);
+            me->states[i].state = NULL;
+        }
+    }
+    me->states_thinned = thinned;
+}
+
+void midend_set_undo_snapshot_stride(midend *me, int stride)
+{
+    me->undo_stride = stride;
+    midend_thin_states(me);
+}
+
+void midend_set_generation_threads(midend *me, int nthreads)
+{
+    me->gen_threads = nthreads < 1 ? 1 : nthreads;
+}
+
+void midend_set_generation_progress(midend *me, random_poll_fn progress,
+                                    void *ctx)
+{
+    me->gen_progress = progress;
+    me->gen_progress_ctx = ctx;
+}
+
+#ifdef PARALLEL_GENERATION
+/*
+ * Parallel generation. Each of several threads runs new_desc on its
+ * own random stream, and the first to come back with a game wins.
+ * Stream 0 is seeded with the midend's new seed string itself, and
+ * stream i > 0 with that string followed by "/i"; the winning
+ * stream's seed string becomes the game's seed, so that it
+ * regenerates the same game on its own. The losers are told to stop
+ * through random_cancelled(), and are left to finish in the
+ * background: each owns copies of everything it uses, and the last
+ * one out frees the shared structure.
+ */
+struct gen_race {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int cancel;                 /* accessed atomically */
+    int refs;                   /* the caller plus each live stream */
+    int winner;                 /* index of the first stream done, or -1 */
+    char *desc, *aux;
+    random_poll_fn progress;    /* the midend's, called with lock held */
+    void *progress_ctx;
+    unsigned long attempts;     /* over all streams */
+};
+
+struct gen_stream {
+    struct gen_race *race;
+    const game *ourgame;
+    game_params *params;
+    random_state *rs;
+    bool interactive;
+    int index;
+};
+
+/* Drop a reference to the race, with its lock held; unlocks it. */
+static void gen_race_unref(struct gen_race *race)
+{
+    bool last = (--race->refs == 0);
+
+    pthread_cond_signal(&race->done);
+    pthread_mutex_unlock(&race->lock);
+    if (last) {
+        pthread_cond_destroy(&race->done);
+        pthread_mutex_destroy(&race->lock);
+        sfree(race->desc);
+        sfree(race->aux);
+        sfree(race);
+    }
+}
+
+/*
+ * Each stream's poll function. The cancel flag is checked again
+ * under the lock, since the caller sets it (holding the lock) before
+ * returning, after which its progress function must not be called.
+ */
+static bool gen_stream_poll(void *vstream, unsigned long attempts)
+{
+    struct gen_stream *st = (struct gen_stream *)vstream;
+    struct gen_race *race = st->race;
+    bool stop;
+
+    if (__atomic_load_n(&race->cancel, __ATOMIC_RELAXED))
+        return true;
+    if (!race->progress)
+        return false;
+
+    pthread_mutex_lock(&race->lock);
+    stop = __atomic_load_n(&race->cancel, __ATOMIC_RELAXED) != 0;
+    if (!stop && race->progress(race->progress_ctx, ++race->attempts)) {
+        __atomic_store_n(&race->cancel, 1, __ATOMIC_RELAXED);
+        stop = true;
+    }
+    pthread_mutex_unlock(&race->lock);
+    return stop;
+}
+
+static void *gen_stream_run(void *vstream)
+{
+    struct gen_stream *st = (struct gen_stream *)vstream;
+    struct gen_race *race = st->race;
+    char *aux = NULL, *desc;
+
+    desc = st->ourgame->new_desc(st->params, st->rs, &aux, st->interactive);
+    st->ourgame->free_params(st->params);
+    random_free(st->rs);
+
+    pthread_mutex_lock(&race->lock);
+    if (desc && race->winner < 0) {
+        race->winner = st->index;
+        race->desc = desc;
+        race->aux = aux;
+        desc = aux = NULL;
+        __atomic_store_n(&race->cancel, 1, __ATOMIC_RELAXED);
+    }
+    gen_race_unref(race);
+
+    sfree(desc);
+    sfree(aux);
+    sfree(st);
+    return NULL;
+}
+
+/*
+ * Returns the new game description, having replaced me->aux_info and
+ * (if a stream other than 0 won) me->seedstr, or NULL if the progress
+ * function stopped generation. Sets *started_r to false if no thread
+ * could be started, leaving the caller to generate serially.
+ */
+static char *midend_new_desc_parallel(midend *me, bool *started_r)
+{
+    struct gen_race *race = snew(struct gen_race);
+    char *seed = snewn(strlen(me->seedstr) + 20, char);
+    char *desc = NULL;
+    int i, started = 0;
+
+    pthread_mutex_init(&race->lock, NULL);
+    pthread_cond_init(&race->done, NULL);
+    race->cancel = 0;
+    race->refs = 1;
+    race->winner = -1;
+    race->desc = race->aux = NULL;
+    race->progress = me->gen_progress;
+    race->progress_ctx = me->gen_progress_ctx;
+    race->attempts = 0;
+
+    for (i = 0; i < me->gen_threads; i++) {
+        struct gen_stream *st = snew(struct gen_stream);
+        pthread_attr_t attr;
+        pthread_t thread;
+        int err;
+
+        if (i == 0)
+            strcpy(seed, me->seedstr);
+        else
+            sprintf(seed, "%s/%d", me->seedstr, i);
+        st->race = race;
+        st->ourgame = me->ourgame;
+        st->params = me->ourgame->dup_params(me->curparams);
+        st->rs = random_new_seed_string(seed);
+        random_set_poll(st->rs, gen_stream_poll, st);
+        st->interactive = (me->drawing != NULL);
+        st->index = i;
+
+        pthread_mutex_lock(&race->lock);
+        race->refs++;
+        pthread_mutex_unlock(&race->lock);
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        err = pthread_create(&thread, &attr, gen_stream_run, st);
+        pthread_attr_destroy(&attr);
+        if (err) {
+            pthread_mutex_lock(&race->lock);
+            race->refs--;
+            pthread_mutex_unlock(&race->lock);
+            me->ourgame->free_params(st->params);
+            random_free(st->rs);
+            sfree(st);
+            break;
+        }
+        started++;
+    }
+
+    pthread_mutex_lock(&race->lock);
+    if (started > 0) {
+        while (race->winner < 0 && race->refs > 1)
+            pthread_cond_wait(&race->done, &race->lock);
+        __atomic_store_n(&race->cancel, 1, __ATOMIC_RELAXED);
+        if (race->winner >= 0) {
+            desc = race->desc;
+            sfree(me->aux_info);
+            me->aux_info = race->aux;
+            race->desc = race->aux = NULL;
+            if (race->winner > 0) {
+                sprintf(seed, "%s/%d", me->seedstr, race->winner);
+                sfree(me->seedstr);
+                me->seedstr = dupstr(seed);
+            }
+        }
+    }
+
+    gen_race_unref(race);
+    sfree(seed);
+    *started_r = (started > 0);
+    return desc;
+}
+#endif
+
 static void midend_free_preset_menu(midend *me, struct preset_menu *menu)
 {
     if (menu) {
@@ -278,6 +628,7 @@ void midend_free(midend *me)
     random_free(me->random);
     sfree(me->newgame_undo.buf);
     sfree(me->newgame_redo.buf);
+    sfree(me->journal_ui);
     sfree(me->states);
     sfree(me->desc);
     sfree(me->privdesc);
@@ -421,7 +772,141 @@ static void newgame_serialise_write(void *ctx, const void *buf, int len)
     ser->len = new_len;
 }
 
-void midend_new_game(midend *me)
+/*
+ * The journal starts with a base record, which is a save file in the
+ * compact binary form (see midend_serialise_compact()), and then has
+ * one key/value pair, in the same form, appended per change to the
+ * undo chain: MOVE, SOLVE and RESTART add a state exactly as in
+ * a save file, UNDO and REDO move statepos, PURGE discards the redo
+ * chain, TIME (for timed games) updates the elapsed time, and UI
+ * follows any of those after which the game_ui's encoding changed
+ * (e.g. Mines counting a death). The UI record is taken once the
+ * back end's changed_state has seen the move, since replaying the
+ * move calls that again before applying the record. Once
+ * the appended records outgrow both this threshold and the base
+ * record, the journal is compacted by writing a new base record.
+ */
+#define JOURNAL_COMPACT_MIN 16384
+
+static void midend_journal_base(midend *me)
+{
+    struct midend_serialise_buf ser;
+
+    if (!me->journal_write || me->statepos < 1)
+        return;
+    midend_serialise_compact_buf(me, &ser);
+    me->journal_write(me->journal_ctx, ser.buf, ser.len, true);
+    me->journal_len = me->journal_base_len = ser.len;
+    sfree(ser.buf);
+    sfree(me->journal_ui);
+    me->journal_ui = me->ui ? me->ourgame->encode_ui(me->ui) : NULL;
+}
+
+static void midend_journal_pair(midend *me, const char *key,
+                                const char *value)
+{
+    struct midend_serialise_buf ser;
+
+    ser.buf = NULL;
+    ser.len = ser.size = 0;
+    serialise_binary_pair(&ser, key, value, strlen(value));
+    me->journal_write(me->journal_ctx, ser.buf, ser.len, false);
+    me->journal_len += ser.len;
+    sfree(ser.buf);
+}
+
+static void midend_journal_time(midend *me)
+{
+    if (me->timing) {
+        char buf[80];
+        sprintf(buf, "%g", me->elapsed);
+        midend_journal_pair(me, "TIME", buf);
+    }
+}
+
+static void midend_journal_record(midend *me, const char *key,
+                                  const char *value)
+{
+    if (!me->journal_write)
+        return;
+    midend_journal_time(me);
+    midend_journal_pair(me, key, value);
+}
+
+/*
+ * Record the game_ui if it has changed since the journal last did,
+ * and compact the journal if it's due.
+ */
+static void midend_journal_ui(midend *me)
+{
+    char *ui;
+
+    if (!me->journal_write)
+        return;
+    ui = me->ui ? me->ourgame->encode_ui(me->ui) : NULL;
+    if (ui && (!me->journal_ui || strcmp(ui, me->journal_ui))) {
+        midend_journal_pair(me, "UI", ui);
+        sfree(me->journal_ui);
+        me->journal_ui = ui;
+    } else {
+        sfree(ui);
+    }
+    if (me->journal_len > JOURNAL_COMPACT_MIN &&
+        me->journal_len - me->journal_base_len > me->journal_base_len)
+        midend_journal_base(me);
+}
+
+void midend_journal_flush(midend *me)
+{
+    if (!me->journal_write || me->statepos < 1)
+        return;
+    midend_journal_time(me);
+    midend_journal_ui(me);
+}
+
+void midend_set_journal(midend *me,
+                        void (*write)(void *ctx, const void *buf, int len,
+                                      bool rewrite),
+                        void *wctx)
+{
+    me->journal_write = write;
+    me->journal_ctx = wctx;
+    me->journal_len = me->journal_base_len = 0;
+    midend_journal_base(me);
+}
+
+/*
+ * Open a trace section for a profiler (see trace_enabled in
+ * puzzles.h), named after the entry point, the game and its params.
+ * Returns whether it did, to be passed to midend_trace_end.
+ */
+static bool midend_trace_begin(midend *me, const char *what)
+{
+#ifdef TRACE_SECTIONS
+    if (trace_enabled()) {
+        char *params = me->ourgame->encode_params(me->params, true);
+        char *name = snewn(strlen(what) + strlen(me->ourgame->name) +
+                           strlen(params) + 3, char);
+
+        sprintf(name, "%s %s:%s", what, me->ourgame->name, params);
+        trace_begin(name);
+        sfree(name);
+        sfree(params);
+        return true;
+    }
+#endif
+    return false;
+}
+
+static void midend_trace_end(bool traced)
+{
+#ifdef TRACE_SECTIONS
+    if (traced)
+        trace_end();
+#endif
+}
+
+static void midend_new_game_internal(midend *me)
 {
     me->newgame_undo.len = 0;
     if (me->newgame_can_store_undo) {
@@ -452,6 +937,10 @@ void midend_new_game(midend *me)
 	me->genmode = GOT_NOTHING;
     } else {
         random_state *rs;
+        bool generated = false;
+#ifdef PARALLEL_GENERATION
+        bool fresh_seed = false;
+#endif
 
         if (me->genmode == GOT_SEED) {
             me->genmode = GOT_NOTHING;
@@ -463,37 +952,73 @@ void midend_new_game(midend *me)
              * I'll avoid putting a leading zero on the number,
              * just in case it confuses anybody who thinks it's
              * processed as an integer rather than a string.
+             *
+             * New seeds carry RANDOM_FAST_SEED_TAG so that
+             * generation uses the cheaper random number generator.
              */
-            char newseed[16];
-            int i;
-            newseed[15] = '\0';
-            newseed[0] = '1' + (char)random_upto(me->random, 9);
+            char newseed[16 + sizeof(RANDOM_FAST_SEED_TAG)];
+            int i, t = strlen(RANDOM_FAST_SEED_TAG);
+            strcpy(newseed, RANDOM_FAST_SEED_TAG);
+            newseed[t+15] = '\0';
+            newseed[t] = '1' + (char)random_upto(me->random, 9);
             for (i = 1; i < 15; i++)
-                newseed[i] = '0' + (char)random_upto(me->random, 10);
+                newseed[t+i] = '0' + (char)random_upto(me->random, 10);
             sfree(me->seedstr);
             me->seedstr = dupstr(newseed);
 
 	    if (me->curparams)
 		me->ourgame->free_params(me->curparams);
 	    me->curparams = me->ourgame->dup_params(me->params);
+#ifdef PARALLEL_GENERATION
+            fresh_seed = true;
+#endif
         }
 
 	sfree(me->desc);
 	sfree(me->privdesc);
         sfree(me->aux_info);
 	me->aux_info = NULL;
+	me->desc = me->privdesc = NULL;
 
-        rs = random_new(me->seedstr, strlen(me->seedstr));
-	/*
-	 * If this midend has been instantiated without providing a
-	 * drawing API, it is non-interactive. This means that it's
-	 * being used for bulk game generation, and hence we should
-	 * pass the non-interactive flag to new_desc.
-	 */
-        me->desc = me->ourgame->new_desc(me->curparams, rs,
-					 &me->aux_info, (me->drawing != NULL));
-	me->privdesc = NULL;
-        random_free(rs);
+#ifdef PARALLEL_GENERATION
+        /*
+         * A seed we chose ourselves may be replaced by a sibling
+         * stream's, but one we were given must be generated from as
+         * it is.
+         */
+        if (fresh_seed && me->gen_threads > 1 &&
+            (me->ourgame->flags & PARALLEL_NEW_DESC))
+            me->desc = midend_new_desc_parallel(me, &generated);
+#endif
+
+        if (!generated) {
+            rs = random_new_seed_string(me->seedstr);
+            if (me->gen_progress)
+                random_set_poll(rs, me->gen_progress, me->gen_progress_ctx);
+            /*
+             * Generating on this thread alone, so let any search
+             * the generator runs use the other threads instead.
+             */
+            search_set_default_threads(me->gen_threads);
+            /*
+             * If this midend has been instantiated without providing
+             * a drawing API, it is non-interactive. This means that
+             * it's being used for bulk game generation, and hence we
+             * should pass the non-interactive flag to new_desc.
+             */
+            me->desc = me->ourgame->new_desc(me->curparams, rs,
+                                             &me->aux_info,
+                                             (me->drawing != NULL));
+            search_set_default_threads(1);
+            random_free(rs);
+        }
+
+        if (!me->desc) {
+            /* stopped by me->gen_progress: there is no game to undo
+             * back to, so don't try to serialise one next time */
+            me->newgame_can_store_undo = false;
+            return;
+        }
     }
 
     ensure(me);
@@ -556,7 +1081,15 @@ void midend_new_game(midend *me)
         me->game_id_change_notify_function(me->game_id_change_notify_ctx);
 
     me->newgame_can_store_undo = true;
-    changed_state(me->drawing, 0, 0);
+    midend_journal_base(me);
+    midend_changed_state(me);
+}
+
+void midend_new_game(midend *me)
+{
+    bool traced = midend_trace_begin(me, "new_game");
+    midend_new_game_internal(me);
+    midend_trace_end(traced);
 }
 
 bool midend_can_undo(midend *me)
@@ -653,12 +1186,15 @@ static bool midend_undo(midend *me)
                                        me->states[me->statepos-2].state);
         if (somehow_completed_by_undo) android_completed(me->frontend);  // Theoretically possible I suppose?
 	me->statepos--;
+        midend_thin_states(me);
+        midend_journal_record(me, "UNDO", "");
         me->dir = -1;
-        changed_state(me->drawing, me->statepos > 1, me->statepos < me->nstates);
+        midend_changed_state(me);
         return true;
     } else if (me->newgame_undo.len) {
 	struct newgame_undo_deserialise_read_ctx rctx;
 	struct newgame_undo_deserialise_check_ctx cctx;
+	struct pair_reader pr;
         struct midend_serialise_buf serbuf;
 
         /*
@@ -674,9 +1210,10 @@ static bool midend_undo(midend *me)
 	rctx.len = me->newgame_undo.len; /* copy for reentrancy safety */
 	rctx.pos = 0;
         cctx.refused = false;
+        pair_reader_init(&pr, newgame_undo_deserialise_read, &rctx);
         deserialise_error = midend_deserialise_internal(
-            me, newgame_undo_deserialise_read, &rctx,
-            newgame_undo_deserialise_check, &cctx);
+            me, &pr, newgame_undo_deserialise_check, &cctx);
+        pair_reader_free(&pr);
         if (cctx.refused) {
             /*
              * Our post-deserialisation check shows that we can't use
@@ -728,12 +1265,15 @@ static bool midend_redo(midend *me)
                                        me->states[me->statepos].state);
         if (just_completed) android_completed(me->frontend);
 	me->statepos++;
+        midend_thin_states(me);
+        midend_journal_record(me, "REDO", "");
         me->dir = +1;
-        changed_state(me->drawing, me->statepos > 1, me->statepos < me->nstates);
+        midend_changed_state(me);
         return true;
     } else if (me->newgame_redo.len) {
 	struct newgame_undo_deserialise_read_ctx rctx;
 	struct newgame_undo_deserialise_check_ctx cctx;
+	struct pair_reader pr;
         struct midend_serialise_buf serbuf;
 
         /*
@@ -749,9 +1289,10 @@ static bool midend_redo(midend *me)
 	rctx.len = me->newgame_redo.len; /* copy for reentrancy safety */
 	rctx.pos = 0;
         cctx.refused = false;
+        pair_reader_init(&pr, newgame_undo_deserialise_read, &rctx);
         deserialise_error = midend_deserialise_internal(
-            me, newgame_undo_deserialise_read, &rctx,
-            newgame_undo_deserialise_check, &cctx);
+            me, &pr, newgame_undo_deserialise_check, &cctx);
+        pair_reader_free(&pr);
         if (cctx.refused) {
             /*
              * Our post-deserialisation check shows that we can't use
@@ -861,22 +1402,33 @@ void midend_restart_game(midend *me)
     me->states[me->nstates].movestr = dupstr(me->desc);
     me->states[me->nstates].movetype = RESTART;
     me->statepos = ++me->nstates;
+    midend_thin_states(me);
+    midend_journal_record(me, "RESTART", me->desc);
     // me->ui is allowed to be null here! (#333)
     bool just_completed = me->ourgame->changed_state(me->ui,
                                    me->states[me->statepos-2].state,
                                    me->states[me->statepos-1].state);
     if (just_completed) android_completed(me->frontend);  // Unlikely, but maybe in a manually entered game ID?
-    changed_state(me->drawing, me->statepos > 1, me->statepos < me->nstates);
+    midend_changed_state(me);
     me->flash_pos = me->flash_time = 0.0F;
     midend_finish_move(me);
     midend_redraw(me);
     midend_set_timer(me);
 }
 
+/*
+ * Copy of the current state, to animate from once a key has changed
+ * it. Only taken when the state is about to change, so that the
+ * stream of drag events which only update the UI costs no copying.
+ */
+static game_state *midend_dup_current(midend *me)
+{
+    return me->ourgame->dup_game(me->states[me->statepos - 1].state);
+}
+
 static bool midend_really_process_key(midend *me, int x, int y, int button)
 {
-    game_state *oldstate =
-        me->ourgame->dup_game(me->states[me->statepos - 1].state);
+    game_state *oldstate = NULL;
     int type = MOVE;
     bool gottype = false, ret = true;
     float anim_time;
@@ -901,16 +1453,19 @@ static bool midend_really_process_key(midend *me, int x, int y, int button)
 	    midend_stop_anim(me);
 	    type = me->states[me->statepos-1].movetype;
 	    gottype = true;
+	    oldstate = midend_dup_current(me);
 	    if (!midend_undo(me))
 		goto done;
 	} else if (button == 'r' || button == 'R' ||
 		   button == '\x12' || button == '\x19' ||
                    button == UI_REDO) {
 	    midend_stop_anim(me);
+	    oldstate = midend_dup_current(me);
 	    if (!midend_redo(me))
 		goto done;
 	} else if ((button == '\x13' || button == UI_SOLVE) &&
                    me->ourgame->can_solve) {
+	    oldstate = midend_dup_current(me);
 	    if (midend_solve(me))
 		goto done;
 	} else if (button == 'q' || button == 'Q' || button == '\x11' ||
@@ -938,6 +1493,7 @@ static bool midend_really_process_key(midend *me, int x, int y, int button)
             midend_set_timer(me);
             goto done;
         } else if (s) {
+            oldstate = midend_dup_current(me);
 	    midend_stop_anim(me);
             midend_purge_states(me);
             ensure(me);
@@ -946,13 +1502,15 @@ static bool midend_really_process_key(midend *me, int x, int y, int button)
             me->states[me->nstates].movestr = movestr;
             me->states[me->nstates].movetype = MOVE;
             me->statepos = ++me->nstates;
+            midend_thin_states(me);
+            midend_journal_record(me, "MOVE", movestr);
             me->dir = +1;
             // me->ui is allowed to be null here! (#333)
             bool just_completed = me->ourgame->changed_state(me->ui,
 					   me->states[me->statepos-2].state,
 					   me->states[me->statepos-1].state);
             if (just_completed) android_completed(me->frontend);
-            changed_state(me->drawing, me->statepos > 1, me->statepos < me->nstates);
+            midend_changed_state(me);
         } else {
             goto done;
         }
@@ -991,7 +1549,8 @@ static bool midend_really_process_key(midend *me, int x, int y, int button)
     return ret;
 }
 
-bool midend_process_key(midend *me, int x, int y, int button)
+static bool midend_process_key_internal(midend *me, int x, int y,
+                                        int button)
 {
     bool ret = true;
 
@@ -1130,6 +1689,14 @@ bool midend_process_key(midend *me, int x, int y, int button)
     return ret;
 }
 
+bool midend_process_key(midend *me, int x, int y, int button)
+{
+    bool traced = midend_trace_begin(me, "process_key");
+    bool ret = midend_process_key_internal(me, x, y, button);
+    midend_trace_end(traced);
+    return ret;
+}
+
 key_label *midend_request_keys(midend *me, int *n, int *arrow_mode)
 {
     return midend_request_keys_by_game(n, me->ourgame, midend_get_params(me), arrow_mode);
@@ -1164,6 +1731,7 @@ void midend_redraw(midend *me)
 
     if (me->statepos > 0 && me->drawstate) {
         bool first_draw = me->first_draw;
+        bool traced = midend_trace_begin(me, "redraw");
         me->first_draw = false;
 
         start_draw(me->drawing);
@@ -1202,6 +1770,7 @@ void midend_redraw(midend *me)
         }
 
         end_draw(me->drawing);
+        midend_trace_end(traced);
     }
 }
 
@@ -1219,6 +1788,7 @@ void midend_freeze_timer(midend *me, float tprop)
 void midend_timer(midend *me, float tplus)
 {
     bool need_redraw = (me->anim_time > 0 || me->flash_time > 0);
+    bool traced = midend_trace_begin(me, "timer");
 
     me->anim_pos += tplus;
     if (me->anim_pos >= me->anim_time ||
@@ -1243,6 +1813,14 @@ void midend_timer(midend *me, float tplus)
     }
 
     midend_set_timer(me);
+    midend_trace_end(traced);
+}
+
+float midend_timer_deadline(midend *me)
+{
+    if (me->anim_time > 0 || me->flash_time > 0 || !me->timing)
+        return 0.0F;
+    return 1.0F - (me->elapsed - (int)me->elapsed);
 }
 
 float *midend_colours(midend *me, int *ncolours)
@@ -1722,6 +2300,7 @@ const char *midend_game_id_int(midend *me, const char *id, int defmode, int vali
         error = me->ourgame->validate_params(newcurparams, desc == NULL);
         if (error) {
             me->ourgame->free_params(newcurparams);
+            sfree(par);
             return error;
         }
         oldparams1 = me->curparams;
@@ -1761,6 +2340,7 @@ const char *midend_game_id_int(midend *me, const char *id, int defmode, int vali
                 if (newparams)
                     me->ourgame->free_params(newparams);
             }
+            sfree(par);
             return error;
         }
     }
@@ -1772,6 +2352,7 @@ const char *midend_game_id_int(midend *me, const char *id, int defmode, int vali
             if (newparams)
                 me->ourgame->free_params(newparams);
         }
+        sfree(par);
         return NULL;
     }
 
@@ -1916,28 +2497,13 @@ char *midend_text_format(midend *me)
 	return NULL;
 }
 
-const char *midend_solve(midend *me)
+/*
+ * Enter the move a solver came up with as the next state.
+ */
+static void midend_enter_solve(midend *me, char *movestr)
 {
     game_state *s;
-    const char *msg;
-    char *movestr;
 
-    if (!me->ourgame->can_solve)
-	return _("This game does not support the Solve operation");
-
-    if (me->statepos < 1)
-	return _("No game set up to solve");   /* _shouldn't_ happen! */
-
-    msg = NULL;
-    movestr = me->ourgame->solve(me->states[0].state,
-				 me->states[me->statepos-1].state,
-				 me->aux_info, &msg);
-    assert(movestr != UI_UPDATE);
-    if (!movestr) {
-	if (!msg)
-	    msg = _("Solve operation failed");   /* _shouldn't_ happen, but can */
-	return msg;
-    }
     s = me->ourgame->execute_move(me->states[me->statepos-1].state, movestr);
     assert(s);
 
@@ -1951,12 +2517,14 @@ const char *midend_solve(midend *me)
     me->states[me->nstates].movestr = movestr;
     me->states[me->nstates].movetype = SOLVE;
     me->statepos = ++me->nstates;
+    midend_thin_states(me);
+    midend_journal_record(me, "SOLVE", movestr);
     // me->ui is allowed to be null here! (#333)
     bool wrongly_claimed_completion = me->ourgame->changed_state(me->ui,
                                    me->states[me->statepos-2].state,
                                    me->states[me->statepos-1].state);
     assert(!wrongly_claimed_completion);
-    changed_state(me->drawing, me->statepos > 1, me->statepos < me->nstates);
+    midend_changed_state(me);
     me->dir = +1;
     if (me->ourgame->flags & SOLVE_ANIMATES) {
 	me->oldstate = me->ourgame->dup_game(me->states[me->statepos-2].state);
@@ -1972,9 +2540,153 @@ const char *midend_solve(midend *me)
     if (me->drawing)
         midend_redraw(me);
     midend_set_timer(me);
+}
+
+static const char *midend_solve_check(midend *me)
+{
+    if (!me->ourgame->can_solve)
+	return _("This game does not support the Solve operation");
+
+    if (me->statepos < 1)
+	return _("No game set up to solve");   /* _shouldn't_ happen! */
+
+    return NULL;
+}
+
+static const char *midend_solve_internal(midend *me)
+{
+    const char *msg;
+    char *movestr;
+
+    msg = midend_solve_check(me);
+    if (msg)
+        return msg;
+
+    search_set_default_threads(me->gen_threads);
+    movestr = me->ourgame->solve(me->states[0].state,
+				 me->states[me->statepos-1].state,
+				 me->aux_info, &msg);
+    search_set_default_threads(1);
+    assert(movestr != UI_UPDATE);
+    if (!movestr) {
+	if (!msg)
+	    msg = _("Solve operation failed");   /* _shouldn't_ happen, but can */
+	return msg;
+    }
+    midend_enter_solve(me, movestr);
     return NULL;
 }
 
+const char *midend_solve(midend *me)
+{
+    bool traced = midend_trace_begin(me, "solve");
+    const char *ret = midend_solve_internal(me);
+    midend_trace_end(traced);
+    return ret;
+}
+
+/*
+ * An asynchronous solve works on its own copies of the two states
+ * and the aux info, so that the midend can carry on meanwhile. The
+ * copies mustn't come from dup_game, because that can share data with
+ * the midend's states through reference counts that aren't atomic,
+ * and solvers dup and free states themselves. So they are built
+ * afresh from the game description, and share nothing with the
+ * midend's states except through caches that take a lock, such as
+ * grid.c's.
+ */
+struct midend_solve_job {
+    const game *ourgame;
+    game_state *orig, *curr;
+    char *aux;
+    int threads;
+    char *movestr;
+    const char *msg;
+};
+
+/*
+ * Build states[i] again from scratch, by starting a new game from the
+ * description and replaying the moves up to it, as deserialisation
+ * does.
+ */
+static game_state *midend_private_state(midend *me, int i)
+{
+    game_state *s, *next;
+    int k;
+
+    s = me->ourgame->new_game(me, me->params,
+                              me->privdesc ? me->privdesc : me->desc);
+    for (k = 1; k <= i; k++) {
+        assert(me->states[k].movetype != NEWGAME);
+        if (me->states[k].movetype == RESTART)
+            next = me->ourgame->new_game(me, me->params,
+                                         me->states[k].movestr);
+        else
+            next = me->ourgame->execute_move(s, me->states[k].movestr);
+        assert(next);
+        me->ourgame->free_game(s);
+        s = next;
+    }
+    return s;
+}
+
+midend_solve_job *midend_solve_start(midend *me, const char **msg)
+{
+    midend_solve_job *job;
+
+    *msg = midend_solve_check(me);
+    if (*msg)
+        return NULL;
+
+    job = snew(midend_solve_job);
+    job->ourgame = me->ourgame;
+    job->orig = midend_private_state(me, 0);
+    job->curr = midend_private_state(me, me->statepos-1);
+    job->aux = me->aux_info ? dupstr(me->aux_info) : NULL;
+    job->threads = me->gen_threads;
+    job->movestr = NULL;
+    job->msg = NULL;
+    me->solve_job = job;
+    return job;
+}
+
+void midend_solve_run(midend_solve_job *job)
+{
+    search_set_default_threads(job->threads);
+    job->movestr = job->ourgame->solve(job->orig, job->curr, job->aux,
+                                       &job->msg);
+    search_set_default_threads(1);
+    assert(job->movestr != UI_UPDATE);
+}
+
+const char *midend_solve_finish(midend *me, midend_solve_job *job)
+{
+    const char *msg = NULL;
+
+    if (job == me->solve_job) {
+        me->solve_job = NULL;
+        if (job->movestr) {
+            bool traced = midend_trace_begin(me, "solve");
+            midend_enter_solve(me, job->movestr);
+            midend_trace_end(traced);
+            job->movestr = NULL;
+        } else {
+            msg = job->msg ? job->msg : _("Solve operation failed");
+        }
+    }
+    midend_solve_discard(job);
+    return msg;
+}
+
+void midend_solve_discard(midend_solve_job *job)
+{
+    job->ourgame->free_game(job->orig);
+    job->ourgame->free_game(job->curr);
+    sfree(job->aux);
+    sfree(job->movestr);
+    sfree(job);
+}
+
 int midend_status(midend *me)
 {
     /*
@@ -2025,12 +2737,108 @@ char *midend_rewrite_statusbar(midend *me, const char *text)
 #define SERIALISE_MAGIC "Simon Tatham's Portable Puzzle Collection"
 #define SERIALISE_VERSION "1"
 
-void midend_serialise(midend *me,
-                      void (*write)(void *ctx, const void *buf, int len),
-                      void *wctx)
+/*
+ * The compact binary form of a save file carries exactly the same
+ * key/value pairs as the text form, so that both go through the same
+ * code in midend_deserialise_internal. In place of the SAVEFILE line
+ * it starts with the 7 bytes of SERIALISE_BINARY_MAGIC (whose leading
+ * NUL can never begin a text save) and one byte giving the version of
+ * the binary container itself. Then each pair is one byte giving the
+ * key's index in serialise_binary_keys (plus 1), a little-endian
+ * base-128 varint giving the length of the value, and the value.
+ *
+ * In builds with zlib (USE_ZLIB), a long enough move list - every
+ * MOVE, SOLVE and RESTART pair, in the form above - is deflated into
+ * the value of a single MOVES pair instead, after a varint giving its
+ * uncompressed length. Builds without zlib can't read such a file.
+ */
+#define SERIALISE_BINARY_MAGIC "\0SGTPUZ"
+#define SERIALISE_BINARY_MAGIC_LEN 7
+#define SERIALISE_BINARY_VERSION 1
+#define SERIALISE_DEFLATE_MIN 512
+static const char *const serialise_binary_keys[] = {
+    "SAVEFILE", "VERSION", "GAME", "PARAMS", "CPARAMS", "SEED", "DESC",
+    "PRIVDESC", "AUXINFO", "UI", "TIME", "NSTATES", "STATEPOS", "MOVE",
+    "SOLVE", "RESTART", "MOVES", "UNDO", "REDO", "PURGE",
+};
+
+/* Writes 'n' as a varint to 'buf', which needs room for 5 bytes.
+ * Returns the number of bytes written. */
+static int put_varint(unsigned char *buf, unsigned n)
 {
+    int len = 0;
+
+    do {
+        buf[len++] = (n & 0x7F) | (n > 0x7F ? 0x80 : 0);
+        n >>= 7;
+    } while (n);
+    return len;
+}
+
+/* Reads a varint from the first 'len' bytes of 'buf' into '*n'.
+ * Returns the number of bytes it took, or 0 if it was malformed or
+ * too big for a length that can have 1 added to it as an int. */
+static int get_varint(const unsigned char *buf, int len, unsigned *n)
+{
+    int i;
+
+    *n = 0;
+    for (i = 0; i < len && i < 5; i++) {
+        if (i == 4 && (buf[i] & 0x70))
+            return 0;
+        *n |= (unsigned)(buf[i] & 0x7F) << (7*i);
+        if (!(buf[i] & 0x80))
+            return *n < INT_MAX ? i+1 : 0;
+    }
+    return 0;
+}
+
+static void serialise_binary_pair(struct midend_serialise_buf *ser,
+                                  const char *key, const char *val,
+                                  int len)
+{
+    unsigned char hbuf[1 + 5];
     int i;
 
+    for (i = 0; i < lenof(serialise_binary_keys); i++)
+        if (!strcmp(key, serialise_binary_keys[i]))
+            break;
+    assert(i < lenof(serialise_binary_keys));
+    hbuf[0] = i + 1;
+    newgame_serialise_write(ser, hbuf, 1 + put_varint(hbuf + 1, len));
+    newgame_serialise_write(ser, val, len);
+}
+
+#ifdef USE_ZLIB
+/*
+ * Replace the pairs from 'start' to the end of 'ser' with a MOVES
+ * pair holding them deflated, if that's smaller. Compaction of a
+ * journal happens between moves, so this goes for speed over size.
+ */
+static void serialise_deflate_moves(struct midend_serialise_buf *ser,
+                                    int start)
+{
+    uLong rawlen = ser->len - start;
+    uLongf zlen = compressBound(rawlen);
+    unsigned char *z = snewn(5 + zlen, unsigned char);
+    int hlen = put_varint(z, rawlen);
+
+    if (compress2(z + hlen, &zlen, (const Bytef *)ser->buf + start,
+                  rawlen, Z_BEST_SPEED) == Z_OK &&
+        hlen + zlen < rawlen) {
+        ser->len = start;
+        serialise_binary_pair(ser, "MOVES", (char *)z, hlen + zlen);
+    }
+    sfree(z);
+}
+#endif
+
+static void midend_serialise_internal(
+    midend *me, void (*write)(void *ctx, const void *buf, int len),
+    void *wctx, struct midend_serialise_buf *binary)
+{
+    int i, movestart;
+
     /*
      * Each line of the save file contains three components. First
      * exactly 8 characters of header word indicating what type of
@@ -2039,11 +2847,18 @@ void midend_serialise(midend *me,
      * line; then a colon followed by the string itself (exactly as
      * many bytes as previously specified, no matter what they
      * contain). Then a newline (of reasonably flexible form).
+     *
+     * If 'binary' is non-NULL, the pairs are instead appended to it
+     * in the compact form described above.
      */
 #define wr(h,s) do { \
     char hbuf[80]; \
     const char *str = (s); \
     char lbuf[9];                               \
+    if (binary) { \
+        serialise_binary_pair(binary, h, str, strlen(str)); \
+        break; \
+    } \
     copy_left_justified(lbuf, sizeof(lbuf), h); \
     sprintf(hbuf, "%s:%d:", lbuf, (int)strlen(str)); \
     write(wctx, hbuf, strlen(hbuf)); \
@@ -2055,7 +2870,13 @@ void midend_serialise(midend *me,
      * Magic string identifying the file, and version number of the
      * file format.
      */
-    wr("SAVEFILE", SERIALISE_MAGIC);
+    if (binary) {
+        unsigned char version = SERIALISE_BINARY_VERSION;
+        newgame_serialise_write(binary, SERIALISE_BINARY_MAGIC,
+                                SERIALISE_BINARY_MAGIC_LEN);
+        newgame_serialise_write(binary, &version, 1);
+    } else
+        wr("SAVEFILE", SERIALISE_MAGIC);
     wr("VERSION", SERIALISE_VERSION);
 
     /*
@@ -2155,6 +2976,7 @@ void midend_serialise(midend *me,
      * information for execute_move() to reconstruct it from the
      * previous one.
      */
+    movestart = binary ? binary->len : 0;
     for (i = 1; i < me->nstates; i++) {
         assert(me->states[i].movetype != NEWGAME);   /* only state 0 */
         switch (me->states[i].movetype) {
@@ -2169,10 +2991,231 @@ void midend_serialise(midend *me,
             break;
         }
     }
+#ifdef USE_ZLIB
+    if (binary && binary->len - movestart >= SERIALISE_DEFLATE_MIN)
+        serialise_deflate_moves(binary, movestart);
+#else
+    (void)movestart;
+#endif
 
 #undef wr
 }
 
+void midend_serialise(midend *me,
+                      void (*write)(void *ctx, const void *buf, int len),
+                      void *wctx)
+{
+    bool traced = midend_trace_begin(me, "serialise");
+    midend_serialise_internal(me, write, wctx, NULL);
+    midend_trace_end(traced);
+}
+
+/*
+ * Serialise to the compact form in a newly allocated buffer. It's
+ * sized up front from the move list, which is almost all of a long
+ * game, so that it's built with at most one reallocation.
+ */
+static void midend_serialise_compact_buf(midend *me,
+                                         struct midend_serialise_buf *ser)
+{
+    int i, size = 1024;
+
+    for (i = 1; i < me->nstates; i++)
+        size += 6 + strlen(me->states[i].movestr);
+    if (me->desc)
+        size += 2 * strlen(me->desc);
+    if (me->aux_info)
+        size += 2 * strlen(me->aux_info);
+
+    ser->buf = snewn(size, char);
+    ser->size = size;
+    ser->len = 0;
+    midend_serialise_internal(me, NULL, NULL, ser);
+}
+
+void midend_serialise_compact(midend *me,
+                              void (*write)(void *ctx, const void *buf,
+                                            int len),
+                              void *wctx)
+{
+    struct midend_serialise_buf ser;
+    bool traced = midend_trace_begin(me, "serialise");
+
+    midend_serialise_compact_buf(me, &ser);
+    write(wctx, ser.buf, ser.len);
+    sfree(ser.buf);
+    midend_trace_end(traced);
+}
+
+static void pair_reader_init(struct pair_reader *pr,
+                             bool (*read)(void *ctx, void *buf, int len),
+                             void *rctx)
+{
+    pr->read = read;
+    pr->rctx = rctx;
+    pr->binary = -1;
+    pr->moves = NULL;
+    pr->moves_len = pr->moves_pos = 0;
+}
+
+static void pair_reader_free(struct pair_reader *pr)
+{
+    sfree(pr->moves);
+}
+
+static bool pair_read(struct pair_reader *pr, void *buf, int len)
+{
+    if (pr->moves) {
+        if (len > pr->moves_len - pr->moves_pos)
+            return false;
+        memcpy(buf, pr->moves + pr->moves_pos, len);
+        pr->moves_pos += len;
+        return true;
+    }
+    return pr->read(pr->rctx, buf, len);
+}
+
+/*
+ * Inflate the value of a MOVES pair into pr->moves, for the pairs in
+ * it to be read before anything after it.
+ */
+static bool pair_reader_inflate(struct pair_reader *pr,
+                                const char *val, int len)
+{
+#ifdef USE_ZLIB
+    unsigned rawlen;
+    uLongf dlen;
+    int hlen = get_varint((const unsigned char *)val, len, &rawlen);
+
+    /* deflate can't do better than about 1032:1 */
+    if (!hlen || pr->moves || rawlen / 1032 > (unsigned)len)
+        return false;
+    pr->moves = snewn(rawlen + 1, char);
+    dlen = rawlen;
+    if (uncompress((Bytef *)pr->moves, &dlen, (const Bytef *)val + hlen,
+                   len - hlen) != Z_OK || dlen != rawlen) {
+        sfree(pr->moves);
+        pr->moves = NULL;
+        return false;
+    }
+    pr->moves_len = rawlen;
+    pr->moves_pos = 0;
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Read one key/value pair from a save file in either form, into
+ * 'key' (which must have room for 9 chars) and a newly allocated
+ * '*val'. The form is detected from the first byte, and a binary
+ * file's magic number is reported as the same SAVEFILE pair a text
+ * file starts with. A MOVES pair is never returned: the pairs inside
+ * it are.
+ */
+enum { READ_PAIR_OK, READ_PAIR_EOF, READ_PAIR_BAD };
+static int midend_read_pair(struct pair_reader *pr, char *key, char **val)
+{
+    int len;
+    char c;
+
+    *val = NULL;
+
+    if (pr->moves && pr->moves_pos == pr->moves_len) {
+        sfree(pr->moves);
+        pr->moves = NULL;
+    }
+
+    if (pr->binary == 1) {
+        unsigned char b, vbuf[5];
+        unsigned ulen;
+        int i;
+
+        if (!pair_read(pr, &b, 1))
+            return READ_PAIR_EOF;
+        if (b == 0 || b > lenof(serialise_binary_keys))
+            return READ_PAIR_BAD;
+        strcpy(key, serialise_binary_keys[b - 1]);
+
+        i = 0;
+        do {
+            if (!pair_read(pr, &vbuf[i], 1))
+                return READ_PAIR_EOF;
+        } while ((vbuf[i++] & 0x80) && i < 5);
+        if (!get_varint(vbuf, i, &ulen))
+            return READ_PAIR_BAD;
+        len = ulen;
+
+        *val = snewn(len+1, char);
+        if (!pair_read(pr, *val, len))
+            return READ_PAIR_EOF;
+        (*val)[len] = '\0';
+
+        if (!strcmp(key, "MOVES")) {
+            bool ok = pair_reader_inflate(pr, *val, len);
+            sfree(*val);
+            *val = NULL;
+            if (!ok)
+                return READ_PAIR_BAD;
+            return midend_read_pair(pr, key, val);
+        }
+        return READ_PAIR_OK;
+    }
+
+    do {
+        if (!pair_read(pr, key, 1))
+            return READ_PAIR_EOF;
+    } while (key[0] == '\r' || key[0] == '\n');
+
+    if (pr->binary == -1) {
+        if (key[0] == SERIALISE_BINARY_MAGIC[0]) {
+            char magic[SERIALISE_BINARY_MAGIC_LEN + 1];
+            magic[0] = key[0];
+            if (!pair_read(pr, magic + 1, SERIALISE_BINARY_MAGIC_LEN))
+                return READ_PAIR_EOF;
+            if (memcmp(magic, SERIALISE_BINARY_MAGIC,
+                       SERIALISE_BINARY_MAGIC_LEN) ||
+                magic[SERIALISE_BINARY_MAGIC_LEN] != SERIALISE_BINARY_VERSION)
+                return READ_PAIR_BAD;
+            pr->binary = 1;
+            strcpy(key, "SAVEFILE");
+            *val = dupstr(SERIALISE_MAGIC);
+            return READ_PAIR_OK;
+        }
+        pr->binary = 0;
+    }
+
+    if (!pair_read(pr, key+1, 8))
+        return READ_PAIR_EOF;
+
+    if (key[8] != ':')
+        return READ_PAIR_BAD;
+    len = strcspn(key, ": ");
+    assert(len <= 8);
+    key[len] = '\0';
+
+    len = 0;
+    while (1) {
+        if (!pair_read(pr, &c, 1))
+            return READ_PAIR_EOF;
+
+        if (c == ':') {
+            break;
+        } else if (c >= '0' && c <= '9' && len < (INT_MAX - 9) / 10) {
+            len = (len * 10) + (c - '0');
+        } else {
+            return READ_PAIR_BAD;
+        }
+    }
+
+    *val = snewn(len+1, char);
+    if (!pair_read(pr, *val, len))
+        return READ_PAIR_EOF;
+    (*val)[len] = '\0';
+    return READ_PAIR_OK;
+}
+
 /*
  * Internal version of midend_deserialise, taking an extra check
  * function to be called just before beginning to install things in
@@ -2184,7 +3227,7 @@ void midend_serialise(midend *me,
  * Accepts me == null, to identify the game only.
  */
 static const char *midend_deserialise_internal(
-    midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx,
+    midend *me, struct pair_reader *pr,
     const char *(*check)(void *ctx, midend *, const struct deserialise_data *),
     void *cctx)
 {
@@ -2213,54 +3256,19 @@ static const char *midend_deserialise_internal(
      */
     while (data.nstates <= 0 || data.statepos < 0 ||
            gotstates < data.nstates-1) {
-        char key[9], c;
-        int len;
+        char key[9];
 
-        do {
-            if (!read(rctx, key, 1)) {
-                /* unexpected EOF */
-                goto cleanup;
-            }
-        } while (key[0] == '\r' || key[0] == '\n');
-
-        if (!read(rctx, key+1, 8)) {
-            /* unexpected EOF */
-            goto cleanup;
-        }
-
-        if (key[8] != ':') {
+        switch (midend_read_pair(pr, key, &val)) {
+          case READ_PAIR_OK:
+            break;
+          case READ_PAIR_BAD:
             if (started)
                 ret = _("Data was incorrectly formatted for a saved game file");
-	    goto cleanup;
-        }
-        len = strcspn(key, ": ");
-        assert(len <= 8);
-        key[len] = '\0';
-
-        len = 0;
-        while (1) {
-            if (!read(rctx, &c, 1)) {
-                /* unexpected EOF */
-                goto cleanup;
-            }
-
-            if (c == ':') {
-                break;
-            } else if (c >= '0' && c <= '9') {
-                len = (len * 10) + (c - '0');
-            } else {
-                if (started)
-                    ret = _("Data was incorrectly formatted for a saved game file");
-                goto cleanup;
-            }
-        }
-
-        val = snewn(len+1, char);
-        if (!read(rctx, val, len)) {
-            if (started)
+            goto cleanup;
+          default:
+            /* unexpected EOF */
             goto cleanup;
         }
-        val[len] = '\0';
 
         if (!started) {
             if (strcmp(key, "SAVEFILE") || strcmp(val, SERIALISE_MAGIC)) {
@@ -2470,6 +3478,8 @@ static const char *midend_deserialise_internal(
         data.states = tmp;
     }
     me->statepos = data.statepos;
+    me->solve_job = NULL;
+    midend_thin_states(me);
 
     /*
      * Don't save the "new game undo/redo" state.  So "new game" twice or
@@ -2519,6 +3529,7 @@ static const char *midend_deserialise_internal(
     midend_size_new_drawstate(me);
     if (me->game_id_change_notify_function)
         me->game_id_change_notify_function(me->game_id_change_notify_ctx);
+    midend_journal_base(me);
 
     ret = NULL;                        /* success! */
 
@@ -2554,7 +3565,113 @@ static const char *midend_deserialise_internal(
 const char *midend_deserialise(
     midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx)
 {
-    return midend_deserialise_internal(me, read, rctx, NULL, NULL);
+    bool traced = midend_trace_begin(me, "deserialise");
+    struct pair_reader pr;
+    const char *ret;
+
+    pair_reader_init(&pr, read, rctx);
+    ret = midend_deserialise_internal(me, &pr, NULL, NULL);
+    pair_reader_free(&pr);
+    midend_trace_end(traced);
+    return ret;
+}
+
+/*
+ * Load a journal written via midend_set_journal(): deserialise its
+ * base record, then replay the records after it. A truncated or
+ * unreadable record ends the replay, leaving the game as it was
+ * after the last complete one, since that's what a crash part way
+ * through an append leaves behind. An ordinary save file is a
+ * journal with nothing after the base, so this accepts that too.
+ */
+const char *midend_deserialise_journal(
+    midend *me, bool (*read)(void *ctx, void *buf, int len), void *rctx)
+{
+    void (*journal_write)(void *, const void *, int, bool);
+    struct pair_reader pr;
+    const char *ret;
+    bool replayed = false;
+
+    journal_write = me->journal_write;
+    me->journal_write = NULL;
+    pair_reader_init(&pr, read, rctx);
+    ret = midend_deserialise_internal(me, &pr, NULL, NULL);
+    if (ret)
+        goto done;
+
+    while (1) {
+        char key[9], *val;
+        game_state *s = NULL;
+        int type;
+
+        if (midend_read_pair(&pr, key, &val) != READ_PAIR_OK) {
+            sfree(val);
+            break;
+        }
+
+        if (!strcmp(key, "TIME")) {
+            me->elapsed = (float)atof(val);
+        } else if (!strcmp(key, "UI")) {
+            me->ourgame->decode_ui(me->ui, val);
+        } else if (!strcmp(key, "UNDO") || !strcmp(key, "REDO")) {
+            int newpos = me->statepos + (key[0] == 'U' ? -1 : +1);
+            if (newpos >= 1 && newpos <= me->nstates) {
+                me->ourgame->changed_state(
+                    me->ui, me->states[me->statepos-1].state,
+                    me->states[newpos-1].state);
+                me->statepos = newpos;
+                midend_thin_states(me);
+            }
+        } else if (!strcmp(key, "PURGE")) {
+            midend_discard_redo(me);
+        } else if (!strcmp(key, "MOVE") || !strcmp(key, "SOLVE") ||
+                   !strcmp(key, "RESTART")) {
+            if (key[0] == 'R') {
+                type = RESTART;
+                if (!me->ourgame->validate_desc(me->params, val))
+                    s = me->ourgame->new_game(me, me->params, val);
+            } else {
+                type = key[0] == 'S' ? SOLVE : MOVE;
+                s = me->ourgame->execute_move(
+                    me->states[me->statepos-1].state, val);
+            }
+            if (!s) {
+                sfree(val);
+                break;
+            }
+            midend_discard_redo(me);
+            ensure(me);
+            me->states[me->nstates].state = s;
+            me->states[me->nstates].movestr = val;
+            me->states[me->nstates].movetype = type;
+            me->statepos = ++me->nstates;
+            me->ourgame->changed_state(me->ui,
+                                       me->states[me->statepos-2].state,
+                                       me->states[me->statepos-1].state);
+            midend_thin_states(me);
+            val = NULL;
+        }
+        replayed = true;
+        sfree(val);
+    }
+
+    if (replayed) {
+        if (me->drawstate)
+            me->ourgame->free_drawstate(me->drawing, me->drawstate);
+        me->drawstate =
+            me->ourgame->new_drawstate(me->drawing,
+                                       me->states[me->statepos-1].state);
+        me->first_draw = true;
+        midend_size_new_drawstate(me);
+        midend_set_timer(me);
+    }
+
+  done:
+    pair_reader_free(&pr);
+    me->journal_write = journal_write;
+    if (!ret)
+        midend_journal_base(me);
+    return ret;
 }
 
 /*
@@ -2570,67 +3687,33 @@ const char *identify_game(char **name,
 {
     int nstates = 0, statepos = -1, gotstates = 0;
     bool started = false;
+    struct pair_reader pr_, *pr = &pr_;
 
     char *val = NULL;
     /* Initially all errors give the same report */
     const char *ret = _("Data does not appear to be a saved game file");
 
     *name = NULL;
+    pair_reader_init(pr, read, rctx);
 
     /*
      * Loop round and round reading one key/value pair at a time from
      * the serialised stream, until we've found the game name.
      */
     while (nstates <= 0 || statepos < 0 || gotstates < nstates-1) {
-        char key[9], c;
-        int len;
-
-        do {
-            if (!read(rctx, key, 1)) {
-                /* unexpected EOF */
-                goto cleanup;
-            }
-        } while (key[0] == '\r' || key[0] == '\n');
+        char key[9];
 
-        if (!read(rctx, key+1, 8)) {
-            /* unexpected EOF */
-            goto cleanup;
-        }
-
-        if (key[8] != ':') {
+        switch (midend_read_pair(pr, key, &val)) {
+          case READ_PAIR_OK:
+            break;
+          case READ_PAIR_BAD:
             if (started)
                 ret = _("Data was incorrectly formatted for a saved game file");
-	    goto cleanup;
-        }
-        len = strcspn(key, ": ");
-        assert(len <= 8);
-        key[len] = '\0';
-
-        len = 0;
-        while (1) {
-            if (!read(rctx, &c, 1)) {
-                /* unexpected EOF */
-                goto cleanup;
-            }
-
-            if (c == ':') {
-                break;
-            } else if (c >= '0' && c <= '9') {
-                len = (len * 10) + (c - '0');
-            } else {
-                if (started)
-                    ret = _("Data was incorrectly formatted for a"
-                    " saved game file");
-                goto cleanup;
-            }
-        }
-
-        val = snewn(len+1, char);
-        if (!read(rctx, val, len)) {
-            if (started)
+            goto cleanup;
+          default:
+            /* unexpected EOF */
             goto cleanup;
         }
-        val[len] = '\0';
 
         if (!started) {
             if (strcmp(key, "SAVEFILE") || strcmp(val, SERIALISE_MAGIC)) {
@@ -2660,6 +3743,7 @@ const char *identify_game(char **name,
 
     cleanup:
     sfree(val);
+    pair_reader_free(pr);
     return ret;
 }
 
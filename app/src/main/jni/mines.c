@@ -14,7 +14,6 @@
 #include <ctype.h>
 #include <math.h>
 
-#include "tree234.h"
 #include "puzzles.h"
 
 enum {
@@ -293,50 +292,111 @@ static int bitcount16(int inword)
 }
 
 /*
- * We use a tree234 to store a large number of small localised
- * sets, each with a mine count. We also keep some of those sets
- * linked together into a to-do list.
+ * We store a large number of small localised sets, each with a mine
+ * count, in a flat array indexed by the top left square of each set,
+ * with the sets sharing a top left square chained in mask order. So
+ * walking the array in order visits the sets sorted by (y,x,mask).
+ * We also keep some of those sets linked together into a to-do list.
+ * Sets are allocated from blocks which are only freed with the store.
  */
 struct set {
     short x, y, mask, mines;
     bool todo;
     struct set *prev, *next;
+    struct set *hnext;		       /* next set with the same x,y */
 };
 
-static int setcmp(void *av, void *bv)
-{
-    struct set *a = (struct set *)av;
-    struct set *b = (struct set *)bv;
-
-    if (a->y < b->y)
-	return -1;
-    else if (a->y > b->y)
-	return +1;
-    else if (a->x < b->x)
-	return -1;
-    else if (a->x > b->x)
-	return +1;
-    else if (a->mask < b->mask)
-	return -1;
-    else if (a->mask > b->mask)
-	return +1;
-    else
-	return 0;
-}
+#define SETS_PER_BLOCK 256
 
 struct setstore {
-    tree234 *sets;
+    int w, h;
+    struct set **cells;
+    int nsets;
     struct set *todo_head, *todo_tail;
+    struct set *freelist;
+    struct set **blocks;
+    int nblocks, blocksize;
 };
 
-static struct setstore *ss_new(void)
+static struct setstore *ss_new(int w, int h)
 {
     struct setstore *ss = snew(struct setstore);
-    ss->sets = newtree234(setcmp);
+    int i;
+    ss->w = w;
+    ss->h = h;
+    ss->cells = snewn(w*h, struct set *);
+    for (i = 0; i < w*h; i++)
+	ss->cells[i] = NULL;
+    ss->nsets = 0;
     ss->todo_head = ss->todo_tail = NULL;
+    ss->freelist = NULL;
+    ss->blocks = NULL;
+    ss->nblocks = ss->blocksize = 0;
     return ss;
 }
 
+/*
+ * Empty the store, keeping its allocations for reuse by the next solve.
+ */
+static void ss_clear(struct setstore *ss)
+{
+    int i;
+    for (i = 0; i < ss->w * ss->h; i++) {
+	while (ss->cells[i]) {
+	    struct set *s = ss->cells[i];
+	    ss->cells[i] = s->hnext;
+	    s->hnext = ss->freelist;
+	    ss->freelist = s;
+	}
+    }
+    ss->nsets = 0;
+    ss->todo_head = ss->todo_tail = NULL;
+}
+
+static void ss_free(struct setstore *ss)
+{
+    int i;
+    for (i = 0; i < ss->nblocks; i++)
+	sfree(ss->blocks[i]);
+    sfree(ss->blocks);
+    sfree(ss->cells);
+    sfree(ss);
+}
+
+static struct set *ss_alloc(struct setstore *ss)
+{
+    struct set *s;
+    if (!ss->freelist) {
+	int i;
+	if (ss->nblocks >= ss->blocksize) {
+	    ss->blocksize = ss->nblocks + 16;
+	    ss->blocks = sresize(ss->blocks, ss->blocksize, struct set *);
+	}
+	s = ss->blocks[ss->nblocks++] = snewn(SETS_PER_BLOCK, struct set);
+	for (i = SETS_PER_BLOCK; i-- > 0 ;) {
+	    s[i].hnext = ss->freelist;
+	    ss->freelist = &s[i];
+	}
+    }
+    s = ss->freelist;
+    ss->freelist = s->hnext;
+    return s;
+}
+
+/*
+ * Return the nth set in (y,x,mask) order, or NULL if there are fewer.
+ */
+static struct set *ss_index(struct setstore *ss, int n)
+{
+    int i;
+    struct set *s;
+    for (i = 0; i < ss->w * ss->h; i++)
+	for (s = ss->cells[i]; s; s = s->hnext)
+	    if (n-- == 0)
+		return s;
+    return NULL;
+}
+
 /*
  * Take two input sets, in the form (x,y,mask). Munge the first by
  * taking either its intersection with the second or its difference
@@ -409,7 +469,7 @@ static void ss_add_todo(struct setstore *ss, struct set *s)
 
 static void ss_add(struct setstore *ss, int x, int y, int mask, int mines)
 {
-    struct set *s;
+    struct set *s, **link;
 
     assert(mask != 0);
 
@@ -423,24 +483,28 @@ static void ss_add(struct setstore *ss, int x, int y, int mask, int mines)
 	mask >>= 3, y++;
 
     /*
-     * Create a set structure and add it to the tree.
+     * Find where it belongs in its square's chain, which is kept in
+     * mask order; if this set already exists there's nothing to do.
      */
-    s = snew(struct set);
+    assert(x >= 0 && x < ss->w && y >= 0 && y < ss->h);
+    link = &ss->cells[y * ss->w + x];
+    while (*link && (*link)->mask < mask)
+	link = &(*link)->hnext;
+    if (*link && (*link)->mask == mask)
+	return;
+
+    s = ss_alloc(ss);
     s->x = x;
     s->y = y;
     s->mask = mask;
     s->mines = mines;
     s->todo = false;
-    if (add234(ss->sets, s) != s) {
-	/*
-	 * This set already existed! Free it and return.
-	 */
-	sfree(s);
-	return;
-    }
+    s->hnext = *link;
+    *link = s;
+    ss->nsets++;
 
     /*
-     * We've added a new set to the tree, so put it on the todo
+     * We've added a new set to the store, so put it on the todo
      * list.
      */
     ss_add_todo(ss, s);
@@ -448,7 +512,7 @@ static void ss_add(struct setstore *ss, int x, int y, int mask, int mines)
 
 static void ss_remove(struct setstore *ss, struct set *s)
 {
-    struct set *next = s->next, *prev = s->prev;
+    struct set *next = s->next, *prev = s->prev, **link;
 
 #ifdef SOLVER_DIAGNOSTICS
     printf("removing set %d,%d %03x\n", s->x, s->y, s->mask);
@@ -469,14 +533,38 @@ static void ss_remove(struct setstore *ss, struct set *s)
     s->todo = false;
 
     /*
-     * Remove s from the tree.
+     * Remove s from its square's chain.
      */
-    del234(ss->sets, s);
+    link = &ss->cells[s->y * ss->w + s->x];
+    while (*link != s)
+	link = &(*link)->hnext;
+    *link = s->hnext;
+    ss->nsets--;
 
     /*
-     * Destroy the actual set structure.
+     * Return the set structure to the free list.
      */
-    sfree(s);
+    s->hnext = ss->freelist;
+    ss->freelist = s;
+}
+
+/*
+ * Determine whether two sets have any square in common, by lining
+ * up the rows of the second with those of the first.
+ */
+static bool setoverlaps(int x1, int y1, int mask1, int x2, int y2, int mask2)
+{
+    int dx = x2 - x1, dy = y2 - y1, row;
+
+    if (abs(dx) >= 3 || abs(dy) >= 3)
+	return false;
+    for (row = max(0, dy); row < min(3, dy + 3); row++) {
+	int row1 = (mask1 >> (3 * row)) & 7;
+	int row2 = (mask2 >> (3 * (row - dy))) & 7;
+	if (row1 & (dx >= 0 ? row2 << dx : row2 >> -dx))
+	    return true;
+    }
+    return false;
 }
 
 /*
@@ -491,37 +579,23 @@ static struct set **ss_overlap(struct setstore *ss, int x, int y, int mask)
 
     for (xx = x-3; xx < x+3; xx++)
 	for (yy = y-3; yy < y+3; yy++) {
-	    struct set stmp, *s;
-	    int pos;
+	    struct set *s;
 
-	    /*
-	     * Find the first set with these top left coordinates.
-	     */
-	    stmp.x = xx;
-	    stmp.y = yy;
-	    stmp.mask = 0;
+	    if (xx < 0 || xx >= ss->w || yy < 0 || yy >= ss->h)
+		continue;
 
-	    if (findrelpos234(ss->sets, &stmp, NULL, REL234_GE, &pos)) {
-		while ((s = index234(ss->sets, pos)) != NULL &&
-		       s->x == xx && s->y == yy) {
-		    /*
-		     * This set potentially overlaps the input one.
-		     * Compute the intersection to see if they
-		     * really overlap, and add it to the list if
-		     * so.
-		     */
-		    if (setmunge(x, y, mask, s->x, s->y, s->mask, false)) {
-			/*
-			 * There's an overlap.
-			 */
-			if (nret >= retsize) {
-			    retsize = nret + 32;
-			    ret = sresize(ret, retsize, struct set *);
-			}
-			ret[nret++] = s;
+	    for (s = ss->cells[yy * ss->w + xx]; s; s = s->hnext) {
+		/*
+		 * This set potentially overlaps the input one.
+		 * Check whether they really overlap, and add it to
+		 * the list if so.
+		 */
+		if (setoverlaps(x, y, mask, s->x, s->y, s->mask)) {
+		    if (nret >= retsize) {
+			retsize = nret + 32;
+			ret = sresize(ret, retsize, struct set *);
 		    }
-
-		    pos++;
+		    ret[nret++] = s;
 		}
 	    }
 	}
@@ -640,12 +714,16 @@ struct perturbations {
 
 typedef struct perturbations *(*perturb_cb) (void *, signed char *, int, int, int);
 
+/*
+ * `ss' is an empty set store for a w x h grid, which is cleared
+ * again before returning so that callers running the solver many
+ * times can keep reusing it.
+ */
 static int minesolve(int w, int h, int n, signed char *grid,
 		     open_cb open,
                      perturb_cb perturb,
-		     void *ctx, random_state *rs)
+		     void *ctx, random_state *rs, struct setstore *ss)
 {
-    struct setstore *ss = ss_new();
     struct set **list;
     struct squaretodo astd, *std = &astd;
     int x, y, i, j;
@@ -966,7 +1044,7 @@ static int minesolve(int w, int h, int n, signed char *grid,
 	     * a bit slow for large n, so I artificially cap this
 	     * recursion at n=10 to avoid too much pain.
 	     */
-	    nsets = count234(ss->sets);
+	    nsets = ss->nsets;
 	    if (nsets <= lenof(setused)) {
 		/*
 		 * Doing this with actual recursive function calls
@@ -1011,7 +1089,7 @@ static int minesolve(int w, int h, int n, signed char *grid,
 		 */
 		struct set *sets[lenof(setused)];
 		for (i = 0; i < nsets; i++)
-		    sets[i] = index234(ss->sets, i);
+		    sets[i] = ss_index(ss, i);
 
 		cursor = 0;
 		while (1) {
@@ -1150,7 +1228,7 @@ static int minesolve(int w, int h, int n, signed char *grid,
 	{
 	    struct set *s;
 
-	    for (i = 0; (s = index234(ss->sets, i)) != NULL; i++)
+	    for (i = 0; (s = ss_index(ss, i)) != NULL; i++)
 		printf("remaining set: %d,%d %03x %d\n", s->x, s->y, s->mask, s->mines);
 	}
 #endif
@@ -1174,13 +1252,13 @@ static int minesolve(int w, int h, int n, signed char *grid,
 	     * 
 	     * If we have no sets at all, we must give up.
 	     */
-	    if (count234(ss->sets) == 0) {
+	    if (ss->nsets == 0) {
 #ifdef SOLVER_DIAGNOSTICS
 		printf("perturbing on entire unknown set\n");
 #endif
 		ret = perturb(ctx, grid, 0, 0, 0);
 	    } else {
-		s = index234(ss->sets, random_upto(rs, count234(ss->sets)));
+		s = ss_index(ss, random_upto(rs, ss->nsets));
 #ifdef SOLVER_DIAGNOSTICS
 		printf("perturbing on set %d,%d %03x\n", s->x, s->y, s->mask);
 #endif
@@ -1251,7 +1329,7 @@ static int minesolve(int w, int h, int n, signed char *grid,
 		{
 		    struct set *s;
 
-		    for (i = 0; (s = index234(ss->sets, i)) != NULL; i++)
+		    for (i = 0; (s = ss_index(ss, i)) != NULL; i++)
 			printf("remaining set: %d,%d %03x %d\n", s->x, s->y, s->mask, s->mines);
 		}
 #endif
@@ -1282,16 +1360,10 @@ static int minesolve(int w, int h, int n, signed char *grid,
 	    }
 
     /*
-     * Free the set list and square-todo list.
+     * Empty the set list and free the square-todo list.
      */
-    {
-	struct set *s;
-	while ((s = delpos234(ss->sets, 0)) != NULL)
-	    sfree(s);
-	freetree234(ss->sets);
-	sfree(ss);
-	sfree(std->next);
-    }
+    ss_clear(ss);
+    sfree(std->next);
 
     return nperturbs;
 }
@@ -1730,6 +1802,10 @@ static bool *minegen(int w, int h, int n, int x, int y, bool unique,
     int ntries = 0;
 
     do {
+	if (random_cancelled(rs)) {
+	    sfree(ret);
+	    return NULL;
+	}
 	success = false;
 	ntries++;
 
@@ -1797,6 +1873,7 @@ static bool *minegen(int w, int h, int n, int x, int y, bool unique,
          */
 	if (unique) {
 	    signed char *solvegrid = snewn(w*h, signed char);
+	    struct setstore *ss = ss_new(w, h);
 	    struct minectx actx, *ctx = &actx;
 	    int solveret, prevret = -2;
 
@@ -1809,12 +1886,16 @@ static bool *minegen(int w, int h, int n, int x, int y, bool unique,
 	    ctx->allow_big_perturbs = (ntries > 100);
 
 	    while (1) {
+		if (random_cancelled(rs)) {
+		    success = false;
+		    break;
+		}
 		memset(solvegrid, -2, w*h);
 		solvegrid[y*w+x] = mineopen(ctx, x, y);
 		assert(solvegrid[y*w+x] == 0); /* by deliberate arrangement */
 
 		solveret =
-		    minesolve(w, h, n, solvegrid, mineopen, mineperturb, ctx, rs);
+		    minesolve(w, h, n, solvegrid, mineopen, mineperturb, ctx, rs, ss);
 		if (solveret < 0 || (prevret >= 0 && solveret >= prevret)) {
 		    success = false;
 		    break;
@@ -1824,6 +1905,7 @@ static bool *minegen(int w, int h, int n, int x, int y, bool unique,
 		}
 	    }
 
+	    ss_free(ss);
 	    sfree(solvegrid);
 	} else {
 	    success = true;
@@ -1946,7 +2028,7 @@ static bool *new_mine_layout(int w, int h, int n, int x, int y, bool unique,
     grid = minegen(w, h, n, x, y, unique, rs);
 
     if (game_desc)
-        *game_desc = describe_layout(grid, w * h, x, y, true);
+        *game_desc = grid ? describe_layout(grid, w * h, x, y, true) : NULL;
 
     return grid;
 }
@@ -2045,7 +2127,8 @@ static const char *validate_desc(const game_params *params, const char *desc)
 static int open_square(game_state *state, int x, int y)
 {
     int w = state->w, h = state->h;
-    int xx, yy, nmines, ncovered;
+    int i, xx, yy, nmines, ncovered;
+    tdq *todo;
 
     if (!state->layout->mines) {
 	/*
@@ -2089,53 +2172,47 @@ static int open_square(game_state *state, int x, int y)
     /*
      * Otherwise, the player has opened a safe square. Mark it to-do.
      */
+    todo = tdq_new(w*h);
     state->grid[y*w+x] = -10;	       /* `todo' value internal to this func */
+    tdq_add(todo, y*w+x);
 
     /*
-     * Now go through the grid finding all `todo' values and
-     * opening them. Every time one of them turns out to have no
-     * neighbouring mines, we add all its unopened neighbours to
-     * the list as well.
-     * 
-     * FIXME: We really ought to be able to do this better than
-     * using repeated N^2 scans of the grid.
+     * Now open each to-do square in turn. Every time one of them
+     * turns out to have no neighbouring mines, we add all its
+     * unopened neighbours to the queue as well, so each square is
+     * visited at most once however large the empty region.
      */
-    while (1) {
-	bool done_something = false;
+    while ((i = tdq_remove(todo)) >= 0) {
+	int dx, dy, v;
 
-	for (yy = 0; yy < h; yy++)
-	    for (xx = 0; xx < w; xx++)
-		if (state->grid[yy*w+xx] == -10) {
-		    int dx, dy, v;
-
-		    assert(!state->layout->mines[yy*w+xx]);
+	xx = i % w;
+	yy = i / w;
+	assert(state->grid[i] == -10);
+	assert(!state->layout->mines[i]);
 
-		    v = 0;
+	v = 0;
 
-		    for (dx = -1; dx <= +1; dx++)
-			for (dy = -1; dy <= +1; dy++)
-			    if (xx+dx >= 0 && xx+dx < state->w &&
-				yy+dy >= 0 && yy+dy < state->h &&
-				state->layout->mines[(yy+dy)*w+(xx+dx)])
-				v++;
-
-		    state->grid[yy*w+xx] = v;
-
-		    if (v == 0) {
-			for (dx = -1; dx <= +1; dx++)
-			    for (dy = -1; dy <= +1; dy++)
-				if (xx+dx >= 0 && xx+dx < state->w &&
-				    yy+dy >= 0 && yy+dy < state->h &&
-				    state->grid[(yy+dy)*w+(xx+dx)] == -2)
-				    state->grid[(yy+dy)*w+(xx+dx)] = -10;
-		    }
+	for (dx = -1; dx <= +1; dx++)
+	    for (dy = -1; dy <= +1; dy++)
+		if (xx+dx >= 0 && xx+dx < state->w &&
+		    yy+dy >= 0 && yy+dy < state->h &&
+		    state->layout->mines[(yy+dy)*w+(xx+dx)])
+		    v++;
 
-		    done_something = true;
-		}
+	state->grid[i] = v;
 
-	if (!done_something)
-	    break;
+	if (v == 0) {
+	    for (dx = -1; dx <= +1; dx++)
+		for (dy = -1; dy <= +1; dy++)
+		    if (xx+dx >= 0 && xx+dx < state->w &&
+			yy+dy >= 0 && yy+dy < state->h &&
+			state->grid[(yy+dy)*w+(xx+dx)] == -2) {
+			state->grid[(yy+dy)*w+(xx+dx)] = -10;
+			tdq_add(todo, (yy+dy)*w+(xx+dx));
+		    }
+	}
     }
+    tdq_free(todo);
 
     /*
      * Finally, scan the grid and see if exactly as many squares
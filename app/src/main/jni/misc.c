@@ -441,4 +441,42 @@ char *button2label(int button)
     return NULL;
 }
 
+tilehash tilehash_add(tilehash h, unsigned long long v)
+{
+    h = (h ^ v) * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 29);
+}
+
+tilehash tilehash_add_bytes(tilehash h, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    unsigned long long v;
+    size_t i;
+
+    h = tilehash_add(h, len);
+    while (len > 0) {
+        v = 0;
+        for (i = 0; i < 8 && i < len; i++)
+            v |= (unsigned long long)p[i] << (8 * i);
+        h = tilehash_add(h, v);
+        p += i;
+        len -= i;
+    }
+    return h;
+}
+
+bool tilehash_update(tilehash *drawn, tilehash h)
+{
+    /* Finish mixing, then keep 0 free to mean `not drawn'. */
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    h |= 1;
+
+    if (*drawn == h)
+        return false;
+    *drawn = h;
+    return true;
+}
+
 /* vim: set shiftwidth=4 tabstop=8: */
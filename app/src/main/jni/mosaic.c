@@ -493,66 +493,85 @@ static char solve_cell(const game_params *params, struct desc_cell *desc,
 static bool solve_check(const game_params *params, struct desc_cell *desc,
                         random_state *rs, struct solution_cell **sol_return)
 {
-    int x, y, i;
+    int x, y, i, j, dx, dy;
     int board_size = params->height * params->width;
     struct solution_cell *sol = snewn(board_size, struct solution_cell),
         *curr_sol;
     bool made_progress = true, error = false;
     int solved = 0, curr = 0, shown = 0;
-    needed_list_item *head = NULL, *curr_needed, **needed_array;
-    struct desc_cell *curr_desc;
+    int *order = snewn(board_size, int), *order_pos;
+    bitgrid *dirty;
 
     memset(sol, 0, board_size * sizeof(*sol));
-    for (y = 0; y < params->height; y++) {
-        for (x = 0; x < params->width; x++) {
-            curr_desc = get_coords(params, desc, x, y);
-            if (curr_desc->shown) {
-                curr_needed = snew(needed_list_item);
-                curr_needed->next = head;
-                head = curr_needed;
-                curr_needed->x = x;
-                curr_needed->y = y;
-                shown++;
-            }
+    /* The clues in the order they're tried, last square first unless
+     * shuffled. */
+    for (i = board_size; i-- > 0;) {
+        if (desc[i].shown) {
+            order[shown++] = i;
         }
     }
-    needed_array = snewn(shown, needed_list_item *);
-    curr_needed = head;
-    i = 0;
-    while (curr_needed) {
-        needed_array[i] = curr_needed;
-        curr_needed = curr_needed->next;
-        i++;
-    }
     if (rs) {
-        shuffle(needed_array, shown, sizeof(*needed_array), rs);
+        shuffle(order, shown, sizeof(*order), rs);
+    }
+
+    /*
+     * Each pass tries the clues in the same order, but a clue can
+     * only make progress if something in its 3x3 neighbourhood has
+     * changed since it was last tried, so we only try the ones marked
+     * in 'dirty' (indexed by position in 'order'), which makes no
+     * difference to the outcome. When a clue makes progress, the
+     * clues which might now be able to are those within two squares
+     * of it.
+     */
+    order_pos = snewn(board_size, int);
+    for (i = 0; i < board_size; i++) {
+        order_pos[i] = -1;
+    }
+    for (i = 0; i < shown; i++) {
+        order_pos[order[i]] = i;
+    }
+    dirty = bitgrid_new(max(shown, 1), 1);
+    for (i = 0; i < shown; i++) {
+        bitgrid_set(dirty, i, 0, true);
     }
+
     solved = 0;
     while (solved < shown && made_progress && !error) {
         made_progress = false;
-        for (i = 0; i < shown; i++) {
-            curr = solve_cell(params, desc, NULL, sol, needed_array[i]->x,
-                              needed_array[i]->y);
+        for (i = bitgrid_row_next(dirty, 0, 0); i >= 0;
+             i = bitgrid_row_next(dirty, 0, i + 1)) {
+            x = order[i] % params->width;
+            y = order[i] / params->width;
+            bitgrid_set(dirty, i, 0, false);
+            curr = solve_cell(params, desc, NULL, sol, x, y);
             if (curr < 0) {
                 error = true;
 #ifdef DEBUG_PRINTS
-                printf("error in cell x=%d, y=%d\n", needed_array[i]->x,
-                       needed_array[i]->y);
+                printf("error in cell x=%d, y=%d\n", x, y);
 #endif
                 break;
             }
             if (curr > 0) {
                 solved++;
                 made_progress = true;
+                for (dy = -2; dy <= 2; dy++) {
+                    for (dx = -2; dx <= 2; dx++) {
+                        if (x + dx < 0 || x + dx >= params->width ||
+                            y + dy < 0 || y + dy >= params->height) {
+                            continue;
+                        }
+                        j = order_pos[(y + dy) * params->width + x + dx];
+                        if (j >= 0) {
+                            bitgrid_set(dirty, j, 0, true);
+                        }
+                    }
+                }
             }
         }
     }
-    while (head) {
-        curr_needed = head;
-        head = curr_needed->next;
-        sfree(curr_needed);
-    }
-    sfree(needed_array);
+    bitgrid_free(dirty);
+    sfree(order_pos);
+    sfree(order);
     solved = 0;
     /* verifying all the board is solved */
     if (made_progress) {
@@ -1148,6 +1148,12 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 
     begin_generation:
 
+    if (random_cancelled(rs)) {
+        sfree(tiles);
+        sfree(barriers);
+        return NULL;
+    }
+
     memset(tiles, 0, w * h);
     memset(barriers, 0, w * h);
 
@@ -1897,26 +1903,25 @@ static char *game_text_format(const game_state *state)
 static unsigned char *compute_active(const game_state *state, int cx, int cy)
 {
     unsigned char *active;
-    tree234 *todo;
-    struct xyd *xyd;
+    int *todo, ntodo = 0;
 
     active = snewn(state->width * state->height, unsigned char);
     memset(active, 0, state->width * state->height);
 
     /*
-     * We only store (x,y) pairs in todo, but it's easier to reuse
-     * xyd_cmp and just store direction 0 every time.
+     * todo is a stack of square indices still to be examined. Each
+     * square goes on it at most once, when it is first marked active,
+     * so it never needs more room than there are squares.
      */
-    todo = newtree234(xyd_cmp_nc);
+    todo = snewn(state->width * state->height, int);
     index(state, active, cx, cy) = ACTIVE;
-    add234(todo, new_xyd(cx, cy, 0));
+    todo[ntodo++] = cy * state->width + cx;
 
-    while ( (xyd = delpos234(todo, 0)) != NULL) {
+    while (ntodo > 0) {
 	int x1, y1, d1, x2, y2, d2;
 
-	x1 = xyd->x;
-	y1 = xyd->y;
-	sfree(xyd);
+	x1 = todo[--ntodo] % state->width;
+	y1 = todo[ntodo] / state->width;
 
 	for (d1 = 1; d1 < 0x10; d1 <<= 1) {
 	    OFFSET(x2, y2, x1, y1, d1, state);
@@ -1933,13 +1938,11 @@ static unsigned char *compute_active(const game_state *state, int cx, int cy)
 		!(barrier(state, x1, y1) & d1) &&
 		!index(state, active, x2, y2)) {
 		index(state, active, x2, y2) = ACTIVE;
-		add234(todo, new_xyd(x2, y2, 0));
+		todo[ntodo++] = y2 * state->width + x2;
 	    }
 	}
     }
-    /* Now we expect the todo list to have shrunk to zero size. */
-    assert(count234(todo) == 0);
-    freetree234(todo);
+    sfree(todo);
 
     return active;
 }
@@ -2019,11 +2022,6 @@ static int *compute_loops_inner(int w, int h, bool wrapping,
     return loops;
 }
 
-static int *compute_loops(const game_state *state)
-{
-    return compute_loops_inner(state->width, state->height, state->wrapping,
-                               state->tiles, state->imm->barriers);
-}
 
 struct game_ui {
     int org_x, org_y; /* origin */
@@ -2091,8 +2089,92 @@ struct game_drawstate {
     int width, height;
     int tilesize;
     unsigned long *visible, *to_draw;
+
+    /*
+     * Loop highlighting for the last state drawn. 'looptiles' holds
+     * the connections the loops were found for (tiles less barriers),
+     * so that after a rotation only the edges that changed need be
+     * passed to findloop.
+     */
+    bool loops_valid;
+    unsigned char *looptiles;
+    struct findloopstate *fls;
+    int *loops;
 };
 
+/* More changed squares than this and we just run findloop afresh. */
+#define MAX_LOOP_UPDATES 4
+
+static bool loop_edge_exists(const game_drawstate *ds, int v, int dir,
+                             int *v1)
+{
+    int x1, y1;
+
+    OFFSETWH(x1, y1, v % ds->width, v / ds->width, dir,
+             ds->width, ds->height);
+    *v1 = y1 * ds->width + x1;
+    return (ds->looptiles[v] & dir) && (ds->looptiles[*v1] & F(dir));
+}
+
+/* Change one square of ds->looptiles, keeping ds->fls in step. */
+static bool update_loop_square(game_drawstate *ds, int v, unsigned char t)
+{
+    int wh = ds->width * ds->height, dir, v1;
+    unsigned char old = ds->looptiles[v];
+    bool ok = true;
+
+    for (dir = 1; dir < 0x10; dir <<= 1)
+        if ((old & ~t & dir) && loop_edge_exists(ds, v, dir, &v1))
+            ok = ok && findloop_remove_edge(ds->fls, wh, v, v1);
+    ds->looptiles[v] = t;
+    for (dir = 1; dir < 0x10; dir <<= 1)
+        if ((t & ~old & dir) && loop_edge_exists(ds, v, dir, &v1))
+            ok = ok && findloop_add_edge(ds->fls, wh, v, v1);
+    return ok;
+}
+
+static const int *update_loops(game_drawstate *ds, const game_state *state)
+{
+    int w = state->width, h = state->height, wh = w*h;
+    int i, nchanged = 0, dir, v1;
+    bool ok;
+
+    /* A wrapping grid this narrow has doubled edges and self-loops,
+     * which the incremental updates don't cope with. */
+    ok = ds->loops_valid && !(state->wrapping && (w < 3 || h < 3));
+    for (i = 0; ok && i < wh; i++) {
+        unsigned char t = state->tiles[i] & 0xF & ~state->imm->barriers[i];
+        if (t != ds->looptiles[i])
+            ok = (++nchanged <= MAX_LOOP_UPDATES &&
+                  update_loop_square(ds, i, t));
+    }
+    if (ok && !nchanged)
+        return ds->loops;
+
+    if (!ok) {
+        struct net_neighbour_ctx ctx;
+
+        for (i = 0; i < wh; i++)
+            ds->looptiles[i] =
+                state->tiles[i] & 0xF & ~state->imm->barriers[i];
+        ctx.w = w;
+        ctx.h = h;
+        ctx.tiles = ds->looptiles;
+        ctx.barriers = NULL;
+        findloop_run(ds->fls, wh, net_neighbour, &ctx);
+        ds->loops_valid = true;
+    }
+
+    for (i = 0; i < wh; i++) {
+        ds->loops[i] = 0;
+        for (dir = 1; dir < 0x10; dir <<= 1)
+            if (loop_edge_exists(ds, i, dir, &v1) &&
+                findloop_is_loop_edge(ds->fls, i, v1))
+                ds->loops[i] |= ERR(dir);
+    }
+    return ds->loops;
+}
+
 /* ----------------------------------------------------------------------
  * Process a move.
  */
@@ -2434,9 +2516,10 @@ static game_state *execute_move(const game_state *from, const char *move)
      * For this purpose it doesn't matter where the source square is,
      * because we can start from anywhere (or, at least, any square
      * that's non-empty!), and correctly determine whether the game is
-     * completed.
+     * completed. Once it has been, it stays that way, so there's no
+     * need to look again.
      */
-    {
+    if (!ret->completed) {
 	unsigned char *active;
 	int pos;
         bool complete = true;
@@ -2483,6 +2566,11 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
     for (i = 0; i < ncells; i++)
         ds->visible[i] = -1;
 
+    ds->loops_valid = false;
+    ds->looptiles = snewn(state->width * state->height, unsigned char);
+    ds->fls = findloop_new_state(state->width * state->height);
+    ds->loops = snewn(state->width * state->height, int);
+
     return ds;
 }
 
@@ -2493,6 +2581,10 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
 static void game_free_drawstate(drawing *dr, game_drawstate *ds)
 {
     sfree(ds->visible);
+    sfree(ds->to_draw);
+    sfree(ds->looptiles);
+    findloop_free_state(ds->fls);
+    sfree(ds->loops);
     sfree(ds);
 }
 
@@ -2867,7 +2959,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
 {
     int tx, ty, dx, dy, d, dsh, last_rotate_dir, frame;
     unsigned char *active;
-    int *loops;
+    const int *loops;
     float angle = 0.0;
 
     tx = ty = -1;
@@ -2900,7 +2992,7 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
      * of barriers.
      */
     active = compute_active(state, ui->cx, ui->cy);
-    loops = compute_loops(state);
+    loops = update_loops(ds, state);
 
     for (dy = -1; dy < ds->height+1; dy++) {
         for (dx = -1; dx < ds->width+1; dx++) {
@@ -3065,7 +3157,6 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
     }
 
     sfree(active);
-    sfree(loops);
 }
 
 static float game_anim_length(const game_state *oldstate,
@@ -3309,5 +3400,6 @@ const struct game thegame = {
 #endif
     true,			       /* wants_statusbar */
     false, game_timing_state,
-    0,				       /* flags */
+    PARALLEL_NEW_DESC,		       /* flags */
+    16,				       /* undo_snapshot_stride */
 };
@@ -5,6 +5,7 @@
  */
 
 #include <stdarg.h>
+#include <time.h>
 
 #include "puzzles.h"
 
@@ -19,6 +20,11 @@ void draw_polygon(drawing *dr, const int *coords, int npoints,
                   int fillcolour, int outlinecolour) {}
 void draw_circle(drawing *dr, int cx, int cy, int radius,
                  int fillcolour, int outlinecolour) {}
+void draw_thick_polygon(drawing *dr, float thickness, int *coords,
+                        int npoints, int fillcolour, int outlinecolour) {}
+void draw_thick_circle(drawing *dr, float thickness, float cx, float cy,
+                       float radius, int fillcolour, int outlinecolour) {}
+void inertia_follow(drawing *dr, bool is_solved) {}
 char *text_fallback(drawing *dr, const char *const *strings, int nstrings)
 { return dupstr(strings[0]); }
 void clip(drawing *dr, int x, int y, int w, int h) {}
@@ -50,6 +56,14 @@ struct preset_menu *preset_menu_add_submenu(struct preset_menu *parent,
 void preset_menu_add_preset(struct preset_menu *parent,
                             char *title, game_params *params) {}
 
+void get_random_seed(void **randseed, int *randseedsize)
+{
+    time_t *tp = snew(time_t);
+    time(tp);
+    *randseed = (void *)tp;
+    *randseedsize = sizeof(time_t);
+}
+
 void fatal(const char *fmt, ...)
 {
     va_list ap;
@@ -0,0 +1,109 @@
+/*
+ * pack.c: read and write puzzle packs; see pack.h for the format.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include "puzzles.h"
+#include "pack.h"
+
+static unsigned long get_u32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+        ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+static bool put_u32(FILE *fp, unsigned long v)
+{
+    unsigned char b[4];
+
+    b[0] = v & 0xFF;
+    b[1] = (v >> 8) & 0xFF;
+    b[2] = (v >> 16) & 0xFF;
+    b[3] = (v >> 24) & 0xFF;
+    return fwrite(b, 1, 4, fp) == 4;
+}
+
+bool pack_write(FILE *fp, const char *name, const char *params,
+                char *const *descs, int n)
+{
+    unsigned long off = 0;
+    int i;
+
+    if (fwrite(PACK_MAGIC, 1, PACK_MAGIC_LEN, fp) != PACK_MAGIC_LEN ||
+        !put_u32(fp, n) ||
+        fwrite(name, 1, strlen(name) + 1, fp) != strlen(name) + 1 ||
+        fwrite(params, 1, strlen(params) + 1, fp) != strlen(params) + 1)
+        return false;
+    for (i = 0; i < n; i++) {
+        if (!put_u32(fp, off))
+            return false;
+        off += strlen(descs[i]);
+    }
+    if (!put_u32(fp, off))
+        return false;
+    for (i = 0; i < n; i++)
+        if (fwrite(descs[i], 1, strlen(descs[i]), fp) != strlen(descs[i]))
+            return false;
+    return fflush(fp) == 0;
+}
+
+const char *pack_open(pack *pk, const void *data, size_t len)
+{
+    const unsigned char *p = data, *end = p + len;
+    unsigned long count, prev, off;
+    size_t i;
+
+    if (len < PACK_MAGIC_LEN + 4 || memcmp(p, PACK_MAGIC, PACK_MAGIC_LEN))
+        return "Not a puzzle pack";
+    p += PACK_MAGIC_LEN;
+    count = get_u32(p);
+    p += 4;
+
+    pk->name = (const char *)p;
+    p = memchr(p, '\0', end - p);
+    if (!p)
+        return "Puzzle pack header is truncated";
+    pk->params = (const char *)++p;
+    p = memchr(p, '\0', end - p);
+    if (!p)
+        return "Puzzle pack header is truncated";
+    p++;
+
+    if (count > INT_MAX || count >= (size_t)(end - p) / 4)
+        return "Puzzle pack index is truncated";
+    pk->count = (int)count;
+    pk->offsets = p;
+    pk->descs = (const char *)(p + 4 * (count + 1));
+
+    /* Every desc must lie within the file, in order. */
+    prev = 0;
+    for (i = 0; i <= count; i++) {
+        off = get_u32(p + 4 * i);
+        if (off < prev)
+            return "Puzzle pack index is corrupt";
+        prev = off;
+    }
+    if (prev > (size_t)(end - (const unsigned char *)pk->descs))
+        return "Puzzle pack is truncated";
+    return NULL;
+}
+
+char *pack_game_id(const pack *pk, int i)
+{
+    unsigned long start, dlen;
+    size_t plen = strlen(pk->params);
+    char *ret;
+
+    assert(i >= 0 && i < pk->count);
+    start = get_u32(pk->offsets + 4 * i);
+    dlen = get_u32(pk->offsets + 4 * (i + 1)) - start;
+    ret = snewn(plen + dlen + 2, char);
+    memcpy(ret, pk->params, plen);
+    ret[plen] = ':';
+    memcpy(ret + plen + 1, pk->descs + start, dlen);
+    ret[plen + 1 + dlen] = '\0';
+    return ret;
+}
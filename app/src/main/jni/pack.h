@@ -0,0 +1,61 @@
+/*
+ * pack.h: header defining functions in pack.c.
+ *
+ * A puzzle pack is a file of pre-generated game descriptions for one
+ * game and one set of parameters, so that a front end can offer
+ * puzzles that would be slow to generate on the spot. Any entry can
+ * be found in constant time without reading the others, so a pack
+ * can be mapped into memory and used in place.
+ *
+ * Layout, with all integers 32-bit little-endian:
+ *
+ *   "SGTPACK1"                 8-byte magic
+ *   count                      number of entries
+ *   game name, NUL-terminated
+ *   params, NUL-terminated     fully encoded, as for a game ID
+ *   offset[0..count]           start of each desc within the desc
+ *                              area, plus its end as offset[count]
+ *   desc area                  the descs, with no separators
+ *
+ * Entry i is then "params:desc" as a game ID for that game, with
+ * desc being offset[i+1] - offset[i] bytes from offset[i].
+ */
+
+#ifndef PACK_H
+#define PACK_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define PACK_MAGIC "SGTPACK1"
+#define PACK_MAGIC_LEN 8
+
+typedef struct pack {
+    const char *name, *params;
+    int count;
+    const unsigned char *offsets;
+    const char *descs;
+} pack;
+
+/*
+ * Write a pack holding n descs to fp. Returns false on a write
+ * error.
+ */
+bool pack_write(FILE *fp, const char *name, const char *params,
+                char *const *descs, int n);
+
+/*
+ * Check that the len bytes at data are a well-formed pack, and if
+ * so fill in pk to point into them. Returns NULL on success, or an
+ * error message. Nothing is copied, so data must outlive pk.
+ */
+const char *pack_open(pack *pk, const void *data, size_t len);
+
+/*
+ * Return the game ID ("params:desc") of entry i of a pack, in a
+ * freshly allocated string.
+ */
+char *pack_game_id(const pack *pk, int i);
+
+#endif /* PACK_H */
@@ -183,7 +183,13 @@ typedef struct solver_ctx {
     const game_params *params;  /* also in shared_state */
     clue *clues;                /* also in shared_state */
     borderflag *borders;        /* also in game_state */
-    int *dsf;                   /* particular to the solver */
+    DSF *dsf;                   /* particular to the solver */
+    /* The same information as the dsf, packed per square as BORDER()
+     * bits: `joined' has the edges whose squares share a region, and
+     * `open' the edges that are neither joined nor borders yet. */
+    borderflag *joined, *open;
+    int *next;                  /* each region's squares, as a cycle */
+    int *outs;                  /* scratch for solver_not_too_small */
 } solver_ctx;
 
 /* Deductions:
@@ -262,15 +268,47 @@ static const int bitcount[16] = {0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4};
 
 #define COMPUTE_J (-1)
 
+#define OUT_OF_BOUNDS(x, y, w, h) \
+    ((x) < 0 || (x) >= (w) || (y) < 0 || (y) >= (h))
+
 static void connect(solver_ctx *ctx, int i, int j)
 {
-    dsf_merge(ctx->dsf, i, j);
+    int w = ctx->params->w, h = ctx->params->h, m, dir, tmp;
+
+    i = dsf_find(ctx->dsf, i);
+    j = dsf_find(ctx->dsf, j);
+    if (i == j) return;
+    if (dsf_class_size(ctx->dsf, i) > dsf_class_size(ctx->dsf, j)) {
+        tmp = i; i = j; j = tmp;
+    }
+
+    /* walk the smaller region, joining every edge it shares with
+     * the larger one */
+    m = i;
+    do {
+        for (dir = 0; dir < 4; ++dir) {
+            int x = m % w + dx[dir], y = m / w + dy[dir], mm = y*w + x;
+            if (OUT_OF_BOUNDS(x, y, w, h)) continue;
+            if (dsf_find(ctx->dsf, mm) != j) continue;
+            ctx->joined[m] |= BORDER(dir);
+            ctx->joined[mm] |= BORDER(FLIP(dir));
+            ctx->open[m] &= ~BORDER(dir);
+            ctx->open[mm] &= ~BORDER(FLIP(dir));
+        }
+        m = ctx->next[m];
+    } while (m != i);
+
+    dsf_union(ctx->dsf, i, j);
+    tmp = ctx->next[i];
+    ctx->next[i] = ctx->next[j];
+    ctx->next[j] = tmp;
 }
 
 static bool connected(solver_ctx *ctx, int i, int j, int dir)
 {
-    if (j == COMPUTE_J) j = i + dx[dir] + ctx->params->w*dy[dir];
-    return dsf_canonify(ctx->dsf, i) == dsf_canonify(ctx->dsf, j);
+    if (dir < 0) return dsf_equivalent(ctx->dsf, i, j);
+    assert (j == COMPUTE_J || j == i + dx[dir] + ctx->params->w*dy[dir]);
+    return ctx->joined[i] & BORDER(dir);
 }
 
 static void disconnect(solver_ctx *ctx, int i, int j, int dir)
@@ -278,6 +316,8 @@ static void disconnect(solver_ctx *ctx, int i, int j, int dir)
     if (j == COMPUTE_J) j = i + dx[dir] + ctx->params->w*dy[dir];
     ctx->borders[i] |= BORDER(dir);
     ctx->borders[j] |= BORDER(FLIP(dir));
+    ctx->open[i] &= ~BORDER(dir);
+    ctx->open[j] &= ~BORDER(FLIP(dir));
 }
 
 static bool disconnected(solver_ctx *ctx, int i, int j, int dir)
@@ -289,9 +329,7 @@ static bool disconnected(solver_ctx *ctx, int i, int j, int dir)
 static bool maybe(solver_ctx *ctx, int i, int j, int dir)
 {
     assert (j == COMPUTE_J || j == i + dx[dir] + ctx->params->w*dy[dir]);
-    return !disconnected(ctx, i, j, dir) && !connected(ctx, i, j, dir);
-    /* the ordering is important: disconnected works for invalid
-     * squares (i.e. out of bounds), connected doesn't. */
+    return ctx->open[i] & BORDER(dir);
 }
 
 static void solver_connected_clues_versus_region_size(solver_ctx *ctx)
@@ -326,7 +364,7 @@ static bool solver_number_exhausted(solver_ctx *ctx)
     bool changed = false;
 
     for (i = 0; i < wh; ++i) {
-        if (ctx->clues[i] == EMPTY) continue;
+        if (ctx->clues[i] == EMPTY || !ctx->open[i]) continue;
 
         if (bitcount[(ctx->borders[i] & BORDER_MASK)] == ctx->clues[i]) {
             for (dir = 0; dir < 4; ++dir) {
@@ -338,11 +376,7 @@ static bool solver_number_exhausted(solver_ctx *ctx)
             continue;
         }
 
-        for (off = dir = 0; dir < 4; ++dir) {
-            int j = i + dx[dir] + w*dy[dir];
-            if (!disconnected(ctx, i, j, dir) && connected(ctx, i, j, dir))
-                ++off; /* ^^^ bounds checking before ^^^^^ */
-        }
+        off = bitcount[ctx->joined[i] & ~ctx->borders[i] & BORDER_MASK];
 
         if (ctx->clues[i] == 4 - off)
             for (dir = 0; dir < 4; ++dir) {
@@ -362,11 +396,14 @@ static bool solver_not_too_big(solver_ctx *ctx)
     bool changed = false;
 
     for (i = 0; i < wh; ++i) {
-        int size = dsf_size(ctx->dsf, i);
+        int size;
+        if (!ctx->open[i]) continue;
+        size = dsf_class_size(ctx->dsf, i);
         for (dir = 0; dir < 4; ++dir) {
             int j = i + dx[dir] + w*dy[dir];
             if (!maybe(ctx, i, j, dir)) continue;
-            if (size + dsf_size(ctx->dsf, j) <= ctx->params->k) continue;
+            if (size + dsf_class_size(ctx->dsf, j) <= ctx->params->k)
+                continue;
             disconnect(ctx, i, j, dir);
             changed = true;
         }
@@ -378,32 +415,34 @@ static bool solver_not_too_big(solver_ctx *ctx)
 static bool solver_not_too_small(solver_ctx *ctx)
 {
     int w = ctx->params->w, h = ctx->params->h, wh = w*h, i, dir;
-    int *outs, k = ctx->params->k, ci;
+    int *outs = ctx->outs, k = ctx->params->k, ci;
     bool changed = false;
 
-    snewa(outs, wh);
     setmem(outs, -1, wh);
 
     for (i = 0; i < wh; ++i) {
-        ci = dsf_canonify(ctx->dsf, i);
-        if (dsf_size(ctx->dsf, ci) == k) continue;
+        if (!ctx->open[i]) continue;
+        ci = dsf_find(ctx->dsf, i);
+        if (dsf_class_size(ctx->dsf, ci) == k) continue;
         for (dir = 0; dir < 4; ++dir) {
             int j = i + dx[dir] + w*dy[dir];
             if (!maybe(ctx, i, j, dir)) continue;
-            if (outs[ci] == -1) outs[ci] = dsf_canonify(ctx->dsf, j);
-            else if (outs[ci] != dsf_canonify(ctx->dsf, j)) outs[ci] = -2;
+            if (outs[ci] == -1) outs[ci] = dsf_find(ctx->dsf, j);
+            else if (outs[ci] != dsf_find(ctx->dsf, j)) outs[ci] = -2;
         }
     }
 
+    /* Regions are indexed by root, but grown in order of their
+     * smallest square, as they always have been. */
     for (i = 0; i < wh; ++i) {
-        int j = outs[i];
-        if (i != dsf_canonify(ctx->dsf, i)) continue;
+        int j;
+        if (i != dsf_minimal(ctx->dsf, i)) continue;
+        j = outs[dsf_find(ctx->dsf, i)];
         if (j < 0) continue;
         connect(ctx, i, j); /* only one place for i to grow */
         changed = true;
     }
 
-    sfree(outs);
     return changed;
 }
 
@@ -469,6 +508,7 @@ static bool solver_equivalent_edges(solver_ctx *ctx)
     for (i = 0; i < wh; ++i) {
         int n_on = 0, n_off = 0;
         if (ctx->clues[i] < 1 || ctx->clues[i] > 3) continue;
+        if (bitcount[ctx->open[i]] < 2) continue;
 
         if (ctx->clues[i] == 2 /* don't need it otherwise */)
             for (dirj = 0; dirj < 4; ++dirj) {
@@ -572,14 +612,23 @@ error:
 
 static bool solver(const game_params *params, clue *clues, borderflag *borders)
 {
-    int w = params->w, h = params->h, wh = w*h;
+    int w = params->w, h = params->h, wh = w*h, i;
     bool changed;
     solver_ctx ctx;
 
     ctx.params = params;
     ctx.clues = clues;
     ctx.borders = borders;
-    ctx.dsf = snew_dsf(wh);
+    ctx.dsf = dsf_new(wh);
+    snewa(ctx.joined, wh);
+    snewa(ctx.open, wh);
+    snewa(ctx.next, wh);
+    snewa(ctx.outs, wh);
+    for (i = 0; i < wh; ++i) {
+        ctx.joined[i] = 0;
+        ctx.open[i] = ~borders[i] & BORDER_MASK;
+        ctx.next[i] = i;
+    }
 
     solver_connected_clues_versus_region_size(&ctx); /* idempotent */
     do {
@@ -591,7 +640,11 @@ static bool solver(const game_params *params, clue *clues, borderflag *borders)
         changed |= solver_equivalent_edges(&ctx);
     } while (changed);
 
-    sfree(ctx.dsf);
+    dsf_free(ctx.dsf);
+    sfree(ctx.joined);
+    sfree(ctx.open);
+    sfree(ctx.next);
+    sfree(ctx.outs);
 
     return is_solved(params, clues, borders);
 }
@@ -612,9 +665,6 @@ static void init_borders(int w, int h, borderflag *borders)
     }
 }
 
-#define OUT_OF_BOUNDS(x, y, w, h) \
-    ((x) < 0 || (x) >= (w) || (y) < 0 || (y) >= (h))
-
 #define xshuffle(ptr, len, rs) shuffle((ptr), (len), sizeof (ptr)[0], (rs))
 
 static char *new_game_desc(const game_params *params, random_state *rs,
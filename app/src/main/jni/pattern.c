@@ -363,73 +363,332 @@ static int compute_rowdata(int *ret, unsigned char *start, int len, int step)
 bool verbose = false;
 #endif
 
-static bool do_recurse(unsigned char *known, unsigned char *deduced,
-                       unsigned char *row,
-		       unsigned char *minpos_done, unsigned char *maxpos_done,
-		       unsigned char *minpos_ok, unsigned char *maxpos_ok,
-		       int *data, int len,
-                       int freespace, int ndone, int lowest)
+/*
+ * Rows and columns up to this long are solved by do_line_bits, using
+ * one machine word per set of positions 0..len.
+ */
+typedef uint64_t line_bits;
+#define LINE_BITS_MAX 63
+
+/*
+ * Scratch space for do_row, big enough for the longest row or column
+ * of the puzzle.
+ */
+struct line_workspace {
+    int max;
+    unsigned char *known, *deduced;
+    unsigned char *before, *after;
+    int *dots, *cover;
+    line_bits *before_bits, *after_bits;
+};
+
+static struct line_workspace *new_line_workspace(int max)
+{
+    struct line_workspace *lw = snew(struct line_workspace);
+    int tablesize = ((max + 1) / 2 + 1) * (max + 1);
+
+    lw->max = max;
+    lw->known = snewn(max, unsigned char);
+    lw->deduced = snewn(max, unsigned char);
+    lw->before = snewn(tablesize, unsigned char);
+    lw->after = snewn(tablesize, unsigned char);
+    lw->dots = snewn(max + 1, int);
+    lw->cover = snewn(max + 1, int);
+    lw->before_bits = snewn((max + 1) / 2 + 1, line_bits);
+    lw->after_bits = snewn((max + 1) / 2 + 1, line_bits);
+    return lw;
+}
+
+static void free_line_workspace(struct line_workspace *lw)
+{
+    sfree(lw->known);
+    sfree(lw->deduced);
+    sfree(lw->before);
+    sfree(lw->after);
+    sfree(lw->dots);
+    sfree(lw->cover);
+    sfree(lw->before_bits);
+    sfree(lw->after_bits);
+    sfree(lw);
+}
+
+/*
+ * Work out, for every square of a row or column, whether it can be
+ * BLOCK and whether it can be DOT in some layout of the runs in
+ * data[] which agrees with known[]. Each of those goes into deduced[]
+ * as a bit, so a square which could be either ends up STILL_UNKNOWN,
+ * and if the row can't be laid out at all, nothing gets set.
+ *
+ * Rather than trying every layout, this works from both ends at once.
+ * before[j][i] says whether the first i squares can hold exactly the
+ * first j runs, and after[j][i] whether the squares from i onwards can
+ * hold exactly runs j onwards. Then a square can be DOT if the runs
+ * either side of it can be split between before and after, and run j
+ * can start at square s if the squares it needs are free of DOTs and
+ * the runs before and after it fit round it with a gap either side.
+ * That takes time proportional to the row length times the number
+ * of runs.
+ */
+static void do_line_bytes(struct line_workspace *lw, const int *data,
+                          int len)
 {
-    int i, j, k;
-
-    /* This algorithm basically tries all possible ways the given rows of
-     * black blocks can be laid out in the row/column being examined.
-     * Special care is taken to avoid checking the tail of a row/column
-     * if the same conditions have already been checked during this recursion
-     * The algorithm also takes care to cut its losses as soon as an
-     * invalid (partial) solution is detected.
+    const unsigned char *known = lw->known;
+    unsigned char *deduced = lw->deduced;
+    int *dots = lw->dots, *cover = lw->cover;
+    int nruns, i, j, s, w = len + 1;
+
+#define BEFORE(j, i) (lw->before[(j) * w + (i)])
+#define AFTER(j, i) (lw->after[(j) * w + (i)])
+/* Whether squares [a,b) contain no known DOT */
+#define NODOTS(a, b) (dots[b] == dots[a])
+
+    for (nruns = 0; data[nruns]; nruns++);
+
+    dots[0] = 0;
+    for (i = 0; i < len; i++)
+        dots[i+1] = dots[i] + (known[i] == DOT);
+
+    BEFORE(0, 0) = true;
+    for (i = 1; i <= len; i++)
+        BEFORE(0, i) = BEFORE(0, i-1) && known[i-1] != BLOCK;
+    for (j = 1; j <= nruns; j++) {
+        int runlen = data[j-1];
+        for (i = 0; i <= len; i++) {
+            bool ok = i > 0 && known[i-1] != BLOCK && BEFORE(j, i-1);
+            s = i - runlen;
+            if (!ok && s >= 0 && NODOTS(s, i)) {
+                if (s == 0)
+                    ok = (j == 1);
+                else
+                    ok = known[s-1] != BLOCK && BEFORE(j-1, s-1);
+            }
+            BEFORE(j, i) = ok;
+        }
+    }
+
+    for (i = 0; i < len; i++)
+        deduced[i] = 0;
+    if (!BEFORE(nruns, len))
+        return;                        /* no layout at all */
+
+    AFTER(nruns, len) = true;
+    for (i = len-1; i >= 0; i--)
+        AFTER(nruns, i) = AFTER(nruns, i+1) && known[i] != BLOCK;
+    for (j = nruns-1; j >= 0; j--) {
+        int runlen = data[j];
+        for (i = len; i >= 0; i--) {
+            bool ok = i < len && known[i] != BLOCK && AFTER(j, i+1);
+            s = i + runlen;
+            if (!ok && s <= len && NODOTS(i, s)) {
+                if (s == len)
+                    ok = (j == nruns-1);
+                else
+                    ok = known[s] != BLOCK && AFTER(j+1, s+1);
+            }
+            AFTER(j, i) = ok;
+        }
+    }
+
+    for (i = 0; i < len; i++) {
+        if (known[i] == BLOCK)
+            continue;
+        for (j = 0; j <= nruns; j++)
+            if (BEFORE(j, i) && AFTER(j, i+1)) {
+                deduced[i] |= DOT;
+                break;
+            }
+    }
+
+    /*
+     * cover[] counts, as a running total of starts minus ends, how
+     * many possible run placements include each square.
      */
-    if (data[ndone]) {
-	if (lowest >= minpos_done[ndone] && lowest <= maxpos_done[ndone]) {
-	    if (lowest >= minpos_ok[ndone] && lowest <= maxpos_ok[ndone]) {
-		for (i=0; i<lowest; i++)
-		    deduced[i] |= row[i];
-	    }
-	    return lowest >= minpos_ok[ndone] && lowest <= maxpos_ok[ndone];
-	} else {
-	    if (lowest < minpos_done[ndone]) minpos_done[ndone] = lowest;
-	    if (lowest > maxpos_done[ndone]) maxpos_done[ndone] = lowest;
-	}
-	for (i=0; i<=freespace; i++) {
-	    j = lowest;
-	    for (k=0; k<i; k++) {
-		if (known[j] == BLOCK) goto next_iter;
-	        row[j++] = DOT;
-	    }
-	    for (k=0; k<data[ndone]; k++) {
-		if (known[j] == DOT) goto next_iter;
-	        row[j++] = BLOCK;
-	    }
-	    if (j < len) {
-		if (known[j] == BLOCK) goto next_iter;
-	        row[j++] = DOT;
-	    }
-	    if (do_recurse(known, deduced, row, minpos_done, maxpos_done,
-	                   minpos_ok, maxpos_ok, data, len, freespace-i, ndone+1, j)) {
-	        if (lowest < minpos_ok[ndone]) minpos_ok[ndone] = lowest;
-	        if (lowest + i > maxpos_ok[ndone]) maxpos_ok[ndone] = lowest + i;
-	        if (lowest + i > maxpos_done[ndone]) maxpos_done[ndone] = lowest + i;
-	    }
-	    next_iter:
-	    j++;
-	}
-	return lowest >= minpos_ok[ndone] && lowest <= maxpos_ok[ndone];
-    } else {
-	for (i=lowest; i<len; i++) {
-	    if (known[i] == BLOCK) return false;
-	    row[i] = DOT;
-	    }
-	for (i=0; i<len; i++)
-	    deduced[i] |= row[i];
-	return true;
+    for (i = 0; i <= len; i++)
+        cover[i] = 0;
+    for (j = 0; j < nruns; j++) {
+        int runlen = data[j];
+        for (s = 0; s + runlen <= len; s++) {
+            if (!NODOTS(s, s + runlen))
+                continue;
+            if (s == 0 ? j != 0 :
+                known[s-1] == BLOCK || !BEFORE(j, s-1))
+                continue;
+            if (s + runlen == len ? j != nruns-1 :
+                known[s+runlen] == BLOCK || !AFTER(j+1, s+runlen+1))
+                continue;
+            cover[s]++;
+            cover[s + runlen]--;
+        }
+    }
+    for (i = 0, s = 0; i < len; i++) {
+        s += cover[i];
+        if (s)
+            deduced[i] |= BLOCK;
     }
+
+#undef BEFORE
+#undef AFTER
+#undef NODOTS
 }
 
+/*
+ * Helpers for do_line_bits, in which bit i of a line_bits stands for
+ * position i along the row.
+ */
+
+/* The bits i such that bits i..i+n-1 of x are all set. */
+static line_bits line_all(line_bits x, int n)
+{
+    int have = 1;
 
-static bool do_row(unsigned char *known, unsigned char *deduced,
-                   unsigned char *row,
-                   unsigned char *minpos_done, unsigned char *maxpos_done,
-                   unsigned char *minpos_ok, unsigned char *maxpos_ok,
+    while (have * 2 <= n) {
+        x &= x >> have;
+        have *= 2;
+    }
+    if (have < n)
+        x &= x >> (n - have);
+    return x;
+}
+
+/* x with every set bit i extended to cover bits i..i+n-1. */
+static line_bits line_smear(line_bits x, int n)
+{
+    int have = 1;
+
+    while (have * 2 <= n) {
+        x |= x << have;
+        have *= 2;
+    }
+    if (have < n)
+        x |= x << (n - have);
+    return x;
+}
+
+/*
+ * The bits i for which there is a bit i0 <= i set in seeds, and bits
+ * i0..i-1 are all set in through. Adding the seeds to through carries
+ * from the lowest seed in each run of ones in through to the top of
+ * that run, and the bits that change are the ones wanted, apart from
+ * any further seeds in the run, which the carry passes over without
+ * changing.
+ */
+static line_bits line_spread(line_bits seeds, line_bits through)
+{
+    line_bits s = seeds & through;
+    return seeds | (((((through + s) ^ through) | s) & through) << 1);
+}
+
+/* Bits 0..n-1 of x in reverse order. */
+static line_bits line_reverse(line_bits x, int n)
+{
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    x = ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+    x = ((x >> 16) & 0x0000FFFF0000FFFFULL) |
+        ((x & 0x0000FFFF0000FFFFULL) << 16);
+    x = (x >> 32) | (x << 32);
+    return x >> (64 - n);
+}
+
+/*
+ * Fill in before[j] for each j, as a set of positions i in the same
+ * sense as do_line_bytes's before table, given which squares aren't
+ * known to be BLOCK and which aren't known to be DOT.
+ */
+static void line_before(line_bits *before, const int *data, int nruns,
+                        line_bits notblock, line_bits notdot,
+                        bool reversed)
+{
+    int j;
+
+    before[0] = line_spread(1, notblock);
+    for (j = 1; j <= nruns; j++) {
+        int runlen = data[reversed ? nruns - j : j-1];
+        line_bits starts = (before[j-1] & notblock) << 1;
+        if (j == 1)
+            starts |= 1;
+        starts &= line_all(notdot, runlen);
+        before[j] = line_spread(starts << runlen, notblock);
+    }
+}
+
+/*
+ * The same as do_line_bytes, but working on whole rows at once with
+ * bitwise operations, which takes time proportional only to the
+ * number of runs.
+ */
+static void do_line_bits(struct line_workspace *lw, const int *data,
+                         int len)
+{
+    const unsigned char *known = lw->known;
+    unsigned char *deduced = lw->deduced;
+    line_bits *before = lw->before_bits, *after = lw->after_bits;
+    line_bits notblock = 0, notdot = 0, canblock = 0, candot = 0;
+    int nruns, i, j;
+
+    for (nruns = 0; data[nruns]; nruns++);
+
+    for (i = 0; i < len; i++) {
+        if (known[i] != BLOCK)
+            notblock |= (line_bits)1 << i;
+        if (known[i] != DOT)
+            notdot |= (line_bits)1 << i;
+    }
+
+    for (i = 0; i < len; i++)
+        deduced[i] = 0;
+
+    line_before(before, data, nruns, notblock, notdot, false);
+    if (!(before[nruns] & ((line_bits)1 << len)))
+        return;                        /* no layout at all */
+
+    /*
+     * The after table is the before table of the row backwards,
+     * turned round again: after[j] has bit i set if the squares from
+     * i onwards can hold exactly runs j onwards.
+     */
+    line_before(after, data, nruns, line_reverse(notblock, len),
+                line_reverse(notdot, len), true);
+    for (j = 0; j <= nruns / 2; j++) {
+        line_bits lo = line_reverse(after[j], len + 1);
+        after[j] = line_reverse(after[nruns - j], len + 1);
+        after[nruns - j] = lo;
+    }
+
+    for (j = 0; j <= nruns; j++)
+        candot |= before[j] & (after[j] >> 1);
+    candot &= notblock;
+
+    for (j = 0; j < nruns; j++) {
+        int runlen = data[j];
+        line_bits starts = (before[j] & notblock) << 1;
+        line_bits ends = notblock & (after[j+1] >> 1);
+        if (j == 0)
+            starts |= 1;
+        if (j == nruns-1)
+            ends |= (line_bits)1 << len;
+        starts &= line_all(notdot, runlen) & (ends >> runlen);
+        canblock |= line_smear(starts, runlen);
+    }
+
+    for (i = 0; i < len; i++) {
+        if (candot & ((line_bits)1 << i))
+            deduced[i] |= DOT;
+        if (canblock & ((line_bits)1 << i))
+            deduced[i] |= BLOCK;
+    }
+}
+
+static void do_line(struct line_workspace *lw, const int *data, int len)
+{
+    if (len <= LINE_BITS_MAX)
+        do_line_bits(lw, data, len);
+    else
+        do_line_bytes(lw, data, len);
+}
+
+static bool do_row(struct line_workspace *lw,
                    unsigned char *start, int len, int step, int *data,
                    unsigned int *changed
 #ifdef STANDALONE_SOLVER
@@ -437,32 +696,23 @@ static bool do_row(unsigned char *known, unsigned char *deduced,
 #endif
                    )
 {
-    int rowlen, i, freespace;
+    unsigned char *known = lw->known, *deduced = lw->deduced;
+    int rowlen, i;
     bool done_any;
 
-    assert(len >= 0);   /* avoid compile warnings about the memsets below */
+    assert(len >= 0 && len <= lw->max);
 
-    freespace = len+1;
-    for (rowlen = 0; data[rowlen]; rowlen++) {
-	minpos_done[rowlen] = minpos_ok[rowlen] = len - 1;
-	maxpos_done[rowlen] = maxpos_ok[rowlen] = 0;
-	freespace -= data[rowlen]+1;
-    }
+    for (rowlen = 0; data[rowlen]; rowlen++);
 
-    for (i = 0; i < len; i++) {
+    for (i = 0; i < len; i++)
 	known[i] = start[i*step];
-	deduced[i] = 0;
-    }
-    for (i = len - 1; i >= 0 && known[i] == DOT; i--)
-        freespace--;
 
     if (rowlen == 0) {
         memset(deduced, DOT, len);
     } else if (rowlen == 1 && data[0] == len) {
         memset(deduced, BLOCK, len);
     } else {
-        do_recurse(known, deduced, row, minpos_done, maxpos_done, minpos_ok,
-                   maxpos_ok, data, len, freespace, 0, 0);
+        do_line(lw, data, len);
     }
 
     done_any = false;
@@ -498,7 +748,7 @@ static bool do_row(unsigned char *known, unsigned char *deduced,
 
 static bool solve_puzzle(const game_state *state, unsigned char *grid,
                          int w, int h,
-                         unsigned char *matrix, unsigned char *workspace,
+                         unsigned char *matrix, struct line_workspace *lw,
                          unsigned int *changed_h, unsigned int *changed_w,
                          int *rowdata
 #ifdef STANDALONE_SOLVER
@@ -600,10 +850,7 @@ static bool solve_puzzle(const game_state *state, unsigned char *grid,
 		    } else {
 			rowdata[compute_rowdata(rowdata, grid+i*w, w, 1)] = 0;
 		    }
-		    do_row(workspace, workspace+max, workspace+2*max,
-			   workspace+3*max, workspace+4*max,
-			   workspace+5*max, workspace+6*max,
-			   matrix+i*w, w, 1, rowdata, changed_w
+		    do_row(lw, matrix+i*w, w, 1, rowdata, changed_w
 #ifdef STANDALONE_SOLVER
 			   , "row", i+1, cluewid
 #endif
@@ -624,10 +871,7 @@ static bool solve_puzzle(const game_state *state, unsigned char *grid,
 		    } else {
 			rowdata[compute_rowdata(rowdata, grid+i, h, w)] = 0;
 		    }
-		    do_row(workspace, workspace+max, workspace+2*max,
-			   workspace+3*max, workspace+4*max,
-			   workspace+5*max, workspace+6*max,
-			   matrix+i, h, w, rowdata, changed_h
+		    do_row(lw, matrix+i, h, w, rowdata, changed_h
 #ifdef STANDALONE_SOLVER
 			   , "col", i+1, cluewid
 #endif
@@ -657,7 +901,8 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
 {
     int i, j, ntries, max;
     bool ok;
-    unsigned char *grid, *matrix, *workspace;
+    unsigned char *grid, *matrix;
+    struct line_workspace *lw;
     unsigned int *changed_h, *changed_w;
     int *rowdata;
 
@@ -666,7 +911,7 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
     grid = snewn(w*h, unsigned char);
     /* Allocate this here, to avoid having to reallocate it again for every geneerated grid */
     matrix = snewn(w*h, unsigned char);
-    workspace = snewn(max*7, unsigned char);
+    lw = new_line_workspace(max);
     changed_h = snewn(max+1, unsigned int);
     changed_w = snewn(max+1, unsigned int);
     rowdata = snewn(max+1, int);
@@ -706,12 +951,12 @@ static unsigned char *generate_soluble(random_state *rs, int w, int h)
         if (!ok)
             continue;
 
-	ok = solve_puzzle(NULL, grid, w, h, matrix, workspace,
+	ok = solve_puzzle(NULL, grid, w, h, matrix, lw,
 			  changed_h, changed_w, rowdata, 0);
     } while (!ok);
 
     sfree(matrix);
-    sfree(workspace);
+    free_line_workspace(lw);
     sfree(changed_h);
     sfree(changed_w);
     sfree(rowdata);
@@ -762,18 +1007,18 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 
     {
         unsigned char *matrix = snewn(params->w*params->h, unsigned char);
-        unsigned char *workspace = snewn(max*7, unsigned char);
+        struct line_workspace *lw = new_line_workspace(max);
         unsigned int *changed_h = snewn(max+1, unsigned int);
         unsigned int *changed_w = snewn(max+1, unsigned int);
         int *rowdata = snewn(max+1, int);
         for (i = 0; i < params->w * params->h; i++) {
             state->common->immutable[index[i]] = false;
             if (!solve_puzzle(state, grid, params->w, params->h,
-                              matrix, workspace, changed_h, changed_w,
+                              matrix, lw, changed_h, changed_w,
                               rowdata, 0))
                 state->common->immutable[index[i]] = true;
         }
-        sfree(workspace);
+        free_line_workspace(lw);
         sfree(changed_h);
         sfree(changed_w);
         sfree(rowdata);
@@ -1063,7 +1308,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     char *ret;
     int max;
     bool ok;
-    unsigned char *workspace;
+    struct line_workspace *lw;
     unsigned int *changed_h, *changed_w;
     int *rowdata;
 
@@ -1075,15 +1320,15 @@ static char *solve_game(const game_state *state, const game_state *currstate,
 
     max = max(w, h);
     matrix = snewn(w*h, unsigned char);
-    workspace = snewn(max*7, unsigned char);
+    lw = new_line_workspace(max);
     changed_h = snewn(max+1, unsigned int);
     changed_w = snewn(max+1, unsigned int);
     rowdata = snewn(max+1, int);
 
-    ok = solve_puzzle(state, NULL, w, h, matrix, workspace,
+    ok = solve_puzzle(state, NULL, w, h, matrix, lw,
 		      changed_h, changed_w, rowdata, 0);
 
-    sfree(workspace);
+    free_line_workspace(lw);
     sfree(changed_h);
     sfree(changed_w);
     sfree(rowdata);
@@ -2052,6 +2297,7 @@ const struct game thegame = {
     false,			       /* wants_statusbar */
     false, game_timing_state,
     REQUIRE_RBUTTON,		       /* flags */
+    16,				       /* undo_snapshot_stride */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -2100,13 +2346,14 @@ int main(int argc, char **argv)
 
     {
 	int w = p->w, h = p->h, i, j, max, cluewid = 0;
-	unsigned char *matrix, *workspace;
+	unsigned char *matrix;
+	struct line_workspace *lw;
 	unsigned int *changed_h, *changed_w;
 	int *rowdata;
 
 	matrix = snewn(w*h, unsigned char);
 	max = max(w, h);
-	workspace = snewn(max*7, unsigned char);
+	lw = new_line_workspace(max);
 	changed_h = snewn(max+1, unsigned int);
 	changed_w = snewn(max+1, unsigned int);
 	rowdata = snewn(max+1, int);
@@ -2129,7 +2376,7 @@ int main(int argc, char **argv)
 	    }
 	}
 
-	solve_puzzle(s, NULL, w, h, matrix, workspace,
+	solve_puzzle(s, NULL, w, h, matrix, lw,
 		     changed_h, changed_w, rowdata, cluewid);
 
 	for (i = 0; i < h; i++) {
@@ -235,6 +235,47 @@ static vector xform_coord(vector vo, int shrink, vector vtrans, int ang)
 
 #define XFORM(n,o,s,a) vs[(n)] = xform_coord(v_edge, (s), vs[(o)], (a))
 
+/*
+ * Every tile generated below a half-tile has its first vertex
+ * inside that half-tile, so if the half-tile is entirely outside
+ * the clipping window, nothing below it is wanted. The margin
+ * allows for the caller rounding coordinates to integers.
+ */
+#define CLIP_MARGIN 1.0
+
+static int outside_window(penrose_state *state, vector *vs)
+{
+    double x, y, xmin, xmax, ymin, ymax;
+    int i;
+
+    if (!state->clip)
+        return 0;
+
+    xmin = xmax = v_x(vs, 0);
+    ymin = ymax = v_y(vs, 0);
+    for (i = 1; i < 3; i++) {
+        x = v_x(vs, i);
+        y = v_y(vs, i);
+        if (x < xmin) xmin = x;
+        if (x > xmax) xmax = x;
+        if (y < ymin) ymin = y;
+        if (y > ymax) ymax = y;
+    }
+    return (xmax < state->xmin - CLIP_MARGIN ||
+            xmin > state->xmax + CLIP_MARGIN ||
+            ymax < state->ymin - CLIP_MARGIN ||
+            ymin > state->ymax + CLIP_MARGIN);
+}
+
+/* Check the half-tile with the given second and third vertices. */
+#define CLIPPED(s1,a1,s2,a2) do {                       \
+        vector vs[3];                                   \
+        vs[0] = v_orig;                                 \
+        XFORM(1, 0, (s1), (a1));                        \
+        XFORM(2, 0, (s2), (a2));                        \
+        if (outside_window(state, vs)) return 0;        \
+    } while (0)
+
 static int penrose_p2_small(penrose_state *state, int depth, int flip,
                             vector v_orig, vector v_edge);
 
@@ -243,6 +284,8 @@ static int penrose_p2_large(penrose_state *state, int depth, int flip,
 {
     vector vv_orig, vv_edge;
 
+    CLIPPED(0, 0, 0, -36*flip);
+
 #ifdef DEBUG_PENROSE
     {
         vector vs[3];
@@ -285,6 +328,8 @@ static int penrose_p2_small(penrose_state *state, int depth, int flip,
 {
     vector vv_orig;
 
+    CLIPPED(0, 0, -1, -36*flip);
+
 #ifdef DEBUG_PENROSE
     {
         vector vs[3];
@@ -328,6 +373,8 @@ static int penrose_p3_large(penrose_state *state, int depth, int flip,
 {
     vector vv_orig;
 
+    CLIPPED(1, 0, 0, -36*flip);
+
 #ifdef DEBUG_PENROSE
     {
         vector vs[3];
@@ -373,6 +420,8 @@ static int penrose_p3_small(penrose_state *state, int depth, int flip,
 {
     vector vv_orig;
 
+    CLIPPED(0, 0, 0, -36*flip);
+
 #ifdef DEBUG_PENROSE
     {
         vector vs[3];
@@ -576,6 +625,7 @@ int main(int argc, char *argv[])
     ps.start_size = atoi(argv[1]);
     ps.max_depth = atoi(argv[2]);
     ps.new_tile = test_cb;
+    ps.clip = 0;
 
     ntiles = nfinal = 0;
 
@@ -36,6 +36,13 @@ struct penrose_state {
     int start_size;  /* initial side length */
     int max_depth;      /* Recursion depth */
 
+    /* If clip is set, only tiles which might have a vertex within
+     * the window [xmin,xmax] x [ymin,ymax] (after rounding to the
+     * nearest integer) are generated: any half-tile lying wholly
+     * outside it is dropped along with everything below it. */
+    int clip;
+    double xmin, xmax, ymin, ymax;
+
     tile_callback new_tile;
     void *ctx;          /* for callback */
 };
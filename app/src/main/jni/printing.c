@@ -22,6 +22,8 @@ struct document {
     bool got_solns;
     float *colwid, *rowht;
     float userscale;
+    drawing *stream;		       /* see document_begin_stream */
+    int pages_done;
 };
 
 /*
@@ -43,14 +45,16 @@ document *document_new(int pw, int ph, float userscale)
     doc->rowht = snewn(ph, float);
 
     doc->userscale = userscale;
+    doc->stream = NULL;
+    doc->pages_done = 0;
 
     return doc;
 }
 
 /*
- * Free a document structure, whether it's been printed or not.
+ * Free the puzzles held by a document, leaving it empty.
  */
-void document_free(document *doc)
+static void free_puzzles(document *doc)
 {
     int i;
 
@@ -60,6 +64,16 @@ void document_free(document *doc)
 	if (doc->puzzles[i].st2)
 	    doc->puzzles[i].game->free_game(doc->puzzles[i].st2);
     }
+    doc->npuzzles = 0;
+    doc->got_solns = false;
+}
+
+/*
+ * Free a document structure, whether it's been printed or not.
+ */
+void document_free(document *doc)
+{
+    free_puzzles(doc);
 
     sfree(doc->colwid);
     sfree(doc->rowht);
@@ -68,6 +82,8 @@ void document_free(document *doc)
     sfree(doc);
 }
 
+static void stream_page(document *doc);
+
 /*
  * Called from midend.c to add a puzzle to be printed. Provides a
  * game_params (for initial layout computation), a game_state, and
@@ -88,6 +104,9 @@ void document_add_puzzle(document *doc, const game *game, game_params *par,
     doc->npuzzles++;
     if (st2)
 	doc->got_solns = true;
+
+    if (doc->stream && doc->npuzzles == doc->pw * doc->ph)
+        stream_page(doc);
 }
 
 static void get_puzzle_size(const document *doc, struct puzzle *pz,
@@ -148,35 +167,15 @@ void document_end(const document *doc, drawing *dr)
 }
 
 /*
- * Print a single page of a document.
+ * Print the n puzzles from offset onwards as page number pageno,
+ * showing their solutions if pass is 1.
  */
-void document_print_page(const document *doc, drawing *dr, int page_nr)
+static void print_page(const document *doc, drawing *dr, int offset, int n,
+                       int pass, int pageno)
 {
-    int ppp;			       /* puzzles per page */
-    int pages;
-    int page, pass;
-    int pageno;
-    int i, n, offset;
+    int i;
     float colsum, rowsum;
 
-    ppp = doc->pw * doc->ph;
-    pages = (doc->npuzzles + ppp - 1) / ppp;
-
-    /* Get the current page, pass, and pageno based on page_nr. */
-    if (page_nr < pages) {
-        page = page_nr;
-        pass = 0;
-    }
-    else {
-        assert(doc->got_solns);
-        page = page_nr - pages;
-        pass = 1;
-    }
-    pageno = page_nr + 1;
-
-    offset = page * ppp;
-    n = min(ppp, doc->npuzzles - offset);
-
     print_begin_page(dr, pageno);
 
     for (i = 0; i < doc->pw; i++)
@@ -279,6 +278,35 @@ void document_print_page(const document *doc, drawing *dr, int page_nr)
     print_end_page(dr, pageno);
 }
 
+/*
+ * Print a single page of a document.
+ */
+void document_print_page(const document *doc, drawing *dr, int page_nr)
+{
+    int ppp;			       /* puzzles per page */
+    int pages;
+    int page, pass;
+    int offset;
+
+    ppp = doc->pw * doc->ph;
+    pages = (doc->npuzzles + ppp - 1) / ppp;
+
+    /* Get the current page and pass based on page_nr. */
+    if (page_nr < pages) {
+        page = page_nr;
+        pass = 0;
+    }
+    else {
+        assert(doc->got_solns);
+        page = page_nr - pages;
+        pass = 1;
+    }
+
+    offset = page * ppp;
+    print_page(doc, dr, offset, min(ppp, doc->npuzzles - offset), pass,
+               page_nr + 1);
+}
+
 /*
  * Having accumulated a load of puzzles, actually do the printing.
  */
@@ -291,3 +319,41 @@ void document_print(const document *doc, drawing *dr)
         document_print_page(doc, dr, page);
     print_end_doc(dr);
 }
+
+/*
+ * Print a document as it is built, rather than all at once when it's
+ * complete. Each page is printed as soon as it fills up, and its
+ * puzzles are then freed, so memory use doesn't grow with the length
+ * of the document. Call this before adding any puzzles, and
+ * document_end_stream() after the last.
+ *
+ * The number of pages isn't known in advance, so print_begin_doc is
+ * passed 0. If any puzzles on a page have solutions, the page of
+ * solutions follows it directly, rather than all the solutions
+ * coming at the end.
+ */
+void document_begin_stream(document *doc, drawing *dr)
+{
+    assert(doc->npuzzles == 0);
+    doc->stream = dr;
+    doc->pages_done = 0;
+    print_begin_doc(dr, 0);
+}
+
+static void stream_page(document *doc)
+{
+    print_page(doc, doc->stream, 0, doc->npuzzles, 0, ++doc->pages_done);
+    if (doc->got_solns)
+        print_page(doc, doc->stream, 0, doc->npuzzles, 1,
+                   ++doc->pages_done);
+    free_puzzles(doc);
+}
+
+void document_end_stream(document *doc)
+{
+    assert(doc->stream);
+    if (doc->npuzzles)
+        stream_page(doc);
+    print_end_doc(doc->stream);
+    doc->stream = NULL;
+}
@@ -16,6 +16,8 @@ struct psdata {
     bool clipped;
     float hatchthick, hatchspace;
     int gamewidth, gameheight;
+    bool pages_atend;		       /* page count goes in the trailer */
+    int pages;			       /* pages begun so far */
     drawing *drawing;
 };
 
@@ -292,7 +294,15 @@ static void ps_begin_doc(void *handle, int pages)
     fputs("%%Creator: Simon Tatham's Portable Puzzle Collection\n", ps->fp);
     fputs("%%DocumentData: Clean7Bit\n", ps->fp);
     fputs("%%LanguageLevel: 1\n", ps->fp);
-    fprintf(ps->fp, "%%%%Pages: %d\n", pages);
+    /*
+     * A streamed document doesn't know its page count yet, so it
+     * gives it in the trailer instead.
+     */
+    ps->pages_atend = (pages <= 0);
+    if (!ps->pages_atend)
+        fprintf(ps->fp, "%%%%Pages: %d\n", pages);
+    else
+        fputs("%%Pages: (atend)\n", ps->fp);
     fputs("%%DocumentNeededResources:\n", ps->fp);
     fputs("%%+ font Helvetica\n", ps->fp);
     fputs("%%+ font Courier\n", ps->fp);
@@ -335,6 +345,7 @@ static void ps_begin_page(void *handle, int number)
 {
     psdata *ps = (psdata *)handle;
 
+    ps->pages = max(ps->pages, number);
     fprintf(ps->fp, "%%%%Page: %d %d\ngsave save\n%g dup scale\n",
 	    number, number, 72.0 / 25.4);
 }
@@ -376,6 +387,8 @@ static void ps_end_doc(void *handle)
 {
     psdata *ps = (psdata *)handle;
 
+    if (ps->pages_atend)
+        fprintf(ps->fp, "%%%%Trailer\n%%%%Pages: %d\n", ps->pages);
     fputs("%%EOF\n", ps->fp);
 }
 
@@ -384,7 +397,9 @@ static const struct drawing_api ps_drawing = {
     ps_draw_rect,
     ps_draw_line,
     ps_draw_polygon,
+    NULL /* draw_thick_polygon */,
     ps_draw_circle,
+    NULL /* draw_thick_circle */,
     NULL /* draw_update */,
     ps_clip,
     ps_unclip,
@@ -416,6 +431,8 @@ psdata *ps_init(FILE *outfile, bool colour)
     ps->ytop = 0;
     ps->clipped = false;
     ps->hatchthick = ps->hatchspace = ps->gamewidth = ps->gameheight = 0;
+    ps->pages_atend = false;
+    ps->pages = 0;
     ps->drawing = drawing_new(&ps_drawing, NULL, ps);
 
     return ps;
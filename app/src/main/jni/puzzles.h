@@ -81,13 +81,27 @@ enum {
 #define REQUIRE_RBUTTON ( 1 << 10 )
 /* Pocket PC: Game requires numeric input */
 #define REQUIRE_NUMPAD ( 1 << 11 )
+/* new_desc may run on several threads at once, and gives up (returning
+ * NULL) soon after random_cancelled() becomes true */
+#define PARALLEL_NEW_DESC ( 1 << 12 )
 /* end of `flags' word definitions */
 
+/*
+ * Storage class for any file-scope variable that a PARALLEL_NEW_DESC
+ * generator writes to, so that concurrent generations don't share it.
+ */
+#ifdef PARALLEL_GENERATION
+#define THREAD_LOCAL _Thread_local
+#else
+#define THREAD_LOCAL
+#endif
+
 #define IGNOREARG(x) ( (x) = (x) )
 
 typedef struct frontend frontend;
 typedef struct config_item config_item;
 typedef struct midend midend;
+typedef struct midend_solve_job midend_solve_job;
 typedef struct random_state random_state;
 typedef struct game_params game_params;
 typedef struct game_state game_state;
@@ -99,6 +113,8 @@ typedef struct document document;
 typedef struct drawing_api drawing_api;
 typedef struct drawing drawing;
 typedef struct psdata psdata;
+/* see random_set_poll() */
+typedef bool (*random_poll_fn)(void *ctx, unsigned long attempts);
 
 #define ALIGN_VNORMAL 0x000
 #define ALIGN_VCENTRE 0x100
@@ -242,6 +258,19 @@ void deactivate_timer(frontend *fe);
 void activate_timer(frontend *fe);
 void get_random_seed(void **randseed, int *randseedsize);
 char *get_text(const char *text);
+#ifdef TRACE_SECTIONS
+/*
+ * Trace sections for a system profiler, supplied by frontends built
+ * with TRACE_SECTIONS. The midend brackets its main entry points with
+ * these, naming the game and its params, so that a trace shows which
+ * puzzle took the time. trace_begin is only called after
+ * trace_enabled has returned true, and each call is matched by a
+ * trace_end on the same thread.
+ */
+bool trace_enabled(void);
+void trace_begin(const char *name);
+void trace_end(void);
+#endif
 #ifdef ANDROID
 /* TODO reinstate get_text(x) when occasional crash diagnosed... */
 #define _(x) (x)
@@ -255,6 +284,7 @@ char *get_text(const char *text);
  */
 drawing *drawing_new(const drawing_api *api, midend *me, void *handle);
 void drawing_free(drawing *dr);
+void drawing_set_coalescing(drawing *dr, bool coalesce);
 void draw_text(drawing *dr, int x, int y, int fonttype, int fontsize,
                int align, int colour, const char *text);
 void draw_rect(drawing *dr, int x, int y, int w, int h, int colour);
@@ -329,6 +359,11 @@ void midend_redraw(midend *me);
 float *midend_colours(midend *me, int *ncolours);
 void midend_freeze_timer(midend *me, float tprop);
 void midend_timer(midend *me, float tplus);
+/* How long the front end may wait before calling midend_timer again
+ * without anything going stale: 0 during animations and flashes, or
+ * else the time until the clock of a timed game next shows a new
+ * second. */
+float midend_timer_deadline(midend *me);
 struct preset_menu *midend_get_presets(midend *me, int *id_limit);
 int midend_which_preset(midend *me);
 bool midend_wants_statusbar(midend *me);
@@ -344,6 +379,18 @@ char *midend_get_random_seed(midend *me);
 bool midend_can_format_as_text_now(midend *me);
 char *midend_text_format(midend *me);
 const char *midend_solve(midend *me);
+/* Solve without blocking the caller. midend_solve_start snapshots the
+ * current position (or returns NULL with *msg set); the job may then
+ * be passed to midend_solve_run on any thread, and back to
+ * midend_solve_finish on the midend's own, which enters the solution
+ * as midend_solve would and frees the job. If the position has moved
+ * on since the start, or another job has been started, the result is
+ * quietly dropped instead. A job whose midend has gone away must be
+ * freed with midend_solve_discard. */
+midend_solve_job *midend_solve_start(midend *me, const char **msg);
+void midend_solve_run(midend_solve_job *job);
+const char *midend_solve_finish(midend *me, midend_solve_job *job);
+void midend_solve_discard(midend_solve_job *job);
 int midend_status(midend *me);
 bool midend_can_undo(midend *me);
 bool midend_can_redo(midend *me);
@@ -353,13 +400,50 @@ char *midend_rewrite_statusbar(midend *me, const char *text);
 void midend_serialise(midend *me,
                       void (*write)(void *ctx, const void *buf, int len),
                       void *wctx);
+/* The same in a smaller binary form, in one call to 'write'. The text
+ * form stays the one to exchange; midend_deserialise and
+ * identify_game accept either. */
+void midend_serialise_compact(midend *me,
+                              void (*write)(void *ctx, const void *buf,
+                                            int len),
+                              void *wctx);
 const char *midend_deserialise(midend *me,
                                bool (*read)(void *ctx, void *buf, int len),
                                void *rctx);
+/* Journalling: 'write' receives a base record in the compact form
+ * (with rewrite true, meaning it replaces everything written so far)
+ * whenever a game is started or loaded or the journal is compacted,
+ * and small appended records as moves are made and undone.
+ * midend_journal_flush appends the elapsed time and game_ui as they
+ * are now, for a front end about to be put away.
+ * midend_deserialise_journal reads the result back. */
+void midend_set_journal(midend *me,
+                        void (*write)(void *ctx, const void *buf, int len,
+                                      bool rewrite),
+                        void *wctx);
+void midend_journal_flush(midend *me);
+const char *midend_deserialise_journal(midend *me,
+                                       bool (*read)(void *ctx, void *buf,
+                                                    int len),
+                                       void *rctx);
 const char *identify_game(char **name,
                           bool (*read)(void *ctx, void *buf, int len),
                           void *rctx);
 void midend_request_id_changes(midend *me, void (*notify)(void *), void *ctx);
+void midend_set_undo_snapshot_stride(midend *me, int stride);
+/* Generate new games (for backends flagged PARALLEL_NEW_DESC, in builds
+ * with PARALLEL_GENERATION) on this many threads at once, taking the
+ * first to finish. Other generators, and Solve, may use the threads to
+ * split up their search.c searches instead. */
+void midend_set_generation_threads(midend *me, int nthreads);
+/* Have midend_new_game call progress at each generator retry point,
+ * with the number of attempts so far. If it returns true, generation
+ * stops and midend_new_game returns leaving the midend without a
+ * game, to be given another midend_new_game or freed. With several
+ * generation threads, calls are serialised and count attempts over
+ * all of them. */
+void midend_set_generation_progress(midend *me, random_poll_fn progress,
+                                    void *ctx);
 bool midend_get_cursor_location(midend *me, int *x, int *y, int *w, int *h);
 
 /* Printing functions supplied by the mid-end */
@@ -382,6 +466,28 @@ void *smalloc(size_t size);
 void *srealloc(void *p, size_t size);
 void sfree(void *p);
 char *dupstr(const char *s);
+#ifdef MALLOC_STATS
+/*
+ * Building with MALLOC_STATS counts every allocation made through
+ * the functions above, overall and per source file that made it.
+ * Not thread-safe; a snapshot is only meaningful between calls.
+ */
+void *smalloc_tagged(size_t size, const char *tag);
+void *srealloc_tagged(void *p, size_t size, const char *tag);
+#define smalloc(size) smalloc_tagged(size, __FILE__)
+#define srealloc(p, size) srealloc_tagged(p, size, __FILE__)
+struct malloc_stats {
+    const char *tag;                   /* NULL for the overall totals */
+    size_t total_bytes, live_bytes, peak_bytes;
+    unsigned long count;
+};
+/* Fill in up to 'max' entries, the overall totals first and then one
+ * per tag, and return how many there are in all. */
+int malloc_stats_snapshot(struct malloc_stats *out, int max);
+/* Zero the totals and counts, and start measuring peaks afresh from
+ * the bytes live now. */
+void malloc_stats_reset(void);
+#endif
 #define snew(type) \
     ( (type *) smalloc (sizeof (type)) )
 #define snewn(number, type) \
@@ -389,6 +495,27 @@ char *dupstr(const char *s);
 #define sresize(array, number, type) \
     ( (type *) srealloc ((array), (number) * sizeof (type)) )
 
+/*
+ * arena.c: bump allocation of scratch space that is discarded in
+ * bulk, either back to a mark or all at once by arena_reset. The
+ * arena keeps its memory for reuse until arena_free.
+ */
+typedef struct arena arena;
+typedef struct arena_mark {
+    int chunk;
+    size_t used;
+} arena_mark;
+arena *arena_new(void);
+void *arena_alloc(arena *a, size_t size);
+arena_mark arena_get_mark(const arena *a);
+void arena_release(arena *a, arena_mark m);
+void arena_reset(arena *a);
+void arena_free(arena *a);
+#define anew(a, type) \
+    ( (type *) arena_alloc ((a), sizeof (type)) )
+#define anewn(a, number, type) \
+    ( (type *) arena_alloc ((a), (number) * sizeof (type)) )
+
 /*
  * misc.c
  */
@@ -443,6 +570,19 @@ void copy_left_justified(char *buf, size_t sz, const char *str);
    function is NULL. Dynamically allocated, to be freed by caller. */
 char *button2label(int button);
 
+/*
+ * Per-tile change detection for game_drawstates. Instead of keeping
+ * a copy of everything that went into drawing each tile, a backend
+ * mixes it all into one tilehash, starting from 0, and keeps only
+ * that. tilehash_update() then says whether the tile needs redrawing
+ * and records the new hash. A drawn hash of 0 always needs a redraw,
+ * so an array zeroed at creation (or on a flash) forces one.
+ */
+typedef unsigned long long tilehash;
+tilehash tilehash_add(tilehash h, unsigned long long v);
+tilehash tilehash_add_bytes(tilehash h, const void *data, size_t len);
+bool tilehash_update(tilehash *drawn, tilehash h);
+
 /*
  * dsf.c
  */
@@ -466,6 +606,49 @@ void edsf_merge(int *dsf, int v1, int v2, bool inverse);
 void dsf_merge(int *dsf, int v1, int v2);
 void dsf_init(int *dsf, int len);
 
+/*
+ * A separate, typed disjoint set forest using union by size and full
+ * path compression, for solvers that canonify in inner loops. It has
+ * no inverse flags, and the root of a class is arbitrary, so use
+ * dsf_minimal() where the smallest element is wanted as canonical
+ * (as legacy dsf_canonify() returns).
+ */
+typedef struct DSF DSF;
+DSF *dsf_new(int size);
+void dsf_free(DSF *dsf);
+void dsf_reinit(DSF *dsf);
+void dsf_copy(DSF *to, const DSF *from);
+int dsf_find(DSF *dsf, int val);
+/* Returns the root of the merged class. */
+int dsf_union(DSF *dsf, int v1, int v2);
+bool dsf_equivalent(DSF *dsf, int v1, int v2);
+int dsf_class_size(DSF *dsf, int val);
+int dsf_minimal(DSF *dsf, int val);
+/* Point every element directly at its root, and return the array of
+ * roots, indexed by element, valid until the next dsf_union. */
+const int *dsf_flatten(DSF *dsf);
+
+/*
+ * bitgrid.c: a w x h rectangle of bits, each row packed into whole
+ * machine words, for two-state cells and GF(2) matrices. Row
+ * operations between two bitgrids need them to be the same width.
+ */
+typedef struct bitgrid bitgrid;
+bitgrid *bitgrid_new(int w, int h);    /* all bits clear */
+bitgrid *bitgrid_dup(const bitgrid *bg);
+void bitgrid_free(bitgrid *bg);
+void bitgrid_clear(bitgrid *bg);
+bool bitgrid_get(const bitgrid *bg, int x, int y);
+void bitgrid_set(bitgrid *bg, int x, int y, bool v);
+void bitgrid_toggle(bitgrid *bg, int x, int y);
+/* Row dy of dst ^= row sy of src; dst and src may be the same. */
+void bitgrid_xor_row(bitgrid *dst, int dy, const bitgrid *src, int sy);
+bool bitgrid_rows_equal(const bitgrid *a, int ay, const bitgrid *b, int by);
+bool bitgrid_row_empty(const bitgrid *bg, int y);
+int bitgrid_row_popcount(const bitgrid *bg, int y);
+/* The first set bit in row y at or after column x, or -1 if none. */
+int bitgrid_row_next(const bitgrid *bg, int y, int x);
+
 /*
  * tdq.c
  */
@@ -501,8 +684,62 @@ tdq *tdq_new(int n);
 void tdq_free(tdq *tdq);
 void tdq_add(tdq *tdq, int k);
 int tdq_remove(tdq *tdq);        /* returns -1 if nothing available */
+bool tdq_empty(const tdq *tdq);  /* true if tdq_remove would return -1 */
 void tdq_fill(tdq *tdq);         /* add everything to the tdq at once */
 
+/*
+ * search.c: depth-first search for solutions, stopping once a given
+ * number have been found, for uniqueness checks that only need to
+ * tell 0, 1 and 'more than 1' apart.
+ *
+ * The state being searched belongs to the caller, which must make
+ * every change to it during the search through search_save (called
+ * before modifying the given bytes in place) or search_set_int.
+ * Those changes are undone automatically on backing out of a branch,
+ * and by the time search_run returns.
+ *
+ * At each node the search calls propagate, if present, which makes
+ * whatever deductions it likes and returns false on a contradiction.
+ * Then branch returns the number of ways to continue, with *where
+ * set to identify the choice point to choose; or 0 if the state is
+ * a complete solution, in which case solution is called, if present.
+ * choose(where, i) makes the ith choice, or returns false if that is
+ * immediately contradictory. node, if present, is called on entry to
+ * every node, for instrumentation.
+ *
+ * If dup_ctx and free_ctx are present, then in builds with
+ * PARALLEL_GENERATION the choices at the root may be shared out among
+ * several threads, each searching from its own copy of the context.
+ * The callbacks must then be safe to run on copies concurrently;
+ * calls to solution are serialised, and search_solutions counts the
+ * solutions found by every thread.
+ */
+typedef struct searcher searcher;
+struct search_ops {
+    bool (*propagate)(searcher *s, void *ctx);
+    int (*branch)(searcher *s, void *ctx, int *where);
+    bool (*choose)(searcher *s, void *ctx, int where, int i);
+    void (*solution)(searcher *s, void *ctx);
+    void (*node)(searcher *s, void *ctx, int depth);
+    void *(*dup_ctx)(void *ctx);
+    void (*free_ctx)(void *ctx);
+};
+searcher *search_new(void);
+void search_free(searcher *s);
+/* Threads to split the root among (default: see below). */
+void search_set_threads(searcher *s, int nthreads);
+/* Thread count for searches subsequently created on this thread. */
+void search_set_default_threads(int nthreads);
+void search_save(searcher *s, void *where, size_t len);
+void search_set_int(searcher *s, int *where, int value);
+/* Returns the number of solutions found, at most limit. */
+int search_run(searcher *s, const struct search_ops *ops, void *ctx,
+               int limit);
+/* Solutions found so far by the current or last search_run. */
+int search_solutions(const searcher *s);
+/* Nodes visited by every search_run on this search since search_new. */
+unsigned long search_nodes(const searcher *s);
+
 /*
  * laydomino.c
  */
@@ -518,9 +755,30 @@ extern char ver[];
  * random.c
  */
 random_state *random_new(const char *seed, int len);
+/* Same interface, but a much cheaper generator with a different stream. */
+random_state *random_new_fast(const char *seed, int len);
+/* Seed strings with this prefix select the fast generator; others get
+ * the SHA-1 one, so that existing game IDs still reproduce. The older
+ * tag selects version 1 of the fast generator, whose random_upto
+ * differs, so its game IDs also still reproduce. */
+#define RANDOM_FAST_SEED_TAG "~2"
+#define RANDOM_FAST_SEED_TAG_V1 "~1"
+random_state *random_new_seed_string(const char *seedstr);
 random_state *random_copy(random_state *tocopy);
+/*
+ * Generators call random_cancelled at their retry points. Each call
+ * counts one more attempt and passes the count to the poll function
+ * set here, which returns true to stop the generation; from then on
+ * random_cancelled always returns true, and the generator gives up
+ * and returns NULL. Without a poll function it is always false.
+ */
+void random_set_poll(random_state *state, random_poll_fn poll, void *ctx);
+bool random_cancelled(random_state *state);
 unsigned long random_bits(random_state *state, int bits);
 unsigned long random_upto(random_state *state, unsigned long limit);
+/* Fill out[0..n-1] with the same values as n calls to random_upto. */
+void random_fill_upto(random_state *state, unsigned long limit,
+                      int *out, int n);
 void random_free(random_state *state);
 char *random_state_encode(random_state *state);
 random_state *random_state_decode(const char *input);
@@ -556,6 +814,8 @@ void document_begin(const document *doc, drawing *dr);
 void document_end(const document *doc, drawing *dr);
 void document_print_page(const document *doc, drawing *dr, int page_nr);
 void document_print(const document *doc, drawing *dr);
+void document_begin_stream(document *doc, drawing *dr);
+void document_end_stream(document *doc);
 
 /*
  * ps.c
@@ -631,6 +891,21 @@ bool findloop_is_loop_edge(struct findloopstate *state, int u, int v);
 bool findloop_is_bridge(
     struct findloopstate *pv, int u, int v, int *u_vertices, int *v_vertices);
 
+/*
+ * Update the output of findloop_run after adding or removing the
+ * single edge u-v, so that both query functions above give the
+ * answers a fresh run on the new graph would. The graph must have no
+ * self-loops or repeated edges.
+ *
+ * Adding an edge always succeeds, unless u and v are already joined
+ * in findloop's spanning tree. Removing an edge succeeds only if it
+ * was a bridge. Otherwise these functions return false and leave the
+ * state unusable, and the caller must call findloop_run again.
+ */
+bool findloop_add_edge(struct findloopstate *pv, int nvertices, int u, int v);
+bool findloop_remove_edge(struct findloopstate *pv, int nvertices,
+                          int u, int v);
+
 /*
  * Helper function to sort an array. Differs from standard qsort in
  * that it takes a context parameter that is passed to the compare
@@ -720,6 +995,11 @@ struct game {
     bool is_timed;
     bool (*timing_state)(const game_state *state, game_ui *ui);
     int flags;
+    /* If > 1, the midend keeps a full game_state in its undo chain
+     * only every this many moves, and rebuilds the others by
+     * replaying execute_move. Only worth it for games with large
+     * states; 0 (the default if omitted) keeps every state. */
+    int undo_snapshot_stride;
 };
 
 /*
@@ -768,6 +1048,9 @@ struct drawing_api {
 			    float x1, float y1, float x2, float y2,
 			    int colour);
     void (*inertia_follow)(void *handle, bool is_solved);
+    /* Optional: called instead of end_draw if nothing was drawn
+     * since start_draw, so there is nothing to repaint. */
+    void (*end_draw_unchanged)(void *handle);
 };
 
 /*
@@ -8,12 +8,43 @@
  * The generator is based on SHA-1. This is almost certainly
  * overkill, but I had the SHA-1 code kicking around and it was
  * easier to reuse it than to do anything else!
+ *
+ * Since generators can spend a noticeable fraction of their time in
+ * SHA-1, there is also a much cheaper xoshiro128** engine, selected
+ * by random_new_fast() or by a seed string carrying
+ * RANDOM_FAST_SEED_TAG. Untagged seeds keep the SHA-1 stream so that
+ * existing game IDs still produce the same games.
+ *
+ * The fast engine is versioned by its seed tag. Version 1 draws
+ * bounded integers the same way as the SHA-1 engine, by rejection on
+ * a few bits more than the limit needs. Version 2 (the current tag)
+ * draws them with Lemire's multiply-and-shift method, which consumes
+ * one whole 32-bit output per draw and almost never needs a divide.
+ *
+ * Where the CPU has SHA-1 instructions (x86 SHA extensions, or the
+ * ARMv8 cryptography extensions) the block transform uses them,
+ * chosen at run time. They compute exactly the same function as the
+ * portable code, so the choice never affects the output.
  */
 
 #include <assert.h>
+#include <ctype.h>
 #include <string.h>
 #include <stdio.h>
 
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define SHA_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined __GNUC__ && defined __aarch64__ && defined __linux__
+#define SHA_ARM
+#include <sys/auxv.h>
+#include <arm_neon.h>
+#ifndef HWCAP_SHA1
+#define HWCAP_SHA1 (1 << 5)
+#endif
+#endif
+
 #include "puzzles.h"
 
 /* ----------------------------------------------------------------------
@@ -31,7 +62,7 @@ static void SHA_Core_Init(uint32 h[5])
     h[4] = 0xc3d2e1f0;
 }
 
-static void SHATransform(uint32 * digest, uint32 * block)
+static void SHATransform_portable(uint32 * digest, uint32 * block)
 {
     uint32 w[80];
     uint32 a, b, c, d, e;
@@ -94,6 +125,157 @@ static void SHATransform(uint32 * digest, uint32 * block)
     digest[4] += e;
 }
 
+/*
+ * The hardware versions work four rounds at a time, on vectors of
+ * four message words. Both take the block as already-decoded host
+ * words, as the portable version does.
+ */
+#ifdef SHA_X86
+
+/* Four rounds using round function f, on message vector msg[g]. */
+#define SHA_X86_ROUNDS(g, f) do {                                       \
+        if ((g) >= 4)                                                   \
+            msg[(g)%4] = _mm_sha1msg2_epu32(_mm_xor_si128(              \
+                _mm_sha1msg1_epu32(msg[(g)%4], msg[((g)+1)%4]),         \
+                msg[((g)+2)%4]), msg[((g)+3)%4]);                       \
+        e1 = ((g) == 0 ? _mm_add_epi32(e0, msg[0]) :                    \
+              _mm_sha1nexte_epu32(e0, msg[(g)%4]));                     \
+        e0 = abcd;                                                      \
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, f);                        \
+    } while (0)
+
+__attribute__((target("sha,sse4.1")))
+static void SHATransform_x86(uint32 * digest, uint32 * block)
+{
+    __m128i abcd, abcd_save, e0, e1, e_save, msg[4];
+    int i;
+
+    /* The instructions want word 0 in the top lane. */
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)digest), 0x1B);
+    e0 = _mm_set_epi32(digest[4], 0, 0, 0);
+    abcd_save = abcd;
+    e_save = e0;
+    for (i = 0; i < 4; i++)
+        msg[i] = _mm_shuffle_epi32(
+            _mm_loadu_si128((__m128i *)(block + 4*i)), 0x1B);
+
+    SHA_X86_ROUNDS(0, 0);  SHA_X86_ROUNDS(1, 0);  SHA_X86_ROUNDS(2, 0);
+    SHA_X86_ROUNDS(3, 0);  SHA_X86_ROUNDS(4, 0);  SHA_X86_ROUNDS(5, 1);
+    SHA_X86_ROUNDS(6, 1);  SHA_X86_ROUNDS(7, 1);  SHA_X86_ROUNDS(8, 1);
+    SHA_X86_ROUNDS(9, 1);  SHA_X86_ROUNDS(10, 2); SHA_X86_ROUNDS(11, 2);
+    SHA_X86_ROUNDS(12, 2); SHA_X86_ROUNDS(13, 2); SHA_X86_ROUNDS(14, 2);
+    SHA_X86_ROUNDS(15, 3); SHA_X86_ROUNDS(16, 3); SHA_X86_ROUNDS(17, 3);
+    SHA_X86_ROUNDS(18, 3); SHA_X86_ROUNDS(19, 3);
+
+    e0 = _mm_sha1nexte_epu32(e0, e_save);
+    abcd = _mm_add_epi32(abcd, abcd_save);
+    _mm_storeu_si128((__m128i *)digest, _mm_shuffle_epi32(abcd, 0x1B));
+    digest[4] = _mm_extract_epi32(e0, 3);
+}
+
+static bool SHA_hardware_available(void)
+{
+    unsigned a, b, c, d;
+
+    if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSE4_1))
+        return false;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d))
+        return false;
+    return (b & (1U << 29)) != 0;      /* SHA extensions */
+}
+
+#define SHATransform_hardware SHATransform_x86
+
+#endif /* SHA_X86 */
+
+#ifdef SHA_ARM
+
+/* Four rounds using round function op, on message vector msg[g]. */
+#define SHA_ARM_ROUNDS(g, op, k) do {                                   \
+        if ((g) >= 4)                                                   \
+            msg[(g)%4] = vsha1su1q_u32(vsha1su0q_u32(                   \
+                msg[(g)%4], msg[((g)+1)%4], msg[((g)+2)%4]),            \
+                msg[((g)+3)%4]);                                        \
+        wk = vaddq_u32(msg[(g)%4], vdupq_n_u32(k));                     \
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));                       \
+        abcd = op(abcd, e0, wk);                                        \
+        e0 = e1;                                                        \
+    } while (0)
+#define SHA_ARM_C(g) SHA_ARM_ROUNDS(g, vsha1cq_u32, 0x5a827999)
+#define SHA_ARM_P1(g) SHA_ARM_ROUNDS(g, vsha1pq_u32, 0x6ed9eba1)
+#define SHA_ARM_M(g) SHA_ARM_ROUNDS(g, vsha1mq_u32, 0x8f1bbcdc)
+#define SHA_ARM_P2(g) SHA_ARM_ROUNDS(g, vsha1pq_u32, 0xca62c1d6)
+
+#ifdef __clang__
+__attribute__((target("crypto")))
+#else
+__attribute__((target("+crypto")))
+#endif
+static void SHATransform_arm(uint32 * digest, uint32 * block)
+{
+    uint32x4_t abcd, abcd_save, wk, msg[4];
+    uint32_t e0, e1;
+    int i;
+
+    abcd = vld1q_u32(digest);
+    e0 = digest[4];
+    abcd_save = abcd;
+    for (i = 0; i < 4; i++)
+        msg[i] = vld1q_u32(block + 4*i);
+
+    SHA_ARM_C(0);   SHA_ARM_C(1);   SHA_ARM_C(2);   SHA_ARM_C(3);
+    SHA_ARM_C(4);   SHA_ARM_P1(5);  SHA_ARM_P1(6);  SHA_ARM_P1(7);
+    SHA_ARM_P1(8);  SHA_ARM_P1(9);  SHA_ARM_M(10);  SHA_ARM_M(11);
+    SHA_ARM_M(12);  SHA_ARM_M(13);  SHA_ARM_M(14);  SHA_ARM_P2(15);
+    SHA_ARM_P2(16); SHA_ARM_P2(17); SHA_ARM_P2(18); SHA_ARM_P2(19);
+
+    vst1q_u32(digest, vaddq_u32(abcd, abcd_save));
+    digest[4] += e0;
+}
+
+static bool SHA_hardware_available(void)
+{
+    return (getauxval(AT_HWCAP) & HWCAP_SHA1) != 0;
+}
+
+#define SHATransform_hardware SHATransform_arm
+
+#endif /* SHA_ARM */
+
+static void SHATransform_choose(uint32 * digest, uint32 * block);
+static void (*SHATransform)(uint32 * digest, uint32 * block) =
+    SHATransform_choose;
+
+/*
+ * Pick a transform on first use. As a last line of defence, the
+ * hardware version has to agree with the portable one on a test
+ * block before we trust it. (Racing threads can only ever store the
+ * same answer here.)
+ */
+static void SHATransform_choose(uint32 * digest, uint32 * block)
+{
+    void (*chosen)(uint32 *, uint32 *) = SHATransform_portable;
+
+#ifdef SHATransform_hardware
+    if (SHA_hardware_available()) {
+        uint32 h1[5], h2[5], w[16];
+        int i;
+
+        SHA_Core_Init(h1);
+        SHA_Core_Init(h2);
+        for (i = 0; i < 16; i++)
+            w[i] = 0x9E3779B9U * (i + 1);
+        SHATransform_portable(h1, w);
+        SHATransform_hardware(h2, w);
+        if (!memcmp(h1, h2, sizeof(h1)))
+            chosen = SHATransform_hardware;
+    }
+#endif
+
+    SHATransform = chosen;
+    chosen(digest, block);
+}
+
 /* ----------------------------------------------------------------------
  * Outer SHA algorithm: take an arbitrary length byte string,
  * convert it into 16-word blocks with the prescribed padding at
@@ -205,6 +387,13 @@ struct random_state {
     unsigned char seedbuf[40];
     unsigned char databuf[20];
     int pos;
+    bool fast;               /* if so, only xs[] is used */
+    bool wordwise;           /* fast engine version 2 */
+    uint32 xs[4];
+    random_poll_fn poll;     /* see random_set_poll() */
+    void *pollctx;
+    unsigned long attempts;
+    bool stopped;
 };
 
 random_state *random_new(const char *seed, int len)
@@ -212,6 +401,9 @@ random_state *random_new(const char *seed, int len)
     random_state *state;
 
     state = snew(random_state);
+    state->fast = false;
+    state->wordwise = false;
+    state->poll = NULL;
 
     SHA_Simple(seed, len, state->seedbuf);
     SHA_Simple(state->seedbuf, 20, state->seedbuf + 20);
@@ -221,21 +413,101 @@ random_state *random_new(const char *seed, int len)
     return state;
 }
 
+random_state *random_new_fast(const char *seed, int len)
+{
+    random_state *state;
+    unsigned char digest[20];
+    int i;
+
+    state = snew(random_state);
+    memset(state, 0, sizeof(*state));
+    state->fast = true;
+    state->poll = NULL;
+    SHA_Simple(seed, len, digest);
+    for (i = 0; i < 4; i++)
+        state->xs[i] = ((uint32)digest[i*4] << 24) |
+            ((uint32)digest[i*4+1] << 16) |
+            ((uint32)digest[i*4+2] << 8) | (uint32)digest[i*4+3];
+    if (!(state->xs[0] | state->xs[1] | state->xs[2] | state->xs[3]))
+        state->xs[0] = 1;              /* the one state xoshiro avoids */
+    return state;
+}
+
+random_state *random_new_seed_string(const char *seedstr)
+{
+    int taglen = strlen(RANDOM_FAST_SEED_TAG);
+    random_state *state;
+
+    if (!strncmp(seedstr, RANDOM_FAST_SEED_TAG, taglen)) {
+        state = random_new_fast(seedstr + taglen, strlen(seedstr + taglen));
+        state->wordwise = true;
+        return state;
+    }
+    taglen = strlen(RANDOM_FAST_SEED_TAG_V1);
+    if (!strncmp(seedstr, RANDOM_FAST_SEED_TAG_V1, taglen))
+        return random_new_fast(seedstr + taglen, strlen(seedstr + taglen));
+    return random_new(seedstr, strlen(seedstr));
+}
+
 random_state *random_copy(random_state *tocopy)
 {
     random_state *result;
     result = snew(random_state);
-    memcpy(result->seedbuf, tocopy->seedbuf, sizeof(result->seedbuf));
-    memcpy(result->databuf, tocopy->databuf, sizeof(result->databuf));
-    result->pos = tocopy->pos;
+    *result = *tocopy;
     return result;
 }
 
+void random_set_poll(random_state *state, random_poll_fn poll, void *ctx)
+{
+    state->poll = poll;
+    state->pollctx = ctx;
+    state->attempts = 0;
+    state->stopped = false;
+}
+
+bool random_cancelled(random_state *state)
+{
+    if (!state->poll)
+        return false;
+    if (!state->stopped)
+        state->stopped = state->poll(state->pollctx, ++state->attempts);
+    return state->stopped;
+}
+
+#define rol32(x,y) ( (((uint32)(x)) << (y)) | (((uint32)(x)) >> (32-(y))) )
+
+/* xoshiro128**, by Blackman and Vigna. */
+static uint32 random_fast_next(random_state *state)
+{
+    uint32 *xs = state->xs;
+    uint32 ret = rol32(xs[1] * 5, 7) * 9;
+    uint32 t = xs[1] << 9;
+
+    xs[2] ^= xs[0];
+    xs[3] ^= xs[1];
+    xs[1] ^= xs[2];
+    xs[0] ^= xs[3];
+    xs[2] ^= t;
+    xs[3] = rol32(xs[3], 11);
+    return ret & 0xFFFFFFFFUL;
+}
+
 unsigned long random_bits(random_state *state, int bits)
 {
     unsigned long ret = 0;
     int n;
 
+    if (state->fast) {
+        if (bits <= 32) {
+            ret = random_fast_next(state);
+            return bits < 32 ? ret >> (32 - bits) : ret;
+        }
+        for (n = 0; n < bits; n += 16)
+            ret = (ret << 16) | (random_fast_next(state) >> 16);
+        ret &= (1 << (bits-1)) * 2 - 1;
+        return ret;
+    }
+
     for (n = 0; n < bits; n += 8) {
 	if (state->pos >= 20) {
 	    int i;
@@ -263,20 +535,56 @@ unsigned long random_bits(random_state *state, int bits)
     return ret;
 }
 
+/*
+ * Lemire's bounded draw: the top half of a 32x32-bit product is
+ * uniform on [0,limit) once the few low halves below 2^32 mod limit
+ * have been rejected.
+ */
+static unsigned long random_upto_wordwise(random_state *state, uint32 limit)
+{
+    unsigned long long m = (unsigned long long)random_fast_next(state) * limit;
+
+    if ((uint32)m < limit) {
+        uint32 threshold = (uint32)-limit % limit;
+        while ((uint32)m < threshold)
+            m = (unsigned long long)random_fast_next(state) * limit;
+    }
+    return (unsigned long)(m >> 32);
+}
+
+/*
+ * Set up the rejection sampling for the older bounded draw: we draw
+ * *bits bits and reject anything at or above *max.
+ */
+static unsigned long random_upto_setup(unsigned long limit, int *bits,
+                                       unsigned long *max)
+{
+    unsigned long divisor;
+
+    *bits = 0;
+    while ((limit >> *bits) != 0)
+	(*bits)++;
+
+    *bits += 3;
+    assert(*bits < 32);
+
+    *max = 1L << *bits;
+    divisor = *max / limit;
+    *max = limit * divisor;
+    return divisor;
+}
+
 unsigned long random_upto(random_state *state, unsigned long limit)
 {
-    int bits = 0;
+    int bits;
     unsigned long max, divisor, data;
 
-    while ((limit >> bits) != 0)
-	bits++;
-
-    bits += 3;
-    assert(bits < 32);
+    if (state->wordwise) {
+        assert(limit > 0 && limit <= 0xFFFFFFFFUL);
+        return random_upto_wordwise(state, limit);
+    }
 
-    max = 1L << bits;
-    divisor = max / limit;
-    max = limit * divisor;
+    divisor = random_upto_setup(limit, &bits, &max);
 
     do {
 	data = random_bits(state, bits);
@@ -285,6 +593,30 @@ unsigned long random_upto(random_state *state, unsigned long limit)
     return data / divisor;
 }
 
+void random_fill_upto(random_state *state, unsigned long limit,
+                      int *out, int n)
+{
+    int i, bits;
+    unsigned long max, divisor, data;
+
+    assert(limit > 0 && limit - 1 <= INT_MAX);
+
+    if (state->wordwise) {
+        for (i = 0; i < n; i++)
+            out[i] = random_upto_wordwise(state, limit);
+        return;
+    }
+
+    divisor = random_upto_setup(limit, &bits, &max);
+
+    for (i = 0; i < n; i++) {
+        do {
+            data = random_bits(state, bits);
+        } while (data >= max);
+        out[i] = data / divisor;
+    }
+}
+
 void random_free(random_state *state)
 {
     sfree(state);
@@ -295,6 +627,13 @@ char *random_state_encode(random_state *state)
     char retbuf[256];
     int len = 0, i;
 
+    if (state->fast) {
+        len += sprintf(retbuf+len, state->wordwise ? "Y" : "X");
+        for (i = 0; i < 4; i++)
+            len += sprintf(retbuf+len, "%08lx", (unsigned long)state->xs[i]);
+        return dupstr(retbuf);
+    }
+
     for (i = 0; i < lenof(state->seedbuf); i++)
 	len += sprintf(retbuf+len, "%02x", state->seedbuf[i]);
     for (i = 0; i < lenof(state->databuf); i++)
@@ -311,9 +650,26 @@ random_state *random_state_decode(const char *input)
 
     state = snew(random_state);
 
-    memset(state->seedbuf, 0, sizeof(state->seedbuf));
-    memset(state->databuf, 0, sizeof(state->databuf));
-    state->pos = 0;
+    memset(state, 0, sizeof(*state));
+    state->poll = NULL;
+
+    if (*input == 'X' || *input == 'Y') {
+        int i, j;
+
+        state->fast = true;
+        state->wordwise = (*input == 'Y');
+        input++;
+        for (i = 0; i < 4; i++) {
+            for (j = 0; j < 8 && isxdigit((unsigned char)*input); j++) {
+                int v = *input++;
+                v = isdigit(v) ? v - '0' : tolower(v) - 'a' + 10;
+                state->xs[i] = (state->xs[i] << 4) | v;
+            }
+        }
+        if (!(state->xs[0] | state->xs[1] | state->xs[2] | state->xs[3]))
+            state->xs[0] = 1;
+        return state;
+    }
 
     byte = digits = 0;
     pos = 0;
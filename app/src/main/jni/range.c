@@ -287,10 +287,13 @@ typedef struct move {
 } move;
 enum {M_BLACK = 0, M_WHITE = 1};
 
+struct solver_scratch;
+
 typedef move *(reasoning)(game_state *state,
                           int nclues,
                           const square *clues,
-                          move *buf);
+                          move *buf,
+                          struct solver_scratch *sc);
 
 static reasoning solver_reasoning_not_too_big;
 static reasoning solver_reasoning_adjacency;
@@ -357,12 +360,16 @@ static reasoning *const reasonings[] = {
     solver_reasoning_recursion
 };
 
+static struct solver_scratch *new_scratch(int w, int h);
+static void free_scratch(struct solver_scratch *sc);
+
 static move *do_solve(game_state *state,
                       int nclues,
                       const square *clues,
                       move *move_buffer,
                       int difficulty)
 {
+    struct solver_scratch *sc = new_scratch(state->params.w, state->params.h);
     struct move *buf = move_buffer, *oldbuf;
     int i;
 
@@ -371,11 +378,12 @@ static move *do_solve(game_state *state,
         for (i = 0; i < lenof(reasonings) && i <= difficulty; ++i) {
             /* only recurse if all else fails */
             if (i == DIFF_RECURSION && buf > oldbuf) continue;
-            buf = (*reasonings[i])(state, nclues, clues, buf);
-            if (buf == NULL) return NULL;
+            buf = (*reasonings[i])(state, nclues, clues, buf, sc);
+            if (buf == NULL) break;
         }
-    } while (buf > oldbuf);
+    } while (buf && buf > oldbuf);
 
+    free_scratch(sc);
     return buf;
 }
 
@@ -417,7 +425,8 @@ static void solver_makemove(puzzle_size r, puzzle_size c, int colour,
 static move *solver_reasoning_adjacency(game_state *state,
                                         int nclues,
                                         const square *clues,
-                                        move *buf)
+                                        move *buf,
+                                        struct solver_scratch *sc)
 {
     int r, c, i;
     for (r = 0; r < state->params.h; ++r)
@@ -437,33 +446,159 @@ static int dfs_biconnect_visit(puzzle_size r, puzzle_size c,
                                square *dfs_parent, int *dfs_depth,
                                move **buf);
 
+/*
+ * Connectedness starts with a depth-first search for the cut vertices
+ * of the graph of non-black squares. After that, so long as those
+ * squares stay connected, it can tell whether a square is a cut vertex
+ * just by looking around it: painting it black would cut the white
+ * region in two exactly when two of the separate runs of black (or
+ * off-grid) squares surrounding it are joined up elsewhere, counting
+ * diagonal neighbours and the whole grid edge as joined. So the
+ * solver keeps a dsf of the black squares, with one extra element
+ * for the edge, and only adds the squares painted since last time.
+ */
+struct solver_scratch {
+    int w, h;
+    move *seen;      /* buffer position when connectedness last ran */
+    bool local;      /* true if the local test is usable */
+    DSF *blacks;     /* squares are joined only once added */
+    bool *added;
+};
+
+static struct solver_scratch *new_scratch(int w, int h)
+{
+    struct solver_scratch *sc = snew(struct solver_scratch);
+
+    sc->w = w;
+    sc->h = h;
+    sc->seen = NULL;
+    sc->local = false;
+    sc->blacks = dsf_new(w * h + 1);
+    sc->added = snewn(w * h, bool);
+    return sc;
+}
+
+static void free_scratch(struct solver_scratch *sc)
+{
+    dsf_free(sc->blacks);
+    sfree(sc->added);
+    sfree(sc);
+}
+
+/* clockwise from above, so that odd entries are the corners */
+static int const dr8[8] = {-1, -1,  0, +1, +1, +1,  0, -1};
+static int const dc8[8] = { 0, +1, +1, +1,  0, -1, -1, -1};
+
+/* Returns the dsf class of the black run at square (r, c), or -1 if
+ * it's not black as far as the dsf knows. */
+static int black_class(struct solver_scratch *sc, int r, int c)
+{
+    if (out_of_bounds(r, c, sc->w, sc->h))
+        return dsf_find(sc->blacks, sc->w * sc->h);
+    if (!sc->added[idx(r, c, sc->w)]) return -1;
+    return dsf_find(sc->blacks, idx(r, c, sc->w));
+}
+
+static bool is_cut_vertex(struct solver_scratch *sc, int r, int c)
+{
+    int cls[8], runs[4], nruns = 0, start, j, k;
+
+    for (j = 0; j < 8; ++j)
+        cls[j] = black_class(sc, r + dr8[j], c + dc8[j]);
+    /* a corner between two black sides joins them whatever it is */
+    for (j = 1; j < 8; j += 2)
+        if (cls[j] < 0 && cls[j-1] >= 0 && cls[(j+1) % 8] >= 0)
+            cls[j] = cls[j-1];
+
+    for (start = 0; start < 8 && cls[start] >= 0; ++start);
+    if (start == 8) return false;
+
+    for (j = 1; j <= 8; ++j) {
+        int const here = cls[(start + j) % 8];
+        if (here < 0 || cls[(start + j - 1) % 8] >= 0) continue;
+        for (k = 0; k < nruns; ++k)
+            if (runs[k] == here) return true;
+        runs[nruns++] = here;
+    }
+    return false;
+}
+
+static void add_black(struct solver_scratch *sc, int i)
+{
+    int const w = sc->w, h = sc->h, r = i / w, c = i % w;
+    int j;
+
+    sc->added[i] = true;
+    for (j = 0; j < 8; ++j) {
+        int const rr = r + dr8[j], cc = c + dc8[j];
+        if (out_of_bounds(rr, cc, w, h))
+            dsf_union(sc->blacks, i, w * h);
+        else if (sc->added[idx(rr, cc, w)])
+            dsf_union(sc->blacks, i, idx(rr, cc, w));
+    }
+}
+
 static move *solver_reasoning_connectedness(game_state *state,
                                             int nclues,
                                             const square *clues,
-                                            move *buf)
+                                            move *buf,
+                                            struct solver_scratch *sc)
 {
     int const w = state->params.w, h = state->params.h, n = w * h;
-
-    square *const dfs_parent = snewn(n, square);
-    int *const dfs_depth = snewn(n, int);
-
+    move *it;
     int i;
-    for (i = 0; i < n; ++i) {
-        dfs_parent[i].r = NOT_VISITED;
-        dfs_depth[i] = -n;
+
+    if (sc->seen) {
+        bool changed = false;
+        for (it = sc->seen; it < buf; ++it) {
+            if (it->colour != M_BLACK) continue;
+            changed = true;
+            if (!sc->local) continue;
+            /* cutting the white region in two spoils the local test */
+            if (is_cut_vertex(sc, it->square.r, it->square.c))
+                sc->local = false;
+            add_black(sc, idx(it->square.r, it->square.c, w));
+        }
+        if (!changed) return buf;
+    } else {
+        for (i = 0; i < n; ++i) sc->added[i] = false;
+        for (i = 0; i < n; ++i)
+            if (state->grid[i] == BLACK) add_black(sc, i);
     }
 
-    for (i = 0; i < n && state->grid[i] == BLACK; ++i);
+    if (sc->local) {
+        for (i = 0; i < n; ++i)
+            if (state->grid[i] == EMPTY && is_cut_vertex(sc, i / w, i % w))
+                solver_makemove(i / w, i % w, M_WHITE, state, &buf);
+    } else {
+        square *const dfs_parent = snewn(n, square);
+        int *const dfs_depth = snewn(n, int);
+        bool connected = true;
+
+        for (i = 0; i < n; ++i) {
+            dfs_parent[i].r = NOT_VISITED;
+            dfs_depth[i] = -n;
+        }
+
+        for (i = 0; i < n && state->grid[i] == BLACK; ++i);
+
+        dfs_parent[i].r = i / w;
+        dfs_parent[i].c = i % w; /* `dfs root`.parent == `dfs root` */
+        dfs_depth[i] = 0;
 
-    dfs_parent[i].r = i / w;
-    dfs_parent[i].c = i % w; /* `dfs root`.parent == `dfs root` */
-    dfs_depth[i] = 0;
+        dfs_biconnect_visit(i / w, i % w, state, dfs_parent, dfs_depth, &buf);
 
-    dfs_biconnect_visit(i / w, i % w, state, dfs_parent, dfs_depth, &buf);
+        for (i = 0; i < n; ++i)
+            if (state->grid[i] != BLACK && dfs_parent[i].r == NOT_VISITED)
+                connected = false;
+        /* once disconnected, the white region stays that way */
+        sc->local = !sc->seen && connected;
 
-    sfree(dfs_parent);
-    sfree(dfs_depth);
+        sfree(dfs_parent);
+        sfree(dfs_depth);
+    }
 
+    sc->seen = buf;
     return buf;
 }
 
@@ -511,7 +646,8 @@ static int dfs_biconnect_visit(puzzle_size r, puzzle_size c,
 static move *solver_reasoning_not_too_big(game_state *state,
                                           int nclues,
                                           const square *clues,
-                                          move *buf)
+                                          move *buf,
+                                          struct solver_scratch *sc)
 {
     int const w = state->params.w, runmasks[4] = {
         ~(MASK(BLACK) | MASK(EMPTY)),
@@ -596,7 +732,8 @@ static move *solver_reasoning_not_too_big(game_state *state,
 static move *solver_reasoning_recursion(game_state *state,
                                         int nclues,
                                         const square *clues,
-                                        move *buf)
+                                        move *buf,
+                                        struct solver_scratch *sc)
 {
     int const w = state->params.w, n = w * state->params.h;
     int cell, colour;
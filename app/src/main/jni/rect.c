@@ -258,7 +258,7 @@ struct numberdata {
 
 static void remove_rect_placement(int w, int h,
                                   struct rectlist *rectpositions,
-                                  int *overlaps,
+                                  int *overlaps, int *cellrects,
                                   int rectnum, int placement)
 {
     int x, y, xx, yy;
@@ -273,7 +273,8 @@ static void remove_rect_placement(int w, int h,
 
     /*
      * Decrement each entry in the overlaps array to reflect the
-     * removal of this rectangle placement.
+     * removal of this rectangle placement, and keep cellrects up to
+     * date with any square this rectangle can no longer reach.
      */
     for (yy = 0; yy < rectpositions[rectnum].rects[placement].h; yy++) {
         y = yy + rectpositions[rectnum].rects[placement].y;
@@ -282,8 +283,9 @@ static void remove_rect_placement(int w, int h,
 
             assert(overlaps[(rectnum * h + y) * w + x] != 0);
 
-            if (overlaps[(rectnum * h + y) * w + x] > 0)
-                overlaps[(rectnum * h + y) * w + x]--;
+            if (overlaps[(rectnum * h + y) * w + x] > 0 &&
+                --overlaps[(rectnum * h + y) * w + x] == 0)
+                cellrects[y * w + x]--;
         }
     }
 
@@ -334,7 +336,8 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
 		       random_state *rs)
 {
     struct rectlist *rectpositions;
-    int *overlaps, *rectbyplace, *workspace;
+    int *overlaps, *cellrects, *rectbyplace, *workspace, *touched;
+    bool *rectdirty;
     int i, ret;
 
     /*
@@ -487,7 +490,39 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
         }
     }
 
+    /*
+     * cellrects counts, for each square, the rectangles which still
+     * have a candidate placement covering it (that is, which have a
+     * positive overlaps entry there), so that square-focused
+     * deduction need not look through every rectangle at every
+     * square. It is only meaningful for squares not yet known.
+     */
+    cellrects = snewn(w * h, int);
+    for (i = 0; i < w*h; i++) {
+        int j;
+
+        cellrects[i] = 0;
+        for (j = 0; j < nrects; j++)
+            if (overlaps[j * w * h + i] > 0)
+                cellrects[i]++;
+    }
+
+    /*
+     * Whether a placement survives rectangle-focused deduction
+     * depends only on which squares are known and on the candidate
+     * number placements, so a rectangle need only be looked at
+     * again once one of those has changed under one of its
+     * placements. rectdirty records which rectangles that has
+     * happened to.
+     */
+    rectdirty = snewn(nrects, bool);
+    for (i = 0; i < nrects; i++)
+        rectdirty[i] = true;
+
     workspace = snewn(nrects, int);
+    touched = snewn(nrects, int);
+    for (i = 0; i < nrects; i++)
+        workspace[i] = 0;
 
     /*
      * Now run the actual deduction loop.
@@ -543,8 +578,11 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                            " (sole remaining number position)\n", x, y, i);
 #endif
 
-                    for (j = 0; j < nrects; j++)
+                    for (j = 0; j < nrects; j++) {
+                        if (overlaps[(j * h + y) * w + x] != -1)
+                            rectdirty[j] = true;
                         overlaps[(j * h + y) * w + x] = -1;
+                    }
                     
                     overlaps[(i * h + y) * w + x] = -2;
                 }
@@ -589,8 +627,11 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                                xx, yy, i);
 #endif
 
-                        for (j = 0; j < nrects; j++)
+                        for (j = 0; j < nrects; j++) {
+                            if (overlaps[(j * h + yy) * w + xx] != -1)
+                                rectdirty[j] = true;
                             overlaps[(j * h + yy) * w + xx] = -1;
+                        }
                     
                         overlaps[(i * h + yy) * w + xx] = -2;
                     }
@@ -604,13 +645,14 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
         for (i = 0; i < nrects; i++) {
             int j;
 
+            if (!rectdirty[i])
+                continue;
+            rectdirty[i] = false;
+
             for (j = 0; j < rectpositions[i].n; j++) {
-                int xx, yy, k;
+                int xx, yy, k, m, ntouched = 0;
                 bool del = false;
 
-                for (k = 0; k < nrects; k++)
-                    workspace[k] = 0;
-
                 for (yy = 0; yy < rectpositions[i].rects[j].h; yy++) {
                     int y = yy + rectpositions[i].rects[j].y;
                     for (xx = 0; xx < rectpositions[i].rects[j].w; xx++) {
@@ -639,9 +681,14 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                             /*
                              * This placement overlaps one of the
                              * candidate number placements for some
-                             * rectangle. Count it.
+                             * rectangle. Count it, remembering
+                             * which rectangles we've counted for so
+                             * that only those need checking and
+                             * clearing afterwards.
                              */
-                            workspace[rectbyplace[y * w + x]]++;
+                            k = rectbyplace[y * w + x];
+                            if (!workspace[k]++)
+                                touched[ntouched++] = k;
                         }
                     }
                 }
@@ -653,7 +700,8 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                      * candidate number placements for any
                      * rectangle. If so, we can rule it out.
                      */
-                    for (k = 0; k < nrects; k++)
+                    for (m = 0; m < ntouched; m++) {
+                        k = touched[m];
                         if (k != i && workspace[k] == numbers[k].npoints) {
 #ifdef SOLVER_DIAGNOSTICS
                             printf("rect %d placement at %d,%d w=%d h=%d "
@@ -668,6 +716,7 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                             del = true;
                             break;
                         }
+                    }
 
                     /*
                      * Failing that, see if it overlaps at least
@@ -690,8 +739,12 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                     }
                 }
 
+                for (m = 0; m < ntouched; m++)
+                    workspace[touched[m]] = 0;
+
                 if (del) {
-                    remove_rect_placement(w, h, rectpositions, overlaps, i, j);
+                    remove_rect_placement(w, h, rectpositions, overlaps,
+                                          cellrects, i, j);
 
                     j--;               /* don't skip over next placement */
 
@@ -706,22 +759,21 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
          * part of a single rectangle.
          */
         {
-            int x, y, n, index;
+            int x, y, index;
             for (y = 0; y < h; y++) for (x = 0; x < w; x++) {
                 /* Known squares are marked as <0 everywhere, so we only need
                  * to check the overlaps entry for rect 0. */
                 if (overlaps[y * w + x] < 0)
                     continue;          /* known already */
 
-                n = 0;
-                index = -1;
-                for (i = 0; i < nrects; i++)
-                    if (overlaps[(i * h + y) * w + x] > 0)
-                        n++, index = i;
-
-                if (n == 1) {
+                if (cellrects[y * w + x] == 1) {
                     int j;
 
+                    for (index = 0; index < nrects; index++)
+                        if (overlaps[(index * h + y) * w + x] > 0)
+                            break;
+                    assert(index < nrects);
+
                     /*
                      * Now we can rule out all placements for
                      * rectangle `index' which _don't_ contain
@@ -737,7 +789,7 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                             y >= r->y && y < r->y + r->h)
                             continue;  /* this one is OK */
                         remove_rect_placement(w, h, rectpositions, overlaps,
-                                              index, j);
+                                              cellrects, index, j);
                         j--;           /* don't skip over next placement */
                         done_something = true;
                     }
@@ -811,7 +863,7 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                  * placements, and eliminate it.
                  */
                 int index = random_upto(rs, nrpns);
-                int k, m;
+                int k, m, oldnpoints;
                 struct rpn rpn = rpns[index];
                 struct rect r;
                 sfree(rpns);
@@ -820,6 +872,7 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                 j = rpn.placement;
                 k = rpn.number;
                 r = rectpositions[i].rects[j];
+                oldnpoints = numbers[k].npoints;
 
                 /*
                  * We rule out placement j of rectangle i by means
@@ -850,6 +903,25 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
                         done_something = true;
                     }
                 }
+
+                /*
+                 * That changes the number counts checked against any
+                 * placement covering one of rectangle k's number
+                 * placements, whether kept or just removed (the
+                 * removed ones are still in the array, past the end
+                 * of the live ones).
+                 */
+                for (m = 0; m < oldnpoints; m++) {
+                    int x = numbers[k].points[m].x;
+                    int y = numbers[k].points[m].y;
+                    int n;
+
+                    for (n = 0; n < nrects; n++)
+                        if (overlaps[(n * h + y) * w + x] != 0 &&
+                            overlaps[(n * h + y) * w + x] != -1)
+                            rectdirty[n] = true;
+                }
+                rectdirty[k] = true;
             }
         }
 
@@ -898,7 +970,10 @@ static int rect_solver(int w, int h, int nrects, struct numberdata *numbers,
      * Free up all allocated storage.
      */
     sfree(workspace);
+    sfree(touched);
+    sfree(rectdirty);
     sfree(rectbyplace);
+    sfree(cellrects);
     sfree(overlaps);
     for (i = 0; i < nrects; i++)
         sfree(rectpositions[i].rects);
@@ -904,11 +904,20 @@ static void gen_grid_random(int w, int h, int nc, int *grid, random_state *rs)
     }
 
     /*
-     * Fill in the rest of the grid at random.
+     * Fill in the rest of the grid at random, drawing all the
+     * colours in one batch.
      */
-    for (i = 0; i < n; i++) {
-	if (grid[i] == 0)
-	    grid[i] = (int)random_upto(rs, nc)+1;
+    {
+	int *cols = snewn(n, int);
+
+	for (i = j = 0; i < n; i++)
+	    if (grid[i] == 0)
+		j++;
+	random_fill_upto(rs, nc, cols, j);
+	for (i = j = 0; i < n; i++)
+	    if (grid[i] == 0)
+		grid[i] = cols[j++] + 1;
+	sfree(cols);
     }
 }
 
@@ -0,0 +1,323 @@
+/*
+ * search.c: a bounded depth-first search for puzzle solutions, for
+ * generators that only need to know whether a puzzle has no
+ * solution, one, or more than one.
+ *
+ * The caller describes its search through a set of callbacks (see
+ * puzzles.h), and makes every change to its state through
+ * search_save or search_set_int. Those record the old contents on a
+ * trail, so that backing out of a branch is a matter of copying the
+ * saved bytes back, newest first, rather than keeping a copy of the
+ * whole state for every level of the search.
+ *
+ * The trail is a single growable byte buffer. Each entry is the
+ * saved bytes, padded to a multiple of the header alignment,
+ * followed by a header giving the address and length, so that
+ * entries can be popped from the end without any other bookkeeping.
+ *
+ * With PARALLEL_GENERATION, a search whose ops can duplicate their
+ * context may also share out the branches at its root among several
+ * threads (see search_split).
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "puzzles.h"
+
+#ifdef PARALLEL_GENERATION
+#include <pthread.h>
+#endif
+
+struct search_entry {
+    void *where;
+    size_t len;
+};
+
+#define SEARCH_PAD(len) \
+    (((len) + sizeof(struct search_entry) - 1) / \
+     sizeof(struct search_entry) * sizeof(struct search_entry))
+
+struct search_shared;
+
+struct searcher {
+    unsigned char *trail;
+    size_t used, size;
+
+    const struct search_ops *ops;
+    void *ctx;
+    int limit, found;
+    unsigned long nodes;
+    int threads;
+    struct search_shared *shared;   /* non-NULL in a root-split worker */
+};
+
+static THREAD_LOCAL int search_default_threads = 1;
+
+void search_set_default_threads(int nthreads)
+{
+    search_default_threads = nthreads < 1 ? 1 : nthreads;
+}
+
+searcher *search_new(void)
+{
+    searcher *s = snew(searcher);
+    s->trail = NULL;
+    s->used = s->size = 0;
+    s->ops = NULL;
+    s->ctx = NULL;
+    s->limit = s->found = 0;
+    s->nodes = 0;
+    s->threads = search_default_threads;
+    s->shared = NULL;
+    return s;
+}
+
+void search_free(searcher *s)
+{
+    if (!s)
+        return;
+    sfree(s->trail);
+    sfree(s);
+}
+
+void search_save(searcher *s, void *where, size_t len)
+{
+    struct search_entry e;
+    size_t need = SEARCH_PAD(len) + sizeof(e);
+
+    if (s->size - s->used < need) {
+        s->size = s->size * 2 > s->used + need ?
+            s->size * 2 : s->used + need + 256;
+        s->trail = sresize(s->trail, s->size, unsigned char);
+    }
+
+    memcpy(s->trail + s->used, where, len);
+    s->used += SEARCH_PAD(len);
+    e.where = where;
+    e.len = len;
+    memcpy(s->trail + s->used, &e, sizeof(e));
+    s->used += sizeof(e);
+}
+
+void search_set_int(searcher *s, int *where, int value)
+{
+    if (*where != value) {
+        search_save(s, where, sizeof(int));
+        *where = value;
+    }
+}
+
+static void search_undo(searcher *s, size_t mark)
+{
+    while (s->used > mark) {
+        struct search_entry e;
+
+        s->used -= sizeof(e);
+        memcpy(&e, s->trail + s->used, sizeof(e));
+        s->used -= SEARCH_PAD(e.len);
+        memcpy(e.where, s->trail + s->used, e.len);
+    }
+}
+
+#ifdef PARALLEL_GENERATION
+/*
+ * State shared between the threads of a root split. Solutions are
+ * counted, and reported to the solution callback, under the lock;
+ * found is also read without it to notice when to stop.
+ */
+struct search_shared {
+    pthread_mutex_t lock;
+    int found;                  /* accessed atomically outside lock */
+    int next;                   /* next root choice, accessed atomically */
+    int nchoices, where;
+};
+#endif
+
+static bool search_stopped(const searcher *s)
+{
+#ifdef PARALLEL_GENERATION
+    if (s->shared)
+        return __atomic_load_n(&s->shared->found, __ATOMIC_RELAXED) >=
+            s->limit;
+#endif
+    return s->found >= s->limit;
+}
+
+static void search_found(searcher *s)
+{
+#ifdef PARALLEL_GENERATION
+    if (s->shared) {
+        pthread_mutex_lock(&s->shared->lock);
+        /* a solution found after another thread reached the limit
+         * is dropped, so that the count never exceeds it */
+        if (s->shared->found < s->limit) {
+            __atomic_store_n(&s->shared->found, s->shared->found + 1,
+                             __ATOMIC_RELAXED);
+            if (s->ops->solution)
+                s->ops->solution(s, s->ctx);
+        }
+        pthread_mutex_unlock(&s->shared->lock);
+        return;
+    }
+#endif
+    s->found++;
+    if (s->ops->solution)
+        s->ops->solution(s, s->ctx);
+}
+
+#ifdef PARALLEL_GENERATION
+static void search_node(searcher *s, int depth);
+
+/*
+ * Each thread of a root split, including the one that started it,
+ * repeatedly takes the next untried root choice until there are
+ * none left or enough solutions have been found. Threads that run
+ * out of choices early simply stop, so the work is balanced at the
+ * granularity of whole root subtrees.
+ */
+static void search_split_work(searcher *s)
+{
+    struct search_shared *sh = s->shared;
+
+    while (!search_stopped(s)) {
+        int i = __atomic_fetch_add(&sh->next, 1, __ATOMIC_RELAXED);
+        size_t mark = s->used;
+
+        if (i >= sh->nchoices)
+            break;
+        if (s->ops->choose(s, s->ctx, sh->where, i))
+            search_node(s, 1);
+        search_undo(s, mark);
+    }
+}
+
+static void *search_split_run(void *vs)
+{
+    search_split_work((searcher *)vs);
+    return NULL;
+}
+
+/*
+ * Share out the root's choices among up to s->threads threads. Each
+ * extra thread works on its own copy of the context, made before
+ * any choice is tried; if a thread can't be started, the others
+ * just take on its share.
+ */
+static void search_split(searcher *s, int nchoices, int where)
+{
+    struct search_shared sh;
+    int nworkers = (s->threads < nchoices ? s->threads : nchoices) - 1;
+    searcher **workers = snewn(nworkers, searcher *);
+    pthread_t *threads = snewn(nworkers, pthread_t);
+    int i, started = 0;
+
+    pthread_mutex_init(&sh.lock, NULL);
+    sh.found = 0;
+    sh.next = 0;
+    sh.nchoices = nchoices;
+    sh.where = where;
+    s->shared = &sh;
+
+    for (i = 0; i < nworkers; i++) {
+        searcher *w = search_new();
+        w->ops = s->ops;
+        w->ctx = s->ops->dup_ctx(s->ctx);
+        w->limit = s->limit;
+        w->shared = &sh;
+        if (pthread_create(&threads[started], NULL, search_split_run, w)) {
+            s->ops->free_ctx(w->ctx);
+            search_free(w);
+            break;
+        }
+        workers[started++] = w;
+    }
+
+    search_split_work(s);
+
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        s->nodes += workers[i]->nodes;
+        s->ops->free_ctx(workers[i]->ctx);
+        search_free(workers[i]);
+    }
+
+    s->shared = NULL;
+    s->found = sh.found;
+    pthread_mutex_destroy(&sh.lock);
+    sfree(threads);
+    sfree(workers);
+}
+#endif
+
+static void search_node(searcher *s, int depth)
+{
+    const struct search_ops *ops = s->ops;
+    int nchoices, where, i;
+
+    s->nodes++;
+    if (ops->node)
+        ops->node(s, s->ctx, depth);
+
+    if (ops->propagate && !ops->propagate(s, s->ctx))
+        return;
+
+    nchoices = ops->branch(s, s->ctx, &where);
+    if (nchoices == 0) {
+        search_found(s);
+        return;
+    }
+
+#ifdef PARALLEL_GENERATION
+    if (depth == 0 && s->threads > 1 && nchoices > 1 && ops->dup_ctx) {
+        search_split(s, nchoices, where);
+        return;
+    }
+#endif
+
+    for (i = 0; i < nchoices && !search_stopped(s); i++) {
+        size_t mark = s->used;
+
+        if (ops->choose(s, s->ctx, where, i))
+            search_node(s, depth + 1);
+        search_undo(s, mark);
+    }
+}
+
+int search_run(searcher *s, const struct search_ops *ops, void *ctx,
+               int limit)
+{
+    size_t mark = s->used;
+
+    assert(limit > 0);
+    s->ops = ops;
+    s->ctx = ctx;
+    s->limit = limit;
+    s->found = 0;
+    search_node(s, 0);
+    search_undo(s, mark);
+
+    return s->found;
+}
+
+void search_set_threads(searcher *s, int nthreads)
+{
+    s->threads = nthreads < 1 ? 1 : nthreads;
+}
+
+int search_solutions(const searcher *s)
+{
+#ifdef PARALLEL_GENERATION
+    if (s->shared)
+        return s->shared->found;
+#endif
+    return s->found;
+}
+
+unsigned long search_nodes(const searcher *s)
+{
+    return s->nodes;
+}
+
+/* vim: set shiftwidth=4 tabstop=8: */
@@ -147,47 +147,54 @@ static bool move_couldfit(
     return sz <= gap;
 }
 
-static bool isvalidmove(const game_state *state, bool clever,
-                        int fromx, int fromy, int tox, int toy)
+/* The checks in isvalidmove beyond the geometry and the loop test:
+ * whether 'from' may be linked to 'to' given the numbers on both. */
+static bool isvalidlink(const game_state *state, bool clever,
+                        int from, int to)
 {
-    int w = state->w, from = fromy*w+fromx, to = toy*w+tox;
-    int nfrom, nto;
-
-    if (!INGRID(state, fromx, fromy) || !INGRID(state, tox, toy))
-        return false;
-
-    /* can only move where we point */
-    if (!ispointing(state, fromx, fromy, tox, toy))
-        return false;
-
-    nfrom = state->nums[from]; nto = state->nums[to];
+    int w = state->w, nfrom = state->nums[from], nto = state->nums[to];
 
     /* can't move _from_ the preset final number, or _to_ the preset 1. */
     if (((nfrom == state->n) && (state->flags[from] & FLAG_IMMUTABLE)) ||
         ((nto   == 1)        && (state->flags[to]   & FLAG_IMMUTABLE)))
         return false;
 
-    /* can't create a new connection between cells in the same region
-     * as that would create a loop. */
-    if (dsf_canonify(state->dsf, from) == dsf_canonify(state->dsf, to))
-        return false;
-
     /* if both cells are actual numbers, can't drag if we're not
      * one digit apart. */
     if (ISREALNUM(state, nfrom) && ISREALNUM(state, nto)) {
         if (nfrom != nto-1)
             return false;
     } else if (clever && ISREALNUM(state, nfrom)) {
-        if (!move_couldfit(state, nfrom, +1, tox, toy))
+        if (!move_couldfit(state, nfrom, +1, to%w, to/w))
             return false;
     } else if (clever && ISREALNUM(state, nto)) {
-        if (!move_couldfit(state, nto, -1, fromx, fromy))
+        if (!move_couldfit(state, nto, -1, from%w, from/w))
             return false;
     }
 
     return true;
 }
 
+static bool isvalidmove(const game_state *state, bool clever,
+                        int fromx, int fromy, int tox, int toy)
+{
+    int w = state->w, from = fromy*w+fromx, to = toy*w+tox;
+
+    if (!INGRID(state, fromx, fromy) || !INGRID(state, tox, toy))
+        return false;
+
+    /* can only move where we point */
+    if (!ispointing(state, fromx, fromy, tox, toy))
+        return false;
+
+    /* can't create a new connection between cells in the same region
+     * as that would create a loop. */
+    if (dsf_canonify(state->dsf, from) == dsf_canonify(state->dsf, to))
+        return false;
+
+    return isvalidlink(state, clever, from, to);
+}
+
 static void makelink(game_state *state, int from, int to)
 {
     if (state->next[from] != -1)
@@ -1249,11 +1256,63 @@ static game_state *new_game(midend *me, const game_params *params,
 
 /* --- Solver --- */
 
+/*
+ * The squares each arrow could link to never change during a solve, so
+ * we list them once and then only ever shrink the lists. Once a pass
+ * starts with a link in place, no later pass can break it (makelink
+ * is only ever asked to link a square with no next to one with no
+ * prev), so a target that has gained a prev, or that has joined our
+ * own chain, is gone for good and can be dropped.
+ */
+struct solver_scratch {
+    int *raystart, *raylen;     /* size n: candidates for cell i are */
+    int *rays;                  /*   rays[raystart[i] .. +raylen[i]] */
+    int *from;                  /* size n */
+    int *root;                  /* size n: chain of each cell this pass */
+};
+
+static struct solver_scratch *new_scratch(game_state *state)
+{
+    struct solver_scratch *sc = snew(struct solver_scratch);
+    int i, x, y, d, w = state->w, nrays = 0;
+
+    sc->raystart = snewn(state->n, int);
+    sc->raylen = snewn(state->n, int);
+    sc->rays = snewn(state->n * max(state->w, state->h), int);
+    sc->from = snewn(state->n, int);
+    sc->root = snewn(state->n, int);
+
+    for (i = 0; i < state->n; i++) {
+        sc->raystart[i] = nrays;
+        d = state->dirs[i];
+        x = i%w; y = i/w;
+        while (1) {
+            x += dxs[d]; y += dys[d];
+            if (!INGRID(state, x, y)) break;
+            sc->rays[nrays++] = y*w+x;
+        }
+        sc->raylen[i] = nrays - sc->raystart[i];
+    }
+    return sc;
+}
+
+static void free_scratch(struct solver_scratch *sc)
+{
+    sfree(sc->raystart);
+    sfree(sc->raylen);
+    sfree(sc->rays);
+    sfree(sc->from);
+    sfree(sc->root);
+    sfree(sc);
+}
+
 /* If a tile has a single tile it can link _to_, or there's only a single
  * location that can link to a given tile, fill that link in. */
-static int solve_single(game_state *state, game_state *copy, int *from)
+static int solve_single(game_state *state, game_state *copy,
+                        struct solver_scratch *sc)
 {
-    int i, j, sx, sy, x, y, d, poss, w=state->w, nlinks = 0;
+    int i, j, k, n, poss, nlinks = 0;
+    int *from = sc->from, *root = sc->root, *ray;
 
     /* The from array is a list of 'which square can link _to_ us';
      * we start off with from as '-1' (meaning 'not found'); if we find
@@ -1261,6 +1320,8 @@ static int solve_single(game_state *state, game_state *copy, int *from)
      * we find another we set it to -2. */
 
     memset(from, -1, state->n*sizeof(int));
+    for (i = 0; i < state->n; i++)
+        root[i] = dsf_canonify(state->dsf, i);
 
     /* poss is 'can I link to anything' with the same meanings. */
 
@@ -1268,18 +1329,18 @@ static int solve_single(game_state *state, game_state *copy, int *from)
         if (state->next[i] != -1) continue;
         if (state->nums[i] == state->n) continue; /* no next from last no. */
 
-        d = state->dirs[i];
         poss = -1;
-        sx = x = i%w; sy = y = i/w;
-        while (1) {
-            x += dxs[d]; y += dys[d];
-            if (!INGRID(state, x, y)) break;
-            if (!isvalidmove(state, true, sx, sy, x, y)) continue;
+        ray = sc->rays + sc->raystart[i];
+        for (k = n = 0; k < sc->raylen[i]; k++) {
+            j = ray[k];
 
             /* can't link to somewhere with a back-link we would have to
-             * break (the solver just doesn't work like this). */
-            j = y*w+x;
-            if (state->prev[j] != -1) continue;
+             * break (the solver just doesn't work like this), nor into
+             * our own chain; neither will ever be possible again. */
+            if (state->prev[j] != -1 || root[j] == root[i]) continue;
+            ray[n++] = j;
+
+            if (!isvalidlink(state, true, i, j)) continue;
 
             if (state->nums[i] > 0 && state->nums[j] > 0 &&
                 state->nums[i] <= state->n && state->nums[j] <= state->n &&
@@ -1287,6 +1348,8 @@ static int solve_single(game_state *state, game_state *copy, int *from)
                 debug(("Solver: forcing link through existing consecutive numbers."));
                 poss = j;
                 from[j] = i;
+                /* keep the rest of the list as it is */
+                while (++k < sc->raylen[i]) ray[n++] = ray[k];
                 break;
             }
 
@@ -1298,16 +1361,20 @@ static int solve_single(game_state *state, game_state *copy, int *from)
              * what points to 'j' in a similar way). */
             from[j] = (from[j] == -1) ? i : -2;
         }
+        sc->raylen[i] = n;
+
         if (poss == -2) {
-            /*debug(("Solver: (%d,%d) has multiple possible next squares.", sx, sy));*/
+            /*debug(("Solver: (%d,%d) has multiple possible next squares.",
+                     i%state->w, i/state->w));*/
             ;
         } else if (poss == -1) {
-            debug(("Solver: nowhere possible for (%d,%d) to link to.", sx, sy));
+            debug(("Solver: nowhere possible for (%d,%d) to link to.",
+                   i%state->w, i/state->w));
             copy->impossible = true;
             return -1;
         } else {
             debug(("Solver: linking (%d,%d) to only possible next (%d,%d).",
-                   sx, sy, poss%w, poss/w));
+                   i%state->w, i/state->w, poss%state->w, poss/state->w));
             makelink(copy, i, poss);
             nlinks++;
         }
@@ -1317,17 +1384,18 @@ static int solve_single(game_state *state, game_state *copy, int *from)
         if (state->prev[i] != -1) continue;
         if (state->nums[i] == 1) continue; /* no prev from 1st no. */
 
-        x = i%w; y = i/w;
         if (from[i] == -1) {
-            debug(("Solver: nowhere possible to link to (%d,%d)", x, y));
+            debug(("Solver: nowhere possible to link to (%d,%d)",
+                   i%state->w, i/state->w));
             copy->impossible = true;
             return -1;
         } else if (from[i] == -2) {
-            /*debug(("Solver: (%d,%d) has multiple possible prev squares.", x, y));*/
+            /*debug(("Solver: (%d,%d) has multiple possible prev squares.",
+                     i%state->w, i/state->w));*/
             ;
         } else {
             debug(("Solver: linking only possible prev (%d,%d) to (%d,%d).",
-                   from[i]%w, from[i]/w, x, y));
+                   from[i]%state->w, from[i]/state->w, i%state->w, i/state->w));
             makelink(copy, from[i], i);
             nlinks++;
         }
@@ -1340,21 +1408,22 @@ static int solve_single(game_state *state, game_state *copy, int *from)
 static int solve_state(game_state *state)
 {
     game_state *copy = dup_game(state);
-    int *scratch = snewn(state->n, int), ret;
+    struct solver_scratch *sc = new_scratch(state);
+    int ret;
 
     debug_state("Before solver: ", state);
 
     while (1) {
         update_numbers(state);
 
-        if (solve_single(state, copy, scratch)) {
+        if (solve_single(state, copy, sc)) {
             dup_game_to(state, copy);
             if (state->impossible) break; else continue;
         }
         break;
     }
     free_game(copy);
-    sfree(scratch);
+    free_scratch(sc);
 
     update_numbers(state);
     ret = state->impossible ? -1 : check_completion(state, false);
@@ -612,6 +612,7 @@ struct solver_state {
     struct solver_op *ops;
     int n_ops, n_alloc;
     int *scratch;
+    DSF *blacks; /* see solve_splitswhite */
 };
 
 static struct solver_state *solver_state_new(game_state *state)
@@ -621,6 +622,7 @@ static struct solver_state *solver_state_new(game_state *state)
     ss->ops = NULL;
     ss->n_ops = ss->n_alloc = 0;
     ss->scratch = snewn(state->n, int);
+    ss->blacks = dsf_new(state->n + 1);
 
     return ss;
 }
@@ -628,6 +630,7 @@ static struct solver_state *solver_state_new(game_state *state)
 static void solver_state_free(struct solver_state *ss)
 {
     sfree(ss->scratch);
+    dsf_free(ss->blacks);
     if (ss->ops) sfree(ss->ops);
     sfree(ss);
 }
@@ -1041,33 +1044,97 @@ static bool solve_hassinglewhiteregion(
     return (szwhite == nwhite);
 }
 
+/* Clockwise from above; odd entries are the diagonals. */
+static const int dxs8[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const int dys8[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+/* Returns the class of a black (or off-grid) square in ss->blacks,
+ * or -1 if it's white. */
+static int solve_blackclass(game_state *state, struct solver_state *ss,
+                            int x, int y)
+{
+    if (!INGRID(state, x, y))
+        return dsf_find(ss->blacks, state->n);
+    if (!(state->flags[y*state->w + x] & F_BLACK))
+        return -1;
+    return dsf_find(ss->blacks, y*state->w + x);
+}
+
+/* Joins up black squares which touch, even diagonally, and those on
+ * the edge with the extra element standing for the edge itself. */
+static void solve_connectblacks(game_state *state, struct solver_state *ss)
+{
+    int i, d, x, y, xd, yd;
+
+    dsf_reinit(ss->blacks);
+    for (i = 0; i < state->n; i++) {
+        if (!(state->flags[i] & F_BLACK)) continue;
+        x = i%state->w; y = i/state->w;
+        for (d = 0; d < 8; d++) {
+            xd = x + dxs8[d]; yd = y + dys8[d];
+            if (!INGRID(state, xd, yd))
+                dsf_union(ss->blacks, i, state->n);
+            else if (state->flags[yd*state->w + xd] & F_BLACK)
+                dsf_union(ss->blacks, i, yd*state->w + xd);
+        }
+    }
+}
+
+/* With a contiguous white region, blackening the white square (x,y)
+ * splits it exactly when two of the separate runs of black squares
+ * around (x,y) are already joined up, so that together they'd cut
+ * the region off. Needs solve_connectblacks first. */
+static bool solve_splitswhite(game_state *state, struct solver_state *ss,
+                              int x, int y)
+{
+    int cls[8], runs[4], nruns = 0, start, d, k;
+
+    for (d = 0; d < 8; d++)
+        cls[d] = solve_blackclass(state, ss, x + dxs8[d], y + dys8[d]);
+    /* two black sides touch diagonally, whatever's in the corner */
+    for (d = 1; d < 8; d += 2)
+        if (cls[d] < 0 && cls[d-1] >= 0 && cls[(d+1) % 8] >= 0)
+            cls[d] = cls[d-1];
+
+    for (start = 0; start < 8 && cls[start] >= 0; start++);
+    if (start == 8) return false;
+
+    for (d = 1; d <= 8; d++) {
+        int here = cls[(start + d) % 8];
+        if (here < 0 || cls[(start + d - 1) % 8] >= 0) continue;
+        for (k = 0; k < nruns; k++)
+            if (runs[k] == here) return true;
+        runs[nruns++] = here;
+    }
+    return false;
+}
+
 static void solve_removesplits_check(game_state *state, struct solver_state *ss,
-                                     int x, int y)
+                                     int x, int y, int nwhite)
 {
     int i = y*state->w + x;
-    bool issingle;
 
     if (!INGRID(state, x, y)) return;
     if ((state->flags[i] & F_CIRCLE) || (state->flags[i] & F_BLACK))
         return;
 
     /* If putting a black square at (x,y) would make the white region
-     * non-contiguous, it must be circled. */
-    state->flags[i] |= F_BLACK;
-    issingle = solve_hassinglewhiteregion(state, ss);
-    state->flags[i] &= ~F_BLACK;
+     * non-contiguous (or leave none at all), it must be circled. */
+    if (nwhite == 1) {
+        debug(("solve_removesplits: no white squares would be left!\n"));
+        state->impossible = true;
+    } else if (!solve_splitswhite(state, ss, x, y))
+        return;
 
-    if (!issingle)
-        solver_op_add(ss, x, y, CIRCLE, "MC: black square here would split white region");
+    solver_op_add(ss, x, y, CIRCLE, "MC: black square here would split white region");
 }
 
 /* For all black squares, search in squares diagonally adjacent to see if
  * we can rule out putting a black square there (because it would make the
  * white region non-contiguous). */
-/* This function is likely to be somewhat slow. */
 static int solve_removesplits(game_state *state, struct solver_state *ss)
 {
-    int i, x, y, n_ops = ss->n_ops;
+    int i, x, y, n_ops = ss->n_ops, nwhite = 0;
 
     if (!solve_hassinglewhiteregion(state, ss)) {
         debug(("solve_removesplits: white region is not contiguous at start!\n"));
@@ -1075,14 +1142,18 @@ static int solve_removesplits(game_state *state, struct solver_state *ss)
         return 0;
     }
 
+    solve_connectblacks(state, ss);
+    for (i = 0; i < state->n; i++)
+        if (!(state->flags[i] & F_BLACK)) nwhite++;
+
     for (i = 0; i < state->n; i++) {
         if (!(state->flags[i] & F_BLACK)) continue;
 
         x = i%state->w; y = i/state->w;
-        solve_removesplits_check(state, ss, x-1, y-1);
-        solve_removesplits_check(state, ss, x+1, y-1);
-        solve_removesplits_check(state, ss, x+1, y+1);
-        solve_removesplits_check(state, ss, x-1, y+1);
+        solve_removesplits_check(state, ss, x-1, y-1, nwhite);
+        solve_removesplits_check(state, ss, x+1, y-1, nwhite);
+        solve_removesplits_check(state, ss, x+1, y+1, nwhite);
+        solve_removesplits_check(state, ss, x-1, y+1, nwhite);
     }
     return ss->n_ops - n_ops;
 }
@@ -239,7 +239,7 @@ struct solver_scratch {
      * Disjoint set forest which tracks the connected sets of
      * points.
      */
-    int *connected;
+    DSF *connected;
 
     /*
      * Counts the number of possible exits from each connected set
@@ -260,7 +260,7 @@ struct solver_scratch {
      * Another disjoint set forest. This one tracks _squares_ which
      * are known to slant in the same direction.
      */
-    int *equiv;
+    DSF *equiv;
 
     /*
      * Stores slash values which we know for an equivalence class.
@@ -295,6 +295,16 @@ struct solver_scratch {
      */
     unsigned char *vbitmap;
 
+    /*
+     * Marks the clue points whose neighbourhood has changed since
+     * the solver last looked at them. Whether a clue point allows a
+     * deduction depends only on the contents of its neighbouring
+     * squares and the equivalences between them, so fill_square
+     * marks the four corners of the square it fills, and any actual
+     * merge of two equivalence classes marks every point.
+     */
+    bool *dirty;
+
     /*
      * Useful to have this information automatically passed to
      * solver subroutines. (This pointer is not dynamically
@@ -307,39 +317,41 @@ static struct solver_scratch *new_scratch(int w, int h)
 {
     int W = w+1, H = h+1;
     struct solver_scratch *ret = snew(struct solver_scratch);
-    ret->connected = snewn(W*H, int);
+    ret->connected = dsf_new(W*H);
     ret->exits = snewn(W*H, int);
     ret->border = snewn(W*H, bool);
-    ret->equiv = snewn(w*h, int);
+    ret->equiv = dsf_new(w*h);
     ret->slashval = snewn(w*h, signed char);
     ret->vbitmap = snewn(w*h, unsigned char);
+    ret->dirty = snewn(W*H, bool);
     return ret;
 }
 
 static void free_scratch(struct solver_scratch *sc)
 {
+    sfree(sc->dirty);
     sfree(sc->vbitmap);
     sfree(sc->slashval);
-    sfree(sc->equiv);
+    dsf_free(sc->equiv);
     sfree(sc->border);
     sfree(sc->exits);
-    sfree(sc->connected);
+    dsf_free(sc->connected);
     sfree(sc);
 }
 
 /*
- * Wrapper on dsf_merge() which updates the `exits' and `border'
+ * Wrapper on dsf_union() which updates the `exits' and `border'
  * arrays.
  */
-static void merge_vertices(int *connected,
+static void merge_vertices(DSF *connected,
 			   struct solver_scratch *sc, int i, int j)
 {
     int exits = -1;
     bool border = false;    /* initialise to placate optimiser */
 
     if (sc) {
-	i = dsf_canonify(connected, i);
-	j = dsf_canonify(connected, j);
+	i = dsf_find(connected, i);
+	j = dsf_find(connected, j);
 
 	/*
 	 * We have used one possible exit from each of the two
@@ -351,10 +363,9 @@ static void merge_vertices(int *connected,
 	border = sc->border[i] || sc->border[j];
     }
 
-    dsf_merge(connected, i, j);
+    i = dsf_union(connected, i, j);
 
     if (sc) {
-	i = dsf_canonify(connected, i);
 	sc->exits[i] = exits;
 	sc->border[i] = border;
     }
@@ -370,14 +381,29 @@ static void merge_vertices(int *connected,
 static void decr_exits(struct solver_scratch *sc, int i)
 {
     if (sc->clues[i] < 0) {
-	i = dsf_canonify(sc->connected, i);
+	i = dsf_find(sc->connected, i);
 	sc->exits[i]--;
     }
 }
 
+static void mark_all_dirty(struct solver_scratch *sc, int W, int H)
+{
+    int i;
+
+    for (i = 0; i < W*H; i++)
+	sc->dirty[i] = true;
+}
+
+/* Mark the clue points at the corners of square (x,y). */
+static void mark_dirty(struct solver_scratch *sc, int W, int x, int y)
+{
+    sc->dirty[y*W+x] = sc->dirty[y*W+(x+1)] = true;
+    sc->dirty[(y+1)*W+x] = sc->dirty[(y+1)*W+(x+1)] = true;
+}
+
 static void fill_square(int w, int h, int x, int y, int v,
 			signed char *soln,
-			int *connected, struct solver_scratch *sc)
+			DSF *connected, struct solver_scratch *sc)
 {
     int W = w+1 /*, H = h+1 */;
 
@@ -395,8 +421,9 @@ static void fill_square(int w, int h, int x, int y, int v,
     soln[y*w+x] = v;
 
     if (sc) {
-	int c = dsf_canonify(sc->equiv, y*w+x);
+	int c = dsf_find(sc->equiv, y*w+x);
 	sc->slashval[c] = v;
+	mark_dirty(sc, W, x, y);
     }
 
     if (v < 0) {
@@ -467,13 +494,13 @@ static int slant_solve(int w, int h, const signed char *clues,
      * Establish a disjoint set forest for tracking connectedness
      * between grid points.
      */
-    dsf_init(sc->connected, W*H);
+    dsf_reinit(sc->connected);
 
     /*
      * Establish a disjoint set forest for tracking which squares
      * are known to slant in the same direction.
      */
-    dsf_init(sc->equiv, w*h);
+    dsf_reinit(sc->equiv);
 
     /*
      * Clear the slashval array.
@@ -485,6 +512,11 @@ static int slant_solve(int w, int h, const signed char *clues,
      */
     memset(sc->vbitmap, 0xF, w*h);
 
+    /*
+     * Every clue point needs looking at to begin with.
+     */
+    mark_all_dirty(sc, W, H);
+
     /*
      * Initialise the `exits' and `border' arrays. These are used
      * to do second-order loop avoidance: the dual of the no loops
@@ -531,6 +563,9 @@ static int slant_solve(int w, int h, const signed char *clues,
 		int nneighbours;
 		int nu, nl, c, s, eq, eq2, last, meq, mj1, mj2;
 
+		if (!sc->dirty[y*W+x])
+		    continue;
+		sc->dirty[y*W+x] = false;
 		if ((c = clues[y*W+x]) < 0)
 		    continue;
 
@@ -576,7 +611,7 @@ static int slant_solve(int w, int h, const signed char *clues,
 		nl = c;
 		last = neighbours[nneighbours-1].pos;
 		if (soln[last] == 0)
-		    eq = dsf_canonify(sc->equiv, last);
+		    eq = dsf_find(sc->equiv, last);
 		else
 		    eq = -1;
 		meq = mj1 = mj2 = -1;
@@ -586,7 +621,7 @@ static int slant_solve(int w, int h, const signed char *clues,
 		    if (soln[j] == 0) {
 			nu++;	       /* undecided */
 			if (meq < 0 && difficulty > DIFF_EASY) {
-			    eq2 = dsf_canonify(sc->equiv, j);
+			    eq2 = dsf_find(sc->equiv, j);
 			    if (eq == eq2 && last != j) {
 				/*
 				 * We've found an equivalent pair.
@@ -697,9 +732,9 @@ static int slant_solve(int w, int h, const signed char *clues,
 			    printf("clue point at %d,%d implies %d,%d == %d,"
 				   "%d\n", x, y, mj1%w, mj1/w, mj2%w, mj2/w);
 #endif
-			mj1 = dsf_canonify(sc->equiv, mj1);
+			mj1 = dsf_find(sc->equiv, mj1);
 			sv1 = sc->slashval[mj1];
-			mj2 = dsf_canonify(sc->equiv, mj2);
+			mj2 = dsf_find(sc->equiv, mj2);
 			sv2 = sc->slashval[mj2];
 			if (sv1 != 0 && sv2 != 0 && sv1 != sv2) {
 #ifdef SOLVER_DIAGNOSTICS
@@ -710,8 +745,9 @@ static int slant_solve(int w, int h, const signed char *clues,
 			    return 0;
 			}
 			sv1 = sv1 ? sv1 : sv2;
-			dsf_merge(sc->equiv, mj1, mj2);
-			mj1 = dsf_canonify(sc->equiv, mj1);
+			if (mj1 != mj2)
+			    mark_all_dirty(sc, W, H);
+			mj1 = dsf_union(sc->equiv, mj1, mj2);
 			sc->slashval[mj1] = sv1;
 		    }
 		}
@@ -746,7 +782,7 @@ static int slant_solve(int w, int h, const signed char *clues,
 		bs = false;
 
 		if (difficulty > DIFF_EASY)
-		    v = sc->slashval[dsf_canonify(sc->equiv, y*w+x)];
+		    v = sc->slashval[dsf_find(sc->equiv, y*w+x)];
 		else
 		    v = 0;
 
@@ -755,8 +791,8 @@ static int slant_solve(int w, int h, const signed char *clues,
 		 * (x+1,y+1); if successful, we will deduce that we
 		 * must have a forward slash.
 		 */
-		c1 = dsf_canonify(sc->connected, y*W+x);
-		c2 = dsf_canonify(sc->connected, (y+1)*W+(x+1));
+		c1 = dsf_find(sc->connected, y*W+x);
+		c2 = dsf_find(sc->connected, (y+1)*W+(x+1));
 		if (c1 == c2) {
 		    fs = true;
 #ifdef SOLVER_DIAGNOSTICS
@@ -782,8 +818,8 @@ static int slant_solve(int w, int h, const signed char *clues,
 		 * Now do the same between (x+1,y) and (x,y+1), to
 		 * see if we are required to have a backslash.
 		 */
-		c1 = dsf_canonify(sc->connected, y*W+(x+1));
-		c2 = dsf_canonify(sc->connected, (y+1)*W+x);
+		c1 = dsf_find(sc->connected, y*W+(x+1));
+		c2 = dsf_find(sc->connected, (y+1)*W+x);
 		if (c1 == c2) {
 		    bs = true;
 #ifdef SOLVER_DIAGNOSTICS
@@ -876,9 +912,10 @@ static int slant_solve(int w, int h, const signed char *clues,
                  */
                 if (x+1 < w && !(sc->vbitmap[y*w+x] & 0x3)) {
                     int n1 = y*w+x, n2 = y*w+(x+1);
-                    if (dsf_canonify(sc->equiv, n1) !=
-                        dsf_canonify(sc->equiv, n2)) {
-                        dsf_merge(sc->equiv, n1, n2);
+                    if (dsf_find(sc->equiv, n1) !=
+                        dsf_find(sc->equiv, n2)) {
+                        dsf_union(sc->equiv, n1, n2);
+                        mark_all_dirty(sc, W, H);
                         done_something = true;
 #ifdef SOLVER_DIAGNOSTICS
                         if (verbose)
@@ -890,9 +927,10 @@ static int slant_solve(int w, int h, const signed char *clues,
                 }
                 if (y+1 < h && !(sc->vbitmap[y*w+x] & 0xC)) {
                     int n1 = y*w+x, n2 = (y+1)*w+x;
-                    if (dsf_canonify(sc->equiv, n1) !=
-                        dsf_canonify(sc->equiv, n2)) {
-                        dsf_merge(sc->equiv, n1, n2);
+                    if (dsf_find(sc->equiv, n1) !=
+                        dsf_find(sc->equiv, n2)) {
+                        dsf_union(sc->equiv, n1, n2);
+                        mark_all_dirty(sc, W, H);
                         done_something = true;
 #ifdef SOLVER_DIAGNOSTICS
                         if (verbose)
@@ -992,7 +1030,8 @@ static void slant_generate(int w, int h, signed char *soln, random_state *rs)
 {
     int W = w+1, H = h+1;
     int x, y, i;
-    int *connected, *indices;
+    DSF *connected;
+    int *indices;
 
     /*
      * Clear the output.
@@ -1003,7 +1042,7 @@ static void slant_generate(int w, int h, signed char *soln, random_state *rs)
      * Establish a disjoint set forest for tracking connectedness
      * between grid points.
      */
-    connected = snew_dsf(W*H);
+    connected = dsf_new(W*H);
 
     /*
      * Prepare a list of the squares in the grid, and fill them in
@@ -1024,10 +1063,8 @@ static void slant_generate(int w, int h, signed char *soln, random_state *rs)
 	y = indices[i] / w;
 	x = indices[i] % w;
 
-	fs = (dsf_canonify(connected, y*W+x) ==
-	      dsf_canonify(connected, (y+1)*W+(x+1)));
-	bs = (dsf_canonify(connected, (y+1)*W+x) ==
-	      dsf_canonify(connected, y*W+(x+1)));
+	fs = dsf_equivalent(connected, y*W+x, (y+1)*W+(x+1));
+	bs = dsf_equivalent(connected, (y+1)*W+x, y*W+(x+1));
 
 	/*
 	 * It isn't possible to get into a situation where we
@@ -1059,7 +1096,7 @@ static void slant_generate(int w, int h, signed char *soln, random_state *rs)
     }
 
     sfree(indices);
-    sfree(connected);
+    dsf_free(connected);
 }
 
 static char *new_game_desc(const game_params *params, random_state *rs,
@@ -1079,6 +1116,11 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     sc = new_scratch(w, h);
 
     do {
+	if (random_cancelled(rs)) {
+	    desc = NULL;
+	    goto cleanup;
+	}
+
 	/*
 	 * Create the filled grid.
 	 */
@@ -1144,6 +1186,10 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 		    pass = 1;
 
 		if (pass == j) {
+		    if (random_cancelled(rs)) {
+			desc = NULL;
+			goto cleanup;
+		    }
 		    clues[y*W+x] = -1;
 		    if (slant_solve(w, h, clues, tmpsoln, sc,
 				    params->diff) != 1)
@@ -1207,6 +1253,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 	auxbuf[w*h] = '\0';
     }
 
+  cleanup:
     free_scratch(sc);
     sfree(clueindices);
     sfree(clues);
@@ -140,68 +140,18 @@ enum {
 };
 
 /*
- * To determine all possible ways to reach a given sum by adding two or
- * three numbers from 1..9, each of which occurs exactly once in the sum,
- * these arrays contain a list of bitmasks for each sum value, where if
- * bit N is set, it means that N occurs in the sum.  Each list is
- * terminated by a zero if it is shorter than the size of the array.
+ * To determine all possible ways to reach a given sum by adding two,
+ * three or four numbers from 1..9, each of which occurs exactly once
+ * in the sum, these arrays contain a list of bitmasks for each sum
+ * value, where if bit N is set, it means that N occurs in the sum.
+ * Each list is terminated by a zero if it is shorter than the size of
+ * the array. The tables themselves are written out at build time by
+ * the CMake scripts, into solo-sums.h.
  */
 #define MAX_2SUMS 5
 #define MAX_3SUMS 8
 #define MAX_4SUMS 12
-static unsigned long sum_bits2[18][MAX_2SUMS];
-static unsigned long sum_bits3[25][MAX_3SUMS];
-static unsigned long sum_bits4[31][MAX_4SUMS];
-
-static int find_sum_bits(unsigned long *array, int idx, int value_left,
-			 int addends_left, int min_addend,
-			 unsigned long bitmask_so_far)
-{
-    int i;
-    assert(addends_left >= 2);
-
-    for (i = min_addend; i < value_left; i++) {
-	unsigned long new_bitmask = bitmask_so_far | (1L << i);
-	assert(bitmask_so_far != new_bitmask);
-
-	if (addends_left == 2) {
-	    int j = value_left - i;
-	    if (j <= i)
-		break;
-	    if (j > 9)
-		continue;
-	    array[idx++] = new_bitmask | (1L << j);
-	} else
-	    idx = find_sum_bits(array, idx, value_left - i,
-				addends_left - 1, i + 1,
-				new_bitmask);
-    }
-    return idx;
-}
-
-static void precompute_sum_bits(void)
-{
-    int i;
-    for (i = 3; i < 31; i++) {
-	int j;
-	if (i < 18) {
-	    j = find_sum_bits(sum_bits2[i], 0, i, 2, 1, 0);
-	    assert (j <= MAX_2SUMS);
-	    if (j < MAX_2SUMS)
-		sum_bits2[i][j] = 0;
-	}
-	if (i < 25) {
-	    j = find_sum_bits(sum_bits3[i], 0, i, 3, 1, 0);
-	    assert (j <= MAX_3SUMS);
-	    if (j < MAX_3SUMS)
-		sum_bits3[i][j] = 0;
-	}
-	j = find_sum_bits(sum_bits4[i], 0, i, 4, 1, 0);
-	assert (j <= MAX_4SUMS);
-	if (j < MAX_4SUMS)
-	    sum_bits4[i][j] = 0;
-    }
-}
+#include "solo-sums.h"
 
 struct game_params {
     /*
@@ -982,7 +932,11 @@ static int solver_intersect(struct solver_usage *usage,
 }
 
 struct solver_scratch {
-    unsigned char *grid, *rowidx, *colidx, *set;
+    unsigned char *grid, *rowidx, *colidx;
+    unsigned int *rows, *cells;
+#ifdef STANDALONE_SOLVER
+    unsigned char *set;                /* for solver_set_reference */
+#endif
     int *neighbours, *bfsqueue;
     int *indexlist, *indexlist2;
 #ifdef STANDALONE_SOLVER
@@ -990,6 +944,139 @@ struct solver_scratch {
 #endif
 };
 
+/*
+ * solver_set and solver_forcing pack candidate sets into a word, with
+ * bit i standing for the ith member; validate_params keeps cr small
+ * enough for that.
+ */
+#define SOLVER_BIT(i) (1U << (i))
+
+static int solver_bitcount(unsigned int word)
+{
+#ifdef __GNUC__
+    return __builtin_popcount(word);
+#else
+    int count = 0;
+    for (; word; word &= word - 1)
+        count++;
+    return count;
+#endif
+}
+
+/* Index of the lowest set bit of a non-zero word. */
+static int solver_lowbit(unsigned int word)
+{
+#ifdef __GNUC__
+    return __builtin_ctz(word);
+#else
+    int i = 0;
+    while (!(word & 1))
+        word >>= 1, i++;
+    return i;
+#endif
+}
+
+#ifdef STANDALONE_SOLVER
+/*
+ * The original byte-at-a-time version of solver_set, less its
+ * diagnostics. With -c, the standalone solver runs it alongside the
+ * bitmask version on every call and stops if they ever disagree.
+ */
+static bool solver_cross_check;
+
+static int solver_set_reference(struct solver_usage *usage,
+                                struct solver_scratch *scratch, int *indices)
+{
+    int cr = usage->cr;
+    int i, j, n, count;
+    unsigned char *grid = scratch->grid;
+    unsigned char *rowidx = scratch->rowidx;
+    unsigned char *colidx = scratch->colidx;
+    unsigned char *set = scratch->set;
+
+    memset(rowidx, 1, cr);
+    memset(colidx, 1, cr);
+    for (i = 0; i < cr; i++) {
+        int count = 0, first = -1;
+        for (j = 0; j < cr; j++)
+            if (usage->cube[indices[i*cr+j]])
+                first = j, count++;
+        if (count == 0)
+            return -1;
+        if (count == 1)
+            rowidx[i] = colidx[first] = 0;
+    }
+
+    for (i = j = 0; i < cr; i++)
+        if (rowidx[i])
+            rowidx[j++] = i;
+    n = j;
+    for (i = j = 0; i < cr; i++)
+        if (colidx[i])
+            colidx[j++] = i;
+    assert(n == j);
+
+    for (i = 0; i < n; i++)
+        for (j = 0; j < n; j++)
+            grid[i*cr+j] = usage->cube[indices[rowidx[i]*cr+colidx[j]]];
+
+    memset(set, 0, n);
+    count = 0;
+    while (1) {
+        if (count > 1 && count < n-1) {
+            int rows = 0;
+            for (i = 0; i < n; i++) {
+                bool ok = true;
+                for (j = 0; j < n; j++)
+                    if (set[j] && grid[i*cr+j]) {
+                        ok = false;
+                        break;
+                    }
+                if (ok)
+                    rows++;
+            }
+
+            if (rows > n - count)
+		return -1;
+
+            if (rows >= n - count) {
+                bool progress = false;
+
+                for (i = 0; i < n; i++) {
+                    bool ok = true;
+                    for (j = 0; j < n; j++)
+                        if (set[j] && grid[i*cr+j]) {
+                            ok = false;
+                            break;
+                        }
+                    if (!ok) {
+                        for (j = 0; j < n; j++)
+                            if (!set[j] && grid[i*cr+j]) {
+                                progress = true;
+                                usage->cube[indices[rowidx[i]*cr+colidx[j]]]
+                                    = false;
+                            }
+                    }
+                }
+
+                if (progress)
+                    return +1;
+            }
+        }
+
+        i = n;
+        while (i > 0 && set[i-1])
+            set[--i] = 0, count--;
+        if (i > 0)
+            set[--i] = 1, count++;
+        else
+            break;
+    }
+
+    return 0;
+}
+#endif
+
 static int solver_set(struct solver_usage *usage,
                       struct solver_scratch *scratch,
                       int *indices
@@ -999,11 +1086,24 @@ static int solver_set(struct solver_usage *usage,
                       )
 {
     int cr = usage->cr;
-    int i, j, n, count;
-    unsigned char *grid = scratch->grid;
+    int i, j, n, ret = 0;
+    unsigned int *rows = scratch->rows;
     unsigned char *rowidx = scratch->rowidx;
     unsigned char *colidx = scratch->colidx;
-    unsigned char *set = scratch->set;
+    unsigned int set, all;
+#ifdef STANDALONE_SOLVER
+    bool *refcube = NULL;
+    int refret = 0;
+
+    if (solver_cross_check) {
+        bool *cube = usage->cube;
+        refcube = snewn(cr*cr*cr, bool);
+        memcpy(refcube, cube, cr*cr*cr * sizeof(bool));
+        usage->cube = refcube;
+        refret = solver_set_reference(usage, scratch, indices);
+        usage->cube = cube;
+    }
+#endif
 
     /*
      * We are passed a cr-by-cr matrix of booleans. Our first job
@@ -1014,16 +1114,16 @@ static int solver_set(struct solver_usage *usage,
     memset(rowidx, 1, cr);
     memset(colidx, 1, cr);
     for (i = 0; i < cr; i++) {
-        int count = 0, first = -1;
+        unsigned int bits = 0;
         for (j = 0; j < cr; j++)
             if (usage->cube[indices[i*cr+j]])
-                first = j, count++;
+                bits |= SOLVER_BIT(j);
 
 	/*
-	 * If count == 0, then there's a row with no 1s at all and
-	 * the puzzle is internally inconsistent.
+	 * If there are no 1s at all in this row, then the puzzle
+	 * is internally inconsistent.
 	 */
-        if (count == 0) {
+        if (!bits) {
 #ifdef STANDALONE_SOLVER
             if (solver_show_working) {
                 va_list ap;
@@ -1036,10 +1136,11 @@ static int solver_set(struct solver_usage *usage,
                        solver_recurse_depth*4, "");
             }
 #endif
-            return -1;
+            ret = -1;
+            goto done;
         }
-        if (count == 1)
-            rowidx[i] = colidx[first] = 0;
+        if (solver_bitcount(bits) == 1)
+            rowidx[i] = colidx[solver_lowbit(bits)] = 0;
     }
 
     /*
@@ -1056,11 +1157,16 @@ static int solver_set(struct solver_usage *usage,
     assert(n == j);
 
     /*
-     * And create the smaller matrix.
+     * And create the smaller matrix, as one word per row. Column j
+     * of it is bit n-1-j, for the benefit of the search below.
      */
-    for (i = 0; i < n; i++)
+    for (i = 0; i < n; i++) {
+        unsigned int bits = 0;
         for (j = 0; j < n; j++)
-            grid[i*cr+j] = usage->cube[indices[rowidx[i]*cr+colidx[j]]];
+            if (usage->cube[indices[rowidx[i]*cr+colidx[j]]])
+                bits |= SOLVER_BIT(n-1-j);
+        rows[i] = bits;
+    }
 
     /*
      * Having done that, we now have a matrix in which every row
@@ -1068,132 +1174,129 @@ static int solver_set(struct solver_usage *usage,
      * a rectangle of zeroes (in the set-theoretic sense of
      * `rectangle', i.e. a subset of rows crossed with a subset of
      * columns) whose width and height add up to n.
+     *
+     * The candidate sets of columns are the successive values of
+     * a binary counter, with column 0 as its top bit, so a row has
+     * a zero in every column of a set exactly when its word and
+     * the counter have no bits in common.
      */
+    all = SOLVER_BIT(n) - 1;
+    set = 0;
+    while (set != all) {
+        int count, nrows;
+
+        set++;
+        count = solver_bitcount(set);
 
-    memset(set, 0, n);
-    count = 0;
-    while (1) {
         /*
          * We have a candidate set. If its size is <=1 or >=n-1
          * then we move on immediately.
          */
-        if (count > 1 && count < n-1) {
-            /*
-             * The number of rows we need is n-count. See if we can
-             * find that many rows which each have a zero in all
-             * the positions listed in `set'.
-             */
-            int rows = 0;
-            for (i = 0; i < n; i++) {
-                bool ok = true;
-                for (j = 0; j < n; j++)
-                    if (set[j] && grid[i*cr+j]) {
-                        ok = false;
-                        break;
-                    }
-                if (ok)
-                    rows++;
-            }
+        if (count <= 1 || count >= n-1)
+            continue;
 
-            /*
-             * We expect never to be able to get _more_ than
-             * n-count suitable rows: this would imply that (for
-             * example) there are four numbers which between them
-             * have at most three possible positions, and hence it
-             * indicates a faulty deduction before this point or
-             * even a bogus clue.
-             */
-            if (rows > n - count) {
+        /*
+         * The number of rows we need is n-count. See if we can
+         * find that many rows which each have a zero in all the
+         * positions listed in `set'.
+         */
+        nrows = 0;
+        for (i = 0; i < n; i++)
+            if (!(rows[i] & set))
+                nrows++;
+
+        /*
+         * We expect never to be able to get _more_ than n-count
+         * suitable rows: this would imply that (for example)
+         * there are four numbers which between them have at most
+         * three possible positions, and hence it indicates a
+         * faulty deduction before this point or even a bogus
+         * clue.
+         */
+        if (nrows > n - count) {
 #ifdef STANDALONE_SOLVER
-		if (solver_show_working) {
-		    va_list ap;
-		    printf("%*s", solver_recurse_depth*4,
-			   "");
-		    va_start(ap, fmt);
-		    vprintf(fmt, ap);
-		    va_end(ap);
-		    printf(":\n%*s  contradiction reached\n",
-			   solver_recurse_depth*4, "");
-		}
+            if (solver_show_working) {
+                va_list ap;
+                printf("%*s", solver_recurse_depth*4,
+                       "");
+                va_start(ap, fmt);
+                vprintf(fmt, ap);
+                va_end(ap);
+                printf(":\n%*s  contradiction reached\n",
+                       solver_recurse_depth*4, "");
+            }
 #endif
-		return -1;
-	    }
+            ret = -1;
+            goto done;
+        }
 
-            if (rows >= n - count) {
-                bool progress = false;
+        if (nrows >= n - count) {
+            /*
+             * We've got one! Now, for each row which _doesn't_
+             * satisfy the criterion, eliminate all its set bits in
+             * the positions _not_ listed in `set'. Return +1
+             * (meaning progress has been made) if we successfully
+             * eliminated anything at all.
+             *
+             * This involves referring back through rowidx/colidx
+             * in order to work out which actual positions in the
+             * cube to meddle with.
+             */
+            for (i = 0; i < n; i++) {
+                unsigned int elim;
 
-                /*
-                 * We've got one! Now, for each row which _doesn't_
-                 * satisfy the criterion, eliminate all its set
-                 * bits in the positions _not_ listed in `set'.
-                 * Return +1 (meaning progress has been made) if we
-                 * successfully eliminated anything at all.
-                 * 
-                 * This involves referring back through
-                 * rowidx/colidx in order to work out which actual
-                 * positions in the cube to meddle with.
-                 */
-                for (i = 0; i < n; i++) {
-                    bool ok = true;
-                    for (j = 0; j < n; j++)
-                        if (set[j] && grid[i*cr+j]) {
-                            ok = false;
-                            break;
-                        }
-                    if (!ok) {
-                        for (j = 0; j < n; j++)
-                            if (!set[j] && grid[i*cr+j]) {
-                                int fpos = indices[rowidx[i]*cr+colidx[j]];
+                if (!(rows[i] & set))
+                    continue;
+                elim = rows[i] & ~set;
+                for (j = 0; j < n; j++)
+                    if (elim & SOLVER_BIT(n-1-j)) {
+                        int fpos = indices[rowidx[i]*cr+colidx[j]];
 #ifdef STANDALONE_SOLVER
-                                if (solver_show_working) {
-                                    int px, py, pn;
-
-                                    if (!progress) {
-                                        va_list ap;
-					printf("%*s", solver_recurse_depth*4,
-					       "");
-                                        va_start(ap, fmt);
-                                        vprintf(fmt, ap);
-                                        va_end(ap);
-                                        printf(":\n");
-                                    }
+                        if (solver_show_working) {
+                            int px, py, pn;
+
+                            if (!ret) {
+                                va_list ap;
+                                printf("%*s", solver_recurse_depth*4, "");
+                                va_start(ap, fmt);
+                                vprintf(fmt, ap);
+                                va_end(ap);
+                                printf(":\n");
+                            }
 
-                                    pn = 1 + fpos % cr;
-                                    px = fpos / cr;
-                                    py = px / cr;
-                                    px %= cr;
+                            pn = 1 + fpos % cr;
+                            px = fpos / cr;
+                            py = px / cr;
+                            px %= cr;
 
-                                    printf("%*s  ruling out %d at (%d,%d)\n",
-					   solver_recurse_depth*4, "",
-                                           pn, 1+px, 1+py);
-                                }
+                            printf("%*s  ruling out %d at (%d,%d)\n",
+                                   solver_recurse_depth*4, "",
+                                   pn, 1+px, 1+py);
+                        }
 #endif
-                                progress = true;
-                                usage->cube[fpos] = false;
-                            }
+                        ret = +1;
+                        usage->cube[fpos] = false;
                     }
-                }
-
-                if (progress) {
-                    return +1;
-                }
             }
-        }
 
-        /*
-         * Binary increment: change the rightmost 0 to a 1, and
-         * change all 1s to the right of it to 0s.
-         */
-        i = n;
-        while (i > 0 && set[i-1])
-            set[--i] = 0, count--;
-        if (i > 0)
-            set[--i] = 1, count++;
-        else
-            break;                     /* done */
+            if (ret)
+                goto done;
+        }
     }
 
-    return 0;
+  done:
+#ifdef STANDALONE_SOLVER
+    if (refcube) {
+        if (ret != refret ||
+            memcmp(refcube, usage->cube, cr*cr*cr * sizeof(bool))) {
+            fprintf(stderr, "solver_set: bitmask and reference versions "
+                    "disagree\n");
+            abort();
+        }
+        sfree(refcube);
+    }
+#endif
+    return ret;
 }
 
 /*
@@ -1241,33 +1344,40 @@ static int solver_forcing(struct solver_usage *usage,
     int *bfsprev = scratch->bfsprev;
 #endif
     unsigned char *number = scratch->grid;
+    unsigned int *cells = scratch->cells;
     int *neighbours = scratch->neighbours;
-    int x, y;
+    int x, y, n;
+
+    /*
+     * Take a copy of each square's candidates as a word, with bit
+     * n-1 standing for number n. Nothing below changes the cube
+     * until we return, so the copy stays accurate throughout.
+     */
+    for (y = 0; y < cr; y++)
+        for (x = 0; x < cr; x++) {
+            unsigned int bits = 0;
+            for (n = 1; n <= cr; n++)
+                if (cube(x, y, n))
+                    bits |= SOLVER_BIT(n-1);
+            cells[y*cr+x] = bits;
+        }
 
     for (y = 0; y < cr; y++)
         for (x = 0; x < cr; x++) {
-            int count, t, n;
+            unsigned int here = cells[y*cr+x];
 
             /*
              * If this square doesn't have exactly two candidate
              * numbers, don't try it.
-             * 
-             * In this loop we also sum the candidate numbers,
-             * which is a nasty hack to allow us to quickly find
-             * `the other one' (since we will shortly know there
-             * are exactly two).
              */
-            for (count = t = 0, n = 1; n <= cr; n++)
-                if (cube(x, y, n))
-                    count++, t += n;
-            if (count != 2)
+            if (solver_bitcount(here) != 2)
                 continue;
 
             /*
              * Now attempt a bfs for each candidate.
              */
             for (n = 1; n <= cr; n++)
-                if (cube(x, y, n)) {
+                if (here & SOLVER_BIT(n-1)) {
                     int orign, currn, head, tail;
 
                     /*
@@ -1281,7 +1391,8 @@ static int solver_forcing(struct solver_usage *usage,
 #ifdef STANDALONE_SOLVER
                     bfsprev[y*cr+x] = -1;
 #endif
-                    number[y*cr+x] = t - n;
+                    number[y*cr+x] =
+                        1 + solver_lowbit(here & ~SOLVER_BIT(n-1));
 
                     while (head < tail) {
                         int xx, yy, nneighbours, xt, yt, i;
@@ -1319,7 +1430,7 @@ static int solver_forcing(struct solver_usage *usage,
                          * Try visiting each of those neighbours.
                          */
                         for (i = 0; i < nneighbours; i++) {
-                            int cc, tt, nn;
+                            unsigned int there;
 
                             xt = neighbours[i] % cr;
                             yt = neighbours[i] / cr;
@@ -1331,7 +1442,8 @@ static int solver_forcing(struct solver_usage *usage,
                              */
                             if (number[yt*cr+xt] <= cr)
                                 continue;
-                            if (!cube(xt, yt, currn))
+                            there = cells[yt*cr+xt];
+                            if (!(there & SOLVER_BIT(currn-1)))
                                 continue;
 
                             /*
@@ -1346,15 +1458,13 @@ static int solver_forcing(struct solver_usage *usage,
                              * this square to have exactly two
                              * possible numbers.
                              */
-                            for (cc = tt = 0, nn = 1; nn <= cr; nn++)
-                                if (cube(xt, yt, nn))
-                                    cc++, tt += nn;
-                            if (cc == 2) {
+                            if (solver_bitcount(there) == 2) {
                                 bfsqueue[tail++] = yt*cr+xt;
 #ifdef STANDALONE_SOLVER
                                 bfsprev[yt*cr+xt] = yy*cr+xx;
 #endif
-                                number[yt*cr+xt] = tt - currn;
+                                number[yt*cr+xt] = 1 + solver_lowbit(
+                                    there & ~SOLVER_BIT(currn-1));
                             }
 
                             /*
@@ -1478,7 +1588,8 @@ static int solver_killer_sums(struct solver_usage *usage, int b,
     int cr = usage->cr;
     int i, ret, max_sums;
     int nsquares = cages->nr_squares[b];
-    unsigned long *sumbits, possible_addends;
+    const unsigned long *sumbits;
+    unsigned long possible_addends;
 
     if (clue == 0) {
 	assert(nsquares == 0);
@@ -1660,38 +1771,27 @@ static int filter_whole_cages(struct solver_usage *usage, int *squares, int n,
     return off;
 }
 
-static struct solver_scratch *solver_new_scratch(struct solver_usage *usage)
+static struct solver_scratch *solver_new_scratch(struct solver_usage *usage,
+                                                 arena *ar)
 {
-    struct solver_scratch *scratch = snew(struct solver_scratch);
+    struct solver_scratch *scratch = anew(ar, struct solver_scratch);
     int cr = usage->cr;
-    scratch->grid = snewn(cr*cr, unsigned char);
-    scratch->rowidx = snewn(cr, unsigned char);
-    scratch->colidx = snewn(cr, unsigned char);
-    scratch->set = snewn(cr, unsigned char);
-    scratch->neighbours = snewn(5*cr, int);
-    scratch->bfsqueue = snewn(cr*cr, int);
+    scratch->grid = anewn(ar, cr*cr, unsigned char);
+    scratch->rowidx = anewn(ar, cr, unsigned char);
+    scratch->colidx = anewn(ar, cr, unsigned char);
+    scratch->rows = anewn(ar, cr, unsigned int);
+    scratch->cells = anewn(ar, cr*cr, unsigned int);
 #ifdef STANDALONE_SOLVER
-    scratch->bfsprev = snewn(cr*cr, int);
+    scratch->set = anewn(ar, cr, unsigned char);
 #endif
-    scratch->indexlist = snewn(cr*cr, int);   /* used for set elimination */
-    scratch->indexlist2 = snewn(cr, int);   /* only used for intersect() */
-    return scratch;
-}
-
-static void solver_free_scratch(struct solver_scratch *scratch)
-{
+    scratch->neighbours = anewn(ar, 5*cr, int);
+    scratch->bfsqueue = anewn(ar, cr*cr, int);
 #ifdef STANDALONE_SOLVER
-    sfree(scratch->bfsprev);
+    scratch->bfsprev = anewn(ar, cr*cr, int);
 #endif
-    sfree(scratch->bfsqueue);
-    sfree(scratch->neighbours);
-    sfree(scratch->set);
-    sfree(scratch->colidx);
-    sfree(scratch->rowidx);
-    sfree(scratch->grid);
-    sfree(scratch->indexlist);
-    sfree(scratch->indexlist2);
-    sfree(scratch);
+    scratch->indexlist = anewn(ar, cr*cr, int); /* used for set elimination */
+    scratch->indexlist2 = anewn(ar, cr, int);   /* only used for intersect() */
+    return scratch;
 }
 
 /*
@@ -1705,33 +1805,46 @@ struct difficulty {
     int diff, kdiff;
 };
 
+/*
+ * The usage and scratch structures, and everything allocated by
+ * recursive calls, come from the arena 'ar' and are given back to it
+ * before returning (so a generator can pass the same arena to every
+ * call), or from a private arena if 'ar' is NULL.
+ */
 static void solver(int cr, struct block_structure *blocks,
 		  struct block_structure *kblocks, bool xtype,
-		  digit *grid, digit *kgrid, struct difficulty *dlev)
+		  digit *grid, digit *kgrid, struct difficulty *dlev,
+		  arena *ar)
 {
     struct solver_usage *usage;
     struct solver_scratch *scratch;
     int x, y, b, i, n, ret;
     int diff = DIFF_BLOCK;
     int kdiff = DIFF_KSINGLE;
+    arena *own = NULL;
+    arena_mark mark;
+
+    if (!ar)
+	ar = own = arena_new();
+    mark = arena_get_mark(ar);
 
     /*
      * Set up a usage structure as a clean slate (everything
      * possible).
      */
-    usage = snew(struct solver_usage);
+    usage = anew(ar, struct solver_usage);
     usage->cr = cr;
     usage->blocks = blocks;
     if (kblocks) {
 	usage->kblocks = dup_block_structure(kblocks);
 	usage->extra_cages = alloc_block_structure (kblocks->c, kblocks->r,
 						    cr * cr, cr, cr * cr);
-	usage->extra_clues = snewn(cr*cr, digit);
+	usage->extra_clues = anewn(ar, cr*cr, digit);
     } else {
 	usage->kblocks = usage->extra_cages = NULL;
 	usage->extra_clues = NULL;
     }
-    usage->cube = snewn(cr*cr*cr, bool);
+    usage->cube = anewn(ar, cr*cr*cr, bool);
     usage->grid = grid;		       /* write straight back to the input */
     if (kgrid) {
 	int nclues;
@@ -1742,7 +1855,7 @@ static void solver(int cr, struct block_structure *blocks,
 	 * Allow for expansion of the killer regions, the absolute
 	 * limit is obviously one region per square.
 	 */
-	usage->kclues = snewn(cr*cr, digit);
+	usage->kclues = anewn(ar, cr*cr, digit);
 	for (i = 0; i < nclues; i++) {
 	    for (n = 0; n < kblocks->nr_squares[i]; n++)
 		if (kgrid[kblocks->blocks[i][n]] != 0)
@@ -1757,22 +1870,22 @@ static void solver(int cr, struct block_structure *blocks,
     for (i = 0; i < cr*cr*cr; i++)
         usage->cube[i] = true;
 
-    usage->row = snewn(cr * cr, bool);
-    usage->col = snewn(cr * cr, bool);
-    usage->blk = snewn(cr * cr, bool);
+    usage->row = anewn(ar, cr * cr, bool);
+    usage->col = anewn(ar, cr * cr, bool);
+    usage->blk = anewn(ar, cr * cr, bool);
     memset(usage->row, 0, cr * cr * sizeof(bool));
     memset(usage->col, 0, cr * cr * sizeof(bool));
     memset(usage->blk, 0, cr * cr * sizeof(bool));
 
     if (xtype) {
-	usage->diag = snewn(cr * 2, bool);
+	usage->diag = anewn(ar, cr * 2, bool);
 	memset(usage->diag, 0, cr * 2 * sizeof(bool));
     } else
 	usage->diag = NULL; 
 
     usage->nr_regions = cr * 3 + (xtype ? 2 : 0);
-    usage->regions = snewn(cr * usage->nr_regions, int);
-    usage->sq2region = snewn(cr * cr * 3, int *);
+    usage->regions = anewn(ar, cr * usage->nr_regions, int);
+    usage->sq2region = anewn(ar, cr * cr * 3, int *);
 
     for (n = 0; n < cr; n++) {
 	for (i = 0; i < cr; i++) {
@@ -1788,7 +1901,7 @@ static void solver(int cr, struct block_structure *blocks,
 	}
     }
 
-    scratch = solver_new_scratch(usage);
+    scratch = solver_new_scratch(usage, ar);
 
     /*
      * Place all the clue numbers we are given.
@@ -2532,9 +2645,9 @@ static void solver(int cr, struct block_structure *blocks,
 	    y = best / cr;
 	    x = best % cr;
 
-	    list = snewn(cr, digit);
-	    ingrid = snewn(cr * cr, digit);
-	    outgrid = snewn(cr * cr, digit);
+	    list = anewn(ar, cr, digit);
+	    ingrid = anewn(ar, cr * cr, digit);
+	    outgrid = anewn(ar, cr * cr, digit);
 	    memcpy(ingrid, grid, cr * cr);
 
 	    /* Make a list of the possible digits. */
@@ -2570,7 +2683,7 @@ static void solver(int cr, struct block_structure *blocks,
 		solver_recurse_depth++;
 #endif
 
-		solver(cr, blocks, kblocks, xtype, outgrid, kgrid, dlev);
+		solver(cr, blocks, kblocks, xtype, outgrid, kgrid, dlev, ar);
 
 #ifdef STANDALONE_SOLVER
 		solver_recurse_depth--;
@@ -2606,10 +2719,6 @@ static void solver(int cr, struct block_structure *blocks,
 		if (diff == DIFF_AMBIGUOUS)
 		    break;
 	    }
-
-	    sfree(outgrid);
-	    sfree(ingrid);
-	    sfree(list);
 	}
 
     } else {
@@ -2637,21 +2746,13 @@ static void solver(int cr, struct block_structure *blocks,
 	       "one solution");
 #endif
 
-    sfree(usage->sq2region);
-    sfree(usage->regions);
-    sfree(usage->cube);
-    sfree(usage->row);
-    sfree(usage->col);
-    sfree(usage->blk);
     if (usage->kblocks) {
 	free_block_structure(usage->kblocks);
 	free_block_structure(usage->extra_cages);
-	sfree(usage->extra_clues);
     }
-    if (usage->kclues) sfree(usage->kclues);
-    sfree(usage);
 
-    solver_free_scratch(scratch);
+    arena_release(ar, mark);
+    arena_free(own);
 }
 
 /* ----------------------------------------------------------------------
@@ -2783,6 +2884,16 @@ static bool gridgen_real(struct gridgen_usage *usage, digit *grid, int *steps)
 	return false;
     (*steps)--;
 
+    /*
+     * Every so often, also check that somebody still wants the
+     * grid. If not, use up the remaining steps so that we unwind
+     * straight out of the recursion.
+     */
+    if ((*steps & 1023) == 0 && random_cancelled(usage->rs)) {
+        *steps = 0;
+        return false;
+    }
+
     /*
      * Otherwise, there must be at least one space. Find the most
      * constrained space, using the `r' field as a tie-breaker.
@@ -3661,8 +3772,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int coords[16], ncoords;
     int x, y, i, j;
     struct difficulty dlev;
-
-    precompute_sum_bits();
+    arena *ar;
+    bool cancelled = false;
 
     /*
      * Adjust the maximum difficulty level to be consistent with
@@ -3679,6 +3790,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     grid = snewn(area, digit);
     locs = snewn(area, struct xy);
     grid2 = snewn(area, digit);
+    ar = arena_new();
 
     blocks = alloc_block_structure (c, r, area, cr, cr);
 
@@ -3695,6 +3807,10 @@ static char *new_game_desc(const game_params *params, random_state *rs,
      * difficult grids otherwise.
      */
     while (1) {
+        if (random_cancelled(rs)) {
+            cancelled = true;
+            break;
+        }
 
         /*
          * Generate a random solved state, starting by
@@ -3756,7 +3872,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 		compute_kclues(kblocks, kgrid, grid2, area);
 
 		memset(grid, 0, area * sizeof *grid);
-		solver(cr, blocks, kblocks, params->xtype, grid, kgrid, &dlev);
+		solver(cr, blocks, kblocks, params->xtype, grid, kgrid,
+		       &dlev, ar);
 		if (dlev.diff == dlev.maxdiff && dlev.kdiff == dlev.maxkdiff) {
 		    /*
 		     * We have one that matches our difficulty.  Store it for
@@ -3855,7 +3972,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
             for (j = 0; j < ncoords; j++)
                 grid2[coords[2*j+1]*cr+coords[2*j]] = 0;
 
-            solver(cr, blocks, kblocks, params->xtype, grid2, kgrid, &dlev);
+            solver(cr, blocks, kblocks, params->xtype, grid2, kgrid,
+                   &dlev, ar);
             if (dlev.diff <= dlev.maxdiff &&
 		(!params->killer || dlev.kdiff <= dlev.maxkdiff)) {
                 for (j = 0; j < ncoords; j++)
@@ -3865,7 +3983,8 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 
         memcpy(grid2, grid, area);
 
-	solver(cr, blocks, kblocks, params->xtype, grid2, kgrid, &dlev);
+	solver(cr, blocks, kblocks, params->xtype, grid2, kgrid,
+	       &dlev, ar);
 	if (dlev.diff == dlev.maxdiff &&
 	    (!params->killer || dlev.kdiff == dlev.maxkdiff))
 	    break;		       /* found one! */
@@ -3873,17 +3992,19 @@ static char *new_game_desc(const game_params *params, random_state *rs,
 
     sfree(grid2);
     sfree(locs);
+    arena_free(ar);
 
     /*
      * Now we have the grid as it will be presented to the user.
      * Encode it in a game desc.
      */
-    desc = encode_puzzle_desc(params, grid, blocks, kgrid, kblocks);
+    desc = cancelled ? NULL :
+        encode_puzzle_desc(params, grid, blocks, kgrid, kblocks);
 
     sfree(grid);
     free_block_structure(blocks);
     if (params->killer) {
-        free_block_structure(kblocks);
+        if (kblocks) free_block_structure(kblocks);
         sfree(kgrid);
     }
 
@@ -4148,8 +4269,6 @@ static game_state *new_game(midend *me, const game_params *params,
     int c = params->c, r = params->r, cr = c*r, area = cr * cr;
     int i;
 
-    precompute_sum_bits();
-
     state->cr = cr;
     state->xtype = params->xtype;
     state->killer = params->killer;
@@ -4314,7 +4433,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     dlev.maxdiff = DIFF_RECURSIVE;
     dlev.maxkdiff = DIFF_KINTERSECT;
     solver(cr, state->blocks, state->kblocks, state->xtype, grid,
-	   state->kgrid, &dlev);
+	   state->kgrid, &dlev, NULL);
 
     *error = NULL;
 
@@ -4635,12 +4754,10 @@ struct game_drawstate {
     bool started, xtype;
     int cr;
     int tilesize;
-    digit *grid;
-    unsigned char *pencil;
-    unsigned char *hl;
+    /* What each tile was drawn with, as hashed in draw_number. */
+    tilehash *drawn;
     /* This is scratch space used within a single call to game_redraw. */
     int nregions, *entered_items;
-    int lastglow;
 };
 
 static char *interpret_move(const game_state *state, game_ui *ui,
@@ -4988,12 +5105,8 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
     ds->started = false;
     ds->cr = cr;
     ds->xtype = state->xtype;
-    ds->grid = snewn(cr*cr, digit);
-    memset(ds->grid, cr+2, cr*cr);
-    ds->pencil = snewn(cr*cr*cr, digit);
-    memset(ds->pencil, 0, cr*cr*cr);
-    ds->hl = snewn(cr*cr, unsigned char);
-    memset(ds->hl, 0, cr*cr);
+    ds->drawn = snewn(cr*cr, tilehash);
+    memset(ds->drawn, 0, cr*cr*sizeof(tilehash));
     /*
      * ds->entered_items needs one row of cr entries per entity in
      * which digits may not be duplicated. That's one for each row,
@@ -5004,15 +5117,12 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
 	ds->nregions += state->kblocks->nr_blocks;
     ds->entered_items = snewn(cr * ds->nregions, int);
     ds->tilesize = 0;                  /* not decided yet */
-    ds->lastglow = 0;
     return ds;
 }
 
 static void game_free_drawstate(drawing *dr, game_drawstate *ds)
 {
-    sfree(ds->hl);
-    sfree(ds->pencil);
-    sfree(ds->grid);
+    sfree(ds->drawn);
     sfree(ds->entered_items);
     sfree(ds);
 }
@@ -5025,11 +5135,13 @@ static void draw_number(drawing *dr, game_drawstate *ds,
     int cx, cy, cw, ch;
     int col_killer = (hl & 32 ? COL_ERROR : COL_KILLER);
     char str[20];
+    tilehash h;
 
-    if (ds->grid[y*cr+x] == state->grid[y*cr+x] &&
-        ds->hl[y*cr+x] == hl &&
-        ds->lastglow == glow &&
-        !memcmp(ds->pencil+(y*cr+x)*cr, state->pencil+(y*cr+x)*cr, cr))
+    h = tilehash_add(0, state->grid[y*cr+x]);
+    h = tilehash_add(h, hl);
+    h = tilehash_add(h, glow);
+    h = tilehash_add_bytes(h, state->pencil+(y*cr+x)*cr, cr);
+    if (!tilehash_update(&ds->drawn[y*cr+x], h))
 	return;			       /* no change required */
 
     tx = BORDER + x * TILE_SIZE + 1 + GRIDEXTRA;
@@ -5309,10 +5421,6 @@ static void draw_number(drawing *dr, game_drawstate *ds,
     unclip(dr);
 
     draw_update(dr, cx, cy, cw, ch);
-
-    ds->grid[y*cr+x] = state->grid[y*cr+x];
-    memcpy(ds->pencil+(y*cr+x)*cr, state->pencil+(y*cr+x)*cr, cr);
-    ds->hl[y*cr+x] = hl;
 }
 
 static void outline_block_structure(drawing *dr, game_drawstate *ds,
@@ -5424,7 +5532,6 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
 	    draw_number(dr, ds, state, x, y, highlight, ui->glow);
 	}
     }
-    ds->lastglow = ui->glow;
 
     /*
      * Update the _entire_ grid if necessary.
@@ -5804,7 +5911,7 @@ const struct game thegame = {
 #endif
     false,			       /* wants_statusbar */
     false, game_timing_state,
-    REQUIRE_RBUTTON | REQUIRE_NUMPAD,  /* flags */
+    REQUIRE_RBUTTON | REQUIRE_NUMPAD | PARALLEL_NEW_DESC,  /* flags */
 };
 
 #ifdef STANDALONE_SOLVER
@@ -5824,6 +5931,8 @@ int main(int argc, char **argv)
             solver_show_working = true;
         } else if (!strcmp(p, "-g")) {
             grade = true;
+        } else if (!strcmp(p, "-c")) {
+            solver_cross_check = true;
         } else if (*p == '-') {
             fprintf(stderr, "%s: unrecognised option `%s'\n", argv[0], p);
             return 1;
@@ -5833,7 +5942,7 @@ int main(int argc, char **argv)
     }
 
     if (!id) {
-        fprintf(stderr, "usage: %s [-g | -v] <game_id>\n", argv[0]);
+        fprintf(stderr, "usage: %s [-g | -v] [-c] <game_id>\n", argv[0]);
         return 1;
     }
 
@@ -5855,7 +5964,8 @@ int main(int argc, char **argv)
 
     dlev.maxdiff = DIFF_RECURSIVE;
     dlev.maxkdiff = DIFF_KINTERSECT;
-    solver(s->cr, s->blocks, s->kblocks, s->xtype, s->grid, s->kgrid, &dlev);
+    solver(s->cr, s->blocks, s->kblocks, s->xtype, s->grid, s->kgrid,
+           &dlev, NULL);
     if (grade) {
 	printf("Difficulty rating: %s\n",
 	       dlev.diff==DIFF_BLOCK ? "Trivial (blockwise positional elimination only)":
@@ -80,6 +80,11 @@ int tdq_remove(tdq *tdq)
     return ret;
 }
 
+bool tdq_empty(const tdq *tdq)
+{
+    return !tdq->flags[tdq->queue[tdq->op]];
+}
+
 void tdq_fill(tdq *tdq)
 {
     int i;
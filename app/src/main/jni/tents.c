@@ -421,8 +421,8 @@ enum { N, U, L, R, D, MAXDIR };	       /* link directions */
 #define F(d) ( U + D - (d) )
 struct solver_scratch {
     char *links;		       /* mapping between trees and tents */
-    int *locs;
-    char *place, *mrows, *trows;
+    char *mrows;
+    char *fwd, *bwd;		       /* row/column placement reachability */
 };
 
 static struct solver_scratch *new_scratch(int w, int h)
@@ -430,20 +430,18 @@ static struct solver_scratch *new_scratch(int w, int h)
     struct solver_scratch *ret = snew(struct solver_scratch);
 
     ret->links = snewn(w*h, char);
-    ret->locs = snewn(max(w, h), int);
-    ret->place = snewn(max(w, h), char);
     ret->mrows = snewn(3 * max(w, h), char);
-    ret->trows = snewn(3 * max(w, h), char);
+    ret->fwd = snewn((max(w, h)+1) * (max(w, h)+1) * 2, char);
+    ret->bwd = snewn((max(w, h)+1) * (max(w, h)+1) * 2, char);
 
     return ret;
 }
 
 static void free_scratch(struct solver_scratch *sc)
 {
-    sfree(sc->trows);
+    sfree(sc->bwd);
+    sfree(sc->fwd);
     sfree(sc->mrows);
-    sfree(sc->place);
-    sfree(sc->locs);
     sfree(sc->links);
     sfree(sc);
 }
@@ -456,7 +454,7 @@ static int tents_solve(int w, int h, const char *grid, int *numbers,
 		       char *soln, struct solver_scratch *sc, int diff)
 {
     int x, y, d, i, j;
-    char *mrow, *trow, *trow1, *trow2;
+    char *mrow;
 
     /*
      * Set up solver data.
@@ -662,10 +660,10 @@ static int tents_solve(int w, int h, const char *grid, int *numbers,
 	 * If localised deductions about the trees and tents
 	 * themselves haven't helped us, it's time to resort to the
 	 * numbers round the grid edge. For each row and column, we
-	 * go through all possible combinations of locations for
-	 * the unplaced tents, rule out any which have adjacent
-	 * tents, and spot any square which is given the same state
-	 * by all remaining combinations.
+	 * consider all possible combinations of locations for the
+	 * unplaced tents, rule out any which have adjacent tents,
+	 * and spot any square which is given the same state by all
+	 * remaining combinations.
 	 */
 	for (i = 0; i < w+h; i++) {
 	    int start, step, len, start1, start2, n, k;
@@ -715,127 +713,78 @@ static int tents_solve(int w, int h, const char *grid, int *numbers,
 	    k = numbers[i];
 
 	    /*
-	     * Count and store the locations of the free squares,
-	     * and also count the number of tents already placed.
+	     * Count the free squares, and also count the number of
+	     * tents already placed.
 	     */
 	    n = 0;
 	    for (j = 0; j < len; j++) {
 		if (soln[start+j*step] == TENT)
 		    k--;	       /* one fewer tent to place */
 		else if (soln[start+j*step] == BLANK)
-		    sc->locs[n++] = j;
+		    n++;
 	    }
 
 	    if (n == 0)
 		continue;	       /* nothing left to do here */
 
 	    /*
-	     * Now we know we're placing k tents in n squares. Set
-	     * up the first possibility.
+	     * Now we know we're placing k tents in n squares. (If k
+	     * is out of range, the only placement on offer is the
+	     * nearest one: no tents at all, or a tent in every free
+	     * square.)
+	     *
+	     * A placement is valid unless it contains two adjacent
+	     * tents. (Other forms of invalidity, such as containing
+	     * a tent adjacent to one already placed, will have been
+	     * dealt with already by other parts of the solver.) So
+	     * rather than iterate over all C(n,k) placements, we can
+	     * walk along the row once in each direction recording
+	     * which states are reachable, where a state is the
+	     * number of new tents placed so far and whether the last
+	     * square got one:
+	     *
+	     *   fwd[(j*(k+1)+c)*2+t]: squares 0..j-1 can hold c new
+	     *   tents, with a tent in square j-1 iff t.
+	     *
+	     *   bwd[(j*(k+1)+c)*2+t]: squares j..len-1 can hold c
+	     *   new tents, given a tent in square j-1 iff t.
+	     *
+	     * Combining the two tells us, for each square, whether
+	     * any valid placement gives it a tent, whether any
+	     * leaves it empty, and whether any leaves it and both
+	     * its neighbours empty (which is what matters to the
+	     * adjacent rows).
 	     */
-	    for (j = 0; j < n; j++)
-		sc->place[j] = (j < k ? TENT : NONTENT);
-
-	    /*
-	     * We're aiming to find squares in this row which are
-	     * invariant over all valid possibilities. Thus, we
-	     * maintain the current state of that invariance. We
-	     * start everything off at MAGIC to indicate that it
-	     * hasn't been set up yet.
-	     */
-	    mrow = sc->mrows;
-	    trow = sc->trows;
-	    trow1 = sc->trows + len;
-	    trow2 = sc->trows + 2*len;
-	    memset(mrow, MAGIC, 3*len);
-
-	    /*
-	     * And iterate over all possibilities.
-	     */
-	    while (1) {
-		int p;
-                bool valid;
-
-		/*
-		 * See if this possibility is valid. The only way
-		 * it can fail to be valid is if it contains two
-		 * adjacent tents. (Other forms of invalidity, such
-		 * as containing a tent adjacent to one already
-		 * placed, will have been dealt with already by
-		 * other parts of the solver.)
-		 */
-		valid = true;
-		for (j = 0; j+1 < n; j++)
-		    if (sc->place[j] == TENT &&
-			sc->place[j+1] == TENT &&
-			sc->locs[j+1] == sc->locs[j]+1) {
-			valid = false;
-			break;
-		    }
-
-		if (valid) {
-		    /*
-		     * Merge this valid combination into mrow.
-		     */
-		    memset(trow, MAGIC, len);
-		    memset(trow+len, BLANK, 2*len);
-		    for (j = 0; j < n; j++) {
-			trow[sc->locs[j]] = sc->place[j];
-			if (sc->place[j] == TENT) {
-			    int jj;
-			    for (jj = sc->locs[j]-1; jj <= sc->locs[j]+1; jj++)
-				if (jj >= 0 && jj < len)
-				    trow1[jj] = trow2[jj] = NONTENT;
-			}
-		    }
-
-		    for (j = 0; j < 3*len; j++) {
-			if (trow[j] == MAGIC)
-			    continue;
-			if (mrow[j] == MAGIC || mrow[j] == trow[j]) {
-			    /*
-			     * Either this is the first valid
-			     * placement we've found at all, or
-			     * this square's contents are
-			     * consistent with every previous valid
-			     * combination.
-			     */
-			    mrow[j] = trow[j];
-			} else {
-			    /*
-			     * This square's contents fail to match
-			     * what they were in a different
-			     * combination, so we cannot deduce
-			     * anything about this square.
-			     */
-			    mrow[j] = BLANK;
-			}
-		    }
+	    if (k < 0)
+		k = 0;
+	    if (k > n)
+		k = n;
+	    memset(sc->fwd, 0, (len+1) * (k+1) * 2);
+	    memset(sc->bwd, 0, (len+1) * (k+1) * 2);
+#define FWD(j,c,t) sc->fwd[((j)*(k+1)+(c))*2+(t)]
+#define BWD(j,c,t) sc->bwd[((j)*(k+1)+(c))*2+(t)]
+	    FWD(0, 0, 0) = true;
+	    for (j = 0; j < len; j++) {
+		bool isfree = (soln[start+j*step] == BLANK);
+		int c;
+		for (c = 0; c <= k; c++) {
+		    if (FWD(j, c, 0) || FWD(j, c, 1))
+			FWD(j+1, c, 0) = true;
+		    if (isfree && c < k && FWD(j, c, 0))
+			FWD(j+1, c+1, 1) = true;
 		}
-
-		/*
-		 * Find the next combination of k choices from n.
-		 * We do this by finding the rightmost tent which
-		 * can be moved one place right, doing so, and
-		 * shunting all tents to the right of that as far
-		 * left as they can go.
-		 */
-		p = 0;
-		for (j = n-1; j > 0; j--) {
-		    if (sc->place[j] == TENT)
-			p++;
-		    if (sc->place[j] == NONTENT && sc->place[j-1] == TENT) {
-			sc->place[j-1] = NONTENT;
-			sc->place[j] = TENT;
-			while (p--)
-			    sc->place[++j] = TENT;
-			while (++j < n)
-			    sc->place[j] = NONTENT;
-			break;
-		    }
+	    }
+	    BWD(len, 0, 0) = BWD(len, 0, 1) = true;
+	    for (j = len; j-- > 0;) {
+		bool isfree = (soln[start+j*step] == BLANK);
+		int c;
+		for (c = 0; c <= k; c++) {
+		    bool ok = BWD(j+1, c, 0);
+		    BWD(j, c, 1) = ok;
+		    if (isfree && c > 0 && BWD(j+1, c-1, 1))
+			ok = true;
+		    BWD(j, c, 0) = ok;
 		}
-		if (j <= 0)
-		    break;	       /* we've finished */
 	    }
 
 	    /*
@@ -843,9 +792,41 @@ static int tents_solve(int w, int h, const char *grid, int *numbers,
 	     * which case we have an internally inconsistent
 	     * puzzle.
 	     */
-	    if (mrow[sc->locs[0]] == MAGIC)
+	    if (!BWD(0, k, 0))
 		return 0;	       /* inconsistent */
 
+	    /*
+	     * Fill in mrow: for this row, TENT or NONTENT for a free
+	     * square that every valid placement agrees on, BLANK
+	     * where they differ, and MAGIC for squares that were
+	     * already known; for the adjacent rows, NONTENT for a
+	     * square next to a tent in every valid placement, and
+	     * BLANK otherwise.
+	     */
+	    mrow = sc->mrows;
+	    for (j = 0; j < len; j++) {
+		bool cantent = false, canempty = false, canclear = false;
+		int c;
+
+		for (c = 0; c <= k; c++) {
+		    if (c < k && FWD(j, c, 0) && BWD(j+1, k-c-1, 1))
+			cantent = true;
+		    if ((FWD(j, c, 0) || FWD(j, c, 1)) && BWD(j+1, k-c, 0))
+			canempty = true;
+		    if (FWD(j, c, 0) &&
+			(j+1 == len ? c == k : BWD(j+2, k-c, 0)))
+			canclear = true;
+		}
+
+		if (soln[start+j*step] != BLANK)
+		    mrow[j] = MAGIC;
+		else
+		    mrow[j] = (!canempty ? TENT : !cantent ? NONTENT : BLANK);
+		mrow[len+j] = mrow[2*len+j] = (canclear ? BLANK : NONTENT);
+	    }
+#undef FWD
+#undef BWD
+
 	    /*
 	     * Now go through mrow and see if there's anything
 	     * we've deduced which wasn't already mentioned in soln.
@@ -255,6 +255,8 @@ struct solver_ctx {
     int *clues;
     long *iscratch;
     int *dscratch;
+    /* latin_solver stamp at which each clue was last examined */
+    unsigned long *easyseen, *hardseen;
 };
 
 static int solver_easy(struct latin_solver *solver, void *vctx)
@@ -320,6 +322,13 @@ static int solver_easy(struct latin_solver *solver, void *vctx)
 	STARTSTEP(start, step, c, w);
 	CSTARTSTEP(cstart, cstep, c, w);
 
+	if (!latin_solver_line_changed(solver, ctx->easyseen[c],
+				       cstart, cstep, w)) {
+	    if (ret)
+		return ret;	       /* as looking at it would have */
+	    continue;
+	}
+
 	/* Find the location of each number in the row. */
 	for (i = 0; i < w; i++)
 	    ctx->dscratch[i] = w;
@@ -431,6 +440,8 @@ static int solver_easy(struct latin_solver *solver, void *vctx)
 		}
 	    i++;
 	}
+
+	ctx->easyseen[c] = solver->stamp;
     }
 
     if (ret)
@@ -458,6 +469,10 @@ static int solver_hard(struct latin_solver *solver, void *vctx)
 	    continue;
 	CSTARTSTEP(start, step, c, w);
 
+	if (!latin_solver_line_changed(solver, ctx->hardseen[c],
+				       start, step, w))
+	    continue;
+
 	for (i = 0; i < w; i++)
 	    ctx->iscratch[i] = 0;
 
@@ -567,6 +582,8 @@ static int solver_hard(struct latin_solver *solver, void *vctx)
 	    if (ret)
 		return ret;
 	}
+
+	ctx->hardseen[c] = solver->stamp;
     }
 
     return 0;
@@ -607,25 +624,43 @@ static bool towers_valid(struct latin_solver *solver, void *vctx)
     return true;
 }
 
-static int solver(int w, int *clues, digit *soln, int maxdiff)
+/*
+ * Solve into soln, taking all working memory from the arena 'ar' (and
+ * giving it back before returning), or from a private one if 'ar' is
+ * NULL.
+ */
+static int solver(int w, int *clues, digit *soln, int maxdiff, arena *ar)
 {
-    int ret;
+    int ret, i;
     struct solver_ctx ctx;
+    struct latin_solver solver;
+    arena *own = NULL;
+    arena_mark mark;
+
+    if (!ar)
+        ar = own = arena_new();
+    mark = arena_get_mark(ar);
 
     ctx.w = w;
     ctx.diff = maxdiff;
     ctx.clues = clues;
     ctx.started = false;
-    ctx.iscratch = snewn(w, long);
-    ctx.dscratch = snewn(w+1, int);
-
-    ret = latin_solver(soln, w, maxdiff,
-		       DIFF_EASY, DIFF_HARD, DIFF_EXTREME,
-		       DIFF_EXTREME, DIFF_UNREASONABLE,
-		       towers_solvers, towers_valid, &ctx, NULL, NULL);
-
-    sfree(ctx.iscratch);
-    sfree(ctx.dscratch);
+    ctx.iscratch = anewn(ar, w, long);
+    ctx.dscratch = anewn(ar, w+1, int);
+    ctx.easyseen = anewn(ar, 4*w, unsigned long);
+    ctx.hardseen = anewn(ar, 4*w, unsigned long);
+    for (i = 0; i < 4*w; i++)
+        ctx.easyseen[i] = ctx.hardseen[i] = 0;
+
+    latin_solver_alloc_arena(&solver, soln, w, ar);
+    ret = latin_solver_main(&solver, maxdiff,
+			    DIFF_EASY, DIFF_HARD, DIFF_EXTREME,
+			    DIFF_EXTREME, DIFF_UNREASONABLE,
+			    towers_solvers, towers_valid, &ctx, NULL, NULL);
+    latin_solver_free(&solver);
+
+    arena_release(ar, mark);
+    arena_free(own);
 
     return ret;
 }
@@ -643,6 +678,7 @@ static char *new_game_desc(const game_params *params, random_state *rs,
     int i, ret;
     int diff = params->diff;
     char *desc, *p;
+    arena *ar;
 
     /*
      * Difficulty exceptions: some combinations of size and
@@ -670,12 +706,18 @@ done
 	diff = DIFF_HARD;
 
     grid = NULL;
+    ar = arena_new();
     clues = snewn(4*w, int);
     soln = snewn(a, digit);
     soln2 = snewn(a, digit);
     order = snewn(max(4*w,a), int);
 
     while (1) {
+	if (random_cancelled(rs)) {
+	    desc = NULL;
+	    goto cleanup;
+	}
+
 	/*
 	 * Construct a latin square to be the solution.
 	 */
@@ -712,7 +754,7 @@ done
 	     * grids.
 	     */
 	    memset(soln2, 0, a);
-	    ret = solver(w, clues, soln2, diff);
+	    ret = solver(w, clues, soln2, diff, ar);
 	    if (ret > diff)
 		continue;
 	}
@@ -725,7 +767,7 @@ done
 
 	    memcpy(soln2, grid, a);
 	    soln2[j] = 0;
-	    ret = solver(w, clues, soln2, diff);
+	    ret = solver(w, clues, soln2, diff, ar);
 	    if (ret <= diff)
 		grid[j] = 0;
 	}
@@ -740,7 +782,7 @@ done
 
 		memcpy(soln2, grid, a);
 		clues[j] = 0;
-		ret = solver(w, clues, soln2, diff);
+		ret = solver(w, clues, soln2, diff, ar);
 		if (ret > diff)
 		    clues[j] = clue;
 	    }
@@ -751,7 +793,7 @@ done
 	 * level, but not at the one below.
 	 */
 	memcpy(soln2, grid, a);
-	ret = solver(w, clues, soln2, diff);
+	ret = solver(w, clues, soln2, diff, ar);
 	if (ret != diff)
 	    continue;		       /* go round again */
 
@@ -819,11 +861,13 @@ done
 	(*aux)[i+1] = '0' + soln[i];
     (*aux)[a+1] = '\0';
 
+  cleanup:
     sfree(grid);
     sfree(clues);
     sfree(soln);
     sfree(soln2);
     sfree(order);
+    arena_free(ar);
 
     return desc;
 }
@@ -1040,7 +1084,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
     soln = snewn(a, digit);
     memcpy(soln, state->clues->immutable, a);
 
-    ret = solver(w, state->clues->clues, soln, DIFFCOUNT-1);
+    ret = solver(w, state->clues->clues, soln, DIFFCOUNT-1, NULL);
 
     if (ret == diff_impossible) {
 	*error = _("No solution exists for this puzzle");
@@ -2178,7 +2222,7 @@ int main(int argc, char **argv)
     solver_show_working = 0;
     for (diff = 0; diff < DIFFCOUNT; diff++) {
 	memcpy(s->grid, s->clues->immutable, p->w * p->w);
-	ret = solver(p->w, s->clues->clues, s->grid, diff);
+	ret = solver(p->w, s->clues->clues, s->grid, diff, NULL);
 	if (ret <= diff)
 	    break;
     }
@@ -2191,7 +2235,7 @@ int main(int argc, char **argv)
         solver_show_working = really_show_working;
         memcpy(s->grid, s->clues->immutable, p->w * p->w);
         ret = solver(p->w, s->clues->clues, s->grid,
-                     diff < DIFFCOUNT ? diff : DIFFCOUNT-1);
+                     diff < DIFFCOUNT ? diff : DIFFCOUNT-1, NULL);
     }
 
     if (diff == DIFFCOUNT) {
@@ -903,10 +903,72 @@ static game_state *new_game(midend *me, const game_params *params, const char *d
     return state;
 }
 
+/* The deductions tracks_solve tries, in the order it tries them. */
+enum {
+    RULE_FLAGS, RULE_COUNT, RULE_LOOP,
+    RULE_SINGLE, RULE_LOOSE, RULE_NEIGHBOURS,
+    RULE_NEIGHBOURS_BOTH, RULE_BRIDGE,
+    NRULES
+};
+
+#ifdef STANDALONE_SOLVER
+static const char *const rule_names[NRULES] = {
+    "update flags", "count clues", "check loop",
+    "check single", "check loose ends", "check neighbours",
+    "check neighbours both ways", "bridge parity",
+};
+#endif
+
 struct solver_scratch {
     int *dsf;
+
+    /*
+     * Change tracking. Each deduction looks either at a single square
+     * or at a single row or column (the loop and bridge checks look at
+     * the whole grid), so once a rule has found nothing in one of
+     * those, it needn't look there again until something in it has
+     * changed. After each rule that makes progress, we compare sflags
+     * with 'prev' and stamp whatever changed; each rule remembers the
+     * stamp at which it last looked at each part.
+     */
+    unsigned long stamp, lastchange;
+    unsigned int *prev;             /* size w*h: sflags at the last stamp */
+    unsigned long *changed;         /* size w*h: when each square changed */
+    unsigned long *linechanged;     /* size w+h: columns, then rows */
+    unsigned long *seen[NRULES];    /* per square, line or grid */
+    struct {
+        int calls, progress, skipped;
+    } stats[NRULES];
 };
 
+static void solver_note_changes(game_state *state, struct solver_scratch *sc)
+{
+    int i, w = state->p.w, h = state->p.h;
+
+    sc->stamp++;
+    for (i = 0; i < w*h; i++) {
+        unsigned int f = state->sflags[i] & ~S_MARK;
+        if (f == sc->prev[i])
+            continue;
+        sc->prev[i] = f;
+        sc->changed[i] = sc->linechanged[i%w] = sc->linechanged[w+i/w] =
+            sc->lastchange = sc->stamp;
+    }
+}
+
+/* Returns true if 'rule' has already looked at square, line or grid
+ * 'part' since it last changed; otherwise marks it as looked at now. */
+static bool solver_seen(struct solver_scratch *sc, int rule, int part,
+                        unsigned long changed)
+{
+    if (sc->seen[rule][part] >= changed) {
+        sc->stats[rule].skipped++;
+        return true;
+    }
+    sc->seen[rule][part] = sc->stamp;
+    return false;
+}
+
 static int solve_set_sflag(game_state *state, int x, int y,
                            unsigned int f, const char *why)
 {
@@ -942,12 +1004,15 @@ static int solve_set_eflag(game_state *state, int x, int y, int d,
     return 1;
 }
 
-static int solve_update_flags(game_state *state)
+static int solve_update_flags(game_state *state, struct solver_scratch *sc)
 {
     int x, y, i, w = state->p.w, h = state->p.h, did = 0;
 
     for (x = 0; x < w; x++) {
         for (y = 0; y < h; y++) {
+            if (solver_seen(sc, RULE_FLAGS, y*w+x, sc->changed[y*w+x]))
+                continue;
+
             /* If a square is NOTRACK, all four edges must be. */
             if (state->sflags[y*w + x] & S_NOTRACK) {
                 for (i = 0; i < 4; i++) {
@@ -1044,15 +1109,19 @@ static int solve_count_clues_sub(game_state *state, int si, int id, int n,
     return did;
 }
 
-static int solve_count_clues(game_state *state)
+static int solve_count_clues(game_state *state, struct solver_scratch *sc)
 {
     int w = state->p.w, h = state->p.h, x, y, target, did = 0;
 
     for (x = 0; x < w; x++) {
+        if (solver_seen(sc, RULE_COUNT, x, sc->linechanged[x]))
+            continue;
         target = state->numbers->numbers[x];
         did += solve_count_clues_sub(state, x, w, h, target, "col count");
     }
     for (y = 0; y < h; y++) {
+        if (solver_seen(sc, RULE_COUNT, w+y, sc->linechanged[w+y]))
+            continue;
         target = state->numbers->numbers[w+y];
         did += solve_count_clues_sub(state, y*w, 1, w, target, "row count");
     }
@@ -1107,15 +1176,19 @@ static int solve_check_single_sub(game_state *state, int si, int id, int n,
     return did;
 }
 
-static int solve_check_single(game_state *state)
+static int solve_check_single(game_state *state, struct solver_scratch *sc)
 {
     int w = state->p.w, h = state->p.h, x, y, target, did = 0;
 
     for (x = 0; x < w; x++) {
+        if (solver_seen(sc, RULE_SINGLE, x, sc->linechanged[x]))
+            continue;
         target = state->numbers->numbers[x];
         did += solve_check_single_sub(state, x, w, h, target, R|L, "single on col");
     }
     for (y = 0; y < h; y++) {
+        if (solver_seen(sc, RULE_SINGLE, w+y, sc->linechanged[w+y]))
+            continue;
         target = state->numbers->numbers[w+y];
         did += solve_check_single_sub(state, y*w, 1, w, target, U|D, "single on row");
     }
@@ -1186,15 +1259,20 @@ static int solve_check_loose_sub(game_state *state, int si, int id, int n,
     return did;
 }
 
-static int solve_check_loose_ends(game_state *state)
+static int solve_check_loose_ends(game_state *state,
+                                  struct solver_scratch *sc)
 {
     int w = state->p.w, h = state->p.h, x, y, target, did = 0;
 
     for (x = 0; x < w; x++) {
+        if (solver_seen(sc, RULE_LOOSE, x, sc->linechanged[x]))
+            continue;
         target = state->numbers->numbers[x];
         did += solve_check_loose_sub(state, x, w, h, target, R|L, "loose on col");
     }
     for (y = 0; y < h; y++) {
+        if (solver_seen(sc, RULE_LOOSE, w+y, sc->linechanged[w+y]))
+            continue;
         target = state->numbers->numbers[w+y];
         did += solve_check_loose_sub(state, y*w, 1, w, target, U|D, "loose on row");
     }
@@ -1270,12 +1348,16 @@ static int solve_check_neighbours_try(game_state *state, int x, int y,
     return did;
 }
 
-static int solve_check_neighbours(game_state *state, bool both_ways)
+static int solve_check_neighbours(game_state *state, bool both_ways,
+                                  struct solver_scratch *sc)
 {
     int w = state->p.w, h = state->p.h, x, y, did = 0;
+    int rule = both_ways ? RULE_NEIGHBOURS_BOTH : RULE_NEIGHBOURS;
     bool onefill, oneempty;
 
     for (x = 0; x < w; x++) {
+        if (solver_seen(sc, rule, x, sc->linechanged[x]))
+            continue;
         solve_check_neighbours_count(state, x, w, h, x, &onefill, &oneempty);
         if (!both_ways)
             oneempty = false; /* disable the harder version of the deduction */
@@ -1289,6 +1371,8 @@ static int solve_check_neighbours(game_state *state, bool both_ways)
         }
     }
     for (y = 0; y < h; y++) {
+        if (solver_seen(sc, rule, w+y, sc->linechanged[w+y]))
+            continue;
         solve_check_neighbours_count(state, y*w, 1, w, w+y,
                                      &onefill, &oneempty);
         if (!both_ways)
@@ -1355,11 +1439,14 @@ static int solve_check_loop_sub(game_state *state, int x, int y, int dir,
     return 0;
 }
 
-static int solve_check_loop(game_state *state)
+static int solve_check_loop(game_state *state, struct solver_scratch *sc)
 {
     int w = state->p.w, h = state->p.h, x, y, i, j, did = 0;
     int *dsf, startc, endc;
 
+    if (solver_seen(sc, RULE_LOOP, 0, sc->lastchange))
+        return 0;
+
     /* TODO eventually we should pull this out into a solver struct and keep it
        updated as we connect squares. For now we recreate it every time we try
        this particular solver step. */
@@ -1530,6 +1617,9 @@ static int solve_check_bridge_parity(game_state *state,
     struct solve_bridge_neighbour_ctx ctx[1];
     int x, y, did = 0;
 
+    if (solver_seen(sc, RULE_BRIDGE, 0, sc->lastchange))
+        return 0;
+
     ctx->state = state;
     fls = findloop_new_state(wh);
     findloop_run(fls, wh, solve_bridge_neighbour, ctx);
@@ -1550,7 +1640,7 @@ static int solve_check_bridge_parity(game_state *state,
 
 static int tracks_solve(game_state *state, int diff, int *max_diff_out)
 {
-    int x, y, w = state->p.w, h = state->p.h;
+    int x, y, i, w = state->p.w, h = state->p.h;
     struct solver_scratch sc[1];
     int max_diff = DIFF_EASY;
 
@@ -1569,32 +1659,68 @@ static int tracks_solve(game_state *state, int diff, int *max_diff_out)
         solve_discount_edge(state, w-1, y, R);
     }
 
+    /* Everything starts out changed, at stamp 1, and unseen. */
+    sc->stamp = sc->lastchange = 1;
+    sc->prev = snewn(w*h, unsigned int);
+    sc->changed = snewn(w*h, unsigned long);
+    sc->linechanged = snewn(w+h, unsigned long);
+    for (i = 0; i < w*h; i++) {
+        sc->prev[i] = state->sflags[i] & ~S_MARK;
+        sc->changed[i] = 1;
+    }
+    for (i = 0; i < w+h; i++)
+        sc->linechanged[i] = 1;
+    for (i = 0; i < NRULES; i++) {
+        int n = (i == RULE_FLAGS ? w*h : i == RULE_LOOP ||
+                 i == RULE_BRIDGE ? 1 : w+h);
+        sc->seen[i] = snewn(n, unsigned long);
+        memset(sc->seen[i], 0, n * sizeof(unsigned long));
+        sc->stats[i].calls = sc->stats[i].progress = sc->stats[i].skipped = 0;
+    }
+
     while (!state->impossible) {
 
 /* Can't use do ... while (0) because we need a 'continue' in this macro */
-#define TRY(curr_diff, funcall)                         \
-        if (diff >= (curr_diff) && (funcall)) {         \
+#define TRY(curr_diff, rule, funcall)                   \
+        if (diff >= (curr_diff) &&                      \
+            (sc->stats[rule].calls++, (funcall))) {     \
+            sc->stats[rule].progress++;                 \
+            solver_note_changes(state, sc);             \
             if (max_diff < curr_diff)                   \
                 max_diff = curr_diff;                   \
             continue;                                   \
         } else ((void)0)
 
-        TRY(DIFF_EASY, solve_update_flags(state));
-        TRY(DIFF_EASY, solve_count_clues(state));
-        TRY(DIFF_EASY, solve_check_loop(state));
+        TRY(DIFF_EASY, RULE_FLAGS, solve_update_flags(state, sc));
+        TRY(DIFF_EASY, RULE_COUNT, solve_count_clues(state, sc));
+        TRY(DIFF_EASY, RULE_LOOP, solve_check_loop(state, sc));
 
-        TRY(DIFF_TRICKY, solve_check_single(state));
-        TRY(DIFF_TRICKY, solve_check_loose_ends(state));
-        TRY(DIFF_TRICKY, solve_check_neighbours(state, false));
+        TRY(DIFF_TRICKY, RULE_SINGLE, solve_check_single(state, sc));
+        TRY(DIFF_TRICKY, RULE_LOOSE, solve_check_loose_ends(state, sc));
+        TRY(DIFF_TRICKY, RULE_NEIGHBOURS,
+            solve_check_neighbours(state, false, sc));
 
-        TRY(DIFF_HARD, solve_check_neighbours(state, true));
-        TRY(DIFF_HARD, solve_check_bridge_parity(state, sc));
+        TRY(DIFF_HARD, RULE_NEIGHBOURS_BOTH,
+            solve_check_neighbours(state, true, sc));
+        TRY(DIFF_HARD, RULE_BRIDGE, solve_check_bridge_parity(state, sc));
 
 #undef TRY
 
         break;
     }
 
+#ifdef STANDALONE_SOLVER
+    for (i = 0; i < NRULES; i++)
+        solverdebug(("%s: %d calls, %d made progress, %d parts skipped",
+                     rule_names[i], sc->stats[i].calls,
+                     sc->stats[i].progress, sc->stats[i].skipped));
+#endif
+
+    for (i = 0; i < NRULES; i++)
+        sfree(sc->seen[i]);
+    sfree(sc->linechanged);
+    sfree(sc->changed);
+    sfree(sc->prev);
     sfree(sc->dsf);
 
     if (max_diff_out)
@@ -52,6 +52,7 @@ typedef struct node234_Tag node234;
 struct tree234_Tag {
     node234 *root;
     cmpfn234 cmp;
+    node234 *spare;		       /* freelist, chained through parent */
 };
 
 struct node234_Tag {
@@ -69,9 +70,29 @@ tree234 *newtree234(cmpfn234 cmp) {
     LOG(("created tree %p\n", ret));
     ret->root = NULL;
     ret->cmp = cmp;
+    ret->spare = NULL;
     return ret;
 }
 
+/*
+ * Allocate a node for a tree, reusing one from its freelist if
+ * there is one, and give a node back to the freelist. Nodes are
+ * still individually allocated, so join and split can move them
+ * between trees freely.
+ */
+static node234 *newnode234(tree234 *t) {
+    node234 *n = t->spare;
+    if (n) {
+	t->spare = n->parent;
+	return n;
+    }
+    return snew(node234);
+}
+static void releasenode234(tree234 *t, node234 *n) {
+    n->parent = t->spare;
+    t->spare = n;
+}
+
 /*
  * Free a 2-3-4 tree (not including freeing the elements).
  */
@@ -85,10 +106,33 @@ static void freenode234(node234 *n) {
     sfree(n);
 }
 void freetree234(tree234 *t) {
+    node234 *n;
     freenode234(t->root);
+    while ((n = t->spare) != NULL) {
+	t->spare = n->parent;
+	sfree(n);
+    }
     sfree(t);
 }
 
+/*
+ * Empty a 2-3-4 tree (not including freeing the elements), keeping
+ * its nodes for reuse.
+ */
+static void clearnode234(tree234 *t, node234 *n) {
+    if (!n)
+	return;
+    clearnode234(t, n->kids[0]);
+    clearnode234(t, n->kids[1]);
+    clearnode234(t, n->kids[2]);
+    clearnode234(t, n->kids[3]);
+    releasenode234(t, n);
+}
+void cleartree234(tree234 *t) {
+    clearnode234(t, t->root);
+    t->root = NULL;
+}
+
 /*
  * Internal function to count a node.
  */
@@ -119,7 +163,7 @@ int count234(tree234 *t) {
  * Propagate a node overflow up a tree until it stops. Returns 0 or
  * 1, depending on whether the root had to be split or not.
  */
-static int add234_insert(node234 *left, void *e, node234 *right,
+static int add234_insert(tree234 *t, node234 *left, void *e, node234 *right,
 			 node234 **root, node234 *n, int ki) {
     int lcount, rcount;
     /*
@@ -192,7 +236,7 @@ static int add234_insert(node234 *left, void *e, node234 *right,
 	    LOG(("  done\n"));
 	    break;
 	} else {
-	    node234 *m = snew(node234);
+	    node234 *m = newnode234(t);
 	    m->parent = n->parent;
 	    LOG(("  splitting a 4-node; created new node %p\n", m));
 	    /*
@@ -288,7 +332,7 @@ static int add234_insert(node234 *left, void *e, node234 *right,
 	return 0;		       /* root unchanged */
     } else {
 	LOG(("  root is overloaded, split into two\n"));
-	(*root) = snew(node234);
+	(*root) = newnode234(t);
 	(*root)->kids[0] = left;     (*root)->counts[0] = lcount;
 	(*root)->elems[0] = e;
 	(*root)->kids[1] = right;    (*root)->counts[1] = rcount;
@@ -319,7 +363,7 @@ static void *add234_internal(tree234 *t, void *e, int index) {
 
     LOG(("adding element \"%s\" to tree %p\n", e, t));
     if (t->root == NULL) {
-	t->root = snew(node234);
+	t->root = newnode234(t);
 	t->root->elems[1] = t->root->elems[2] = NULL;
 	t->root->kids[0] = t->root->kids[1] = NULL;
 	t->root->kids[2] = t->root->kids[3] = NULL;
@@ -387,7 +431,7 @@ static void *add234_internal(tree234 *t, void *e, int index) {
 	n = n->kids[ki];
     } while (n);
 
-    add234_insert(NULL, e, NULL, &t->root, n, ki);
+    add234_insert(t, NULL, e, NULL, &t->root, n, ki);
 
     return orig_e;
 }
@@ -784,7 +828,8 @@ static void trans234_subtree_left(node234 *n, int ki, int *k, int *index) {
  *   /     \       ->        |
  *  a   b B c C d      a A b B c C d
  */
-static void trans234_subtree_merge(node234 *n, int ki, int *k, int *index) {
+static void trans234_subtree_merge(tree234 *t, node234 *n, int ki,
+                                   int *k, int *index) {
     node234 *left, *right;
     int i, leftlen, rightlen, lsize, rsize;
 
@@ -828,7 +873,7 @@ static void trans234_subtree_merge(node234 *n, int ki, int *k, int *index) {
 
     n->counts[ki] += rightlen + 1;
 
-    sfree(right);
+    releasenode234(t, right);
 
     /*
      * Move the rest of n up by one.
@@ -955,7 +1000,7 @@ static void *delpos234_internal(tree234 *t, int index) {
 		 * ki is small with only small neighbours. Pick a
 		 * neighbour and merge with it.
 		 */
-		trans234_subtree_merge(n, ki>0 ? ki-1 : ki, &ki, &index);
+		trans234_subtree_merge(t, n, ki>0 ? ki-1 : ki, &ki, &index);
 		sub = n->kids[ki];
 
 		if (!n->elems[0]) {
@@ -966,7 +1011,7 @@ static void *delpos234_internal(tree234 *t, int index) {
 		    LOG(("  shifting root!\n"));
 		    t->root = sub;
 		    sub->parent = NULL;
-		    sfree(n);
+		    releasenode234(t, n);
 		    n = NULL;
 		}
 	    }
@@ -998,7 +1043,7 @@ static void *delpos234_internal(tree234 *t, int index) {
     if (!n->elems[0]) {
 	LOG(("  removed last element in tree, destroying empty root\n"));
 	assert(n == t->root);
-	sfree(n);
+	releasenode234(t, n);
 	t->root = NULL;
     }
 
@@ -1030,7 +1075,7 @@ void *del234(tree234 *t, void *e) {
  * resulting tree is the same height as the original larger one, or
  * one higher.
  */
-static node234 *join234_internal(node234 *left, void *sep,
+static node234 *join234_internal(tree234 *t, node234 *left, void *sep,
 				 node234 *right, int *height) {
     node234 *root, *node;
     int relht = *height;
@@ -1045,7 +1090,7 @@ static node234 *join234_internal(node234 *left, void *sep,
 	 * nodes.
 	 */
 	node234 *newroot;
-	newroot = snew(node234);
+	newroot = newnode234(t);
 	newroot->kids[0] = left;     newroot->counts[0] = countnode234(left);
 	newroot->elems[0] = sep;
 	newroot->kids[1] = right;    newroot->counts[1] = countnode234(right);
@@ -1105,7 +1150,7 @@ static node234 *join234_internal(node234 *left, void *sep,
     /*
      * Now proceed as for addition.
      */
-    *height = add234_insert(left, sep, right, &root, node, ki);
+    *height = add234_insert(t, left, sep, right, &root, node, ki);
 
     return root;
 }
@@ -1133,7 +1178,7 @@ tree234 *join234(tree234 *t1, tree234 *t2) {
 
 	element = delpos234(t2, 0);
 	relht = height234(t1) - height234(t2);
-	t1->root = join234_internal(t1->root, element, t2->root, &relht);
+	t1->root = join234_internal(t1, t1->root, element, t2->root, &relht);
 	t2->root = NULL;
     }
     return t1;
@@ -1153,7 +1198,7 @@ tree234 *join234r(tree234 *t1, tree234 *t2) {
 
 	element = delpos234(t1, size1-1);
 	relht = height234(t1) - height234(t2);
-	t2->root = join234_internal(t1->root, element, t2->root, &relht);
+	t2->root = join234_internal(t2, t1->root, element, t2->root, &relht);
 	t1->root = NULL;
     }
     return t2;
@@ -1222,7 +1267,7 @@ static node234 *split234_internal(tree234 *t, int index) {
 	 * new node pointers in halves[0] and halves[1], and go up
 	 * a level.
 	 */
-	sib = snew(node234);
+	sib = newnode234(t);
 	for (i = 0; i < 3; i++) {
 	    if (i+ki < 3 && n->elems[i+ki]) {
 		sib->elems[i] = n->elems[i+ki];
@@ -1297,7 +1342,7 @@ static node234 *split234_internal(tree234 *t, int index) {
 	while (halves[half] && !halves[half]->elems[0]) {
 	    LOG(("  root %p is undersize, throwing away\n", halves[half]));
 	    halves[half] = halves[half]->kids[0];
-	    sfree(halves[half]->parent);
+	    releasenode234(t, halves[half]->parent);
 	    halves[half]->parent = NULL;
 	    LOG(("  new root is %p\n", halves[half]));
 	}
@@ -1354,7 +1399,7 @@ static node234 *split234_internal(tree234 *t, int index) {
 		     * Neighbour is small, or possibly neighbour is
 		     * medium and we are undersize.
 		     */
-		    trans234_subtree_merge(n, merge, NULL, NULL);
+		    trans234_subtree_merge(t, n, merge, NULL, NULL);
 		    sub = n->kids[merge];
 		    if (!n->elems[0]) {
 			/*
@@ -1365,7 +1410,7 @@ static node234 *split234_internal(tree234 *t, int index) {
 			LOG(("  shifting root!\n"));
 			halves[half] = sub;
 			halves[half]->parent = NULL;
-			sfree(n);
+			releasenode234(t, n);
 		    }
 		} else {
 		    /* Neighbour is big enough to move trees over. */
@@ -1458,6 +1503,63 @@ tree234 *copytree234(tree234 *t, copyfn234 copyfn, void *copyfnstate) {
     return t2;
 }
 
+/*
+ * Build a tree of the given height directly from an array. `cap'
+ * is the largest number of elements a subtree of height-1 can hold
+ * (4^(height-1)-1); each node takes as few children as will hold
+ * its elements and shares the elements out evenly among them, which
+ * keeps every subtree within its minimum and maximum size.
+ */
+static node234 *buildnode234(void **elems, int n, int height, long cap) {
+    node234 *node = snew(node234);
+    int i, k, pos;
+
+    for (i = 0; i < 4; i++) {
+	node->kids[i] = NULL;
+	node->counts[i] = 0;
+    }
+    for (i = 0; i < 3; i++)
+	node->elems[i] = NULL;
+    node->parent = NULL;
+
+    if (height == 1) {
+	assert(n >= 1 && n <= 3);
+	for (i = 0; i < n; i++)
+	    node->elems[i] = elems[i];
+	return node;
+    }
+
+    for (k = 2; k < 4 && n > k * cap + k - 1; k++);
+    pos = 0;
+    for (i = 0; i < k; i++) {
+	int m = (n - (k-1)) / k + (i < (n - (k-1)) % k);
+	node->kids[i] = buildnode234(elems + pos, m, height-1, (cap-3)/4);
+	node->kids[i]->parent = node;
+	node->counts[i] = m;
+	pos += m;
+	if (i < k-1)
+	    node->elems[i] = elems[pos++];
+    }
+    return node;
+}
+tree234 *buildtree234(cmpfn234 cmp, void **elems, int n) {
+    tree234 *t;
+    int i, height;
+    long cap;
+
+    if (cmp)
+	for (i = 1; i < n; i++)
+	    if (cmp(elems[i-1], elems[i]) >= 0)
+		return NULL;
+
+    t = newtree234(cmp);
+    if (n > 0) {
+	for (height = 1, cap = 0; cap*4+3 < n; height++, cap = cap*4+3);
+	t->root = buildnode234(elems, n, height, cap);
+    }
+    return t;
+}
+
 #ifdef TEST
 
 /*
@@ -1902,6 +2004,10 @@ int mycmp(void *av, void *bv) {
     return strcmp(a, b);
 }
 
+int mycmpq(const void *av, const void *bv) {
+    return mycmp(*(void *const *)av, *(void *const *)bv);
+}
+
 const char *const strings_init[] = {
     "0", "2", "3", "I", "K", "d", "H", "J", "Q", "N", "n", "q", "j", "i",
     "7", "G", "F", "D", "b", "x", "g", "B", "e", "v", "V", "T", "f", "E",
@@ -2198,6 +2304,38 @@ int main(void) {
     verifytree(tree3, array, 2);
     verifytree(tree, array, 0);
 
+    /*
+     * Bulk building: every size from empty up to all the strings,
+     * sorted and unsorted, must produce a valid tree. Then clear
+     * and refill one, and check an out-of-order array is refused.
+     */
+    freetree234(tree);
+    freetree234(tree2);
+    freetree234(tree3);
+    freetree234(tree4);
+    for (i = 0; i <= NSTR; i++) {
+	for (j = 0; j < i; j++)
+	    array[j] = strings[j];
+	qsort(array, i, sizeof(*array), mycmpq);
+	tree = buildtree234(mycmp, array, i);
+	verifytree(tree, array, i);
+	freetree234(tree);
+	tree = buildtree234(NULL, array, i);
+	verifytree(tree, array, i);
+	freetree234(tree);
+    }
+    tree = buildtree234(mycmp, array, NSTR);
+    cleartree234(tree);
+    verifytree(tree, array, 0);
+    for (i = 0; i < NSTR; i++)
+	add234(tree, array[i]);
+    verifytree(tree, array, NSTR);
+    freetree234(tree);
+    array[0] = strings[1];
+    array[1] = strings[0];
+    assert(mycmp(array[0], array[1]) > 0);
+    assert(buildtree234(mycmp, array, 2) == NULL);
+
     return 0;
 }
 
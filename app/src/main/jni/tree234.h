@@ -201,4 +201,20 @@ tree234 *join234r(tree234 *t1, tree234 *t2);
  */
 tree234 *copytree234(tree234 *t, copyfn234 copyfn, void *copyfnstate);
 
+/*
+ * Build a tree from an array of n elements in one pass, in time
+ * linear in n. For a sorted tree the array must already be in
+ * strictly increasing order under cmp; NULL is returned if it is
+ * not. For an unsorted tree (cmp NULL) the array order is kept.
+ */
+tree234 *buildtree234(cmpfn234 cmp, void **elems, int n);
+
+/*
+ * Remove every element from a tree (not including freeing the
+ * elements). The tree's nodes are kept and reused by later
+ * additions, so refilling a cleared tree is cheaper than building
+ * a new one.
+ */
+void cleartree234(tree234 *t);
+
 #endif /* TREE234_H */
@@ -205,6 +205,14 @@ static const char *validate_params(const game_params *params, bool full)
 /* --------------------------------------------------------------- */
 /* Game state allocation, deallocation. */
 
+/* A monster cell along a path, with the monster types (as guess bits)
+ * that would be counted there from each end of the path. */
+struct pathview {
+    int monster;
+    int slot;                   /* index of monster in mapping */
+    int seen_start, seen_end;
+};
+
 struct path {
     int length;
     int *p;
@@ -215,6 +223,8 @@ struct path {
     int sightings_start;
     int sightings_end;
     int *xy;
+    int num_views;
+    struct pathview *views;     /* the non-mirror cells of p, in order */
 };
 
 struct game_common {
@@ -276,6 +286,9 @@ static game_state *new_state(const game_params *params) {
         state->common->paths[i].p = snewn(state->common->wh,int);
         state->common->paths[i].xy = snewn(state->common->wh,int);
         state->common->paths[i].mapping = snewn(state->common->wh,int);
+        state->common->paths[i].num_views = 0;
+        state->common->paths[i].views =
+            snewn(state->common->wh,struct pathview);
     }
 
     state->guess = NULL;
@@ -356,6 +369,7 @@ static void free_game(game_state *state) {
     state->common->refcount--;
     if (state->common->refcount == 0) {
         for (i=0;i<state->common->num_paths;i++) {
+            sfree(state->common->paths[i].views);
             sfree(state->common->paths[i].mapping);
             sfree(state->common->paths[i].xy);
             sfree(state->common->paths[i].p);
@@ -433,6 +447,28 @@ static int grid2range(int x, int y, int w, int h) {
     return 2*(w+h) - y;
 }
 
+static void make_views(struct path *path) {
+    int i, j;
+    bool mirror;
+
+    path->num_views = 0;
+    mirror = false;
+    for (i=0;i<path->length;i++) {
+        struct pathview *v;
+        if (path->p[i] == -1) { mirror = true; continue; }
+        v = &path->views[path->num_views++];
+        v->monster = path->p[i];
+        for (j=0;path->mapping[j] != v->monster;j++);
+        v->slot = j;
+        v->seen_start = (mirror ? 1 : 2) | 4;
+    }
+    mirror = false;
+    for (i=path->length-1,j=path->num_views;i>=0;i--) {
+        if (path->p[i] == -1) { mirror = true; continue; }
+        path->views[--j].seen_end = (mirror ? 1 : 2) | 4;
+    }
+}
+
 static void make_paths(game_state *state) {
     int i;
     int count = 0;
@@ -520,11 +556,29 @@ static void make_paths(game_state *state) {
                 if (state->common->paths[count].mapping[j] == m) found = true;
             if (!found) state->common->paths[count].mapping[c++] = m;
         }
+
+        /* Generate view vector: a ghost is only seen in a mirror, a
+         * vampire only directly, and a zombie either way */
+        make_views(&state->common->paths[count]);
         count++;
     }
     return;
 }
 
+/* Count the monsters seen from each end of a path, given a single
+ * monster type (1, 2 or 4) for each entry of its mapping. */
+static void path_sightings(const struct path *path, const int *g,
+                           int *start, int *end) {
+    int i, m;
+
+    *start = *end = 0;
+    for (i=0;i<path->num_views;i++) {
+        m = g[path->views[i].slot];
+        if (m & path->views[i].seen_start) (*start)++;
+        if (m & path->views[i].seen_end) (*end)++;
+    }
+}
+
 struct guess {
     int length;
     int *guess;
@@ -638,47 +692,10 @@ static void get_unique(game_state *state, int counter, random_state *rs) {
         view_count[i] = 0;
     
     do {
-        bool mirror;
         int start_view, end_view;
-        
-        mirror = false;
-        start_view = 0;
-        for (p=0;p<state->common->paths[counter].length;p++) {
-            if (state->common->paths[counter].p[p] == -1) mirror = true;
-            else {
-                for (i=0;i<path_guess.length;i++) {
-                    if (state->common->paths[counter].p[p] ==
-                        state->common->paths[counter].mapping[i]) {
-                        if (path_guess.guess[i] == 1 && mirror)
-                            start_view++;
-                        if (path_guess.guess[i] == 2 && !mirror)
-                            start_view++;
-                        if (path_guess.guess[i] == 4)
-                            start_view++;
-                        break;
-                    }
-                }
-            }
-        }
-        mirror = false;
-        end_view = 0;
-        for (p=state->common->paths[counter].length-1;p>=0;p--) {
-            if (state->common->paths[counter].p[p] == -1) mirror = true;
-            else {
-                for (i=0;i<path_guess.length;i++) {
-                    if (state->common->paths[counter].p[p] ==
-                        state->common->paths[counter].mapping[i]) {
-                        if (path_guess.guess[i] == 1 && mirror)
-                            end_view++;
-                        if (path_guess.guess[i] == 2 && !mirror)
-                            end_view++;
-                        if (path_guess.guess[i] == 4)
-                            end_view++;
-                        break;
-                    }
-                }
-            }
-        }
+
+        path_sightings(&state->common->paths[counter], path_guess.guess,
+                       &start_view, &end_view);
 
         assert(start_view >= 0 && start_view < pathlimit);
         assert(end_view >= 0 && end_view < pathlimit);
@@ -805,54 +822,21 @@ static bool check_numbers(game_state *state, int *guess) {
     return valid;
 }
 
-static bool check_solution(int *g, struct path path) {
-    int i;
-    bool mirror;
-    int count;
-
-    count = 0;
-    mirror = false;
-    for (i=0;i<path.length;i++) {
-        if (path.p[i] == -1) mirror = true;
-        else {
-            if (g[path.p[i]] == 1 && mirror) count++;
-            else if (g[path.p[i]] == 2 && !mirror) count++;
-            else if (g[path.p[i]] == 4) count++;
-        }
-    }
-    if (count != path.sightings_start) return false;    
-
-    count = 0;
-    mirror = false;
-    for (i=path.length-1;i>=0;i--) {
-        if (path.p[i] == -1) mirror = true;
-        else {
-            if (g[path.p[i]] == 1 && mirror) count++;
-            else if (g[path.p[i]] == 2 && !mirror) count++;
-            else if (g[path.p[i]] == 4) count++;
-        }
-    }
-    if (count != path.sightings_end) return false;  
-
-    return true;
-}
-
 static bool solve_iterative(game_state *state, struct path *paths) {
     bool solved;
-    int p,i,j,count;
+    int p,i,j,g,start,end;
+    int base_ghosts, base_vampires, base_zombies;
+    int count_ghosts, count_vampires, count_zombies;
 
-    int *guess;
     int *possible;
 
     struct guess loop;
 
     solved = true;
     loop.length = state->common->num_total;
-    guess = snewn(state->common->num_total,int);
     possible = snewn(state->common->num_total,int);
 
     for (i=0;i<state->common->num_total;i++) {
-        guess[i] = state->guess[i];
         possible[i] = 0;
     }
 
@@ -876,17 +860,41 @@ static bool solve_iterative(game_state *state, struct path *paths) {
                 possible[paths[p].mapping[i]] = 0;
             }
 
+            /* Monsters off this path are the same for every guess, so
+             * count them once and add each guess's own monsters on */
+            base_ghosts = base_vampires = base_zombies = 0;
+            for (i=0;i<state->common->num_total;i++) {
+                g = state->guess[i];
+                if (g == 1) base_ghosts++;
+                if (g == 2) base_vampires++;
+                if (g == 4) base_zombies++;
+            }
+            for (i=0;i<paths[p].num_monsters;i++) {
+                g = state->guess[paths[p].mapping[i]];
+                if (g == 1) base_ghosts--;
+                if (g == 2) base_vampires--;
+                if (g == 4) base_zombies--;
+            }
+
             while(true) {
-                for (i=0;i<state->common->num_total;i++) {
-                    guess[i] = state->guess[i];
+                count_ghosts = base_ghosts;
+                count_vampires = base_vampires;
+                count_zombies = base_zombies;
+                for (i=0;i<paths[p].num_monsters;i++) {
+                    g = loop.guess[i];
+                    if (g == 1) count_ghosts++;
+                    if (g == 2) count_vampires++;
+                    if (g == 4) count_zombies++;
+                }
+                if (count_ghosts <= state->common->num_ghosts &&
+                    count_vampires <= state->common->num_vampires &&
+                    count_zombies <= state->common->num_zombies) {
+                    path_sightings(&paths[p], loop.guess, &start, &end);
+                    if (start == paths[p].sightings_start &&
+                        end == paths[p].sightings_end)
+                        for (j=0;j<paths[p].num_monsters;j++)
+                            possible[paths[p].mapping[j]] |= loop.guess[j];
                 }
-                count = 0;
-                for (i=0;i<paths[p].num_monsters;i++) 
-                    guess[paths[p].mapping[i]] = loop.guess[count++];
-                if (check_numbers(state,guess) &&
-                    check_solution(guess,paths[p]))
-                    for (j=0;j<paths[p].num_monsters;j++)
-                        possible[paths[p].mapping[j]] |= loop.guess[j];
                 if (!next_list(&loop,loop.length-1)) break;
             }
             for (i=0;i<paths[p].num_monsters;i++)       
@@ -905,65 +913,142 @@ static bool solve_iterative(game_state *state, struct path *paths) {
     }
 
     sfree(possible);
-    sfree(guess);
 
     return solved;
 }
 
-static bool solve_bruteforce(game_state *state, struct path *paths) {
-    bool solved, correct;
-    int number_solutions;
-    int p,i;
+/*
+ * The brute-force solver: a search over every monster that
+ * solve_iterative couldn't pin down, trying its possibilities in
+ * ascending order and lowest-numbered monster first, and stopping
+ * at the second solution. Partial assignments are pruned as soon as
+ * some count can no longer be met.
+ */
+struct bruteforce_ctx {
+    game_state *state;
+    struct path *paths;
+    int *guess;                 /* 1, 2 or 4 if decided, else a mask */
+};
 
-    struct guess loop;
+static bool bruteforce_single(int g) {
+    return g == 1 || g == 2 || g == 4;
+}
 
-    loop.guess = snewn(state->common->num_total,int);
-    loop.possible = snewn(state->common->num_total,int);
+static bool bruteforce_propagate(searcher *s, void *vctx) {
+    struct bruteforce_ctx *ctx = (struct bruteforce_ctx *)vctx;
+    game_state *state = ctx->state;
+    int p, i, dir;
 
-    for (i=0;i<state->common->num_total;i++) {
-        loop.possible[i] = state->guess[i];
-        switch (state->guess[i]) {
-          case 1: loop.guess[i] = 1; break;
-          case 2: loop.guess[i] = 2; break;
-          case 3: loop.guess[i] = 1; break;
-          case 4: loop.guess[i] = 4; break;
-          case 5: loop.guess[i] = 1; break;
-          case 6: loop.guess[i] = 2; break;
-          case 7: loop.guess[i] = 1; break;
+    for (i=0;i<state->common->num_total;i++)
+        if (ctx->guess[i] == 0) return false;
+    if (!check_numbers(state, ctx->guess)) return false;
+
+    /*
+     * For each sighting count, count the monsters that are definitely
+     * seen and those that might be. The count must lie in between.
+     */
+    for (p=0;p<state->common->num_paths;p++) {
+        struct path *path = &ctx->paths[p];
+        for (dir=0;dir<2;dir++) {
+            int lo = 0, hi = 0;
+            for (i=0;i<path->num_views;i++) {
+                struct pathview *v = &path->views[i];
+                int g = ctx->guess[v->monster];
+                if (g & (dir ? v->seen_end : v->seen_start)) {
+                    hi++;
+                    if (bruteforce_single(g)) lo++;
+                }
+            }
+            if (dir == 0 && (path->sightings_start < lo ||
+                             path->sightings_start > hi)) return false;
+            if (dir == 1 && (path->sightings_end < lo ||
+                             path->sightings_end > hi)) return false;
         }
     }
 
-    solved = false;
-    number_solutions = 0;
+    return true;
+}
 
-    while (true) {
+static int bruteforce_branch(searcher *s, void *vctx, int *where) {
+    struct bruteforce_ctx *ctx = (struct bruteforce_ctx *)vctx;
+    int i, g;
 
-        correct = true;
-        if (!check_numbers(state,loop.guess)) correct = false;
-        else 
-            for (p=0;p<state->common->num_paths;p++)
-                if (!check_solution(loop.guess,paths[p])) {
-                    correct = false; break;
-                }
-        if (correct) {
-            number_solutions++;
-            solved = true;
-            if(number_solutions > 1) {
-                solved = false;
-                break; 
-            }
-            for (i=0;i<state->common->num_total;i++)
-                state->guess[i] = loop.guess[i];
-        }
-        if (!next_list(&loop,state->common->num_total -1)) {
-            break;
+    for (i=0;i<ctx->state->common->num_total;i++) {
+        g = ctx->guess[i];
+        if (!bruteforce_single(g)) {
+            *where = i;
+            return (g & 1) + ((g >> 1) & 1) + ((g >> 2) & 1);
         }
     }
+    return 0;
+}
 
-    sfree(loop.possible);
-    sfree(loop.guess);
+static bool bruteforce_choose(searcher *s, void *vctx, int where, int i) {
+    struct bruteforce_ctx *ctx = (struct bruteforce_ctx *)vctx;
+    int g = ctx->guess[where], bit;
 
-    return solved;
+    for (bit=1;bit<=4;bit<<=1)
+        if ((g & bit) && i-- == 0) break;
+    search_set_int(s, &ctx->guess[where], bit);
+    return true;
+}
+
+static void bruteforce_solution(searcher *s, void *vctx) {
+    struct bruteforce_ctx *ctx = (struct bruteforce_ctx *)vctx;
+    int i;
+
+    /* On finding a second solution, the first one stays in place. */
+    if (search_solutions(s) == 1)
+        for (i=0;i<ctx->state->common->num_total;i++)
+            ctx->state->guess[i] = ctx->guess[i];
+}
+
+/* Copies share state and paths, which only the solution writes to. */
+static void *bruteforce_dup_ctx(void *vctx) {
+    struct bruteforce_ctx *ctx = (struct bruteforce_ctx *)vctx;
+    struct bruteforce_ctx *ret = snew(struct bruteforce_ctx);
+    int n = ctx->state->common->num_total;
+
+    *ret = *ctx;
+    ret->guess = snewn(n,int);
+    memcpy(ret->guess, ctx->guess, n * sizeof(int));
+    return ret;
+}
+
+static void bruteforce_free_ctx(void *vctx) {
+    struct bruteforce_ctx *ctx = (struct bruteforce_ctx *)vctx;
+
+    sfree(ctx->guess);
+    sfree(ctx);
+}
+
+static const struct search_ops bruteforce_ops = {
+    bruteforce_propagate,
+    bruteforce_branch,
+    bruteforce_choose,
+    bruteforce_solution,
+    NULL,
+    bruteforce_dup_ctx,
+    bruteforce_free_ctx,
+};
+
+static bool solve_bruteforce(game_state *state, struct path *paths) {
+    struct bruteforce_ctx ctx;
+    searcher *s;
+    int i, number_solutions;
+
+    ctx.state = state;
+    ctx.paths = paths;
+    ctx.guess = snewn(state->common->num_total,int);
+    for (i=0;i<state->common->num_total;i++)
+        ctx.guess[i] = state->guess[i];
+
+    s = search_new();
+    number_solutions = search_run(s, &bruteforce_ops, &ctx, 2);
+    search_free(s);
+    sfree(ctx.guess);
+
+    return number_solutions == 1;
 }
 
 static int path_cmp(const void *a, const void *b) {
@@ -533,6 +533,7 @@ static void game_debug(game_state *state)
 
 struct solver_link {
     int len, gx, gy, lx, ly;
+    unsigned long seen;   /* latin_solver stamp when last examined */
 };
 
 struct solver_ctx {
@@ -540,6 +541,10 @@ struct solver_ctx {
 
     int nlinks, alinks;
     struct solver_link *links;
+
+    /* latin_solver stamps at which each square was last examined by
+     * solver_adjacent and solver_adjacent_set (adjacent mode only) */
+    unsigned long *adjseen, *setseen;
 };
 
 static void solver_add_link(struct solver_ctx *ctx,
@@ -555,6 +560,7 @@ static void solver_add_link(struct solver_ctx *ctx,
     ctx->links[ctx->nlinks].lx = lx;
     ctx->links[ctx->nlinks].ly = ly;
     ctx->links[ctx->nlinks].len = len;
+    ctx->links[ctx->nlinks].seen = 0;
     ctx->nlinks++;
     /*debug(("Adding new link: len %d (%d,%d) < (%d,%d), nlinks now %d",
            len, lx, ly, gx, gy, ctx->nlinks));*/
@@ -569,10 +575,16 @@ static struct solver_ctx *new_ctx(game_state *state)
 
     ctx->nlinks = ctx->alinks = 0;
     ctx->links = NULL;
+    ctx->adjseen = ctx->setseen = NULL;
     ctx->state = state;
 
-    if (state->mode == MODE_ADJACENT)
+    if (state->mode == MODE_ADJACENT) {
+        ctx->adjseen = snewn(o*o, unsigned long);
+        ctx->setseen = snewn(o*o, unsigned long);
+        for (i = 0; i < o*o; i++)
+            ctx->adjseen[i] = ctx->setseen[i] = 0;
         return ctx; /* adjacent mode doesn't use links. */
+    }
 
     for (x = 0; x < o; x++) {
         for (y = 0; y < o; y++) {
@@ -597,6 +609,8 @@ static void free_ctx(void *vctx)
 {
     struct solver_ctx *ctx = (struct solver_ctx *)vctx;
     if (ctx->links) sfree(ctx->links);
+    sfree(ctx->adjseen);
+    sfree(ctx->setseen);
     sfree(ctx);
 }
 
@@ -634,7 +648,15 @@ static int solver_links(struct latin_solver *solver, void *vctx)
     struct solver_link *link;
 
     for (i = 0; i < ctx->nlinks; i++) {
+        int sq[2];
+
         link = &ctx->links[i];
+        sq[0] = link->gx*solver->o + link->gy;
+        sq[1] = link->lx*solver->o + link->ly;
+        if (!latin_solver_changed(solver, link->seen, sq, 2))
+            continue;
+        link->seen = solver->stamp;
+
         solver_nminmax(solver, link->gx, link->gy, NULL, &gmax, &gns);
         solver_nminmax(solver, link->lx, link->ly, &lmin, NULL, &lns);
 
@@ -690,6 +712,10 @@ static int solver_adjacent(struct latin_solver *solver, void *vctx)
     for (x = 0; x < o; x++) {
         for (y = 0; y < o; y++) {
             if (grid(x, y) == 0) continue;
+            if (!latin_solver_line_changed(solver, ctx->adjseen[x*o+y],
+                                           x*o+y, 1, 1))
+                continue;
+            ctx->adjseen[x*o+y] = solver->stamp;
 
             /* We have a definite number here. Make sure that any
              * adjacent possibles reflect the adjacent/non-adjacent clue. */
@@ -742,6 +768,11 @@ static int solver_adjacent_set(struct latin_solver *solver, void *vctx)
 
     for (x = 0; x < o; x++) {
         for (y = 0; y < o; y++) {
+            if (!latin_solver_line_changed(solver, ctx->setseen[x*o+y],
+                                           x*o+y, 1, 1))
+                continue;
+            ctx->setseen[x*o+y] = solver->stamp;
+
             for (i = 0; i < 4; i++) {
                 bool isadjacent =
                     (GRID(ctx->state, flags, x, y) & adjthan[i].f);
@@ -885,13 +916,14 @@ static bool unequal_valid(struct latin_solver *solver, void *vctx)
     return true;
 }
 
-static int solver_state(game_state *state, int maxdiff)
+/* Working memory comes from 'ar' if that isn't NULL. */
+static int solver_state(game_state *state, int maxdiff, arena *ar)
 {
     struct solver_ctx *ctx = new_ctx(state);
     struct latin_solver solver;
     int diff;
 
-    latin_solver_alloc(&solver, state->nums, state->order);
+    latin_solver_alloc_arena(&solver, state->nums, state->order, ar);
 
     diff = latin_solver_main(&solver, maxdiff,
 			     DIFF_LATIN, DIFF_SET, DIFF_EXTREME,
@@ -921,7 +953,7 @@ static game_state *solver_hint(const game_state *state, int *diff_r,
     int diff, r = 0;
 
     for (diff = mindiff; diff <= maxdiff; diff++) {
-        r = solver_state(ret, diff);
+        r = solver_state(ret, diff, NULL);
         debug(("solver_state after %s %d", unequal_diffnames[diff], r));
         if (r != 0) goto done;
     }
@@ -1082,7 +1114,7 @@ int maxtries;
 static int gg_solved;
 
 static int game_assemble(game_state *new, int *scratch, digit *latin,
-                         int difficulty)
+                         int difficulty, arena *ar)
 {
     game_state *copy = dup_game(new);
     int best;
@@ -1105,7 +1137,7 @@ static int game_assemble(game_state *new, int *scratch, digit *latin,
 
     while(1) {
         gg_solved++;
-        if (solver_state(copy, difficulty) == 1) break;
+        if (solver_state(copy, difficulty, ar) == 1) break;
 
         best = gg_best_clue(copy, scratch, latin);
         gg_place_clue(new, scratch[best], latin, false);
@@ -1123,7 +1155,7 @@ static int game_assemble(game_state *new, int *scratch, digit *latin,
 }
 
 static void game_strip(game_state *new, int *scratch, digit *latin,
-                       int difficulty)
+                       int difficulty, arena *ar)
 {
     int o = new->order, o2 = o*o, lscratch = o2*5, i;
     game_state *copy = blank_game(new->order, new->mode);
@@ -1136,7 +1168,7 @@ static void game_strip(game_state *new, int *scratch, digit *latin,
         memcpy(copy->nums,  new->nums,  o2 * sizeof(digit));
         memcpy(copy->flags, new->flags, o2 * sizeof(unsigned int));
         gg_solved++;
-        if (solver_state(copy, difficulty) != 1) {
+        if (solver_state(copy, difficulty, ar) != 1) {
             /* put clue back, we can't solve without it. */
             bool ret = gg_place_clue(new, scratch[i], latin, false);
             assert(ret);
@@ -1191,6 +1223,7 @@ static char *new_game_desc(const game_params *params_in, random_state *rs,
     int *scratch, lscratch = o2*5;
     char *ret, buf[80];
     game_state *state = blank_game(params->order, params->mode);
+    arena *ar = arena_new();
 
     /* Generate a list of 'things to strip' (randomised later) */
     scratch = snewn(lscratch, int);
@@ -1203,6 +1236,10 @@ generate:
         printf("new_game_desc: generating %s puzzle, ntries so far %d\n",
                unequal_diffnames[params->diff], ntries);
 #endif
+    if (random_cancelled(rs)) {
+        ret = NULL;
+        goto cleanup;
+    }
     if (sq) sfree(sq);
     sq = latin_generate(params->order, rs);
     latin_debug(sq, params->order);
@@ -1219,13 +1256,13 @@ generate:
     }
 
     gg_solved = 0;
-    if (game_assemble(state, scratch, sq, params->diff) < 0)
+    if (game_assemble(state, scratch, sq, params->diff, ar) < 0)
         goto generate;
-    game_strip(state, scratch, sq, params->diff);
+    game_strip(state, scratch, sq, params->diff, ar);
 
     if (params->diff > 0) {
         game_state *copy = dup_game(state);
-        nsol = solver_state(copy, params->diff-1);
+        nsol = solver_state(copy, params->diff-1, ar);
         free_game(copy);
         if (nsol > 0) {
 #ifdef STANDALONE_SOLVER
@@ -1269,9 +1306,11 @@ generate:
     }
     *aux = latin_desc(sq, params->order);
 
+cleanup:
     free_game(state);
     sfree(sq);
     sfree(scratch);
+    arena_free(ar);
 
     return ret;
 }
@@ -1429,7 +1468,7 @@ static char *solve_game(const game_state *state, const game_state *currstate,
         if (!(solved->flags[r] & F_IMMUTABLE))
             solved->nums[r] = 0;
     }
-    r = solver_state(solved, DIFFCOUNT-1);   /* always use full solver */
+    r = solver_state(solved, DIFFCOUNT-1, NULL);   /* always use full solver */
     if (r > 0) ret = latin_desc(solved->nums, solved->order);
     free_game(solved);
     return ret;
@@ -2370,7 +2409,7 @@ static void soak(game_params *p, random_state *rs)
         p->diff = realdiff;
         desc = new_game_desc(p, rs, &aux, false);
         st = new_game(NULL, p, desc);
-        solver_state(st, DIFF_RECURSIVE);
+        solver_state(st, DIFF_RECURSIVE, NULL);
         free_game(st);
         sfree(aux);
         sfree(desc);
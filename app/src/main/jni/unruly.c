@@ -48,6 +48,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <math.h>
+#include <limits.h>
 
 #include "puzzles.h"
 
@@ -477,8 +478,56 @@ struct unruly_scratch {
     int *ones_cols;
     int *zeros_rows;
     int *zeros_cols;
+
+    /*
+     * The same squares again as bitmaps, one per row and column, so
+     * that the three-in-a-row and uniqueness checks can look at a
+     * whole row a word at a time. Bit x of row y is square (x,y), and
+     * bit y of column x is the same square.
+     */
+    int rowwords, colwords;
+    unsigned long *ones_rowbits, *zeros_rowbits;
+    unsigned long *ones_colbits, *zeros_colbits;
 };
 
+#define ULONG_BITS ((int)(sizeof(unsigned long) * CHAR_BIT))
+
+static int unruly_popcount(unsigned long v)
+{
+#ifdef __GNUC__
+    return __builtin_popcountl(v);
+#else
+    int n = 0;
+    for (; v; v &= v - 1)
+        n++;
+    return n;
+#endif
+}
+
+static int unruly_lowest_bit(unsigned long v)
+{
+#ifdef __GNUC__
+    return __builtin_ctzl(v);
+#else
+    int n = 0;
+    for (; !(v & 1); v >>= 1)
+        n++;
+    return n;
+#endif
+}
+
+/* The bitmap of squares containing 'value' in row or column i. */
+static unsigned long *unruly_line_bits(struct unruly_scratch *scratch,
+                                       bool horizontal, char value, int i)
+{
+    if (horizontal)
+        return (value == N_ONE ? scratch->ones_rowbits :
+                scratch->zeros_rowbits) + i * scratch->rowwords;
+    else
+        return (value == N_ONE ? scratch->ones_colbits :
+                scratch->zeros_colbits) + i * scratch->colwords;
+}
+
 static void unruly_solver_update_remaining(const game_state *state,
                                            struct unruly_scratch *scratch)
 {
@@ -490,16 +539,30 @@ static void unruly_solver_update_remaining(const game_state *state,
     memset(scratch->ones_cols, 0, w2 * sizeof(int));
     memset(scratch->zeros_rows, 0, h2 * sizeof(int));
     memset(scratch->zeros_cols, 0, w2 * sizeof(int));
+    memset(scratch->ones_rowbits, 0,
+           h2 * scratch->rowwords * sizeof(unsigned long));
+    memset(scratch->zeros_rowbits, 0,
+           h2 * scratch->rowwords * sizeof(unsigned long));
+    memset(scratch->ones_colbits, 0,
+           w2 * scratch->colwords * sizeof(unsigned long));
+    memset(scratch->zeros_colbits, 0,
+           w2 * scratch->colwords * sizeof(unsigned long));
 
     for (x = 0; x < w2; x++)
         for (y = 0; y < h2; y++) {
-            if (state->grid[y * w2 + x] == N_ONE) {
+            char c = state->grid[y * w2 + x];
+            if (c == N_ONE) {
                 scratch->ones_rows[y]++;
                 scratch->ones_cols[x]++;
-            } else if (state->grid[y * w2 + x] == N_ZERO) {
+            } else if (c == N_ZERO) {
                 scratch->zeros_rows[y]++;
                 scratch->zeros_cols[x]++;
-            }
+            } else
+                continue;
+            unruly_line_bits(scratch, true, c, y)[x / ULONG_BITS] |=
+                1UL << (x % ULONG_BITS);
+            unruly_line_bits(scratch, false, c, x)[y / ULONG_BITS] |=
+                1UL << (y % ULONG_BITS);
         }
 }
 
@@ -514,6 +577,13 @@ static struct unruly_scratch *unruly_new_scratch(const game_state *state)
     ret->zeros_rows = snewn(h2, int);
     ret->zeros_cols = snewn(w2, int);
 
+    ret->rowwords = (w2 + ULONG_BITS - 1) / ULONG_BITS;
+    ret->colwords = (h2 + ULONG_BITS - 1) / ULONG_BITS;
+    ret->ones_rowbits = snewn(h2 * ret->rowwords, unsigned long);
+    ret->zeros_rowbits = snewn(h2 * ret->rowwords, unsigned long);
+    ret->ones_colbits = snewn(w2 * ret->colwords, unsigned long);
+    ret->zeros_colbits = snewn(w2 * ret->colwords, unsigned long);
+
     unruly_solver_update_remaining(state, ret);
 
     return ret;
@@ -525,74 +595,88 @@ static void unruly_free_scratch(struct unruly_scratch *scratch)
     sfree(scratch->ones_cols);
     sfree(scratch->zeros_rows);
     sfree(scratch->zeros_cols);
+    sfree(scratch->ones_rowbits);
+    sfree(scratch->zeros_rowbits);
+    sfree(scratch->ones_colbits);
+    sfree(scratch->zeros_colbits);
 
     sfree(scratch);
 }
 
-static int unruly_solver_check_threes(game_state *state, int *rowcount,
-                                      int *colcount, bool horizontal,
+/* Fill in an empty square, keeping the scratch data up to date. */
+static void unruly_solver_place(game_state *state,
+                                struct unruly_scratch *scratch,
+                                int i, char fill)
+{
+    int w2 = state->w2, x = i % w2, y = i / w2;
+
+    assert(state->grid[i] == EMPTY);
+    state->grid[i] = fill;
+    if (fill == N_ONE) {
+        scratch->ones_rows[y]++;
+        scratch->ones_cols[x]++;
+    } else {
+        scratch->zeros_rows[y]++;
+        scratch->zeros_cols[x]++;
+    }
+    unruly_line_bits(scratch, true, fill, y)[x / ULONG_BITS] |=
+        1UL << (x % ULONG_BITS);
+    unruly_line_bits(scratch, false, fill, x)[y / ULONG_BITS] |=
+        1UL << (y % ULONG_BITS);
+}
+
+static int unruly_solver_check_threes(game_state *state,
+                                      struct unruly_scratch *scratch,
+                                      bool horizontal,
                                       char check, char block)
 {
     int w2 = state->w2, h2 = state->h2;
+    int nlines = (horizontal ? h2 : w2), len = (horizontal ? w2 : h2);
+    int nwords = (horizontal ? scratch->rowwords : scratch->colwords);
 
-    int dx = horizontal ? 1 : 0, dy = 1 - dx;
-    int sx = dx, sy = dy;
-    int ex = w2 - dx, ey = h2 - dy;
-
-    int x, y;
+    int line, k;
     int ret = 0;
 
-    /* Check for any three squares which almost form three in a row */
-    for (y = sy; y < ey; y++) {
-        for (x = sx; x < ex; x++) {
-            int i1 = (y-dy) * w2 + (x-dx);
-            int i2 = y * w2 + x;
-            int i3 = (y+dy) * w2 + (x+dx);
-
-            if (state->grid[i1] == check && state->grid[i2] == check
-                && state->grid[i3] == EMPTY) {
-                ret++;
+    /*
+     * Check for any three squares which almost form three in a row.
+     * Filling in one of those can't complete or spoil another, so we
+     * can find a whole row's worth at once: an empty square must be
+     * 'block' if the two squares on either side of it, or the two
+     * beyond it on one side, are both 'check'.
+     */
+    for (line = 0; line < nlines; line++) {
+        const unsigned long *c = unruly_line_bits(scratch, horizontal,
+                                                  check, line);
+        const unsigned long *b = unruly_line_bits(scratch, horizontal,
+                                                  block, line);
+
+        for (k = 0; k < nwords; k++) {
+            unsigned long prev = (k > 0 ? c[k-1] : 0);
+            unsigned long next = (k+1 < nwords ? c[k+1] : 0);
+            unsigned long before1 = c[k] << 1 | prev >> (ULONG_BITS-1);
+            unsigned long before2 = c[k] << 2 | prev >> (ULONG_BITS-2);
+            unsigned long after1 = c[k] >> 1 | next << (ULONG_BITS-1);
+            unsigned long after2 = c[k] >> 2 | next << (ULONG_BITS-2);
+            unsigned long found = ~(c[k] | b[k]) &
+                ((before1 & before2) | (before1 & after1) |
+                 (after1 & after2));
+
+            if (k == nwords-1 && len % ULONG_BITS)
+                found &= (1UL << (len % ULONG_BITS)) - 1;
+
+            while (found) {
+                int pos = k * ULONG_BITS + unruly_lowest_bit(found);
+                int i = (horizontal ? line * w2 + pos : pos * w2 + line);
+
+                found &= found - 1;
 #ifdef STANDALONE_SOLVER
                 if (solver_verbose) {
-                    printf("Solver: %i,%i and %i,%i confirm %c at %i,%i\n",
-                           i1 % w2, i1 / w2, i2 % w2, i2 / w2,
-                           (block == N_ONE ? '1' : '0'), i3 % w2,
-                           i3 / w2);
+                    printf("Solver: three in a row rule gives %c at %i,%i\n",
+                           (block == N_ONE ? '1' : '0'), i % w2, i / w2);
                 }
 #endif
-                state->grid[i3] = block;
-                rowcount[i3 / w2]++;
-                colcount[i3 % w2]++;
-            }
-            if (state->grid[i1] == check && state->grid[i2] == EMPTY
-                && state->grid[i3] == check) {
+                unruly_solver_place(state, scratch, i, block);
                 ret++;
-#ifdef STANDALONE_SOLVER
-                if (solver_verbose) {
-                    printf("Solver: %i,%i and %i,%i confirm %c at %i,%i\n",
-                           i1 % w2, i1 / w2, i3 % w2, i3 / w2,
-                           (block == N_ONE ? '1' : '0'), i2 % w2,
-                           i2 / w2);
-                }
-#endif
-                state->grid[i2] = block;
-                rowcount[i2 / w2]++;
-                colcount[i2 % w2]++;
-            }
-            if (state->grid[i1] == EMPTY && state->grid[i2] == check
-                && state->grid[i3] == check) {
-                ret++;
-#ifdef STANDALONE_SOLVER
-                if (solver_verbose) {
-                    printf("Solver: %i,%i and %i,%i confirm %c at %i,%i\n",
-                           i2 % w2, i2 / w2, i3 % w2, i3 / w2,
-                           (block == N_ONE ? '1' : '0'), i1 % w2,
-                           i1 / w2);
-                }
-#endif
-                state->grid[i1] = block;
-                rowcount[i1 / w2]++;
-                colcount[i1 % w2]++;
             }
         }
     }
@@ -605,19 +689,10 @@ static int unruly_solver_check_all_threes(game_state *state,
 {
     int ret = 0;
 
-    ret +=
-        unruly_solver_check_threes(state, scratch->zeros_rows,
-                                   scratch->zeros_cols, true, N_ONE, N_ZERO);
-    ret +=
-        unruly_solver_check_threes(state, scratch->ones_rows,
-                                   scratch->ones_cols, true, N_ZERO, N_ONE);
-    ret +=
-        unruly_solver_check_threes(state, scratch->zeros_rows,
-                                   scratch->zeros_cols, false, N_ONE,
-                                   N_ZERO);
-    ret +=
-        unruly_solver_check_threes(state, scratch->ones_rows,
-                                   scratch->ones_cols, false, N_ZERO, N_ONE);
+    ret += unruly_solver_check_threes(state, scratch, true, N_ONE, N_ZERO);
+    ret += unruly_solver_check_threes(state, scratch, true, N_ZERO, N_ONE);
+    ret += unruly_solver_check_threes(state, scratch, false, N_ONE, N_ZERO);
+    ret += unruly_solver_check_threes(state, scratch, false, N_ZERO, N_ONE);
 
     return ret;
 }
@@ -633,8 +708,9 @@ static int unruly_solver_check_uniques(game_state *state, int *rowcount,
     int nr = (horizontal ? h2 : w2);
     int nc = (horizontal ? w2 : h2);
     int max = nc / 2;
+    int nwords = (horizontal ? scratch->rowwords : scratch->colwords);
 
-    int r, r2, c;
+    int r, r2, k;
     int ret = 0;
 
     /*
@@ -644,19 +720,21 @@ static int unruly_solver_check_uniques(game_state *state, int *rowcount,
      * that it's different.
      */
     for (r = 0; r < nr; r++) {
+        const unsigned long *c = unruly_line_bits(scratch, horizontal,
+                                                  check, r);
         if (rowcount[r] != max)
             continue;
         for (r2 = 0; r2 < nr; r2++) {
+            const unsigned long *c2 = unruly_line_bits(scratch, horizontal,
+                                                       check, r2);
             int nmatch = 0, nonmatch = -1;
             if (rowcount[r2] != max-1)
                 continue;
-            for (c = 0; c < nc; c++) {
-                if (state->grid[r*rmult + c*cmult] == check) {
-                    if (state->grid[r2*rmult + c*cmult] == check)
-                        nmatch++;
-                    else
-                        nonmatch = c;
-                }
+            for (k = 0; k < nwords; k++) {
+                nmatch += unruly_popcount(c[k] & c2[k]);
+                if (c[k] & ~c2[k])
+                    nonmatch = k * ULONG_BITS +
+                        unruly_lowest_bit(c[k] & ~c2[k]);
             }
             if (nmatch == max-1) {
                 int i1 = r2 * rmult + nonmatch * cmult;
@@ -672,14 +750,7 @@ static int unruly_solver_check_uniques(game_state *state, int *rowcount,
                            i1 / w2);
                 }
 #endif
-                state->grid[i1] = block;
-                if (block == N_ONE) {
-                    scratch->ones_rows[i1 / w2]++;
-                    scratch->ones_cols[i1 % w2]++;
-                } else {
-                    scratch->zeros_rows[i1 / w2]++;
-                    scratch->zeros_cols[i1 % w2]++;
-                }
+                unruly_solver_place(state, scratch, i1, block);
                 ret++;
             }
         }
@@ -704,8 +775,9 @@ static int unruly_solver_check_all_uniques(game_state *state,
     return ret;
 }
 
-static int unruly_solver_fill_row(game_state *state, int i, bool horizontal,
-                                  int *rowcount, int *colcount, char fill)
+static int unruly_solver_fill_row(game_state *state,
+                                  struct unruly_scratch *scratch,
+                                  int i, bool horizontal, char fill)
 {
     int ret = 0;
     int w2 = state->w2, h2 = state->h2;
@@ -730,9 +802,7 @@ static int unruly_solver_fill_row(game_state *state, int i, bool horizontal,
             }
 #endif
             ret++;
-            state->grid[p] = fill;
-            rowcount[(horizontal ? i : j)]++;
-            colcount[(horizontal ? j : i)]++;
+            unruly_solver_place(state, scratch, p, fill);
         }
     }
 
@@ -748,7 +818,8 @@ static int unruly_solver_fill_row(game_state *state, int i, bool horizontal,
 static int unruly_solver_check_single_gap(game_state *state,
                                           int *complete, bool horizontal,
                                           int *rowcount, int *colcount,
-                                          char fill)
+                                          char fill,
+                                          struct unruly_scratch *scratch)
 {
     int w2 = state->w2, h2 = state->h2;
     int count = (horizontal ? h2 : w2); /* number of rows to check */
@@ -767,8 +838,8 @@ static int unruly_solver_check_single_gap(game_state *state,
                        "%c\n", i, (fill == N_ZERO ? '0' : '1'));
             }
 #endif
-            ret += unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                          colcount, fill);
+            ret += unruly_solver_fill_row(state, scratch, i, horizontal,
+                                          fill);
         }
     }
 
@@ -783,19 +854,23 @@ static int unruly_solver_check_all_single_gap(game_state *state,
     ret +=
         unruly_solver_check_single_gap(state, scratch->ones_rows, true,
                                        scratch->zeros_rows,
-                                       scratch->zeros_cols, N_ZERO);
+                                       scratch->zeros_cols, N_ZERO,
+                                       scratch);
     ret +=
         unruly_solver_check_single_gap(state, scratch->ones_cols, false,
                                        scratch->zeros_rows,
-                                       scratch->zeros_cols, N_ZERO);
+                                       scratch->zeros_cols, N_ZERO,
+                                       scratch);
     ret +=
         unruly_solver_check_single_gap(state, scratch->zeros_rows, true,
                                        scratch->ones_rows,
-                                       scratch->ones_cols, N_ONE);
+                                       scratch->ones_cols, N_ONE,
+                                       scratch);
     ret +=
         unruly_solver_check_single_gap(state, scratch->zeros_cols, false,
                                        scratch->ones_rows,
-                                       scratch->ones_cols, N_ONE);
+                                       scratch->ones_cols, N_ONE,
+                                       scratch);
 
     return ret;
 }
@@ -803,7 +878,8 @@ static int unruly_solver_check_all_single_gap(game_state *state,
 static int unruly_solver_check_complete_nums(game_state *state,
                                              int *complete, bool horizontal,
                                              int *rowcount, int *colcount,
-                                             char fill)
+                                             char fill,
+                                             struct unruly_scratch *scratch)
 {
     int w2 = state->w2, h2 = state->h2;
     int count = (horizontal ? h2 : w2); /* number of rows to check */
@@ -822,8 +898,8 @@ static int unruly_solver_check_complete_nums(game_state *state,
                        (fill != N_ZERO ? '0' : '1'));
             }
 #endif
-            ret += unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                          colcount, fill);
+            ret += unruly_solver_fill_row(state, scratch, i, horizontal,
+                                          fill);
         }
     }
 
@@ -838,19 +914,23 @@ static int unruly_solver_check_all_complete_nums(game_state *state,
     ret +=
         unruly_solver_check_complete_nums(state, scratch->ones_rows, true,
                                           scratch->zeros_rows,
-                                          scratch->zeros_cols, N_ZERO);
+                                          scratch->zeros_cols, N_ZERO,
+                                       scratch);
     ret +=
         unruly_solver_check_complete_nums(state, scratch->ones_cols, false,
                                           scratch->zeros_rows,
-                                          scratch->zeros_cols, N_ZERO);
+                                          scratch->zeros_cols, N_ZERO,
+                                       scratch);
     ret +=
         unruly_solver_check_complete_nums(state, scratch->zeros_rows, true,
                                           scratch->ones_rows,
-                                          scratch->ones_cols, N_ONE);
+                                          scratch->ones_cols, N_ONE,
+                                       scratch);
     ret +=
         unruly_solver_check_complete_nums(state, scratch->zeros_cols, false,
                                           scratch->ones_rows,
-                                          scratch->ones_cols, N_ONE);
+                                          scratch->ones_cols, N_ONE,
+                                       scratch);
 
     return ret;
 }
@@ -858,7 +938,8 @@ static int unruly_solver_check_all_complete_nums(game_state *state,
 static int unruly_solver_check_near_complete(game_state *state,
                                              int *complete, bool horizontal,
                                              int *rowcount, int *colcount,
-                                             char fill)
+                                             char fill,
+                                             struct unruly_scratch *scratch)
 {
     int w2 = state->w2, h2 = state->h2;
     int w = w2/2, h = h2/2;
@@ -919,8 +1000,8 @@ static int unruly_solver_check_near_complete(game_state *state,
                 }
 #endif
                 ret +=
-                    unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                         colcount, fill);
+                    unruly_solver_fill_row(state, scratch, i, horizontal,
+                                           fill);
 
                 state->grid[i2] = EMPTY;
                 state->grid[i3] = EMPTY;
@@ -938,8 +1019,8 @@ static int unruly_solver_check_near_complete(game_state *state,
                 }
 #endif
                 ret +=
-                    unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                         colcount, fill);
+                    unruly_solver_fill_row(state, scratch, i, horizontal,
+                                           fill);
 
                 state->grid[i1] = EMPTY;
                 state->grid[i3] = EMPTY;
@@ -957,8 +1038,8 @@ static int unruly_solver_check_near_complete(game_state *state,
                 }
 #endif
                 ret +=
-                    unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                         colcount, fill);
+                    unruly_solver_fill_row(state, scratch, i, horizontal,
+                                           fill);
 
                 state->grid[i1] = EMPTY;
                 state->grid[i2] = EMPTY;
@@ -977,8 +1058,8 @@ static int unruly_solver_check_near_complete(game_state *state,
                 }
 #endif
                 ret +=
-                    unruly_solver_fill_row(state, i, horizontal, rowcount,
-                                         colcount, fill);
+                    unruly_solver_fill_row(state, scratch, i, horizontal,
+                                           fill);
 
                 state->grid[i1] = EMPTY;
                 state->grid[i2] = EMPTY;
@@ -998,19 +1079,23 @@ static int unruly_solver_check_all_near_complete(game_state *state,
     ret +=
         unruly_solver_check_near_complete(state, scratch->ones_rows, true,
                                         scratch->zeros_rows,
-                                        scratch->zeros_cols, N_ZERO);
+                                        scratch->zeros_cols, N_ZERO,
+                                       scratch);
     ret +=
         unruly_solver_check_near_complete(state, scratch->ones_cols, false,
                                         scratch->zeros_rows,
-                                        scratch->zeros_cols, N_ZERO);
+                                        scratch->zeros_cols, N_ZERO,
+                                       scratch);
     ret +=
         unruly_solver_check_near_complete(state, scratch->zeros_rows, true,
                                         scratch->ones_rows,
-                                        scratch->ones_cols, N_ONE);
+                                        scratch->ones_cols, N_ONE,
+                                       scratch);
     ret +=
         unruly_solver_check_near_complete(state, scratch->zeros_cols, false,
                                         scratch->ones_rows,
-                                        scratch->ones_cols, N_ONE);
+                                        scratch->ones_cols, N_ONE,
+                                       scratch);
 
     return ret;
 }
@@ -1328,15 +1413,8 @@ static bool unruly_fill_game(game_state *state, struct unruly_scratch *scratch,
         if (state->grid[i] != EMPTY)
             continue;
 
-        if (random_upto(rs, 2)) {
-            state->grid[i] = N_ONE;
-            scratch->ones_rows[i / w2]++;
-            scratch->ones_cols[i % w2]++;
-        } else {
-            state->grid[i] = N_ZERO;
-            scratch->zeros_rows[i / w2]++;
-            scratch->zeros_cols[i % w2]++;
-        }
+        unruly_solver_place(state, scratch, i,
+                            random_upto(rs, 2) ? N_ONE : N_ZERO);
 
         unruly_solve_game(state, scratch, DIFFCOUNT);
     }
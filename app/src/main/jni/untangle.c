@@ -305,7 +305,7 @@ static int64 dotprod64(long a, long b, long p, long q)
 static bool cross(point a1, point a2, point b1, point b2)
 {
     long b1x, b1y, b2x, b2y, px, py;
-    int64 d1, d2, d3;
+    int64 d1, d2;
 
     /*
      * The condition for crossing is that b1 and b2 are on opposite
@@ -353,11 +353,19 @@ static bool cross(point a1, point a2, point b1, point b2)
 	/* If they're both strictly negative, the lines do not cross. */
 	if (sign64(d1) < 0 && sign64(d2) < 0)
 	    return false;
-	/* Otherwise, take the dot product of a2-a1 with itself. If
-	 * the other two dot products both exceed this, the lines do
-	 * not cross. */
-	d3 = dotprod64(px, px, py, py);
-	if (greater64(d1, d3) && greater64(d2, d3))
+	/* Otherwise, construct b1-a2 and b2-a2, and if their dot
+	 * products with a2-a1 are both strictly positive, the lines do
+	 * not cross. (Comparing the dot products above with that of
+	 * a2-a1 with itself would need them all scaled by the same
+	 * denominators, which they aren't unless the points share
+	 * one.) */
+	b1x = b1.x * a2.d - a2.x * b1.d;
+	b1y = b1.y * a2.d - a2.y * b1.d;
+	b2x = b2.x * a2.d - a2.x * b2.d;
+	b2y = b2.y * a2.d - a2.y * b2.d;
+	d1 = dotprod64(b1x, px, b1y, py);
+	d2 = dotprod64(b2x, px, b2y, py);
+	if (sign64(d1) > 0 && sign64(d2) > 0)
 	    return false;
     }
 
@@ -761,23 +769,88 @@ static const char *validate_desc(const game_params *params, const char *desc)
     return NULL;
 }
 
+/*
+ * Bounding box of an edge, used to avoid calling cross() on pairs of
+ * edges that are nowhere near each other. The box is widened very
+ * slightly, so that rounding in the floating-point coordinates can
+ * only ever let through extra pairs, never lose a crossing; cross()
+ * still has the final say.
+ *
+ * An edge whose two points coincide is the exception: cross() counts
+ * it as crossing anything whose line (not just segment) its point is
+ * on, so such an edge gets a box covering everything.
+ */
+struct edgebox {
+    double x0, y0, x1, y1;
+    int index;			       /* of the edge in the graph */
+};
+
+#define EDGEBOX_SLACK 1e-9
+
+static void edgebox_extend(double lo, double hi, double *min, double *max)
+{
+    *min = lo - EDGEBOX_SLACK * (fabs(lo) + 1);
+    *max = hi + EDGEBOX_SLACK * (fabs(hi) + 1);
+}
+
+static int edgebox_cmp(const void *av, const void *bv, void *ctx)
+{
+    const struct edgebox *a = (const struct edgebox *)av;
+    const struct edgebox *b = (const struct edgebox *)bv;
+
+    if (a->x0 < b->x0)
+	return -1;
+    else if (a->x0 > b->x0)
+	return +1;
+    return a->index - b->index;
+}
+
 static void mark_crossings(game_state *state)
 {
     bool ok = true;
-    int i, j;
-    edge *e, *e2;
+    int i, j, nedges = count234(state->graph->edges);
+    edge *edges = snewn(nedges, edge), *e;
+    struct edgebox *boxes = snewn(nedges, struct edgebox);
 
+    for (i = 0; (e = index234(state->graph->edges, i)) != NULL; i++) {
+	point *pa = &state->pts[e->a], *pb = &state->pts[e->b];
+	double ax = (double)pa->x / pa->d, ay = (double)pa->y / pa->d;
+	double bx = (double)pb->x / pb->d, by = (double)pb->y / pb->d;
+
+	edges[i] = *e;
+	if (pa->x * pb->d == pb->x * pa->d && pa->y * pb->d == pb->y * pa->d) {
+	    boxes[i].x0 = boxes[i].y0 = -HUGE_VAL;
+	    boxes[i].x1 = boxes[i].y1 = HUGE_VAL;
+	} else {
+	    edgebox_extend(min(ax, bx), max(ax, bx),
+			   &boxes[i].x0, &boxes[i].x1);
+	    edgebox_extend(min(ay, by), max(ay, by),
+			   &boxes[i].y0, &boxes[i].y1);
+	}
+	boxes[i].index = i;
 #ifdef SHOW_CROSSINGS
-    for (i = 0; (e = index234(state->graph->edges, i)) != NULL; i++)
 	state->crosses[i] = false;
 #endif
+    }
 
     /*
      * Check correctness: for every pair of edges, see whether they
-     * cross.
+     * cross. Sweeping across the edges in order of their left ends,
+     * each need only be compared with the ones that start before it
+     * ends, and then only if their boxes overlap vertically too.
      */
-    for (i = 0; (e = index234(state->graph->edges, i)) != NULL; i++) {
-	for (j = i+1; (e2 = index234(state->graph->edges, j)) != NULL; j++) {
+    arraysort(boxes, nedges, edgebox_cmp, NULL);
+    for (i = 0; i < nedges; i++) {
+	for (j = i+1; j < nedges && boxes[j].x0 <= boxes[i].x1; j++) {
+	    int lo, hi;
+	    edge *e2;
+
+	    if (boxes[j].y0 > boxes[i].y1 || boxes[j].y1 < boxes[i].y0)
+		continue;
+	    lo = min(boxes[i].index, boxes[j].index);
+	    hi = max(boxes[i].index, boxes[j].index);
+	    e = &edges[lo];
+	    e2 = &edges[hi];
 	    if (e2->a == e->a || e2->a == e->b ||
 		e2->b == e->a || e2->b == e->b)
 		continue;
@@ -785,7 +858,7 @@ static void mark_crossings(game_state *state)
 		      state->pts[e->a], state->pts[e->b])) {
 		ok = false;
 #ifdef SHOW_CROSSINGS
-		state->crosses[i] = state->crosses[j] = true;
+		state->crosses[lo] = state->crosses[hi] = true;
 #else
 		goto done;	       /* multi-level break - sorry */
 #endif
@@ -793,13 +866,11 @@ static void mark_crossings(game_state *state)
 	}
     }
 
-    /*
-     * e == NULL if we've gone through all the edge pairs
-     * without finding a crossing.
-     */
 #ifndef SHOW_CROSSINGS
     done:
 #endif
+    sfree(boxes);
+    sfree(edges);
     if (ok)
 	state->completed = true;
 }
@@ -816,7 +887,9 @@ static game_state *new_game(midend *me, const game_params *params,
 {
     int n = params->n;
     game_state *state = snew(game_state);
-    int a, b;
+    const char *p;
+    edge **ea;
+    int a, b, i, m;
 
     state->params = *params;
     state->w = state->h = COORDLIMIT(n);
@@ -824,9 +897,20 @@ static game_state *new_game(midend *me, const game_params *params,
     make_circle(state->pts, n, state->w);
     state->graph = snew(struct graph);
     state->graph->refcount = 1;
-    state->graph->edges = newtree234(edgecmp);
     state->completed = state->cheated = state->just_solved = false;
 
+    /*
+     * Our own descriptions list the edges in sorted order, so we
+     * can normally build the edge tree in one pass rather than
+     * inserting them one by one.
+     */
+    m = (*desc ? 1 : 0);
+    for (p = desc; *p; p++)
+	if (*p == ',')
+	    m++;
+    ea = snewn(m, edge *);
+    m = 0;
+
     while (*desc) {
 	a = atoi(desc);
 	assert(a >= 0 && a < params->n);
@@ -840,8 +924,21 @@ static game_state *new_game(midend *me, const game_params *params,
 	    assert(*desc == ',');
 	    desc++;		       /* eat comma */
 	}
-	addedge(state->graph->edges, a, b);
+	assert(a != b);
+	ea[m] = snew(edge);
+	ea[m]->a = min(a, b);
+	ea[m]->b = max(a, b);
+	m++;
+    }
+
+    state->graph->edges = buildtree234(edgecmp, (void **)ea, m);
+    if (!state->graph->edges) {
+	state->graph->edges = newtree234(edgecmp);
+	for (i = 0; i < m; i++)
+	    if (add234(state->graph->edges, ea[i]) != ea[i])
+		sfree(ea[i]);
     }
+    sfree(ea);
 
 #ifdef SHOW_CROSSINGS
     state->crosses = snewn(count234(state->graph->edges), int);
@@ -1514,4 +1611,5 @@ const struct game thegame = {
     false,			       /* wants_statusbar */
     false, game_timing_state,
     SOLVE_ANIMATES,		       /* flags */
+    16,				       /* undo_snapshot_stride */
 };
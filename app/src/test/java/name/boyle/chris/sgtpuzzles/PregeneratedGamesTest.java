@@ -0,0 +1,43 @@
+package name.boyle.chris.sgtpuzzles;
+
+import org.junit.Rule;
+import org.junit.Test;
+import org.junit.rules.TemporaryFolder;
+
+import java.io.File;
+import java.io.IOException;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertNull;
+
+public class PregeneratedGamesTest {
+
+	@Rule
+	public TemporaryFolder folder = new TemporaryFolder();
+
+	@Test
+	public void testQueueIsFirstInFirstOutAndBounded() throws IOException {
+		final PregeneratedGames games = new PregeneratedGames(folder.getRoot());
+		assertEquals(PregeneratedGames.DEPTH, games.wanted("net", "5x5"));
+		for (int i = 0; i < PregeneratedGames.DEPTH + 1; i++) {
+			games.push("net", "5x5", "game" + i);
+		}
+		assertEquals(0, games.wanted("net", "5x5"));
+		assertEquals(PregeneratedGames.DEPTH, games.wanted("net", "7x7"));
+		for (int i = 0; i < PregeneratedGames.DEPTH; i++) {
+			assertEquals("game" + i, games.pop("net", "5x5"));
+		}
+		assertNull(games.pop("net", "5x5"));
+		assertEquals((float) PregeneratedGames.DEPTH / (PregeneratedGames.DEPTH + 1), games.getHitRate(), 0.001f);
+	}
+
+	@Test
+	public void testNumberOfKeysIsBounded() throws IOException {
+		final PregeneratedGames games = new PregeneratedGames(folder.getRoot());
+		for (int i = 0; i <= PregeneratedGames.MAX_KEYS; i++) {
+			games.push("solo", "params" + i, "game" + i);
+		}
+		final File[] remaining = folder.getRoot().listFiles();
+		assertEquals(PregeneratedGames.MAX_KEYS, remaining == null ? 0 : remaining.length);
+	}
+}
@@ -0,0 +1,50 @@
+/*
+ * emccflavour.js: choose which build of a puzzle a browser can run.
+ *
+ * The web front end can be built in an optional flavour using
+ * WebAssembly SIMD and threads (see PUZZLES_WASM_SIMD and
+ * PUZZLES_WASM_THREADS in cmake/platforms/emscripten.cmake), whose
+ * files carry a suffix such as ".simd.mt.js". A page can load this
+ * script first and then the puzzle's script named by
+ *
+ *     "blackbox" + puzzle_flavour_suffix(".simd.mt") + ".js"
+ *
+ * which falls back to the plain build unless the browser supports
+ * everything the flavour needs.
+ */
+
+// A minimal module using one SIMD instruction (i8x16.splat), which
+// only validates where WebAssembly SIMD is supported.
+var puzzle_simd_test = new Uint8Array([
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,   // header
+    0x01, 0x05, 0x01, 0x60, 0x00, 0x01, 0x7b,         // type: [] -> [v128]
+    0x03, 0x02, 0x01, 0x00,                           // one function
+    0x0a, 0x08, 0x01, 0x06, 0x00,                     // its body:
+    0x41, 0x00, 0xfd, 0x0f, 0x0b                      // i32.const 0;
+]);                                                   // i8x16.splat; end
+
+function puzzle_have_simd() {
+    try {
+        return typeof WebAssembly === "object" &&
+            WebAssembly.validate(puzzle_simd_test);
+    } catch (e) {
+        return false;
+    }
+}
+
+// Threads need SharedArrayBuffer, which browsers only offer to pages
+// served cross-origin isolated (COOP and COEP headers).
+function puzzle_have_threads() {
+    return typeof SharedArrayBuffer === "function" &&
+        (typeof crossOriginIsolated === "undefined" || crossOriginIsolated);
+}
+
+// Return the given flavour suffix if every feature it names is
+// available, or the empty string for the plain build.
+function puzzle_flavour_suffix(flavour) {
+    if (flavour.indexOf(".simd") >= 0 && !puzzle_have_simd())
+        return "";
+    if (flavour.indexOf(".mt") >= 0 && !puzzle_have_threads())
+        return "";
+    return flavour;
+}
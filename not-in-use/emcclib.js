@@ -229,27 +229,6 @@ mergeInto(LibraryManager.library, {
         update_xmin = update_xmax = update_ymin = update_ymax = undefined;
     },
 
-    /*
-     * void js_canvas_draw_update(int x, int y, int w, int h);
-     *
-     * Mark a rectangle of the off-screen canvas as needing to be
-     * copied to the on-screen one.
-     */
-    js_canvas_draw_update: function(x, y, w, h) {
-        /*
-         * Currently we do this in a really simple way, just by taking
-         * the smallest rectangle containing all updates so far. We
-         * could instead keep the data in a richer form (e.g. retain
-         * multiple smaller rectangles needing update, and only redraw
-         * the whole thing beyond a certain threshold) but this will
-         * do for now.
-         */
-        if (update_xmin === undefined || update_xmin > x) update_xmin = x;
-        if (update_ymin === undefined || update_ymin > y) update_ymin = y;
-        if (update_xmax === undefined || update_xmax < x+w) update_xmax = x+w;
-        if (update_ymax === undefined || update_ymax < y+h) update_ymax = y+h;
-    },
-
     /*
      * void js_canvas_end_draw(void);
      *
@@ -271,109 +250,153 @@ mergeInto(LibraryManager.library, {
     },
 
     /*
-     * void js_canvas_draw_rect(int x, int y, int w, int h,
-     *                          const char *colour);
-     * 
-     * Draw a rectangle.
-     */
-    js_canvas_draw_rect: function(x, y, w, h, colptr) {
-        ctx.fillStyle = UTF8ToString(colptr);
-        ctx.fillRect(x, y, w, h);
-    },
-
-    /*
-     * void js_canvas_clip_rect(int x, int y, int w, int h);
-     * 
-     * Set a clipping rectangle.
-     */
-    js_canvas_clip_rect: function(x, y, w, h) {
-        ctx.save();
-        ctx.beginPath();
-        ctx.rect(x, y, w, h);
-        ctx.clip();
-    },
-
-    /*
-     * void js_canvas_unclip(void);
-     * 
-     * Reset to no clipping.
-     */
-    js_canvas_unclip: function() {
-        ctx.restore();
-    },
-
-    /*
-     * void js_canvas_draw_line(float x1, float y1, float x2, float y2,
-     *                          int width, const char *colour);
-     * 
-     * Draw a line. We must adjust the coordinates by 0.5 because
-     * Javascript's canvas coordinates appear to be pixel corners,
-     * whereas we want pixel centres. Also, we manually draw the pixel
-     * at each end of the line, which our clients will expect but
-     * Javascript won't reliably do by default (in common with other
-     * Postscriptish drawing frameworks).
-     */
-    js_canvas_draw_line: function(x1, y1, x2, y2, width, colour) {
-        colour = UTF8ToString(colour);
-
-        ctx.beginPath();
-        ctx.moveTo(x1 + 0.5, y1 + 0.5);
-        ctx.lineTo(x2 + 0.5, y2 + 0.5);
-        ctx.lineWidth = width;
-        ctx.lineCap = 'round';
-        ctx.lineJoin = 'round';
-        ctx.strokeStyle = colour;
-        ctx.stroke();
-        ctx.fillStyle = colour;
-        ctx.fillRect(x1, y1, 1, 1);
-        ctx.fillRect(x2, y2, 1, 1);
-    },
-
-    /*
-     * void js_canvas_draw_poly(int *points, int npoints,
-     *                          const char *fillcolour,
-     *                          const char *outlinecolour);
-     * 
-     * Draw a polygon.
+     * void js_canvas_set_colours(char **colours, int ncolours);
+     *
+     * Remember the style string for each of the puzzle's colours, so
+     * that draw commands can refer to them by index.
      */
-    js_canvas_draw_poly: function(pointptr, npoints, fill, outline) {
-        ctx.beginPath();
-        ctx.moveTo(getValue(pointptr  , 'i32') + 0.5,
-                   getValue(pointptr+4, 'i32') + 0.5);
-        for (var i = 1; i < npoints; i++)
-            ctx.lineTo(getValue(pointptr+8*i  , 'i32') + 0.5,
-                       getValue(pointptr+8*i+4, 'i32') + 0.5);
-        ctx.closePath();
-        if (fill != 0) {
-            ctx.fillStyle = UTF8ToString(fill);
-            ctx.fill();
-        }
-        ctx.lineWidth = '1';
-        ctx.lineCap = 'round';
-        ctx.lineJoin = 'round';
-        ctx.strokeStyle = UTF8ToString(outline);
-        ctx.stroke();
+    js_canvas_set_colours: function(ptr, n) {
+        colours = [];
+        for (var i = 0; i < n; i++)
+            colours.push(UTF8ToString(getValue(ptr + 4*i, '*')));
     },
 
     /*
-     * void js_canvas_draw_circle(int x, int y, int r,
-     *                            const char *fillcolour,
-     *                            const char *outlinecolour);
-     * 
-     * Draw a circle.
-     */
-    js_canvas_draw_circle: function(x, y, r, fill, outline) {
-        ctx.beginPath();
-        ctx.arc(x + 0.5, y + 0.5, r, 0, 2*Math.PI);
-        if (fill != 0) {
-            ctx.fillStyle = UTF8ToString(fill);
-            ctx.fill();
+     * void js_canvas_draw_commands(const int32_t *cmds, int len,
+     *                              const char *text);
+     *
+     * Replay a buffer of draw commands in the format of drawcmd.h,
+     * which the C side collects so as to call us once per redraw
+     * rather than once per primitive. The fields are read straight
+     * out of the heap; the string of a TEXT command is at the given
+     * offset from 'text'.
+     *
+     * Line coordinates are adjusted by 0.5 because Javascript's
+     * canvas coordinates appear to be pixel corners, whereas we want
+     * pixel centres. Also, we manually draw the pixel at each end of
+     * a line, which our clients will expect but Javascript won't
+     * reliably do by default (in common with other Postscriptish
+     * drawing frameworks).
+     */
+    js_canvas_draw_commands: function(cmdptr, len, textptr) {
+        var i32 = HEAP32, f32 = HEAPF32;
+        var p = cmdptr >> 2, end = p + len;
+        var x, y, w, h, n, j, colour, fill, flags;
+
+        while (p < end) {
+            switch (i32[p]) {
+              case 1: /* DRAW_OP_RECT */
+                ctx.fillStyle = colours[i32[p+5]];
+                ctx.fillRect(i32[p+1], i32[p+2], i32[p+3], i32[p+4]);
+                p += 6;
+                break;
+              case 2: /* DRAW_OP_LINE */
+                x = f32[p+2]; y = f32[p+3]; w = f32[p+4]; h = f32[p+5];
+                colour = colours[i32[p+6]];
+                ctx.beginPath();
+                ctx.moveTo(x + 0.5, y + 0.5);
+                ctx.lineTo(w + 0.5, h + 0.5);
+                ctx.lineWidth = f32[p+1];
+                ctx.lineCap = 'round';
+                ctx.lineJoin = 'round';
+                ctx.strokeStyle = colour;
+                ctx.stroke();
+                ctx.fillStyle = colour;
+                ctx.fillRect(x, y, 1, 1);
+                ctx.fillRect(w, h, 1, 1);
+                p += 7;
+                break;
+              case 3: /* DRAW_OP_POLY */
+                n = i32[p+2];
+                fill = i32[p+6];
+                ctx.beginPath();
+                ctx.moveTo(i32[p+7] + i32[p+3] + 0.5,
+                           i32[p+8] + i32[p+4] + 0.5);
+                for (j = 1; j < n; j++)
+                    ctx.lineTo(i32[p+7+2*j] + i32[p+3] + 0.5,
+                               i32[p+8+2*j] + i32[p+4] + 0.5);
+                ctx.closePath();
+                if (fill >= 0) {
+                    ctx.fillStyle = colours[fill];
+                    ctx.fill();
+                }
+                ctx.lineWidth = f32[p+1];
+                ctx.lineCap = 'round';
+                ctx.lineJoin = 'round';
+                ctx.strokeStyle = colours[i32[p+5]];
+                ctx.stroke();
+                p += 7 + 2*n;
+                break;
+              case 4: /* DRAW_OP_CIRCLE */
+                fill = i32[p+6];
+                ctx.beginPath();
+                ctx.arc(f32[p+2] + 0.5, f32[p+3] + 0.5, f32[p+4],
+                        0, 2*Math.PI);
+                if (fill >= 0) {
+                    ctx.fillStyle = colours[fill];
+                    ctx.fill();
+                }
+                ctx.lineWidth = f32[p+1];
+                ctx.lineCap = 'round';
+                ctx.lineJoin = 'round';
+                ctx.strokeStyle = colours[i32[p+5]];
+                ctx.stroke();
+                p += 7;
+                break;
+              case 5: /* DRAW_OP_TEXT */
+                flags = i32[p+3];
+                ctx.font = i32[p+4] + 'px ' +
+                    (flags & 0x10 ? 'monospace' : 'sans-serif');
+                ctx.fillStyle = colours[i32[p+5]];
+                ctx.textAlign = (flags & 1 ? 'center' :
+                                 flags & 2 ? 'right' : 'left');
+                ctx.textBaseline = 'alphabetic';
+                ctx.fillText(UTF8ToString(textptr + i32[p+6]),
+                             i32[p+1], i32[p+2]);
+                p += 7;
+                break;
+              case 6: /* DRAW_OP_CLIP */
+                ctx.save();
+                ctx.beginPath();
+                ctx.rect(i32[p+1], i32[p+2], i32[p+3], i32[p+4]);
+                ctx.clip();
+                p += 5;
+                break;
+              case 7: /* DRAW_OP_UNCLIP */
+                ctx.restore();
+                p += 3;
+                break;
+              case 8: /* DRAW_OP_UPDATE */
+                /*
+                 * Just take the smallest rectangle containing all
+                 * updates so far. We could instead keep the data in a
+                 * richer form (e.g. retain multiple smaller rectangles
+                 * needing update, and only redraw the whole thing
+                 * beyond a certain threshold) but this will do for
+                 * now.
+                 */
+                x = i32[p+1]; y = i32[p+2]; w = i32[p+3]; h = i32[p+4];
+                if (update_xmin === undefined || update_xmin > x) update_xmin = x;
+                if (update_ymin === undefined || update_ymin > y) update_ymin = y;
+                if (update_xmax === undefined || update_xmax < x+w) update_xmax = x+w;
+                if (update_ymax === undefined || update_ymax < y+h) update_ymax = y+h;
+                p += 5;
+                break;
+              case 9: /* DRAW_OP_BLITTER_SAVE */
+                x = i32[p+2]; y = i32[p+3]; w = i32[p+4]; h = i32[p+5];
+                blitters[i32[p+1]].getContext('2d').drawImage(
+                    offscreen_canvas, x, y, w, h, 0, 0, w, h);
+                p += 6;
+                break;
+              case 10: /* DRAW_OP_BLITTER_LOAD */
+                x = i32[p+2]; y = i32[p+3]; w = i32[p+4]; h = i32[p+5];
+                ctx.drawImage(blitters[i32[p+1]], 0, 0, w, h, x, y, w, h);
+                p += 6;
+                break;
+              default:
+                throw "bad draw command " + i32[p];
+            }
         }
-        ctx.lineWidth = '1';
-        ctx.lineCap = 'round';
-        ctx.lineJoin = 'round';
-        ctx.strokeStyle = UTF8ToString(outline);
-        ctx.stroke();
     },
 
     /*
@@ -440,25 +463,6 @@ mergeInto(LibraryManager.library, {
         return ret;
     },
 
-    /*
-     * void js_canvas_draw_text(int x, int y, int halign,
-     *                          const char *colptr, const char *fontptr,
-     *                          const char *text);
-     * 
-     * Draw text. Vertical alignment has been taken care of on the C
-     * side, by optionally calling the above function. Horizontal
-     * alignment is handled here, since we can get the canvas draw
-     * function to do it for us with almost no extra effort.
-     */
-    js_canvas_draw_text: function(x, y, halign, colptr, fontptr, text) {
-        ctx.font = UTF8ToString(fontptr);
-        ctx.fillStyle = UTF8ToString(colptr);
-        ctx.textAlign = (halign == 0 ? 'left' :
-                         halign == 1 ? 'center' : 'right');
-        ctx.textBaseline = 'alphabetic';
-        ctx.fillText(UTF8ToString(text), x, y);
-    },
-
     /*
      * int js_canvas_new_blitter(int w, int h);
      * 
@@ -484,35 +488,6 @@ mergeInto(LibraryManager.library, {
         blitters[id] = null;
     },
 
-    /*
-     * void js_canvas_copy_to_blitter(int id, int x, int y, int w, int h);
-     * 
-     * Copy from the puzzle image to a blitter. The size is passed to
-     * us, partly so we don't have to remember the size of each
-     * blitter, but mostly so that the C side can adjust the copy
-     * rectangle in the case where it partially overlaps the edge of
-     * the screen.
-     */
-    js_canvas_copy_to_blitter: function(id, x, y, w, h) {
-        var blitter_ctx = blitters[id].getContext('2d');
-        blitter_ctx.drawImage(offscreen_canvas,
-                              x, y, w, h,
-                              0, 0, w, h);
-    },
-
-    /*
-     * void js_canvas_copy_from_blitter(int id, int x, int y, int w, int h);
-     * 
-     * Copy from a blitter back to the puzzle image. As above, the
-     * size of the copied rectangle is passed to us from the C side
-     * and may already have been modified.
-     */
-    js_canvas_copy_from_blitter: function(id, x, y, w, h) {
-        ctx.drawImage(blitters[id],
-                      0, 0, w, h,
-                      x, y, w, h);
-    },
-
     /*
      * void js_canvas_make_statusbar(void);
      * 
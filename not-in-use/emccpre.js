@@ -26,10 +26,14 @@ var onscreen_canvas, offscreen_canvas;
 var ctx;
 
 // Bounding rectangle for the copy to the onscreen canvas that will be
-// done at drawing end time. Updated by js_canvas_draw_update and used
-// by js_canvas_end_draw.
+// done at drawing end time. Updated by the UPDATE commands replayed
+// in js_canvas_draw_commands and used by js_canvas_end_draw.
 var update_xmin, update_xmax, update_ymin, update_ymax;
 
+// The puzzle's colours as canvas style strings, indexed as in draw
+// commands. Set once by js_canvas_set_colours.
+var colours = [];
+
 // Module object for Emscripten. We fill in these parameters to ensure
 // that Module.run() won't be called until we're ready (we want to do
 // our own init stuff first), and that when main() returns nothing